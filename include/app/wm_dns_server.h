@@ -54,6 +54,35 @@ s8 tls_dnss_start(u8 *dnsname);
  */
 void tls_dnss_stop(void);
 
+/**
+ * @brief          This function is used to answer one more name
+ *                 with the server's address
+ *
+ * @param[in]      *dnsname    dns name, "*" answers every name and
+ *                             "*.wm.com" every name below wm.com
+ *
+ * @retval         WM_SUCCESS     success
+ * @retval         WM_FAILED	  failed
+ *
+ * @note           Captive portal checks of phones are answered from
+ *                 prebuilt replies. Names are kept when the service
+ *                 is restarted.
+ */
+s8 tls_dnss_add_name(u8 *dnsname);
+
+/**
+ * @brief          This function is used to remove a name added by
+ *                 tls_dnss_add_name
+ *
+ * @param[in]      *dnsname    dns name as it was added
+ *
+ * @retval         WM_SUCCESS     success
+ * @retval         WM_FAILED	  failed
+ *
+ * @note           None
+ */
+s8 tls_dnss_del_name(u8 *dnsname);
+
 /**
  * @}
  */
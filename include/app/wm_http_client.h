@@ -139,6 +139,8 @@ typedef signed long             LONG;
 // HTTP Type Definitions 
 typedef UINT32          HTTP_SESSION_HANDLE;
 typedef UINT32          HTTP_CLIENT_SESSION_FLAGS;
+/** consumer of HTTPClientReadDataStream, returns HTTP_CLIENT_SUCCESS to go on */
+typedef UINT32          (*HTTP_CLIENT_BODY_CB)(VOID *pArg, CHAR *pData, UINT32 nLength);
 /******************************************************************************
 *
 *  Section      : HTTP API structures
@@ -184,6 +186,26 @@ typedef struct _HTTP_CLIENT
     UINT32        HttpState;
 } HTTP_CLIENT;
 
+/** Latency of one request phase, in OS ticks */
+typedef struct _HTTP_CLIENT_PHASE
+{
+    UINT32        nCount;                         // Requests that went through the phase
+    UINT32        nTotal;                         // Sum of their times (average = nTotal / nCount)
+    UINT32        nMax;                           // Longest time
+} HTTP_CLIENT_PHASE;
+
+/** Request statistics of all sessions, see HTTPClientGetStats */
+typedef struct _HTTP_CLIENT_STATS
+{
+    UINT32        nRequests;                      // Requests that got a response
+    UINT32        nReused;                        // Of these, sent on a pooled keep-alive connection
+    HTTP_CLIENT_PHASE Dns;                        // Host name resolution
+    HTTP_CLIENT_PHASE Connect;                    // TCP connect and TLS handshake
+    HTTP_CLIENT_PHASE Send;                       // Request headers and posted data
+    HTTP_CLIENT_PHASE Wait;                       // Request sent until the response headers are in
+    HTTP_CLIENT_PHASE Body;                       // Response headers until the end of the body
+} HTTP_CLIENT_STATS;
+
 /** HTTP parameters */
 typedef struct _HTTPParameters
 {
@@ -397,6 +419,24 @@ UINT32                  HTTPClientRecvResponse        (HTTP_SESSION_HANDLE pSess
  * @note           None
  */
 UINT32                  HTTPClientReadData            (HTTP_SESSION_HANDLE pSession, VOID *pBuffer, UINT32 nBytesToRead, UINT32 nTimeout, UINT32 *nBytesRecived);
+/**
+ * @brief          Read the whole response body and pass it to a callback
+ *
+ * @param[in]      pSession           HTTP Session handle
+ * @param[in]      *pBuffer           Buffer the body is received into
+ * @param[in]      nBufferSize        The size of the buffer
+ * @param[in]      nTimeout           Timeout of each socket read in seconds
+ * @param[in]      pfnBody            Called with every filled buffer and with the rest of the body
+ * @param[in]      *pArg              Passed to pfnBody
+ * @param[out]     *nBytesRecived     Count of the body bytes passed to pfnBody, may be NULL
+ *
+ * @retval         HTTP_CLIENT_EOS         the whole body was received
+ * @retval         other                   failed, or the value pfnBody returned to stop
+ *
+ * @note           Chunked bodies are passed without their framing. The socket
+ *                 is not read while pfnBody runs.
+ */
+UINT32                  HTTPClientReadDataStream      (HTTP_SESSION_HANDLE pSession, VOID *pBuffer, UINT32 nBufferSize, UINT32 nTimeout, HTTP_CLIENT_BODY_CB pfnBody, VOID *pArg, UINT32 *nBytesRecived);
 /**
  * @brief          Fill the users structure with the session information
  *
@@ -409,6 +449,33 @@ UINT32                  HTTPClientReadData            (HTTP_SESSION_HANDLE pSess
  * @note           None
  */
 UINT32                  HTTPClientGetInfo             (HTTP_SESSION_HANDLE pSession, HTTP_CLIENT *HTTPClient);
+/**
+ * @brief          Get the request latency statistics of all sessions
+ *
+ * @param[out]     *pStats            The statistics
+ * @param[in]      bReset             TRUE to clear them afterwards
+ *
+ * @return         None
+ *
+ * @note           With TLS_CONFIG_HTTP_CLIENT_POOL a session reuses an idle
+ *                 connection to the same host and port, then the Dns and
+ *                 Connect phases are skipped.
+ */
+VOID                    HTTPClientGetStats            (HTTP_CLIENT_STATS *pStats, BOOL bReset);
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+/**
+ * @brief          Close idle keep-alive connections
+ *
+ * @param[in]      bAll               FALSE closes those whose idle time is over,
+ *                                    TRUE all of them
+ *
+ * @return         None
+ *
+ * @note           A connection is kept by HTTPClientCloseRequest when the whole
+ *                 response was read and the server did not ask to close it.
+ */
+VOID                    HTTPClientCloseIdle           (BOOL bAll);
+#endif
 /**
  * @brief          Initiate the headr searching functions and find the first header
  *
@@ -283,6 +283,31 @@ INT8S tls_dnss_start(INT8U * DnsName);
  */
 void tls_dnss_stop(void);
 
+/**
+ * @brief          Answer one more name with the dns server's address
+ *
+ * @param[in]      DnsName    dns name, "*" or "*.wm.com" for a wildcard
+ *
+ * @retval         DNSS_ERR_SUCCESS - No error
+ * @retval         DNSS_ERR_PARAM - Input parameter error
+ * @retval         DNSS_ERR_MEM - The name table is full
+ *
+ * @note           The names are kept when the server is restarted
+ */
+INT8S tls_dnss_add_name(INT8U * DnsName);
+
+/**
+ * @brief          Remove a name added by tls_dnss_add_name
+ *
+ * @param[in]      DnsName    dns name as it was added
+ *
+ * @retval         DNSS_ERR_SUCCESS - No error
+ * @retval         DNSS_ERR_PARAM - Unknown name
+ *
+ * @note           None
+ */
+INT8S tls_dnss_del_name(INT8U * DnsName);
+
 /**
  * @brief          Get station's ip address by mac address
  *
@@ -97,6 +97,20 @@ struct tls_ethif * tls_netif_get_ethif(void);
  */
 err_t tls_dhcp_start(void);
 
+/**
+ * @brief          This function is used to start DHCP Client from
+ *                 INIT-REBOOT, reusing a previous lease
+ *
+ * @param[in]      ipaddr    previously leased address, network order
+ *
+ * @retval         0     success
+ * @retval         Minus failed
+ *
+ * @note           falls back to a normal discover when the server
+ *                 does not confirm the address
+ */
+err_t tls_dhcp_start_reboot(u32 ipaddr);
+
 /**
  * @brief          This function is used to stop DHCP client
  *
@@ -341,4 +355,22 @@ err_t tls_netif2_set_addr(ip4_addr_t *ipaddr,
 void tls_dhcps_setdns(u8_t numdns);
 #endif
 
+#if TLS_CONFIG_LWIP_POOLS
+/**
+ * @brief          Format the lwIP heap and memp pool usage as text
+ *
+ * @param[out]     buf     output buffer
+ * @param[in]      len     size of buf
+ *
+ * @retval         number of characters written, not counting the terminator
+ *
+ * @note           The first line is "<static_bytes>,<heap_size>,<heap_used>,
+ *                 <heap_max>,<heap_err>", static_bytes being the heap plus
+ *                 all pools. Then one "<pool>,<size>,<num>,<used>,<max>,<err>"
+ *                 line per pool. Lines are separated by CR LF; pools that do
+ *                 not fit are dropped.
+ */
+int tls_netif_mem_report(char *buf, int len);
+#endif
+
 #endif //WM_NETIF_H
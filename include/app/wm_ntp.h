@@ -33,17 +33,83 @@
  * @{
  */
 
+typedef struct {
+    u8 synced;          /**< the clock was set from a server */
+    u8 service;         /**< tls_ntp_sync_start is running */
+    u8 server;          /**< server of the last sample, as numbered by tls_ntp_set_server */
+    s32 offset_ms;      /**< last sample against the clock before it was corrected */
+    u32 delay_ms;       /**< round trip of the last sample */
+    s32 freq_ppb;       /**< correction added to the local tick clock */
+    s32 rtc_ppm;        /**< estimated RTC error, 0 until known */
+    u32 poll;           /**< seconds between rounds of the service */
+    u32 rounds;
+    u32 samples;        /**< valid answers */
+    u32 failures;       /**< rounds without a valid answer */
+    u32 steps;          /**< offsets too large to slew */
+} tls_ntp_status_t;
+
 /**
  * @brief          This function is used to get network time.
  *
  * @param          None
  *
- * @retval         time value
+ * @retval         time value, UTC + 8 hours; 0 on failure
  *
- * @note           None
+ * @note           All servers are asked at once and the answer with the
+ *                 shortest round trip is used. While the clock is fresh
+ *                 from tls_ntp_sync_start no request is sent.
  */
 u32 tls_ntp_client(void);
 
+/**
+ * @brief          This function is used to get the disciplined UTC time.
+ *
+ * @param[out]     sec    seconds since 1970, may be NULL
+ * @param[out]     ms     milliseconds, may be NULL
+ *
+ * @retval         WM_SUCCESS     success
+ * @retval         WM_FAILED      never synchronized
+ *
+ * @note           Does not block or use the network.
+ */
+int tls_ntp_get_time(u32 *sec, u32 *ms);
+
+/**
+ * @brief          This function is used to keep the time synchronized.
+ *
+ * @param          None
+ *
+ * @retval         WM_SUCCESS     success
+ * @retval         WM_FAILED      no server could be resolved
+ *
+ * @note           Polls the servers every 64 to 16384 seconds, slews the
+ *                 clock and its frequency and writes the RTC at a second
+ *                 boundary. Blocks for the server names only.
+ */
+int tls_ntp_sync_start(void);
+
+/**
+ * @brief          This function is used to stop the synchronization.
+ *
+ * @param          None
+ *
+ * @return         None
+ *
+ * @note           The clock keeps running on its last frequency.
+ */
+void tls_ntp_sync_stop(void);
+
+/**
+ * @brief          This function is used to get the synchronization state.
+ *
+ * @param[out]     status    state and counters
+ *
+ * @return         None
+ *
+ * @note           None
+ */
+void tls_ntp_get_status(tls_ntp_status_t *status);
+
 /**
  * @brief          This function is used to set ntp servers.
  *
@@ -168,6 +168,19 @@ void tls_pmu_timer1_start(u16 msec);
 void tls_pmu_timer1_stop(void);
 
 
+/**
+ * @brief          	This function is used to check whether pmu timer1 ran out
+ *
+ * @param		None
+ *
+ * @retval         	1    	its interrupt is pending, not yet served
+ * @retval         	0    	not run out
+ *
+ * @note           	None
+ */
+int tls_pmu_timer1_expired(void);
+
+
 
 /**
  * @brief          	This function is used to start pmu goto standby 
@@ -58,6 +58,28 @@ void tls_set_rtc(struct tm *tblock);
  */
 void tls_get_rtc(struct tm *tblock);
 
+/**
+ * @brief          This function is used to set pmu rtc time in seconds
+ *
+ * @param[in]      t    seconds since 1970, as taken by localtime()
+ *
+ * @return         None
+ *
+ * @note           None
+ */
+void tls_rtc_set_time(time_t t);
+
+/**
+ * @brief          This function is used to get pmu rtc time in seconds
+ *
+ * @param          None
+ *
+ * @return         seconds since 1970, as returned by mktime()
+ *
+ * @note           None
+ */
+time_t tls_rtc_get_time(void);
+
 /**
  * @brief          This function is used to register pmu rtc interrupt
  *
@@ -0,0 +1,119 @@
+/**
+ * @file    wm_dns.h
+ *
+ * @brief   asynchronous DNS resolver
+ *
+ * @author  winnermicro
+ *
+ * Copyright (c) 2014 Winner Microelectronics Co., Ltd.
+ */
+#ifndef WM_DNS_H
+#define WM_DNS_H
+
+#include "wm_type_def.h"
+
+/**
+ * @defgroup DNS_APIs DNS APIs
+ * @brief DNS resolver APIs
+ */
+
+/**
+ * @addtogroup DNS_APIs
+ * @{
+ */
+
+/** Names kept in the cache */
+#define TLS_DNS_CACHE_NUM       16
+/** A records kept per name */
+#define TLS_DNS_ADDR_MAX        4
+/** Callbacks waiting for answers, over all names */
+#define TLS_DNS_WAITER_NUM      8
+/** Seconds a missing name is remembered */
+#define TLS_DNS_NEG_TTL         30
+/** Names with a shorter TTL are not refreshed ahead of expiry */
+#define TLS_DNS_PREFETCH_TTL    16
+/** First retransmission timeout in ms, doubled for each try */
+#define TLS_DNS_RTO             1000
+#define TLS_DNS_TRIES           3
+
+#define TLS_DNS_OK              0
+#define TLS_DNS_INPROGRESS      1
+#define TLS_DNS_ERR             -1
+
+/**
+ * @brief          Called with the result of tls_dns_resolve
+ *
+ * @param[in]      addr     IPv4 addresses in network byte order, NULL on failure
+ * @param[in]      count    number of addresses, 0 on failure
+ * @param[in]      arg      argument given to tls_dns_resolve
+ *
+ * @note           Runs in the tcpip thread and must not block.
+ */
+typedef void (*tls_dns_found_fn)(const u32 *addr, u8 count, void *arg);
+
+typedef struct {
+    u32 hits;           /**< answered from the cache */
+    u32 neg_hits;       /**< failed from the negative cache */
+    u32 misses;         /**< started a query */
+    u32 joined;         /**< waited for a query already in flight */
+    u32 prefetches;     /**< refreshed before expiry */
+    u32 sent;           /**< query packets, one per server and try */
+    u32 answers;
+    u32 nxdomain;       /**< names without an A record */
+    u32 timeouts;
+} tls_dns_stats_t;
+
+/**
+ * @brief          Initialize the resolver
+ *
+ * @note           Called once after tcpip_init.
+ */
+void tls_dns_init(void);
+
+/**
+ * @brief          Resolve a name without blocking
+ *
+ * @param[in]      name     host name or dotted IPv4 address
+ * @param[out]     addr     first address, set when TLS_DNS_OK is returned
+ * @param[in]      found    called when the answer arrives, may be NULL
+ * @param[in]      arg      argument of found
+ *
+ * @retval         TLS_DNS_OK            answered from the cache
+ * @retval         TLS_DNS_INPROGRESS    found will be called
+ * @retval         TLS_DNS_ERR           invalid name, known to be missing or
+ *                                       out of resources
+ *
+ * @note           The query goes to all configured DNS servers at once
+ *                 and the first answer wins.
+ */
+int tls_dns_resolve(const char *name, u32 *addr, tls_dns_found_fn found, void *arg);
+
+/**
+ * @brief          Resolve a name, blocking until the answer or the last
+ *                 retransmission timed out
+ *
+ * @param[in]      name     host name or dotted IPv4 address
+ * @param[out]     addr     address in network byte order
+ *
+ * @retval         TLS_DNS_OK     success
+ * @retval         TLS_DNS_ERR    failed
+ *
+ * @note           Does not block when the name is in the cache.
+ */
+int tls_dns_gethostbyname(const char *name, u32 *addr);
+
+/**
+ * @brief          Drop all cached names, queries in flight are kept
+ */
+void tls_dns_flush(void);
+
+/**
+ * @brief          Get the resolver counters
+ */
+void tls_dns_get_stats(tls_dns_stats_t *stats);
+
+/**
+ * @}
+ */
+
+#endif /* WM_DNS_H */
@@ -202,6 +202,21 @@ int tls_socket_send(u8 skt_num, void *pdata, u16 len);
 */
 int tls_socket_close(u8 skt_num);
 
+#if TLS_CONFIG_TCP_WND_AUTOTUNE
+/**
+* @brief This function is called by your application code to pin the TCP window priority of a connected socket.
+*
+* @param[in] skt_num      Is the socket number that returned by tls_socket_create function, or of an accepted client.
+*
+* @param[in] prio         TCP_WND_PRIO_LOW (smallest window), TCP_WND_PRIO_NORMAL (sized from RTT and throughput)
+*                         or TCP_WND_PRIO_HIGH (largest share of the memory budget).
+*
+* @retval	 ERR_OK    If the priority is set.
+*              negative number   If an error was detected.
+*/
+int tls_socket_set_wnd_prio(u8 skt_num, u8 prio);
+#endif
+
 struct tls_skt_status_ext_t {
     u8 socket;
     u8 status;
@@ -232,6 +232,7 @@ struct linger {
 #define TCP_KEEPIDLE   0x03    /* set pcb->keep_idle  - Same as TCP_KEEPALIVE, but use seconds for get/setsockopt */
 #define TCP_KEEPINTVL  0x04    /* set pcb->keep_intvl - Use seconds for get/setsockopt */
 #define TCP_KEEPCNT    0x05    /* set pcb->keep_cnt   - Use number of probes sent for get/setsockopt */
+#define TCP_WNDPRIO    0x10    /* TCP_WND_PRIO_xxx of the window auto-tuning (TLS_CONFIG_TCP_WND_AUTOTUNE) */
 
 #if TLS_CONFIG_IPV6
 /**
@@ -59,6 +59,51 @@ typedef void    tls_os_mutex_t;
 /** TYPE definition of TLS_OS_TIMER_CALLBACK */
 typedef  void (*TLS_OS_TIMER_CALLBACK)(void *ptmr, void *parg);
 
+/** Size in words of the caller storage of a statically created task, with the
+    run time counters and the mutex base priority */
+#define TLS_OS_TASK_STATIC_WORDS      21
+/** Size in words of the caller storage of a statically created queue, mailbox, semaphore or mutex */
+#define TLS_OS_QUEUE_STATIC_WORDS     20
+/** Size in words of the caller storage of a statically created timer */
+#define TLS_OS_TIMER_STATIC_WORDS     12
+
+/** TYPE definition of the caller storage for tls_os_task_create_static */
+typedef struct tls_os_task_static {
+	u32 space[TLS_OS_TASK_STATIC_WORDS];
+} tls_os_task_static_t;
+/** TYPE definition of the caller storage for tls_os_queue_create_static */
+typedef struct tls_os_queue_static {
+	u32 space[TLS_OS_QUEUE_STATIC_WORDS];
+} tls_os_queue_static_t;
+/** TYPE definition of the caller storage for tls_os_sem_create_static */
+typedef tls_os_queue_static_t tls_os_sem_static_t;
+/** TYPE definition of the caller storage for tls_os_mutex_create_static */
+typedef tls_os_queue_static_t tls_os_mutex_static_t;
+/** TYPE definition of the caller storage for tls_os_mailbox_create_static */
+typedef tls_os_queue_static_t tls_os_mailbox_static_t;
+/** TYPE definition of the caller storage for tls_os_timer_create_static */
+typedef struct tls_os_timer_static {
+	u32 space[TLS_OS_TIMER_STATIC_WORDS];
+} tls_os_timer_static_t;
+
+#if TLS_CONFIG_TASK_PROFILE
+/** Period in microseconds of the hardware timer driving the task profiler */
+#define TLS_OS_TASK_PROF_TICK_US      100
+/** Maximum length of a task name reported by the task profiler */
+#define TLS_OS_TASK_PROF_NAME_LEN     8
+
+/** Structure definition of the per-task profiling record */
+struct tls_os_task_prof_info {
+	char name[TLS_OS_TASK_PROF_NAME_LEN + 1];   /**< task name */
+	char state;                                 /**< R: ready, B: blocked, S: suspended, D: deleted */
+	u8   prio;                                  /**< task priority, as passed to tls_os_task_create */
+	u32  run_time;                              /**< run time, in TLS_OS_TASK_PROF_TICK_US units */
+	u32  switches;                              /**< number of times the task was switched in */
+	u32  stk_size;                              /**< stack size, in bytes */
+	u32  stk_free;                              /**< least free stack ever seen, in bytes */
+};
+#endif
+
 /** MACRO definition of TIMER ONE times */
 #define TLS_OS_TIMER_OPT_ONE_SHORT    1u
 /** MACRO definition of TIMER PERIOD */
@@ -198,6 +243,36 @@ tls_os_status_t tls_os_task_create(tls_os_task_t *task,
       u32 prio,
       u32 flag);
 
+/**
+ * @brief          This function is used to create a task without allocating
+                   its control block from the heap.
+ *
+ * @param[in]      *task      pointer to the task
+ * @param[in]      *tcb       caller storage for the task control block,
+                              must stay valid for the lifetime of the task
+ * @param[in]      name       the task's name
+ * @param[in]      entry      the task's entry function
+ * @param[in]      param      parameter passed to entry
+ * @param[in]      *stk_start pointer to the task's bottom of stack
+ * @param[in]      stk_size   the size of the stack in bytes
+ * @param[in]      prio       the task's priority
+ * @param[in]      flag       contains additional information about the behavior of the task
+ *
+ * @retval         TLS_OS_SUCCESS     the call was successful.
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           Same stack requirements as tls_os_task_create
+ */
+tls_os_status_t tls_os_task_create_static(tls_os_task_t *task,
+      tls_os_task_static_t *tcb,
+      const char* name,
+      void (*entry)(void* param),
+      void* param,
+      u8 *stk_start,
+      u32 stk_size,
+      u32 prio,
+      u32 flag);
+
 /**
  * @brief          This function allows you to delete a task.  The calling
                    task can delete itself by its own priority number.
@@ -243,6 +318,21 @@ tls_os_status_t tls_os_task_del(u8 prio, void (*freefun)(void));
  */
 tls_os_status_t tls_os_mutex_create(u8 prio, tls_os_mutex_t **mutex);
 
+/**
+ * @brief          This function creates a mutual exclusion semaphore
+                   in caller storage
+ *
+ * @param[in]      prio      see tls_os_mutex_create
+ * @param[in]      *mcb      caller storage for the mutex
+ * @param[in]      **mutex   pointer to the created mutex
+ *
+ * @retval         TLS_OS_SUCCESS     the call was successful
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           None
+ */
+tls_os_status_t tls_os_mutex_create_static(u8 prio, tls_os_mutex_static_t *mcb, tls_os_mutex_t **mutex);
+
 /**
  * @brief          This function deletes a mutual exclusion semaphore and
                    readies all tasks pending on the it
@@ -330,6 +420,20 @@ tls_os_status_t tls_os_mutex_create(u8 prio, tls_os_mutex_t **mutex);
  */
 tls_os_status_t tls_os_sem_create(tls_os_sem_t **sem, u32 cnt);
 
+/**
+ * @brief          This function creates a semaphore in caller storage
+ *
+ * @param[in]      **sem    pointer to the created semaphore
+ * @param[in]      *scb     caller storage for the semaphore
+ * @param[in]      cnt      the initial value for the semaphore
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           None
+ */
+tls_os_status_t tls_os_sem_create_static(tls_os_sem_t **sem, tls_os_sem_static_t *scb, u32 cnt);
+
 
 /**
  * @brief          This function deletes a semaphore and readies all tasks
@@ -413,6 +517,31 @@ tls_os_status_t tls_os_sem_delete(tls_os_sem_t *sem);
  */
  tls_os_status_t tls_os_queue_create(tls_os_queue_t **queue, u32 queue_size);
 
+/**
+ * @brief          This function creates a message queue in caller storage
+ *
+ * @param[in]      **queue       pointer to the created queue
+ * @param[in]      *qcb          caller storage for the queue control block
+ * @param[in]      *storage      caller storage for queue_size messages of
+ 								 msg_size bytes
+ * @param[in]      queue_size    the number of messages
+ * @param[in]      msg_size      0 for a queue of pointers used with
+ 								 tls_os_queue_send/tls_os_queue_receive,
+ 								 otherwise the size of the messages passed by
+ 								 copy with tls_os_queue_send_copy/
+ 								 tls_os_queue_receive_copy
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           None
+ */
+ tls_os_status_t tls_os_queue_create_static(tls_os_queue_t **queue,
+        tls_os_queue_static_t *qcb,
+        void *storage,
+        u32 queue_size,
+        u32 msg_size);
+
 /**
  * @brief          This function deletes a message queue and readies all
                    tasks pending on the queue
@@ -457,6 +586,43 @@ tls_os_status_t tls_os_sem_delete(tls_os_sem_t *sem);
  */
 tls_os_status_t tls_os_queue_flush(tls_os_queue_t *queue);
 
+/**
+ * @brief          This function copies a message into a queue created by
+                   tls_os_queue_create_static with a non-zero msg_size
+ *
+ * @param[in]      *queue     pointer to the queue
+ * @param[in]      *msg       pointer to the message to copy
+ * @param[in]      msg_size   message size, must match the queue
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           May be called from an ISR
+ */
+ tls_os_status_t tls_os_queue_send_copy(tls_os_queue_t *queue,
+        const void *msg,
+        u32 msg_size);
+
+/**
+ * @brief          This function waits for a message of a queue created by
+                   tls_os_queue_create_static with a non-zero msg_size and
+                   copies it out
+ *
+ * @param[in]      *queue       pointer to the queue
+ * @param[out]     *msg         buffer receiving the message
+ * @param[in]      msg_size     message size, must match the queue
+ * @param[in]      wait_time    timeout in clock ticks, 0 waits forever
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           None
+ */
+ tls_os_status_t tls_os_queue_receive_copy(tls_os_queue_t *queue,
+        void *msg,
+        u32 msg_size,
+        u32 wait_time);
+
 
 /**
  * @brief          This function waits for a message to be sent to a queue
@@ -496,6 +662,24 @@ tls_os_status_t tls_os_queue_flush(tls_os_queue_t *queue);
  */
  tls_os_status_t tls_os_mailbox_create(tls_os_mailbox_t **mailbox, u32 mailbox_size);
 
+/**
+ * @brief          This function creates a message mailbox in caller storage
+ *
+ * @param[in]      **mailbox     pointer to the created mailbox
+ * @param[in]      *mbcb         caller storage for the mailbox
+ * @param[in]      **storage     caller storage for mailbox_size pointers
+ * @param[in]      mailbox_size  size
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       failed
+ *
+ * @note           None
+ */
+ tls_os_status_t tls_os_mailbox_create_static(tls_os_mailbox_t **mailbox,
+        tls_os_mailbox_static_t *mbcb,
+        void **storage,
+        u32 mailbox_size);
+
 /**
  * @brief          This function deletes a mailbox and readies all of the tasks
                    pending on the this mailbox.
@@ -622,6 +806,30 @@ tls_os_status_t tls_os_queue_flush(tls_os_queue_t *queue);
         bool repeat,
         u8 *name);
 
+/**
+ * @brief          This function creates a timer in caller storage
+ *
+ * @param[in]      **timer     pointer to the created timer
+ * @param[in]      *tcb        caller storage for the timer
+ * @param[in]      callback    see tls_os_timer_create
+ * @param[in]      *callback_arg   see tls_os_timer_create
+ * @param[in]      period      see tls_os_timer_create
+ * @param[in]      repeat      if repeat
+ * @param[in]      *name       name of the timer
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR		  failed
+ *
+ * @note           None
+ */
+ tls_os_status_t tls_os_timer_create_static(tls_os_timer_t **timer,
+        tls_os_timer_static_t *tcb,
+        TLS_OS_TIMER_CALLBACK callback,
+        void *callback_arg,
+        u32 period,
+        bool repeat,
+        u8 *name);
+
 /**
  * @brief          This function is called by your application code to start
                    a timer.
@@ -703,6 +911,76 @@ int tls_os_timer_delete(tls_os_timer_t *timer);
  */
 void tls_os_disp_task_stat_info(void);
 
+#if TLS_CONFIG_TASK_PROFILE
+/**
+ * @brief          This function is used to start (or restart) the task
+ *                 profiler
+ *
+ * @param[in]      None
+ *
+ * @retval         TLS_OS_SUCCESS     success
+ * @retval         TLS_OS_ERROR       no hardware timer available
+ *
+ * @note           All run time and context switch counters are cleared.
+ *                 The first call claims one timer from wm_timer.c.
+ */
+tls_os_status_t tls_os_task_prof_start(void);
+
+/**
+ * @brief          This function is used to stop the task profiler
+ *
+ * @param[in]      None
+ *
+ * @return         None
+ *
+ * @note           Counters are frozen, not cleared, so they can still be read.
+ */
+void tls_os_task_prof_stop(void);
+
+/**
+ * @brief          This function is used to check whether the task profiler
+ *                 is running
+ *
+ * @param[in]      None
+ *
+ * @retval         1     running
+ * @retval         0     stopped
+ *
+ * @note           None
+ */
+u8 tls_os_task_prof_running(void);
+
+/**
+ * @brief          This function is used to read the per-task statistics
+ *
+ * @param[out]     info        array receiving one record per task
+ * @param[in]      max         number of records available in info
+ * @param[out]     total       time covered by the statistics, may be NULL
+ * @param[out]     isr         part of total spent in interrupt handlers, may be NULL
+ *
+ * @retval         number of records written
+ *
+ * @note           total and isr are in TLS_OS_TASK_PROF_TICK_US units.
+ *                 Scans every task stack, do not call it from an ISR.
+ */
+int tls_os_task_prof_get(struct tls_os_task_prof_info *info, int max, u32 *total, u32 *isr);
+
+/**
+ * @brief          This function is used to format the task statistics as text
+ *
+ * @param[out]     buf     output buffer
+ * @param[in]      len     size of buf
+ *
+ * @retval         number of characters written, not counting the terminator
+ *
+ * @note           The first line is "<running>,<total_ms>,<isr_permille>", then
+ *                 one "<name>,<prio>,<state>,<cpu_permille>,<switches>,
+ *                 <stk_free>,<stk_size>" line per task.  Lines are separated
+ *                 by CR LF; tasks that do not fit are dropped.
+ */
+int tls_os_task_prof_report(char *buf, int len);
+#endif
+
 /**
  * @}
  */
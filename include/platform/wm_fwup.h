@@ -185,6 +185,35 @@ int tls_fwup_init(void);
  */
 u32 tls_fwup_enter(enum tls_fwup_image_src image_src);
 
+/**
+ * @brief          This function is used to continue an image update whose
+ *                 first bytes were programmed by an earlier session,
+ *                 e.g. before a reboot.
+ *
+ * @param[in]      image_src   image file's source
+ * @param[in]      *booter     header of the image
+ * @param[in]      offset      image bytes after the header already in flash,
+ *                             a multiple of INSIDE_FLS_SECTOR_SIZE
+ *
+ * @retval         non-zero    successfully, return session id
+ * @retval         0           failed, or the image can not be resumed
+ *
+ * @note           The following requests carry the image from offset on,
+ *                 without the header.
+ */
+u32 tls_fwup_enter_resume(enum tls_fwup_image_src image_src, T_BOOTER *booter, u32 offset);
+
+/**
+ * @brief          This function is used to get how much of the image is in flash
+ *
+ * @param[in]      session_id    session identity of firmware update progress
+ *
+ * @retval         image bytes after the header programmed to flash
+ *
+ * @note           Data still in the sector buffer is not counted
+ */
+u32 tls_fwup_programmed_len(u32 session_id);
+
 /**
  * @brief          This function is used to exit firmware update progress.
  *
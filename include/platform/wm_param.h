@@ -105,6 +105,9 @@ struct tls_sys_param {
 	char sntp_service2[32];
 	char sntp_service3[32];
     struct tls_param_tem_offset params_tem;
+    struct tls_param_fast_rejoin fast_rejoin;
+    struct tls_param_fwup_progress fwup_progress;
+    struct tls_param_dhcps_lease dhcps_lease;
 };
 
 struct tls_param_flash {
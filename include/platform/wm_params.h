@@ -129,8 +129,11 @@ TLS_PARAM_ID_AUTO_RECONNECT         	|			u8 auto_reconnect
 #define TLS_PARAM_ID_SNTP_SERVER2	(52)
 #define TLS_PARAM_ID_SNTP_SERVER3	(53)
 #define TLS_PARAM_ID_TEM_OFFSET	    (54)
+#define TLS_PARAM_ID_FAST_REJOIN    (55)
+#define TLS_PARAM_ID_FWUP_PROGRESS  (56)
+#define TLS_PARAM_ID_DHCPS_LEASE    (57)
 
-#define TLS_PARAM_ID_MAX            (55)
+#define TLS_PARAM_ID_MAX            (58)
 /**   MACRO of Physical moe of Ieee802.11   */
 #define TLS_PARAM_PHY_11BG_MIXED      (0)
 #define TLS_PARAM_PHY_11B             (1)
@@ -306,6 +309,38 @@ struct tls_param_tem_offset {
 	s32 offset;
 };
 
+/**   Structure of fast rejoin cache, last joined BSS and DHCP lease    */
+struct tls_param_fast_rejoin {
+	u8 valid;
+	u8 channel;
+	u8 bssid[6];
+	u8 ssid_len;
+	u8 ssid[32];
+	u8 ip[4];	/* leased address, 0 for static ip */
+};
+
+/**   Structure of http firmware download progress, to resume after reboot    */
+struct tls_param_fwup_progress {
+	u8 valid;
+	u8 reserved[3];
+	u32 url_hash;		/* image location */
+	u32 img_checksum;	/* upd_checksum of the image header */
+	u32 img_len;		/* upd_img_len of the image header */
+	u32 programmed;		/* image bytes after the header in flash */
+};
+
+#define TLS_PARAM_DHCPS_LEASE_NUM	8
+/**   Structure of softap DHCP server address assignments, kept across reboots    */
+struct tls_param_dhcps_lease {
+	u8 count;
+	u8 reserved[3];
+	struct {
+		u8 mac[6];
+		u8 reserved[2];
+		u8 ip[4];
+	} lease[TLS_PARAM_DHCPS_LEASE_NUM];
+};
+
 /**   Structure of KEY parameter    */
 struct tls_param_key {
 	u8 psk[64];
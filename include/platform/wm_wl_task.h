@@ -28,11 +28,14 @@
 #define TLS_HTTP_CLIENT_TASK_PRIO           (TASK_WL_PRIO_MAX + 9)
 #define AP_SOCKET_S_TASK_PRIO               (TASK_WL_PRIO_MAX + 10)
 #define TLS_UPNP_TASK_PRIO                  (TASK_WL_PRIO_MAX + 11)
+#define TLS_HTTP_FWUP_TASK_PRIO             (TASK_WL_PRIO_MAX + 12)
+#define TLS_MQTT_SESSION_TASK_PRIO          (TASK_WL_PRIO_MAX + 13)
+#define TLS_MQTT_RX_TASK_PRIO               (TASK_WL_PRIO_MAX + 14)
 #define TLS_ONESHOT_TASK_PRIO          		(TASK_WL_PRIO_MAX + 15)
 #define TLS_ONESHOT_SPEC_TASK_PRIO			(TASK_WL_PRIO_MAX + 16)
 
 
-#define TLS_MBOX_ALL_COUNT                  8
+#define TLS_MBOX_ALL_COUNT                  9
 #define TLS_MBOX_ID_WL_TASK                 0
 #define TLS_MBOX_ID_HOSTIF_TASK             1
 #define TLS_MBOX_ID_JDCLOUD_SERVER          2
@@ -41,8 +44,9 @@
 #define TLS_MBOX_ID_UPNP_COMMON             5
 #define TLS_MBOX_ID_UPNP_GENA               6
 #define TLS_MBOX_ID_UPNP_MINISERVER         7
+#define TLS_MBOX_ID_MQTT_SESSION            8
 
-#define TLS_TIMEO_ALL_COUONT                9
+#define TLS_TIMEO_ALL_COUONT                10
 #define TLS_TIMEO_ID_NULL                   0
 #define TLS_TIMEO_ID_WL_TASK                1
 #define TLS_TIMEO_ID_HOSTIF_TASK            2
@@ -52,6 +56,7 @@
 #define TLS_TIMEO_ID_UPNP_COMMON            6
 #define TLS_TIMEO_ID_UPNP_GENA              7
 #define TLS_TIMEO_ID_UPNP_MINISERVER        8
+#define TLS_TIMEO_ID_MQTT_SESSION           9
 
 #define TLS_MSG_ALL_COUONT                  9
 #define TLS_MSG_ID_TX_MGMT_CMPLT            0
@@ -78,6 +78,19 @@ void tls_untimeout_p(u8 timeo_assigned, tls_timeout_handler handler, void *arg);
  */
 void tls_timeouts_mbox_fetch_p(u8 timeo_assigned, tls_mbox_t mbox, void **msg);
 
+/**
+ * @brief          Get the time left before the nearest pending timeout of all
+ *                 the timer lists
+ *
+ * @param          None
+ *
+ * @return         milliseconds, 0xFFFFFFFF if no timeout is pending
+ *
+ * @note           Lower bound, the timeout may be due a tick later. Used to
+ *                 limit the tickless idle sleep
+ */
+u32 tls_timeouts_next_p(void);
+
 /**
  * @brief          Initialize the timer
  *
@@ -59,6 +59,7 @@ CRYPTO
 #define TLS_CONFIG_HTTP_CLIENT_AUTH						(TLS_CONFIG_HTTP_CLIENT_AUTH_BASIC || TLS_CONFIG_HTTP_CLIENT_AUTH_DIGEST)
 #define TLS_CONFIG_HTTP_CLIENT_SECURE					CFG_OFF
 #define TLS_CONFIG_HTTP_CLIENT_TASK						(CFG_ON && TLS_CONFIG_HTTP_CLIENT)
+#define TLS_CONFIG_HTTP_CLIENT_POOL						(CFG_OFF && TLS_CONFIG_HTTP_CLIENT)	/* reuse keep-alive connections across requests */
 
 
 
@@ -72,6 +73,39 @@ CRYPTO
 
 #define TLS_CONFIG_NTP 									CFG_ON
 
+/** Per-task CPU/stack profiling (AT+TPROF, /taskprof.html) **/
+#define TLS_CONFIG_TASK_PROFILE							CFG_OFF
+
+/** Tickless idle, PMU timer1 is reserved for the idle wake-up and the RTC is started; sleeps up to 65 s **/
+#define TLS_CONFIG_TICKLESS_IDLE						CFG_OFF
+
+/** Rejoin the last BSS on its channel and reuse the DHCP lease **/
+#define TLS_CONFIG_FAST_REJOIN							CFG_OFF
+
+/** HTTP OTA in ranged requests, resumed after a reboot **/
+#define TLS_CONFIG_HTTP_FWUP_RANGE						(CFG_OFF && TLS_CONFIG_HTTP_CLIENT)
+
+/** MQTT session: QoS1/2 inflight window, retransmission, offline queue **/
+#define TLS_CONFIG_MQTT_SESSION							CFG_OFF
+
+/** lwIP objects in fixed memp pools and its own heap, RX in PBUF_POOL (AT+LWMEM) **/
+#define TLS_CONFIG_LWIP_POOLS							CFG_OFF
+
+/** Socket calls run under the lwIP core lock, no message to the tcpip thread **/
+#define TLS_CONFIG_LWIP_CORE_LOCKING					CFG_OFF
+
+/** TCP receive window and send buffer sized per connection within a global budget **/
+#define TLS_CONFIG_TCP_WND_AUTOTUNE					CFG_OFF
+
+/** Softap DHCP server keeps its address assignments in the param area **/
+#define TLS_CONFIG_DHCPS_LEASE_SAVE					CFG_OFF
+
+/** Softap DNS server forwards other names upstream in AP+STA mode and caches the answers **/
+#define TLS_CONFIG_DNSS_FORWARD					CFG_OFF
+
+/** Asynchronous DNS resolver with a TTL cache behind gethostbyname **/
+#define TLS_CONFIG_DNS_RESOLVER					CFG_OFF
+
 
 #define  VERC_DNS_OPT						            CFG_ON
 #define  VERC_LWIP_OPT                                  CFG_ON
@@ -45,6 +45,11 @@ static u32 fwup_task_stk[FWUP_TASK_STK_SIZE];
 static u8 oneshotback = 0;
 static u8 *fwupwritebuffer = NULL;
 
+/* header of the image tls_fwup_enter_resume() continues, taken over by
+   fwup_scheduler with the next request */
+static T_BOOTER fwup_resume_booter;
+static bool fwup_resume_pending = FALSE;
+
 T_BOOTER imgheader[2];
 extern u32 flashtotalsize;
 static void fwup_update_autoflag(void)
@@ -192,6 +197,15 @@ static void fwup_scheduler(void *data)
 				{
 					fwup->current_state |= TLS_FWUP_STATE_BUSY;
 				}
+				if(fwup_resume_pending)
+				{
+					/* the header and the first sectors are already in flash */
+					MEMCPY(&booter, &fwup_resume_booter, sizeof(T_BOOTER));
+					org_checksum = booter.upd_checksum;
+					isacrossflash = FALSE;
+					currentlen = 0;
+					fwup_resume_pending = FALSE;
+				}
 				dl_list_for_each_safe(request, temp, &fwup->wait_list, struct tls_fwup_request, list) 
 				{
 					request->status = TLS_FWUP_REQ_STATUS_BUSY;
@@ -502,6 +516,61 @@ u32 tls_fwup_enter(enum tls_fwup_image_src image_src)
 	return session_id;
 }
 
+u32 tls_fwup_enter_resume(enum tls_fwup_image_src image_src, T_BOOTER *booter, u32 offset)
+{
+	u32 session_id;
+	u32 program_base;
+	u32 cpu_sr;
+
+	if ((booter == NULL) || (TRUE != tls_fwup_img_header_check(booter)))
+	{
+		return 0;
+	}
+	if ((IMG_TYPE_OLD_PLAIN != booter->img_type) && (IMG_TYPE_NEW_PLAIN != booter->img_type))
+	{
+		return 0;
+	}
+	if ((offset % INSIDE_FLS_SECTOR_SIZE) || (offset >= booter->upd_img_len))
+	{
+		return 0;
+	}
+	program_base = booter->upd_img_addr | FLASH_BASE_ADDR;
+	/* images moved around the 1M boundary are always written from the start */
+	if ((IMG_TYPE_OLD_PLAIN == booter->img_type)
+		&& (0x200000 == flashtotalsize)
+		&& (program_base < FLASH_1M_END_ADDR)
+		&& ((program_base + booter->upd_img_len) >= (FLASH_1M_END_ADDR - INSIDE_FLS_BLOCK_SIZE)))
+	{
+		return 0;
+	}
+
+	session_id = tls_fwup_enter(image_src);
+	if (session_id == 0)
+	{
+		return 0;
+	}
+
+	cpu_sr = tls_os_set_critical();
+	MEMCPY(&fwup_resume_booter, booter, sizeof(T_BOOTER));
+	fwup->received_len = sizeof(T_BOOTER) + offset;
+	fwup->total_len = booter->upd_img_len;
+	fwup->updated_len = offset;
+	fwup->program_base = program_base;
+	fwup->program_offset = offset;
+	fwup_resume_pending = TRUE;
+	tls_os_release_critical(cpu_sr);
+	return session_id;
+}
+
+u32 tls_fwup_programmed_len(u32 session_id)
+{
+	if ((fwup == NULL) || (session_id != fwup->current_session_id))
+	{
+		return 0;
+	}
+	return fwup->program_offset;
+}
+
 int tls_fwup_exit(u32 session_id)
 {
 	u32 cpu_sr;
@@ -539,6 +608,8 @@ int tls_fwup_exit(u32 session_id)
 
 	fwup->current_session_id = 0;
 	fwup->busy = FALSE;
+	/* a resume the scheduler has not taken over yet ends with the session */
+	fwup_resume_pending = FALSE;
 	if (oneshotback == 1){
 		tls_wifi_set_oneshot_flag(oneshotback); // 恢复一键配置
 	}
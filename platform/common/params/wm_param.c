@@ -269,6 +269,15 @@ static int param_to_flash(int id, int modify_count, int partition_num)
         case TLS_PARAM_ID_TEM_OFFSET:
 			MEMCPY(&dest->params_tem, &src->params_tem, sizeof(struct tls_param_tem_offset));
             break;
+        case TLS_PARAM_ID_FAST_REJOIN:
+			MEMCPY(&dest->fast_rejoin, &src->fast_rejoin, sizeof(struct tls_param_fast_rejoin));
+            break;
+        case TLS_PARAM_ID_FWUP_PROGRESS:
+			MEMCPY(&dest->fwup_progress, &src->fwup_progress, sizeof(struct tls_param_fwup_progress));
+            break;
+        case TLS_PARAM_ID_DHCPS_LEASE:
+			MEMCPY(&dest->dhcps_lease, &src->dhcps_lease, sizeof(struct tls_param_dhcps_lease));
+            break;
 
 
 		default:
@@ -864,6 +873,15 @@ int tls_param_set(int id, void *argv, bool to_flash)
         case TLS_PARAM_ID_TEM_OFFSET:
             MEMCPY(&param->params_tem, argv, sizeof(struct tls_param_tem_offset));
 			break;
+        case TLS_PARAM_ID_FAST_REJOIN:
+            MEMCPY(&param->fast_rejoin, argv, sizeof(struct tls_param_fast_rejoin));
+			break;
+        case TLS_PARAM_ID_FWUP_PROGRESS:
+            MEMCPY(&param->fwup_progress, argv, sizeof(struct tls_param_fwup_progress));
+			break;
+        case TLS_PARAM_ID_DHCPS_LEASE:
+            MEMCPY(&param->dhcps_lease, argv, sizeof(struct tls_param_dhcps_lease));
+			break;
 
 		default:
 			TLS_DBGPRT_WARNING("invalid parameter id - %d!\n", id);
@@ -1106,6 +1124,15 @@ int tls_param_get(int id, void *argv, bool from_flash)
         case TLS_PARAM_ID_TEM_OFFSET:
             MEMCPY(argv, &src->params_tem, sizeof(struct tls_param_tem_offset));
 			break;
+        case TLS_PARAM_ID_FAST_REJOIN:
+            MEMCPY(argv, &src->fast_rejoin, sizeof(struct tls_param_fast_rejoin));
+			break;
+        case TLS_PARAM_ID_FWUP_PROGRESS:
+            MEMCPY(argv, &src->fwup_progress, sizeof(struct tls_param_fwup_progress));
+			break;
+        case TLS_PARAM_ID_DHCPS_LEASE:
+            MEMCPY(argv, &src->dhcps_lease, sizeof(struct tls_param_dhcps_lease));
+			break;
 
 		default:
 			TLS_DBGPRT_WARNING("invalid parameter id - %d!\n", id);
@@ -2,6 +2,7 @@
 #include "wm_mem.h"
 #include "wm_wl_timers.h"
 #include "wm_wl_task.h"
+#include "wm_osal.h"
 
 struct tls_timeo {
   struct tls_timeo *next;
@@ -12,6 +13,8 @@ struct tls_timeo {
 
 /** The one and only timeout list */
 struct tls_timeo *next_timeout[TLS_TIMEO_ALL_COUONT];
+/* os tick when the owner task of each list last started waiting */
+static u32 timeo_wait_start[TLS_TIMEO_ALL_COUONT];
 
 /**
  * @brief          Wait (forever) for a message to arrive in an mbox.
@@ -39,6 +42,7 @@ void tls_timeouts_mbox_fetch_p(u8 timeo_assigned, tls_mbox_t mbox, void **msg)
     time_needed = tls_arch_mbox_fetch(mbox, msg, 0);
   } else {
     if ((*timeo)->time > 0) {
+      timeo_wait_start[timeo_assigned] = tls_os_get_time();
       time_needed = tls_arch_mbox_fetch(mbox, msg, (*timeo)->time);
     } else {
       time_needed = SYS_ARCH_TIMEOUT;
@@ -163,6 +167,41 @@ void tls_untimeout_p(u8 timeo_assigned, tls_timeout_handler handler, void *arg)
   return;
 }
 
+/**
+ * @brief          Get the time left before the nearest pending timeout of all
+ *                 the timer lists
+ *
+ * @param          None
+ *
+ * @return         milliseconds, 0xFFFFFFFF if no timeout is pending
+ *
+ * @note           The head of each list counts from the moment its owner
+ *                 task last started waiting. That time is taken off, rounded
+ *                 up to the next tick, so this is a lower bound and is safe
+ *                 to use as a sleep limit.
+ */
+u32 tls_timeouts_next_p(void)
+{
+	u8 i;
+	u32 now = tls_os_get_time();
+	u32 waited;
+	u32 left;
+	u32 next = 0xFFFFFFFF;
+
+	for (i = 0; i < TLS_TIMEO_ALL_COUONT; i++)
+	{
+		if (next_timeout[i] == NULL)
+			continue;
+
+		waited = (now - timeo_wait_start[i] + 1) * (1000 / HZ);
+		left = (next_timeout[i]->time > waited) ? (next_timeout[i]->time - waited) : 0;
+		if (left < next)
+			next = left;
+	}
+
+	return next;
+}
+
 /**
  * @brief          timer initialized
  *
@@ -274,6 +274,21 @@ void tls_pmu_timer1_stop(void)
 	tls_reg_write32(HR_PMU_TIMER1, val);
 }
 
+/**
+ * @brief          	This function is used to check whether pmu timer1 ran out
+ *
+ * @param		None
+ *
+ * @retval         	1    	its interrupt is pending, not yet served
+ * @retval         	0    	not run out
+ *
+ * @note           	None
+ */
+int tls_pmu_timer1_expired(void)
+{
+	return (tls_reg_read32(HR_PMU_INTERRUPT_SRC) & BIT(1)) ? 1 : 0;
+}
+
 
 
 /**
@@ -82,6 +82,38 @@ void tls_get_rtc(struct tm *tblock)
 	tblock->tm_sec  =  ctrl1 & 0x0000003f;
 }
 
+/**
+ * @brief          This function is used to set pmu rtc time in seconds
+ *
+ * @param[in]      t    seconds since 1970, as taken by localtime()
+ *
+ * @return         None
+ *
+ * @note           None
+ */
+void tls_rtc_set_time(time_t t)
+{
+	tls_set_rtc(localtime(&t));
+}
+
+/**
+ * @brief          This function is used to get pmu rtc time in seconds
+ *
+ * @param          None
+ *
+ * @return         seconds since 1970, as returned by mktime()
+ *
+ * @note           None
+ */
+time_t tls_rtc_get_time(void)
+{
+	struct tm tblock;
+
+	memset(&tblock, 0, sizeof(tblock));
+	tls_get_rtc(&tblock);
+	return mktime(&tblock);
+}
+
 void PMU_RTC_IRQHandler(void)
 {
     if (tls_reg_read32(HR_PMU_INTERRUPT_SRC) & BIT(5)) /* rtc interrupt */
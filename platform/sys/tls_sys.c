@@ -43,10 +43,78 @@ struct tls_sys_msg
 {
     u32 msg;
     void *data;
+    u32 time;   /* tick count when posted */
 };
 #define SYS_TASK_STK_SIZE          256
 
-static tls_os_queue_t *msg_queue;
+/*
+ * Messages are dispatched from priority lanes, the highest non-empty lane
+ * first and FIFO inside a lane. Link state changes must stay ordered with
+ * respect to each other so they share the high lane.
+ */
+#define SYS_MSG_LANE_HIGH          0    /* link state, dhcp/netif setup */
+#define SYS_MSG_LANE_NORMAL        1    /* auto reconnect */
+#define SYS_MSG_LANE_LOW           2    /* rmms and anything else */
+#define SYS_MSG_LANE_NUM           3
+
+#define SYS_MSG_HIGH_SIZE          10
+#define SYS_MSG_NORMAL_SIZE        4
+#define SYS_MSG_LOW_SIZE           6
+
+/* messages without data that can be merged with an identical pending one */
+#define SYS_MSG_COALESCE_MASK      ((1 << SYS_MSG_NET_DOWN) | \
+                                    (1 << SYS_MSG_CONNECT_FAILED) | \
+                                    (1 << SYS_MSG_AUTO_MODE_RUN) | \
+                                    (1 << SYS_MSG_NET2_DOWN))
+
+struct sys_msg_lane
+{
+    struct tls_sys_msg *ring;
+    u8 size;
+    u8 head;
+    u8 count;
+    u8 peak;
+};
+
+static struct tls_sys_msg msg_high_storage[SYS_MSG_HIGH_SIZE];
+static struct tls_sys_msg msg_normal_storage[SYS_MSG_NORMAL_SIZE];
+static struct tls_sys_msg msg_low_storage[SYS_MSG_LOW_SIZE];
+
+static struct sys_msg_lane msg_lanes[SYS_MSG_LANE_NUM] = {
+    {msg_high_storage,   SYS_MSG_HIGH_SIZE,   0, 0, 0},
+    {msg_normal_storage, SYS_MSG_NORMAL_SIZE, 0, 0, 0},
+    {msg_low_storage,    SYS_MSG_LOW_SIZE,    0, 0, 0},
+};
+
+/* wakes the sys task, it drains all lanes on every wake-up */
+static tls_os_sem_t *msg_sem;
+static tls_os_sem_static_t msg_sem_cb;
+
+static struct tls_sys_msg_stat msg_stats[SYS_MSG_TYPE_MAX];
+
+#if TLS_CONFIG_FAST_REJOIN
+#define SYS_REJOIN_IDLE            0
+#define SYS_REJOIN_FAST            1    /* directed connect to the cached bss */
+#define SYS_REJOIN_SCAN            2    /* connect after a full scan */
+
+struct sys_rejoin
+{
+    u8 state;
+    u8 lease_reused;
+    u8 ssid_len;
+    u8 pwd_len;
+    u8 ssid[32];
+    u8 pwd[64];
+    u8 quick_set;   /* quick connect holds the cached channel */
+    struct tls_param_quick_connect quick_user;
+    u32 start;      /* ticks of the connect request */
+    u32 assoc;
+    u32 ip;
+};
+
+static struct sys_rejoin rejoin;
+static struct tls_sys_rejoin_stat rejoin_stat;
+#endif
 
 #if TLS_DBG_LEVEL_DUMP
 void TLS_DBGPRT_DUMP(char *p, u32 len)
@@ -80,6 +148,216 @@ void TLS_DBGPRT_DUMP(char *p, u32 len)
 
 #endif
 
+#if TLS_CONFIG_FAST_REJOIN
+/* point quick connect at the cached channel, the user setting is kept */
+static void sys_rejoin_quick_connect(u8 channel)
+{
+    struct tls_param_quick_connect quick_connect;
+
+    if (!rejoin.quick_set)
+    {
+        tls_param_get(TLS_PARAM_ID_QUICK_CONNECT, &rejoin.quick_user, FALSE);
+        rejoin.quick_set = 1;
+    }
+    quick_connect.quick_connect_en = TRUE;
+    quick_connect.chanId = channel;
+    tls_param_set(TLS_PARAM_ID_QUICK_CONNECT, &quick_connect, FALSE);
+}
+
+//-------------------------------------------------------------------------
+
+static void sys_rejoin_quick_restore(void)
+{
+    if (!rejoin.quick_set)
+        return ;
+
+    tls_param_set(TLS_PARAM_ID_QUICK_CONNECT, &rejoin.quick_user, FALSE);
+    rejoin.quick_set = 0;
+}
+
+//-------------------------------------------------------------------------
+
+static u32 sys_rejoin_ms(u32 from, u32 to)
+{
+    return (to - from) * 1000 / HZ;
+}
+
+//-------------------------------------------------------------------------
+
+int tls_sys_rejoin(u8 *ssid, u8 ssid_len, u8 *pwd, u8 pwd_len)
+{
+    struct tls_param_fast_rejoin cache;
+    int ret;
+
+    if ((ssid_len > sizeof(rejoin.ssid)) || (pwd_len > sizeof(rejoin.pwd)))
+        return tls_wifi_connect(ssid, ssid_len, pwd, pwd_len);
+
+    /* kept for the scan fallback */
+    MEMCPY(rejoin.ssid, ssid, ssid_len);
+    rejoin.ssid_len = ssid_len;
+    MEMCPY(rejoin.pwd, pwd, pwd_len);
+    rejoin.pwd_len = pwd_len;
+    rejoin.start = tls_os_get_time();
+    rejoin.assoc = 0;
+    rejoin.ip = 0;
+    rejoin.lease_reused = 0;
+
+    tls_param_get(TLS_PARAM_ID_FAST_REJOIN, &cache, FALSE);
+    if (cache.valid && (cache.ssid_len == ssid_len) &&
+        (0 == memcmp(cache.ssid, ssid, ssid_len)))
+    {
+        rejoin.state = SYS_REJOIN_FAST;
+        sys_rejoin_quick_connect(cache.channel);
+        ret = tls_wifi_connect_by_ssid_bssid(ssid, ssid_len, cache.bssid,
+                                             pwd, pwd_len);
+        if (WM_SUCCESS == ret)
+            return ret;
+        sys_rejoin_quick_restore();
+    }
+
+    rejoin.state = SYS_REJOIN_SCAN;
+    return tls_wifi_connect(ssid, ssid_len, pwd, pwd_len);
+}
+
+//-------------------------------------------------------------------------
+
+/* a directed connect failed: forget the cached bss and scan once */
+static int sys_rejoin_fallback(void)
+{
+    struct tls_param_fast_rejoin cache;
+
+    if (SYS_REJOIN_FAST != rejoin.state)
+        return 0;
+
+    rejoin_stat.fallbacks++;
+    sys_rejoin_quick_restore();
+
+    /* sram only, flash is rewritten after the next successful join */
+    tls_param_get(TLS_PARAM_ID_FAST_REJOIN, &cache, FALSE);
+    cache.valid = 0;
+    tls_param_set(TLS_PARAM_ID_FAST_REJOIN, &cache, FALSE);
+
+    TLS_DBGPRT_INFO("fast rejoin failed, scanning\n");
+    rejoin.state = SYS_REJOIN_SCAN;
+    tls_wifi_connect(rejoin.ssid, rejoin.ssid_len, rejoin.pwd, rejoin.pwd_len);
+
+    return 1;
+}
+
+//-------------------------------------------------------------------------
+
+#if TLS_CONFIG_LWIP_VER2_0_3
+/* request the cached lease again if we are back on the same network */
+static int sys_rejoin_dhcp_start(void)
+{
+    struct tls_param_fast_rejoin cache;
+    struct tls_curr_bss_t bss;
+    u32 lease;
+
+    tls_param_get(TLS_PARAM_ID_FAST_REJOIN, &cache, FALSE);
+    MEMCPY(&lease, cache.ip, 4);
+    if (!cache.valid || (0 == lease))
+        return 0;
+
+    tls_wifi_get_current_bss(&bss);
+    if ((bss.ssid_len != cache.ssid_len) ||
+        (0 != memcmp(bss.ssid, cache.ssid, cache.ssid_len)))
+        return 0;
+
+    if (tls_dhcp_start_reboot(lease))
+        return 0;
+
+    rejoin.lease_reused = 1;
+    return 1;
+}
+
+//-------------------------------------------------------------------------
+
+#endif
+
+/* on ip: publish the timing and cache bss and lease for the next join */
+static void sys_rejoin_save(void)
+{
+    struct tls_param_fast_rejoin cache;
+    struct tls_param_fast_rejoin saved;
+    struct tls_param_ip ip_param;
+    struct tls_curr_bss_t bss;
+    struct tls_ethif *ethif;
+
+    if (rejoin.start && rejoin.ip)
+    {
+        rejoin_stat.fast = (SYS_REJOIN_FAST == rejoin.state);
+        if (rejoin_stat.fast)
+            rejoin_stat.fast_ok++;
+        rejoin_stat.lease_reused = rejoin.lease_reused;
+        rejoin_stat.assoc_ms = rejoin.assoc ?
+                               sys_rejoin_ms(rejoin.start, rejoin.assoc) : 0;
+        rejoin_stat.dhcp_ms = rejoin.assoc ?
+                              sys_rejoin_ms(rejoin.assoc, rejoin.ip) : 0;
+        rejoin_stat.total_ms = sys_rejoin_ms(rejoin.start, rejoin.ip);
+        TLS_DBGPRT_INFO("join %s: assoc %d ms, ip %d ms, total %d ms\n",
+                        rejoin_stat.fast ? "fast" : "scan",
+                        rejoin_stat.assoc_ms, rejoin_stat.dhcp_ms,
+                        rejoin_stat.total_ms);
+    }
+    sys_rejoin_quick_restore();
+    rejoin.state = SYS_REJOIN_IDLE;
+    rejoin.start = 0;
+
+    tls_wifi_get_current_bss(&bss);
+    if ((0 == bss.ssid_len) || (bss.ssid_len > sizeof(cache.ssid)))
+        return ;
+
+    memset(&cache, 0, sizeof(cache));
+    cache.valid = 1;
+    cache.channel = bss.channel;
+    MEMCPY(cache.bssid, bss.bssid, sizeof(cache.bssid));
+    cache.ssid_len = bss.ssid_len;
+    MEMCPY(cache.ssid, bss.ssid, bss.ssid_len);
+    tls_param_get(TLS_PARAM_ID_IP, &ip_param, FALSE);
+    if (ip_param.dhcp_enable)
+    {
+        ethif = tls_netif_get_ethif();
+        MEMCPY(cache.ip, &ethif->ip_addr.addr, 4);
+    }
+
+    /* only touch the flash when something changed */
+    tls_param_get(TLS_PARAM_ID_FAST_REJOIN, &saved, TRUE);
+    if (memcmp(&saved, &cache, sizeof(cache)))
+        tls_param_set(TLS_PARAM_ID_FAST_REJOIN, &cache, TRUE);
+    else
+        tls_param_set(TLS_PARAM_ID_FAST_REJOIN, &cache, FALSE);
+}
+
+//-------------------------------------------------------------------------
+
+int tls_sys_rejoin_stat_get(struct tls_sys_rejoin_stat *stat)
+{
+    if (NULL == stat)
+        return -1;
+
+    *stat = rejoin_stat;
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+#else
+int tls_sys_rejoin(u8 *ssid, u8 ssid_len, u8 *pwd, u8 pwd_len)
+{
+    return tls_wifi_connect(ssid, ssid_len, pwd, pwd_len);
+}
+
+//-------------------------------------------------------------------------
+
+int tls_sys_rejoin_stat_get(struct tls_sys_rejoin_stat *stat)
+{
+    return -1;
+}
+
+//-------------------------------------------------------------------------
+
+#endif
 #if TLS_CONFIG_LWIP_VER2_0_3
 static void sys_net_up()
 {
@@ -94,6 +372,10 @@ static void sys_net_up()
         ip4_addr_set_zero(&gateway);
         tls_netif_set_addr(&ip_addr, &net_mask, &gateway);
         tls_netif_set_up();
+#if TLS_CONFIG_FAST_REJOIN
+        if (sys_rejoin_dhcp_start())
+            return ;
+#endif
         tls_dhcp_start();
     } else {
         tls_dhcp_stop();
@@ -355,7 +637,7 @@ void tls_auto_reconnect(void)
                 }
                 else if(ssid.ssid_len)
                 {
-                    tls_wifi_connect(ssid.ssid, ssid.ssid_len, origin_key.psk, origin_key.key_length);
+                    tls_sys_rejoin(ssid.ssid, ssid.ssid_len, origin_key.psk, origin_key.key_length);
                 }
 
             }
@@ -448,73 +730,151 @@ static void tls_proc_rmms(struct rmms_msg *msg)
 
 #endif
 
+static u8 sys_msg_lane_of(u32 msg)
+{
+    switch (msg)
+    {
+        case SYS_MSG_NET_UP:
+        case SYS_MSG_NET_DOWN:
+        case SYS_MSG_CONNECT_FAILED:
+        case SYS_MSG_NET2_UP:
+        case SYS_MSG_NET2_DOWN:
+        case SYS_MSG_NET2_FAIL:
+            return SYS_MSG_LANE_HIGH;
+        case SYS_MSG_AUTO_MODE_RUN:
+        case SYS_MSG_IP_UP:
+            return SYS_MSG_LANE_NORMAL;
+        default:
+            return SYS_MSG_LANE_LOW;
+    }
+}
+
+//-------------------------------------------------------------------------
+
+static struct tls_sys_msg_stat *sys_msg_stat_of(u32 msg)
+{
+    return (msg < SYS_MSG_TYPE_MAX) ? &msg_stats[msg] : &msg_stats[0];
+}
+
+//-------------------------------------------------------------------------
+
+/* take the oldest message of the highest priority non-empty lane */
+static int sys_msg_fetch(struct tls_sys_msg *msg)
+{
+    struct sys_msg_lane *lane;
+    u32 cpu_sr;
+    int i;
+
+    cpu_sr = tls_os_set_critical();
+    for (i = 0; i < SYS_MSG_LANE_NUM; i++)
+    {
+        lane = &msg_lanes[i];
+        if (lane->count)
+        {
+            *msg = lane->ring[lane->head];
+            lane->head = (lane->head + 1) % lane->size;
+            lane->count--;
+            tls_os_release_critical(cpu_sr);
+            return 1;
+        }
+    }
+    tls_os_release_critical(cpu_sr);
+
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+static void sys_msg_dispatch(struct tls_sys_msg *msg)
+{
+    u8 auto_reconnect = WIFI_AUTO_CNT_OFF;
+
+    switch (msg->msg)
+    {
+        case SYS_MSG_NET_UP:
+            sys_net_up();
+            break;
+#if TLS_CONFIG_AP
+        case SYS_MSG_NET2_UP:
+            sys_net2_up();
+            break;
+        case SYS_MSG_NET2_DOWN:
+            sys_net2_down();
+            break;
+        case SYS_MSG_NET2_FAIL:
+            sys_net2_down();
+            tls_auto_reconnect();
+            break;
+#endif
+        case SYS_MSG_NET_DOWN:
+            sys_net_down();
+            break;
+        case SYS_MSG_CONNECT_FAILED:
+#if TLS_CONFIG_FAST_REJOIN
+            if (sys_rejoin_fallback())
+                break;
+#endif
+            sys_net_down();
+            break;
+#if TLS_CONFIG_FAST_REJOIN
+        case SYS_MSG_IP_UP:
+            sys_rejoin_save();
+            break;
+#endif
+        case SYS_MSG_AUTO_MODE_RUN:
+            /*restore WiFi auto reconnect Tmp OFF*/
+            tls_wifi_auto_connect_flag(WIFI_AUTO_CNT_FLAG_GET,
+                &auto_reconnect);
+            if (auto_reconnect == WIFI_AUTO_CNT_TMP_OFF)
+            {
+                auto_reconnect = WIFI_AUTO_CNT_ON;
+                tls_wifi_auto_connect_flag(WIFI_AUTO_CNT_FLAG_SET,
+                    &auto_reconnect);
+            }
+
+            tls_auto_reconnect();
+            break;
+#if TLS_CONFIG_RMMS
+        case SYS_MSG_RMMS:
+            tls_proc_rmms(msg->data);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+//-------------------------------------------------------------------------
+
 /*
  * sys task stack
  */
 static u32 sys_task_stk[SYS_TASK_STK_SIZE];
+static tls_os_task_static_t sys_task_tcb;
 
 void tls_sys_task(void *data)
 {
-    u8 err;
-    struct tls_sys_msg *msg;
-    u8 auto_reconnect = WIFI_AUTO_CNT_OFF;
+    struct tls_sys_msg sys_msg;
+    struct tls_sys_msg *msg = &sys_msg;
+    struct tls_sys_msg_stat *stat;
+    u32 latency;
 
-    //u8 oneshotflag = 0;
-    //u8 auto_mode = 0;
     for (;;)
     {
-        err = tls_os_queue_receive(msg_queue, (void **) &msg, 0, 0);
-        if (!err)
-        {
-            switch (msg->msg)
-            {
-                case SYS_MSG_NET_UP:
-                    sys_net_up();
-                    break;
-#if TLS_CONFIG_AP
-                case SYS_MSG_NET2_UP:
-                    sys_net2_up();
-                    break;
-                case SYS_MSG_NET2_DOWN:
-                    sys_net2_down();
-                    break;
-                case SYS_MSG_NET2_FAIL:
-                    sys_net2_down();
-                    tls_auto_reconnect();
-                    break;
-#endif
-                case SYS_MSG_NET_DOWN:
-                    sys_net_down();
-                    break;
-                case SYS_MSG_CONNECT_FAILED:
-					sys_net_down();
-                    break;
-                case SYS_MSG_AUTO_MODE_RUN:
-                    /*restore WiFi auto reconnect Tmp OFF*/
-                    tls_wifi_auto_connect_flag(WIFI_AUTO_CNT_FLAG_GET,
-                        &auto_reconnect);
-                    if (auto_reconnect == WIFI_AUTO_CNT_TMP_OFF)
-                    {
-                        auto_reconnect = WIFI_AUTO_CNT_ON;
-                        tls_wifi_auto_connect_flag(WIFI_AUTO_CNT_FLAG_SET,
-                            &auto_reconnect);
-                    }
+        tls_os_sem_acquire(msg_sem, 0);
 
-                    tls_auto_reconnect();
-                    break;
-#if TLS_CONFIG_RMMS
-                case SYS_MSG_RMMS:
-                    tls_proc_rmms(msg->data);
-                    break;
-#endif
-                default:
-                    break;
-            }
-            tls_mem_free(msg);
-        }
-        else
+        /* refetch after every message so that a link state change posted
+           meanwhile overtakes the rest of a lower lane */
+        while (sys_msg_fetch(msg))
         {
-
+            latency = tls_os_get_time() - msg->time;
+            stat = sys_msg_stat_of(msg->msg);
+            stat->handled++;
+            stat->latency_total += latency;
+            if (latency > stat->latency_max)
+                stat->latency_max = latency;
+
+            sys_msg_dispatch(msg);
         }
     }
 }
@@ -523,22 +883,96 @@ void tls_sys_task(void *data)
 
 void tls_sys_send_msg(u32 msg, void *data)
 {
-    struct tls_sys_msg *pmsg;
+    struct sys_msg_lane *lane;
+    struct tls_sys_msg *sys_msg;
+    struct tls_sys_msg_stat *stat;
+    u32 cpu_sr;
+
+    lane = &msg_lanes[sys_msg_lane_of(msg)];
+    stat = sys_msg_stat_of(msg);
 
-    pmsg = tls_mem_alloc(sizeof(struct tls_sys_msg));
-    if (NULL != pmsg)
+    cpu_sr = tls_os_set_critical();
+    stat->posted++;
+
+    /* only merge with the newest pending message of the lane, merging
+       across a different message would reorder state changes */
+    if (lane->count && (NULL == data) && (msg < 32) &&
+        (SYS_MSG_COALESCE_MASK & (1 << msg)))
     {
-        memset(pmsg, 0, sizeof(struct tls_sys_msg));
-        pmsg->msg = msg;
-        pmsg->data = data;
-        tls_os_queue_send(msg_queue, pmsg, 0);
+        sys_msg = &lane->ring[(lane->head + lane->count - 1) % lane->size];
+        if ((sys_msg->msg == msg) && (NULL == sys_msg->data))
+        {
+            stat->coalesced++;
+            tls_os_release_critical(cpu_sr);
+            return ;
+        }
+    }
+
+    /* may run in an interrupt, the counter is the only report */
+    if (lane->count >= lane->size)
+    {
+        stat->dropped++;
+        tls_os_release_critical(cpu_sr);
+        return ;
     }
 
+    sys_msg = &lane->ring[(lane->head + lane->count) % lane->size];
+    sys_msg->msg = msg;
+    sys_msg->data = data;
+    sys_msg->time = tls_os_get_time();
+    lane->count++;
+    if (lane->count > lane->peak)
+        lane->peak = lane->count;
+    tls_os_release_critical(cpu_sr);
+
+    /* the task drains every lane per wake-up, a saturated count is fine */
+    tls_os_sem_release(msg_sem);
+
     return ;
 }
 
 //-------------------------------------------------------------------------
 
+int tls_sys_msg_stat_get(u32 msg, struct tls_sys_msg_stat *stat)
+{
+    u32 cpu_sr;
+
+    if ((msg >= SYS_MSG_TYPE_MAX) || (NULL == stat))
+        return -1;
+
+    cpu_sr = tls_os_set_critical();
+    *stat = msg_stats[msg];
+    tls_os_release_critical(cpu_sr);
+
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+
+u8 tls_sys_msg_lane_peak(u8 lane)
+{
+    if (lane >= SYS_MSG_LANE_NUM)
+        return 0;
+
+    return msg_lanes[lane].peak;
+}
+
+//-------------------------------------------------------------------------
+
+void tls_sys_msg_stat_reset(void)
+{
+    u32 cpu_sr;
+    int i;
+
+    cpu_sr = tls_os_set_critical();
+    memset(msg_stats, 0, sizeof(msg_stats));
+    for (i = 0; i < SYS_MSG_LANE_NUM; i++)
+        msg_lanes[i].peak = msg_lanes[i].count;
+    tls_os_release_critical(cpu_sr);
+}
+
+//-------------------------------------------------------------------------
+
 void tls_sys_auto_mode_run(void)
 {
     tls_sys_send_msg(SYS_MSG_AUTO_MODE_RUN, NULL);
@@ -599,6 +1033,9 @@ static void sys_net_status_changed(u8 status)
     {
         case NETIF_WIFI_JOIN_SUCCESS:
             TLS_DBGPRT_INFO("join net success\n");
+#if TLS_CONFIG_FAST_REJOIN
+            rejoin.assoc = tls_os_get_time();
+#endif
             tls_sys_net_up();
             break;
         case NETIF_WIFI_JOIN_FAILED:
@@ -644,6 +1081,11 @@ static void sys_net_status_changed(u8 status)
 //#if TLS_CONFIG_RMMS
 //            tls_rmms_start();
 //#endif
+#if TLS_CONFIG_FAST_REJOIN
+            rejoin.ip = tls_os_get_time();
+            /* flash access is left to the sys task */
+            tls_sys_send_msg(SYS_MSG_IP_UP, NULL);
+#endif
             break;
 #if TLS_CONFIG_AP
         case NETIF_WIFI_SOFTAP_SUCCESS:
@@ -679,17 +1121,15 @@ int tls_sys_init()
 {
     int err;
 
-    /* create messge queue */
-#define SYS_MSG_SIZE     20
-
-    err = tls_os_queue_create(&msg_queue, SYS_MSG_SIZE);
+    /* create message doorbell, the lanes are static rings */
+    err = tls_os_sem_create_static(&msg_sem, &msg_sem_cb, 0);
     if (err)
     {
         return  - 1;
     }
 
     /* create task */
-    tls_os_task_create(NULL, "Sys Task", tls_sys_task, (void*)0, (void*)
+    tls_os_task_create_static(NULL, &sys_task_tcb, "Sys Task", tls_sys_task, (void*)0, (void*)
         &sys_task_stk,  /* 任务栈的起始地址 */
     SYS_TASK_STK_SIZE *sizeof(u32),  /* 任务栈的大小     */
     TLS_SYS_TASK_PRIO, 0);
@@ -14,9 +14,113 @@
 #define SYS_MSG_NET2_FAIL         7
 
 #define SYS_MSG_RMMS		   8
+#define SYS_MSG_IP_UP             9
+
+#define SYS_MSG_TYPE_MAX          10
+
+/* dispatch statistics of one message type, latencies in os ticks */
+struct tls_sys_msg_stat
+{
+    u32 posted;
+    u32 handled;
+    u32 coalesced;      /* merged into an identical pending message */
+    u32 dropped;        /* lane was full */
+    u32 latency_max;
+    u32 latency_total;  /* divide by handled for the average */
+};
 
 int tls_sys_init(void);
 void tls_auto_reconnect(void);
 
+/**
+ * @brief          post a message to the sys task
+ *
+ * @param[in]      msg     SYS_MSG_xxx
+ * @param[in]      data    message argument, messages carrying data are
+ *                         never coalesced
+ *
+ * @return         None
+ *
+ * @note           link state messages are handled before reconnect
+ *                 requests, which go before everything else
+ */
+void tls_sys_send_msg(u32 msg, void *data);
+
+/**
+ * @brief          get the dispatch statistics of one message type
+ *
+ * @param[in]      msg     SYS_MSG_xxx, 0 collects unknown types
+ * @param[out]     stat    statistics
+ *
+ * @retval         0       success
+ * @retval         -1      invalid message type
+ *
+ * @note           None
+ */
+int tls_sys_msg_stat_get(u32 msg, struct tls_sys_msg_stat *stat);
+
+/**
+ * @brief          get the highest number of messages pending in a lane
+ *
+ * @param[in]      lane    0 high, 1 normal, 2 low
+ *
+ * @return         peak depth since start or last reset
+ *
+ * @note           None
+ */
+u8 tls_sys_msg_lane_peak(u8 lane);
+
+/**
+ * @brief          clear the dispatch statistics
+ *
+ * @param          None
+ *
+ * @return         None
+ *
+ * @note           None
+ */
+void tls_sys_msg_stat_reset(void);
+
+/* timing of the last join, from the connect request to the ip address */
+struct tls_sys_rejoin_stat
+{
+    u8  fast;           /* joined the cached bss without scanning */
+    u8  lease_reused;   /* dhcp started from INIT-REBOOT */
+    u32 fast_ok;
+    u32 fallbacks;      /* directed connects that fell back to a scan */
+    u32 assoc_ms;       /* connect request to association */
+    u32 dhcp_ms;        /* association to ip address */
+    u32 total_ms;
+};
+
+/**
+ * @brief          connect to an infrastructure network, directly to the
+ *                 last joined bss and channel when they are cached for
+ *                 this ssid, with a full scan otherwise
+ *
+ * @param[in]      ssid       ssid
+ * @param[in]      ssid_len   ssid length
+ * @param[in]      pwd        password
+ * @param[in]      pwd_len    password length
+ *
+ * @retval         WM_SUCCESS    connect started
+ * @retval         other         see tls_wifi_connect
+ *
+ * @note           a failed directed connect is retried once with a scan
+ */
+int tls_sys_rejoin(u8 *ssid, u8 ssid_len, u8 *pwd, u8 pwd_len);
+
+/**
+ * @brief          get the timing of the last join
+ *
+ * @param[out]     stat    join statistics
+ *
+ * @retval         0       success
+ * @retval         -1      fast rejoin is not enabled
+ *
+ * @note           None
+ */
+int tls_sys_rejoin_stat_get(struct tls_sys_rejoin_stat *stat);
+
 
 #endif /* end of TLS_SYS_H */
@@ -115,6 +115,11 @@ extern void tls_fls_layout_init(void);
 
 void task_start (void *data);
 
+#if TLS_CONFIG_TICKLESS_IDLE
+extern void tls_tickless_init(u32 cpu_hz);
+extern int tls_tickless_idle_sleep(void);
+#endif
+
 void tls_os_timer_init(void)
 {
 	tls_sys_clk sysclk;
@@ -122,6 +127,10 @@ void tls_os_timer_init(void)
 	tls_sys_clk_get(&sysclk);
 	SysTick_Config(sysclk.cpuclk*UNIT_MHZ/HZ);
 	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
+
+#if TLS_CONFIG_TICKLESS_IDLE
+	tls_tickless_init(sysclk.cpuclk * UNIT_MHZ);
+#endif
 }
 /****************/
 /* main program */
@@ -129,6 +138,11 @@ void tls_os_timer_init(void)
 
 void vApplicationIdleHook( void )
 {
+#if TLS_CONFIG_TICKLESS_IDLE
+	if (tls_tickless_idle_sleep())
+		return;
+#endif
+
     /* clear watch dog interrupt */
     tls_watchdog_clr();
 
@@ -0,0 +1,328 @@
+/*****************************************************************************
+*
+* File Name : wm_tickless.c
+*
+* Description: tickless idle, stops the periodic os tick while the scheduler
+*              has nothing to run
+*
+* Copyright (c) 2014 Winner Micro Electronic Design Co., Ltd.
+* All rights reserved.
+*
+*****************************************************************************/
+#include "wm_config.h"
+
+#if TLS_CONFIG_TICKLESS_IDLE
+#include "wm_type_def.h"
+#include "wm_osal.h"
+#include "wm_watchdog.h"
+#include "wm_wl_timers.h"
+#include "wm_pmu.h"
+#include "wm_rtc.h"
+#include "misc.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* not worth stopping the tick for shorter idle periods */
+#define TICKLESS_IDLE_MIN_TICKS     2
+/* pmu timer1 counts ms in 16 bits */
+#define TICKLESS_PMU_MAX_MS         65535
+/* systick as stopwatch, one lap */
+#define TICKLESS_LAP                (SysTick_LOAD_RELOAD_Msk + 1)
+
+static u32 tickless_cpu_hz = 0;
+static u32 tickless_cycles_per_tick = 0;
+static u32 tickless_max_idle_ticks = 0;
+static u32 tickless_max_long_ticks = 0;
+
+/**
+ * @brief          set up tickless idle for the current cpu clock
+ *
+ * @param[in]      cpu_hz    cpu clock in Hz, systick runs from it
+ *
+ * @return         None
+ *
+ * @note           called whenever the systick period is configured
+ */
+void tls_tickless_init(u32 cpu_hz)
+{
+	struct tm tblock;
+
+	tickless_cpu_hz = cpu_hz;
+	tickless_cycles_per_tick = cpu_hz / HZ;
+	/* up to a systick period systick wakes the cpu, beyond pmu timer1 */
+	tickless_max_idle_ticks = SysTick_LOAD_RELOAD_Msk / tickless_cycles_per_tick;
+	tickless_max_long_ticks = TICKLESS_PMU_MAX_MS / (1000 / HZ);
+
+	/* no callback, the interrupt only has to end the wfi */
+	tls_pmu_timer1_isr_register(NULL, NULL);
+
+	/* the rtc bounds early wake-ups, start it if it was never set */
+	tls_get_rtc(&tblock);
+	if (0 == tblock.tm_mday)
+	{
+		tblock.tm_mday = 1;
+		tls_set_rtc(&tblock);
+	}
+}
+
+/*
+ * systick counts LOAD down to 0 and reloads, so a period is LOAD + 1
+ * cycles. The current tick has val cycles left when the sleep starts,
+ * val is not 0 as no tick is pending.
+ */
+static u32 tickless_sleep_reload(u32 val, u32 expected)
+{
+	return val + tickless_cycles_per_tick * (expected - 1) - 1;
+}
+
+/*
+ * Ticks completed while asleep, not counting the tick interrupt left
+ * pending when the long period ran out, and the LOAD that ends the tick
+ * the sleep ended in on the next tick boundary.
+ */
+static u32 tickless_wake(u32 reload, u32 val, int counted, u32 expected, u32 *load)
+{
+	u32 elapsed;
+	u32 complete;
+
+	if (counted)
+	{
+		/* cycles since the long period ran out and reloaded */
+		elapsed = reload - val + 1;
+		if (elapsed < tickless_cycles_per_tick)
+			*load = tickless_cycles_per_tick - elapsed - 1;
+		else
+			*load = tickless_cycles_per_tick - 1;
+		return expected - 1;
+	}
+
+	/* woken early by another interrupt, count from the last tick boundary */
+	elapsed = expected * tickless_cycles_per_tick - val;
+	complete = elapsed / tickless_cycles_per_tick;
+	*load = (complete + 1) * tickless_cycles_per_tick - elapsed - 1;
+	return complete;
+}
+
+/* seconds since the start of the month, enough to time one sleep */
+static u32 tickless_rtc_secs(void)
+{
+	struct tm tblock;
+
+	tls_get_rtc(&tblock);
+	return ((tblock.tm_mday * 24 + tblock.tm_hour) * 60 + tblock.tm_min) * 60 + tblock.tm_sec;
+}
+
+/*
+ * Cycles a long sleep took. systick ran one lap after the other from VAL 0
+ * with its interrupt off, the lap count is lost once it wrapped: pmu timer1
+ * running out tells it to within half a lap, else the rtc seconds give the
+ * smallest count the sleep can have taken.
+ */
+static u64 tickless_long_elapsed(u32 val, int wrapped, int timer_out,
+                                 u64 timer_cycles, u32 rtc_secs)
+{
+	u64 phase = (TICKLESS_LAP - val) % TICKLESS_LAP;
+	u64 low = TICKLESS_LAP;
+	u64 laps;
+
+	if (!wrapped)
+		return phase;
+
+	if (timer_out)
+	{
+		laps = (timer_cycles + TICKLESS_LAP / 2 - phase) / TICKLESS_LAP;
+		return phase + (laps ? laps : 1) * TICKLESS_LAP;
+	}
+
+	/* rtc_secs second boundaries passed, so more than rtc_secs - 1 s; not
+	   beyond the timer, the rtc may have gone round the month */
+	if ((rtc_secs > 1) && ((u64)(rtc_secs - 1) * tickless_cpu_hz > low) &&
+	    ((u64)(rtc_secs - 1) * tickless_cpu_hz < timer_cycles))
+		low = (u64)(rtc_secs - 1) * tickless_cpu_hz;
+	laps = (low - phase + TICKLESS_LAP - 1) / TICKLESS_LAP;
+	return phase + laps * TICKLESS_LAP;
+}
+
+/*
+ * Ticks completed in a long sleep of cycles, which started with left cycles
+ * of the current tick to go, and the LOAD that ends the tick it ended in.
+ */
+static u32 tickless_long_wake(u32 left, u64 cycles, u32 *load)
+{
+	u64 elapsed = cycles + tickless_cycles_per_tick - left;
+	u32 complete = (u32)(elapsed / tickless_cycles_per_tick);
+
+	*load = (u32)((u64)(complete + 1) * tickless_cycles_per_tick - elapsed - 1);
+	return complete;
+}
+
+/*
+ * Sleeps longer than a systick period: pmu timer1 wakes the cpu, systick
+ * runs on without its interrupt as stopwatch.
+ */
+static void tickless_long_sleep(u32 left, u32 expected)
+{
+	u64 deadline = left + (u64)tickless_cycles_per_tick * (expected - 1);
+	u32 cycles_per_ms = tickless_cpu_hz / 1000;
+	u32 msec = (u32)(deadline / cycles_per_ms);
+	u32 rtc_start;
+	u32 ctrl;
+	u32 val;
+	int timer_out;
+	u32 load;
+	u32 complete;
+
+	rtc_start = tickless_rtc_secs();
+	SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+	SysTick->VAL = 0;
+	SysTick->CTRL = (SysTick->CTRL & ~SysTick_CTRL_TICKINT_Msk) | SysTick_CTRL_ENABLE_Msk;
+	tls_pmu_timer1_start((u16)msec);
+
+	tls_watchdog_clr();
+
+#if !defined(__CC_ARM)
+	__asm volatile ("dsb");
+	__asm volatile ("wfi");
+	__asm volatile ("isb");
+#else
+	__DSB();
+	__WFI();
+	__ISB();
+#endif
+
+	ctrl = SysTick->CTRL;
+	SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+	val = SysTick->VAL;
+	/* its interrupt, if pending, is served once enabled */
+	timer_out = tls_pmu_timer1_expired();
+	tls_pmu_timer1_stop();
+
+	complete = tickless_long_wake(left,
+	                              tickless_long_elapsed(val, (ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0,
+	                                                    timer_out, (u64)msec * cycles_per_ms,
+	                                                    tickless_rtc_secs() - rtc_start),
+	                              &load);
+
+	SysTick->LOAD = load;
+	SysTick->VAL = 0;
+	SysTick->CTRL = ctrl | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = tickless_cycles_per_tick - 1;
+
+	vTaskStepTick(complete);
+}
+
+/**
+ * @brief          stop the periodic tick while the scheduler has nothing
+ *                 to run until the next delayed task or wl timer expires
+ *
+ * @param          None
+ *
+ * @retval         1    the cpu slept tickless
+ * @retval         0    idle period too short, nothing done
+ *
+ * @note           Up to a systick period systick keeps counting with a
+ *                 single long period, wakes the cpu when it runs out and
+ *                 serves as stopwatch when another interrupt comes first.
+ *                 Longer sleeps, up to 65 s, are woken by pmu timer1. The
+ *                 tick count is exact unless another interrupt ends such a
+ *                 sleep after its first systick period, then it may fall
+ *                 behind by up to 2 s, as bounded by the rtc. systick is
+ *                 realigned to the next tick boundary.
+ */
+int tls_tickless_idle_sleep(void)
+{
+	portTickType expected;
+	u32 wl_next;
+	u32 reload;
+	u32 ctrl;
+	u32 load;
+	u32 complete;
+
+	if (0 == tickless_cycles_per_tick)
+		return 0;
+
+	vTaskSuspendAll();
+	/* PRIMASK only, an interrupt still ends the wfi below */
+	__disable_irq();
+
+	expected = xTaskGetExpectedIdleTime();
+	if (expected > tickless_max_long_ticks)
+		expected = tickless_max_long_ticks;
+
+	wl_next = tls_timeouts_next_p();
+	if (0xFFFFFFFF != wl_next)
+	{
+		wl_next /= (1000 / HZ);
+		if (expected > wl_next)
+			expected = wl_next;
+	}
+
+	if (expected < TICKLESS_IDLE_MIN_TICKS)
+	{
+		__enable_irq();
+		xTaskResumeAll();
+		return 0;
+	}
+
+	/* with the counter stopped a tick is either pending or has cycles
+	   left; a pending one would merge with the tick ending the sleep */
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+	{
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		__enable_irq();
+		xTaskResumeAll();
+		return 0;
+	}
+
+	if (expected > tickless_max_idle_ticks)
+	{
+		tickless_long_sleep(SysTick->VAL, expected);
+		__enable_irq();
+		xTaskResumeAll();
+		return 1;
+	}
+
+	/* let systick run the whole sleep in one period, starting from what is
+	   left of the current tick */
+	reload = tickless_sleep_reload(SysTick->VAL, expected);
+	SysTick->LOAD = reload;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	tls_watchdog_clr();
+
+#if !defined(__CC_ARM)
+	__asm volatile ("dsb");
+	__asm volatile ("wfi");
+	__asm volatile ("isb");
+#else
+	__DSB();
+	__WFI();
+	__ISB();
+#endif
+
+	/* reading ctrl clears the count flag, keep it */
+	ctrl = SysTick->CTRL;
+	SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+	/* when the long period ran out its tick interrupt is pending and
+	   accounts for the last tick */
+	complete = tickless_wake(reload, SysTick->VAL,
+	                         (ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0,
+	                         expected, &load);
+
+	/* finish the current tick, then go on with the normal period */
+	SysTick->LOAD = load;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = tickless_cycles_per_tick - 1;
+
+	vTaskStepTick(complete);
+
+	__enable_irq();
+	xTaskResumeAll();
+
+	return 1;
+}
+#endif
@@ -55,6 +55,12 @@ extern u8 *wpa_supplicant_get_mac(void);
 
 static DHCP_SERVER DhcpServer;
 static DHCP_MSG DhcpMsg;
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+static struct tls_param_dhcps_lease DhcpLeaseSaved;
+#endif
+
+#define DHCPS_MAP_SET(map, i)	((map)[(i) >> 5] |= (1UL << ((i) & 31)))
+#define DHCPS_MAP_CLR(map, i)	((map)[(i) >> 5] &= ~(1UL << ((i) & 31)))
 
 #define DHCP_SET_OPTION_SUBNET_MASK(buffer, mask, len)	\
 	{	\
@@ -154,40 +160,263 @@ static void _PostMsgToSysQ(PDHCP_CLIENT pClient, INT16U nMsgId)
 }
 #endif	
 
-static bool _CheckMacIsValid(u8 *mac)
+/* Stations authenticated on the softap, release with tls_mem_free. */
+static struct tls_sta_info_t *_GetStaList(u32 *sta_num)
 {
 #define STA_MAC_BUF_LEN  64
-    u32 cnt;
-    u32 sta_num = 0;
     u8 *sta_buf;
-    bool ret = FALSE;
-    struct tls_sta_info_t *sta;
 
+    *sta_num = 0;
     sta_buf = tls_mem_alloc(STA_MAC_BUF_LEN);
     if (!sta_buf)
-        return FALSE;/* 系统资源不足，无需再让client接入 */
+        return NULL;
 
     memset(sta_buf, 0, STA_MAC_BUF_LEN);
-    tls_wifi_get_authed_sta_info(&sta_num, sta_buf, STA_MAC_BUF_LEN);
-    sta = (struct tls_sta_info_t *)sta_buf;
+    tls_wifi_get_authed_sta_info(sta_num, sta_buf, STA_MAC_BUF_LEN);
+    return (struct tls_sta_info_t *)sta_buf;
+}
+
+static bool _StaListHas(struct tls_sta_info_t *sta, u32 sta_num, u8 *mac)
+{
+    u32 cnt;
+
+    if (!sta)
+        return FALSE;/* 系统资源不足，无需再让client接入 */
+
     for (cnt = 0; cnt < sta_num; cnt++)
     {
         if (!compare_ether_addr(mac, sta->mac_addr))
-        {
-            ret = TRUE;/* 本SOFTAP下的client才予以分配IP */
-            break;
-        }
+            return TRUE;/* 本SOFTAP下的client才予以分配IP */
         sta++;
     }
-    tls_mem_free(sta_buf);
+    return FALSE;
+}
+
+static bool _CheckMacIsValid(u8 *mac)
+{
+    u32 sta_num;
+    bool ret;
+    struct tls_sta_info_t *sta;
+
+    sta = _GetStaList(&sta_num);
+    ret = _StaListHas(sta, sta_num, mac);
+    if (sta)
+        tls_mem_free(sta);
 
     return ret;
 }
 
+static bool _MacIsZero(const INT8U *MacAddr)
+{
+	return (MacAddr[0] | MacAddr[1] | MacAddr[2] | MacAddr[3] | MacAddr[4] | MacAddr[5]) == 0;
+}
+
+static INT8U _MacHash(const INT8U *MacAddr)
+{
+	/* The first three bytes are the same for all stations of a vendor. */
+	return (MacAddr[3] ^ MacAddr[4] ^ MacAddr[5]) & (DHCPS_HASH_SIZE - 1);
+}
+
+static INT8U _IpHash(INT32U IpAddr)
+{
+	/* The pool is a range of consecutive addresses, the low bits spread it evenly. */
+	return ntohl(IpAddr) & (DHCPS_HASH_SIZE - 1);
+}
+
+/* Keep the IDLE and free bitmaps in step with the client's state and MAC address. */
+static void _ClientUpdateMaps(PDHCP_CLIENT pClient)
+{
+	INT8U i = pClient - DhcpServer.Clients;
+
+	if(pClient->State == DHCP_CLIENT_STATE_IDLE)
+	{
+		DHCPS_MAP_SET(DhcpServer.IdleMap, i);
+		if(_MacIsZero(pClient->MacAddr))
+		{
+			DHCPS_MAP_SET(DhcpServer.FreeMap, i);
+		}
+		else
+		{
+			DHCPS_MAP_CLR(DhcpServer.FreeMap, i);
+		}
+	}
+	else
+	{
+		DHCPS_MAP_CLR(DhcpServer.IdleMap, i);
+		DHCPS_MAP_CLR(DhcpServer.FreeMap, i);
+	}
+}
+
+static void _ClientSetState(PDHCP_CLIENT pClient, DHCP_CLIENT_STATE State)
+{
+	pClient->State = State;
+	_ClientUpdateMaps(pClient);
+}
+
+/* Set the client's MAC address (NULL clears it) and move the client to that address's hash chain. */
+static void _ClientSetMac(PDHCP_CLIENT pClient, const INT8U *MacAddr)
+{
+	INT8U i = pClient - DhcpServer.Clients;
+	INT8U *pIdx;
+
+	if(MacAddr && (memcmp(pClient->MacAddr, MacAddr, 6) == 0))
+	{
+		return;
+	}
+
+	if(!_MacIsZero(pClient->MacAddr))
+	{
+		pIdx = &DhcpServer.MacHash[_MacHash(pClient->MacAddr)];
+		while(*pIdx != i)
+		{
+			pIdx = &DhcpServer.MacNext[*pIdx];
+		}
+		*pIdx = DhcpServer.MacNext[i];
+	}
+
+	if(MacAddr && !_MacIsZero(MacAddr))
+	{
+		MEMCPY(pClient->MacAddr, MacAddr, 6);
+		pIdx = &DhcpServer.MacHash[_MacHash(MacAddr)];
+		DhcpServer.MacNext[i] = *pIdx;
+		*pIdx = i;
+	}
+	else
+	{
+		memset(pClient->MacAddr, 0, 6);
+	}
+	_ClientUpdateMaps(pClient);
+}
+
+/* Entry with this MAC address, Active selects a negotiating or bound entry (1) or an IDLE history entry (0). */
+static PDHCP_CLIENT _ClientFindByMac(const INT8U *MacAddr, INT8U Active)
+{
+	INT8U i;
+	PDHCP_CLIENT pClient;
+
+	for(i = DhcpServer.MacHash[_MacHash(MacAddr)]; i != DHCPS_INDEX_END; i = DhcpServer.MacNext[i])
+	{
+		pClient = &DhcpServer.Clients[i];
+		if((memcmp(pClient->MacAddr, MacAddr, 6) == 0) &&
+			((pClient->State != DHCP_CLIENT_STATE_IDLE) == Active))
+		{
+			return pClient;
+		}
+	}
+	return NULL;
+}
+
+/* Entry that owns this ip address of the pool. */
+static PDHCP_CLIENT _ClientFindByIp(INT32U IpAddr)
+{
+	INT8U i;
+
+	for(i = DhcpServer.IpHash[_IpHash(IpAddr)]; i != DHCPS_INDEX_END; i = DhcpServer.IpNext[i])
+	{
+		if(DhcpServer.Clients[i].IpAddr.addr == IpAddr)
+		{
+			return &DhcpServer.Clients[i];
+		}
+	}
+	return NULL;
+}
+
+/* Lowest entry set in Map and not in Mask (may be NULL). */
+static PDHCP_CLIENT _ClientFirst(const INT32U *Map, const INT32U *Mask)
+{
+	INT32U w, Bits;
+	INT8U b;
+
+	for(w = 0; w < DHCPS_MAP_WORDS; w++)
+	{
+		Bits = Map[w] & (Mask ? ~Mask[w] : 0xFFFFFFFF);
+		if(Bits)
+		{
+			for(b = 0; (Bits & 1) == 0; b++)
+			{
+				Bits >>= 1;
+			}
+			return &DhcpServer.Clients[w * 32 + b];
+		}
+	}
+	return NULL;
+}
+
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+/* Put the assignments saved by _LeaseSave() back as history entries. */
+static void _LeaseRestore(void)
+{
+	struct tls_param_dhcps_lease *pLease = &DhcpLeaseSaved;
+	PDHCP_CLIENT pClient;
+	INT32U IpAddr;
+	INT8U i;
+
+	tls_param_get(TLS_PARAM_ID_DHCPS_LEASE, pLease, FALSE);
+	if(pLease->count > TLS_PARAM_DHCPS_LEASE_NUM)
+	{
+		memset(pLease, 0, sizeof(*pLease));
+	}
+	for(i = 0; i < pLease->count; i++)
+	{
+		MEMCPY(&IpAddr, pLease->lease[i].ip, 4);
+		pClient = _ClientFindByIp(IpAddr);
+		if(pClient && _MacIsZero(pClient->MacAddr) &&
+			(_ClientFindByMac(pLease->lease[i].mac, 0) == NULL))
+		{
+			_ClientSetMac(pClient, pLease->lease[i].mac);
+		}
+	}
+}
+
+/* Save the bound and history entries, the flash is only written when they changed. */
+static void _LeaseSave(void)
+{
+	struct tls_param_dhcps_lease Lease;
+	PDHCP_CLIENT pClient;
+	INT8U i;
+
+	memset(&Lease, 0, sizeof(Lease));
+	for(i = 0; (i < DHCPS_HISTORY_CLIENT_NUM) && (Lease.count < TLS_PARAM_DHCPS_LEASE_NUM); i++)
+	{
+		pClient = &DhcpServer.Clients[i];
+		if(((pClient->State == DHCP_CLIENT_STATE_BIND) || (pClient->State == DHCP_CLIENT_STATE_IDLE)) &&
+			!_MacIsZero(pClient->MacAddr))
+		{
+			MEMCPY(Lease.lease[Lease.count].mac, pClient->MacAddr, 6);
+			MEMCPY(Lease.lease[Lease.count].ip, &pClient->IpAddr.addr, 4);
+			Lease.count++;
+		}
+	}
+	DhcpServer.LeaseDirty = 0;
+	if(memcmp(&Lease, &DhcpLeaseSaved, sizeof(Lease)) != 0)
+	{
+		MEMCPY(&DhcpLeaseSaved, &Lease, sizeof(Lease));
+		tls_param_set(TLS_PARAM_ID_DHCPS_LEASE, &Lease, TRUE);
+		DhcpServer.LeaseFlushTicks = DHCPS_LEASE_FLUSH_TICKS;
+	}
+}
+
+/* Called once a tick: a burst of binds costs one flash write, not one each. */
+static void _LeaseFlush(void)
+{
+	if(DhcpServer.LeaseFlushTicks)
+	{
+		DhcpServer.LeaseFlushTicks--;
+	}
+	else if(DhcpServer.LeaseDirty)
+	{
+		_LeaseSave();
+	}
+}
+#endif
+
 static void _DhcpTickHandle(void * Arg)
 {
 	INT8U i;
 	PDHCP_CLIENT pClient;
+	struct tls_sta_info_t *sta = NULL;
+	u32 sta_num = 0;
+	bool sta_got = FALSE;
 
 	if(DhcpServer.Enable == 0)
 	{
@@ -202,8 +431,8 @@ static void _DhcpTickHandle(void * Arg)
 			if(pClient->Timeout && (--pClient->Timeout == 0))
 			{
 				/* Timeout for the client's request frame. */
-				memset(pClient->MacAddr, 0, 6);
-				pClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetMac(pClient, NULL);
+				_ClientSetState(pClient, DHCP_CLIENT_STATE_IDLE);
 			}
 		}
 		else if(pClient->State == DHCP_CLIENT_STATE_BIND)
@@ -212,19 +441,37 @@ static void _DhcpTickHandle(void * Arg)
 			if(pClient->Lease && (--pClient->Lease == 0))
 			{
 				/* The lease time over. */
-				pClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetState(pClient, DHCP_CLIENT_STATE_IDLE);
 		//		_PostMsgToSysQ(pClient, SYSC_MSG_IP_RELEASE);
 			}
-			else if(_CheckMacIsValid(pClient->MacAddr) == 0)
+			else
+			{
+				/* Get the station list once per tick, not per client. */
+				if(!sta_got)
+				{
+					sta = _GetStaList(&sta_num);
+					sta_got = TRUE;
+				}
+			}
+			if((pClient->State == DHCP_CLIENT_STATE_BIND) && !_StaListHas(sta, sta_num, pClient->MacAddr))
 			{
 				/* The client leave the wireless network. */
-				pClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetState(pClient, DHCP_CLIENT_STATE_IDLE);
 		//		_PostMsgToSysQ(pClient, SYSC_MSG_IP_RELEASE);
 			}
 #endif			
 		}	
 	}
 	
+	if(sta)
+	{
+		tls_mem_free(sta);
+	}
+
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+	_LeaseFlush();
+#endif
+
 	if(DhcpServer.Enable) sys_timeout(DHCP_TICK_TIME, _DhcpTickHandle, NULL);
 }
 
@@ -282,7 +529,6 @@ static INT8U _ParseDhcpOptions(PDHCP_MSG pMsg, INT8U * pMsgType, INT32U * pReqIp
 
 static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U ReqIpAddr, INT32U ServerId)
 {
-	INT8U i;
 	INT8U IpUnavailable;
 	PDHCP_CLIENT pClient;
 	PDHCP_CLIENT pFreeClient;
@@ -300,64 +546,47 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 	pReturnClient = NULL;
 	IpUnavailable = 0;
 	
-	for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
-	{
-		pClient = &DhcpServer.Clients[i];
-		if(pClient->State == DHCP_CLIENT_STATE_IDLE)
-		{	
-			if((pMyHistoryClient == NULL) && (memcmp(pClient->MacAddr, MacAddr, 6) == 0))
-			{
-				/* Get my history entry. */
-				pMyHistoryClient = pClient;
-			}
-
-			if((pReqClient == NULL) && ip4_addr_cmp(&pClient->IpAddr, (ip4_addr_t *)&ReqIpAddr) )
-			{
-				/* Get the idle entry that hold my requested ip address. */
-				pReqClient = pClient;
-			}
+	/* Is negotiating ip address or has negotiated now. */
+	pMyClient = _ClientFindByMac(MacAddr, 1);
 
-			if((pFreeClient == NULL) && (memcmp(pClient->MacAddr, "\x00\x00\x00\x00\x00\x00", 6) == 0) )
-			{
-				/* Get the first free entry. */
-				pFreeClient = pClient;
-			}
+	/* Get my history entry. */
+	pMyHistoryClient = _ClientFindByMac(MacAddr, 0);
 
-			if((pHistoryClient == NULL) && (memcmp(pClient->MacAddr, "\x00\x00\x00\x00\x00\x00", 6) != 0))
-			{
-				/* Get the first histoy entry that not belong to me. */
-				pHistoryClient = pClient;
-			}
+	pClient = _ClientFindByIp(ReqIpAddr);
+	if(pClient)
+	{
+		if(pClient->State == DHCP_CLIENT_STATE_IDLE)
+		{
+			/* Get the idle entry that hold my requested ip address. */
+			pReqClient = pClient;
 		}
-		else
+		else if(memcmp(pClient->MacAddr, MacAddr, 6) != 0)
 		{
-			if(memcmp(pClient->MacAddr, MacAddr, 6) == 0)
-			{
-				/* Is negotiating ip address or has negotiated now. */
-				pMyClient = pClient;
-			}
-			else if(ip4_addr_cmp(&pClient->IpAddr, (ip4_addr_t *)&ReqIpAddr))
-			{
-				/* The requested ip address is allocated. */
-				IpUnavailable = 1;
-			}
+			/* The requested ip address is allocated. */
+			IpUnavailable = 1;
 		}
 	}
 
+	/* Get the first free entry. */
+	pFreeClient = _ClientFirst(DhcpServer.FreeMap, NULL);
+
+	/* Get the first histoy entry, IDLE with a MAC address. */
+	pHistoryClient = _ClientFirst(DhcpServer.IdleMap, DhcpServer.FreeMap);
+
 	switch(MsgType)
 	{
 		case DHCP_MSG_DISCOVER:
 			if(pMyClient)
 			{
 				/* Amazing!!The client restart the negotiation. */
-				pMyClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetState(pMyClient, DHCP_CLIENT_STATE_IDLE);
 				
 				if(pReqClient)
 				{
 					/* The client request another ip address and that address is not allocated now. */
 					if(pMyClient->State != DHCP_CLIENT_STATE_BIND)
 					{
-						memset(pMyClient->MacAddr, 0, 6);
+						_ClientSetMac(pMyClient, NULL);
 					}
 					else
 					{
@@ -420,9 +649,9 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 					
 					if(pMyClient->State != DHCP_CLIENT_STATE_BIND)
 					{
-						memset(pMyClient->MacAddr, 0, 6);
+						_ClientSetMac(pMyClient, NULL);
 					}
-					pMyClient->State = DHCP_CLIENT_STATE_IDLE;
+					_ClientSetState(pMyClient, DHCP_CLIENT_STATE_IDLE);
 				}
 				else
 				{
@@ -431,14 +660,14 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 						/* The client request a new address that is not allocated. */
 						if(pMyClient->State != DHCP_CLIENT_STATE_BIND)
 						{
-							memset(pMyClient->MacAddr, 0, 6);
+							_ClientSetMac(pMyClient, NULL);
 						}
 						else
 						{
 						//	_PostMsgToSysQ(pMyClient, SYSC_MSG_IP_RELEASE);
 						}
 
-						pMyClient->State = DHCP_CLIENT_STATE_IDLE;
+						_ClientSetState(pMyClient, DHCP_CLIENT_STATE_IDLE);
 						if((ServerId == 0) || (DhcpServer.ServerIpAddr.addr == ServerId))
 						{
 							/* The client request the new address and that is free, allocate it. */
@@ -488,13 +717,13 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 			{
 				if(pMyClient->State != DHCP_CLIENT_STATE_BIND)
 				{
-					memset(pMyClient->MacAddr, 0, 6);
+					_ClientSetMac(pMyClient, NULL);
 				}
 				else
 				{
 				//	_PostMsgToSysQ(pClient, SYSC_MSG_IP_RELEASE);
 				}
-				pMyClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetState(pMyClient, DHCP_CLIENT_STATE_IDLE);
 			}
 			pReturnClient = NULL;
 			break;
@@ -505,13 +734,13 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 			{
 				if(pMyClient->State != DHCP_CLIENT_STATE_BIND)
 				{
-					memset(pMyClient->MacAddr, 0, 6);
+					_ClientSetMac(pMyClient, NULL);
 				}
 				else
 				{
 				//	_PostMsgToSysQ(pClient, SYSC_MSG_IP_RELEASE);
 				}
-				pMyClient->State = DHCP_CLIENT_STATE_IDLE;
+				_ClientSetState(pMyClient, DHCP_CLIENT_STATE_IDLE);
 			}
 			pReturnClient = NULL;
 			break;
@@ -525,7 +754,7 @@ static PDHCP_CLIENT _ClientTableLookup(INT8U * MacAddr, INT8U MsgType, INT32U Re
 	if(pReturnClient)
 	{
 		/* Updata the client's MAC address. */
-		MEMCPY(pReturnClient->MacAddr, MacAddr, 6);
+		_ClientSetMac(pReturnClient, MacAddr);
 	}
 
 	return pReturnClient;
@@ -739,17 +968,12 @@ static void _DHCPOfferGenAndSend(PDHCP_CLIENT pClient, INT8U * pClientMacAddr, I
 
 static void _CleanClientHistory(INT8U * pClientMacAddr)
 {
-	INT8U i;
 	PDHCP_CLIENT pClient;
-	
-	for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
+
+	while((pClient = _ClientFindByMac(pClientMacAddr, 0)) != NULL)
 	{
-		pClient = &DhcpServer.Clients[i];
-		if((pClient->State == DHCP_CLIENT_STATE_IDLE) && (memcmp(pClient->MacAddr, pClientMacAddr, 6) == 0))
-		{
-			/* Clean the history client's Mac address. */
-			memset(pClient->MacAddr, 0, 6);
-		}
+		/* Clean the history client's Mac address. */
+		_ClientSetMac(pClient, NULL);
 	}
 }
 
@@ -761,15 +985,18 @@ static void _DhcpClientSMEHandle(PDHCP_CLIENT pClient, INT8U MsgType, INT32U Xid
 			if(MsgType == DHCP_MSG_DISCOVER)
 			{
 				/* Receive the "DISCOVER" frame, switch the state to "SELECT". */
-				pClient->State = DHCP_CLIENT_STATE_SELECT;
+				_ClientSetState(pClient, DHCP_CLIENT_STATE_SELECT);
 			}
 			else if(MsgType == DHCP_MSG_REQUEST)
 			{
 				/* If the requested ip is not allocated, allocate it. */
 				_DHCPAckGenAndSend(pClient, pClient->MacAddr, Xid, Flags);
 				pClient->Lease = DHCP_DEFAULT_LEASE_TIME;
-				pClient->State = DHCP_CLIENT_STATE_BIND;
+				_ClientSetState(pClient, DHCP_CLIENT_STATE_BIND);
 				_CleanClientHistory(pClient->MacAddr);
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+				DhcpServer.LeaseDirty = 1;
+#endif
 //				_PostMsgToSysQ(pClient, SYSC_MSG_IP_ALLOCATED);
 				break;
 			}
@@ -778,7 +1005,7 @@ static void _DhcpClientSMEHandle(PDHCP_CLIENT pClient, INT8U MsgType, INT32U Xid
 			/* Receive the "DISCOVER" frame, send "OFFER" to the client. */
 			_DHCPOfferGenAndSend(pClient, pClient->MacAddr, Xid, Flags);
 			pClient->Timeout = DHCP_DEFFAULT_TIMEOUT;
-			pClient->State = DHCP_CLIENT_STATE_REQUEST;
+			_ClientSetState(pClient, DHCP_CLIENT_STATE_REQUEST);
 			break;
 
 		case DHCP_CLIENT_STATE_REQUEST:
@@ -787,8 +1014,11 @@ static void _DhcpClientSMEHandle(PDHCP_CLIENT pClient, INT8U MsgType, INT32U Xid
 			/* Send ACK to the client, if receive the "REQUEST" frame to select the offer or renew the DHCP lease. */
 			_DHCPAckGenAndSend(pClient, pClient->MacAddr, Xid, Flags);
 			pClient->Lease = DHCP_DEFAULT_LEASE_TIME;
-			pClient->State = DHCP_CLIENT_STATE_BIND;
+			_ClientSetState(pClient, DHCP_CLIENT_STATE_BIND);
 			_CleanClientHistory(pClient->MacAddr);
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+			DhcpServer.LeaseDirty = 1;
+#endif
 			break;
 
 		default:
@@ -798,40 +1028,34 @@ static void _DhcpClientSMEHandle(PDHCP_CLIENT pClient, INT8U MsgType, INT32U Xid
 
 ip4_addr_t *DHCPS_GetIpByMac(const INT8U *MacAddr)
 {
-    INT8U i;
     PDHCP_CLIENT pClient;
-    ip4_addr_t *IpAddr = NULL;
 
-    for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
+    if (DhcpServer.Enable == 0)
     {
-        pClient = &DhcpServer.Clients[i];
-        if (0 == compare_ether_addr(MacAddr, pClient->MacAddr))
-        { 
-            IpAddr = &pClient->IpAddr;
-            break;
-        }
+        return NULL;
     }
 
-    return IpAddr;
+    pClient = _ClientFindByMac(MacAddr, 1);
+    if (pClient == NULL)
+    {
+        pClient = _ClientFindByMac(MacAddr, 0);
+    }
+
+    return pClient ? &pClient->IpAddr : NULL;
 } 
 
 INT8U *DHCPS_GetMacByIp(const ip4_addr_t *ipaddr)
 {
-    INT8U i;
     PDHCP_CLIENT pClient;
-    INT8U *macaddr = NULL;
 
-    for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
+    if (DhcpServer.Enable == 0)
     {
-        pClient = &DhcpServer.Clients[i];
-        if (pClient->IpAddr.addr == ipaddr->addr)
-        { 
-            macaddr = pClient->MacAddr;
-            break;
-        }
+        return NULL;
     }
 
-    return macaddr;
+    pClient = _ClientFindByIp(ipaddr->addr);
+
+    return pClient ? pClient->MacAddr : NULL;
 }
 
 /* numdns 0/1  --> dns 1/2 */
@@ -965,7 +1189,6 @@ void DHCPS_RecvCb(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Add
 -------------------------------------------------------------------------*/
 INT8S DHCPS_ClientDelete(INT8U * MacAddr)
 {
-	INT8U i;
 	PDHCP_CLIENT pClient;
 
 	/* Check the server is active now. */
@@ -979,22 +1202,19 @@ INT8S DHCPS_ClientDelete(INT8U * MacAddr)
 		return DHCPS_ERR_PARAM;
 	}
 	
-	for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
+	pClient = _ClientFindByMac(MacAddr, 1);
+	if(pClient)
 	{
-		pClient = &DhcpServer.Clients[i];
-		if((pClient->State != DHCP_CLIENT_STATE_IDLE) && (memcmp(pClient->MacAddr, MacAddr, 6) == 0))
+		if(pClient->State != DHCP_CLIENT_STATE_BIND)
 		{
-			if(pClient->State != DHCP_CLIENT_STATE_BIND)
-			{
-				/* For negotiating client, return. */
-				return DHCPS_ERR_NOT_BIND;
-			}
-			else
-			{
-				/* For bind client, delete it directly. */
-				pClient->State = DHCP_CLIENT_STATE_IDLE;
-				return DHCPS_ERR_SUCCESS;
-			}
+			/* For negotiating client, return. */
+			return DHCPS_ERR_NOT_BIND;
+		}
+		else
+		{
+			/* For bind client, delete it directly. */
+			_ClientSetState(pClient, DHCP_CLIENT_STATE_IDLE);
+			return DHCPS_ERR_SUCCESS;
 		}
 	}
 
@@ -1044,22 +1264,30 @@ INT8S DHCPS_Start(struct netif *Netif)
 	DhcpServer.LeaseTime = DHCP_DEFAULT_LEASE_TIME;
 	
 	/* Initialize the free DHCP clients. */
+	memset(DhcpServer.MacHash, DHCPS_INDEX_END, sizeof(DhcpServer.MacHash));
+	memset(DhcpServer.IpHash, DHCPS_INDEX_END, sizeof(DhcpServer.IpHash));
 	for(i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
 	{
 		pClient = &DhcpServer.Clients[i];
-		/* Set the initial client state is "IDLE". */
-		pClient->State = DHCP_CLIENT_STATE_IDLE;
 		
-		/* Set the ip address to the client. */
+		/* Set the ip address to the client, it stays with this entry until the server stops. */
 		Val = ntohl(DhcpServer.StartIpAddr.addr);
 		tmp = (Val & (~Mask));
 		tmp = ((tmp + i) % (~Mask)) ? ((tmp + i) % (~Mask)) : 1;
 		Val = htonl((Val & Mask) | tmp);
 		ip4_addr_set(&pClient->IpAddr, (ip4_addr_t *)&Val);
+		DhcpServer.IpNext[i] = DhcpServer.IpHash[_IpHash(Val)];
+		DhcpServer.IpHash[_IpHash(Val)] = i;
+
+		/* Set the initial client state is "IDLE". */
+		_ClientSetState(pClient, DHCP_CLIENT_STATE_IDLE);
 		
 		/* Set the default lease time. */
 		pClient->Lease = DHCP_DEFAULT_LEASE_TIME;
 	}
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+	_LeaseRestore();
+#endif
 	
 	/* Allocate a UDP PCB. */
 	DhcpServer.Socket = udp_new();
@@ -1102,6 +1330,13 @@ void DHCPS_Stop(void)
 	
 	/* Stop the tick timer. */
 	sys_untimeout(_DhcpTickHandle, NULL);
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+	/* Save what the timer has not flushed yet. */
+	if(DhcpServer.LeaseDirty)
+	{
+		_LeaseSave();
+	}
+#endif
 	
 	/* Release the socket. */
 	if(DhcpServer.Socket) 
@@ -25,12 +25,18 @@
 #define DHCPS_ERR_NOT_FOUND      -5
 #define DHCPS_ERR_INACTIVE      -6
 
-#define DHCPS_HISTORY_CLIENT_NUM      8
+#define DHCPS_HISTORY_CLIENT_NUM      8 /* at most 254 */
+/* Buckets of the MAC and IP indexes, power of 2 */
+#define DHCPS_HASH_SIZE      16
+#define DHCPS_INDEX_END      0xFF
+#define DHCPS_MAP_WORDS      ((DHCPS_HISTORY_CLIENT_NUM + 31) / 32)
 
 #define DHCP_DEFAULT_LEASE_TIME      7200 /* 2 Hours. */
 #define DHCP_DEFAULT_LEASE_TIME_MS      7200000 /* 7200000ms */
 #define DHCP_TICK_TIME      1000 /* 1s. */
 #define DHCP_DEFFAULT_TIMEOUT      10 /* 500ms */
+/* Ticks between two writes of the saved leases to the flash. */
+#define DHCPS_LEASE_FLUSH_TICKS      30 /* 30s. */
 
 #define DHCP_HWTYPE_ETHERNET      1
 
@@ -114,6 +120,19 @@ typedef struct __DHCP_SERVER
 	ip4_addr_t Dns2;
 	INT32U LeaseTime;
 	DHCP_CLIENT Clients[DHCPS_HISTORY_CLIENT_NUM];
+	/* Hash chains of client indexes, by MAC address and by ip address. */
+	INT8U MacHash[DHCPS_HASH_SIZE];
+	INT8U MacNext[DHCPS_HISTORY_CLIENT_NUM];
+	INT8U IpHash[DHCPS_HASH_SIZE];
+	INT8U IpNext[DHCPS_HISTORY_CLIENT_NUM];
+	/* One bit per client: IDLE entries, and IDLE entries without a history MAC address. */
+	INT32U IdleMap[DHCPS_MAP_WORDS];
+	INT32U FreeMap[DHCPS_MAP_WORDS];
+#if TLS_CONFIG_DHCPS_LEASE_SAVE
+	/* The leases changed since the last save, and the ticks until the flash may be written again. */
+	INT8U LeaseDirty;
+	INT32U LeaseFlushTicks;
+#endif
 }DHCP_SERVER, *PDHCP_SERVER;
 
 #define DHCPS_HADDR_SIZE      16
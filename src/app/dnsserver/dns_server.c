@@ -29,6 +29,7 @@
 #include "lwip/tcpip.h"
 #include "lwip/memp.h"
 #include "lwip/udp.h"
+#include "lwip/dns.h"
 
 #include "netif/ethernetif.h"
 
@@ -37,175 +38,572 @@
 #if TLS_CONFIG_AP
 static DNS_SERVER DnsServer;
 
-static INT32S _DnsCompareName(INT8U * MyDns, INT8U * Query)
+static const INT8U DnsQueryA[sizeof(DNS_QUERY)] = {0x00, DNS_RRTYPE_A, 0x00, DNS_RRCLASS_IN};
+
+static INT8U _DnsLower(INT8U c)
 {
-	INT8U n;
+	return ((c >= 'A') && (c <= 'Z')) ? (c + ('a' - 'A')) : c;
+}
 
-	if((strlen((const char *)Query) - 1) > 32)
+/* Label lengths are below 64, _DnsLower never changes them. */
+static INT32S _DnsCaseCmp(const INT8U * A, const INT8U * B, INT32U Len)
+{
+	while(Len--)
 	{
-		return 1;
+		if(_DnsLower(*A++) != _DnsLower(*B++))
+		{
+			return 1;
+		}
 	}
-	
-	do
+
+	return 0;
+}
+
+/* Length of the name in wire format including the root label, 0 if it is not valid. */
+static INT32U _DnsNameLen(const INT8U * Name, INT32U Max)
+{
+	INT32U Len = 0;
+
+	while(Len < Max)
 	{
-		n = *Query++;
-		/* @see RFC 1035 - 4.1.4. Message compression. */
-		if((n & 0xc0) == 0xc0) 
+		if(Name[Len] == 0)
 		{
-			/* Compressed name. */
-			break;
+			return Len + 1;
 		}
-		else
+		/* @see RFC 1035 - 4.1.4. Message compression, never used in the question. */
+		if(Name[Len] & 0xc0)
 		{
-			/* Not compressed name. */
-			while(n > 0)
+			return 0;
+		}
+		Len += Name[Len] + 1;
+	}
+
+	return 0;
+}
+
+/* "wm.com" to "\2wm\3com\0" in lower case, returns the length or 0. */
+static INT32U _DnsNameToWire(const INT8U * DnsName, INT8U * Wire)
+{
+	INT32U Len = strlen((const char *)DnsName);
+	INT8U * Label = Wire;
+	INT32U i;
+
+	if((Len == 0) || (Len > 32))
+	{
+		/* The length of the DNS name must be less than 32. */
+		return 0;
+	}
+
+	*Label = 0;
+	for(i = 0; i < Len; i++)
+	{
+		if(DnsName[i] == '.')
+		{
+			if(*Label == 0)
 			{
-				if((*MyDns) != (*Query))
-				{
-					return 1;
-				}
-				++Query;
-				++MyDns;
-				--n;
-			};
-			++MyDns;
-		}
-	} while (*Query != 0);
-
-	return ((*(--MyDns) == 0) ? 0 : 1);
+				return 0;
+			}
+			Label = Wire + i + 1;
+			*Label = 0;
+		}
+		else
+		{
+			Wire[i + 1] = _DnsLower(DnsName[i]);
+			(*Label)++;
+		}
+	}
+
+	/* A trailing dot already ends with the root label. */
+	if(*Label == 0)
+	{
+		return Len + 1;
+	}
+	Wire[Len + 1] = 0;
+
+	return Len + 2;
 }
 
-static void _DNSNameErrGenAndSend(ip_addr_t *Addr, INT16U Port, PDNS_QUERY pDnsQuery, INT8U * QueryName, INT16U TansactionId)
+/* "*" matches every name, "*.wm.com" every name below wm.com. */
+static INT8S _DnsParseName(INT8U * DnsName, DNSS_NAME * Entry)
 {
-	INT32U Len;
-	INT8U * Body;
-	PDNS_HEADER pDnsHeader;
-	struct pbuf * pDnsBuf;
-	INT8U * pDnsReply;
+	memset(Entry, 0, sizeof(DNSS_NAME));
+	if(DnsName == NULL)
+	{
+		return DNSS_ERR_PARAM;
+	}
+
+	if((DnsName[0] == '*') && (DnsName[1] == '\0'))
+	{
+		Entry->Wild = 1;
+		Entry->NameLen = 1;
+	}
+	else if((DnsName[0] == '*') && (DnsName[1] == '.'))
+	{
+		Entry->Wild = 1;
+		Entry->NameLen = _DnsNameToWire(DnsName + 2, Entry->Name);
+	}
+	else
+	{
+		Entry->NameLen = _DnsNameToWire(DnsName, Entry->Name);
+	}
+
+	return (Entry->NameLen == 0) ? DNSS_ERR_PARAM : DNSS_ERR_SUCCESS;
+}
+
+static void _DnsBuildAnswer(void)
+{
+	INT8U * Body = DnsServer.Answer;
+	INT32U ServerIpAddr;
+	DNS_ANSWER DnsAnswer;
+	INT16U Tmp;
+
+	/* NAME: provided as offset to first occurence in response. */
+	Tmp = htons(DNS_NAME_OFFSET | DNS_HEADER_LEN);
+	MEMCPY(Body, &Tmp, sizeof(INT16U));
+	Body += sizeof(INT16U);
+
+	/* Answer. */
+	DnsAnswer.Type = htons(DNS_RRTYPE_A);
+	DnsAnswer.Class = htons(DNS_RRCLASS_IN);
+	DnsAnswer.Ttl = htonl(DNS_DEFAULT_TTL);
+	MEMCPY(Body, &DnsAnswer, sizeof(DNS_ANSWER));
+	Body += sizeof(DNS_ANSWER);
 
-	Len = ((sizeof(DNS_HEADER) + (strlen((const char *)QueryName) + 1) + sizeof(DNS_QUERY) + 3)  >> 2) << 2;
-	pDnsReply = tls_mem_alloc(Len);
-	if(pDnsReply == NULL)
+	/* Length. */
+	Tmp = htons(4);
+	MEMCPY(Body, &Tmp, sizeof(INT16U));
+	Body += sizeof(INT16U);
+
+	/* IP Address. */
+	ServerIpAddr = ip_addr_get_ip4_u32(&DnsServer.HostIp);
+	MEMCPY(Body, &ServerIpAddr, 4);
+}
+
+static void _DnsBuildResp(DNSS_NAME * Entry)
+{
+	PDNS_HEADER pDnsHeader = (PDNS_HEADER)Entry->Resp;
+	INT8U * Body = Entry->Resp + DNS_HEADER_LEN;
+
+	if((Entry->NameLen == 0) || Entry->Wild)
 	{
+		Entry->RespLen = 0;
 		return;
 	}
-	
-	pDnsHeader = (PDNS_HEADER)pDnsReply;
-	Body = (INT8U *)(pDnsHeader + 1);
-	Len = 0;
 
-	/* Header. */
-	pDnsHeader->TansactionId = TansactionId;
+	/* Header, the transaction id is set for each reply. */
+	pDnsHeader->TansactionId = 0;
 	pDnsHeader->DnsFlag1 = DNS_FLAG1_RESPONSE;
-	pDnsHeader->DnsFlag2 = DNS_FLAG2_ERR_NAME;
+	pDnsHeader->DnsFlag2 = DNS_FLAG2_ERR_NONE;
 	pDnsHeader->Quentions = htons(1);
-	pDnsHeader->AnswerRR = 0;
+	pDnsHeader->AnswerRR = htons(1);
 	pDnsHeader->AuthorityRR = 0;
 	pDnsHeader->AdditionalRR = 0;
-	Len += sizeof(DNS_HEADER);
-	
+
 	/* Querry. */
-	MEMCPY(Body, QueryName, strlen((const char *)QueryName) + 1);
-	Body += strlen((const char *)QueryName) + 1;
-	Len += strlen((const char *)QueryName) + 1;
-	MEMCPY(Body, pDnsQuery, sizeof(DNS_QUERY));
-	Len += sizeof(DNS_QUERY);
+	MEMCPY(Body, Entry->Name, Entry->NameLen);
+	Body += Entry->NameLen;
+	MEMCPY(Body, DnsQueryA, sizeof(DnsQueryA));
+	Body += sizeof(DnsQueryA);
+
+	MEMCPY(Body, DnsServer.Answer, DNS_ANSWER_A_LEN);
+	Entry->RespLen = DNS_HEADER_LEN + Entry->NameLen + sizeof(DnsQueryA) + DNS_ANSWER_A_LEN;
+}
+
+/* Entries are changed by the application while the tcpip thread answers from them. */
+static void _DnsStoreName(DNSS_NAME * Entry, DNSS_NAME * New)
+{
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	if(New != NULL)
+	{
+		_DnsBuildResp(New);
+	}
+
+	SYS_ARCH_PROTECT(lev);
+	if(New != NULL)
+	{
+		MEMCPY(Entry, New, sizeof(DNSS_NAME));
+	}
+	else
+	{
+		Entry->NameLen = 0;
+	}
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+static DNSS_NAME * _DnsFindName(const INT8U * Name, INT32U Len)
+{
+	DNSS_NAME * Entry;
+	INT32U i;
+	INT32U Pos;
+
+	for(i = 0; i < DNSS_NAME_NUM; i++)
+	{
+		Entry = &DnsServer.Names[i];
+		if(Entry->NameLen == 0)
+		{
+			continue;
+		}
+
+		if(!Entry->Wild)
+		{
+			if((Entry->NameLen == Len) && (_DnsCaseCmp(Entry->Name, Name, Len) == 0))
+			{
+				return Entry;
+			}
+			continue;
+		}
+
+		/* "*" stands for one label or more in front of the suffix. */
+		for(Pos = Name[0] + 1; Pos < Len; Pos += Name[Pos] + 1)
+		{
+			if(((Len - Pos) == Entry->NameLen) && (_DnsCaseCmp(Entry->Name, Name + Pos, Entry->NameLen) == 0))
+			{
+				return Entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Send a prebuilt message with the client's transaction id. */
+static void _DNSPrebuiltSend(ip_addr_t *Addr, INT16U Port, const INT8U * Msg, INT32U Len, INT16U TansactionId)
+{
+	struct pbuf * pDnsBuf;
 
 	pDnsBuf = pbuf_alloc(PBUF_TRANSPORT, Len, PBUF_RAM);
 	if(pDnsBuf == NULL)
 	{
-		tls_mem_free(pDnsReply);
 		return;
 	}
-	pbuf_take(pDnsBuf, (const void *) pDnsReply, Len);
+	MEMCPY(pDnsBuf->payload, Msg, Len);
+	((PDNS_HEADER)pDnsBuf->payload)->TansactionId = TansactionId;
 
 	/* Send to the client. */
 	udp_sendto(DnsServer.Socket, pDnsBuf, Addr, Port);
 	pbuf_free(pDnsBuf);
-	tls_mem_free(pDnsReply);
 }
 
-static void _DNSAnswerGenAndSend(ip_addr_t *Addr, INT16U Port, PDNS_QUERY pDnsQuery, INT8U * QueryName, INT16U TansactionId)
+/* Reply with the question as asked and, if given, the answer record. */
+static void _DNSReplyGenAndSend(ip_addr_t *Addr, INT16U Port, const INT8U * Question, INT32U QuestionLen, INT16U TansactionId, INT8U DnsFlag2, const INT8U * Answer)
 {
 	INT32U Len;
 	INT8U * Body;
-	INT32U ServerIpAddr;
 	PDNS_HEADER pDnsHeader;
-	DNS_ANSWER DnsAnswer;
 	struct pbuf * pDnsBuf;
-	INT8U * pDnsReply;
-	INT16U Tmp;
 
-	Len = ((sizeof(DNS_HEADER) + (strlen((const char *)QueryName) + 1) + sizeof(DNS_QUERY) + 2 + sizeof(DNS_ANSWER) + 2 + 4 + 3)  >> 2) << 2;
-	pDnsReply = tls_mem_alloc(Len);
-	if(pDnsReply == NULL)
+	Len = DNS_HEADER_LEN + QuestionLen + ((Answer != NULL) ? DNS_ANSWER_A_LEN : 0);
+	pDnsBuf = pbuf_alloc(PBUF_TRANSPORT, Len, PBUF_RAM);
+	if(pDnsBuf == NULL)
 	{
 		return;
 	}
-	
-	pDnsHeader = (PDNS_HEADER)pDnsReply;
-	Body = (INT8U *)(pDnsHeader + 1);
-	Len = 0;
+
+	pDnsHeader = (PDNS_HEADER)pDnsBuf->payload;
+	Body = (INT8U *)pDnsBuf->payload + DNS_HEADER_LEN;
 
 	/* Header. */
 	pDnsHeader->TansactionId = TansactionId;
 	pDnsHeader->DnsFlag1 = DNS_FLAG1_RESPONSE;
-	pDnsHeader->DnsFlag2 = DNS_FLAG2_ERR_NONE;
+	pDnsHeader->DnsFlag2 = DnsFlag2;
 	pDnsHeader->Quentions = htons(1);
-	pDnsHeader->AnswerRR = htons(1);
+	pDnsHeader->AnswerRR = (Answer != NULL) ? htons(1) : 0;
 	pDnsHeader->AuthorityRR = 0;
 	pDnsHeader->AdditionalRR = 0;
-	Len += sizeof(DNS_HEADER);
-	
+
 	/* Querry. */
-	MEMCPY(Body, QueryName, strlen((const char *)QueryName) + 1);
-	Body += strlen((const char *)QueryName) + 1;
-	Len += strlen((const char *)QueryName) + 1;
-	MEMCPY(Body, pDnsQuery, sizeof(DNS_QUERY));
-	Body += sizeof(DNS_QUERY);
-	Len += sizeof(DNS_QUERY);
+	MEMCPY(Body, Question, QuestionLen);
+	Body += QuestionLen;
 
-	/* NAME: provided as offset to first occurence in response. */
-	Tmp = DNS_NAME_OFFSET | sizeof(DNS_HEADER);
-	Tmp = htons(Tmp);
-	MEMCPY(Body, &Tmp, sizeof(INT16U));
-	Body += sizeof(INT16U);
-	Len += sizeof(INT16U);
+	if(Answer != NULL)
+	{
+		MEMCPY(Body, Answer, DNS_ANSWER_A_LEN);
+	}
 
-	/* Answer. */
-	DnsAnswer.Type = htons(DNS_RRTYPE_A);
-	DnsAnswer.Class = htons(DNS_RRCLASS_IN);
-	DnsAnswer.Ttl = htonl(DNS_DEFAULT_TTL);
-	MEMCPY(Body, &DnsAnswer, sizeof(DNS_ANSWER));
-	Body += sizeof(DNS_ANSWER);
-	Len += sizeof(DNS_ANSWER);
+	/* Send to the client. */
+	udp_sendto(DnsServer.Socket, pDnsBuf, Addr, Port);
+	pbuf_free(pDnsBuf);
+}
 
-	/* Length. */
-	Tmp = htons(4);
-	MEMCPY(Body, &Tmp, sizeof(INT16U));
-	Body += sizeof(INT16U);
-	Len += sizeof(INT16U);
+#if TLS_CONFIG_DNSS_FORWARD
+static INT32S _DnsCacheCmp(DNSS_CACHE * Cache, const INT8U * Question, INT32U QuestionLen)
+{
+	if(Cache->QuestionLen != QuestionLen)
+	{
+		return 1;
+	}
+
+	return memcmp(Cache->Resp + DNS_HEADER_LEN, Question, QuestionLen);
+}
+
+static void _DnsCacheFree(DNSS_CACHE * Cache)
+{
+	if(Cache->Resp)
+	{
+		tls_mem_free(Cache->Resp);
+	}
+	memset(Cache, 0, sizeof(DNSS_CACHE));
+}
+
+static DNSS_CACHE * _DnsCacheFind(const INT8U * Question, INT32U QuestionLen)
+{
+	DNSS_CACHE * Cache;
+	INT32U Now = tls_os_get_time();
+	INT32U i;
+
+	for(i = 0; i < DNSS_CACHE_NUM; i++)
+	{
+		Cache = &DnsServer.Cache[i];
+		if(Cache->Resp == NULL)
+		{
+			continue;
+		}
+		if((INT32S)(Now - Cache->Expire) >= 0)
+		{
+			_DnsCacheFree(Cache);
+			continue;
+		}
+		if(_DnsCacheCmp(Cache, Question, QuestionLen) == 0)
+		{
+			return Cache;
+		}
+	}
+
+	return NULL;
+}
+
+/* Keep an upstream answer for its smallest TTL, not longer than DNSS_CACHE_TTL_MAX. */
+static void _DnsCacheAdd(const INT8U * Msg, INT32U Len)
+{
+	PDNS_HEADER pDnsHeader = (PDNS_HEADER)Msg;
+	DNSS_CACHE * Cache = NULL;
+	DNSS_CACHE * Entry;
+	INT32U Now = tls_os_get_time();
+	INT32U Ttl = DNSS_CACHE_TTL_MAX;
+	INT32U QuestionLen;
+	INT32U RrTtl;
+	INT32U Pos;
+	INT32U i;
+	INT16U nAnswers;
+	INT8U * Resp;
+
+	if((Len > DNSS_CACHE_LEN) || (pDnsHeader->DnsFlag1 & DNS_FLAG1_TRUNC) ||
+	   ((pDnsHeader->DnsFlag2 & DNS_FLAG2_ERR_MASK) != DNS_FLAG2_ERR_NONE) ||
+	   (pDnsHeader->Quentions != htons(1)) || (pDnsHeader->AnswerRR == 0))
+	{
+		return;
+	}
+
+	QuestionLen = _DnsNameLen(Msg + DNS_HEADER_LEN, Len - DNS_HEADER_LEN);
+	if((QuestionLen == 0) || ((DNS_HEADER_LEN + QuestionLen + sizeof(DNS_QUERY)) > Len))
+	{
+		return;
+	}
+	QuestionLen += sizeof(DNS_QUERY);
+
+	Pos = DNS_HEADER_LEN + QuestionLen;
+	nAnswers = ntohs(pDnsHeader->AnswerRR);
+	while(nAnswers--)
+	{
+		/* Owner name, compressed or not. */
+		while(Pos < Len)
+		{
+			if(Msg[Pos] == 0)
+			{
+				Pos += 1;
+				break;
+			}
+			if((Msg[Pos] & 0xc0) == 0xc0)
+			{
+				Pos += 2;
+				break;
+			}
+			Pos += Msg[Pos] + 1;
+		}
+
+		/* Type, class, ttl and data length. */
+		if((Pos + 10) > Len)
+		{
+			return;
+		}
+		RrTtl = ((INT32U)Msg[Pos + 4] << 24) | ((INT32U)Msg[Pos + 5] << 16) | ((INT32U)Msg[Pos + 6] << 8) | Msg[Pos + 7];
+		if(RrTtl < Ttl)
+		{
+			Ttl = RrTtl;
+		}
+		Pos += 10 + (((INT32U)Msg[Pos + 8] << 8) | Msg[Pos + 9]);
+		if(Pos > Len)
+		{
+			return;
+		}
+	}
+
+	if(Ttl == 0)
+	{
+		return;
+	}
+
+	/* The same question, a free or expired entry, else the one expiring first. */
+	for(i = 0; i < DNSS_CACHE_NUM; i++)
+	{
+		Entry = &DnsServer.Cache[i];
+		if((Entry->Resp == NULL) || ((INT32S)(Now - Entry->Expire) >= 0) ||
+		   (_DnsCacheCmp(Entry, Msg + DNS_HEADER_LEN, QuestionLen) == 0))
+		{
+			Cache = Entry;
+			break;
+		}
+		if((Cache == NULL) || ((INT32S)(Entry->Expire - Cache->Expire) < 0))
+		{
+			Cache = Entry;
+		}
+	}
+
+	Resp = tls_mem_alloc(Len);
+	if(Resp == NULL)
+	{
+		return;
+	}
+	MEMCPY(Resp, Msg, Len);
+
+	_DnsCacheFree(Cache);
+	Cache->Resp = Resp;
+	Cache->Len = Len;
+	Cache->QuestionLen = QuestionLen;
+	Cache->Expire = Now + Ttl * HZ;
+}
+
+static INT32U _DnsQuestionHash(const INT8U * Question, INT32U QuestionLen)
+{
+	INT32U Hash = 5381;
+
+	while(QuestionLen--)
+	{
+		Hash = (Hash * 33) ^ *Question++;
+	}
+
+	return Hash;
+}
+
+static void _DnsForward(const INT8U * Msg, INT32U Len, INT32U QuestionLen, ip_addr_t *Addr, INT16U Port)
+{
+	const ip_addr_t * Server = dns_getserver(0);
+	DNSS_FWD * Fwd = NULL;
+	DNSS_FWD * Entry;
+	struct pbuf * pDnsBuf;
+	INT32U Now = tls_os_get_time();
+	INT32U i;
+
+	if((DnsServer.Upstream == NULL) || ip_addr_isany(Server))
+	{
+		return;
+	}
+
+	/* A free or timed out entry, else the oldest query is given up. */
+	for(i = 0; i < DNSS_FWD_NUM; i++)
+	{
+		Entry = &DnsServer.Fwd[i];
+		if(!Entry->Used || ((Now - Entry->Time) > (DNSS_FWD_TIMEOUT * HZ)))
+		{
+			Fwd = Entry;
+			break;
+		}
+		if((Fwd == NULL) || ((INT32S)(Entry->Time - Fwd->Time) < 0))
+		{
+			Fwd = Entry;
+		}
+	}
 
-	/* IP Address. */
-	ServerIpAddr = ip_addr_get_ip4_u32(&DnsServer.HostIp);
-	MEMCPY(Body, &ServerIpAddr, 4);
-	Body += 4;
-	Len += 4;
-	
 	pDnsBuf = pbuf_alloc(PBUF_TRANSPORT, Len, PBUF_RAM);
 	if(pDnsBuf == NULL)
 	{
-		tls_mem_free(pDnsReply);
 		return;
 	}
-	pbuf_take(pDnsBuf, (const void *) pDnsReply, Len);
-
-	/* Send to the client. */
-	udp_sendto(DnsServer.Socket, pDnsBuf, Addr, Port);
+	MEMCPY(pDnsBuf->payload, Msg, Len);
+
+	Fwd->Used = 1;
+	Fwd->Time = Now;
+	ip_addr_copy(Fwd->Addr, *Addr);
+	ip_addr_copy(Fwd->Server, *Server);
+	Fwd->QuestionHash = _DnsQuestionHash(Msg + DNS_HEADER_LEN, QuestionLen);
+	Fwd->QuestionLen = QuestionLen;
+	Fwd->Port = Port;
+	Fwd->TansactionId = ((PDNS_HEADER)Msg)->TansactionId;
+	Fwd->FwdId = (INT16U)LWIP_RAND() ^ ++DnsServer.FwdId;
+	((PDNS_HEADER)pDnsBuf->payload)->TansactionId = Fwd->FwdId;
+
+	udp_sendto(DnsServer.Upstream, pDnsBuf, Server, DNS_SERVER_PORT);
 	pbuf_free(pDnsBuf);
-	tls_mem_free(pDnsReply);
 }
 
+static void _DnsUpstreamRecv(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, const ip_addr_t *Addr, u16_t Port)
+{
+	PDNS_HEADER pDnsHeader;
+	struct pbuf * pDnsBuf = NULL;
+	DNSS_FWD * Fwd = NULL;
+	INT32U QuestionLen;
+	INT32U i;
+
+	do
+	{
+		if((Port != DNS_SERVER_PORT) || (P->tot_len < (DNS_HEADER_LEN + sizeof(DNS_QUERY))))
+		{
+			break;
+		}
+
+		pDnsBuf = pbuf_alloc(PBUF_TRANSPORT, P->tot_len, PBUF_RAM);
+		if(pDnsBuf == NULL)
+		{
+			break;
+		}
+		pbuf_copy_partial(P, pDnsBuf->payload, P->tot_len, 0);
+		pDnsHeader = (PDNS_HEADER)pDnsBuf->payload;
+
+		if(!(pDnsHeader->DnsFlag1 & DNS_FLAG1_RESPONSE) || (pDnsHeader->Quentions != htons(1)))
+		{
+			break;
+		}
+
+		QuestionLen = _DnsNameLen((const INT8U *)(pDnsHeader + 1), P->tot_len - DNS_HEADER_LEN - sizeof(DNS_QUERY));
+		if(QuestionLen == 0)
+		{
+			break;
+		}
+		QuestionLen += sizeof(DNS_QUERY);
+
+		for(i = 0; i < DNSS_FWD_NUM; i++)
+		{
+			if(DnsServer.Fwd[i].Used && (DnsServer.Fwd[i].FwdId == pDnsHeader->TansactionId))
+			{
+				Fwd = &DnsServer.Fwd[i];
+				break;
+			}
+		}
+
+		/* Anyone can guess the id, the reply must also come from the server and answer the question asked. */
+		if((Fwd == NULL) || !ip_addr_cmp(Addr, &Fwd->Server) || (QuestionLen != Fwd->QuestionLen) ||
+		   (_DnsQuestionHash((const INT8U *)(pDnsHeader + 1), QuestionLen) != Fwd->QuestionHash))
+		{
+			break;
+		}
+		Fwd->Used = 0;
+
+		_DnsCacheAdd((const INT8U *)pDnsBuf->payload, pDnsBuf->tot_len);
+
+		/* Send to the client. */
+		pDnsHeader->TansactionId = Fwd->TansactionId;
+		udp_sendto(DnsServer.Socket, pDnsBuf, &Fwd->Addr, Fwd->Port);
+	}while(0);
+
+	if(pDnsBuf)
+	{
+		pbuf_free(pDnsBuf);
+	}
+	pbuf_free(P);
+}
+#endif
+
 /*   DNSS_RecvCb   */
 /*-------------------------------------------------------------------------
 	Description:	
@@ -222,63 +620,110 @@ static void _DNSAnswerGenAndSend(ip_addr_t *Addr, INT16U Port, PDNS_QUERY pDnsQu
 		None.
 		
 	Note:	
-		
+		Configured names are answered from prebuilt replies, so most queries
+		cost one copy and no parsing beyond the question name.
 -------------------------------------------------------------------------*/
 void DNSS_RecvCb(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Addr, INT16U Port)
 {
 	PDNS_HEADER pDnsHeader;
 	DNS_QUERY DnsQuery;
-	//INT16U nQuestions, nAnswers;
+	DNSS_NAME * Entry;
+	struct netif *netif;
+	INT32U NameLen;
 	INT8U * pDnsName;
-	INT8U * pDnsMsg;
+	INT8U * pDnsMsg = NULL;
+#if TLS_CONFIG_DNSS_FORWARD
+	DNSS_CACHE * Cache;
+#endif
 
 	do
 	{
-		pDnsMsg = tls_mem_alloc(P->tot_len);
-		if(pDnsMsg == NULL)
+		if(P->tot_len < (DNS_HEADER_LEN + 1 + sizeof(DNS_QUERY)))
 		{
 			break;
 		}
-		pbuf_copy_partial(P, pDnsMsg, P->tot_len, 0);
-		
-		pDnsHeader = (PDNS_HEADER)pDnsMsg;
 
-		/* Get the quention number and answer number. */
-		//nQuestions = ntohs(pDnsHeader->Quentions);
-		//nAnswers = ntohs(pDnsHeader->AnswerRR);
+		/* Queries nearly always come in one pbuf, read them in place. */
+		if(P->len == P->tot_len)
+		{
+			pDnsHeader = (PDNS_HEADER)P->payload;
+		}
+		else
+		{
+			pDnsMsg = tls_mem_alloc(P->tot_len);
+			if(pDnsMsg == NULL)
+			{
+				break;
+			}
+			pbuf_copy_partial(P, pDnsMsg, P->tot_len, 0);
+			pDnsHeader = (PDNS_HEADER)pDnsMsg;
+		}
 
 		/* Filter out the response frame and the unstandard query frame. */
-		if((pDnsHeader->DnsFlag1 & DNS_FLAG1_RESPONSE) || ((pDnsHeader->DnsFlag1 & (0xf << 3)) != DNS_FLAG1_OPCODE_STANDARD))
+		if((pDnsHeader->DnsFlag1 & DNS_FLAG1_RESPONSE) || ((pDnsHeader->DnsFlag1 & (0xf << 3)) != DNS_FLAG1_OPCODE_STANDARD) ||
+		   (pDnsHeader->Quentions != htons(1)))
 		{
 			break;
 		}
 
 		/* Locate the dns name. */
 		pDnsName = (INT8U *)(pDnsHeader + 1);
+		NameLen = _DnsNameLen(pDnsName, P->tot_len - DNS_HEADER_LEN - sizeof(DNS_QUERY));
+		if(NameLen == 0)
+		{
+			break;
+		}
 
 		/* Get the query class and type. */
-		MEMCPY(&DnsQuery, (pDnsName + strlen((const char *)pDnsName) + 1), sizeof(DnsQuery));
+		MEMCPY(&DnsQuery, pDnsName + NameLen, sizeof(DnsQuery));
+
+		/* Check the query class. */
+		if(DnsQuery.Class != htons(DNS_RRCLASS_IN))
+		{
+			break;
+		}
 
-		/* Check the query class and type. */
-		if((DnsQuery.Class != htons(DNS_RRCLASS_IN)) && (DnsQuery.Type != htons(DNS_RRTYPE_A)))
+		Entry = _DnsFindName(pDnsName, NameLen);
+		if(Entry != NULL)
 		{
+			if(DnsQuery.Type != htons(DNS_RRTYPE_A))
+			{
+				/* My dns name has no such record, the client asks for A right away. */
+				_DNSReplyGenAndSend(Addr, Port, pDnsName, NameLen + sizeof(DNS_QUERY), pDnsHeader->TansactionId, DNS_FLAG2_ERR_NONE, NULL);
+			}
+			else if(Entry->Wild || memcmp(Entry->Name, pDnsName, NameLen))
+			{
+				/* The question is echoed as asked, the case may differ from mine. */
+				_DNSReplyGenAndSend(Addr, Port, pDnsName, NameLen + sizeof(DNS_QUERY), pDnsHeader->TansactionId, DNS_FLAG2_ERR_NONE, DnsServer.Answer);
+			}
+			else
+			{
+				/* My dns name, so send the answer to the client. */
+				_DNSPrebuiltSend(Addr, Port, Entry->Resp, Entry->RespLen, pDnsHeader->TansactionId);
+			}
 			break;
 		}
 
-		if(_DnsCompareName(DnsServer.DnsName, pDnsName) != 0)
+		netif = tls_get_netif();
+		if(!netif_is_up(netif))
 		{
 			/* Not my dns name, so notify the client name error. */
-#if TLS_CONFIG_AP
-            struct netif *netif = tls_get_netif();
-            if (!netif_is_up(netif))
-#endif
-			_DNSNameErrGenAndSend(Addr, Port, &DnsQuery, pDnsName, pDnsHeader->TansactionId);
+			_DNSReplyGenAndSend(Addr, Port, pDnsName, NameLen + sizeof(DNS_QUERY), pDnsHeader->TansactionId, DNS_FLAG2_ERR_NAME, NULL);
+			break;
+		}
+
+#if TLS_CONFIG_DNSS_FORWARD
+		/* The station is connected, resolve the name upstream. */
+		Cache = _DnsCacheFind(pDnsName, NameLen + sizeof(DNS_QUERY));
+		if(Cache != NULL)
+		{
+			_DNSPrebuiltSend(Addr, Port, Cache->Resp, Cache->Len, pDnsHeader->TansactionId);
 		}
 		else
 		{
-			/* My dns name, so send the answer to the client. */
-			_DNSAnswerGenAndSend(Addr, Port, &DnsQuery, pDnsName, pDnsHeader->TansactionId);
+			_DnsForward((const INT8U *)pDnsHeader, P->tot_len, NameLen + sizeof(DNS_QUERY), Addr, Port);
 		}
+#endif
 	}while(0);
 
 	if(pDnsMsg)
@@ -301,21 +746,116 @@ void DNSS_RecvCb(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Addr
 			DNSS_ERR_PARAM - Input parameter error
 	Note:	
 		The length of the DNS name must be less than 32.
+		"*" answers every name, "*.wm.com" every name below wm.com.
 -------------------------------------------------------------------------*/
 INT8S DNSS_Config(INT8U * DnsName)
 {
-	if((DnsName == NULL) || (strlen((const char *)DnsName) > 32))
+	DNSS_NAME New;
+
+	if(_DnsParseName(DnsName, &New) != DNSS_ERR_SUCCESS)
 	{
-		/* The length of the DNS name must be less than 32. */
 		return DNSS_ERR_PARAM;
 	}
 
-	memset(DnsServer.DnsName, 0, 32);
-	MEMCPY(DnsServer.DnsName, DnsName, strlen((const char *)DnsName));
+	_DnsStoreName(&DnsServer.Names[0], &New);
 
 	return DNSS_ERR_SUCCESS;
 }
 
+/*   DNSS_AddName   */
+/*-------------------------------------------------------------------------
+	Description:
+		This function is used to answer one more dns name with the server's address.
+	Arguments:
+		DnsName	: Pointer the dns name, "*" or "*.wm.com" for a wildcard.
+
+	Return Value:
+		The DNS Server error code:
+			DNSS_ERR_SUCCESS - No error
+			DNSS_ERR_PARAM - Input parameter error
+			DNSS_ERR_MEM - The name table is full
+	Note:
+		The names are kept when the server is stopped and started again.
+-------------------------------------------------------------------------*/
+INT8S DNSS_AddName(INT8U * DnsName)
+{
+	DNSS_NAME New;
+	DNSS_NAME * Entry;
+	DNSS_NAME * Free = NULL;
+	INT32U i;
+
+	if(_DnsParseName(DnsName, &New) != DNSS_ERR_SUCCESS)
+	{
+		return DNSS_ERR_PARAM;
+	}
+
+	/* Entry 0 belongs to DNSS_Start and DNSS_Config. */
+	for(i = 1; i < DNSS_NAME_NUM; i++)
+	{
+		Entry = &DnsServer.Names[i];
+		if(Entry->NameLen == 0)
+		{
+			if(Free == NULL)
+			{
+				Free = Entry;
+			}
+		}
+		else if((Entry->NameLen == New.NameLen) && (Entry->Wild == New.Wild) &&
+		        (memcmp(Entry->Name, New.Name, New.NameLen) == 0))
+		{
+			return DNSS_ERR_SUCCESS;
+		}
+	}
+
+	if(Free == NULL)
+	{
+		return DNSS_ERR_MEM;
+	}
+
+	_DnsStoreName(Free, &New);
+
+	return DNSS_ERR_SUCCESS;
+}
+
+/*   DNSS_DelName   */
+/*-------------------------------------------------------------------------
+	Description:
+		This function is used to remove a dns name added by DNSS_AddName.
+	Arguments:
+		DnsName	: Pointer the dns name as it was added.
+
+	Return Value:
+		The DNS Server error code:
+			DNSS_ERR_SUCCESS - No error
+			DNSS_ERR_PARAM - Input parameter error or unknown name
+	Note:
+
+-------------------------------------------------------------------------*/
+INT8S DNSS_DelName(INT8U * DnsName)
+{
+	DNSS_NAME Del;
+	DNSS_NAME * Entry;
+	INT32U i;
+
+	if(_DnsParseName(DnsName, &Del) != DNSS_ERR_SUCCESS)
+	{
+		return DNSS_ERR_PARAM;
+	}
+
+	for(i = 1; i < DNSS_NAME_NUM; i++)
+	{
+		Entry = &DnsServer.Names[i];
+		if((Entry->NameLen == Del.NameLen) && (Entry->Wild == Del.Wild) &&
+		   (memcmp(Entry->Name, Del.Name, Del.NameLen) == 0))
+		{
+			_DnsStoreName(Entry, NULL);
+			return DNSS_ERR_SUCCESS;
+		}
+	}
+
+	return DNSS_ERR_PARAM;
+}
+
 /*   DNSS_Start   */
 /*-------------------------------------------------------------------------
 	Description:	
@@ -335,20 +875,29 @@ INT8S DNSS_Config(INT8U * DnsName)
 -------------------------------------------------------------------------*/
 INT8S DNSS_Start(struct netif *Netif, INT8U * DnsName)
 {
-	if((Netif == NULL) || (strlen((const char *)DnsName) > 32))
+	DNSS_NAME New;
+	INT32U i;
+
+	if((Netif == NULL) || (_DnsParseName(DnsName, &New) != DNSS_ERR_SUCCESS))
 	{
 		return DNSS_ERR_PARAM;
 	}
-	
+
 	if(netif_is_up(Netif) == 0)
 	{
 		return DNSS_ERR_LINKDOWN;
 	}
-	
-	memset(&DnsServer, 0, sizeof(DnsServer));
 
-	MEMCPY(DnsServer.DnsName, DnsName, strlen((const char *)DnsName));
+	DNSS_Stop();
+
+	/* The replies carry the address, build them again for this one. */
 	ip_addr_set(&DnsServer.HostIp, &Netif->ip_addr);
+	_DnsBuildAnswer();
+	_DnsStoreName(&DnsServer.Names[0], &New);
+	for(i = 1; i < DNSS_NAME_NUM; i++)
+	{
+		_DnsBuildResp(&DnsServer.Names[i]);
+	}
 
 	DnsServer.Socket = udp_new();
 	if(DnsServer.Socket == NULL)
@@ -362,6 +911,16 @@ INT8S DNSS_Start(struct netif *Netif, INT8U * DnsName)
 	/* Set up the recv callback and argument. */
 	udp_recv(DnsServer.Socket, (udp_recv_fn)DNSS_RecvCb, Netif);
 
+#if TLS_CONFIG_DNSS_FORWARD
+	/* Without it the server only answers its own names. */
+	DnsServer.Upstream = udp_new();
+	if(DnsServer.Upstream != NULL)
+	{
+		udp_bind(DnsServer.Upstream, IP_ADDR_ANY, 0);
+		udp_recv(DnsServer.Upstream, _DnsUpstreamRecv, NULL);
+	}
+#endif
+
 	return DNSS_ERR_SUCCESS;
 }
 
@@ -380,7 +939,28 @@ INT8S DNSS_Start(struct netif *Netif, INT8U * DnsName)
 -------------------------------------------------------------------------*/
 void DNSS_Stop(void)
 {
-	if(DnsServer.Socket) udp_remove(DnsServer.Socket);
+#if TLS_CONFIG_DNSS_FORWARD
+	INT32U i;
+#endif
+
+	if(DnsServer.Socket)
+	{
+		udp_remove(DnsServer.Socket);
+		DnsServer.Socket = NULL;
+	}
+
+#if TLS_CONFIG_DNSS_FORWARD
+	if(DnsServer.Upstream)
+	{
+		udp_remove(DnsServer.Upstream);
+		DnsServer.Upstream = NULL;
+	}
+	memset(DnsServer.Fwd, 0, sizeof(DnsServer.Fwd));
+	for(i = 0; i < DNSS_CACHE_NUM; i++)
+	{
+		_DnsCacheFree(&DnsServer.Cache[i]);
+	}
+#endif
 }
 #endif
 
@@ -62,6 +62,26 @@
 
 #define DNS_NAME_OFFSET      0xC000
 
+#define DNS_HEADER_LEN      12
+/* Name pointer, type, class, ttl, length and the address of an A record. */
+#define DNS_ANSWER_A_LEN      16
+
+/* Names answered with the server's address, entry 0 is the one given to DNSS_Start. */
+#define DNSS_NAME_NUM      4
+/* Longest name in wire format: 32 characters, the first length and the root. */
+#define DNSS_NAME_LEN      34
+#define DNSS_RESP_LEN      (((DNS_HEADER_LEN + DNSS_NAME_LEN + 4 + DNS_ANSWER_A_LEN) + 3) & ~3)
+
+#if TLS_CONFIG_DNSS_FORWARD
+/* Queries waiting for the upstream server. */
+#define DNSS_FWD_NUM      8
+#define DNSS_FWD_TIMEOUT      5 /* seconds. */
+/* Upstream answers kept, each for its smallest TTL but not longer than DNSS_CACHE_TTL_MAX. */
+#define DNSS_CACHE_NUM      8
+#define DNSS_CACHE_LEN      512
+#define DNSS_CACHE_TTL_MAX      60 /* seconds. */
+#endif
+
 #ifdef INT8U
 #undef INT8U
 #endif
@@ -87,12 +107,57 @@ typedef unsigned int INT32U;
 #endif
 typedef signed int INT32S;
 
+typedef struct __DNSS_NAME
+{
+	/* Prebuilt answer, only the transaction id is patched before sending. */
+	INT8U Resp[DNSS_RESP_LEN];
+	INT16U RespLen;
+	/* Lower case wire format, for a wildcard the part after "*". */
+	INT8U Name[DNSS_NAME_LEN];
+	INT8U NameLen;
+	INT8U Wild;
+}DNSS_NAME;
+
+#if TLS_CONFIG_DNSS_FORWARD
+typedef struct __DNSS_FWD
+{
+	ip_addr_t Addr;
+	/* The upstream server the query went to, only its reply is taken. */
+	ip_addr_t Server;
+	INT32U Time;
+	/* Hash and length of the question, the reply must carry the same. */
+	INT32U QuestionHash;
+	INT16U QuestionLen;
+	INT16U Port;
+	INT16U TansactionId;
+	INT16U FwdId;
+	INT8U Used;
+}DNSS_FWD;
+
+typedef struct __DNSS_CACHE
+{
+	INT8U * Resp;
+	INT32U Expire;
+	INT16U Len;
+	/* Length of the question, it starts right after the header. */
+	INT16U QuestionLen;
+}DNSS_CACHE;
+#endif
+
 typedef struct __DNS_SERVER
 {
 	struct udp_pcb * Socket;
-	INT8U DnsName[32];
+	DNSS_NAME Names[DNSS_NAME_NUM];
+	/* Answer record of the wildcard names, it points at the question. */
+	INT8U Answer[DNS_ANSWER_A_LEN];
 	/* Attention!!! MUST BE __align(4) */
 	ip_addr_t HostIp;
+#if TLS_CONFIG_DNSS_FORWARD
+	struct udp_pcb * Upstream;
+	INT16U FwdId;
+	DNSS_FWD Fwd[DNSS_FWD_NUM];
+	DNSS_CACHE Cache[DNSS_CACHE_NUM];
+#endif
 }DNS_SERVER;
 
 typedef struct __DNS_HEADER
@@ -121,6 +186,8 @@ typedef struct __DNS_ANSWER
 
 void DNSS_RecvCb(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Addr, INT16U Port);
 INT8S DNSS_Config(INT8U * DnsName);
+INT8S DNSS_AddName(INT8U * DnsName);
+INT8S DNSS_DelName(INT8U * DnsName);
 INT8S DNSS_Start(struct netif *Netif, INT8U * DnsName);
 void DNSS_Stop(void);
 #endif
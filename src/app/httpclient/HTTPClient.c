@@ -23,8 +23,29 @@
 #include "HTTPClientString.h"   // String utilities
 #include "wm_mem.h"
 #include "wm_debug.h"
+#include "wm_osal.h"
 
 #if TLS_CONFIG_HTTP_CLIENT
+
+static HTTP_CLIENT_STATS HttpStats;             // Request latency of all sessions
+
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+// An idle keep-alive connection, kept for the next request to the same host
+typedef struct _HTTP_POOL_CONN
+{
+    BOOL                InUse;
+    BOOL                Secure;                 // TLS connection
+    INT32               HttpSocket;
+    UINT16              nPort;
+    UINT32              nExpire;                // Up time at which the connection is closed
+    CHAR                Host[HTTP_CLIENT_POOL_HOST_LENGTH];
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+    tls_ssl_t           *ssl;                   // The established TLS session
+#endif
+} HTTP_POOL_CONN;
+
+static HTTP_POOL_CONN HttpPool[HTTP_CLIENT_POOL_SIZE];
+#endif //TLS_CONFIG_HTTP_CLIENT_POOL
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Function     : HTTPClientSetLocalConnection
@@ -176,6 +197,13 @@ UINT32 HTTPClientCloseRequest (HTTP_SESSION_HANDLE *pSession)
         tls_mem_free(pHTTPSession->HttpHeaders.HeadersBuffer.pParam);
 		pHTTPSession->HttpHeaders.HeadersBuffer.pParam = NULL;
     }
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+    // Keep the connection for the next request if the server allows it
+    if(HTTPIntrnPoolPut(pHTTPSession) == TRUE)
+    {
+        pHTTPSession->HttpConnection.HttpSocket = HTTP_INVALID_SOCKET;
+    }
+#endif //TLS_CONFIG_HTTP_CLIENT_POOL
     // Close any active socket connection
     HTTPIntrnConnectionClose(pHTTPSession);
     // free the session structure
@@ -672,8 +700,8 @@ UINT32 HTTPClientSendRequest (HTTP_SESSION_HANDLE pSession,
             nRetCode = HTTP_CLIENT_ERROR_SOCKET_TIME_OUT;
             break;
         }
-        //  Handle connection close message (reconnect)
-        if(pHTTPSession->HttpHeadersInfo.Connection == FALSE)
+        //  Handle connection close message (reconnect), or a previous response that was not read to its end
+        if(pHTTPSession->HttpHeadersInfo.Connection == FALSE || pHTTPSession->HttpTiming.BodyDone == FALSE)
         {
             // Gracefully close the connection and set the socket as invalid
             if(pHTTPSession->HttpConnection.HttpSocket != HTTP_INVALID_SOCKET)
@@ -687,6 +715,8 @@ UINT32 HTTPClientSendRequest (HTTP_SESSION_HANDLE pSession,
                 break;
             }
         }
+        memset(&pHTTPSession->HttpTiming,0x00,sizeof(HTTP_TIMING));
+        pHTTPSession->HttpTiming.nSendStart = HTTPIntrnSessionGetUpTime();
 
 #if TLS_CONFIG_HTTP_CLIENT_AUTH
         // Send the request along with the rest of the headers
@@ -751,7 +781,21 @@ UINT32 HTTPClientSendRequest (HTTP_SESSION_HANDLE pSession,
 #endif //TLS_CONFIG_HTTP_CLIENT_AUTH
         {
             // No authentication use the verb that was requested by the caller
-            if((nRetCode = HTTPIntrnHeadersSend(pHTTPSession,pHTTPSession->HttpHeaders.HttpVerb)) != HTTP_CLIENT_SUCCESS)
+            nRetCode = HTTPIntrnHeadersSend(pHTTPSession,pHTTPSession->HttpHeaders.HttpVerb);
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+            // The server may have dropped a pooled connection meanwhile, try the next one or a new connection
+            while(nRetCode != HTTP_CLIENT_SUCCESS && pHTTPSession->HttpConnection.Reused == TRUE)
+            {
+                HTTPIntrnConnectionClose(pHTTPSession);
+                if((nRetCode = HTTPIntrnConnectionOpen(pHTTPSession)) != HTTP_CLIENT_SUCCESS)
+                {
+                    break;
+                }
+                pHTTPSession->HttpTiming.nSendStart = HTTPIntrnSessionGetUpTime();
+                nRetCode = HTTPIntrnHeadersSend(pHTTPSession,pHTTPSession->HttpHeaders.HttpVerb);
+            }
+#endif //TLS_CONFIG_HTTP_CLIENT_POOL
+            if(nRetCode != HTTP_CLIENT_SUCCESS)
             {
                 break;
             }
@@ -772,6 +816,8 @@ UINT32 HTTPClientSendRequest (HTTP_SESSION_HANDLE pSession,
             pHTTPSession->HttpState = pHTTPSession->HttpState | HTTP_CLIENT_STATE_POST_SENT;
         }
         
+        HTTPIntrnStatsAdd(&HttpStats.Send,pHTTPSession->HttpTiming.nSendStart);
+        pHTTPSession->HttpTiming.nSendEnd = HTTPIntrnSessionGetUpTime();
     }while(0);
     
     
@@ -795,6 +841,7 @@ UINT32 HTTPClientRecvResponse (HTTP_SESSION_HANDLE pSession,
     
     UINT32          nRetCode;               // Function return code
     P_HTTP_SESSION  pHTTPSession = NULL;    // Session pointer
+    u32             cpu_sr;
     
     
     // Cast the handle to our internal structure and check the pointers validity
@@ -810,6 +857,15 @@ UINT32 HTTPClientRecvResponse (HTTP_SESSION_HANDLE pSession,
         {
             break;
         }
+        HTTPIntrnStatsAdd(&HttpStats.Wait,pHTTPSession->HttpTiming.nSendEnd);
+        pHTTPSession->HttpTiming.nHeadersTime = HTTPIntrnSessionGetUpTime();
+        cpu_sr = tls_os_set_critical();
+        HttpStats.nRequests++;
+        if(pHTTPSession->HttpConnection.Reused == TRUE)
+        {
+            HttpStats.nReused++;
+        }
+        tls_os_release_critical(cpu_sr);
     } while(0);
     
     return nRetCode;
@@ -925,141 +981,129 @@ UINT32 HTTPClientWriteData (HTTP_SESSION_HANDLE pSession,
 // Last updated : 01/09/2005
 //
 ///////////////////////////////////////////////////////////////////////////////
-                            
-                            UINT32 HTTPClientReadData (HTTP_SESSION_HANDLE pSession,
-                                VOID *pBuffer,           // [IN OUT] a pointer to a buffer that will be filled with the servers response
-                                UINT32 nBytesToRead,     // [IN]     The size of the buffer (numbers of bytes to read)
-                                UINT32 nTimeout,         // [IN]     operation timeout in seconds
-                                UINT32 *nBytesRecived)   // [OUT]    Count of the bytes that ware received in this operation
-                            {
-                                
-                                UINT32          nBytes          = 0;
-                                UINT32          nRetCode        = 0 ;
-                                INT32           nProjectedBytes = 0; // Should support negative numbers
-                                CHAR            *pNullPtr;
-                                BOOL            EndOfStream = FALSE;
-                                
-                                P_HTTP_SESSION  pHTTPSession = NULL;
-                                
-                                // Cast the handle to our internal structure and check the pointers validity
-                                pHTTPSession = (P_HTTP_SESSION)pSession;
-                                if(!pHTTPSession)
-                                {
-                                    return HTTP_CLIENT_ERROR_INVALID_HANDLE;
-                                }
-                                
-                                // If the last verb that was used was HEAD there is no point to get this data (chanses are that we will endup with timeout)
-                                if(pHTTPSession->HttpHeaders.HttpVerb == VerbHead)
-                                {
-                                    return HTTP_CLIENT_EOS;
-                                    
-                                }
-                                
-                                // Set the operation timeout counters
-                                pHTTPSession->HttpCounters.nActionStartTime = HTTPIntrnSessionGetUpTime();
-                                pHTTPSession->HttpCounters.nActionTimeout = HTTP_TIMEOUT(nTimeout);
-                                
-                                
-                                nBytes              = nBytesToRead - 1; // We will spare 1 byte for the trailing null termination
-                                *((CHAR*)pBuffer)   = 0;                // Null terminate the user supplied buffer
-                                *(nBytesRecived)    = 0;                // Set the return bytes count to 0
-                                
-                                // We can read the data only if we got valid headers (and not authentication requests for example)
-                                if((pHTTPSession->HttpState & HTTP_CLIENT_STATE_HEADERS_PARSED) != HTTP_CLIENT_STATE_HEADERS_PARSED)
-                                {
-                                    return HTTP_CLIENT_ERROR_BAD_STATE;
-                                }
-                                
-                                // Is it a chunked mode transfer?
-                                if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_CHUNKED) == HTTP_CLIENT_FLAG_CHUNKED)
-                                {
-                                    
-                                    // How many bytes left until the next chunk?
-                                    if(pHTTPSession->HttpCounters.nBytesToNextChunk == 0)
-                                    {
-                                        // Read the chunk header and get its length
-                                        if(HTTPIntrnGetRemoteChunkLength(pHTTPSession) != HTTP_CLIENT_SUCCESS)
-                                        {
-                                            // Could not parse the chunk parameter
-                                            return HTTP_CLIENT_ERROR_CHUNK;
-                                        }
-                                        
-                                        // 0 Bytes chunk, we should return end of stream
-                                        if(pHTTPSession->HttpCounters.nRecivedChunkLength == 0)
-                                        {
-                                            return HTTP_CLIENT_EOS;
-                                        }
-                                    }
-                                    // If we are about to read pass the next chunk, reduce the read bytes so we will read
-                                    // non HTML data
-                                    nProjectedBytes = pHTTPSession->HttpCounters.nBytesToNextChunk - nBytes;
-                                    if ( nProjectedBytes <= 0)
-                                    {
-                                        // Set the correct bytes count we should read
-                                        nBytes  = pHTTPSession->HttpCounters.nBytesToNextChunk;
-                                    }
-                                }
-                                
-                                // Do we have the content length?
-                                if(pHTTPSession->HttpHeadersInfo.nHTTPContentLength > 0)
-                                {
-                                    // Length of the projected buffer 
-                                    nProjectedBytes = pHTTPSession->HttpCounters.nRecivedBodyLength +  nBytes;
-                                    // If we are going to read more then the known content length then..
-                                    if(nProjectedBytes >= (INT32)pHTTPSession->HttpHeadersInfo.nHTTPContentLength)
-                                    {
-                                        // Reduce the received bytes count to the correct size
-                                        nBytes = pHTTPSession->HttpHeadersInfo.nHTTPContentLength - pHTTPSession->HttpCounters.nRecivedBodyLength;
-                                        
-                                    }
-                                }
-                                // Receive the data from the socket
-                                nRetCode = HTTPIntrnRecv(pHTTPSession,(CHAR*)pBuffer,&nBytes,FALSE);
-                                // Set the return bytes count
-                                *(nBytesRecived) = nBytes;   // + 1; Fixed 11/9/2005
-                                
-                                // Pointer to the end of the buffer
-                                pNullPtr    = (CHAR*)pBuffer + nBytes ;   
-                                // And null terminate   
-                                *pNullPtr = 0;
-                                
-                                // Socket read went OK
-                                if(nRetCode == HTTP_CLIENT_SUCCESS)
-                                {
-                                    
-#ifdef _HTTP_DEBUGGING_
-                                    if(pHTTPSession->pDebug)
-                                    {
-                                        pHTTPSession->pDebug("HTTPClientReadData",NULL,0,"Reading %d bytes",nBytes);
-                                    }
-#endif
-                                    // Set the HTTP counters
-                                    pHTTPSession->HttpCounters.nRecivedBodyLength += nBytes;
-                                    // If we know the total content length and..
-                                    if(pHTTPSession->HttpHeadersInfo.nHTTPContentLength > 0)
-                                    {
-                                        // If total received body is equal or greater then the known content length then..
-                                        if( pHTTPSession->HttpCounters.nRecivedBodyLength >= pHTTPSession->HttpHeadersInfo.nHTTPContentLength)
-                                        {           
-                                            // Raise a flag to signal end of stream
-                                            EndOfStream = TRUE;
-                                        }
-                                    }
-                                    // Is it a chunked mode transfer?
-                                    if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_CHUNKED) == HTTP_CLIENT_FLAG_CHUNKED)
-                                    {
-                                        // We are a little closer to the next chunk now
-                                        pHTTPSession->HttpCounters.nBytesToNextChunk -= nBytes;
-                                    }
-                                    // Is it End of stream?
-                                    if(EndOfStream == TRUE)
-                                    {
-                                        // So exit
-                                        return HTTP_CLIENT_EOS;
-                                    }
-                                }
-                                
-                                return nRetCode ;
+
+UINT32 HTTPClientReadData (HTTP_SESSION_HANDLE pSession,
+                           VOID *pBuffer,           // [IN OUT] a pointer to a buffer that will be filled with the servers response
+                           UINT32 nBytesToRead,     // [IN]     The size of the buffer (numbers of bytes to read)
+                           UINT32 nTimeout,         // [IN]     operation timeout in seconds
+                           UINT32 *nBytesRecived)   // [OUT]    Count of the bytes that ware received in this operation
+{
+    
+    UINT32          nBytes          = 0;
+    UINT32          nRetCode        = 0 ;
+    
+    P_HTTP_SESSION  pHTTPSession = NULL;
+    
+    // Cast the handle to our internal structure and check the pointers validity
+    pHTTPSession = (P_HTTP_SESSION)pSession;
+    if(!pHTTPSession)
+    {
+        return HTTP_CLIENT_ERROR_INVALID_HANDLE;
+    }
+    
+    // If the last verb that was used was HEAD there is no point to get this data (chanses are that we will endup with timeout)
+    if(pHTTPSession->HttpHeaders.HttpVerb == VerbHead)
+    {
+        return HTTP_CLIENT_EOS;
+        
+    }
+    
+    // Set the operation timeout counters
+    pHTTPSession->HttpCounters.nActionStartTime = HTTPIntrnSessionGetUpTime();
+    pHTTPSession->HttpCounters.nActionTimeout = HTTP_TIMEOUT(nTimeout);
+    
+    
+    nBytes              = nBytesToRead - 1; // We will spare 1 byte for the trailing null termination
+    *((CHAR*)pBuffer)   = 0;                // Null terminate the user supplied buffer
+    *(nBytesRecived)    = 0;                // Set the return bytes count to 0
+    
+    nRetCode = HTTPIntrnReadBody(pHTTPSession,(CHAR*)pBuffer,&nBytes);
+    // Set the return bytes count
+    *(nBytesRecived) = nBytes;   // + 1; Fixed 11/9/2005
+    // And null terminate   
+    *((CHAR*)pBuffer + nBytes) = 0;
+    
+    return nRetCode ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPClientReadDataStream
+// Purpose      : Read the whole body and hand it to pfnBody as it arrives, the
+//                chunks framing already removed. pBuffer is filled up before
+//                each call, a pfnBody result other than HTTP_CLIENT_SUCCESS
+//                stops the transfer and is returned. Nothing is read from the
+//                socket while pfnBody runs, so a slow consumer closes the TCP
+//                window instead of needing a second buffer.
+// Returns      : HTTP_CLIENT_EOS when the body is complete, or HTTP Status
+// Last updated : 19/10/2026
+//
+///////////////////////////////////////////////////////////////////////////////
+
+UINT32 HTTPClientReadDataStream (HTTP_SESSION_HANDLE pSession,
+                                 VOID *pBuffer,           // [IN]  the segment buffer
+                                 UINT32 nBufferSize,      // [IN]  size of the segment buffer
+                                 UINT32 nTimeout,         // [IN]  timeout in seconds, for each socket read
+                                 HTTP_CLIENT_BODY_CB pfnBody, // [IN] consumer of the body
+                                 VOID *pArg,              // [IN]  passed to pfnBody
+                                 UINT32 *nBytesRecived)   // [OUT] total body bytes handed to pfnBody
+{
+    UINT32          nBytes;
+    UINT32          nFilled     = 0;
+    UINT32          nRetCode    = HTTP_CLIENT_SUCCESS;
+    UINT32          nCbRetCode;
+    P_HTTP_SESSION  pHTTPSession = NULL;
+    
+    // Cast the handle to our internal structure and check the pointers validity
+    pHTTPSession = (P_HTTP_SESSION)pSession;
+    if(!pHTTPSession)
+    {
+        return HTTP_CLIENT_ERROR_INVALID_HANDLE;
+    }
+    if(!pBuffer || !nBufferSize || !pfnBody)
+    {
+        return HTTP_CLIENT_ERROR_LONG_INPUT;
+    }
+    if(nBytesRecived)
+    {
+        *(nBytesRecived) = 0;
+    }
+    if(pHTTPSession->HttpHeaders.HttpVerb == VerbHead)
+    {
+        return HTTP_CLIENT_EOS;
+    }
+    
+    while(nRetCode == HTTP_CLIENT_SUCCESS)
+    {
+        // Each socket read gets the full timeout
+        pHTTPSession->HttpCounters.nActionStartTime = HTTPIntrnSessionGetUpTime();
+        pHTTPSession->HttpCounters.nActionTimeout = HTTP_TIMEOUT(nTimeout);
+        
+        nBytes = nBufferSize - nFilled;
+        nRetCode = HTTPIntrnReadBody(pHTTPSession,(CHAR*)pBuffer + nFilled,&nBytes);
+        if(nRetCode != HTTP_CLIENT_SUCCESS && nRetCode != HTTP_CLIENT_EOS)
+        {
+            break;
+        }
+        nFilled += nBytes;
+        
+        // Hand over a full buffer, or what is left at the end of the body
+        if(nFilled == nBufferSize || (nRetCode == HTTP_CLIENT_EOS && nFilled > 0))
+        {
+            nCbRetCode = pfnBody(pArg,(CHAR*)pBuffer,nFilled);
+            if(nBytesRecived)
+            {
+                *(nBytesRecived) += nFilled;
+            }
+            nFilled = 0;
+            if(nCbRetCode != HTTP_CLIENT_SUCCESS)
+            {
+                nRetCode = nCbRetCode;
+            }
+        }
+    }
+    
+    return nRetCode;
 }
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -1094,6 +1138,27 @@ UINT32 HTTPClientGetInfo (HTTP_SESSION_HANDLE pSession, HTTP_CLIENT *HTTPClient)
     
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPClientGetStats
+// Purpose      : Copy (and optionally clear) the request latency statistics
+// Returns      : void
+//
+///////////////////////////////////////////////////////////////////////////////
+
+VOID HTTPClientGetStats (HTTP_CLIENT_STATS *pStats, BOOL bReset)
+{
+    u32 cpu_sr;
+    
+    cpu_sr = tls_os_set_critical();
+    memcpy(pStats,&HttpStats,sizeof(HTTP_CLIENT_STATS));
+    if(bReset == TRUE)
+    {
+        memset(&HttpStats,0x00,sizeof(HTTP_CLIENT_STATS));
+    }
+    tls_os_release_critical(cpu_sr);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Function     : HTTPClientFindFirstHeader
@@ -1617,6 +1682,293 @@ static UINT32 HTTPIntrnHeadersAdd (P_HTTP_SESSION pHTTPSession,
     return HTTP_CLIENT_SUCCESS; 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnStatsAdd
+// Purpose      : Account the time since nStart to a request phase
+// Returns      : void
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static VOID HTTPIntrnStatsAdd (HTTP_CLIENT_PHASE *pPhase, UINT32 nStart)
+{
+    UINT32 nTime = HTTPIntrnSessionGetUpTime() - nStart;
+    u32    cpu_sr;
+    
+    cpu_sr = tls_os_set_critical();
+    pPhase->nCount++;
+    pPhase->nTotal += nTime;
+    if(nTime > pPhase->nMax)
+    {
+        pPhase->nMax = nTime;
+    }
+    tls_os_release_critical(cpu_sr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnBodyDone
+// Purpose      : The whole response body was read, the connection is at the
+//                start of the next response and can be reused
+// Returns      : void
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static VOID HTTPIntrnBodyDone (P_HTTP_SESSION pHTTPSession)
+{
+    if(pHTTPSession->HttpTiming.BodyDone == FALSE)
+    {
+        pHTTPSession->HttpTiming.BodyDone = TRUE;
+        HTTPIntrnStatsAdd(&HttpStats.Body,pHTTPSession->HttpTiming.nHeadersTime);
+    }
+}
+
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnPoolHostLength
+// Purpose      : Length of the host name within the URL (without the port)
+// Returns      : Length in bytes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static UINT32 HTTPIntrnPoolHostLength (P_HTTP_SESSION pHTTPSession)
+{
+    if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_URLANDPORT) == HTTP_CLIENT_FLAG_URLANDPORT)
+    {
+        return pHTTPSession->HttpUrl.UrlHost.nLength - pHTTPSession->HttpUrl.UrlPort.nLength - 1;
+    }
+    return pHTTPSession->HttpUrl.UrlHost.nLength;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnPoolClose
+// Purpose      : Close a connection that was taken out of the pool
+// Returns      : void
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static VOID HTTPIntrnPoolClose (HTTP_POOL_CONN *pConn)
+{
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+    if(pConn->Secure == TRUE)
+    {
+        HTTPWrapperSSLClose(pConn->ssl, pConn->HttpSocket);
+    }
+#endif //TLS_CONFIG_HTTP_CLIENT_SECURE
+    shutdown(pConn->HttpSocket,0x02);
+    closesocket(pConn->HttpSocket);
+    pConn->InUse = FALSE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnPoolGet
+// Purpose      : Take an idle connection to the session's host out of the pool.
+//                Expired connections and connections that became readable
+//                while idle (the server closed them) are dropped.
+// Returns      : TRUE if the session got a connection
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static BOOL HTTPIntrnPoolGet (P_HTTP_SESSION pHTTPSession)
+{
+    HTTP_POOL_CONN  Conn;
+    HTTP_TIMEVAL    Timeval = { 0, 0 };
+    fd_set          FDRead;
+    UINT32          nHostLength;
+    UINT32          i;
+    BOOL            Secure;
+    u32             cpu_sr;
+    
+    if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_USINGPROXY) == HTTP_CLIENT_FLAG_USINGPROXY)
+    {
+        return FALSE;
+    }
+    nHostLength = HTTPIntrnPoolHostLength(pHTTPSession);
+    if(nHostLength == 0 || nHostLength >= HTTP_CLIENT_POOL_HOST_LENGTH)
+    {
+        return FALSE;
+    }
+    Secure = ((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_SECURE) == HTTP_CLIENT_FLAG_SECURE);
+    
+    HTTPClientCloseIdle(FALSE);
+    while(1)
+    {
+        Conn.InUse = FALSE;
+        cpu_sr = tls_os_set_critical();
+        for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+        {
+            if(HttpPool[i].InUse == TRUE && HttpPool[i].Secure == Secure &&
+                HttpPool[i].nPort == pHTTPSession->HttpUrl.nPort &&
+                HTTPStrInsensitiveCompare(pHTTPSession->HttpUrl.UrlHost.pParam,HttpPool[i].Host,nHostLength) == TRUE)
+            {
+                Conn = HttpPool[i];
+                HttpPool[i].InUse = FALSE;
+                break;
+            }
+        }
+        tls_os_release_critical(cpu_sr);
+        if(Conn.InUse == FALSE)
+        {
+            return FALSE;
+        }
+        
+        // Nothing may be pending on an idle connection, a read event is the server's FIN
+        FD_ZERO(&FDRead);
+        FD_SET(Conn.HttpSocket, &FDRead);
+        if(select(Conn.HttpSocket + 1, &FDRead, 0, 0, &Timeval) != 0
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+            || (Secure == TRUE && HTTPWrapperSSLRecvPending(Conn.ssl) > 0)
+#endif //TLS_CONFIG_HTTP_CLIENT_SECURE
+            )
+        {
+            HTTPIntrnPoolClose(&Conn);
+            continue;
+        }
+        break;
+    }
+    
+    FD_ZERO(&pHTTPSession->HttpConnection.FDRead); 
+    FD_ZERO(&pHTTPSession->HttpConnection.FDWrite); 
+    FD_ZERO(&pHTTPSession->HttpConnection.FDError); 
+    FD_SET(Conn.HttpSocket, &pHTTPSession->HttpConnection.FDWrite);
+    pHTTPSession->HttpConnection.HttpSocket = Conn.HttpSocket;
+    pHTTPSession->HttpConnection.TlsNego    = TRUE;
+    pHTTPSession->HttpConnection.Reused     = TRUE;
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+    pHTTPSession->ssl           = Conn.ssl;
+    pHTTPSession->ssl_more_data = 0;
+#endif //TLS_CONFIG_HTTP_CLIENT_SECURE
+    return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnPoolPut
+// Purpose      : Keep the session's connection open for the next request to the
+//                same host. Only connections that read the complete response of
+//                a keep-alive server are kept. A full pool drops the connection
+//                that would expire first.
+// Returns      : TRUE if the connection was taken over by the pool
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static BOOL HTTPIntrnPoolPut (P_HTTP_SESSION pHTTPSession)
+{
+    HTTP_POOL_CONN  Conn;
+    HTTP_POOL_CONN  Victim;
+    UINT32          nHostLength;
+    UINT32          nIdle;
+    UINT32          i, nSlot;
+    u32             cpu_sr;
+    
+    if(pHTTPSession->HttpConnection.HttpSocket == HTTP_INVALID_SOCKET ||
+        pHTTPSession->HttpHeadersInfo.Connection == FALSE ||
+        pHTTPSession->HttpTiming.BodyDone == FALSE ||
+        (pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_USINGPROXY) == HTTP_CLIENT_FLAG_USINGPROXY)
+    {
+        return FALSE;
+    }
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+    if(pHTTPSession->ssl_more_data == SOCKET_SSL_MORE_DATA)
+    {
+        return FALSE;
+    }
+#endif //TLS_CONFIG_HTTP_CLIENT_SECURE
+    nHostLength = HTTPIntrnPoolHostLength(pHTTPSession);
+    if(nHostLength == 0 || nHostLength >= HTTP_CLIENT_POOL_HOST_LENGTH)
+    {
+        return FALSE;
+    }
+    // Leave a second of margin to the idle timeout the server announced
+    nIdle = HTTP_CLIENT_POOL_IDLE;
+    if(pHTTPSession->HttpHeadersInfo.nKeepAliveTimeout > 0 && pHTTPSession->HttpHeadersInfo.nKeepAliveTimeout <= nIdle)
+    {
+        nIdle = pHTTPSession->HttpHeadersInfo.nKeepAliveTimeout - 1;
+    }
+    if(nIdle == 0)
+    {
+        return FALSE;
+    }
+    
+    memset(&Conn,0x00,sizeof(HTTP_POOL_CONN));
+    Conn.InUse      = TRUE;
+    Conn.HttpSocket = pHTTPSession->HttpConnection.HttpSocket;
+    Conn.Secure     = ((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_SECURE) == HTTP_CLIENT_FLAG_SECURE);
+    Conn.nPort      = pHTTPSession->HttpUrl.nPort;
+    Conn.nExpire    = HTTPIntrnSessionGetUpTime() + nIdle * HZ;
+    memcpy(Conn.Host,pHTTPSession->HttpUrl.UrlHost.pParam,nHostLength);
+#if TLS_CONFIG_HTTP_CLIENT_SECURE
+    Conn.ssl        = pHTTPSession->ssl;
+#endif //TLS_CONFIG_HTTP_CLIENT_SECURE
+    
+    HTTPClientCloseIdle(FALSE);
+    Victim.InUse = FALSE;
+    cpu_sr = tls_os_set_critical();
+    nSlot = 0;
+    for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+    {
+        if(HttpPool[i].InUse == FALSE)
+        {
+            nSlot = i;
+            break;
+        }
+        if((INT32)(HttpPool[i].nExpire - HttpPool[nSlot].nExpire) < 0)
+        {
+            nSlot = i;
+        }
+    }
+    if(HttpPool[nSlot].InUse == TRUE)
+    {
+        Victim = HttpPool[nSlot];
+    }
+    HttpPool[nSlot] = Conn;
+    tls_os_release_critical(cpu_sr);
+    
+    if(Victim.InUse == TRUE)
+    {
+        HTTPIntrnPoolClose(&Victim);
+    }
+    return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPClientCloseIdle
+// Purpose      : Close the pooled connections whose idle time is over, or all
+//                of them (e.g. when the network went down)
+// Returns      : void
+//
+///////////////////////////////////////////////////////////////////////////////
+
+VOID HTTPClientCloseIdle (BOOL bAll)
+{
+    HTTP_POOL_CONN  Conn;
+    UINT32          nNow;
+    UINT32          i;
+    u32             cpu_sr;
+    
+    for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+    {
+        nNow = HTTPIntrnSessionGetUpTime();
+        Conn.InUse = FALSE;
+        cpu_sr = tls_os_set_critical();
+        if(HttpPool[i].InUse == TRUE && (bAll == TRUE || (INT32)(nNow - HttpPool[i].nExpire) >= 0))
+        {
+            Conn = HttpPool[i];
+            HttpPool[i].InUse = FALSE;
+        }
+        tls_os_release_critical(cpu_sr);
+        if(Conn.InUse == TRUE)
+        {
+            HTTPIntrnPoolClose(&Conn);
+        }
+    }
+}
+#endif //TLS_CONFIG_HTTP_CLIENT_POOL
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Function     : HTTPIntrnConnectionClose
@@ -1654,6 +2006,7 @@ UINT32 HTTPIntrnConnectionClose (P_HTTP_SESSION pHTTPSession)
             closesocket(pHTTPSession->HttpConnection.HttpSocket);
             // And invalidate the socket
             pHTTPSession->HttpConnection.HttpSocket = HTTP_INVALID_SOCKET;
+            pHTTPSession->HttpConnection.Reused = FALSE;
             
             break;;
         }
@@ -1694,6 +2047,7 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
     ULONG           Address = 0;
     HTTP_SOCKADDR_IN ServerAddress;                      // Socket address structure
     HTTP_SOCKADDR_IN LoaclAddress;                       // Socket address structure (for client binding)
+    UINT32           nStart;                             // Phase start time (statistics)
     do
     {
         
@@ -1709,6 +2063,14 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
             pHTTPSession->HttpState  = pHTTPSession->HttpState | HTTP_CLIENT_STATE_HOST_CONNECTED;
             return HTTP_CLIENT_SUCCESS;
         }
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+        // Or an idle connection to the same host
+        if(HTTPIntrnPoolGet(pHTTPSession) == TRUE)
+        {
+            pHTTPSession->HttpState  = pHTTPSession->HttpState | HTTP_CLIENT_STATE_HOST_CONNECTED;
+            return HTTP_CLIENT_SUCCESS;
+        }
+#endif //TLS_CONFIG_HTTP_CLIENT_POOL
         // Zero the socket events 
         FD_ZERO(&pHTTPSession->HttpConnection.FDRead); 
         FD_ZERO(&pHTTPSession->HttpConnection.FDWrite); 
@@ -1740,6 +2102,7 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
         }
         */
         // Resolve the target host name
+        nStart = HTTPIntrnSessionGetUpTime();
         if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_USINGPROXY) != HTTP_CLIENT_FLAG_USINGPROXY)
         {
             // No proxy, directly resolving the host name
@@ -1776,6 +2139,7 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
         break;
         }
         */
+        HTTPIntrnStatsAdd(&HttpStats.Dns,nStart);
         // Reset the address structures
         memset(&ServerAddress, 0, sizeof(HTTP_SOCKADDR_IN)); 
         memset(&LoaclAddress, 0, sizeof(HTTP_SOCKADDR_IN)); 
@@ -1819,6 +2183,7 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
                 nRetCode = HTTP_CLIENT_ERROR_SOCKET_BIND;
             }
         }
+        nStart = HTTPIntrnSessionGetUpTime();
 #if TLS_CONFIG_HTTP_CLIENT_SECURE
         // Connect using TLS or otherwise clear connection
         if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_SECURE) == HTTP_CLIENT_FLAG_SECURE)
@@ -1840,6 +2205,7 @@ static UINT32 HTTPIntrnConnectionOpen (P_HTTP_SESSION pHTTPSession)
         nRetCode = SocketGetErr(pHTTPSession->HttpConnection.HttpSocket);
         if(nRetCode == 0 || nRetCode == HTTP_EWOULDBLOCK || nRetCode == HTTP_EINPROGRESS)
         {      
+            HTTPIntrnStatsAdd(&HttpStats.Connect,nStart);
             // Set TLS Nego flag to flase
             pHTTPSession->HttpConnection.TlsNego = FALSE;
             // Set the Write fd_sets for a socket connection event
@@ -2181,6 +2547,140 @@ static UINT32 HTTPIntrnRecv (P_HTTP_SESSION pHTTPSession,
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Function     : HTTPIntrnReadBody
+// Purpose      : Receive up to *nLength body bytes, the chunks framing removed
+// Returns      : HTTP Status, HTTP_CLIENT_EOS at the end of the body
+// Last updated : 19/10/2026
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static UINT32 HTTPIntrnReadBody (P_HTTP_SESSION pHTTPSession,
+                                 CHAR *pData,        // [IN] a pointer for a buffer that receives the data
+                                 UINT32 *nLength)    // [IN OUT] Length of the buffer and the count of the received bytes
+{
+    UINT32          nBytes          = *(nLength);
+    UINT32          nRetCode        = 0 ;
+    INT32           nProjectedBytes = 0; // Should support negative numbers
+    BOOL            EndOfStream = FALSE;
+    CHAR            ChunkEnd[2];
+    
+    *(nLength) = 0;
+    
+    // We can read the data only if we got valid headers (and not authentication requests for example)
+    if((pHTTPSession->HttpState & HTTP_CLIENT_STATE_HEADERS_PARSED) != HTTP_CLIENT_STATE_HEADERS_PARSED)
+    {
+        return HTTP_CLIENT_ERROR_BAD_STATE;
+    }
+    if(pHTTPSession->HttpTiming.BodyDone == TRUE)
+    {
+        return HTTP_CLIENT_EOS;
+    }
+    // Responses that have no body
+    if(pHTTPSession->HttpHeadersInfo.nHTTPStatus == 204 || pHTTPSession->HttpHeadersInfo.nHTTPStatus == 304 ||
+        pHTTPSession->HttpHeaders.HttpLastVerb == VerbHead ||
+        (pHTTPSession->HttpHeadersInfo.LengthKnown == TRUE && pHTTPSession->HttpHeadersInfo.nHTTPContentLength == 0 &&
+        (pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_CHUNKED) != HTTP_CLIENT_FLAG_CHUNKED))
+    {
+        HTTPIntrnBodyDone(pHTTPSession);
+        return HTTP_CLIENT_EOS;
+    }
+    
+    // Is it a chunked mode transfer?
+    if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_CHUNKED) == HTTP_CLIENT_FLAG_CHUNKED)
+    {
+        
+        // How many bytes left until the next chunk?
+        if(pHTTPSession->HttpCounters.nBytesToNextChunk == 0)
+        {
+            // Read the chunk header and get its length
+            if(HTTPIntrnGetRemoteChunkLength(pHTTPSession) != HTTP_CLIENT_SUCCESS)
+            {
+                // Could not parse the chunk parameter
+                return HTTP_CLIENT_ERROR_CHUNK;
+            }
+            
+            // 0 Bytes chunk, we should return end of stream
+            if(pHTTPSession->HttpCounters.nRecivedChunkLength == 0)
+            {
+                // Consume the CrLf that ends the body, after a trailer the connection can not be reused
+                nBytes = 2;
+                if(HTTPIntrnRecv(pHTTPSession,ChunkEnd,&nBytes,FALSE) == HTTP_CLIENT_SUCCESS &&
+                    nBytes == 2 && memcmp(ChunkEnd,HTTP_CLIENT_CRLF,2) == 0)
+                {
+                    HTTPIntrnBodyDone(pHTTPSession);
+                }
+                return HTTP_CLIENT_EOS;
+            }
+        }
+        // If we are about to read pass the next chunk, reduce the read bytes so we will read
+        // non HTML data
+        nProjectedBytes = pHTTPSession->HttpCounters.nBytesToNextChunk - nBytes;
+        if ( nProjectedBytes <= 0)
+        {
+            // Set the correct bytes count we should read
+            nBytes  = pHTTPSession->HttpCounters.nBytesToNextChunk;
+        }
+    }
+    
+    // Do we have the content length?
+    if(pHTTPSession->HttpHeadersInfo.nHTTPContentLength > 0)
+    {
+        // Length of the projected buffer 
+        nProjectedBytes = pHTTPSession->HttpCounters.nRecivedBodyLength +  nBytes;
+        // If we are going to read more then the known content length then..
+        if(nProjectedBytes >= (INT32)pHTTPSession->HttpHeadersInfo.nHTTPContentLength)
+        {
+            // Reduce the received bytes count to the correct size
+            nBytes = pHTTPSession->HttpHeadersInfo.nHTTPContentLength - pHTTPSession->HttpCounters.nRecivedBodyLength;
+            
+        }
+    }
+    // Receive the data from the socket
+    nRetCode = HTTPIntrnRecv(pHTTPSession,pData,&nBytes,FALSE);
+    *(nLength) = nBytes;
+    
+    // Socket read went OK
+    if(nRetCode == HTTP_CLIENT_SUCCESS)
+    {
+        
+#ifdef _HTTP_DEBUGGING_
+        if(pHTTPSession->pDebug)
+        {
+            pHTTPSession->pDebug("HTTPClientReadData",NULL,0,"Reading %d bytes",nBytes);
+        }
+#endif
+        // Set the HTTP counters
+        pHTTPSession->HttpCounters.nRecivedBodyLength += nBytes;
+        // If we know the total content length and..
+        if(pHTTPSession->HttpHeadersInfo.nHTTPContentLength > 0)
+        {
+            // If total received body is equal or greater then the known content length then..
+            if( pHTTPSession->HttpCounters.nRecivedBodyLength >= pHTTPSession->HttpHeadersInfo.nHTTPContentLength)
+            {           
+                // Raise a flag to signal end of stream
+                EndOfStream = TRUE;
+            }
+        }
+        // Is it a chunked mode transfer?
+        if((pHTTPSession->HttpFlags & HTTP_CLIENT_FLAG_CHUNKED) == HTTP_CLIENT_FLAG_CHUNKED)
+        {
+            // We are a little closer to the next chunk now
+            pHTTPSession->HttpCounters.nBytesToNextChunk -= nBytes;
+        }
+        // Is it End of stream?
+        if(EndOfStream == TRUE)
+        {
+            // So exit
+            HTTPIntrnBodyDone(pHTTPSession);
+            return HTTP_CLIENT_EOS;
+        }
+    }
+    
+    return nRetCode ;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Function     : HTTPIntrnGetRemoteChunkLength
@@ -2221,7 +2721,7 @@ static UINT32 HTTPIntrnGetRemoteChunkLength (P_HTTP_SESSION pHTTPSession)
             {
                 // Increment the bytes count
                 nBytesCount += nBytesRead;
-                if(nBytesRead > HTTP_CLIENT_MAX_CHUNK_HEADER)
+                if(nBytesCount >= HTTP_CLIENT_MAX_CHUNK_HEADER)
                 {
                     // Error chunk buffer is full
                     nRetCode = HTTP_CLIENT_ERROR_CHUNK_TOO_BIG;
@@ -2736,9 +3236,11 @@ static UINT32 HTTPIntrnHeadersParse (P_HTTP_SESSION pHTTPSession)
         
         // Search for content length
         pHTTPSession->HttpHeadersInfo.nHTTPContentLength = 0; // Default no unknown length
+        pHTTPSession->HttpHeadersInfo.LengthKnown = FALSE;
         // Look for the token
         if(HTTPIntrnHeadersFind(pHTTPSession,"content-length",&HTTPParam,TRUE,0) == HTTP_CLIENT_SUCCESS)
         {
+            pHTTPSession->HttpHeadersInfo.LengthKnown = TRUE;
             
             memset(HTTPToken,0x00,HTTP_CLIENT_MAX_TOKEN_LENGTH);        // Reset the token buffer
             nTokenLength  = HTTP_CLIENT_MAX_TOKEN_LENGTH;               // Set the buffer length
@@ -2752,6 +3254,11 @@ static UINT32 HTTPIntrnHeadersParse (P_HTTP_SESSION pHTTPSession)
         
         // Search for connection status
         pHTTPSession->HttpHeadersInfo.Connection = TRUE; // Default status where no server connection header was detected
+        // HTTP/1.0 servers close the connection unless they announce keep alive
+        if(HTTPStrInsensitiveCompare(pHTTPSession->HttpHeadersInfo.HTTPVersion,"HTTP/1.0",0) == TRUE)
+        {
+            pHTTPSession->HttpHeadersInfo.Connection = FALSE;
+        }
         // Look for token (can be standard connection or a proxy connection)
         if( (HTTPIntrnHeadersFind(pHTTPSession,"connection",&HTTPParam,TRUE,0) == HTTP_CLIENT_SUCCESS) ||
             (HTTPIntrnHeadersFind(pHTTPSession,"proxy-connection",&HTTPParam,TRUE,0) == HTTP_CLIENT_SUCCESS))
@@ -2771,6 +3278,17 @@ static UINT32 HTTPIntrnHeadersParse (P_HTTP_SESSION pHTTPSession)
             }    
         }
         
+        // How long the server keeps an idle connection ("Keep-Alive: timeout=5, max=100")
+        pHTTPSession->HttpHeadersInfo.nKeepAliveTimeout = 0;
+        if(HTTPIntrnHeadersFind(pHTTPSession,"keep-alive",&HTTPParam,TRUE,0) == HTTP_CLIENT_SUCCESS)
+        {
+            pPtr = HTTPStrCaseStr(HTTPParam.pParam,HTTPParam.nLength,"timeout=");
+            if(pPtr)
+            {
+                pHTTPSession->HttpHeadersInfo.nKeepAliveTimeout = atol(pPtr + 8);
+            }
+        }
+        
         // Search for chunking mode transfer
         pHTTPSession->HttpFlags = pHTTPSession->HttpFlags &~ HTTP_CLIENT_FLAG_CHUNKED; // Remove the flag
         if(HTTPIntrnHeadersFind(pHTTPSession,"transfer-encoding",&HTTPParam,TRUE,0) == HTTP_CLIENT_SUCCESS)
@@ -3697,6 +4215,7 @@ static UINT32 HTTPIntrnHeadersReceive (P_HTTP_SESSION pHTTPSession,
         {
             break;
         }
+        pHTTPSession->HttpTiming.BodyDone = FALSE;
         // Get the server response
         if((nRetCode = HTTPIntrnGetRemoteHeaders(pHTTPSession)) != HTTP_CLIENT_SUCCESS)
         {
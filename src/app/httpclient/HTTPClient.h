@@ -42,6 +42,9 @@ extern "C" {
 #define HTTP_CLIENT_MAX_TOKEN_NAME_LENGTH   32          // Maximum length for an HTTP authorization token name ("qop")
 #define HTTP_CLIENT_MAX_HEADER_SEARCH_CLUE  1024          // Maximum length for a search clue string (Headers searching)
 #define HTTP_CLIENT_ALLOW_HEAD_VERB         0           // Can we use the HTTP HEAD verb in our outgoing requests?
+#define HTTP_CLIENT_POOL_SIZE               2           // Idle keep-alive connections kept open (all hosts together)
+#define HTTP_CLIENT_POOL_HOST_LENGTH        64          // Maximum length of a host name that a connection is pooled for
+#define HTTP_CLIENT_POOL_IDLE               15          // Seconds a pooled connection is kept, unless the server allows less
 
 #define HTTP_CLIENT_MEMORY_RESIZABLE        FALSE       // Permission to dynamically resize the headers buffer
 #define HTTP_CLIENT_MEMORY_RESIZE_FACTOR    16          // Factor for memory resizing operation
@@ -126,6 +129,7 @@ extern "C" {
         UINT32              HttpStartTime;      // Time stamp for the session
         UINT32              HttpClientPort;     // For client side binding
         BOOL				TlsNego;            // TLS negotiation flag
+        BOOL                Reused;             // The connection was taken from the keep-alive pool
 
     } HTTP_CONNECTION;
 
@@ -165,6 +169,8 @@ extern "C" {
         UINT32               nHTTPContentLength;    // the Content length if specified of the returned data
         UINT32               nHTTPPostContentLength;// the Content-Length of the POSTed data (if known)
         BOOL                 Connection;            // True = Keep alive or undefined, False = Closed
+        BOOL                 LengthKnown;           // a Content-Length header was received (nHTTPContentLength may be 0)
+        UINT32               nKeepAliveTimeout;     // "Keep-Alive: timeout=" of the server in seconds, 0 if not sent
         BOOL                 ValidHeaders;          // a flag that indicates if the incoming header ware parsed OK and found to be valid
         BOOL                 HaveCredentials;       // a flag that indicates if we have credentials for the session
         CHAR                 HTTPVersion[16];       // HTTP version string buffer (for example: "HTTP 1.1")
@@ -218,6 +224,17 @@ extern "C" {
 
     }HTTP_COUNTERS;
 
+    // Time stamps of the request phases (see HTTP_CLIENT_STATS)
+    typedef struct _HTTP_TIMING
+    {
+
+        UINT32              nSendStart;             // Connected, the request is being sent
+        UINT32              nSendEnd;               // The request (and posted data) was sent
+        UINT32              nHeadersTime;           // The response headers ware received
+        BOOL                BodyDone;               // The whole response body was read
+
+    }HTTP_TIMING;
+
     // HTTP Client Session data
     typedef struct _HTTP_REQUEST
     {
@@ -230,6 +247,7 @@ extern "C" {
         HTTP_CREDENTIALS    HttpCredentials;  
         HTTP_CONNECTION     HttpConnection;
         HTTP_COUNTERS       HttpCounters;
+        HTTP_TIMING         HttpTiming;
         UINT32              HttpState;
         UINT32              HttpFlags;
 #ifdef _HTTP_DEBUGGING_
@@ -296,6 +314,7 @@ static    UINT32                  HTTPIntrnGetRemoteHeaders     (P_HTTP_SESSION
 static    UINT32                  HTTPIntrnGetRemoteChunkLength (P_HTTP_SESSION pHTTPSession);
 static    UINT32                  HTTPIntrnSend                 (P_HTTP_SESSION pHTTPSession, CHAR *pData,UINT32 *nLength);
 static    UINT32                  HTTPIntrnRecv                 (P_HTTP_SESSION pHTTPSession, CHAR *pData,UINT32 *nLength,BOOL PeekOnly);
+static    UINT32                  HTTPIntrnReadBody             (P_HTTP_SESSION pHTTPSession, CHAR *pData,UINT32 *nLength);
 static    UINT32                  HTTPIntrnParseAuthHeader      (P_HTTP_SESSION pHTTPSession);
 static    UINT32                  HTTPIntrnAuthHandler          (P_HTTP_SESSION pHTTPSession);
 static    UINT32                  HTTPIntrnAuthSendDigest       (P_HTTP_SESSION pHTTPSession);
@@ -307,6 +326,12 @@ static    UINT32                  HTTPIntrnHeadersReceive       (P_HTTP_SESSION
 static    UINT32                  HTTPIntrnHeadersSend          (P_HTTP_SESSION pHTTPSession, HTTP_VERB HttpVerb);
 static    UINT32                  HTTPIntrnHeadersParse         (P_HTTP_SESSION pHTTPSession);
 static    UINT32                  HTTPIntrnHeadersFind          (P_HTTP_SESSION pHTTPSession, CHAR *pHeaderName, HTTP_PARAM *pParam,BOOL IncommingHeaders,UINT32 nOffset);
+static    VOID                    HTTPIntrnStatsAdd             (HTTP_CLIENT_PHASE *pPhase, UINT32 nStart);
+static    VOID                    HTTPIntrnBodyDone             (P_HTTP_SESSION pHTTPSession);
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+static    BOOL                    HTTPIntrnPoolGet              (P_HTTP_SESSION pHTTPSession);
+static    BOOL                    HTTPIntrnPoolPut              (P_HTTP_SESSION pHTTPSession);
+#endif
 static    UINT32                  HTTPIntrnSessionReset         (P_HTTP_SESSION pHTTPSession, BOOL EntireSession);
 static    UINT32                  HTTPIntrnSessionGetUpTime     (VOID);
 static    BOOL                    HTTPIntrnSessionEvalTimeout   (P_HTTP_SESSION pHTTPSession);
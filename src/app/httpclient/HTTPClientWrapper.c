@@ -6,6 +6,9 @@
 #include "wm_sockets.h"
 #include "lwip/sockets.h"
 #include "wm_debug.h"
+#if TLS_CONFIG_DNS_RESOLVER
+#include "wm_dns.h"
+#endif
 #if TLS_CONFIG_HTTP_CLIENT_SECURE
 #if TLS_CONFIG_USE_POLARSSL
 #include "polarssl/camellia.h"
@@ -248,7 +251,9 @@ long HTTPWrapperGetUpTime()
 
 unsigned long HTTPWrapperGetHostByName(char *name,unsigned long *address)
 {
+#if !TLS_CONFIG_DNS_RESOLVER
     HTTP_HOSTNET     *HostEntry;
+#endif
     int     iPos = 0, iLen = 0,iNumPos = 0,iDots =0;
     long    iIPElement;
     char    c = 0;
@@ -307,6 +312,17 @@ unsigned long HTTPWrapperGetHostByName(char *name,unsigned long *address)
 
     if(iHostType > 0)
     {
+#if TLS_CONFIG_DNS_RESOLVER
+        u32 HostAddr;
+
+        // Thread safe, and answered from the cache without blocking most of the time
+        if(tls_dns_gethostbyname(name, &HostAddr) == TLS_DNS_OK)
+        {
+            *(address) = HostAddr;
+            return 1;
+        }
+        return 0;
+#else
 
         HostEntry = gethostbyname(name); 
         if(HostEntry)
@@ -320,6 +336,7 @@ unsigned long HTTPWrapperGetHostByName(char *name,unsigned long *address)
         {
             return 0; // OK
         }
+#endif
     }
 
     else // numeric address - no need for DNS resolve
@@ -10,6 +10,7 @@
 static sys_mbox_t http_client_mbox = SYS_MBOX_NULL;
 static OS_STK httpClientStk[HTTP_CLIENT_STK_SIZE]; 
 #define    HTTP_CLIENT_BUFFER_SIZE   1024
+#define    HTTP_CLIENT_IDLE_CHECK    5000    /* ms, close expired keep-alive connections */
 extern u8 pSession_flag;
 static UINT32  http_snd_req_local(
 	HTTP_SESSION_HANDLE pHTTP, HTTPParameters ClientParams, HTTP_VERB verb, CHAR* pSndData, u32 dataLen,
@@ -125,7 +126,17 @@ static void http_client_rx(void *sdata)
 	http_client_msg *http_msg;
 	for(;;) 
 	{
+#if TLS_CONFIG_HTTP_CLIENT_POOL
+		/* queued requests to the same host run back to back on one pooled
+		   connection, an idle task closes the connections nobody reuses */
+		if(sys_arch_mbox_fetch(&http_client_mbox, (void **)&msg, HTTP_CLIENT_IDLE_CHECK) == SYS_ARCH_TIMEOUT)
+		{
+			HTTPClientCloseIdle(FALSE);
+			continue;
+		}
+#else
 		sys_arch_mbox_fetch(&http_client_mbox, (void **)&msg, 0);
+#endif
 		http_msg = (http_client_msg *)msg;
 		ret = http_snd_req_local(http_msg->pSession,
 					http_msg->param,
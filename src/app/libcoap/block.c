@@ -137,4 +137,81 @@ coap_add_block(coap_pdu_t *pdu, unsigned int len, const unsigned char *data,
 		       min(len - start, (unsigned int)(1 << (block_szx + 4))),
 		       data + start);
 }
+
+int
+coap_write_block_stream(coap_pdu_t *request, unsigned short type,
+			coap_pdu_t *pdu, coap_block_producer_t producer,
+			void *arg) {
+  coap_block_t block;
+  unsigned char *opt;
+  unsigned char *payload;
+  unsigned short length, max_delta;
+  size_t avail, want, n;
+  unsigned int value;
+  int optlen, i, more = 0;
+
+  assert(pdu);
+  assert(producer);
+
+  if (!coap_get_block(request, type, &block))
+    block.szx = COAP_MAX_BLOCK_SZX;
+  if (block.szx > COAP_MAX_BLOCK_SZX) {
+    block.num <<= block.szx - COAP_MAX_BLOCK_SZX;
+    block.szx = COAP_MAX_BLOCK_SZX;
+  }
+
+  /* room for the option (up to 2 bytes header and 3 bytes value) and
+   * the payload marker */
+  if (pdu->max_size < pdu->length + 6)
+    return -3;
+  avail = pdu->max_size - pdu->length - 6;
+  want = 1 << (block.szx + 4);
+  while (want > avail && block.szx > 0) {
+    debug("decrease block size to %d\n", block.szx - 1);
+    block.szx--;
+    block.num <<= 1;
+    want >>= 1;
+  }
+  if (want > avail || block.num > 0xFFFFF)
+    return -3;
+
+  /* The value is written with the M bit set, so its length does not
+   * change when the producer reports the last block. */
+  value = (block.num << 4) | 0x08 | block.szx;
+  optlen = (value > 0xFFFF) ? 3 : (value > 0xFF) ? 2 : 1;
+
+  length = pdu->length;
+  max_delta = pdu->max_delta;
+  opt = coap_add_option_later(pdu, type, optlen);
+  if (!opt)
+    return -3;
+
+  /* the producer writes the block straight into the message */
+  payload = (unsigned char *)pdu->hdr + pdu->length;
+  n = producer(arg, block.num << (block.szx + 4), payload + 1, want, &more);
+  if (n == 0 && block.num > 0) {
+    debug("illegal block requested\n");
+    pdu->length = length;
+    pdu->max_delta = max_delta;
+    return -2;
+  }
+  if (n > want)
+    n = want;
+  if (n < want)
+    more = 0;
+
+  if (!more)
+    value &= ~0x08;
+  for (i = optlen - 1; i >= 0; i--) {
+    opt[i] = value & 0xff;
+    value >>= 8;
+  }
+
+  if (n) {
+    *payload = COAP_PAYLOAD_START;
+    pdu->data = payload + 1;
+    pdu->length += n + 1;
+  }
+  return 1;
+}
 #endif /* WITHOUT_BLOCK  */
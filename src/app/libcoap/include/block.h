@@ -132,6 +132,42 @@ int coap_add_block(coap_pdu_t *pdu,
                    const unsigned char *data,
                    unsigned int block_num,
                    unsigned char block_szx);
+
+/**
+ * Produces the resource representation for coap_write_block_stream(). Writes
+ * at most @p len bytes starting at @p offset into @p buf and sets @p *more
+ * when data follows the bytes written.
+ *
+ * @return The number of bytes written, @c 0 when @p offset is past the end.
+ */
+typedef size_t (*coap_block_producer_t)(void *arg,
+                                        size_t offset,
+                                        unsigned char *buf,
+                                        size_t len,
+                                        int *more);
+
+/**
+ * Writes the block requested in @p request (block 0 if the request has no
+ * option @p type) to @p pdu. The option and the payload are added to @p pdu
+ * and @p producer writes the data directly into the message, so only the
+ * requested block is held in memory and the representation never has to be
+ * built in one piece. The block size is reduced when the block does not fit
+ * in @p pdu. Options with numbers above @p type must not be added afterwards.
+ *
+ * @param request  The request, may be @c NULL.
+ * @param type     COAP_OPTION_BLOCK2 (or COAP_OPTION_BLOCK1).
+ * @param pdu      The response to write to.
+ * @param producer Writes the data of the block.
+ * @param arg      Passed to @p producer.
+ *
+ * @return @c 1 on success, @c -2 if the block is past the end of the data,
+ *         @c -3 if @p pdu has no room for a block.
+ */
+int coap_write_block_stream(coap_pdu_t *request,
+                            unsigned short type,
+                            coap_pdu_t *pdu,
+                            coap_block_producer_t producer,
+                            void *arg);
 /**@}*/
 
 #endif /* _COAP_BLOCK_H_ */
@@ -316,6 +316,18 @@ coap_pdu_t *coap_new_pdu(void);
 
 void coap_delete_pdu(coap_pdu_t *);
 
+/**
+ * Creates a copy of @p pdu with the token replaced by the @p len bytes at
+ * @p token. Options and payload are copied as encoded, so a message that is
+ * sent to several peers has to be built only once. The new PDU is only as
+ * large as the message and must be released with coap_delete_pdu().
+ *
+ * @return A pointer to the new PDU object or @c NULL on error.
+ */
+coap_pdu_t *coap_pdu_clone_token(const coap_pdu_t *pdu,
+                                 size_t len,
+                                 const unsigned char *token);
+
 /**
  * Parses @p data into the CoAP PDU structure given in @p result.
  * This function returns @c 0 on error or a number greater than zero on success.
@@ -76,6 +76,12 @@ typedef struct coap_attr_t {
  */
 #define COAP_RESOURCE_FLAGS_NOTIFY_CON  0x2
 
+/**
+ * The GET handler output does not depend on the observer. Notifications
+ * are built once per change and copied for every observer with its token.
+ */
+#define COAP_RESOURCE_FLAGS_NOTIFY_SHARED 0x4
+
 typedef struct coap_resource_t {
   unsigned int dirty:1;          /**< set to 1 if resource has changed */
   unsigned int partiallydirty:1; /**< set to 1 if some subscribers have not yet
@@ -132,7 +138,7 @@ coap_resource_t *coap_resource_init(const unsigned char *uri,
  */
 static inline void
 coap_resource_set_mode(coap_resource_t *r, int mode) {
-  r->flags = (r->flags & !COAP_RESOURCE_FLAGS_NOTIFY_CON) | mode;
+  r->flags = (r->flags & ~COAP_RESOURCE_FLAGS_NOTIFY_CON) | mode;
 }
 
 /**
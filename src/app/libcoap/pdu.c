@@ -198,6 +198,36 @@ coap_add_option(coap_pdu_t *pdu, unsigned short type, unsigned int len, const un
   return optsize;
 }
 
+coap_pdu_t *
+coap_pdu_clone_token(const coap_pdu_t *pdu, size_t len, const unsigned char *token) {
+  const unsigned char *rest;
+  size_t rest_len;
+  coap_pdu_t *result;
+
+  assert(pdu);
+
+  rest = (const unsigned char *)pdu->hdr + sizeof(coap_hdr_t) + pdu->hdr->token_length;
+  rest_len = pdu->length - sizeof(coap_hdr_t) - pdu->hdr->token_length;
+
+  result = coap_pdu_init(pdu->hdr->type, pdu->hdr->code, pdu->hdr->id,
+			 sizeof(coap_hdr_t) + len + rest_len);
+  if (!result)
+    return NULL;
+  if (!coap_add_token(result, len, token)) {
+    coap_delete_pdu(result);
+    return NULL;
+  }
+
+  memcpy((unsigned char *)result->hdr + result->length, rest, rest_len);
+  if (pdu->data)
+    result->data = (unsigned char *)result->hdr + result->length
+      + (pdu->data - rest);
+  result->length += rest_len;
+  result->max_delta = pdu->max_delta;
+
+  return result;
+}
+
 /** @FIXME de-duplicate code with coap_add_option */
 unsigned char*
 coap_add_option_later(coap_pdu_t *pdu, unsigned short type, unsigned int len) {
@@ -605,6 +605,7 @@ coap_notify_observers(coap_context_t *context, coap_resource_t *r) {
   coap_subscription_t *obs;
   str token;
   coap_pdu_t *response;
+  coap_pdu_t *shared = NULL;
 
   if (r->observable && (r->dirty || r->partiallydirty)) {
     r->partiallydirty = 0;
@@ -621,6 +622,36 @@ coap_notify_observers(coap_context_t *context, coap_resource_t *r) {
 
       coap_tid_t tid = COAP_INVALID_TID;
       obs->dirty = 0;
+      token.length = obs->token_length;
+      token.s = obs->token;
+
+      if (r->flags & COAP_RESOURCE_FLAGS_NOTIFY_SHARED) {
+	/* run the handler for the first observer only, the others get a
+	 * copy of its notification with their own token */
+	if (!shared) {
+	  shared = coap_pdu_init(COAP_MESSAGE_NON, 0, 0, COAP_MAX_PDU_SIZE);
+	  if (shared && !coap_add_token(shared, obs->token_length, obs->token)) {
+	    coap_delete_pdu(shared);
+	    shared = NULL;
+	  }
+	  if (shared)
+	    h(context, r, &obs->local_if, &obs->subscriber, NULL, &token, shared);
+	}
+	response = shared ? coap_pdu_clone_token(shared, obs->token_length, obs->token) : NULL;
+	if (!response) {
+	  obs->dirty = 1;
+	  r->partiallydirty = 1;
+	  debug("coap_check_notify: pdu copy failed, resource stays partially dirty\n");
+	  continue;
+	}
+	response->hdr->id = coap_new_message_id(context);
+	if ((r->flags & COAP_RESOURCE_FLAGS_NOTIFY_CON) == 0
+	    && obs->non_cnt < COAP_OBS_MAX_NON) {
+	  response->hdr->type = COAP_MESSAGE_NON;
+	} else {
+	  response->hdr->type = COAP_MESSAGE_CON;
+	}
+      } else {
       /* initialize response */
       response = coap_pdu_init(COAP_MESSAGE_CON, 0, 0, COAP_MAX_PDU_SIZE);
       if (!response) {
@@ -638,9 +669,6 @@ coap_notify_observers(coap_context_t *context, coap_resource_t *r) {
 	continue;
       }
 
-      token.length = obs->token_length;
-      token.s = obs->token;
-
       response->hdr->id = coap_new_message_id(context);
       if ((r->flags & COAP_RESOURCE_FLAGS_NOTIFY_CON) == 0
 	  && obs->non_cnt < COAP_OBS_MAX_NON) {
@@ -650,6 +678,7 @@ coap_notify_observers(coap_context_t *context, coap_resource_t *r) {
       }
       /* fill with observer-specific data */
       h(context, r, &obs->local_if, &obs->subscriber, NULL, &token, response);
+      }
 
       /* TODO: do not send response and remove observer when 
        *  COAP_RESPONSE_CLASS(response->hdr->code) > 2
@@ -673,6 +702,9 @@ coap_notify_observers(coap_context_t *context, coap_resource_t *r) {
 
     }
 
+    if (shared)
+      coap_delete_pdu(shared);
+
     /* Increment value for next Observe use. */
     context->observe++;
   }
@@ -3309,6 +3309,46 @@ lws_write(struct lws *wsi, unsigned char *buf, size_t len,
 /* helper for case where buffer may be const */
 #define lws_write_http(wsi, buf, len) \
 	lws_write(wsi, (unsigned char *)(buf), len, LWS_WRITE_HTTP)
+
+/** most payload pieces one lws_write_iov() call looks at */
+#define LWS_IOV_MAX 8
+
+/** struct lws_iovec - one piece of payload for lws_write_iov() */
+struct lws_iovec {
+	const void *base; /**< start of the piece */
+	size_t len; /**< length of the piece */
+};
+
+/**
+ * lws_write_iov() - Send websocket payload from scattered buffers
+ * \param wsi:	Websocket instance (available from user callback)
+ * \param iov:	payload pieces, no LWS_PRE headroom needed and not modified
+ * \param iovcnt:	number of pieces, at most LWS_IOV_MAX are used
+ * \param protocol:	LWS_WRITE_TEXT or LWS_WRITE_BINARY, optionally with
+ *		LWS_WRITE_NO_FIN when more of the message follows in a later
+ *		call
+ *
+ *	The payload is cut into frames of at most the protocol rx_buffer_size
+ *	(or the context pt_serv_buf_size), so a large message does not have
+ *	to be held in one buffer.  Server frames are handed to the socket
+ *	directly from iov, client frames are masked while they are copied to
+ *	the per-thread service buffer, so iov must not point into it.
+ *
+ *	Unlike lws_write() nothing is buffered: when the socket takes less,
+ *	the position inside the frame is remembered, a writable callback is
+ *	requested and the return value tells how many payload bytes were
+ *	consumed.  Call again from that callback with iov advanced by that
+ *	amount and the same protocol; the message type is only used for the
+ *	first frame of a message.  Until the frame is complete lws_write()
+ *	fails, and until the message is complete only control frames may be
+ *	sent with it.
+ *
+ *	Return is -1 for a fatal error needing connection close, or the number
+ *	of payload bytes consumed.  Extensions are not applied.
+ */
+LWS_VISIBLE LWS_EXTERN int
+lws_write_iov(struct lws *wsi, const struct lws_iovec *iov, int iovcnt,
+	      enum lws_write_protocol protocol);
 ///@}
 
 /** \defgroup callback-when-writeable Callback when writeable
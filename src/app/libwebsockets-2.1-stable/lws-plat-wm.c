@@ -362,6 +362,31 @@ lws_plat_check_connection_error(struct lws *wsi)
 {
 	return 0;
 }
+
+LWS_VISIBLE int
+lws_plat_writev(struct lws *wsi, const struct lws_iovec *iov, int iovcnt)
+{
+	struct iovec v[LWS_IOV_MAX + 1];
+	int n;
+
+	if (iovcnt > LWS_IOV_MAX + 1)
+		iovcnt = LWS_IOV_MAX + 1;
+	for (n = 0; n < iovcnt; n++) {
+		v[n].iov_base = (void *)iov[n].base;
+		v[n].iov_len = iov[n].len;
+	}
+
+	n = writev(wsi->sock, v, iovcnt);
+	if (n >= 0)
+		return n;
+
+	if (LWS_ERRNO == LWS_EAGAIN ||
+	    LWS_ERRNO == LWS_EWOULDBLOCK ||
+	    LWS_ERRNO == LWS_EINTR)
+		return LWS_SSL_CAPABLE_MORE_SERVICE;
+
+	return LWS_SSL_CAPABLE_ERROR;
+}
 void *lws_zalloc(size_t size)
 {
 	void *ptr = lws_malloc(size);
@@ -48,6 +48,87 @@ lws_0405_frame_mask_generate(struct lws *wsi)
 	return 0;
 }
 
+/*
+ * XOR len bytes of src with the frame mask into dst, starting at mask byte
+ * *idx.  Once dst is word aligned the mask is applied a word at a time,
+ * dst may equal src.
+ */
+static void
+lws_mask_copy(unsigned char *dst, const unsigned char *src, size_t len,
+	      const unsigned char *mask, unsigned char *idx)
+{
+	unsigned char k[4];
+	unsigned int m, w;
+	int i = *idx & 3;
+
+	while (len && ((unsigned long)dst & 3)) {
+		*dst++ = *src++ ^ mask[i];
+		i = (i + 1) & 3;
+		len--;
+	}
+
+	if (len >= 4) {
+		/* the mask as seen from the current position */
+		k[0] = mask[i];
+		k[1] = mask[(i + 1) & 3];
+		k[2] = mask[(i + 2) & 3];
+		k[3] = mask[(i + 3) & 3];
+		memcpy(&m, k, 4);
+
+		while (len >= 4) {
+			memcpy(&w, src, 4);
+			*(unsigned int *)dst = w ^ m;
+			dst += 4;
+			src += 4;
+			len -= 4;
+		}
+	}
+
+	while (len--) {
+		*dst++ = *src++ ^ mask[i];
+		i = (i + 1) & 3;
+	}
+
+	*idx = i;
+}
+
+/* build a websocket frame header, returns its length (at most 14) */
+static int
+lws_ws_frame_header(unsigned char *p, unsigned char opc, size_t len,
+		    const unsigned char *mask)
+{
+	unsigned char mbit = mask ? 0x80 : 0;
+	int n = 2;
+
+	p[0] = opc;
+	if (len < 126)
+		p[1] = (unsigned char)len | mbit;
+	else if (len < 65536) {
+		p[1] = 126 | mbit;
+		p[2] = (unsigned char)(len >> 8);
+		p[3] = (unsigned char)len;
+		n = 4;
+	} else {
+		p[1] = 127 | mbit;
+		p[2] = 0;
+		p[3] = 0;
+		p[4] = 0;
+		p[5] = 0;
+		p[6] = (unsigned char)(len >> 24);
+		p[7] = (unsigned char)(len >> 16);
+		p[8] = (unsigned char)(len >> 8);
+		p[9] = (unsigned char)len;
+		n = 10;
+	}
+
+	if (mask) {
+		memcpy(&p[n], mask, 4);
+		n += 4;
+	}
+
+	return n;
+}
+
 #ifdef _DEBUG
 
 LWS_VISIBLE void lwsl_hexdump(void *vbuf, size_t len)
@@ -280,6 +361,20 @@ LWS_VISIBLE int lws_write(struct lws *wsi, unsigned char *buf, size_t len,
 			    wp != LWS_WRITE_CLOSE))
 		return 0;
 
+	/*
+	 * a frame lws_write_iov() has partly sent has to be finished from the
+	 * writable callback first, and only control frames may go between the
+	 * frames of its message
+	 */
+	if (wsi->u.ws.tx_hdr_len ||
+	    (wsi->u.ws.tx_stream && (wp & 0xf) != LWS_WRITE_PING &&
+	     (wp & 0xf) != LWS_WRITE_PONG && (wp & 0xf) != LWS_WRITE_CLOSE)) {
+		lwsl_err("%p: lws_write() while an lws_write_iov() %s is "
+			 "pending\n", wsi, wsi->u.ws.tx_hdr_len ? "frame" :
+			 "message");
+		return -1;
+	}
+
 	/* if we are continuing a frame that already had its header done */
 
 	if (wsi->u.ws.inside_frame) {
@@ -458,9 +553,8 @@ do_more_inside_frame:
 		 * in v7, just mask the payload
 		 */
 		if (dropmask) { /* never set if already inside frame */
-			for (n = 4; n < (int)len + 4; n++)
-				dropmask[n] = dropmask[n] ^ wsi->u.ws.mask[
-					(wsi->u.ws.mask_idx++) & 3];
+			lws_mask_copy(dropmask + 4, dropmask + 4, len,
+				      wsi->u.ws.mask, &wsi->u.ws.mask_idx);
 
 			/* copy the frame nonce into place */
 			memcpy(dropmask, wsi->u.ws.mask, 4);
@@ -554,6 +648,184 @@ send_raw:
 	return n - pre;
 }
 
+LWS_VISIBLE int
+lws_write_iov(struct lws *wsi, const struct lws_iovec *iov, int iovcnt,
+	      enum lws_write_protocol wp)
+{
+	struct lws_context *context = wsi->context;
+	struct lws_context_per_thread *pt = &context->pt[(int)wsi->tsi];
+	struct _lws_websocket_related *ws = &wsi->u.ws;
+	int masked = (wsi->mode == LWSCM_WS_CLIENT);
+	struct lws_iovec v[LWS_IOV_MAX + 1];
+	size_t total = 0, consumed = 0, limit, frag, chunk, hdr, skip, sent;
+	unsigned char opc, *p;
+	int i, c, n;
+
+	if (wsi->state != LWSS_ESTABLISHED)
+		return 0;
+
+	/* lws_write() leftovers go first */
+	if (wsi->trunc_len || ws->inside_frame) {
+		lws_callback_on_writable(wsi);
+		return 0;
+	}
+
+	if (iovcnt > LWS_IOV_MAX)
+		iovcnt = LWS_IOV_MAX;
+	for (i = 0; i < iovcnt; i++)
+		total += iov[i].len;
+
+	limit = wsi->protocol->rx_buffer_size;
+	if (!limit)
+		limit = context->pt_serv_buf_size;
+
+	lws_restart_ws_ping_pong_timer(wsi);
+
+	do {
+		if (!ws->tx_hdr_len) {
+			/* start the next frame */
+			frag = total - consumed;
+			if (frag > limit)
+				frag = limit;
+
+			if (ws->tx_stream)
+				opc = LWSWSOPC_CONTINUATION;
+			else if ((wp & 0xf) == LWS_WRITE_TEXT)
+				opc = LWSWSOPC_TEXT_FRAME;
+			else
+				opc = LWSWSOPC_BINARY_FRAME;
+
+			ws->tx_stream = 1;
+			if (consumed + frag == total && !(wp & LWS_WRITE_NO_FIN)) {
+				opc |= 1 << 7;
+				ws->tx_stream = 0;
+			}
+
+			if (masked && lws_0405_frame_mask_generate(wsi)) {
+				lwsl_err("frame mask generation failed\n");
+				return -1;
+			}
+
+			ws->tx_hdr_len = lws_ws_frame_header(ws->tx_hdr, opc,
+					frag, masked ? ws->mask : NULL);
+			ws->tx_hdr_sent = 0;
+			ws->tx_frame_remain = frag;
+		}
+
+		hdr = ws->tx_hdr_len - ws->tx_hdr_sent;
+		chunk = 0;
+
+		if (masked) {
+			/* mask while copying into the service buffer */
+			p = pt->serv_buf;
+			memcpy(p, &ws->tx_hdr[ws->tx_hdr_sent], hdr);
+			p += hdr;
+			skip = consumed;
+			for (i = 0; i < iovcnt &&
+			     chunk < ws->tx_frame_remain &&
+			     hdr + chunk < context->pt_serv_buf_size; i++) {
+				if (skip >= iov[i].len) {
+					skip -= iov[i].len;
+					continue;
+				}
+				n = iov[i].len - skip;
+				if ((size_t)n > ws->tx_frame_remain - chunk)
+					n = ws->tx_frame_remain - chunk;
+				if ((size_t)n > context->pt_serv_buf_size - hdr - chunk)
+					n = context->pt_serv_buf_size - hdr - chunk;
+				lws_mask_copy(p, (const unsigned char *)iov[i].base +
+					      skip, n, ws->mask, &ws->mask_idx);
+				p += n;
+				chunk += n;
+				skip = 0;
+			}
+			n = lws_ssl_capable_write(wsi, pt->serv_buf, hdr + chunk);
+		} else {
+			/* header remainder and the payload straight from iov */
+			c = 0;
+			if (hdr) {
+				v[c].base = &ws->tx_hdr[ws->tx_hdr_sent];
+				v[c++].len = hdr;
+			}
+			skip = consumed;
+			for (i = 0; i < iovcnt && chunk < ws->tx_frame_remain; i++) {
+				if (skip >= iov[i].len) {
+					skip -= iov[i].len;
+					continue;
+				}
+				v[c].base = (const unsigned char *)iov[i].base + skip;
+				v[c].len = iov[i].len - skip;
+				if (v[c].len > ws->tx_frame_remain - chunk)
+					v[c].len = ws->tx_frame_remain - chunk;
+				chunk += v[c++].len;
+				skip = 0;
+			}
+#if LWS_POSIX
+#ifdef LWS_OPENSSL_SUPPORT
+			if (!wsi->ssl)
+#endif
+				n = lws_plat_writev(wsi, v, c);
+#ifdef LWS_OPENSSL_SUPPORT
+			else {
+				/* tls takes one record at a time */
+				p = pt->serv_buf;
+				for (i = 0; i < c; i++) {
+					skip = context->pt_serv_buf_size -
+					       (p - pt->serv_buf);
+					if (skip > v[i].len)
+						skip = v[i].len;
+					memcpy(p, v[i].base, skip);
+					p += skip;
+				}
+				chunk = (p - pt->serv_buf) - hdr;
+				n = lws_ssl_capable_write(wsi, pt->serv_buf,
+							  p - pt->serv_buf);
+			}
+#endif
+#else
+			n = LWS_SSL_CAPABLE_ERROR;
+#endif
+		}
+
+		if (n == LWS_SSL_CAPABLE_ERROR) {
+			lwsl_info("%s: write failed\n", __func__);
+			return -1;
+		}
+		if (n < 0)
+			n = 0;
+
+		if ((size_t)n < hdr) {
+			ws->tx_hdr_sent += n;
+			sent = 0;
+		} else {
+			ws->tx_hdr_sent = ws->tx_hdr_len;
+			sent = n - hdr;
+		}
+
+		/* the unsent bytes are masked again on the next call */
+		if (masked)
+			ws->mask_idx = (ws->mask_idx - (chunk - sent)) & 3;
+
+		ws->tx_frame_remain -= sent;
+		consumed += sent;
+		if (wsi->vhost)
+			wsi->vhost->tx += sent;
+#ifdef LWS_WITH_ACCESS_LOG
+		wsi->access_log.sent += sent;
+#endif
+		if (!ws->tx_frame_remain && ws->tx_hdr_sent == ws->tx_hdr_len)
+			ws->tx_hdr_len = 0;
+
+		if ((size_t)n < hdr + chunk) {
+			/* socket is full, continue from the writable callback */
+			lws_callback_on_writable(wsi);
+			break;
+		}
+	} while (consumed < total);
+
+	return (int)consumed;
+}
+
 LWS_VISIBLE int lws_serve_http_file_fragment(struct lws *wsi)
 {
 	struct lws_context *context = wsi->context;
@@ -1203,6 +1203,12 @@ struct _lws_websocket_related {
 	/* Also used for close content... control opcode == < 128 */
 	unsigned char ping_payload_buf[128 - 3 + LWS_PRE];
 
+	/* lws_write_iov() frame in progress */
+	size_t tx_frame_remain;
+	unsigned char tx_hdr[14];
+	unsigned char tx_hdr_len;
+	unsigned char tx_hdr_sent;
+
 	unsigned char ping_payload_len;
 	unsigned char mask_idx;
 	unsigned char opcode;
@@ -1231,6 +1237,7 @@ struct _lws_websocket_related {
 	unsigned int rx_draining_ext:1;
 	unsigned int tx_draining_ext:1;
 	unsigned int send_check_ping:1;
+	unsigned int tx_stream:1; /* lws_write_iov() message not finished */
 };
 
 #ifdef LWS_WITH_CGI
@@ -1903,6 +1910,8 @@ LWS_EXTERN int
 lws_poll_listen_fd(struct lws_pollfd *fd);
 LWS_EXTERN int
 lws_plat_service(struct lws_context *context, int timeout_ms);
+LWS_EXTERN int
+lws_plat_writev(struct lws *wsi, const struct lws_iovec *iov, int iovcnt);
 LWS_EXTERN LWS_VISIBLE int
 lws_plat_service_tsi(struct lws_context *context, int timeout_ms, int tsi);
 LWS_EXTERN int
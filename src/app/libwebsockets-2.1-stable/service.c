@@ -110,6 +110,12 @@ lws_handle_POLLOUT_event(struct lws *wsi, struct lws_pollfd *pollfd)
 		goto user_service_go_again;
 #endif
 
+	/* a frame lws_write_iov() has partly sent is finished by the user
+	 * callback before control packets, they would land inside it
+	 */
+	if (wsi->state == LWSS_ESTABLISHED && wsi->u.ws.tx_hdr_len)
+		goto user_service;
+
 	/* Priority 3: pending control packets (pong or close)
 	 */
 	if ((wsi->state == LWSS_ESTABLISHED &&
@@ -14,6 +14,16 @@
 #define MQTT_USERNAME_FLAG  (1<<7)
 #define MQTT_PASSWORD_FLAG  (1<<6)
 
+// Small iovec parts are gathered in a stack buffer of this size and sent
+// with one mqttsend call, so the headers of a packet do not go out alone
+#define MQTT_SEND_GATHER_SIZE  128
+
+// Largest CONNECT packet: fixed header, variable header, client id,
+// username and password, each string with its 2 byte length
+#define MQTT_CONNECT_MAX_SIZE  (MQTT_MAX_FIXED_HEADER + 12 + 6 + \
+                                sizeof(((mqtt_broker_handle_t*)0)->clientid) + \
+                                MQTT_CONF_USERNAME_LENGTH + MQTT_CONF_PASSWORD_LENGTH)
+
 uint8_t mqtt_num_rem_len_bytes(const uint8_t* buf) {
     uint8_t num_bytes = 1;
 
@@ -31,10 +41,11 @@ uint8_t mqtt_num_rem_len_bytes(const uint8_t* buf) {
     return num_bytes;
 }
 
-uint16_t mqtt_parse_rem_len(const uint8_t* buf) {
-    uint16_t multiplier = 1;
-    uint16_t value = 0;
+uint32_t mqtt_parse_rem_len(const uint8_t* buf) {
+    uint32_t multiplier = 1;
+    uint32_t value = 0;
     uint8_t digit;
+    uint8_t i = 0;
 
     //printf("mqtt_parse_rem_len\n");
 
@@ -45,7 +56,7 @@ uint16_t mqtt_parse_rem_len(const uint8_t* buf) {
         value += (digit & 127) * multiplier;
         multiplier *= 128;
         buf++;
-    } while ((digit & 128) != 0);
+    } while ((digit & 128) != 0 && ++i < 4);
 
     return value;
 }
@@ -54,16 +65,16 @@ uint16_t mqtt_parse_msg_id(const uint8_t* buf) {
     uint8_t type = MQTTParseMessageType(buf);
     uint8_t qos = MQTTParseMessageQos(buf);
     uint16_t id = 0;
-	
+
     //printf("mqtt_parse_msg_id\n");
-	
+
     if(type >= MQTT_MSG_PUBLISH && type <= MQTT_MSG_UNSUBACK) {
         if(type == MQTT_MSG_PUBLISH) {
             if(qos != 0) {
                 // fixed header length + Topic (UTF encoded)
                 // = 1 for "flags" byte + rlb for length bytes + topic size
                 uint8_t rlb = mqtt_num_rem_len_bytes(buf);
-                uint8_t offset = *(buf+1+rlb)<<8;	// topic UTF MSB
+                uint32_t offset = *(buf+1+rlb)<<8;	// topic UTF MSB
                 offset |= *(buf+1+rlb+1);			// topic UTF LSB
                 offset += (1+rlb+2);					// fixed header + topic size
                 id = *(buf+offset)<<8;				// id MSB
@@ -83,19 +94,19 @@ uint16_t mqtt_parse_msg_id(const uint8_t* buf) {
 uint16_t mqtt_parse_pub_topic(const uint8_t* buf, uint8_t* topic) {
     const uint8_t* ptr;
     uint16_t topic_len = mqtt_parse_pub_topic_ptr(buf, &ptr);
-	
+
     //printf("mqtt_parse_pub_topic\n");
-	
+
     if(topic_len != 0 && ptr != NULL) {
         memcpy(topic, ptr, topic_len);
     }
-	
+
     return topic_len;
 }
 
 uint16_t mqtt_parse_pub_topic_ptr(const uint8_t* buf, const uint8_t **topic_ptr) {
     uint16_t len = 0;
-	
+
     //printf("mqtt_parse_pub_topic_ptr\n");
 
     if(MQTTParseMessageType(buf) == MQTT_MSG_PUBLISH) {
@@ -111,9 +122,9 @@ uint16_t mqtt_parse_pub_topic_ptr(const uint8_t* buf, const uint8_t **topic_ptr)
     return len;
 }
 
-uint16_t mqtt_parse_publish_msg(const uint8_t* buf, uint8_t** msg) {
+uint32_t mqtt_parse_publish_msg(const uint8_t* buf, uint8_t** msg) {
     uint8_t* ptr;
-    uint16_t msg_len = mqtt_parse_pub_msg_ptr(buf, (const uint8_t **)&ptr);
+    uint32_t msg_len = mqtt_parse_pub_msg_ptr(buf, (const uint8_t **)&ptr);
 
     if(msg_len != 0 && ptr != NULL) {
         //memcpy(msg, ptr, msg_len);
@@ -123,8 +134,8 @@ uint16_t mqtt_parse_publish_msg(const uint8_t* buf, uint8_t** msg) {
     return msg_len;
 }
 
-uint16_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t **msg_ptr) {
-    uint16_t len = 0;
+uint32_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t **msg_ptr) {
+    uint32_t len = 0;
 
     //printf("mqtt_parse_pub_msg_ptr\n");
 
@@ -132,7 +143,7 @@ uint16_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t **msg_ptr) {
         // message starts at
         // fixed header length + Topic (UTF encoded) + msg id (if QoS>0)
         uint8_t rlb = mqtt_num_rem_len_bytes(buf);
-        uint8_t offset = (*(buf+1+rlb))<<8;	// topic UTF MSB
+        uint32_t offset = (*(buf+1+rlb))<<8;	// topic UTF MSB
         offset |= *(buf+1+rlb+1);			// topic UTF LSB
         offset += (1+rlb+2);				// fixed header + topic size
 
@@ -141,7 +152,7 @@ uint16_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t **msg_ptr) {
         }
 
         *msg_ptr = (buf + offset);
-				
+
         // offset is now pointing to start of message
         // length of the message is remaining length - variable header
         // variable header is offset - fixed header
@@ -154,17 +165,164 @@ uint16_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t **msg_ptr) {
     return len;
 }
 
+// Start over at the fixed header of the next packet
+static void mqtt_parser_init_state(mqtt_parser_t* parser) {
+    parser->len = 0;
+    parser->rem_len = 0;
+    parser->need = 0;
+    parser->multiplier = 1;
+}
+
+void mqtt_parser_init(mqtt_parser_t* parser, uint8_t* buf, uint32_t size) {
+    memset(parser, 0, sizeof(mqtt_parser_t));
+    parser->buf = buf;
+    parser->size = size;
+    parser->multiplier = 1;
+}
+
+int mqtt_parser_feed(mqtt_parser_t* parser, const uint8_t* data, uint32_t len,
+                     mqtt_packet_fn fn, void* arg) {
+    int packets = 0;
+    uint32_t n;
+    uint8_t byte;
+
+    while(len) {
+        // rest of a packet that did not fit into the buffer
+        if(parser->discard) {
+            n = (len < parser->discard) ? len : parser->discard;
+            parser->discard -= n;
+            data += n;
+            len -= n;
+            continue;
+        }
+
+        // fixed header, byte by byte until the remaining length is complete
+        if(parser->need == 0) {
+            byte = *data++;
+            len--;
+            parser->buf[parser->len++] = byte;
+            if(parser->len == 1) {
+                continue;
+            }
+            parser->rem_len += (byte & 127) * parser->multiplier;
+            parser->multiplier *= 128;
+            if(byte & 128) {
+                if(parser->len == MQTT_MAX_FIXED_HEADER) {
+                    // a fifth length byte, the stream is out of sync
+                    mqtt_parser_init(parser, parser->buf, parser->size);
+                    return -1;
+                }
+                continue;
+            }
+            parser->need = parser->len + parser->rem_len;
+            if(parser->need > parser->size) {
+                parser->discard = parser->rem_len;
+                parser->dropped++;
+                mqtt_parser_init_state(parser);
+                continue;
+            }
+        }
+
+        n = parser->need - parser->len;
+        if(n > len) {
+            n = len;
+        }
+        memcpy(parser->buf + parser->len, data, n);
+        parser->len += n;
+        data += n;
+        len -= n;
+
+        if(parser->len == parser->need) {
+            fn(arg, parser->buf, parser->len);
+            packets++;
+            mqtt_parser_init_state(parser);
+        }
+    }
+    return packets;
+}
+
+uint8_t mqtt_encode_rem_len(uint8_t* buf, uint32_t len) {
+    uint8_t num_bytes = 0;
+    uint8_t digit;
+
+    if(len > MQTT_MAX_REM_LEN) {
+        return 0;
+    }
+    do {
+        digit = len % 128;
+        len /= 128;
+        if(len > 0) {
+            digit |= 0x80;
+        }
+        buf[num_bytes++] = digit;
+    } while(len > 0);
+    return num_bytes;
+}
+
+// Message identifiers run from 1 to 65535, 0 is not allowed
+static uint16_t mqtt_next_id(mqtt_broker_handle_t* broker) {
+    uint16_t id = broker->seq++;
+
+    if(id == 0) {
+        id = broker->seq++;
+    }
+    return id;
+}
+
+// Send the parts of one packet. Without mqttsendv the small parts are
+// gathered in a stack buffer, large parts are passed to mqttsend in place.
+static int mqtt_sendv(mqtt_broker_handle_t* broker, const mqtt_iovec_t* iov, int iovcnt) {
+    uint8_t gather[MQTT_SEND_GATHER_SIZE];
+    uint32_t used = 0;
+    uint32_t total = 0;
+    int i;
+
+    for(i = 0; i < iovcnt; i++) {
+        total += iov[i].len;
+    }
+    if(broker->mqttsendv) {
+        return (broker->mqttsendv(broker->socketid, iov, iovcnt) < (int)total) ? -1 : 1;
+    }
+
+    for(i = 0; i < iovcnt; i++) {
+        if(iov[i].len <= sizeof(gather) - used) {
+            memcpy(gather + used, iov[i].base, iov[i].len);
+            used += iov[i].len;
+            continue;
+        }
+        if(used) {
+            if(broker->mqttsend(broker->socketid, gather, used) < (int)used) {
+                return -1;
+            }
+            used = 0;
+        }
+        if(iov[i].len <= sizeof(gather)) {
+            memcpy(gather, iov[i].base, iov[i].len);
+            used = iov[i].len;
+        } else if(broker->mqttsend(broker->socketid, iov[i].base, iov[i].len) < (int)iov[i].len) {
+            return -1;
+        }
+    }
+    if(used) {
+        if(broker->mqttsend(broker->socketid, gather, used) < (int)used) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
 void mqtt_init(mqtt_broker_handle_t* broker, const char* clientid) {
 
     // Connection options
     broker->alive =  CLOUD_MQTT_SET_ALIVE; // 120 seconds = 2 minutes
     broker->seq = 1; // Sequency for message indetifiers
+    broker->mqttsendv = NULL;
     // Client options
     memset(broker->clientid, 0, sizeof(broker->clientid));
     memset(broker->username, 0, sizeof(broker->username));
     memset(broker->password, 0, sizeof(broker->password));
     if(clientid) {
-        strncpy(broker->clientid, clientid, sizeof(broker->clientid));
+        strncpy(broker->clientid, clientid, sizeof(broker->clientid)-1);
     } else {
         strcpy(broker->clientid, "emqtt");
     }
@@ -173,7 +331,7 @@ void mqtt_init(mqtt_broker_handle_t* broker, const char* clientid) {
 }
 
 void mqtt_init_auth(mqtt_broker_handle_t* broker, const char* username, const char* password) {
-	
+
     if(username && username[0] != '\0')
     {
         strncpy(broker->username, username, sizeof(broker->username)-1);
@@ -182,125 +340,82 @@ void mqtt_init_auth(mqtt_broker_handle_t* broker, const char* username, const ch
     {
         strncpy(broker->password, password, sizeof(broker->password)-1);
     }
-	
+
 }
 
 void mqtt_set_alive(mqtt_broker_handle_t* broker, uint16_t alive) {
     broker->alive = alive;
 }
 
-int mqtt_connect(mqtt_broker_handle_t* broker)
-{
+static uint32_t mqtt_put_string(uint8_t* buf, const char* str, uint16_t len) {
+    buf[0] = len>>8;
+    buf[1] = len&0xFF;
+    memcpy(buf+2, str, len);
+    return len + 2;
+}
+
+int mqtt_encode_connect(mqtt_broker_handle_t* broker, uint8_t* buf, uint32_t size) {
     uint8_t flags = 0x00;
-    int ret;
-    /****************************add by alex********************************************/
-    uint8_t *fixed_header = NULL;
-    int fixed_headerLen;
-    uint8_t *packet =NULL;
-    int packetLen;
-    uint16_t offset = 0;
-    uint16_t clientidlen,usernamelen,passwordlen,payload_len;
-    uint8_t fixedHeaderSize;
-    uint8_t remainLen;
-    uint8_t var_header[12] = {
+    uint16_t clientidlen,usernamelen,passwordlen;
+    uint32_t remainLen;
+    uint32_t offset;
+    static const uint8_t protocol[] = {
         0x00,0x06,0x4d,0x51,0x49,0x73,0x64,0x70, // Protocol name: MQIsdp
         0x03, // Protocol version
-        0, // Connect flags
-        0, 0, // Keep alive
     };
-		
-    var_header[10]=  broker->alive>>8;
-    var_header[11]= broker->alive&0xFF;
 
-    /***********************************************************************************/	
-	
     clientidlen = strlen(broker->clientid);
     usernamelen = strlen(broker->username);
     passwordlen = strlen(broker->password);
-    payload_len = clientidlen + 2;
+    remainLen = sizeof(protocol) + 3 + clientidlen + 2;
     // Preparing the flags
     if(usernamelen) {
-        payload_len += usernamelen + 2;
+        remainLen += usernamelen + 2;
         flags |= MQTT_USERNAME_FLAG;
     }
     if(passwordlen) {
-        payload_len += passwordlen + 2;
+        remainLen += passwordlen + 2;
         flags |= MQTT_PASSWORD_FLAG;
     }
     if(broker->clean_session) {
         flags |= MQTT_CLEAN_SESSION;
     }
-    var_header[9]= flags;
-
-    // Fixed header
-    fixedHeaderSize = 2;    // Default size = one byte Message Type + one byte Remaining Length
-    remainLen = sizeof(var_header)+payload_len;
-    if (remainLen > 127) {
-        fixedHeaderSize++;          // add an additional byte for Remaining Length
-    }
-    
-    fixed_header = (uint8_t*)tls_mem_alloc( fixedHeaderSize );
-    if( fixed_header==NULL )
-    {
+    if(size < MQTT_MAX_FIXED_HEADER + remainLen) {
         return -1;
     }
-    fixed_headerLen = fixedHeaderSize;
-    // Message Type
-    fixed_header[0] = MQTT_MSG_CONNECT;
-
-    // Remaining Length
-    if (remainLen <= 127) {
-        fixed_header[1] = remainLen;
-    } else {
-        // first byte is remainder (mod) of 128, then set the MSB to indicate more bytes
-        fixed_header[1] = remainLen % 128;
-        fixed_header[1] = fixed_header[1] | 0x80;
-        // second byte is number of 128s
-        fixed_header[2] = remainLen / 128;
-    }
-	
-    packet = (uint8_t*)tls_mem_alloc( fixed_headerLen+sizeof(var_header)+payload_len );
-    if( packet==NULL )
-    {
-        tls_mem_free(fixed_header);
-        return -2;
-    }
-    packetLen = fixed_headerLen+sizeof(var_header)+payload_len ;
-    memset(packet, 0, packetLen);
-    memcpy(packet, fixed_header, fixed_headerLen);
-    offset += fixed_headerLen;
-    memcpy(packet+offset, var_header, sizeof(var_header));
-    offset += sizeof(var_header);
-    // Client ID - UTF encoded
-    packet[offset++] = clientidlen>>8;
-    packet[offset++] = clientidlen&0xFF;
-    memcpy(packet+offset, broker->clientid, clientidlen);
-    offset += clientidlen;
 
+    // Fixed header
+    buf[0] = MQTT_MSG_CONNECT;
+    offset = 1 + mqtt_encode_rem_len(buf+1, remainLen);
+    // Variable header
+    memcpy(buf+offset, protocol, sizeof(protocol));
+    offset += sizeof(protocol);
+    buf[offset++] = flags;
+    buf[offset++] = broker->alive>>8;
+    buf[offset++] = broker->alive&0xFF;
+    // Client ID, username and password - UTF encoded
+    offset += mqtt_put_string(buf+offset, broker->clientid, clientidlen);
     if(usernamelen) {
-        // Username - UTF encoded
-        packet[offset++] = usernamelen>>8;
-        packet[offset++] = usernamelen&0xFF;
-        memcpy(packet+offset, broker->username, usernamelen);
-        offset += usernamelen;
+        offset += mqtt_put_string(buf+offset, broker->username, usernamelen);
     }
-
     if(passwordlen) {
-        // Password - UTF encoded
-        packet[offset++] = passwordlen>>8;
-        packet[offset++] = passwordlen&0xFF;
-        memcpy(packet+offset, broker->password, passwordlen);
-        offset += passwordlen;
-    }	
-
-    ret = broker->mqttsend(broker->socketid, packet, packetLen);
-    if(ret < packetLen) {      
-        tls_mem_free(fixed_header);
-        tls_mem_free(packet);
+        offset += mqtt_put_string(buf+offset, broker->password, passwordlen);
+    }
+    return offset;
+}
+
+int mqtt_connect(mqtt_broker_handle_t* broker)
+{
+    uint8_t packet[MQTT_CONNECT_MAX_SIZE];
+    int packetLen;
+
+    packetLen = mqtt_encode_connect(broker, packet, sizeof(packet));
+    if(packetLen < 0) {
+        return -1;
+    }
+    if(broker->mqttsend(broker->socketid, packet, packetLen) < packetLen) {
         return -3;
-    } 
-    tls_mem_free(fixed_header);
-    tls_mem_free(packet);
+    }
     return 0;
 }
 
@@ -333,127 +448,101 @@ int mqtt_ping(mqtt_broker_handle_t* broker) {
     return 1;
 }
 
+int mqtt_encode_publish_header(uint8_t* buf, uint32_t size, const char* topic, uint32_t msgLen,
+                               uint8_t retain, uint8_t qos, uint16_t message_id) {
+    uint16_t topiclen = strlen(topic);
+    uint32_t remainLen = 2 + topiclen + msgLen;
+    uint32_t offset;
+
+    if(qos) {
+        remainLen += 2;
+    }
+    if(remainLen > MQTT_MAX_REM_LEN || size < MQTT_MAX_FIXED_HEADER + 2 + topiclen + 2) {
+        return -1;
+    }
+
+    // Message Type, DUP flag, QoS level, Retain
+    buf[0] = MQTT_MSG_PUBLISH | ((qos & 3) << 1);
+    if(retain) {
+        buf[0] |= MQTT_RETAIN_FLAG;
+    }
+    offset = 1 + mqtt_encode_rem_len(buf+1, remainLen);
+    // Topic - UTF encoded, and the message id
+    offset += mqtt_put_string(buf+offset, topic, topiclen);
+    if(qos) {
+        buf[offset++] = message_id>>8;
+        buf[offset++] = message_id&0xFF;
+    }
+    return offset;
+}
+
+int mqtt_encode_publish(uint8_t* buf, uint32_t size, const char* topic, const void* msg, uint32_t msgLen,
+                        uint8_t retain, uint8_t qos, uint16_t message_id) {
+    int headerLen = mqtt_encode_publish_header(buf, size, topic, msgLen, retain, qos, message_id);
+
+    if(headerLen < 0 || size - headerLen < msgLen) {
+        return -1;
+    }
+    memcpy(buf+headerLen, msg, msgLen);
+    return headerLen + msgLen;
+}
+
 int mqtt_publish(mqtt_broker_handle_t* broker, const char* topic, const char* msg, int msgLen, uint8_t retain) {
     return mqtt_publish_with_qos(broker, topic, msg, msgLen,retain, 0, NULL);
 }
-int mqtt_publish_with_qos(mqtt_broker_handle_t* broker, 
-                             const char* topic, 
+int mqtt_publish_with_qos(mqtt_broker_handle_t* broker,
+                             const char* topic,
                              const char* msg,
-                             int msgLen, 
-                             uint8_t retain, 
-                             uint8_t qos, 
-                             uint16_t* message_id) 
+                             int msgLen,
+                             uint8_t retain,
+                             uint8_t qos,
+                             uint16_t* message_id)
 {
     uint16_t topiclen = strlen(topic);
-
-    uint8_t qos_flag = MQTT_QOS0_FLAG;
-    uint8_t qos_size = 0; // No QoS included
-/************************add by alex****************************/
-    int var_headerLen;
+    uint16_t id = 0;
+    uint8_t fixed_header[MQTT_MAX_FIXED_HEADER + 2];
+    uint8_t msg_id[2];
+    mqtt_iovec_t iov[4];
+    uint32_t remainLen;
     int fixed_headerLen;
-    int packetLen;
+    int iovcnt = 0;
 
-    uint8_t *var_header=NULL;
-    uint8_t *fixed_header=NULL;
-    uint8_t fixedHeaderSize = 2;
-    uint16_t remainLen;
-/***************************************************************/	
-
-    if(qos == 1) {
-        qos_size = 2; // 2 bytes for QoS
-        qos_flag = MQTT_QOS1_FLAG;
-    }
-    else if(qos == 2) {
-        qos_size = 2; // 2 bytes for QoS
-        qos_flag = MQTT_QOS2_FLAG;
+    if(qos > 2 || msgLen < 0) {
+        return -1;
     }
-/************************add by alex*******************************/
-    // Variable header
-    var_header = ( uint8_t* )tls_mem_alloc( topiclen+2+qos_size );
-    
-    if( var_header==NULL )
-    {
+    remainLen = 2 + topiclen + msgLen + (qos ? 2 : 0);
+    if(remainLen > MQTT_MAX_REM_LEN) {
         return -1;
     }
-    
-    var_headerLen = topiclen+2+qos_size;
-/******************************************************************/
-    memset(var_header, 0, var_headerLen);
-    var_header[0] = topiclen>>8;
-    var_header[1] = topiclen&0xFF;
-    memcpy(var_header+2, topic, topiclen);
-    if(qos_size) {
-        var_header[topiclen+2] = broker->seq>>8;
-        var_header[topiclen+3] = broker->seq&0xFF;
+    if(qos) {
+        id = mqtt_next_id(broker);
         if(message_id) { // Returning message id
-            *message_id = broker->seq;
+            *message_id = id;
         }
-        broker->seq++;
-    }
-
-    // Fixed header
-    // the remaining length is one byte for messages up to 127 bytes, then two bytes after that
-    // actually, it can be up to 4 bytes but I'm making the assumption the embedded device will only
-    // need up to two bytes of length (handles up to 16,383 (almost 16k) sized message)
-
-    /**********************add by alex**************************************/
-    remainLen = var_headerLen+msgLen;
-    /***********************************************************************/
-    if (remainLen > 127) {
-        fixedHeaderSize++;          // add an additional byte for Remaining Length
     }
 
-    /***********************add by alex *******************/
-    fixed_headerLen = fixedHeaderSize;
-    fixed_header = (uint8_t *)tls_mem_alloc( fixed_headerLen );
-    if( fixed_header==NULL )
-    {
-        tls_mem_free( var_header );
-        return -1;
-    }
-    /******************************************************/
-    
-    // Message Type, DUP flag, QoS level, Retain
-    fixed_header[0] = MQTT_MSG_PUBLISH | qos_flag;
+    // Fixed header and topic length, then topic, message id and payload in place
+    fixed_header[0] = MQTT_MSG_PUBLISH | (qos << 1);
     if(retain) {
         fixed_header[0] |= MQTT_RETAIN_FLAG;
     }
-    // Remaining Length
-    if (remainLen <= 127) {
-        fixed_header[1] = remainLen;
-    } else {
-        // first byte is remainder (mod) of 128, then set the MSB to indicate more bytes
-        fixed_header[1] = remainLen % 128;
-        fixed_header[1] = fixed_header[1] | 0x80;
-        // second byte is number of 128s
-        fixed_header[2] = remainLen / 128;
-    }
-    /**********************add by alex******************************/
-    packetLen = fixed_headerLen+var_headerLen+msgLen;
-    //uint8_t packet[packetLen];
-    uint8_t *packet = tls_mem_alloc(packetLen);
-    if (!packet)
-    {
-        tls_mem_free(var_header);
-        tls_mem_free( fixed_header );
-        return -1;
-    }
-    memset(packet, 0, packetLen);
-    memcpy(packet, fixed_header, fixed_headerLen);
-    memcpy(packet+fixed_headerLen, var_header, var_headerLen);
-    memcpy(packet+fixed_headerLen+var_headerLen, msg, msgLen);
-
-    // Send the packet
-    if(broker->mqttsend(broker->socketid, packet, packetLen ) < packetLen) {
-        tls_mem_free(var_header);
-        tls_mem_free( fixed_header );
-        tls_mem_free(packet);
-        return -1;
-    }
-    tls_mem_free( fixed_header );
-    tls_mem_free(var_header);
-    tls_mem_free(packet);
-    return 1;
+    fixed_headerLen = 1 + mqtt_encode_rem_len(fixed_header+1, remainLen);
+    fixed_header[fixed_headerLen++] = topiclen>>8;
+    fixed_header[fixed_headerLen++] = topiclen&0xFF;
+    iov[iovcnt].base = fixed_header;
+    iov[iovcnt++].len = fixed_headerLen;
+    iov[iovcnt].base = topic;
+    iov[iovcnt++].len = topiclen;
+    if(qos) {
+        msg_id[0] = id>>8;
+        msg_id[1] = id&0xFF;
+        iov[iovcnt].base = msg_id;
+        iov[iovcnt++].len = sizeof(msg_id);
+    }
+    iov[iovcnt].base = msg;
+    iov[iovcnt++].len = msgLen;
+
+    return mqtt_sendv(broker, iov, iovcnt);
 }
 
 int mqtt_pubrel(mqtt_broker_handle_t* broker, uint16_t message_id) {
@@ -475,134 +564,73 @@ int mqtt_pubrel(mqtt_broker_handle_t* broker, uint16_t message_id) {
     return 1;
 }
 
-int mqtt_subscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* message_id) {
+// SUBSCRIBE and UNSUBSCRIBE of one topic: message id, topic and for
+// SUBSCRIBE the requested QoS byte
+static int mqtt_encode_topic_request(uint8_t type, uint8_t* buf, uint32_t size, const char* topic,
+                                     int qos, uint16_t message_id) {
     uint16_t topiclen = strlen(topic);
+    uint32_t remainLen = 2 + 2 + topiclen + (qos >= 0 ? 1 : 0);
+    uint32_t offset;
 
-    /******************add by alex*********************/
-    uint8_t *utf_topic=NULL;
-    uint8_t *packet=NULL;	
-    int utf_topicLen;
-    int packetLen;	
-    uint8_t fixed_header[2];
-
-    /*************************************************/
-
-    // Variable header
-    uint8_t var_header[2]; // Message ID
-    var_header[0] = broker->seq>>8;
-    var_header[1] = broker->seq&0xFF;
-    if(message_id) { // Returning message id
-        *message_id = broker->seq;
-    }
-    broker->seq++;
-
-    /*******************add by alex**************************/
-    // utf topic
-    //uint8_t utf_topic[topiclen+3]; // Topic size (2 bytes), utf-encoded topic, QoS byte
-    utf_topic = ( uint8_t*)tls_mem_alloc( topiclen+3 );
-    if( utf_topic==NULL )
-    {
+    if(size < MQTT_MAX_FIXED_HEADER + remainLen) {
         return -1;
     }
-    utf_topicLen = topiclen+3;
-    memset(utf_topic, 0, utf_topicLen);
-    utf_topic[0] = topiclen>>8;
-    utf_topic[1] = topiclen&0xFF;
-    memcpy(utf_topic+2, topic, topiclen);
-    /*********************************************************/
-	
-    /********************add by alex***********************/
-    // Fixed header
-    fixed_header[0] = MQTT_MSG_SUBSCRIBE | MQTT_QOS1_FLAG;
-    fixed_header[1] = sizeof(var_header)+utf_topicLen;
-    /******************************************************/
-	
-    /***********************add by alex********************/		
-    packetLen = sizeof(var_header)+sizeof(fixed_header)+utf_topicLen;
-    packet = (uint8_t*)tls_mem_alloc( packetLen );
-    if( packet==NULL )
-    {
-        tls_mem_free(utf_topic);
-        return -1;
+    buf[0] = type | MQTT_QOS1_FLAG;
+    offset = 1 + mqtt_encode_rem_len(buf+1, remainLen);
+    buf[offset++] = message_id>>8;
+    buf[offset++] = message_id&0xFF;
+    offset += mqtt_put_string(buf+offset, topic, topiclen);
+    if(qos >= 0) {
+        buf[offset++] = qos;
     }
-    memset(packet, 0, packetLen);
-    memcpy(packet, fixed_header, sizeof(fixed_header));
-    memcpy(packet+sizeof(fixed_header), var_header, sizeof(var_header));
-    memcpy(packet+sizeof(fixed_header)+sizeof(var_header), utf_topic, utf_topicLen);
+    return offset;
+}
 
-    // Send the packet
-    if(broker->mqttsend(broker->socketid, packet, packetLen) < packetLen) {
-        tls_mem_free(utf_topic);
-        tls_mem_free(packet);
-        return -1;
-    }
-    /*******************************************************/
-    tls_mem_free(utf_topic);
-    tls_mem_free(packet);
-    return 1;
+int mqtt_encode_subscribe(uint8_t* buf, uint32_t size, const char* topic, uint8_t qos, uint16_t message_id) {
+    return mqtt_encode_topic_request(MQTT_MSG_SUBSCRIBE, buf, size, topic, qos & 3, message_id);
 }
 
-int mqtt_unsubscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* message_id) {
+int mqtt_encode_unsubscribe(uint8_t* buf, uint32_t size, const char* topic, uint16_t message_id) {
+    return mqtt_encode_topic_request(MQTT_MSG_UNSUBSCRIBE, buf, size, topic, -1, message_id);
+}
 
+// Send a SUBSCRIBE or UNSUBSCRIBE, the topic is not copied
+static int mqtt_send_topic_request(mqtt_broker_handle_t* broker, uint8_t type, const char* topic,
+                                   uint16_t* message_id) {
     uint16_t topiclen = strlen(topic);
+    uint16_t id = mqtt_next_id(broker);
+    uint8_t header[MQTT_MAX_FIXED_HEADER + 4];
+    uint8_t qos = 0;
+    mqtt_iovec_t iov[3];
+    int headerLen;
+    int iovcnt = 0;
 
-    /******************add by alex*******************/
-    uint8_t *utf_topic=NULL;
-    int utf_topicLen;
-    uint8_t fixed_header[2];
-    uint8_t *packet = NULL;
-    int packetLen;
-
-    /************************************************/
-    // Variable header
-    uint8_t var_header[2]; // Message ID
-    var_header[0] = broker->seq>>8;
-    var_header[1] = broker->seq&0xFF;
     if(message_id) { // Returning message id
-        *message_id = broker->seq;
-    }
-    broker->seq++;
-    /******************add by alex**********************************/
-    // utf topic	
-    utf_topic = (uint8_t*)tls_mem_alloc( topiclen+2 );
-    if( utf_topic==NULL )
-    {
-        return -1;
-    }
-    utf_topicLen = topiclen+2;
-    memset(utf_topic, 0, utf_topicLen);
-    utf_topic[0] = topiclen>>8;
-    utf_topic[1] = topiclen&0xFF;
-    memcpy(utf_topic+2, topic, topiclen);
-    /***************************************************************/
-
-    /*************************add by alex*******************************/
-    // Fixed header
-    fixed_header[0] = MQTT_MSG_UNSUBSCRIBE | MQTT_QOS1_FLAG;
-    fixed_header[1] = sizeof(var_header)+utf_topicLen;
+        *message_id = id;
+    }
+    header[0] = type | MQTT_QOS1_FLAG;
+    headerLen = 1 + mqtt_encode_rem_len(header+1, 4 + topiclen + (type == MQTT_MSG_SUBSCRIBE ? 1 : 0));
+    header[headerLen++] = id>>8;
+    header[headerLen++] = id&0xFF;
+    header[headerLen++] = topiclen>>8;
+    header[headerLen++] = topiclen&0xFF;
+    iov[iovcnt].base = header;
+    iov[iovcnt++].len = headerLen;
+    iov[iovcnt].base = topic;
+    iov[iovcnt++].len = topiclen;
+    if(type == MQTT_MSG_SUBSCRIBE) {
+        iov[iovcnt].base = &qos; // requested QoS
+        iov[iovcnt++].len = 1;
+    }
+    return mqtt_sendv(broker, iov, iovcnt);
+}
 
-    packetLen = sizeof(var_header)+sizeof(fixed_header)+utf_topicLen;
-    packet = (uint8_t*)tls_mem_alloc( packetLen );
-    if( packet==NULL )
-    {
-        tls_mem_free(utf_topic);
-        return -1;
-    }
-    memset(packet, 0, packetLen);
-    memcpy(packet, fixed_header, sizeof(fixed_header));
-    memcpy(packet+sizeof(fixed_header), var_header, sizeof(var_header));
-    memcpy(packet+sizeof(fixed_header)+sizeof(var_header), utf_topic, utf_topicLen);
+int mqtt_subscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* message_id) {
+    return mqtt_send_topic_request(broker, MQTT_MSG_SUBSCRIBE, topic, message_id);
+}
 
-    // Send the packet
-    if(broker->mqttsend(broker->socketid, packet, packetLen) < packetLen) {
-        tls_mem_free(utf_topic);
-        tls_mem_free(packet);
-        return -1;
-    }
-    /***************************************************************/
-    tls_mem_free(utf_topic);
-    tls_mem_free(packet);
-    return 1;
+int mqtt_unsubscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* message_id) {
+    return mqtt_send_topic_request(broker, MQTT_MSG_UNSUBSCRIBE, topic, message_id);
 }
 
 void mqtt_login( mqtt_broker_handle_t* broker )
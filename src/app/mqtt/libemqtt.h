@@ -42,6 +42,9 @@
 
 #define CLOUD_MQTT_SET_ALIVE      (120)
 
+#define MQTT_MAX_REM_LEN          268435455 // 4 bytes of remaining length
+#define MQTT_MAX_FIXED_HEADER     5
+
 #define MQTT_MSG_CONNECT       (1<<4)
 #define MQTT_MSG_CONNACK       (2<<4)
 #define MQTT_MSG_PUBLISH       (3<<4)
@@ -109,7 +112,7 @@ uint8_t mqtt_num_rem_len_bytes(const uint8_t* buf);
  *
  * @retval remaining length
  */
-uint16_t mqtt_parse_rem_len(const uint8_t* buf);
+uint32_t mqtt_parse_rem_len(const uint8_t* buf);
 
 /** Parse packet buffer for message id.
  *
@@ -145,20 +148,82 @@ uint16_t mqtt_parse_pub_topic_ptr(const uint8_t* buf, const uint8_t** topic_ptr)
  * @param buf Pointer to the packet.
  * @param msg Pointer destination buffer for message
  *
- * @retval size in bytes of topic (0 = no publish message in buffer)
+ * @retval size in bytes of message (0 = no publish message in buffer)
  */
-uint16_t mqtt_parse_publish_msg(const uint8_t* buf, uint8_t** msg);
+uint32_t mqtt_parse_publish_msg(const uint8_t* buf, uint8_t** msg);
 
 /** Parse a packet buffer for a pointer to the publish message.
  *
  *  Not called directly - called by mqtt_parse_pub_msg
  */
-uint16_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t** msg_ptr);
+uint32_t mqtt_parse_pub_msg_ptr(const uint8_t* buf, const uint8_t** msg_ptr);
+
+/** Called by mqtt_parser_feed for every complete packet.
+ *
+ * @param arg Argument given to mqtt_parser_feed.
+ * @param packet Complete packet, fixed header included; valid during the call only.
+ * @param len Length of the packet.
+ */
+typedef void (*mqtt_packet_fn)(void* arg, const uint8_t* packet, uint32_t len);
+
+/** Incremental packet parser.
+ *
+ * Reassembles packets from a byte stream that arrives in pieces of any
+ * size. Packets larger than the buffer are skipped and counted in dropped.
+ */
+typedef struct {
+	uint8_t* buf;
+	uint32_t size;
+	uint32_t len;        // bytes of the current packet in buf
+	uint32_t rem_len;    // remaining length decoded so far
+	uint32_t need;       // total length of the current packet, 0 while in the fixed header
+	uint32_t multiplier;
+	uint32_t discard;    // bytes of an oversized packet still to skip
+	uint32_t dropped;    // number of oversized packets skipped
+} mqtt_parser_t;
+
+/** Initialize the incremental parser.
+ *
+ * @param parser Parser state.
+ * @param buf Buffer for one packet, at least MQTT_MAX_FIXED_HEADER bytes.
+ * @param size Size of buf.
+ */
+void mqtt_parser_init(mqtt_parser_t* parser, uint8_t* buf, uint32_t size);
+
+/** Feed received bytes to the parser.
+ *
+ * @param parser Parser state.
+ * @param data Received bytes.
+ * @param len Number of received bytes.
+ * @param fn Called for every complete packet.
+ * @param arg Passed to fn.
+ *
+ * @retval number of packets delivered, -1 on a malformed remaining length
+ */
+int mqtt_parser_feed(mqtt_parser_t* parser, const uint8_t* data, uint32_t len,
+                     mqtt_packet_fn fn, void* arg);
+
+/** Encode a remaining length value.
+ *
+ * @param buf Destination, at least 4 bytes.
+ * @param len Remaining length (up to MQTT_MAX_REM_LEN).
+ *
+ * @retval number of bytes written, 0 if len is too large
+ */
+uint8_t mqtt_encode_rem_len(uint8_t* buf, uint32_t len);
+
+/** One part of a packet for mqttsendv. */
+typedef struct {
+	const void* base;
+	uint32_t len;
+} mqtt_iovec_t;
 
 
 typedef struct {
 	int socketid;    
 	int (*mqttsend)(int socket_info, const void* buf, unsigned int count);
+	// Optional scatter send (e.g. lwip_writev), returns the bytes sent
+	int (*mqttsendv)(int socket_info, const mqtt_iovec_t* iov, int iovcnt);
 	// Connection info
 	char clientid[50];
 	// Auth fields
@@ -208,6 +273,16 @@ void mqtt_set_alive(mqtt_broker_handle_t* broker, uint16_t alive);
  */
 int mqtt_connect(mqtt_broker_handle_t* broker);
 
+/** Encode a CONNECT packet into a caller buffer.
+ *
+ * @param broker Data structure that contains the connection information with the broker.
+ * @param buf Destination buffer.
+ * @param size Size of buf.
+ *
+ * @retval packet length, -1 if buf is too small
+ */
+int mqtt_encode_connect(mqtt_broker_handle_t* broker, uint8_t* buf, uint32_t size);
+
 /** Disconnect to the broker.
  * @param broker Data structure that contains the connection information with the broker.
  *
@@ -245,6 +320,22 @@ int mqtt_publish(mqtt_broker_handle_t* broker, const char* topic, const char* ms
  */
 int mqtt_publish_with_qos(mqtt_broker_handle_t* broker, const char* topic, const char* msg, int msgLen, uint8_t retain, uint8_t qos, uint16_t* message_id);
 
+/** Encode the fixed and variable header of a PUBLISH packet.
+ *
+ * The payload of msgLen bytes is expected to follow the header.
+ *
+ * @retval header length, -1 if buf is too small
+ */
+int mqtt_encode_publish_header(uint8_t* buf, uint32_t size, const char* topic, uint32_t msgLen,
+                               uint8_t retain, uint8_t qos, uint16_t message_id);
+
+/** Encode a complete PUBLISH packet into a caller buffer.
+ *
+ * @retval packet length, -1 if buf is too small
+ */
+int mqtt_encode_publish(uint8_t* buf, uint32_t size, const char* topic, const void* msg, uint32_t msgLen,
+                        uint8_t retain, uint8_t qos, uint16_t message_id);
+
 /** Send a PUBREL message. It's used for PUBLISH message with 2 QoS level.
  * @param broker Data structure that contains the connection information with the broker.
  * @param message_id Message ID
@@ -277,6 +368,18 @@ int mqtt_subscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* me
  */
 int mqtt_unsubscribe(mqtt_broker_handle_t* broker, const char* topic, uint16_t* message_id);
 
+/** Encode a SUBSCRIBE packet for one topic into a caller buffer.
+ *
+ * @retval packet length, -1 if buf is too small
+ */
+int mqtt_encode_subscribe(uint8_t* buf, uint32_t size, const char* topic, uint8_t qos, uint16_t message_id);
+
+/** Encode an UNSUBSCRIBE packet for one topic into a caller buffer.
+ *
+ * @retval packet length, -1 if buf is too small
+ */
+int mqtt_encode_unsubscribe(uint8_t* buf, uint32_t size, const char* topic, uint16_t message_id);
+
 /** Make a ping.
  * @param broker Data structure that contains the connection information with the broker.
  *
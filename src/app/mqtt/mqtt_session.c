@@ -0,0 +1,752 @@
+/**
+ * @file    mqtt_session.c
+ *
+ * @brief   MQTT client session on top of libemqtt
+ *
+ * Messages are kept in a byte ring in the order they are published. The
+ * records in front of the send cursor have been transmitted and wait for
+ * their acknowledgement, the ones behind it wait for the inflight window
+ * to open. When the ring is full the messages go to an optional flash area
+ * and are moved back to the ring, in order, once connected.
+ *
+ * The receive task owns the connection: it connects with back-off, feeds
+ * the incremental parser and handles acknowledgements. Retransmission and
+ * keep-alive run from a wm_wl_task timer. Publishers send directly from
+ * their own task while the window allows; one semaphore protects the
+ * session state and the socket writes.
+ */
+#include <string.h>
+#include "wm_config.h"
+
+#if TLS_CONFIG_MQTT_SESSION
+#include "wm_type_def.h"
+#include "wm_osal.h"
+#include "wm_mem.h"
+#include "wm_sockets.h"
+#include "wm_wl_task.h"
+#include "wm_wl_timers.h"
+#include "wm_internal_flash.h"
+#include "lwip/netdb.h"
+#include "mqtt_session.h"
+
+#define MQTT_SESSION_TICK_MS        500
+#define MQTT_SESSION_BACKOFF_MIN    1000
+#define MQTT_SESSION_BACKOFF_MAX    60000
+#define MQTT_SESSION_CONNACK_MS     10000
+#define MQTT_SESSION_RX_QOS2        8
+
+#define MQTT_SESSION_STK_SIZE       256
+#define MQTT_RX_STK_SIZE            512
+
+#define MQTT_PUBLISH_DUP            0x08
+
+/* record states */
+#define MQTT_REC_QUEUED     0   /* waiting for the first transmission */
+#define MQTT_REC_SENT       1   /* PUBLISH sent, waiting for PUBACK or PUBREC */
+#define MQTT_REC_REL        2   /* PUBREL sent, waiting for PUBCOMP */
+#define MQTT_REC_DONE       3
+#define MQTT_REC_PAD        4   /* unused end of the ring */
+
+/* A queued message, followed by the NUL terminated topic and the payload.
+ * The same layout is used in the flash queue. */
+typedef struct {
+    u16 size;           /* whole record, multiple of 4 */
+    u8 state;
+    u8 flags;           /* qos << 1 | retain */
+    u16 msg_id;
+    u16 topic_len;
+    u32 msg_len;
+    u32 sent;           /* tick of the last transmission */
+} mqtt_rec_t;
+
+#define MQTT_REC_SIZE(topic_len, msg_len) \
+    ((sizeof(mqtt_rec_t) + (topic_len) + 1 + (msg_len) + 3) & ~3UL)
+#define MQTT_REC(off)       ((mqtt_rec_t *)(ses->ring + (off)))
+#define MQTT_REC_TOPIC(rec) ((char *)((rec) + 1))
+#define MQTT_REC_MSG(rec)   ((u8 *)((rec) + 1) + (rec)->topic_len + 1)
+#define MQTT_REC_QOS(rec)   ((rec)->flags >> 1)
+
+struct mqtt_session {
+    mqtt_session_config_t cfg;
+    mqtt_broker_handle_t broker;
+    tls_os_sem_t *lock;
+    int sock;
+    u8 connected;
+    s8 connack;
+    u8 ping_out;
+    u8 inflight;            /* records in SENT or REL */
+    u32 last_tx;
+    u32 last_rx;
+
+    /* RAM queue */
+    u8 *ring;
+    u32 ring_size;
+    u32 head;               /* oldest record */
+    u32 tail;               /* end of the newest record */
+    u32 send;               /* first QUEUED record */
+    u32 count;              /* records in the ring */
+    u32 unsent;             /* QUEUED records in the ring */
+
+    /* flash queue */
+    u32 flash_rd;
+    u32 flash_wr;
+    u32 flash_num;
+
+    /* incoming QoS2 messages waiting for PUBREL */
+    u16 rx_qos2[MQTT_SESSION_RX_QOS2];
+    u8 rx_qos2_next;
+
+    char subs[MQTT_SESSION_SUB_MAX][MQTT_SESSION_TOPIC_MAX];
+    u8 sub_qos[MQTT_SESSION_SUB_MAX];
+    u8 sub_num;
+
+    mqtt_session_stats_t stats;
+    mqtt_parser_t parser;
+    u8 rx_buf[MQTT_SESSION_RX_SIZE];
+};
+
+static struct mqtt_session *ses = NULL;
+
+static u32 mqtt_session_stk[MQTT_SESSION_STK_SIZE];
+static u32 mqtt_rx_stk[MQTT_RX_STK_SIZE];
+
+static struct task_parameter mqtt_session_param = {
+    .mbox_size = 8,
+    .name = "mqtt",
+    .stk_size = MQTT_SESSION_STK_SIZE,
+    .stk_start = (u8 *)mqtt_session_stk,
+    .task_id = TLS_MQTT_SESSION_TASK_PRIO,
+    .mbox_id = TLS_MBOX_ID_MQTT_SESSION,
+    .timeo_id = TLS_TIMEO_ID_MQTT_SESSION,
+};
+
+static int mqtt_session_send(int sock, const void *buf, unsigned int count)
+{
+    return send(sock, buf, count, 0);
+}
+
+static int mqtt_session_sendv(int sock, const mqtt_iovec_t *iov, int iovcnt)
+{
+    struct iovec v[4];
+    int i;
+
+    if (iovcnt > 4)
+        return -1;
+    for (i = 0; i < iovcnt; i++) {
+        v[i].iov_base = (void *)iov[i].base;
+        v[i].iov_len = iov[i].len;
+    }
+    return writev(sock, v, iovcnt);
+}
+
+/* Make the receive task drop the connection */
+static void mqtt_session_down(void)
+{
+    if (ses->connected) {
+        ses->connected = 0;
+        shutdown(ses->sock, SHUT_RDWR);
+    }
+}
+
+static u16 mqtt_session_id(void)
+{
+    if (ses->broker.seq == 0)
+        ses->broker.seq = 1;
+    return ses->broker.seq++;
+}
+
+/* Offset of the record at off, moved to the ring start past the end */
+static u32 mqtt_ring_norm(u32 off)
+{
+    if ((off + sizeof(mqtt_rec_t) > ses->ring_size) || (MQTT_REC(off)->state == MQTT_REC_PAD))
+        return 0;
+    return off;
+}
+
+static u32 mqtt_ring_next(u32 off)
+{
+    return mqtt_ring_norm(off + MQTT_REC(off)->size);
+}
+
+static mqtt_rec_t *mqtt_ring_alloc(u32 size)
+{
+    u32 off = ses->tail;
+
+    if (size > ses->ring_size)
+        return NULL;
+    if (ses->count == 0) {
+        ses->head = ses->tail = ses->send = off = 0;
+    } else if (off == ses->head) {
+        return NULL;
+    } else if (off > ses->head) {
+        if (ses->ring_size - off < size) {
+            if (ses->head < size)
+                return NULL;
+            if (ses->ring_size - off >= sizeof(mqtt_rec_t)) {
+                MQTT_REC(off)->state = MQTT_REC_PAD;
+                MQTT_REC(off)->size = ses->ring_size - off;
+            }
+            off = 0;
+        }
+    } else if (ses->head - off < size) {
+        return NULL;
+    }
+
+    if (ses->unsent == 0)
+        ses->send = off;
+    ses->tail = off + size;
+    ses->count++;
+    ses->unsent++;
+    return MQTT_REC(off);
+}
+
+/* Free the completed records at the head of the ring */
+static void mqtt_ring_reclaim(void)
+{
+    while (ses->count && (MQTT_REC(ses->head)->state == MQTT_REC_DONE)) {
+        ses->head = mqtt_ring_next(ses->head);
+        ses->count--;
+    }
+}
+
+static mqtt_rec_t *mqtt_ring_find(u16 msg_id, u8 state)
+{
+    mqtt_rec_t *rec;
+    u32 off = ses->head;
+    u32 n;
+
+    for (n = ses->count; n; n--) {
+        rec = MQTT_REC(off);
+        if ((rec->state == state) && (rec->msg_id == msg_id))
+            return rec;
+        off = mqtt_ring_next(off);
+    }
+    return NULL;
+}
+
+/* The payload is written before the header, a header in flash is only
+ * valid after its message is complete. */
+static int mqtt_flash_append(mqtt_rec_t *hdr, const char *topic, const void *msg)
+{
+    u32 addr = ses->cfg.flash_addr + ses->flash_wr;
+
+    if (!ses->cfg.flash_addr || (ses->flash_wr + hdr->size > ses->cfg.flash_len))
+        return -1;
+    if ((tls_fls_write(addr + sizeof(mqtt_rec_t), (u8 *)topic, hdr->topic_len + 1) != TLS_FLS_STATUS_OK) ||
+        (hdr->msg_len && (tls_fls_write(addr + sizeof(mqtt_rec_t) + hdr->topic_len + 1,
+                                         (u8 *)msg, hdr->msg_len) != TLS_FLS_STATUS_OK)) ||
+        (tls_fls_write(addr, (u8 *)hdr, sizeof(mqtt_rec_t)) != TLS_FLS_STATUS_OK))
+        return -1;
+    ses->flash_wr += hdr->size;
+    ses->flash_num++;
+    return 0;
+}
+
+/* Find the end of the flash queue left by the last run */
+static void mqtt_flash_scan(void)
+{
+    mqtt_rec_t hdr;
+
+    while (ses->flash_wr + sizeof(hdr) <= ses->cfg.flash_len) {
+        tls_fls_read(ses->cfg.flash_addr + ses->flash_wr, (u8 *)&hdr, sizeof(hdr));
+        if ((hdr.state != MQTT_REC_QUEUED) ||
+            (hdr.size != MQTT_REC_SIZE(hdr.topic_len, hdr.msg_len)) ||
+            (ses->flash_wr + hdr.size > ses->cfg.flash_len))
+            break;
+        ses->flash_wr += hdr.size;
+        ses->flash_num++;
+    }
+}
+
+/* Move messages from the flash queue to the ring, erase it once empty.
+ * Messages moved but not yet sent at a reset are sent again. */
+static int mqtt_flash_drain(void)
+{
+    mqtt_rec_t hdr;
+    mqtt_rec_t *rec;
+    u32 off;
+    int moved = 0;
+
+    while (ses->flash_rd < ses->flash_wr) {
+        tls_fls_read(ses->cfg.flash_addr + ses->flash_rd, (u8 *)&hdr, sizeof(hdr));
+        rec = mqtt_ring_alloc(hdr.size);
+        if (rec == NULL)
+            break;
+        tls_fls_read(ses->cfg.flash_addr + ses->flash_rd, (u8 *)rec, hdr.size);
+        ses->flash_rd += hdr.size;
+        ses->flash_num--;
+        moved++;
+    }
+
+    if (ses->flash_wr && (ses->flash_rd == ses->flash_wr)) {
+        for (off = 0; off < ses->flash_wr; off += INSIDE_FLS_SECTOR_SIZE)
+            tls_fls_erase((ses->cfg.flash_addr + off) / INSIDE_FLS_SECTOR_SIZE);
+        ses->flash_rd = 0;
+        ses->flash_wr = 0;
+    }
+    return moved;
+}
+
+/* Send a record, PUBREL for records in REL */
+static int mqtt_session_tx(mqtt_rec_t *rec, u8 dup)
+{
+    u8 header[MQTT_MAX_FIXED_HEADER + 2 + MQTT_SESSION_TOPIC_MAX + 2];
+    mqtt_iovec_t iov[2];
+    int len;
+
+    rec->sent = tls_os_get_time();
+    ses->last_tx = rec->sent;
+    if (rec->state == MQTT_REC_REL)
+        return mqtt_pubrel(&ses->broker, rec->msg_id);
+
+    len = mqtt_encode_publish_header(header, sizeof(header), MQTT_REC_TOPIC(rec), rec->msg_len,
+                                     rec->flags & 1, MQTT_REC_QOS(rec), rec->msg_id);
+    if (len < 0)
+        return -1;
+    if (dup)
+        header[0] |= MQTT_PUBLISH_DUP;
+    iov[0].base = header;
+    iov[0].len = len;
+    iov[1].base = MQTT_REC_MSG(rec);
+    iov[1].len = rec->msg_len;
+    if (ses->broker.mqttsendv(ses->sock, iov, 2) < (int)(len + rec->msg_len))
+        return -1;
+    return 1;
+}
+
+/* Send queued messages while the window allows */
+static void mqtt_session_pump(void)
+{
+    mqtt_rec_t *rec;
+
+    do {
+        while (ses->connected && ses->unsent) {
+            rec = MQTT_REC(ses->send);
+            if (MQTT_REC_QOS(rec)) {
+                if (ses->inflight >= ses->cfg.inflight)
+                    break;
+                rec->msg_id = mqtt_session_id();
+            }
+            if (mqtt_session_tx(rec, 0) < 0) {
+                mqtt_session_down();
+                break;
+            }
+            if (MQTT_REC_QOS(rec)) {
+                rec->state = MQTT_REC_SENT;
+                ses->inflight++;
+            } else {
+                rec->state = MQTT_REC_DONE;
+            }
+            ses->stats.sent++;
+            ses->unsent--;
+            ses->send = mqtt_ring_next(ses->send);
+        }
+        mqtt_ring_reclaim();
+    } while (ses->connected && mqtt_flash_drain());
+}
+
+static void mqtt_session_ack(u8 type, u16 msg_id)
+{
+    u8 packet[4];
+
+    packet[0] = type;
+    packet[1] = 2;
+    packet[2] = msg_id >> 8;
+    packet[3] = msg_id & 0xFF;
+    if (ses->broker.mqttsend(ses->sock, packet, sizeof(packet)) < (int)sizeof(packet))
+        mqtt_session_down();
+    else
+        ses->last_tx = tls_os_get_time();
+}
+
+static void mqtt_session_sub_send(u8 i)
+{
+    u8 packet[MQTT_MAX_FIXED_HEADER + 5 + MQTT_SESSION_TOPIC_MAX];
+    int len;
+
+    len = mqtt_encode_subscribe(packet, sizeof(packet), ses->subs[i], ses->sub_qos[i], mqtt_session_id());
+    if ((len < 0) || (ses->broker.mqttsend(ses->sock, packet, len) < len))
+        mqtt_session_down();
+    else
+        ses->last_tx = tls_os_get_time();
+}
+
+/* Returns 1 for a QoS2 message that has been delivered before */
+static int mqtt_session_rx_qos2(u16 msg_id, u8 add)
+{
+    int i;
+
+    for (i = 0; i < MQTT_SESSION_RX_QOS2; i++) {
+        if (ses->rx_qos2[i] == msg_id) {
+            if (!add)
+                ses->rx_qos2[i] = 0;
+            return 1;
+        }
+    }
+    if (add) {
+        ses->rx_qos2[ses->rx_qos2_next] = msg_id;
+        ses->rx_qos2_next = (ses->rx_qos2_next + 1) % MQTT_SESSION_RX_QOS2;
+    }
+    return 0;
+}
+
+/* Called by the parser in the receive task */
+static void mqtt_session_packet(void *arg, const uint8_t *packet, uint32_t len)
+{
+    u8 type = MQTTParseMessageType(packet);
+    u8 qos = MQTTParseMessageQos(packet);
+    u16 msg_id = mqtt_parse_msg_id(packet);
+    const u8 *topic;
+    const u8 *msg;
+    u16 topic_len;
+    u32 msg_len;
+    mqtt_rec_t *rec;
+    int dup = 0;
+
+    if (type == MQTT_MSG_CONNACK) {
+        ses->connack = (len >= 4) ? packet[3] : -1;
+        return;
+    }
+
+    tls_os_sem_acquire(ses->lock, 0);
+    ses->last_rx = tls_os_get_time();
+    ses->ping_out = 0;
+    if ((type == MQTT_MSG_PUBLISH) && (qos == 2))
+        dup = mqtt_session_rx_qos2(msg_id, 1);
+    tls_os_sem_release(ses->lock);
+
+    /* deliver without the lock, the callback may publish */
+    if ((type == MQTT_MSG_PUBLISH) && !dup && ses->cfg.on_msg) {
+        topic_len = mqtt_parse_pub_topic_ptr(packet, &topic);
+        msg_len = mqtt_parse_pub_msg_ptr(packet, &msg);
+        ses->cfg.on_msg(ses->cfg.arg, (const char *)topic, topic_len, msg, msg_len, qos);
+    }
+
+    tls_os_sem_acquire(ses->lock, 0);
+    switch (type) {
+    case MQTT_MSG_PUBLISH:
+        if (qos == 1)
+            mqtt_session_ack(MQTT_MSG_PUBACK, msg_id);
+        else if (qos == 2)
+            mqtt_session_ack(MQTT_MSG_PUBREC, msg_id);
+        break;
+    case MQTT_MSG_PUBREL:
+        mqtt_session_rx_qos2(msg_id, 0);
+        mqtt_session_ack(MQTT_MSG_PUBCOMP, msg_id);
+        break;
+    case MQTT_MSG_PUBACK:
+    case MQTT_MSG_PUBCOMP:
+        rec = mqtt_ring_find(msg_id, (type == MQTT_MSG_PUBACK) ? MQTT_REC_SENT : MQTT_REC_REL);
+        if (rec) {
+            rec->state = MQTT_REC_DONE;
+            ses->inflight--;
+            ses->stats.acked++;
+            mqtt_session_pump();
+        }
+        break;
+    case MQTT_MSG_PUBREC:
+        rec = mqtt_ring_find(msg_id, MQTT_REC_SENT);
+        if (rec) {
+            rec->state = MQTT_REC_REL;
+            if (mqtt_session_tx(rec, 0) < 0)
+                mqtt_session_down();
+        } else {
+            /* already released before a reconnect */
+            if (mqtt_pubrel(&ses->broker, msg_id) < 0)
+                mqtt_session_down();
+        }
+        break;
+    default:
+        break;
+    }
+    tls_os_sem_release(ses->lock);
+}
+
+/* Retransmission and keep-alive, runs in the session task */
+static void mqtt_session_tick(void *arg)
+{
+    u32 now = tls_os_get_time();
+    u32 retry = ses->cfg.retry_ms * HZ / 1000;
+    u32 alive = ses->broker.alive * HZ;
+    mqtt_rec_t *rec;
+    u32 off;
+    u32 n;
+
+    tls_os_sem_acquire(ses->lock, 0);
+    if (ses->connected) {
+        off = ses->head;
+        for (n = ses->count; n && ses->connected; n--) {
+            rec = MQTT_REC(off);
+            if (((rec->state == MQTT_REC_SENT) || (rec->state == MQTT_REC_REL)) &&
+                (now - rec->sent >= retry)) {
+                if (mqtt_session_tx(rec, 1) < 0)
+                    mqtt_session_down();
+                ses->stats.retransmits++;
+            }
+            off = mqtt_ring_next(off);
+        }
+
+        if (now - ses->last_rx >= alive + alive / 2) {
+            mqtt_session_down();
+        } else if ((now - ses->last_tx >= alive) ||
+                   ((now - ses->last_rx >= alive) && !ses->ping_out)) {
+            if (mqtt_ping(&ses->broker) < 0)
+                mqtt_session_down();
+            ses->last_tx = now;
+            ses->ping_out = 1;
+        }
+        mqtt_session_pump();
+    }
+    tls_os_sem_release(ses->lock);
+
+    tls_timeout_p(TLS_TIMEO_ID_MQTT_SESSION, MQTT_SESSION_TICK_MS, mqtt_session_tick, NULL);
+}
+
+/* Connect and wait for CONNACK, then resume the session */
+static int mqtt_session_open(u8 *chunk, u32 size)
+{
+    struct hostent *host;
+    struct sockaddr_in addr;
+    struct timeval timeout;
+    fd_set readfd;
+    mqtt_rec_t *rec;
+    u32 off;
+    u32 n;
+    u8 i;
+    int sock;
+    int ret;
+
+    host = gethostbyname(ses->cfg.host);
+    if (host == NULL)
+        return -1;
+    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(ses->cfg.port);
+    memcpy(&addr.sin_addr, host->h_addr, host->h_length);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        closesocket(sock);
+        return -1;
+    }
+
+    tls_os_sem_acquire(ses->lock, 0);
+    ses->sock = sock;
+    ses->broker.socketid = sock;
+    ret = mqtt_connect(&ses->broker);
+    tls_os_sem_release(ses->lock);
+
+    ses->connack = -1;
+    mqtt_parser_init(&ses->parser, ses->rx_buf, sizeof(ses->rx_buf));
+    while ((ret == 0) && (ses->connack < 0)) {
+        FD_ZERO(&readfd);
+        FD_SET(sock, &readfd);
+        timeout.tv_sec = MQTT_SESSION_CONNACK_MS / 1000;
+        timeout.tv_usec = 0;
+        if (select(sock + 1, &readfd, NULL, NULL, &timeout) <= 0)
+            break;
+        ret = recv(sock, chunk, size, 0);
+        if ((ret <= 0) || (mqtt_parser_feed(&ses->parser, chunk, ret, mqtt_session_packet, NULL) < 0))
+            break;
+        ret = 0;
+    }
+    if (ses->connack != 0) {
+        closesocket(sock);
+        ses->sock = -1;
+        return -1;
+    }
+
+    tls_os_sem_acquire(ses->lock, 0);
+    ses->connected = 1;
+    ses->last_rx = ses->last_tx = tls_os_get_time();
+    ses->ping_out = 0;
+    ses->stats.connects++;
+    if (ses->broker.clean_session)
+        memset(ses->rx_qos2, 0, sizeof(ses->rx_qos2));
+    for (i = 0; i < ses->sub_num; i++)
+        mqtt_session_sub_send(i);
+
+    /* resend what the broker has not acknowledged */
+    off = ses->head;
+    for (n = ses->count; n && ses->connected; n--) {
+        rec = MQTT_REC(off);
+        if ((rec->state == MQTT_REC_SENT) || (rec->state == MQTT_REC_REL)) {
+            if (mqtt_session_tx(rec, 1) < 0)
+                mqtt_session_down();
+            ses->stats.retransmits++;
+        }
+        off = mqtt_ring_next(off);
+    }
+    mqtt_session_pump();
+    ret = ses->connected ? 0 : -1;
+    tls_os_sem_release(ses->lock);
+    return ret;
+}
+
+static void mqtt_rx_task(void *data)
+{
+    u8 chunk[256];
+    u32 backoff = MQTT_SESSION_BACKOFF_MIN;
+    int len;
+
+    for (;;) {
+        if (mqtt_session_open(chunk, sizeof(chunk)) < 0) {
+            if (ses->sock >= 0) {
+                closesocket(ses->sock);
+                ses->sock = -1;
+            }
+            tls_os_time_delay(backoff * HZ / 1000);
+            backoff = (backoff * 2 < MQTT_SESSION_BACKOFF_MAX) ? backoff * 2 : MQTT_SESSION_BACKOFF_MAX;
+            continue;
+        }
+        backoff = MQTT_SESSION_BACKOFF_MIN;
+        if (ses->cfg.on_state)
+            ses->cfg.on_state(ses->cfg.arg, 1);
+
+        for (;;) {
+            len = recv(ses->sock, chunk, sizeof(chunk), 0);
+            if (len <= 0)
+                break;
+            if (mqtt_parser_feed(&ses->parser, chunk, len, mqtt_session_packet, NULL) < 0)
+                break;
+        }
+
+        tls_os_sem_acquire(ses->lock, 0);
+        ses->connected = 0;
+        closesocket(ses->sock);
+        ses->sock = -1;
+        tls_os_sem_release(ses->lock);
+        if (ses->cfg.on_state)
+            ses->cfg.on_state(ses->cfg.arg, 0);
+    }
+}
+
+int mqtt_session_start(const mqtt_session_config_t *cfg)
+{
+    if (ses || !cfg || !cfg->host)
+        return -1;
+
+    ses = tls_mem_alloc(sizeof(struct mqtt_session));
+    if (ses == NULL)
+        return -1;
+    memset(ses, 0, sizeof(struct mqtt_session));
+    ses->cfg = *cfg;
+    if (ses->cfg.keepalive == 0)
+        ses->cfg.keepalive = CLOUD_MQTT_SET_ALIVE;
+    if (ses->cfg.inflight == 0)
+        ses->cfg.inflight = 8;
+    else if (ses->cfg.inflight > MQTT_SESSION_INFLIGHT_MAX)
+        ses->cfg.inflight = MQTT_SESSION_INFLIGHT_MAX;
+    if (ses->cfg.retry_ms == 0)
+        ses->cfg.retry_ms = 5000;
+    if (ses->cfg.queue_size == 0)
+        ses->cfg.queue_size = 4096;
+    ses->ring_size = ses->cfg.queue_size & ~3UL;
+    ses->ring = tls_mem_alloc(ses->ring_size);
+    if ((ses->ring == NULL) || (tls_os_sem_create(&ses->lock, 1) != TLS_OS_SUCCESS)) {
+        if (ses->ring)
+            tls_mem_free(ses->ring);
+        tls_mem_free(ses);
+        ses = NULL;
+        return -1;
+    }
+
+    ses->sock = -1;
+    mqtt_init(&ses->broker, ses->cfg.clientid);
+    mqtt_init_auth(&ses->broker, ses->cfg.username, ses->cfg.password);
+    mqtt_set_alive(&ses->broker, ses->cfg.keepalive);
+    ses->broker.clean_session = ses->cfg.clean_session;
+    ses->broker.mqttsend = mqtt_session_send;
+    ses->broker.mqttsendv = mqtt_session_sendv;
+    if (ses->cfg.flash_addr)
+        mqtt_flash_scan();
+
+    tls_wl_task_run(&mqtt_session_param);
+    tls_wl_task_add_timeout(&mqtt_session_param, MQTT_SESSION_TICK_MS, mqtt_session_tick, NULL);
+    tls_os_task_create(NULL, "mqttrx", mqtt_rx_task, NULL,
+                       (void *)mqtt_rx_stk, MQTT_RX_STK_SIZE * sizeof(u32),
+                       TLS_MQTT_RX_TASK_PRIO, 0);
+    return 0;
+}
+
+int mqtt_session_publish(const char *topic, const void *msg, u32 len, u8 qos, u8 retain)
+{
+    mqtt_rec_t hdr;
+    mqtt_rec_t *rec = NULL;
+    u32 topic_len;
+    int ret = 0;
+
+    if (!ses || !topic || (qos > 2) || (!msg && len))
+        return -1;
+    topic_len = strlen(topic);
+    if ((topic_len == 0) || (topic_len >= MQTT_SESSION_TOPIC_MAX) ||
+        (MQTT_REC_SIZE(topic_len, len) > 0xFFFF))
+        return -1;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.size = MQTT_REC_SIZE(topic_len, len);
+    hdr.state = MQTT_REC_QUEUED;
+    hdr.flags = (qos << 1) | (retain ? 1 : 0);
+    hdr.topic_len = topic_len;
+    hdr.msg_len = len;
+
+    tls_os_sem_acquire(ses->lock, 0);
+    /* behind messages in flash, keep the order */
+    if (ses->flash_rd == ses->flash_wr)
+        rec = mqtt_ring_alloc(hdr.size);
+    if (rec) {
+        memcpy(rec, &hdr, sizeof(hdr));
+        memcpy(MQTT_REC_TOPIC(rec), topic, topic_len + 1);
+        if (len)
+            memcpy(MQTT_REC_MSG(rec), msg, len);
+    } else if (mqtt_flash_append(&hdr, topic, msg) == 0) {
+        ses->stats.spilled++;
+    } else {
+        ses->stats.dropped++;
+        ret = -1;
+    }
+    if (ret == 0) {
+        ses->stats.published++;
+        mqtt_session_pump();
+    }
+    tls_os_sem_release(ses->lock);
+    return ret;
+}
+
+int mqtt_session_subscribe(const char *topic, u8 qos)
+{
+    if (!ses || !topic || (qos > 2) || (strlen(topic) >= MQTT_SESSION_TOPIC_MAX))
+        return -1;
+
+    tls_os_sem_acquire(ses->lock, 0);
+    if (ses->sub_num >= MQTT_SESSION_SUB_MAX) {
+        tls_os_sem_release(ses->lock);
+        return -1;
+    }
+    strcpy(ses->subs[ses->sub_num], topic);
+    ses->sub_qos[ses->sub_num] = qos;
+    ses->sub_num++;
+    if (ses->connected)
+        mqtt_session_sub_send(ses->sub_num - 1);
+    tls_os_sem_release(ses->lock);
+    return 0;
+}
+
+u8 mqtt_session_connected(void)
+{
+    return ses ? ses->connected : 0;
+}
+
+void mqtt_session_get_stats(mqtt_session_stats_t *stats)
+{
+    memset(stats, 0, sizeof(mqtt_session_stats_t));
+    if (!ses)
+        return;
+    tls_os_sem_acquire(ses->lock, 0);
+    memcpy(stats, &ses->stats, sizeof(mqtt_session_stats_t));
+    stats->queued = ses->unsent + ses->flash_num;
+    stats->inflight = ses->inflight;
+    tls_os_sem_release(ses->lock);
+}
+#endif
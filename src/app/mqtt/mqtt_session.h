@@ -0,0 +1,108 @@
+/**
+ * @file    mqtt_session.h
+ *
+ * @brief   MQTT client session on top of libemqtt
+ *
+ * One session per device. It keeps the broker connection up, retransmits
+ * unacknowledged QoS1/2 messages, queues messages while the broker is not
+ * reachable (in RAM and, optionally, in a flash area) and sends them in
+ * order after the next connect.
+ */
+#ifndef __MQTT_SESSION_H__
+#define __MQTT_SESSION_H__
+
+#include "wm_type_def.h"
+#include "libemqtt.h"
+
+/** Upper limit of the inflight window */
+#define MQTT_SESSION_INFLIGHT_MAX   32
+/** Topics subscribed again after each connect */
+#define MQTT_SESSION_SUB_MAX        8
+#define MQTT_SESSION_TOPIC_MAX      128
+/** Largest packet accepted from the broker */
+#define MQTT_SESSION_RX_SIZE        1024
+
+/** Message from a subscribed topic, topic is not NUL terminated */
+typedef void (*mqtt_session_msg_fn)(void *arg, const char *topic, u16 topic_len,
+                                    const u8 *msg, u32 msg_len, u8 qos);
+/** Connection state change */
+typedef void (*mqtt_session_state_fn)(void *arg, u8 connected);
+
+typedef struct {
+    const char *host;
+    u16 port;
+    const char *clientid;
+    const char *username;       /**< NULL for none */
+    const char *password;       /**< NULL for none */
+    u16 keepalive;              /**< seconds, 0 = CLOUD_MQTT_SET_ALIVE */
+    u8 clean_session;
+    u8 inflight;                /**< QoS1/2 messages sent but not acknowledged, 0 = 8 */
+    u16 retry_ms;               /**< retransmission timeout, 0 = 5000 */
+    u32 queue_size;             /**< RAM queue in bytes, 0 = 4096 */
+    u32 flash_addr;             /**< flash area for the offline queue, 0 = RAM only */
+    u32 flash_len;              /**< multiple of INSIDE_FLS_SECTOR_SIZE */
+    mqtt_session_msg_fn on_msg;
+    mqtt_session_state_fn on_state;
+    void *arg;
+} mqtt_session_config_t;
+
+typedef struct {
+    u32 published;              /**< messages accepted by mqtt_session_publish */
+    u32 sent;                   /**< PUBLISH packets sent, retransmissions excluded */
+    u32 acked;                  /**< QoS1/2 messages completed */
+    u32 retransmits;
+    u32 dropped;                /**< messages refused because the queues were full */
+    u32 spilled;                /**< messages written to the flash queue */
+    u32 connects;
+    u32 queued;                 /**< messages waiting for the first transmission */
+    u32 inflight;               /**< messages waiting for an acknowledgement */
+} mqtt_session_stats_t;
+
+/**
+ * @brief          Start the session
+ *
+ * @param[in]      cfg    session configuration, strings must stay valid
+ *
+ * @retval         0      success
+ * @retval         -1     already started or out of memory
+ *
+ * @note           Connecting happens in the background, messages
+ *                 published before are queued.
+ */
+int mqtt_session_start(const mqtt_session_config_t *cfg);
+
+/**
+ * @brief          Queue a message and send it when the window allows
+ *
+ * @param[in]      topic     topic, shorter than MQTT_SESSION_TOPIC_MAX
+ * @param[in]      msg       payload
+ * @param[in]      len       payload length
+ * @param[in]      qos       0, 1 or 2
+ * @param[in]      retain    retain flag
+ *
+ * @retval         0      queued or sent
+ * @retval         -1     invalid arguments or queues full
+ *
+ * @note           Does not wait for the acknowledgement.
+ */
+int mqtt_session_publish(const char *topic, const void *msg, u32 len, u8 qos, u8 retain);
+
+/**
+ * @brief          Subscribe a topic, now and after every reconnect
+ *
+ * @retval         0      success
+ * @retval         -1     too many subscriptions or topic too long
+ */
+int mqtt_session_subscribe(const char *topic, u8 qos);
+
+/**
+ * @brief          Report whether the broker accepted the connection
+ */
+u8 mqtt_session_connected(void);
+
+/**
+ * @brief          Get the session counters
+ */
+void mqtt_session_get_stats(mqtt_session_stats_t *stats);
+
+#endif /* __MQTT_SESSION_H__ */
@@ -17,6 +17,16 @@
 #include "wm_debug.h"
 #include "wm_osal.h"
 #include "wm_params.h"
+#include "wm_mem.h"
+#include "wm_rtc.h"
+#include "wm_ntp.h"
+#include "lwip/sys.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#if TLS_CONFIG_DNS_RESOLVER
+#include "wm_dns.h"
+#endif
 
 #if TLS_CONFIG_NTP
 
@@ -30,195 +40,652 @@
 
 #define UTC_NTP 2208988800U     /* 1970 - 1900 ;年 换算成秒 */
 #define BUF_LEN	48
+/* tls_ntp_client and the RTC keep Beijing time */
+#define NTP_TIMEZONE        (8 * 3600)
 
 #define NTP_MAX_TRY_TIMES   4
 #define NTP_SERVER_MAX_NUM	3
 #define NTP_SERVER_DOMAIN_LEN	32
 #define NTP_SERVER_IP_LEN 16
+#define NTP_PORT            123
+/* ms a try waits for the answers of all servers */
+#define NTP_TRY_MS          1000
+/* callers of tls_ntp_client waiting for the same round */
+#define NTP_WAITER_NUM      4
+/* larger offsets are stepped, smaller ones slewed at NTP_SLEW_PPM */
+#define NTP_STEP_MS         1000
+#define NTP_SLEW_PPM        500
+#define NTP_FREQ_MAX_PPB    500000
+/* poll interval in s, doubled while the error stays below NTP_STABLE_MS */
+#define NTP_POLL_MIN        64
+#define NTP_POLL_MAX        16384
+#define NTP_STABLE_MS       20
+/* s between checks of the RTC against the clock */
+#define NTP_RTC_CHECK       600
+
 u8 serverno = NTP_SERVER_MAX_NUM;
 char serverip[NTP_SERVER_MAX_NUM][NTP_SERVER_DOMAIN_LEN];
 
 u32 sntp_serverip[NTP_SERVER_MAX_NUM];
-/* get Timestamp for NTP in LOCAL ENDIAN */
-void get_time64(u32 * ts)
+
+struct ntp_server {
+    u32 addr;
+    u32 nonce[2];       /* transmit timestamp of the request, echoed as origin */
+    u64 sent;           /* local ms */
+    u8 pending;
+};
+
+struct ntp_sample {
+    s64 utc;            /* server time at local, ms since 1970 */
+    u64 local;
+    s32 offset;         /* against the clock, set by ntp_discipline */
+    u32 delay;
+    u8 server;
+    u8 valid;
+};
+
+struct ntp_wait {
+    sys_sem_t sem;
+    u32 addr[NTP_SERVER_MAX_NUM];
+    u8 ok;
+};
+
+struct ntp_start {
+    u32 addr[NTP_SERVER_MAX_NUM];
+    char name[NTP_SERVER_MAX_NUM][NTP_SERVER_DOMAIN_LEN];
+};
+
+/*
+ * UTC at local ms l is ref_utc + (l - ref_local) * (1 + freq / 10^9) plus
+ * as much of slew as NTP_SLEW_PPM allows since ref_local.  Written in the
+ * tcpip thread, read anywhere under SYS_ARCH_PROTECT.
+ */
+static struct {
+    u64 ref_local;
+    s64 ref_utc;
+    s32 freq;
+    s32 slew;
+    u64 last_sync;
+    u32 poll;
+    u8 synced;
+} ntp_clock;
+
+/* owned by the tcpip thread */
+static struct {
+    struct udp_pcb *pcb;
+    struct ntp_server srv[NTP_SERVER_MAX_NUM];
+    char name[NTP_SERVER_MAX_NUM][NTP_SERVER_DOMAIN_LEN];
+    struct ntp_sample best;
+    struct ntp_wait *waiter[NTP_WAITER_NUM];
+    u64 rtc_written;    /* local ms, 0 while the RTC was not set by us */
+    u8 round;
+    u8 tries;
+    u8 service;
+    u8 freq_set;
+    tls_ntp_status_t status;
+} ntp;
+
+static void ntp_try_tmr(void *arg);
+static void ntp_service_tmr(void *arg);
+static void ntp_rtc_tmr(void *arg);
+static void ntp_rtc_check(void *arg);
+
+/* tick counter widened to 64 bits, needs a call at least once per wrap */
+static u64 ntp_local_ms(void)
 {
-	ts[0] = UTC_NTP;
-    ts[1] = 0;
+    static u32 last;
+    static u64 ticks;
+    u64 now;
+    u32 t;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    t = tls_os_get_time();
+    ticks += (u32)(t - last);
+    last = t;
+    now = ticks;
+    SYS_ARCH_UNPROTECT(lev);
+
+    return now * 1000 / HZ;
 }
 
-int open_connect(u8 * buf)
+static s32 ntp_slewed(s64 dt, s32 slew)
 {
-	int s[NTP_SERVER_MAX_NUM] = {-1,-1,-1};
-	int max_socketnum = 0;
-	int total_socketnum = 0;
-	int last_total_socketnum = 0;
-	int ip_num = 0;
-
-    struct sockaddr_in pin;
-    u32 tts[2];                 /* Transmit Timestamp */
-    int ret = 0;
-	int retval = WM_FAILED;
-	int i;
-    int servernum = 0;
-    fd_set readfd;
-    struct timeval timeout;
-    socklen_t addrlen = sizeof(struct sockaddr);
-	struct hostent *host = NULL;
-	int ip_avial_num = 0;
-	
-	for(i = 0; i < NTP_SERVER_MAX_NUM; i++)
-	{
-		tls_param_get(TLS_PARAM_ID_SNTP_SERVER1 + i, serverip[i], 1);
-		s[i] = -1;
-	}	
+    s64 max = dt * NTP_SLEW_PPM / 1000000;
 
-	for(i = 0; i < NTP_SERVER_MAX_NUM; i++)
-	{
-	    host = gethostbyname(serverip[i]);
-	    if(NULL == host)
-	    {
-	        continue;
-	    }
-		memcpy((u8 *)&sntp_serverip[ip_avial_num++], host->h_addr, host->h_length);
-	}	
-	if(ip_avial_num == 0)
-	{
-		ntp_debug("NTP Server DNS Failed ");
-		return	retval;
-	}
+    if (slew > max)
+        return (s32)max;
+    if (slew < -max)
+        return (s32)-max;
+    return slew;
+}
 
-	for (i = 0; i < NTP_MAX_TRY_TIMES; i++){
-		/*initialize */
-		max_socketnum = 0;
-		FD_ZERO(&readfd);
-		for (servernum = 0; servernum < NTP_SERVER_MAX_NUM; servernum++)
-		{
-			if (s[servernum] >= 0)
-			{
-				closesocket(s[servernum]);
-			}
-			s[servernum] = -1;
-		}
-
-		if (WM_SUCCESS == retval)
-		{
-			break;
-		}
-
-		/*send NTP request to multiple servers*/
-		for(servernum = 0;servernum < ip_avial_num;servernum ++ )
-		{
-			s[servernum] = socket(AF_INET,SOCK_DGRAM,IPPROTO_UDP);
-			//printf("s[%d]:%d\n", servernum, s[servernum]);
-			if(s[servernum] < 0)
-			{
-				ntp_debug("sock err\n");
-				continue;
-			}
-
-			ip_num = (servernum + last_total_socketnum)%ip_avial_num;
-
-			memset(&pin, 0, sizeof(struct sockaddr));
-			pin.sin_family=AF_INET;                 //AF_INET表示使用IPv4
-			pin.sin_addr.s_addr=sntp_serverip[ip_num];  //IPADDR_udp
-			pin.sin_port=htons(123);
-
-			buf[0] = 0x23;
-			get_time64(tts);
-			(*(u32 *)&buf[40]) = htonl(tts[0]);
-			(*(u32 *)&buf[44])= htonl(tts[1]);
-
-			ret = sendto(s[servernum], buf, BUF_LEN, 0, (struct sockaddr *)&pin, addrlen);
-			if(ret < 0)
-			{
-				ntp_debug("\nsend err\n");
-				closesocket(s[servernum]);
-				s[servernum] = -1;
-				continue;
-			}
-
-			FD_SET(s[servernum],&readfd);
-			max_socketnum = (max_socketnum >= s[servernum])?max_socketnum:s[servernum];
-			total_socketnum++;
-		}
-
-		last_total_socketnum = total_socketnum;
-
-		/*select timeout 5 second*/
-		timeout.tv_sec = 1;
-		timeout.tv_usec =  0;
-		ret = select(max_socketnum + 1 , &readfd , NULL,NULL ,&timeout) ;
-		if(ret <= 0)
-		{
-			ntp_debug("Failed to select or timeout ");
-		}
-		else
-		{
-			for(servernum = 0;servernum < ip_avial_num ;servernum ++ )
-			{
-				if ((s[servernum] >= 0) && (FD_ISSET(s[servernum],&readfd)))
-				{
-					/*receive data from ntp server*/
-					memset(buf,0,BUF_LEN);
-					ret = recvfrom(s[servernum],buf,BUF_LEN,0,(struct sockaddr *)&pin,&addrlen);
-					if(ret <=  0)
-					{
-						ntp_debug("Fail to recvfrom ");
-						continue;
-					}
-					else
-					{	
-						retval = WM_SUCCESS;
-						break;
-					}
-				}
-			}
-		}
-
-        for(servernum = 0;servernum < ip_avial_num ;servernum ++ )
-		{
-			if ( s[servernum] >= 0 )
-			{
-                closesocket(s[servernum]);
-			}
-		}
-	}
-	return retval;
+/* the clock at local ms, and in synced (may be NULL) whether it was ever set */
+static s64 ntp_clock_read(u64 local, u8 *synced)
+{
+    u64 ref_local;
+    s64 ref_utc;
+    s64 dt;
+    s32 freq;
+    s32 slew;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    ref_local = ntp_clock.ref_local;
+    ref_utc = ntp_clock.ref_utc;
+    freq = ntp_clock.freq;
+    slew = ntp_clock.slew;
+    if (synced)
+        *synced = ntp_clock.synced;
+    SYS_ARCH_UNPROTECT(lev);
+
+    dt = (s64)(local - ref_local);
+    return ref_utc + dt + dt * freq / 1000000000 + ntp_slewed(dt, slew);
+}
+
+static s64 ntp_clock_at(u64 local)
+{
+    return ntp_clock_read(local, NULL);
+}
+
+static s64 ntp_ts_ms(const u8 *ts)
+{
+    u32 sec = ((u32)ts[0] << 24) | ((u32)ts[1] << 16) | ((u32)ts[2] << 8) | ts[3];
+    u32 frac = ((u32)ts[4] << 24) | ((u32)ts[5] << 16) | ((u32)ts[6] << 8) | ts[7];
+
+    return (s64)(u32)(sec - UTC_NTP) * 1000 + (s64)(((u64)frac * 1000) >> 32);
+}
+
+/*
+ * Steps or slews the clock to the sample.  The part of the offset that the
+ * remaining slew does not explain accumulated since the last sample and
+ * corrects the frequency; the poll interval follows how well that worked.
+ */
+static void ntp_discipline(struct ntp_sample *s)
+{
+    s64 now = ntp_clock_at(s->local);
+    s64 offset = s->utc - now;
+    s64 elapsed = (s64)(s->local - ntp_clock.last_sync);
+    s64 err;
+    s64 freq;
+    u32 poll;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    err = offset - (ntp_clock.slew - ntp_slewed((s64)(s->local - ntp_clock.ref_local), ntp_clock.slew));
+    s->offset = (s32)((offset > 0x7fffffff) ? 0x7fffffff : ((offset < -0x7fffffff) ? -0x7fffffff : offset));
+    freq = ntp_clock.freq;
+    poll = ntp_clock.poll;
+
+    if (!ntp_clock.synced || (offset > NTP_STEP_MS) || (offset < -NTP_STEP_MS))
+    {
+        if (!ntp_clock.synced)
+            s->offset = 0;
+        ntp.status.steps++;
+        ntp.rtc_written = 0;
+        now = s->utc;
+        offset = 0;
+        poll = NTP_POLL_MIN;
+    }
+    else
+    {
+        /* the first estimate is taken whole, later ones averaged */
+        if (elapsed >= NTP_POLL_MIN * 1000 / 2)
+        {
+            freq += err * 1000000000 / elapsed / (ntp.freq_set ? 2 : 1);
+            ntp.freq_set = 1;
+            if (freq > NTP_FREQ_MAX_PPB)
+                freq = NTP_FREQ_MAX_PPB;
+            else if (freq < -NTP_FREQ_MAX_PPB)
+                freq = -NTP_FREQ_MAX_PPB;
+        }
+        if ((err < NTP_STABLE_MS) && (err > -NTP_STABLE_MS))
+        {
+            if (poll < NTP_POLL_MAX)
+                poll <<= 1;
+        }
+        else if ((err > 4 * NTP_STABLE_MS) || (err < -4 * NTP_STABLE_MS))
+        {
+            if (poll > NTP_POLL_MIN)
+                poll >>= 1;
+        }
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    ntp_clock.ref_local = s->local;
+    ntp_clock.ref_utc = now;
+    ntp_clock.slew = (s32)offset;
+    ntp_clock.freq = (s32)freq;
+    ntp_clock.last_sync = s->local;
+    ntp_clock.poll = poll;
+    ntp_clock.synced = 1;
+    SYS_ARCH_UNPROTECT(lev);
+
+    ntp_debug("ntp offset %d delay %u freq %d poll %u\n",
+              s->offset, s->delay, (int)freq, poll);
+}
+
+static void ntp_rtc_schedule(void)
+{
+    s64 utc = ntp_clock_at(ntp_local_ms());
+
+    /* the RTC counts whole seconds, write it when the next one starts */
+    sys_untimeout(ntp_rtc_check, NULL);
+    sys_untimeout(ntp_rtc_tmr, NULL);
+    sys_timeout(1000 - (u32)(utc % 1000), ntp_rtc_tmr, NULL);
+}
+
+static void ntp_rtc_tmr(void *arg)
+{
+    u64 local = ntp_local_ms();
+
+    tls_rtc_set_time((time_t)((ntp_clock_at(local) + 500) / 1000) + NTP_TIMEZONE);
+    ntp.rtc_written = local;
+    if (ntp.service)
+        sys_timeout(NTP_RTC_CHECK * 1000, ntp_rtc_check, NULL);
+}
+
+static void ntp_rtc_check(void *arg)
+{
+    u64 local = ntp_local_ms();
+    s64 utc = ntp_clock_at(local);
+    u32 frac = (u32)(utc % 1000);
+    s32 diff;
+    u32 elapsed;
+
+    if (!ntp_clock.synced)
+    {
+        sys_timeout(NTP_RTC_CHECK * 1000, ntp_rtc_check, NULL);
+        return;
+    }
+    /* read half way into a second, a different one means it is off by half */
+    if ((frac < 400) || (frac > 600))
+    {
+        sys_timeout((1500 - frac) % 1000, ntp_rtc_check, NULL);
+        return;
+    }
+
+    diff = (s32)(tls_rtc_get_time() - ((time_t)(utc / 1000) + NTP_TIMEZONE));
+    if (diff == 0)
+    {
+        sys_timeout(NTP_RTC_CHECK * 1000, ntp_rtc_check, NULL);
+        return;
+    }
+
+    /* it was right when written, the drift since then just passed 500 ms */
+    elapsed = (u32)((local - ntp.rtc_written) / 1000);
+    if (ntp.rtc_written && (diff >= -1) && (diff <= 1) && elapsed)
+        ntp.status.rtc_ppm = diff * 500000 / (s32)elapsed;
+    ntp_rtc_schedule();
+}
+
+static void ntp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                     const ip_addr_t *addr, u16_t port)
+{
+    u64 t4 = ntp_local_ms();
+    u8 buf[BUF_LEN];
+    s64 t1, t2, t3;
+    s64 delay;
+    struct ntp_server *srv = NULL;
+    int i;
+
+    if (!ntp.round || (port != NTP_PORT) || (p->tot_len < BUF_LEN))
+        goto out;
+    pbuf_copy_partial(p, buf, BUF_LEN, 0);
+
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        if (ntp.srv[i].pending && (ntp.srv[i].addr == ip_addr_get_ip4_u32(addr)) &&
+            !memcmp(buf + 24, ntp.srv[i].nonce, 8))
+        {
+            srv = &ntp.srv[i];
+            break;
+        }
+    }
+    if (srv == NULL)
+        goto out;
+    srv->pending = 0;
+
+    /* server mode, synchronized */
+    if (((buf[0] & 0x07) != 4) || ((buf[0] >> 6) == 3) || (buf[1] == 0) || (buf[1] > 15))
+        goto done;
+
+    t1 = (s64)srv->sent;
+    t2 = ntp_ts_ms(buf + 32);
+    t3 = ntp_ts_ms(buf + 40);
+    delay = ((s64)t4 - t1) - (t3 - t2);
+    if (delay < 0)
+        delay = 0;
+    ntp.status.samples++;
+
+    if (!ntp.best.valid || ((u32)delay < ntp.best.delay))
+    {
+        ntp.best.utc = (s64)t4 + ((t2 - t1) + (t3 - (s64)t4)) / 2;
+        ntp.best.local = t4;
+        ntp.best.delay = (u32)delay;
+        ntp.best.server = (u8)i;
+        ntp.best.valid = 1;
+    }
+
+done:
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        if (ntp.srv[i].pending)
+            goto out;
+    }
+    sys_untimeout(ntp_try_tmr, NULL);
+    ntp_try_tmr(NULL);
+out:
+    pbuf_free(p);
+}
+
+static int ntp_send(void)
+{
+    u8 buf[BUF_LEN];
+    ip_addr_t to;
+    struct pbuf *p;
+    int sent = 0;
+    int i;
+
+    if (ntp.pcb == NULL)
+    {
+        ntp.pcb = udp_new();
+        if (ntp.pcb == NULL)
+            return 0;
+        udp_recv(ntp.pcb, ntp_recv, NULL);
+    }
+
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        ntp.srv[i].pending = 0;
+        if (ntp.srv[i].addr == 0)
+            continue;
+
+        memset(buf, 0, BUF_LEN);
+        buf[0] = 0x23;
+        ntp.srv[i].nonce[0] = LWIP_RAND();
+        ntp.srv[i].nonce[1] = LWIP_RAND();
+        memcpy(buf + 40, ntp.srv[i].nonce, 8);
+
+        /* udp_sendto leaves its headers in the pbuf, one per server */
+        p = pbuf_alloc(PBUF_TRANSPORT, BUF_LEN, PBUF_RAM);
+        if (p == NULL)
+            break;
+        pbuf_take(p, buf, BUF_LEN);
+        ip_addr_set_ip4_u32(&to, ntp.srv[i].addr);
+        ntp.srv[i].sent = ntp_local_ms();
+        if (udp_sendto(ntp.pcb, p, &to, NTP_PORT) == ERR_OK)
+        {
+            ntp.srv[i].pending = 1;
+            sent++;
+        }
+        pbuf_free(p);
+    }
+
+    return sent;
 }
 
-int get_reply(u8 * buf, u32 * time)
+static void ntp_round_end(void)
 {
-    u32 *pt;
-    u32 t3[2];                  /* t3 = Transmit Timestamp @ Server */
-    u32 t4[2];                  /* t4 = Receive Timestamp @ Client */
-
-    get_time64(t4);
-//  printf("%x  %x\n",t4[0],t4[1]);
-    pt = (u32 *) & buf[40];
-    t3[0] = htonl(*pt);
-    pt = (u32 *) & buf[44];
-    t3[1] = htonl(*pt);
-
-    t3[0] -= UTC_NTP;
-    t3[0] += 8 * 3600;             // 加8小时
-// printf("server Time : %s\n", ctime(&t3[0]));
-    *time = t3[0];
+    int i;
+
+    ntp.round = 0;
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+        ntp.srv[i].pending = 0;
+
+    if (ntp.best.valid)
+    {
+        ntp_discipline(&ntp.best);
+        ntp.status.server = ntp.best.server;
+        ntp.status.offset_ms = ntp.best.offset;
+        ntp.status.delay_ms = ntp.best.delay;
+        /* after a step, otherwise ntp_rtc_check finds the drift */
+        if (ntp.service && !ntp.rtc_written)
+            ntp_rtc_schedule();
+    }
+    else
+    {
+        ntp.status.failures++;
+    }
+
+    for (i = 0; i < NTP_WAITER_NUM; i++)
+    {
+        if (ntp.waiter[i])
+        {
+            ntp.waiter[i]->ok = ntp.best.valid;
+            sys_sem_signal(&ntp.waiter[i]->sem);
+            ntp.waiter[i] = NULL;
+        }
+    }
+
+    if (ntp.service)
+    {
+        sys_untimeout(ntp_service_tmr, NULL);
+        sys_timeout((ntp.best.valid ? ntp_clock.poll : NTP_POLL_MIN) * 1000,
+                    ntp_service_tmr, NULL);
+    }
+}
+
+static void ntp_try_tmr(void *arg)
+{
+    if (!ntp.best.valid && (ntp.tries < NTP_MAX_TRY_TIMES))
+    {
+        ntp.tries++;
+        if (ntp_send())
+        {
+            sys_timeout(NTP_TRY_MS, ntp_try_tmr, NULL);
+            return;
+        }
+    }
+    ntp_round_end();
+}
+
+static void ntp_round_start(void)
+{
+    if (ntp.round)
+        return;
+
+    memset(&ntp.best, 0, sizeof(ntp.best));
+    ntp.round = 1;
+    ntp.tries = 0;
+    ntp.status.rounds++;
+    ntp_try_tmr(NULL);
+}
+
+static void ntp_service_tmr(void *arg)
+{
+#if TLS_CONFIG_DNS_RESOLVER
+    u32 addr;
+    int i;
+
+    /* a miss refreshes the cache for the next round */
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        if (ntp.name[i][0] && (tls_dns_resolve(ntp.name[i], &addr, NULL, NULL) == TLS_DNS_OK))
+            ntp.srv[i].addr = addr;
+    }
+#endif
+    ntp_round_start();
+}
+
+static void ntp_service_start(void *arg)
+{
+    struct ntp_start *msg = arg;
+    int i;
+
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        ntp.srv[i].addr = msg->addr[i];
+        memcpy(ntp.name[i], msg->name[i], NTP_SERVER_DOMAIN_LEN);
+    }
+    tls_mem_free(msg);
+
+    if (!ntp.service)
+    {
+        ntp.service = 1;
+        ntp.status.service = 1;
+        ntp.rtc_written = 0;
+        sys_timeout(NTP_RTC_CHECK * 1000, ntp_rtc_check, NULL);
+    }
+    /* a round in flight schedules the next one when it ends */
+    if (!ntp.round)
+    {
+        sys_untimeout(ntp_service_tmr, NULL);
+        ntp_round_start();
+    }
+}
+
+static void ntp_service_stop(void *arg)
+{
+    ntp.service = 0;
+    ntp.status.service = 0;
+    sys_untimeout(ntp_service_tmr, NULL);
+    sys_untimeout(ntp_rtc_check, NULL);
+    sys_untimeout(ntp_rtc_tmr, NULL);
+}
+
+static void ntp_client_round(void *arg)
+{
+    struct ntp_wait *w = arg;
+    int i;
+
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        if (w->addr[i])
+            ntp.srv[i].addr = w->addr[i];
+    }
+
+    for (i = 0; i < NTP_WAITER_NUM; i++)
+    {
+        if (ntp.waiter[i] == NULL)
+        {
+            ntp.waiter[i] = w;
+            ntp_round_start();
+            return;
+        }
+    }
+    sys_sem_signal(&w->sem);
+}
+
+static int ntp_resolve(u32 *addr)
+{
+    struct hostent *host;
+    int num = 0;
+    int i;
+
+    for (i = 0; i < NTP_SERVER_MAX_NUM; i++)
+    {
+        tls_param_get(TLS_PARAM_ID_SNTP_SERVER1 + i, serverip[i], 1);
+        addr[i] = 0;
+        if (serverip[i][0] == '\0')
+            continue;
+        host = gethostbyname(serverip[i]);
+        if (NULL == host)
+            continue;
+        memcpy(&addr[i], host->h_addr, 4);
+        sntp_serverip[i] = addr[i];
+        num++;
+    }
+
+    return num;
+}
+
+static int ntp_fresh(void)
+{
+    u64 local = ntp_local_ms();
+    int fresh;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    fresh = ntp_clock.synced && ntp.service &&
+            ((local - ntp_clock.last_sync) < (u64)ntp_clock.poll * 1000);
+    SYS_ARCH_UNPROTECT(lev);
+
+    return fresh;
+}
+
+int tls_ntp_get_time(u32 *sec, u32 *ms)
+{
+    s64 utc;
+    u8 synced;
+
+    /* the first sync may be written while this reads */
+    utc = ntp_clock_read(ntp_local_ms(), &synced);
+    if (!synced)
+        return WM_FAILED;
+
+    if (sec)
+        *sec = (u32)(utc / 1000);
+    if (ms)
+        *ms = (u32)(utc % 1000);
 
     return WM_SUCCESS;
 }
 
 u32 tls_ntp_client(void)
 {
-    int ret = 0;
+    struct ntp_wait w;
     u32 time = 0;
-    u8 buf[BUF_LEN] = { 0 };
 
-    ret = open_connect(buf);
-    if (WM_SUCCESS == ret)
+    if (ntp_fresh() && (tls_ntp_get_time(&time, NULL) == WM_SUCCESS))
+        return time + NTP_TIMEZONE;
+
+    if (ntp_resolve(w.addr) == 0)
     {
-        get_reply(buf, &time);
+        ntp_debug("NTP Server DNS Failed ");
+        return 0;
     }
-    return time;
+
+    if (sys_sem_new(&w.sem, 0) != ERR_OK)
+        return 0;
+    w.ok = 0;
+    if (tcpip_callback(ntp_client_round, &w) == ERR_OK)
+        sys_arch_sem_wait(&w.sem, 0);
+    sys_sem_free(&w.sem);
+
+    if (w.ok && (tls_ntp_get_time(&time, NULL) == WM_SUCCESS))
+        return time + NTP_TIMEZONE;
+    return 0;
+}
+
+int tls_ntp_sync_start(void)
+{
+    struct ntp_start *msg;
+
+    msg = tls_mem_alloc(sizeof(struct ntp_start));
+    if (msg == NULL)
+        return WM_FAILED;
+
+    if (ntp_resolve(msg->addr) == 0)
+    {
+        tls_mem_free(msg);
+        return WM_FAILED;
+    }
+    memcpy(msg->name, serverip, sizeof(msg->name));
+
+    if (tcpip_callback(ntp_service_start, msg) != ERR_OK)
+    {
+        tls_mem_free(msg);
+        return WM_FAILED;
+    }
+
+    return WM_SUCCESS;
+}
+
+void tls_ntp_sync_stop(void)
+{
+    tcpip_callback(ntp_service_stop, NULL);
+}
+
+void tls_ntp_get_status(tls_ntp_status_t *status)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    memcpy(status, &ntp.status, sizeof(tls_ntp_status_t));
+    status->synced = ntp_clock.synced;
+    status->freq_ppb = ntp_clock.freq;
+    status->poll = ntp_clock.poll;
+    SYS_ARCH_UNPROTECT(lev);
 }
 
 int tls_ntp_set_server(char *ipaddr, int server_no)
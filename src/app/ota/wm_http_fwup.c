@@ -5,6 +5,11 @@
 #include "wm_http_fwup.h"
 #include "wm_debug.h"
 #include "wm_mem.h"
+#include "wm_params.h"
+#include "wm_param.h"
+#include "wm_internal_flash.h"
+#include "wm_wl_task.h"
+#include "wm_osal.h"
 
 #if TLS_CONFIG_HTTP_CLIENT
 
@@ -16,6 +21,60 @@
 
 enum ota_state {PREPARE_PACKET, SETUP_LINK_AND_REQ, RECV_RSP, HANDLE_HEADER, HANDLE_BODY, SHUTDOWN_LINK, QUIT_OTA};
 
+struct http_fwup_ctx
+{
+    u32 session_id;
+    u32 recvLen;        /* image bytes handed to the fwup engine */
+    u32 totalLen;       /* image length, from the image header */
+    u32 partLen;        /* body bytes of the current request */
+#if USE_BREAK_POINT_RESUME == 0
+    u32 skipLen;        /* already written bytes the server sends again */
+#endif
+    u8  fatal;          /* bad image or flash error, do not retry */
+};
+
+/* HTTPClientReadDataStream consumer, the body goes to the fwup engine in place */
+static UINT32 http_fwup_body(VOID *pArg, CHAR *pData, UINT32 nLength)
+{
+    struct http_fwup_ctx *ctx = (struct http_fwup_ctx *)pArg;
+    T_BOOTER *booter;
+
+    ctx->partLen += nLength;
+#if USE_BREAK_POINT_RESUME == 0
+    if(ctx->skipLen){
+        u32 skip = (nLength < ctx->skipLen) ? nLength : ctx->skipLen;
+
+        ctx->skipLen -= skip;
+        pData += skip;
+        nLength -= skip;
+        if(nLength == 0)
+            return HTTP_CLIENT_SUCCESS;
+    }
+#endif
+    if(ctx->recvLen == 0){
+        //fileSize = headerSize(fixed: 56) + appCodeSize
+        booter = (T_BOOTER *)pData;
+        if((nLength < sizeof(T_BOOTER)) || (TRUE != tls_fwup_img_header_check(booter))){
+            ctx->fatal = 1;
+            return HTTP_CLIENT_ERROR_BAD_HEADER;
+        }
+        ctx->totalLen = booter->upd_img_len + sizeof(T_BOOTER);
+        ctx->session_id = tls_fwup_enter(TLS_FWUP_IMAGE_SRC_WEB);
+        if(ctx->session_id == 0){
+            ctx->fatal = 1;
+            return HTTP_CLIENT_ERROR_BAD_STATE;
+        }
+    }
+
+    if(tls_fwup_request_sync(ctx->session_id, (u8 *)pData, nLength) != TLS_FWUP_STATUS_OK){
+        ctx->fatal = 1;
+        return HTTP_CLIENT_ERROR_BAD_STATE;
+    }
+    ctx->recvLen += nLength;
+    printf("download %d / %d\n", ctx->recvLen, ctx->totalLen);
+    return HTTP_CLIENT_SUCCESS;
+}
+
 int http_fwup(HTTPParameters ClientParams)
 {
     char* Buffer = NULL;  
@@ -23,22 +82,14 @@ int http_fwup(HTTPParameters ClientParams)
     char headRange[32] = {0};
     int  nRetCode = 0;
     u32  content_length=0, size=32;
-    u32  partLen;
-    u32 totalLen = 0;
-    u32 recvLen = 0;
-    T_BOOTER *booter;
-#if USE_BREAK_POINT_RESUME == 0
-    u32 breakFlag = 0;
-    u32 breakLen = 0;
-#endif
-    struct pbuf *p;
-    HTTP_SESSION_HANDLE  pHTTP;
+    struct http_fwup_ctx ctx;
+    HTTP_SESSION_HANDLE  pHTTP = 0;
     enum ota_state now_state = PREPARE_PACKET;
 
     Buffer = (char*)tls_mem_alloc(HTTP_CLIENT_BUFFER_SIZE);
     if (!Buffer)
         return HTTP_CLIENT_ERROR_NO_MEMORY;
-    memset(Buffer, 0, HTTP_CLIENT_BUFFER_SIZE);    
+    memset(&ctx, 0, sizeof(ctx));
 
     while(1)
     {
@@ -51,15 +102,12 @@ int http_fwup(HTTPParameters ClientParams)
                 pHTTP = HTTPClientOpenRequest(0);
 #if USE_BREAK_POINT_RESUME
                 HTTPClientSetVerb(pHTTP,VerbGet);
-                sprintf(headRange, "bytes=%d-", recvLen);
+                sprintf(headRange, "bytes=%d-", ctx.recvLen);
                 if((nRetCode = HTTPClientAddRequestHeaders(pHTTP,"Range", headRange, 1))!= HTTP_CLIENT_SUCCESS){
                     now_state = QUIT_OTA;
                 }
 #else
-                if( recvLen != 0 ){
-                    breakFlag = 1;
-                    breakLen = 0;
-                }
+                ctx.skipLen = ctx.recvLen;
 #endif
                 now_state = SETUP_LINK_AND_REQ;
             }
@@ -97,90 +145,20 @@ int http_fwup(HTTPParameters ClientParams)
                     content_length = atol(strstr(token,":")+1);
                     printf("content_length: %d\n", content_length);
                     now_state = HANDLE_BODY;
-                    if(recvLen == 0){
-                        nRetCode = socket_fwup_accept(0, ERR_OK);
-                        if(nRetCode != ERR_OK)
-                            now_state = QUIT_OTA;
-                    }
                 }
             }
             break;
             
             case HANDLE_BODY:
             {
-                partLen = 0;
-                while(nRetCode != HTTP_CLIENT_EOS )
-                {
-                    u32 nSize = HTTP_CLIENT_BUFFER_SIZE;
-                    nRetCode = HTTPClientReadData(pHTTP,Buffer+3,nSize,RECV_TIMEOUT,&nSize);
-                    if( recvLen == 0 ){
-                        //fileSize = headerSize(fixed: 56) + appCodeSize                   
-                        booter =(T_BOOTER *) (Buffer+3);
-                        if (TRUE == tls_fwup_img_header_check(booter))
-                        {
-                            totalLen = booter->upd_img_len + sizeof(T_BOOTER);
-                        }
-                        else
-                        {
-                            now_state = QUIT_OTA;
-                            break;
-                        }
-                    }
-
-                    if(nRetCode != HTTP_CLIENT_SUCCESS && nRetCode != HTTP_CLIENT_EOS){
-                        now_state = SHUTDOWN_LINK;
-                        break;
-                    }
-#if USE_BREAK_POINT_RESUME == 0
-                    if(breakFlag == 1){
-                        breakLen += nSize;
-                        if(breakLen <= recvLen){
-                            continue;
-                        }
-                        else{
-                            Buffer = Buffer+3+nSize-(breakLen-recvLen)-3;
-                            nSize = (breakLen-recvLen);
-                            breakFlag = 0;
-                        }
-                    }
-#endif
-
-                    p = pbuf_alloc(PBUF_TRANSPORT, nSize + 3, PBUF_REF);
-                    while( !p){
-                        tls_os_time_delay(1);
-                        p = pbuf_alloc(PBUF_TRANSPORT, nSize + 3, PBUF_REF);
-                    }
-                    
-                    if(recvLen == 0)
-                        *(Buffer+0) = SOCKET_FWUP_START;
-                    else if(nRetCode == HTTP_CLIENT_EOS && recvLen == (totalLen-nSize))
-                        *(Buffer+0) = SOCKET_FWUP_END;
-                    else
-                        *(Buffer+0) = SOCKET_FWUP_DATA;
-
-                    *(Buffer+1) = (nSize>>8) & 0xFF;
-                    *(Buffer+2) = nSize & 0xFF;	
-                    p->payload =  Buffer;
-                    p->len = p->tot_len = nSize + 3;
-                    // Send received data to fwup thread and deal with socket issues.
-                    s8 ret = socket_fwup_recv(0, p, ERR_OK);
-                    if(ret != ERR_OK){
-                        now_state = SHUTDOWN_LINK;
-                        break;
-                    }
-                    else{
-                        recvLen += nSize;
-                        partLen += nSize;           
-                        printf("download %d / %d\n", recvLen, totalLen);
-                        if(partLen == content_length){
-                            now_state = SHUTDOWN_LINK;
-                            break;
-                        }
-                    }
-                }
-				if (now_state == QUIT_OTA);
-				else
-                now_state = SHUTDOWN_LINK;
+                /* Received segments are written to flash straight from Buffer */
+                ctx.partLen = 0;
+                nRetCode = HTTPClientReadDataStream(pHTTP, Buffer, HTTP_CLIENT_BUFFER_SIZE,
+                                                    RECV_TIMEOUT, http_fwup_body, &ctx, NULL);
+                if (ctx.fatal)
+                    now_state = QUIT_OTA;
+                else
+                    now_state = SHUTDOWN_LINK;
             }
             break;
             
@@ -188,7 +166,7 @@ int http_fwup(HTTPParameters ClientParams)
             {
                 if(pHTTP){
                     HTTPClientCloseRequest(&pHTTP);
-                    (recvLen == totalLen)?(now_state = QUIT_OTA):(now_state = PREPARE_PACKET);
+                    (ctx.recvLen == ctx.totalLen)?(now_state = QUIT_OTA):(now_state = PREPARE_PACKET);
                 }
             }
             break;
@@ -204,17 +182,375 @@ int http_fwup(HTTPParameters ClientParams)
     tls_mem_free(Buffer);
     if(pHTTP)
         HTTPClientCloseRequest(&pHTTP);
+    if(ctx.totalLen && (ctx.recvLen == ctx.totalLen))
+        nRetCode = HTTP_CLIENT_SUCCESS;
     if(ClientParams.Verbose == TRUE)
     {
-        printf("\n\nHTTP Client terminated %d (got %d kb)\n\n",nRetCode,(recvLen/ 1024));
+        printf("\n\nHTTP Client terminated %d (got %d kb)\n\n",nRetCode,(ctx.recvLen/ 1024));
     }
-    if(nRetCode)
-        socket_fwup_err(0, nRetCode);
+    if(ctx.session_id)
+        tls_fwup_exit(ctx.session_id);
     return nRetCode;
 }
 
+#if TLS_CONFIG_HTTP_FWUP_RANGE
+/* Ranged download: the image is fetched in requests of HTTP_FWUP_CHUNK_MIN
+ * to HTTP_FWUP_CHUNK_MAX bytes, optionally by two connections. Chunks are
+ * handed to the fwup engine in image order and the programmed length is
+ * saved in TLS_PARAM_ID_FWUP_PROGRESS, so a reboot continues from there. */
+#define HTTP_FWUP_CHUNK_MIN      INSIDE_FLS_SECTOR_SIZE
+#define HTTP_FWUP_CHUNK_MAX      (4 * INSIDE_FLS_SECTOR_SIZE)
+#define HTTP_FWUP_CHUNK_FAST     (HZ / 2)    /* double the chunk below this */
+#define HTTP_FWUP_CHUNK_SLOW     (HZ * 3)    /* halve the chunk above this */
+#define HTTP_FWUP_RETRY          5
+#define HTTP_FWUP_SAVE_EVERY     (16 * INSIDE_FLS_SECTOR_SIZE)
+#define HTTP_FWUP_STK_SIZE       512
+
+struct http_fwup_range
+{
+    HTTPParameters *params;
+    T_BOOTER booter;
+    u32 session_id;
+    u32 url_hash;
+    u32 body_len;       /* image bytes after the header */
+    u32 next_fetch;     /* next image offset to request */
+    u32 next_commit;    /* image bytes handed to the fwup engine */
+    u32 saved;          /* programmed length in TLS_PARAM_ID_FWUP_PROGRESS */
+    u32 chunk;          /* current request size */
+    int err;
+    char *buf2;         /* chunk buffer of the second connection */
+    tls_os_sem_t *lock;
+    tls_os_sem_t *commit_sem;   /* released after every commit */
+    tls_os_sem_t *done_sem;     /* released when the second connection ends */
+};
+
+static u32 http_fwup_range_stk[HTTP_FWUP_STK_SIZE];
+
+static u32 http_fwup_url_hash(const char *url)
+{
+    u32 h = 5381;
+
+    while (*url)
+        h = (h * 33) ^ (u8)*url++;
+    return h;
+}
+
+static UINT32 http_fwup_range_body(VOID *pArg, CHAR *pData, UINT32 nLength)
+{
+    UINT32 *got = (UINT32 *)pArg;
+
+    /* the buffer holds exactly the requested range */
+    if (*got)
+        return HTTP_CLIENT_ERROR_LONG_INPUT;
+    *got = nLength;
+    return HTTP_CLIENT_SUCCESS;
+}
+
+/* GET file bytes [start, start + len) into buf */
+static int http_fwup_get_range(HTTPParameters *params, u32 start, u32 len, char *buf)
+{
+    HTTP_SESSION_HANDLE pHTTP;
+    HTTP_CLIENT info;
+    char range[32];
+    UINT32 got = 0;
+    int ret;
+
+    pHTTP = HTTPClientOpenRequest(0);
+    if (!pHTTP)
+        return HTTP_CLIENT_ERROR_NO_MEMORY;
+
+    sprintf(range, "bytes=%u-%u", start, start + len - 1);
+    do
+    {
+        if ((ret = HTTPClientSetVerb(pHTTP, VerbGet)) != HTTP_CLIENT_SUCCESS)
+            break;
+        if ((ret = HTTPClientAddRequestHeaders(pHTTP, "Range", range, 1)) != HTTP_CLIENT_SUCCESS)
+            break;
+        if ((ret = HTTPClientSendRequest(pHTTP, params->Uri, NULL, 0, FALSE, 0, 0)) != HTTP_CLIENT_SUCCESS)
+            break;
+        if ((ret = HTTPClientRecvResponse(pHTTP, RECV_TIMEOUT)) != HTTP_CLIENT_SUCCESS)
+            break;
+        HTTPClientGetInfo(pHTTP, &info);
+        if (info.HTTPStatusCode != 206)
+        {
+            /* no range support, the body would start at 0 */
+            ret = HTTP_CLIENT_ERROR_BAD_HEADER;
+            break;
+        }
+        ret = HTTPClientReadDataStream(pHTTP, buf, len, RECV_TIMEOUT, http_fwup_range_body, &got, NULL);
+        if ((ret == HTTP_CLIENT_EOS) && (got == len))
+            ret = HTTP_CLIENT_SUCCESS;
+        else if ((ret == HTTP_CLIENT_EOS) || (ret == HTTP_CLIENT_SUCCESS))
+            ret = HTTP_CLIENT_ERROR_SOCKET_RECV;
+    } while (0);
+
+    HTTPClientCloseRequest(&pHTTP);
+    return ret;
+}
+
+static void http_fwup_range_save(struct http_fwup_range *rng, u32 programmed)
+{
+    struct tls_param_fwup_progress prog;
+
+    memset(&prog, 0, sizeof(prog));
+    if (programmed)
+    {
+        prog.valid = 1;
+        prog.url_hash = rng->url_hash;
+        prog.img_checksum = rng->booter.upd_checksum;
+        prog.img_len = rng->body_len;
+        prog.programmed = programmed;
+    }
+    tls_param_set(TLS_PARAM_ID_FWUP_PROGRESS, &prog, TRUE);
+    rng->saved = programmed;
+}
+
+/* Aim at requests of one to three seconds: large requests save round
+ * trips on a fast link, small ones lose less on a bad link. */
+static void http_fwup_range_adapt(struct http_fwup_range *rng, u32 len, u32 ticks, bool ok)
+{
+    tls_os_sem_acquire(rng->lock, 0);
+    if (!ok || (ticks > HTTP_FWUP_CHUNK_SLOW))
+    {
+        if (rng->chunk > HTTP_FWUP_CHUNK_MIN)
+            rng->chunk /= 2;
+    }
+    else if ((ticks < HTTP_FWUP_CHUNK_FAST) && (len == rng->chunk))
+    {
+        if (rng->chunk < HTTP_FWUP_CHUNK_MAX)
+            rng->chunk *= 2;
+    }
+    tls_os_sem_release(rng->lock);
+}
+
+static int http_fwup_range_commit(struct http_fwup_range *rng, char *buf, u32 off, u32 len)
+{
+    u32 programmed;
+    bool last;
+
+    /* the engine verifies the image and resets once the last byte is in */
+    last = ((off + len) >= rng->body_len);
+    if (last)
+        http_fwup_range_save(rng, 0);
+
+    if (tls_fwup_request_sync(rng->session_id, (u8 *)buf, len) != TLS_FWUP_STATUS_OK)
+        return HTTP_CLIENT_ERROR_BAD_STATE;
+
+    /* still this connection's turn, the other one may commit the last
+       chunk as soon as next_commit moves on */
+    programmed = tls_fwup_programmed_len(rng->session_id);
+    if (!last && (programmed >= (rng->saved + HTTP_FWUP_SAVE_EVERY)))
+        http_fwup_range_save(rng, programmed);
+
+    tls_os_sem_acquire(rng->lock, 0);
+    rng->next_commit += len;
+    tls_os_sem_release(rng->lock);
+    tls_os_sem_release(rng->commit_sem);
+
+    printf("download %d / %d\n", off + len, rng->body_len);
+    return HTTP_CLIENT_SUCCESS;
+}
+
+static void http_fwup_range_worker(struct http_fwup_range *rng, char *buf)
+{
+    u32 off, len, start;
+    int tries;
+    int ret = HTTP_CLIENT_SUCCESS;
+
+    while (1)
+    {
+        tls_os_sem_acquire(rng->lock, 0);
+        if (rng->err || (rng->next_fetch >= rng->body_len))
+        {
+            tls_os_sem_release(rng->lock);
+            break;
+        }
+        off = rng->next_fetch;
+        len = rng->chunk;
+        if (len > (rng->body_len - off))
+            len = rng->body_len - off;
+        rng->next_fetch += len;
+        tls_os_sem_release(rng->lock);
+
+        for (tries = 0; tries < HTTP_FWUP_RETRY; tries++)
+        {
+            start = tls_os_get_time();
+            ret = http_fwup_get_range(rng->params, sizeof(T_BOOTER) + off, len, buf);
+            http_fwup_range_adapt(rng, len, tls_os_get_time() - start, ret == HTTP_CLIENT_SUCCESS);
+            if (ret == HTTP_CLIENT_SUCCESS)
+                break;
+            tls_os_time_delay(HZ);
+        }
+
+        /* commit in image order, the other connection may hold the chunk before */
+        while (ret == HTTP_CLIENT_SUCCESS)
+        {
+            tls_os_sem_acquire(rng->lock, 0);
+            if (rng->err || (rng->next_commit == off))
+            {
+                if (rng->err)
+                    ret = rng->err;
+                tls_os_sem_release(rng->lock);
+                break;
+            }
+            tls_os_sem_release(rng->lock);
+            tls_os_sem_acquire(rng->commit_sem, HZ);
+        }
+        if (ret == HTTP_CLIENT_SUCCESS)
+            ret = http_fwup_range_commit(rng, buf, off, len);
+
+        if (ret != HTTP_CLIENT_SUCCESS)
+        {
+            tls_os_sem_acquire(rng->lock, 0);
+            if (!rng->err)
+                rng->err = ret;
+            tls_os_sem_release(rng->lock);
+            tls_os_sem_release(rng->commit_sem);
+            break;
+        }
+    }
+}
+
+static void http_fwup_range_task(void *data)
+{
+    struct http_fwup_range *rng = (struct http_fwup_range *)data;
+
+    http_fwup_range_worker(rng, rng->buf2);
+    tls_os_sem_release(rng->done_sem);
+    tls_os_task_del(TLS_HTTP_FWUP_TASK_PRIO, NULL);
+}
+
+int http_fwup_range(HTTPParameters ClientParams, u8 connections)
+{
+    struct http_fwup_range rng;
+    struct tls_param_fwup_progress prog;
+    char *buf;
+    u32 resume = 0;
+    int tries;
+    int ret;
+
+    memset(&rng, 0, sizeof(rng));
+    rng.params = &ClientParams;
+    rng.url_hash = http_fwup_url_hash(ClientParams.Uri);
+    rng.chunk = HTTP_FWUP_CHUNK_MIN;
+
+    buf = (char *)tls_mem_alloc(HTTP_FWUP_CHUNK_MAX);
+    if (!buf)
+        return HTTP_CLIENT_ERROR_NO_MEMORY;
+
+    /* the image header tells whether the saved progress belongs to this image */
+    for (tries = 0; tries < HTTP_FWUP_RETRY; tries++)
+    {
+        ret = http_fwup_get_range(&ClientParams, 0, sizeof(T_BOOTER), buf);
+        if (ret == HTTP_CLIENT_SUCCESS)
+            break;
+        tls_os_time_delay(HZ);
+    }
+    if (ret != HTTP_CLIENT_SUCCESS)
+        goto out;
+    MEMCPY(&rng.booter, buf, sizeof(T_BOOTER));
+    if (TRUE != tls_fwup_img_header_check(&rng.booter))
+    {
+        ret = HTTP_CLIENT_ERROR_BAD_HEADER;
+        goto out;
+    }
+    rng.body_len = rng.booter.upd_img_len;
+
+    tls_param_get(TLS_PARAM_ID_FWUP_PROGRESS, &prog, FALSE);
+    if (prog.valid && (prog.url_hash == rng.url_hash) &&
+        (prog.img_checksum == rng.booter.upd_checksum) &&
+        (prog.img_len == rng.body_len) && (prog.programmed < rng.body_len))
+    {
+        rng.session_id = tls_fwup_enter_resume(TLS_FWUP_IMAGE_SRC_WEB, &rng.booter, prog.programmed);
+        if (rng.session_id)
+            resume = prog.programmed;
+    }
+    if (rng.session_id == 0)
+    {
+        rng.session_id = tls_fwup_enter(TLS_FWUP_IMAGE_SRC_WEB);
+        if ((rng.session_id == 0) ||
+            (tls_fwup_request_sync(rng.session_id, (u8 *)buf, sizeof(T_BOOTER)) != TLS_FWUP_STATUS_OK))
+        {
+            ret = HTTP_CLIENT_ERROR_BAD_STATE;
+            goto out;
+        }
+    }
+    if (resume)
+        printf("resume download at %d\n", resume);
+    rng.next_fetch = resume;
+    rng.next_commit = resume;
+    rng.saved = resume;
+
+    if ((tls_os_sem_create(&rng.lock, 1) != TLS_OS_SUCCESS) ||
+        (tls_os_sem_create(&rng.commit_sem, 0) != TLS_OS_SUCCESS) ||
+        (tls_os_sem_create(&rng.done_sem, 0) != TLS_OS_SUCCESS))
+    {
+        ret = HTTP_CLIENT_ERROR_NO_MEMORY;
+        goto out;
+    }
+
+    /* a second connection keeps the link busy while this one waits for
+       its request to be answered */
+    if ((connections > 1) && ((rng.body_len - resume) > HTTP_FWUP_CHUNK_MAX))
+    {
+        rng.buf2 = (char *)tls_mem_alloc(HTTP_FWUP_CHUNK_MAX);
+        if (rng.buf2 &&
+            (tls_os_task_create(NULL, "httpfwup", http_fwup_range_task, (void *)&rng,
+                                (void *)http_fwup_range_stk, HTTP_FWUP_STK_SIZE * sizeof(u32),
+                                TLS_HTTP_FWUP_TASK_PRIO, 0) != TLS_OS_SUCCESS))
+        {
+            tls_mem_free(rng.buf2);
+            rng.buf2 = NULL;
+        }
+    }
+
+    http_fwup_range_worker(&rng, buf);
+    if (rng.buf2)
+    {
+        tls_os_sem_acquire(rng.done_sem, 0);
+        tls_mem_free(rng.buf2);
+    }
+
+    if (rng.err)
+        ret = rng.err;
+    else if (rng.next_commit == rng.body_len)
+        ret = HTTP_CLIENT_SUCCESS;
+    else
+        ret = HTTP_CLIENT_ERROR_SOCKET_RECV;
+
+out:
+    if (rng.lock)
+        tls_os_sem_delete(rng.lock);
+    if (rng.commit_sem)
+        tls_os_sem_delete(rng.commit_sem);
+    if (rng.done_sem)
+        tls_os_sem_delete(rng.done_sem);
+    if (rng.session_id && (ret == HTTP_CLIENT_ERROR_BAD_STATE) && rng.body_len)
+    {
+        /* the engine rejected the data, a bad crc or a flash error; what
+           is in flash would fail the same way again */
+        http_fwup_range_save(&rng, 0);
+    }
+    else if (rng.session_id && (ret != HTTP_CLIENT_SUCCESS) && rng.body_len)
+    {
+        /* keep what is in flash for the next attempt */
+        resume = tls_fwup_programmed_len(rng.session_id);
+        if (resume > rng.saved)
+            http_fwup_range_save(&rng, resume);
+    }
+    if (rng.session_id)
+        tls_fwup_exit(rng.session_id);
+    tls_mem_free(buf);
+    if (ClientParams.Verbose == TRUE)
+    {
+        printf("\n\nHTTP Client terminated %d (got %d kb)\n\n", ret, (rng.next_commit / 1024));
+    }
+    return ret;
+}
+#endif
+
 int t_http_fwup(char *url)
-{
+{
 	HTTPParameters httpParams;
 	memset(&httpParams, 0, sizeof(HTTPParameters));
 	if (url == NULL)
@@ -227,7 +563,11 @@ int t_http_fwup(char *url)
 	}
 	printf("Location: %s\n",httpParams.Uri);
 	httpParams.Verbose = TRUE;
+#if TLS_CONFIG_HTTP_FWUP_RANGE
+	return http_fwup_range(httpParams, 2);
+#else
 	return http_fwup(httpParams);
+#endif
 }
 
 #endif //TLS_CONFIG_HTTP_CLIENT && TLS_CONFIG_SOCKET_RAW
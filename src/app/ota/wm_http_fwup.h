@@ -32,4 +32,20 @@
 ****************************************************************************/ 
 int   http_fwup(HTTPParameters ClientParams);
 
+/*************************************************************************** 
+* Function: http_fwup_range 
+* Description: Download the firmware in ranged requests and upgrade it. The 
+*              progress is saved in TLS_PARAM_ID_FWUP_PROGRESS, a download of 
+*              the same image continues from there after a reboot. The server 
+*              must answer Range requests with 206. 
+* 
+* Input: ClientParams: The parameters of connecting http server. 
+*        connections: 1 or 2 connections fetching chunks at the same time. 
+* 
+* Output: None 
+* 
+* Return: 0-success, other- failed 
+****************************************************************************/ 
+int   http_fwup_range(HTTPParameters ClientParams, u8 connections);
+
 #endif //WM_HTTP_FWUP_H
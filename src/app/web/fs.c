@@ -124,6 +124,19 @@ static void fs_free(struct fs_file *file)
   }
   return;
 }
+/*-----------------------------------------------------------------------------------*/
+/* Name hash used by the makefs index, keep in sync with fs_hash in makefs */
+unsigned int fs_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (*name)
+	{
+		hash = (hash * 33) ^ (unsigned char)*name++;
+	}
+	return hash;
+}
+
 /*-----------------------------------------------------------------------------------*/
 #ifdef FSDATA_IN_EXT_FLASH
 /* advance.html has max line of 530 bytes !!! */
@@ -192,6 +205,9 @@ struct fs_file *fs_open(char *name)
       file->index = file->len;
       file->pextension = NULL;
       file->ReadIndex=0;
+      file->etag = NULL;
+      file->flags = 0;
+      file->plain = NULL;
       return file;
     }
   }
@@ -200,10 +216,26 @@ struct fs_file *fs_open(char *name)
   return NULL;
 }
 #else
+static void fs_file_set(struct fs_file *file, const struct fsdata_file *f)
+{
+	file->data = (char *)f->data;
+	file->len = f->len;
+	file->index = f->len;
+	file->pextension = NULL;
+	file->ReadIndex=0;
+	file->etag = (const char *)f->etag;
+	file->flags = f->flags;
+	file->plain = f->plain;
+}
+
 struct fs_file *fs_open(char *name)
 {
 	struct fs_file *file;
 	const struct fsdata_file *f;
+#ifdef FS_INDEX
+	unsigned int hash;
+	int lo, hi, mid;
+#endif
   
 	DEBUG_PRINT("kevin debug fs_open = %s\n\r", name);
 	file = fs_malloc();
@@ -221,23 +253,57 @@ struct fs_file *fs_open(char *name)
 		gCurHtmlFile = 0;
 	}
 #endif  
+#ifdef FS_INDEX
+	/* binary search the hash index, then confirm the name */
+	hash = fs_hash(name);
+	lo = 0;
+	hi = FS_NUMFILES;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (FS_INDEX[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; (lo < FS_NUMFILES) && (FS_INDEX[lo].hash == hash); lo++)
+	{
+		f = FS_INDEX[lo].file;
+		if (!strcmp(name, (char *)f->name))
+		{
+			fs_file_set(file, f);
+			return file;
+		}
+	}
+#else
 	for(f = FS_ROOT; f != NULL; f = f->next) 
 	{
 		if (!strcmp(name, (char *)f->name)) 
 		{
-			file->data = (char *)f->data;
-			file->len = f->len;
-			file->index = f->len;
-			file->pextension = NULL;
-			file->ReadIndex=0;
+			fs_file_set(file, f);
 			return file;
 		}
 	}
+#endif
 	fs_free(file);
 	return NULL;
 }
 #endif
 
+/*-----------------------------------------------------------------------------------*/
+/* Switch an open gzip file to its uncompressed copy, -1 if it has none */
+int fs_use_plain(struct fs_file *file)
+{
+#ifdef FSDATA_IN_EXT_FLASH
+	return -1;
+#else
+	if (file->plain == NULL)
+		return -1;
+	fs_file_set(file, (const struct fsdata_file *)file->plain);
+	return 0;
+#endif
+}
+
 /*-----------------------------------------------------------------------------------*/
 void fs_close(struct fs_file *file)
 {
@@ -290,7 +356,7 @@ int fs_read_line(const void *ori_data, char  *buffer, int  max_length, int *temb
 	{
 		return -1;
 	}
-	idvaluebuffer = mem_malloc(MAX_ID_VALUE_BUFFER_LEN);
+	idvaluebuffer = tls_mem_alloc(MAX_ID_VALUE_BUFFER_LEN);
 	if(idvaluebuffer == NULL)
 	{
 		return -1;
@@ -373,7 +439,7 @@ int fs_read_line(const void *ori_data, char  *buffer, int  max_length, int *temb
 	 	len = -1;
 	 }
      if(idvaluebuffer)
-	 	mem_free(idvaluebuffer);
+	 	tls_mem_free(idvaluebuffer);
      return len; 
 }
 
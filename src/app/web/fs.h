@@ -32,12 +32,20 @@
 #ifndef __FS_H__
 #define __FS_H__
 
+/* fs_file.flags, set by makefs */
+#define FS_FILE_FLAG_GZIP   0x01  /* body is gzip compressed */
+#define FS_FILE_FLAG_ETAG   0x02  /* header has an ETag */
+#define FS_FILE_FLAG_LENGTH 0x04  /* HTTP/1.1 header with Content-Length */
+
 struct fs_file {
   char *data;
   int len;
   int index;
   int ReadIndex;
   void *pextension;
+  const char *etag;   /* quoted entity tag, NULL if the file has none */
+  int flags;          /* FS_FILE_FLAG_xxx */
+  const void *plain;  /* uncompressed copy of a gzip file, NULL if none */
 };
 
 /* file will be allocated and filled in by the fs_open function. file will
@@ -45,5 +53,7 @@ struct fs_file {
 struct fs_file *fs_open(char *name);
 void fs_close(struct fs_file *file);
 int fs_read(struct fs_file *file, char *buffer, int count);
+unsigned int fs_hash(const char *name);
+int fs_use_plain(struct fs_file *file);
 
 #endif /* __FS_H__ */
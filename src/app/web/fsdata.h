@@ -36,11 +36,22 @@
 //#define NULL ((void *)0)
 //#endif
 
+/* images built by older makefs only fill in the first four members */
 struct fsdata_file {
   const struct fsdata_file *next;
   const unsigned char *name;
   const unsigned char *data;
   const int len;
+  const unsigned int hash;          /* fs_hash() of name */
+  const unsigned char *etag;        /* quoted entity tag, or NULL */
+  const int flags;                  /* FS_FILE_FLAG_xxx, see fs.h */
+  const struct fsdata_file *plain;  /* uncompressed copy of a gzip file, or NULL */
+};
+
+/* FS_INDEX entries, sorted by hash */
+struct fsdata_index {
+  const unsigned int hash;
+  const struct fsdata_file *file;
 };
 
 #endif /* __FSDATA_H__ */
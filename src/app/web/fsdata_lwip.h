@@ -1,7 +1,7 @@
 static const unsigned char data_404_html[] = {
 	/* /404.html */
 	0x2f, 0x34, 0x30, 0x34, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0,
-	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x34, 
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x34, 
 	0x30, 0x34, 0x20, 0x46, 0x69, 0x6c, 0x65, 0x20, 0x6e, 0x6f, 
 	0x74, 0x20, 0x66, 0x6f, 0x75, 0x6e, 0x64, 0xd, 0xa, 0x53, 
 	0x65, 0x72, 0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 
@@ -11,7 +11,9 @@ static const unsigned char data_404_html[] = {
 	0x64, 0x61, 0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 
 	0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 
 	0x74, 0x79, 0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 
-	0x2f, 0x68, 0x74, 0x6d, 0x6c, 0xd, 0xa, 0xd, 0xa, };
+	0x2f, 0x68, 0x74, 0x6d, 0x6c, 0xd, 0xa, 0x43, 0x6f, 0x6e, 
+	0x74, 0x65, 0x6e, 0x74, 0x2d, 0x4c, 0x65, 0x6e, 0x67, 0x74, 
+	0x68, 0x3a, 0x20, 0x30, 0xd, 0xa, 0xd, 0xa, };
 
 static const unsigned char data_hedbasic_html[] = {
 	/* /hedbasic.html */
@@ -619,7 +621,7 @@ static const unsigned char data_hedfirmware_html[] = {
 static const unsigned char data_index_html[] = {
 	/* /index.html */
 	0x2f, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0,
-	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x32, 
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 
 	0x30, 0x30, 0x20, 0x4f, 0x4b, 0xd, 0xa, 0x53, 0x65, 0x72, 
 	0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 0x50, 0x2f, 
 	0x31, 0x2e, 0x32, 0x2e, 0x30, 0x20, 0x28, 0x68, 0x74, 0x74, 
@@ -628,47 +630,111 @@ static const unsigned char data_index_html[] = {
 	0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 0xd, 0xa, 
 	0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 
 	0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 
-	0x74, 0x6d, 0x6c, 0xd, 0xa, 0xd, 0xa, 0x3c, 0x21, 0x44, 
-	0x4f, 0x43, 0x54, 0x59, 0x50, 0x45, 0x20, 0x68, 0x74, 0x6d, 
-	0x6c, 0x20, 0x50, 0x55, 0x42, 0x4c, 0x49, 0x43, 0x20, 0x22, 
-	0x2d, 0x2f, 0x2f, 0x57, 0x33, 0x43, 0x2f, 0x2f, 0x44, 0x54, 
-	0x44, 0x20, 0x58, 0x48, 0x54, 0x4d, 0x4c, 0x20, 0x31, 0x2e, 
-	0x30, 0x20, 0x46, 0x72, 0x61, 0x6d, 0x65, 0x73, 0x65, 0x74, 
-	0x2f, 0x2f, 0x45, 0x4e, 0x22, 0x20, 0x22, 0x68, 0x74, 0x74, 
-	0x70, 0x3a, 0x2f, 0x2f, 0x77, 0x77, 0x77, 0x2e, 0x77, 0x33, 
-	0x2e, 0x6f, 0x72, 0x67, 0x2f, 0x54, 0x52, 0x2f, 0x78, 0x68, 
-	0x74, 0x6d, 0x6c, 0x31, 0x2f, 0x44, 0x54, 0x44, 0x2f, 0x78, 
-	0x68, 0x74, 0x6d, 0x6c, 0x31, 0x2d, 0x66, 0x72, 0x61, 0x6d, 
-	0x65, 0x73, 0x65, 0x74, 0x2e, 0x64, 0x74, 0x64, 0x22, 0x3e, 
-	0xd, 0xa, 0x3c, 0x68, 0x74, 0x6d, 0x6c, 0x20, 0x78, 0x6d, 
-	0x6c, 0x6e, 0x73, 0x3d, 0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 
-	0x2f, 0x2f, 0x77, 0x77, 0x77, 0x2e, 0x77, 0x33, 0x2e, 0x6f, 
-	0x72, 0x67, 0x2f, 0x31, 0x39, 0x39, 0x39, 0x2f, 0x78, 0x68, 
-	0x74, 0x6d, 0x6c, 0x22, 0x3e, 0xd, 0xa, 0x3c, 0x68, 0x65, 
-	0x61, 0x64, 0x3e, 0xd, 0xa, 0x9, 0x3c, 0x6d, 0x65, 0x74, 
-	0x61, 0x20, 0x68, 0x74, 0x74, 0x70, 0x2d, 0x65, 0x71, 0x75, 
-	0x69, 0x76, 0x3d, 0x22, 0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 
-	0x74, 0x2d, 0x54, 0x79, 0x70, 0x65, 0x22, 0x20, 0x63, 0x6f, 
-	0x6e, 0x74, 0x65, 0x6e, 0x74, 0x3d, 0x22, 0x74, 0x65, 0x78, 
-	0x74, 0x2f, 0x68, 0x74, 0x6d, 0x6c, 0x3b, 0x20, 0x63, 0x68, 
-	0x61, 0x72, 0x73, 0x65, 0x74, 0x3d, 0x67, 0x62, 0x32, 0x33, 
-	0x31, 0x32, 0x22, 0x20, 0x2f, 0x3e, 0xd, 0xa, 0x9, 0x3c, 
-	0x74, 0x69, 0x74, 0x6c, 0x65, 0x3e, 0x77, 0x65, 0x6c, 0x63, 
-	0x6f, 0x6d, 0x65, 0x21, 0x3c, 0x2f, 0x74, 0x69, 0x74, 0x6c, 
-	0x65, 0x3e, 0xd, 0xa, 0x3c, 0x2f, 0x68, 0x65, 0x61, 0x64, 
-	0x3e, 0xd, 0xa, 0x3c, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x73, 
-	0x65, 0x74, 0x20, 0x72, 0x6f, 0x77, 0x73, 0x3d, 0x22, 0x2a, 
-	0x22, 0x3e, 0xd, 0xa, 0x20, 0x20, 0x3c, 0x66, 0x72, 0x61, 
-	0x6d, 0x65, 0x20, 0x73, 0x72, 0x63, 0x3d, 0x22, 0x68, 0x65, 
-	0x64, 0x62, 0x61, 0x73, 0x69, 0x63, 0x2e, 0x68, 0x74, 0x6d, 
-	0x6c, 0x22, 0x20, 0x2f, 0x3e, 0xd, 0xa, 0x3c, 0x2f, 0x66, 
-	0x72, 0x61, 0x6d, 0x65, 0x73, 0x65, 0x74, 0x3e, 0xd, 0xa, 
-	0x3c, 0x2f, 0x68, 0x74, 0x6d, 0x6c, 0x3e, 0xd, 0xa, };
+	0x74, 0x6d, 0x6c, 0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 0x65, 
+	0x6e, 0x74, 0x2d, 0x45, 0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 
+	0x67, 0x3a, 0x20, 0x67, 0x7a, 0x69, 0x70, 0xd, 0xa, 0x56, 
+	0x61, 0x72, 0x79, 0x3a, 0x20, 0x41, 0x63, 0x63, 0x65, 0x70, 
+	0x74, 0x2d, 0x45, 0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 
+	0xd, 0xa, 0x45, 0x54, 0x61, 0x67, 0x3a, 0x20, 0x22, 0x65, 
+	0x35, 0x38, 0x63, 0x36, 0x34, 0x39, 0x31, 0x66, 0x35, 0x62, 
+	0x37, 0x64, 0x30, 0x30, 0x64, 0x22, 0xd, 0xa, 0x43, 0x61, 
+	0x63, 0x68, 0x65, 0x2d, 0x43, 0x6f, 0x6e, 0x74, 0x72, 0x6f, 
+	0x6c, 0x3a, 0x20, 0x6e, 0x6f, 0x2d, 0x63, 0x61, 0x63, 0x68, 
+	0x65, 0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 
+	0x2d, 0x4c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3a, 0x20, 0x32, 
+	0x35, 0x34, 0xd, 0xa, 0xd, 0xa, 0x1f, 0x8b, 0x8, 00, 
+	00, 00, 00, 00, 0x2, 0x3, 0x6d, 0x8e, 0x4b, 0x4f, 
+	0x83, 0x40, 0x14, 0x85, 0xd7, 0x9a, 0xf8, 0x1f, 0x6e, 0x67, 
+	0x69, 0x2, 0x57, 0xca, 0xa, 0x3b, 0x74, 0x21, 0xd4, 0x68, 
+	0x52, 0xb5, 0x31, 0x63, 0xaa, 0x4b, 0xa, 0xd7, 0x42, 0xc2, 
+	0xa3, 0xe, 0x57, 0x7, 0xff, 0xbd, 0x3, 0x43, 0x77, 0xae, 
+	0xee, 0xf3, 0x9c, 0xf3, 0xc9, 0x45, 0xfa, 0x92, 0xa8, 0x8f, 
+	0xdd, 0x6, 0x4a, 0x6e, 0x6a, 0xd8, 0xbd, 0xdd, 0x6d, 0x1f, 
+	0x13, 0x10, 0x1e, 0xe2, 0x3e, 0x4c, 0x10, 0x53, 0x95, 0xc2, 
+	0xfb, 0x83, 0x7a, 0xda, 0x42, 0xe0, 0xdf, 0xc0, 0xbd, 0xce, 
+	0x1a, 0xea, 0x89, 0x11, 0x37, 0xcf, 0x2, 0x44, 0xc9, 0x7c, 
+	0xba, 0x45, 0x34, 0xc6, 0xf8, 0x26, 0xf4, 0x3b, 0x7d, 0x44, 
+	0xf5, 0x8a, 0xc3, 0xe8, 0x13, 0x8c, 0xc2, 0xb9, 0xf5, 0x3e, 
+	0x67, 0x95, 0x5f, 0x70, 0x21, 0xd6, 0x57, 0x97, 0x72, 0x4a, 
+	0x1a, 0x9a, 0xba, 0xed, 0xe3, 0x7f, 0x3c, 0x82, 0x28, 0x8a, 
+	0x9c, 0xd4, 0x3d, 0x53, 0x56, 0xd8, 0x7a, 0x21, 0x1b, 0xe2, 
+	0xc, 0xc6, 0x77, 0x8f, 0xbe, 0xbe, 0xab, 0x9f, 0x58, 0x24, 
+	0x5d, 0xcb, 0xd4, 0xb2, 0xa7, 0x7e, 0x4f, 0x24, 0x20, 0x77, 
+	0x53, 0x2c, 0x98, 0x6, 0xc6, 0x51, 0xbe, 0x82, 0xbc, 0xcc, 
+	0xb4, 0xd, 0x8e, 0x8f, 0x87, 0x65, 0x18, 0x2c, 0x5, 0xe0, 
+	0x64, 0xc4, 0x15, 0xd7, 0xb4, 0x36, 0x54, 0xe7, 0x5d, 0x43, 
+	0xb, 0x89, 0x6e, 0xb6, 0x51, 0x38, 0x67, 0xc9, 0x33, 0x31, 
+	0xe8, 0xce, 0x58, 0xc6, 0xeb, 0x11, 0x4, 0xc0, 0xad, 0xa1, 
+	0xd7, 0xb9, 0xc5, 0xa6, 0xe2, 0x90, 0xf5, 0x55, 0xee, 0x4f, 
+	0x9c, 0x93, 0xb1, 0xc4, 0xb3, 0xcc, 0x79, 0xd9, 0x83, 0x6d, 
+	0xfe, 00, 0xc2, 0x43, 0x76, 0x85, 0x60, 0x1, 00, 00, 
+};
+
+static const unsigned char etag_index_html[] = "\"e58c6491f5b7d00d\"";
+
+static const unsigned char plain_index_html[] = {
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 
+	0x30, 0x30, 0x20, 0x4f, 0x4b, 0xd, 0xa, 0x53, 0x65, 0x72, 
+	0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 0x50, 0x2f, 
+	0x31, 0x2e, 0x32, 0x2e, 0x30, 0x20, 0x28, 0x68, 0x74, 0x74, 
+	0x70, 0x3a, 0x2f, 0x2f, 0x77, 0x77, 0x77, 0x2e, 0x73, 0x69, 
+	0x63, 0x73, 0x2e, 0x73, 0x65, 0x2f, 0x7e, 0x61, 0x64, 0x61, 
+	0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 0xd, 0xa, 
+	0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 
+	0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 
+	0x74, 0x6d, 0x6c, 0xd, 0xa, 0x56, 0x61, 0x72, 0x79, 0x3a, 
+	0x20, 0x41, 0x63, 0x63, 0x65, 0x70, 0x74, 0x2d, 0x45, 0x6e, 
+	0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 0xd, 0xa, 0x45, 0x54, 
+	0x61, 0x67, 0x3a, 0x20, 0x22, 0x61, 0x33, 0x63, 0x34, 0x31, 
+	0x64, 0x63, 0x63, 0x31, 0x61, 0x65, 0x34, 0x62, 0x66, 0x35, 
+	0x61, 0x22, 0xd, 0xa, 0x43, 0x61, 0x63, 0x68, 0x65, 0x2d, 
+	0x43, 0x6f, 0x6e, 0x74, 0x72, 0x6f, 0x6c, 0x3a, 0x20, 0x6e, 
+	0x6f, 0x2d, 0x63, 0x61, 0x63, 0x68, 0x65, 0xd, 0xa, 0x43, 
+	0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x4c, 0x65, 0x6e, 
+	0x67, 0x74, 0x68, 0x3a, 0x20, 0x33, 0x35, 0x32, 0xd, 0xa, 
+	0xd, 0xa, 0x3c, 0x21, 0x44, 0x4f, 0x43, 0x54, 0x59, 0x50, 
+	0x45, 0x20, 0x68, 0x74, 0x6d, 0x6c, 0x20, 0x50, 0x55, 0x42, 
+	0x4c, 0x49, 0x43, 0x20, 0x22, 0x2d, 0x2f, 0x2f, 0x57, 0x33, 
+	0x43, 0x2f, 0x2f, 0x44, 0x54, 0x44, 0x20, 0x58, 0x48, 0x54, 
+	0x4d, 0x4c, 0x20, 0x31, 0x2e, 0x30, 0x20, 0x46, 0x72, 0x61, 
+	0x6d, 0x65, 0x73, 0x65, 0x74, 0x2f, 0x2f, 0x45, 0x4e, 0x22, 
+	0x20, 0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x77, 
+	0x77, 0x77, 0x2e, 0x77, 0x33, 0x2e, 0x6f, 0x72, 0x67, 0x2f, 
+	0x54, 0x52, 0x2f, 0x78, 0x68, 0x74, 0x6d, 0x6c, 0x31, 0x2f, 
+	0x44, 0x54, 0x44, 0x2f, 0x78, 0x68, 0x74, 0x6d, 0x6c, 0x31, 
+	0x2d, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x73, 0x65, 0x74, 0x2e, 
+	0x64, 0x74, 0x64, 0x22, 0x3e, 0xd, 0xa, 0x3c, 0x68, 0x74, 
+	0x6d, 0x6c, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3d, 0x22, 
+	0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x77, 0x77, 0x77, 
+	0x2e, 0x77, 0x33, 0x2e, 0x6f, 0x72, 0x67, 0x2f, 0x31, 0x39, 
+	0x39, 0x39, 0x2f, 0x78, 0x68, 0x74, 0x6d, 0x6c, 0x22, 0x3e, 
+	0xd, 0xa, 0x3c, 0x68, 0x65, 0x61, 0x64, 0x3e, 0xd, 0xa, 
+	0x9, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20, 0x68, 0x74, 0x74, 
+	0x70, 0x2d, 0x65, 0x71, 0x75, 0x69, 0x76, 0x3d, 0x22, 0x43, 
+	0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x54, 0x79, 0x70, 
+	0x65, 0x22, 0x20, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 
+	0x3d, 0x22, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 0x74, 0x6d, 
+	0x6c, 0x3b, 0x20, 0x63, 0x68, 0x61, 0x72, 0x73, 0x65, 0x74, 
+	0x3d, 0x67, 0x62, 0x32, 0x33, 0x31, 0x32, 0x22, 0x20, 0x2f, 
+	0x3e, 0xd, 0xa, 0x9, 0x3c, 0x74, 0x69, 0x74, 0x6c, 0x65, 
+	0x3e, 0x77, 0x65, 0x6c, 0x63, 0x6f, 0x6d, 0x65, 0x21, 0x3c, 
+	0x2f, 0x74, 0x69, 0x74, 0x6c, 0x65, 0x3e, 0xd, 0xa, 0x3c, 
+	0x2f, 0x68, 0x65, 0x61, 0x64, 0x3e, 0xd, 0xa, 0x3c, 0x66, 
+	0x72, 0x61, 0x6d, 0x65, 0x73, 0x65, 0x74, 0x20, 0x72, 0x6f, 
+	0x77, 0x73, 0x3d, 0x22, 0x2a, 0x22, 0x3e, 0xd, 0xa, 0x20, 
+	0x20, 0x3c, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x20, 0x73, 0x72, 
+	0x63, 0x3d, 0x22, 0x68, 0x65, 0x64, 0x62, 0x61, 0x73, 0x69, 
+	0x63, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x22, 0x20, 0x2f, 0x3e, 
+	0xd, 0xa, 0x3c, 0x2f, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x73, 
+	0x65, 0x74, 0x3e, 0xd, 0xa, 0x3c, 0x2f, 0x68, 0x74, 0x6d, 
+	0x6c, 0x3e, 0xd, 0xa, };
+
+static const unsigned char plainetag_index_html[] = "\"a3c41dcc1ae4bf5a\"";
 
 static const unsigned char data_jump_html[] = {
 	/* /jump.html */
 	0x2f, 0x6a, 0x75, 0x6d, 0x70, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0,
-	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x32, 
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 
 	0x30, 0x30, 0x20, 0x4f, 0x4b, 0xd, 0xa, 0x53, 0x65, 0x72, 
 	0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 0x50, 0x2f, 
 	0x31, 0x2e, 0x32, 0x2e, 0x30, 0x20, 0x28, 0x68, 0x74, 0x74, 
@@ -677,12 +743,21 @@ static const unsigned char data_jump_html[] = {
 	0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 0xd, 0xa, 
 	0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 
 	0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 
-	0x74, 0x6d, 0x6c, 0xd, 0xa, 0xd, 0xa, };
+	0x74, 0x6d, 0x6c, 0xd, 0xa, 0x45, 0x54, 0x61, 0x67, 0x3a, 
+	0x20, 0x22, 0x64, 0x34, 0x31, 0x64, 0x38, 0x63, 0x64, 0x39, 
+	0x38, 0x66, 0x30, 0x30, 0x62, 0x32, 0x30, 0x34, 0x22, 0xd, 
+	0xa, 0x43, 0x61, 0x63, 0x68, 0x65, 0x2d, 0x43, 0x6f, 0x6e, 
+	0x74, 0x72, 0x6f, 0x6c, 0x3a, 0x20, 0x6e, 0x6f, 0x2d, 0x63, 
+	0x61, 0x63, 0x68, 0x65, 0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 
+	0x65, 0x6e, 0x74, 0x2d, 0x4c, 0x65, 0x6e, 0x67, 0x74, 0x68, 
+	0x3a, 0x20, 0x30, 0xd, 0xa, 0xd, 0xa, };
+
+static const unsigned char etag_jump_html[] = "\"d41d8cd98f00b204\"";
 
 static const unsigned char data_style_css[] = {
 	/* /style.css */
 	0x2f, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x2e, 0x63, 0x73, 0x73, 0,
-	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x32, 
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 
 	0x30, 0x30, 0x20, 0x4f, 0x4b, 0xd, 0xa, 0x53, 0x65, 0x72, 
 	0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 0x50, 0x2f, 
 	0x31, 0x2e, 0x32, 0x2e, 0x30, 0x20, 0x28, 0x68, 0x74, 0x74, 
@@ -691,53 +766,123 @@ static const unsigned char data_style_css[] = {
 	0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 0xd, 0xa, 
 	0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 
 	0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x63, 
-	0x73, 0x73, 0xd, 0xa, 0xd, 0xa, 0x2f, 0x2a, 0x2a, 0x2a, 
-	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
+	0x73, 0x73, 0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 
+	0x74, 0x2d, 0x45, 0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 
+	0x3a, 0x20, 0x67, 0x7a, 0x69, 0x70, 0xd, 0xa, 0x56, 0x61, 
+	0x72, 0x79, 0x3a, 0x20, 0x41, 0x63, 0x63, 0x65, 0x70, 0x74, 
+	0x2d, 0x45, 0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 0xd, 
+	0xa, 0x45, 0x54, 0x61, 0x67, 0x3a, 0x20, 0x22, 0x64, 0x62, 
+	0x65, 0x30, 0x63, 0x36, 0x62, 0x33, 0x39, 0x36, 0x36, 0x32, 
+	0x62, 0x31, 0x38, 0x37, 0x22, 0xd, 0xa, 0x43, 0x61, 0x63, 
+	0x68, 0x65, 0x2d, 0x43, 0x6f, 0x6e, 0x74, 0x72, 0x6f, 0x6c, 
+	0x3a, 0x20, 0x6e, 0x6f, 0x2d, 0x63, 0x61, 0x63, 0x68, 0x65, 
+	0xd, 0xa, 0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 
+	0x4c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3a, 0x20, 0x31, 0x36, 
+	0x37, 0xd, 0xa, 0xd, 0xa, 0x1f, 0x8b, 0x8, 00, 00, 
+	00, 00, 00, 0x2, 0x3, 0x95, 0x8e, 0xb1, 0xa, 0xc2, 
+	0x30, 0x14, 0x45, 0x67, 0xb, 0xf9, 0x87, 0x7, 0x6e, 0xc5, 
+	0x5a, 0x8a, 0xd0, 0x21, 0x4e, 0x6e, 0xe, 0xba, 0xf9, 0x3, 
+	0x69, 0xfb, 0x92, 0x3e, 0x4c, 0xf3, 0x24, 0x89, 0x42, 0x10, 
+	0xff, 0xdd, 0xb6, 0xce, 0x15, 0x7a, 0xc6, 0xc3, 0xbd, 0xdc, 
+	0x5b, 0xe6, 0xeb, 0x28, 0x45, 0x56, 0xe6, 0x70, 0xbe, 0x5d, 
+	0x2f, 0x10, 0x95, 0x81, 0x10, 0x93, 0xc5, 00, 0xff, 0xf8, 
+	0x55, 0x56, 0xaf, 0x34, 0xdc, 0xa5, 0xb7, 0xc8, 0x36, 0x9a, 
+	0x5d, 0x2c, 0xb4, 0x1a, 0xc8, 0x26, 0x9, 0x27, 0x4f, 0xca, 
+	0xee, 0x82, 0x72, 0xa1, 0x8, 0xe8, 0x49, 0x1f, 0xc7, 0x40, 
+	0xcb, 0x96, 0xbd, 0x84, 0xed, 0x61, 0x66, 0x32, 0x96, 0x1c, 
+	0x16, 0x3d, 0x92, 0xe9, 0xa3, 0x84, 0x6a, 0x5f, 0xd5, 0xf5, 
+	0x64, 0x1b, 0xd5, 0xde, 0x8d, 0xe7, 0xa7, 0xeb, 0xc6, 0x70, 
+	0x3b, 0x33, 0xe9, 0x7, 0x7, 0x8a, 0xc4, 0x4e, 0x7a, 0xb4, 
+	0x2a, 0xd2, 0xb, 0x45, 0xf6, 0x59, 0x3a, 0xc, 0xe8, 0x3a, 
+	0x58, 0x7c, 0xfc, 0x5, 0x16, 0xab, 0x14, 0x81, 0x4b, 0x1, 
+	00, 00, };
+
+static const unsigned char etag_style_css[] = "\"dbe0c6b39662b187\"";
+
+static const unsigned char plain_style_css[] = {
+	0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 
+	0x30, 0x30, 0x20, 0x4f, 0x4b, 0xd, 0xa, 0x53, 0x65, 0x72, 
+	0x76, 0x65, 0x72, 0x3a, 0x20, 0x6c, 0x77, 0x49, 0x50, 0x2f, 
+	0x31, 0x2e, 0x32, 0x2e, 0x30, 0x20, 0x28, 0x68, 0x74, 0x74, 
+	0x70, 0x3a, 0x2f, 0x2f, 0x77, 0x77, 0x77, 0x2e, 0x73, 0x69, 
+	0x63, 0x73, 0x2e, 0x73, 0x65, 0x2f, 0x7e, 0x61, 0x64, 0x61, 
+	0x6d, 0x2f, 0x6c, 0x77, 0x69, 0x70, 0x2f, 0x29, 0xd, 0xa, 
+	0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 
+	0x70, 0x65, 0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x63, 
+	0x73, 0x73, 0xd, 0xa, 0x56, 0x61, 0x72, 0x79, 0x3a, 0x20, 
+	0x41, 0x63, 0x63, 0x65, 0x70, 0x74, 0x2d, 0x45, 0x6e, 0x63, 
+	0x6f, 0x64, 0x69, 0x6e, 0x67, 0xd, 0xa, 0x45, 0x54, 0x61, 
+	0x67, 0x3a, 0x20, 0x22, 0x31, 0x61, 0x64, 0x38, 0x33, 0x30, 
+	0x62, 0x63, 0x36, 0x63, 0x63, 0x37, 0x38, 0x63, 0x61, 0x30, 
+	0x22, 0xd, 0xa, 0x43, 0x61, 0x63, 0x68, 0x65, 0x2d, 0x43, 
+	0x6f, 0x6e, 0x74, 0x72, 0x6f, 0x6c, 0x3a, 0x20, 0x6e, 0x6f, 
+	0x2d, 0x63, 0x61, 0x63, 0x68, 0x65, 0xd, 0xa, 0x43, 0x6f, 
+	0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x4c, 0x65, 0x6e, 0x67, 
+	0x74, 0x68, 0x3a, 0x20, 0x33, 0x33, 0x31, 0xd, 0xa, 0xd, 
+	0xa, 0x2f, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
-	0x2a, 0x2a, 0x2a, 0x2a, 0x2f, 0xd, 0xa, 0x2f, 0x2a, 0x20, 
-	0x48, 0x54, 0x4d, 0x4c, 0x20, 0x74, 0x61, 0x67, 0x20, 0x73, 
-	0x74, 0x79, 0x6c, 0x65, 0x73, 0x20, 0x20, 0x20, 0x20, 0x20, 
+	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2f, 
+	0xd, 0xa, 0x2f, 0x2a, 0x20, 0x48, 0x54, 0x4d, 0x4c, 0x20, 
+	0x74, 0x61, 0x67, 0x20, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x73, 
 	0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
 	0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
-	0x20, 0x20, 0x20, 0x20, 0x2a, 0x2f, 0xd, 0xa, 0x2f, 0x2a, 
+	0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2a, 
+	0x2f, 0xd, 0xa, 0x2f, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
-	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2f, 0xd, 0xa, 0x62, 
-	0x6f, 0x64, 0x79, 0x7b, 0xd, 0xa, 0x9, 0x66, 0x6f, 0x6e, 
-	0x74, 0x2d, 0x66, 0x61, 0x6d, 0x69, 0x6c, 0x79, 0x3a, 0x20, 
-	0x41, 0x72, 0x69, 0x61, 0x6c, 0x2c, 0x73, 0x61, 0x6e, 0x73, 
-	0x2d, 0x73, 0x65, 0x72, 0x69, 0x66, 0x3b, 0xd, 0xa, 0x9, 
-	0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x33, 0x33, 
-	0x33, 0x33, 0x33, 0x33, 0x3b, 0xd, 0xa, 0x9, 0x6c, 0x69, 
-	0x6e, 0x65, 0x2d, 0x68, 0x65, 0x69, 0x67, 0x68, 0x74, 0x3a, 
-	0x20, 0x31, 0x2e, 0x31, 0x36, 0x36, 0x3b, 0xd, 0xa, 0x9, 
-	0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 
-	0x3a, 0x20, 0x23, 0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3b, 
-	0xd, 0xa, 0x9, 0x70, 0x6f, 0x73, 0x69, 0x74, 0x69, 0x6f, 
-	0x6e, 0x3a, 0x72, 0x65, 0x6c, 0x61, 0x74, 0x69, 0x76, 0x65, 
-	0xd, 0xa, 0x7d, 0xd, 0xa, 0x2f, 0x2a, 0x2a, 0x2a, 0x2a, 
+	0x2a, 0x2f, 0xd, 0xa, 0x62, 0x6f, 0x64, 0x79, 0x7b, 0xd, 
+	0xa, 0x9, 0x66, 0x6f, 0x6e, 0x74, 0x2d, 0x66, 0x61, 0x6d, 
+	0x69, 0x6c, 0x79, 0x3a, 0x20, 0x41, 0x72, 0x69, 0x61, 0x6c, 
+	0x2c, 0x73, 0x61, 0x6e, 0x73, 0x2d, 0x73, 0x65, 0x72, 0x69, 
+	0x66, 0x3b, 0xd, 0xa, 0x9, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 
+	0x3a, 0x20, 0x23, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3b, 
+	0xd, 0xa, 0x9, 0x6c, 0x69, 0x6e, 0x65, 0x2d, 0x68, 0x65, 
+	0x69, 0x67, 0x68, 0x74, 0x3a, 0x20, 0x31, 0x2e, 0x31, 0x36, 
+	0x36, 0x3b, 0xd, 0xa, 0x9, 0x62, 0x61, 0x63, 0x6b, 0x67, 
+	0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a, 0x20, 0x23, 0x63, 0x63, 
+	0x63, 0x63, 0x63, 0x63, 0x3b, 0xd, 0xa, 0x9, 0x70, 0x6f, 
+	0x73, 0x69, 0x74, 0x69, 0x6f, 0x6e, 0x3a, 0x72, 0x65, 0x6c, 
+	0x61, 0x74, 0x69, 0x76, 0x65, 0xd, 0xa, 0x7d, 0xd, 0xa, 
+	0x2f, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
-	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x20, 0x65, 0x6e, 
-	0x64, 0x20, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
+	0x2a, 0x2a, 0x20, 0x65, 0x6e, 0x64, 0x20, 0x2a, 0x2a, 0x2a, 
 	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 
-	0x2a, 0x2a, 0x2a, 0x2a, 0x2f, 0xd, 0xa, };
+	0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2f, 
+	0xd, 0xa, };
+
+static const unsigned char plainetag_style_css[] = "\"1ad830bc6cc78ca0\"";
 
-const struct fsdata_file file_404_html[] = {{NULL, data_404_html, data_404_html + 10, sizeof(data_404_html) - 10}};
+const struct fsdata_file file_404_html[] = {{NULL, data_404_html, data_404_html + 10, sizeof(data_404_html) - 10, 2610624489U, NULL, 4, NULL}};
 
-const struct fsdata_file file_hedbasic_html[] = {{file_404_html, data_hedbasic_html, data_hedbasic_html + 15, sizeof(data_hedbasic_html) - 15}};
+const struct fsdata_file file_hedbasic_html[] = {{file_404_html, data_hedbasic_html, data_hedbasic_html + 15, sizeof(data_hedbasic_html) - 15, 3043556842U, NULL, 0, NULL}};
 
-const struct fsdata_file file_hedfirmware_html[] = {{file_hedbasic_html, data_hedfirmware_html, data_hedfirmware_html + 18, sizeof(data_hedfirmware_html) - 18}};
+const struct fsdata_file file_hedfirmware_html[] = {{file_hedbasic_html, data_hedfirmware_html, data_hedfirmware_html + 18, sizeof(data_hedfirmware_html) - 18, 698499233U, NULL, 0, NULL}};
 
-const struct fsdata_file file_index_html[] = {{file_hedfirmware_html, data_index_html, data_index_html + 12, sizeof(data_index_html) - 12}};
+static const struct fsdata_file plainfile_index_html[] = {{NULL, data_index_html, plain_index_html, sizeof(plain_index_html), 1512781063U, plainetag_index_html, 6, NULL}};
 
-const struct fsdata_file file_jump_html[] = {{file_index_html, data_jump_html, data_jump_html + 11, sizeof(data_jump_html) - 11}};
+const struct fsdata_file file_index_html[] = {{file_hedfirmware_html, data_index_html, data_index_html + 12, sizeof(data_index_html) - 12, 1512781063U, etag_index_html, 7, plainfile_index_html}};
 
-const struct fsdata_file file_style_css[] = {{file_jump_html, data_style_css, data_style_css + 11, sizeof(data_style_css) - 11}};
+const struct fsdata_file file_jump_html[] = {{file_index_html, data_jump_html, data_jump_html + 11, sizeof(data_jump_html) - 11, 1464747707U, etag_jump_html, 6, NULL}};
+
+static const struct fsdata_file plainfile_style_css[] = {{NULL, data_style_css, plain_style_css, sizeof(plain_style_css), 1051273552U, plainetag_style_css, 6, NULL}};
+
+const struct fsdata_file file_style_css[] = {{file_jump_html, data_style_css, data_style_css + 11, sizeof(data_style_css) - 11, 1051273552U, etag_style_css, 7, plainfile_style_css}};
 
 #define FS_ROOT file_style_css
 
 #define FS_NUMFILES 6
+
+const struct fsdata_index fs_index[] = {
+	{698499233U, file_hedfirmware_html},
+	{1051273552U, file_style_css},
+	{1464747707U, file_jump_html},
+	{1512781063U, file_index_html},
+	{2610624489U, file_404_html},
+	{3043556842U, file_hedbasic_html},
+};
+
+#define FS_INDEX fs_index
@@ -190,6 +190,11 @@ struct http_state {
  struct http_recive http_recive_request;
   struct pbuf *RecvPbuf;
   int RecvOffset;
+  u8 keepalive;     /* response has a Content-Length, keep the connection */
+  u8 parsing;       /* in http_parse_requests(), close_conn defers the free */
+  u8 closed;        /* closed while parsing */
+  u8 idle;          /* http_poll calls without a request in progress */
+  u16 requests;     /* requests served on this connection */
 //  struct tcp_pcb *pcb;
 };
 
@@ -212,6 +217,7 @@ const tCGI *g_pCGIs = NULL;
 int g_iNumCGIs = 0;
 #endif /* INCLUDE_HTTPD_CGI */
 static u32 session_id;
+static u8 http_conns;   /* open connections, see HTTPD_KEEPALIVE_MAX_CONNS */
 
  const  char GpucHttpHead_Authen[] = {\
     "HTTP/1.1 401 Unauthorized\r\n"
@@ -252,9 +258,15 @@ conn_err(void *arg, err_t err)
       }
       if(hs->buf)
       {
-          mem_free(hs->buf);
+          tls_mem_free(hs->buf);
       }
-      mem_free(hs);
+      if(hs->http_recive_request.Httpd_recive_buf)
+      {
+          tls_mem_free(hs->http_recive_request.Httpd_recive_buf);
+      }
+      if(http_conns)
+          http_conns--;
+      tls_mem_free(hs);
   }
 }
 /*-----------------------------------------------------------------------------------*/
@@ -275,9 +287,22 @@ close_conn(struct tcp_pcb *pcb, struct http_state *hs)
   }
   if(hs->buf)
   {
-    mem_free(hs->buf);
+    tls_mem_free(hs->buf);
+    hs->buf = NULL;
+  }
+  if(http_conns)
+    http_conns--;
+  if(hs->parsing)
+  {
+    /* http_parse_requests() is still using hs, it frees it */
+    hs->closed = 1;
+  }
+  else
+  {
+    if(hs->http_recive_request.Httpd_recive_buf)
+      tls_mem_free(hs->http_recive_request.Httpd_recive_buf);
+    tls_mem_free(hs);
   }
-  mem_free(hs);
   if (pcb)
   	tcp_close(pcb);
 #if TLS_CONFIG_WEB_SERVER_MODE
@@ -376,6 +401,14 @@ extern int fs_read_line(const void *data, char  *buffer, int  max_length,int * t
 void send_data_to_sys(struct http_state *hs);
 void send_jump_html(struct http_state *hs,struct tcp_pcb *pcb);
 void send_error_html(struct http_state *hs,struct tcp_pcb *pcb, int error);
+static void send_status_reply(struct http_state *hs,struct tcp_pcb *pcb, const char *status, const char *etag);
+static int http_header_has(const char *hdrs, const char *name, const char *token);
+static int http_keepalive_ok(struct http_state *hs, const char *hdrs);
+static void http_response_done(struct tcp_pcb *pcb, struct http_state *hs);
+static void http_parse_requests(struct http_state *hs, struct tcp_pcb *pcb);
+#if TLS_CONFIG_TASK_PROFILE
+void send_taskprof_html(struct http_state *hs,struct tcp_pcb *pcb, char *params);
+#endif
 
 /*-----------------------------------------------------------------------------------*/
 static err_t
@@ -397,6 +430,12 @@ send_data(struct tcp_pcb *pcb, struct http_state *hs)
   {
     int count;
 
+    /* The whole file was sent straight from its memory, nothing to read */
+    if(hs->handle && (hs->handle->index == hs->handle->len)) {
+      http_response_done(pcb, hs);
+      return;
+    }
+
     /* Do we already have a send buffer allocated? */
     if(hs->buf) {
       /* Yes - get the length of the buffer */
@@ -406,7 +445,7 @@ send_data(struct tcp_pcb *pcb, struct http_state *hs)
       /* We don't have a send buffer so allocate one up to 2*mss bytes long. */
       count = 2*pcb->mss;
       do {
-        hs->buf = mem_malloc(count);
+        hs->buf = tls_mem_alloc(count);
         if(hs->buf) {
           hs->buf_len = count;
           break;
@@ -488,7 +527,7 @@ send_data(struct tcp_pcb *pcb, struct http_state *hs)
 if (hs->file_flag & FILEFLAG_FILTER)
 {
 	int memlen=len+10;
-	Temp=mem_malloc(memlen);
+	Temp=tls_mem_alloc(memlen);
 	if(Temp==NULL)
 	{
 	   err = ERR_MEM;
@@ -518,19 +557,43 @@ if (hs->file_flag & FILEFLAG_FILTER)
         }
       } while (err == ERR_MEM && filelen > 1);
 if(Temp)
-	mem_free(Temp);
- }
-	  else
-	  {
-		  filelen = len;
-		  err = tcp_write(pcb, hs->file, filelen, 0);
-	  }
+	tls_mem_free(Temp);
 
       if (err == ERR_OK) {
         data_to_send = TRUE;
         hs->file += filelen;
         hs->left -= filelen;
       }
+ }
+	  else
+	  {
+		  /* Static files are memory mapped, hand them to TCP without a
+		     copy and queue as many segments as the send buffer takes.
+		     Only data read into hs->buf must be copied, buf is reused. */
+		  u8 apiflags = 0;
+
+		  if (hs->buf && (hs->file >= hs->buf) &&
+		      (hs->file < hs->buf + hs->buf_len))
+			  apiflags = TCP_WRITE_FLAG_COPY;
+
+		  while (hs->left > 0)
+		  {
+			  len = (tcp_sndbuf(pcb) < hs->left) ? tcp_sndbuf(pcb) : hs->left;
+			  if (len > (2*pcb->mss))
+				  len = 2*pcb->mss;
+			  if (len == 0)
+				  break;
+
+			  err = tcp_write(pcb, hs->file, len,
+			                  apiflags | ((hs->left > len) ? TCP_WRITE_FLAG_MORE : 0));
+			  if (err != ERR_OK)
+				  break;	/* segment queue full, continue on http_sent */
+
+			  data_to_send = TRUE;
+			  hs->file += len;
+			  hs->left -= len;
+		  }
+	  }
 #ifdef INCLUDE_HTTPD_SSI
   } else {
     /* We are processing an SHTML file so need to scan for tags and replace
@@ -905,7 +968,17 @@ http_poll(void *arg, struct tcp_pcb *pcb)
     tcp_abort(pcb);
     return ERR_ABRT;
 } else {
-    if (hs->recv_state == 0){
+    if ((hs->recv_state == 0) && (hs->handle == NULL)){
+	    /* Waiting for the (next) request. Idle connections are closed
+	       after HTTPD_KEEPALIVE_IDLE_POLLS, or at once while the server
+	       has more than HTTPD_KEEPALIVE_MAX_CONNS connections open. */
+	    if ((++hs->idle >= HTTPD_KEEPALIVE_IDLE_POLLS) ||
+	        (http_conns > HTTPD_KEEPALIVE_MAX_CONNS)) {
+		  DEBUG_PRINT("idle, close\n\r");
+	      close_conn(pcb, hs);
+	    }
+    }
+    else if (hs->recv_state == 0){
 	    ++hs->retries;
 	    if (hs->retries >= 10) {
 	      tcp_abort(pcb);
@@ -1079,6 +1152,7 @@ static void resethandler()
   // int UrlBufSize = HTTP_MAX_REQUEST_LEN;
    ///char Url[HTTP_MAX_REQUEST_LEN];
    char * Url=NULL;
+   char * Hdrs=NULL;
   #ifdef INCLUDE_HTTPD_CGI
   int count;
   char *params;
@@ -1141,6 +1215,7 @@ static void resethandler()
                 (Url[i + 4] == 'P')) 
             {
               Url[i] = 0;   
+              Hdrs = &Url[i + 1];
               break;
             }                    
         }
@@ -1150,7 +1225,10 @@ static void resethandler()
           /* We failed to find " HTTP" in the request so assume it is invalid */
           DEBUG_PRINT("Invalid GET request. Closing.\n\r");
           close_conn(pcb, hs);
+          return 0;
         }          
+
+        hs->keepalive = http_keepalive_ok(hs, Hdrs);
         
 #ifdef INCLUDE_HTTPD_SSI
         /*
@@ -1160,6 +1238,14 @@ static void resethandler()
         hs->tag_check = FALSE;
 #endif
 
+#if TLS_CONFIG_TASK_PROFILE
+        /* The task profile page is generated, it does not live in the file system */
+        if((strncmp(Url, "/taskprof.html", 14) == 0) && ((Url[14] == 0) || (Url[14] == '?'))) {
+          send_taskprof_html(hs, pcb, (Url[14] == '?') ? &Url[15] : NULL);
+          return 0;
+        }
+#endif
+
         /*
          * Have we been asked for the default root file?
          */
@@ -1216,6 +1302,7 @@ static void resethandler()
                  strcpy(Url, g_pCGIs[i].pfnCGIHandler(i, count, hs->params, hs->param_vals,&NeedRestart));
 		   if(NeedRestart==1)
 		   {
+			hs->keepalive = 0;
 			send_jump_html(hs,pcb);
 			DEBUG_PRINT("Sending jump html\n\r"); 
       		   	resethandler();
@@ -1259,6 +1346,32 @@ static void resethandler()
         hs->parse_left = file->len;
         hs->tag_end = file->data;
 #endif
+        /* Encoding and validators of makefs images, the two copies of a
+           gzip file have their own ETag */
+        if((file->flags & FS_FILE_FLAG_GZIP) &&
+           !(Hdrs && http_header_has(Hdrs, "Accept-Encoding:", "gzip"))) {
+          fs_use_plain(file);
+        }
+        if(file->etag && Hdrs &&
+           http_header_has(Hdrs, "If-None-Match:", file->etag)) {
+          const char *etag = file->etag;
+
+          fs_close(file);
+          send_status_reply(hs, pcb, "304 Not Modified", etag);
+          return 0;
+        }
+
+        /* Only responses with a Content-Length leave the connection open */
+        if(!(file->flags & FS_FILE_FLAG_LENGTH) ||
+           (hs->file_flag & FILEFLAG_FILTER)) {
+          hs->keepalive = 0;
+        }
+#ifdef INCLUDE_HTTPD_SSI
+        if(hs->tag_check) {
+          hs->keepalive = 0;
+        }
+#endif
+
         hs->handle = file;
         hs->file = file->data;
 
@@ -1424,7 +1537,7 @@ void send_error_html(struct http_state *hs,struct tcp_pcb *pcb, int error)
 		"program flash failed",
 		"varify incorrect",
 	};
-	char *html = mem_malloc(128);
+	char *html = tls_mem_alloc(128);
 
 	if (html){
 		sprintf(html, "HTTP/1.1 200 OK\r\n"
@@ -1440,19 +1553,234 @@ void send_error_html(struct http_state *hs,struct tcp_pcb *pcb, int error)
 		tcp_write(pcb,html, strlen(html), TCP_WRITE_FLAG_COPY);
 		tcp_sent(pcb, http_sent);
 		tcp_output(pcb);	 
-		mem_free(html);
+		tls_mem_free(html);
 	}
 	 close_conn(pcb, hs);	   
 }
 
+/* Header-only reply, e.g. 304 for a matching If-None-Match */
+static void send_status_reply(struct http_state *hs,struct tcp_pcb *pcb, const char *status, const char *etag)
+{
+	char *reply = tls_mem_alloc(128);
+	int len;
+
+	if (reply){
+		len = sprintf(reply, "HTTP/1.1 %s\r\n", status);
+		if (etag)
+			len += sprintf(reply + len, "ETag: %s\r\n", etag);
+		else
+			len += sprintf(reply + len, "Content-Length: 0\r\n");
+		len += sprintf(reply + len, "\r\n");
+
+		tcp_write(pcb, reply, len, TCP_WRITE_FLAG_COPY);
+		tcp_sent(pcb, http_sent);
+		tcp_output(pcb);
+		tls_mem_free(reply);
+		http_response_done(pcb, hs);
+		return;
+	}
+	 close_conn(pcb, hs);
+}
+
+/* strncmp ignoring ASCII case */
+static int http_strnicmp(const char *a, const char *b, int n)
+{
+	int ca, cb;
+
+	for (; n > 0; n--, a++, b++){
+		ca = ((*a >= 'A') && (*a <= 'Z')) ? (*a + 'a' - 'A') : *a;
+		cb = ((*b >= 'A') && (*b <= 'Z')) ? (*b + 'a' - 'A') : *b;
+		if ((ca != cb) || (ca == 0))
+			return ca - cb;
+	}
+	return 0;
+}
+
+/* Does request header <name> (e.g. "Accept-Encoding:") contain token?
+   Both are compared without case. */
+static int http_header_has(const char *hdrs, const char *name, const char *token)
+{
+	const char *value = hdrs;
+	const char *end;
+	int namelen = strlen(name);
+	int toklen = strlen(token);
+
+	while (http_strnicmp(value, name, namelen) != 0){
+		value = strstr(value, "\r\n");
+		if (value == NULL)
+			return 0;
+		value += 2;
+	}
+	value += namelen;
+	end = strstr(value, "\r\n");
+	if (end == NULL)
+		end = value + strlen(value);
+
+	for (; value + toklen <= end; value++){
+		if (http_strnicmp(value, token, toklen) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* May the connection stay open after this request? */
+static int http_keepalive_ok(struct http_state *hs, const char *hdrs)
+{
+	/* HTTP/1.0 clients get close-delimited responses */
+	if ((hdrs == NULL) || (strncmp(hdrs, "HTTP/1.1", 8) != 0))
+		return 0;
+	if (http_header_has(hdrs, "Connection:", "close"))
+		return 0;
+	if (http_conns > HTTPD_KEEPALIVE_MAX_CONNS)
+		return 0;
+	return ((hs->requests + 1) < HTTPD_KEEPALIVE_MAX_REQUESTS);
+}
+
+/* The response is queued: close, or wait for the next request */
+static void http_response_done(struct tcp_pcb *pcb, struct http_state *hs)
+{
+	if (!hs->keepalive){
+		close_conn(pcb, hs);
+		return;
+	}
+
+	if (hs->handle){
+		fs_close(hs->handle);
+		hs->handle = NULL;
+	}
+	hs->file = NULL;
+	hs->left = 0;
+	hs->file_flag = 0;
+	hs->retries = 0;
+	hs->idle = 0;
+	hs->keepalive = 0;
+	hs->requests++;
+
+	/* serve a request that was pipelined behind this one */
+	if (!hs->parsing)
+		http_parse_requests(hs, pcb);
+}
+
+/* Serve the complete requests in hs->http_recive_request in order. A
+ * pipelined request waits until the response before it is queued. */
+static void http_parse_requests(struct http_state *hs, struct tcp_pcb *pcb)
+{
+	struct http_recive *req = &hs->http_recive_request;
+	char *HtmlEnd;
+	char next;
+	int HtmlLen;
+
+	hs->parsing = 1;
+	while (req->Valid && (hs->handle == NULL)){
+		if (hs->recv_state != 2){
+			HtmlEnd = strstr(req->Httpd_recive_buf, "\r\n\r\n");
+			if (HtmlEnd == NULL)
+				break;
+			HtmlEnd += 4;
+			HtmlLen = (int)(HtmlEnd - req->Httpd_recive_buf);
+
+			/* hide the requests behind this one from its header lookups */
+			next = *HtmlEnd;
+			*HtmlEnd = 0;
+			extract_html_recive(req->Httpd_recive_buf, hs, pcb);
+			if (hs->closed)
+				break;
+			*HtmlEnd = next;
+
+			if (hs->recv_state == 1){
+				hs->recv_content_len -= HtmlLen;
+			}
+		}
+		else{
+			HtmlLen = req->charlen;
+			hs->RecvPbuf = pbuf_alloc(PBUF_TRANSPORT, HtmlLen, PBUF_RAM);
+			if (hs->RecvPbuf == NULL){
+				DEBUG_PRINT("http_recv recvpBuf\r\n");
+				break;
+			}
+			pbuf_take(hs->RecvPbuf, req->Httpd_recive_buf, HtmlLen);
+			hs->RecvOffset = 0;
+			hs->recv_content_len -= HtmlLen;
+		}
+
+		req->charlen -= HtmlLen;
+		if (req->charlen <= 0){
+			tls_mem_free(req->Httpd_recive_buf);
+			req->Httpd_recive_buf = NULL;
+			req->charlen = 0;
+			req->Valid = 0;
+		}
+		else{
+			/* keep the terminating NUL */
+			memmove(req->Httpd_recive_buf, req->Httpd_recive_buf + HtmlLen, req->charlen + 1);
+		}
+	}
+	hs->parsing = 0;
+
+	if (hs->closed){
+		if (req->Httpd_recive_buf)
+			tls_mem_free(req->Httpd_recive_buf);
+		tls_mem_free(hs);
+	}
+}
+
+#if TLS_CONFIG_TASK_PROFILE
+#define TASKPROF_HTML_SIZE	1280
+#define TASKPROF_HDR_SIZE	96
+/* GET /taskprof.html[?run=0|1] */
+void send_taskprof_html(struct http_state *hs,struct tcp_pcb *pcb, char *params)
+{
+	char *html;
+	char *body;
+	int len;
+	int hdrlen;
+
+	if (params && strstr(params, "run=1"))
+		tls_os_task_prof_start();
+	else if (params && strstr(params, "run=0"))
+		tls_os_task_prof_stop();
+
+	html = tls_mem_alloc(TASKPROF_HTML_SIZE);
+	if (html){
+		body = html + TASKPROF_HDR_SIZE;
+		len = sprintf(body, "<html>\r\n"
+			"<head>\r\n"
+			"<title>task profile</title>\r\n"
+			"</head>\r\n"
+			"<body>\r\n"
+			"<a href=\"/taskprof.html?run=1\">start</a> "
+			"<a href=\"/taskprof.html?run=0\">stop</a> "
+			"<a href=\"/taskprof.html\">refresh</a>\r\n"
+			"<pre>running,total_ms,isr_permille\r\n"
+			"name,prio,state,cpu_permille,switches,stk_free,stk_size\r\n");
+		len += tls_os_task_prof_report(body + len, TASKPROF_HTML_SIZE - TASKPROF_HDR_SIZE - 32 - len);
+		len += sprintf(body + len, "</pre>\r\n"
+			"</body>\r\n"
+			"</html>\r\n");
+		hdrlen = sprintf(html, "HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/html\r\n"
+			"Cache-Control: no-cache\r\n"
+			"Content-Length: %d\r\n"
+			"\r\n", len);
+
+		tcp_write(pcb, html, hdrlen, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+		tcp_write(pcb, body, len, TCP_WRITE_FLAG_COPY);
+		tcp_sent(pcb, http_sent);
+		tcp_output(pcb);	 
+		tls_mem_free(html);
+		http_response_done(pcb, hs);
+		return;
+	}
+	 close_conn(pcb, hs);	   
+}
+#endif
+
 /*-----------------------------------------------------------------------------------*/
 static err_t
 http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 {
     struct http_state *hs;
     char * temprecive=NULL;
-    char * HtmlBegin=NULL, *HtmlEnd=NULL;
-    int HtmlLen;		
 
 //  DEBUG_PRINT("http_recv 0x%08x\n", pcb);
 
@@ -1461,6 +1789,14 @@ http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 
   if (err == ERR_OK && p != NULL) {
 
+    /* Pipelined requests wait in the request buffer while a response is
+       sent. Leave the data with TCP once that holds enough, lwIP delivers
+       it again later. */
+    if ((hs->handle != NULL) && hs->keepalive &&
+        ((hs->http_recive_request.charlen + p->tot_len) > HTTPD_PIPELINE_BUF_LEN)) {
+      return ERR_MEM;
+    }
+
     /* Inform TCP that we have taken the data. */
     tcp_recved(pcb, p->tot_len);
 
@@ -1481,13 +1817,13 @@ http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 	   return ERR_OK;
     }
 
-    if (hs->handle == NULL) {
+    if ((hs->handle == NULL) || hs->keepalive) {
 //      data = p->payload;
 		if (hs->http_recive_request.Valid){
-			temprecive = mem_malloc(hs->http_recive_request.charlen);
+			temprecive = tls_mem_alloc(hs->http_recive_request.charlen);
 			if (NULL == temprecive){
 				if (hs->http_recive_request.Httpd_recive_buf){
-					mem_free(hs->http_recive_request.Httpd_recive_buf);
+					tls_mem_free(hs->http_recive_request.Httpd_recive_buf);
 					hs->http_recive_request.Httpd_recive_buf = NULL;
 				}
 				hs->http_recive_request.charlen=0;
@@ -1504,11 +1840,11 @@ http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 		}
 
 		if (hs->http_recive_request.Httpd_recive_buf){
-			mem_free(hs->http_recive_request.Httpd_recive_buf);
+			tls_mem_free(hs->http_recive_request.Httpd_recive_buf);
 			hs->http_recive_request.Httpd_recive_buf = NULL;
 		}
 
-		hs->http_recive_request.Httpd_recive_buf=mem_malloc( p->tot_len+hs->http_recive_request.charlen);
+		hs->http_recive_request.Httpd_recive_buf=tls_mem_alloc( p->tot_len+hs->http_recive_request.charlen + 1);
 		if(hs->http_recive_request.Httpd_recive_buf==NULL)
 		{
 			DEBUG_PRINT("Httpd Recive Buf Error pbuf:%x\n\r", p);
@@ -1520,13 +1856,13 @@ http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 	  		return ERR_OK;		
 		}		
 
-		memset(hs->http_recive_request.Httpd_recive_buf,0, p->tot_len+hs->http_recive_request.charlen);
+		memset(hs->http_recive_request.Httpd_recive_buf,0, p->tot_len+hs->http_recive_request.charlen + 1);
 		
 		if(hs->http_recive_request.Valid==1)
 		{
 			if (temprecive){
 				memcpy(hs->http_recive_request.Httpd_recive_buf,temprecive,hs->http_recive_request.charlen);
-				mem_free(temprecive);
+				tls_mem_free(temprecive);
 				temprecive = NULL;
 			}
 		}
@@ -1537,48 +1873,9 @@ http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 		pbuf_free(p);
 		hs->http_recive_request.Valid=1;	
 		DEBUG_PRINT(hs->http_recive_request.Httpd_recive_buf);
-		HtmlLen = 0;
-		HtmlBegin = hs->http_recive_request.Httpd_recive_buf;
-		do{
-			HtmlBegin += HtmlLen;
-			if (hs->recv_state != 2){
-			    HtmlEnd = strstr(HtmlBegin, "\r\n\r\n"); 
-			    if(HtmlEnd){
-			             HtmlEnd += 4;
-				HtmlLen = (int)(HtmlEnd - HtmlBegin)	;	 
-					extract_html_recive(HtmlBegin,hs,pcb);
-				hs->http_recive_request.charlen -= HtmlLen;
-				if (hs->recv_state == 1){
-					hs->recv_content_len -= HtmlLen;	
-				}
-				
-				if (hs->http_recive_request.charlen <= 0){
-			  		mem_free(hs->http_recive_request.Httpd_recive_buf);
-			  		hs->http_recive_request.charlen=0;
-			  		hs->http_recive_request.Httpd_recive_buf=NULL;
-			  		hs->http_recive_request.Valid=0;
-				}	
-		     } 
-	     }
-	     else{
-		HtmlLen = hs->http_recive_request.charlen;
-		hs->RecvPbuf = pbuf_alloc(PBUF_TRANSPORT, HtmlLen, PBUF_RAM);
-		if (hs->RecvPbuf == NULL){
-			DEBUG_PRINT("http_recv recvpBuf\r\n");
-
-			return 0;
+		if (hs->handle == NULL){
+			http_parse_requests(hs, pcb);
 		}
-		pbuf_take(hs->RecvPbuf, HtmlBegin, HtmlLen);	
-		hs->RecvOffset = 0;
-		
-  		mem_free(hs->http_recive_request.Httpd_recive_buf);
-  		hs->http_recive_request.charlen=0;
-  		hs->http_recive_request.Httpd_recive_buf=NULL;
-  		hs->http_recive_request.Valid=0;
-
-		hs->recv_content_len -= HtmlLen;
-	     }	 
-	}while((HtmlEnd) && (hs->http_recive_request.charlen > 0));
 
     } 
 	else {
@@ -1608,7 +1905,7 @@ http_accept(void *arg, struct tcp_pcb *pcb, err_t err)
   /* Allocate memory for the structure that holds the state of the
      connection. */
 
-  hs = (struct http_state *)mem_malloc(sizeof(struct http_state));
+  hs = (struct http_state *)tls_mem_alloc(sizeof(struct http_state));
 
   if (hs == NULL) {
      DEBUG_PRINT("http_accept: Out of memory\n\r"); 
@@ -1621,6 +1918,7 @@ http_accept(void *arg, struct tcp_pcb *pcb, err_t err)
 
   /* Initialize the structure. */
   memset(hs,0,sizeof(struct http_state));
+  http_conns++;
 
   /* Tell TCP that this is the structure we wish to be passed for our
      callbacks. */
@@ -36,6 +36,16 @@
 #define __HTTPD_H__
 
 #define HTTP_MAX_REQUEST_LEN 256
+
+/* HTTP/1.1 persistent connections. Keep-alive is only offered while no
+ * more than HTTPD_KEEPALIVE_MAX_CONNS connections are open (0 disables it),
+ * for up to HTTPD_KEEPALIVE_MAX_REQUESTS requests per connection. Idle
+ * connections are closed after HTTPD_KEEPALIVE_IDLE_POLLS http_poll calls
+ * (2s each). Pipelined requests are buffered up to HTTPD_PIPELINE_BUF_LEN. */
+#define HTTPD_KEEPALIVE_MAX_CONNS     3
+#define HTTPD_KEEPALIVE_MAX_REQUESTS  64
+#define HTTPD_KEEPALIVE_IDLE_POLLS    5
+#define HTTPD_PIPELINE_BUF_LEN        1024
 #define PLAIN_FLAG_LEN 9	//(strlen("plain\r\n\r\n"))
 #define FWEND_FLAG_LEN 7	//(strlen("\r\n-----"))
 
@@ -35,6 +35,9 @@
 #include "wm_efuse.h"
 #include "wm_dhcp_server.h"
 #include "wm_wifi_oneshot.h"
+#if TLS_CONFIG_FAST_REJOIN
+#include "tls_sys.h"
+#endif
 
 extern const char FirmWareVer[];
 extern const char HwVer[];
@@ -308,7 +311,11 @@ int tls_cmd_join_net(void)
 			ret = tls_wifi_connect_by_bssid(bssid.bssid, key->key, key->key_len);
 		}
 	}else{
+#if TLS_CONFIG_FAST_REJOIN
+		ret = tls_sys_rejoin(ssid.ssid, ssid.ssid_len, key->key, key->key_len);
+#else
 		ret = tls_wifi_connect(ssid.ssid, ssid.ssid_len, key->key, key->key_len);
+#endif
 	}
 
 	tls_mem_free(key);
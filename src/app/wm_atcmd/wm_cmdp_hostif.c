@@ -4073,6 +4073,50 @@ int lprsr_proc(u8 set_opt, u8 update_flash, union HOSTIF_CMD_PARAMS_UNION *cmd,
     return 0;
 }
 
+#if TLS_CONFIG_TASK_PROFILE
+/******************************************************************
+* Description:	Start/stop the task profiler or query its report
+
+* Format:		AT+TPROF=<enable><CR>
+			+OK<CR><LF><CR><LF>
+			AT+TPROF[=?]<CR>
+			+OK=<running>,<total_ms>,<isr_permille>
+			[<CR><LF><name>,<prio>,<state>,<cpu_permille>,<switches>,<stk_free>,<stk_size>]...<CR><LF><CR><LF>
+
+* Argument:	enable: 1 clear the counters and start, 0 stop
+			
+******************************************************************/
+int tprof_proc(u8 set_opt, u8 update_flash, union HOSTIF_CMD_PARAMS_UNION *cmd, union HOSTIF_CMDRSP_PARAMS_UNION * cmdrsp){
+    if (set_opt) {
+        if (cmd->wprt.type > 1)
+            return -CMD_ERR_INV_PARAMS;
+        if (cmd->wprt.type) {
+            if (tls_os_task_prof_start())
+                return -CMD_ERR_OPS;
+        } else {
+            tls_os_task_prof_stop();
+        }
+    }
+    return 0;
+}
+#endif
+
+#if TLS_CONFIG_LWIP_POOLS
+/******************************************************************
+* Description:	Query the lwIP heap and memp pool usage
+
+* Format:		AT+LWMEM[=?]<CR>
+			+OK=<static_bytes>,<heap_size>,<heap_used>,<heap_max>,<heap_err>
+			[<CR><LF><pool>,<size>,<num>,<used>,<max>,<err>]...<CR><LF><CR><LF>
+
+* Argument:	None
+			
+******************************************************************/
+int lwmem_proc(u8 set_opt, u8 update_flash, union HOSTIF_CMD_PARAMS_UNION *cmd, union HOSTIF_CMDRSP_PARAMS_UNION * cmdrsp){
+    return 0;
+}
+#endif
+
 extern int tls_tx_wave_start(u32 freq, u32 dividend);
 int tls_tx_sin(u8 set_opt, u8 update_flah, union HOSTIF_CMD_PARAMS_UNION *cmd, union HOSTIF_CMDRSP_PARAMS_UNION * cmdrsp)
 {
@@ -4530,6 +4574,12 @@ static struct tls_cmd_t  at_ri_cmd_tbl[] = {
     { "&LPSTPR", HOSTIF_CMD_NOP, 0x1, 0, 0, lpstpr_proc},
     { "&LPRAGC", HOSTIF_CMD_NOP, 0x1, 0, 0, lpragc_proc},
     { "&LPRSR", HOSTIF_CMD_NOP, 0x9, 0, 0, lprsr_proc},
+#if TLS_CONFIG_TASK_PROFILE
+    { "TPROF", HOSTIF_CMD_NOP, 0xB, 1, 0, tprof_proc},
+#endif
+#if TLS_CONFIG_LWIP_POOLS
+    { "LWMEM", HOSTIF_CMD_NOP, 0x9, 0, 0, lwmem_proc},
+#endif
 #if TLS_CONFIG_AP
     { "SLIST", HOSTIF_CMD_STA_LIST, 0x19, 0, 0, slist_proc},
     { "APLKSTT", HOSTIF_CMD_AP_LINK_STATUS, 0x19, 0, 0,softap_lkstt_proc},
@@ -5658,6 +5708,20 @@ int at_parse_func(char *at_name, struct tls_atcmd_token_t *tok, union HOSTIF_CMD
         }
     }
 #endif
+#if TLS_CONFIG_TASK_PROFILE
+	else if(strcmp("TPROF", at_name) == 0){
+		int ret;
+		u32 param;
+		if(tok->arg_found > 1)
+			return -CMD_ERR_INV_PARAMS;
+		if(tok->arg_found == 1){
+			ret = string_to_uint(tok->arg[0], &param);
+			if(ret || (param > 1))
+				return -CMD_ERR_INV_PARAMS;
+			cmd->wprt.type = (u8)param;
+		}
+	}
+#endif
 #if TLS_CONFIG_WIFI_PING_TEST
 	else if(strcmp("PING", at_name) == 0){
 		int ret;
@@ -6274,6 +6338,25 @@ int at_format_func(char *at_name, u8 set_opt, u8 update_flash, union HOSTIF_CMDR
 	{
             *res_len = atcmd_ok_resp(res_resp);
 	}
+#if TLS_CONFIG_TASK_PROFILE
+	else if(strcmp("TPROF", at_name) == 0)
+	{
+        if (set_opt) {
+            *res_len = atcmd_ok_resp(res_resp);
+        } else {
+            /* keep room for the trailing CR LF CR LF added by the caller */
+            *res_len = sprintf(res_resp, "+OK=");
+            *res_len += tls_os_task_prof_report(res_resp + *res_len, CMD_RSP_BUF_SIZE - 5 - *res_len);
+        }
+	}
+#endif
+#if TLS_CONFIG_LWIP_POOLS
+	else if(strcmp("LWMEM", at_name) == 0)
+	{
+        *res_len = sprintf(res_resp, "+OK=");
+        *res_len += tls_netif_mem_report(res_resp + *res_len, CMD_RSP_BUF_SIZE - 5 - *res_len);
+	}
+#endif
     //else{
 //        return -CMD_ERR_UNSUPP;
 //    }
@@ -0,0 +1,648 @@
+/**************************************************************************
+ * File Name                   : tls_dns.c
+ * Author                      :
+ * Version                     :
+ * Date                        :
+ * Description                 : asynchronous DNS resolver with a TTL cache
+ *
+ * Copyright (c) 2014 Winner Microelectronics Co., Ltd.
+ * All rights reserved.
+ *
+ ***************************************************************************/
+#include "wm_config.h"
+
+#if TLS_CONFIG_DNS_RESOLVER
+
+#include <string.h>
+#include "wm_mem.h"
+#include "wm_osal.h"
+#include "lwip/sys.h"
+#include "lwip/udp.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "wm_dns.h"
+
+#define DNS_PORT                53
+#define DNS_HDR_LEN             12
+#define DNS_FLAG1_RESPONSE      0x80
+#define DNS_FLAG1_RD            0x01
+#define DNS_FLAG2_RCODE         0x0f
+#define DNS_RCODE_NOERROR       0
+#define DNS_RCODE_NXDOMAIN      3
+#define DNS_TYPE_A              1
+#define DNS_CLASS_IN            1
+
+#define DNS_RETRY_INTERVAL      250
+/* seconds, keeps expiry arithmetic far from the tick wrap */
+#define DNS_TTL_MAX             86400
+
+enum {
+    DNS_ENTRY_FREE = 0,
+    DNS_ENTRY_PENDING,
+    DNS_ENTRY_VALID,
+    DNS_ENTRY_NEGATIVE
+};
+
+struct tls_dns_entry {
+    char *name;
+    u32 addr[TLS_DNS_ADDR_MAX];
+    u32 expire;                 /* ticks */
+    u32 ttl;                    /* seconds, of the last answer */
+    u32 used;                   /* ticks of the last lookup */
+    u32 sent;                   /* ticks of the last transmission */
+    u16 id;
+    u8 state;
+    u8 count;
+    u8 querying;
+    u8 tries;
+};
+
+struct tls_dns_waiter {
+    tls_dns_found_fn found;
+    void *arg;
+    struct tls_dns_entry *entry;
+};
+
+static struct tls_dns_entry dns_cache[TLS_DNS_CACHE_NUM];
+static struct tls_dns_waiter dns_waiters[TLS_DNS_WAITER_NUM];
+static tls_dns_stats_t dns_stats;
+static struct udp_pcb *dns_pcb;
+static sys_mutex_t dns_mutex;
+static u8 dns_tmr_active;
+
+static void dns_retry_tmr(void *arg);
+
+static int dns_before(u32 now, u32 time)
+{
+    return (s32)(now - time) < 0;
+}
+
+static char dns_lower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? (c + ('a' - 'A')) : c;
+}
+
+static int dns_name_valid(const char *name)
+{
+    int len = 0;
+
+    if (*name == '\0')
+        return 0;
+    for (; *name; name++) {
+        if (*name == '.') {
+            if (len == 0)
+                return 0;
+            len = 0;
+        } else if (++len > 63) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static struct tls_dns_entry *dns_find(const char *name)
+{
+    const char *a, *b;
+    int i;
+
+    for (i = 0; i < TLS_DNS_CACHE_NUM; i++) {
+        if (dns_cache[i].state == DNS_ENTRY_FREE)
+            continue;
+        for (a = dns_cache[i].name, b = name; *a && (dns_lower(*a) == dns_lower(*b)); a++, b++)
+            ;
+        if (*a == *b)
+            return &dns_cache[i];
+    }
+    return NULL;
+}
+
+/* A free entry, else the least recently used one without a query in flight */
+static struct tls_dns_entry *dns_alloc(const char *name)
+{
+    struct tls_dns_entry *e = NULL;
+    char *copy;
+    int i;
+
+    for (i = 0; i < TLS_DNS_CACHE_NUM; i++) {
+        if (dns_cache[i].state == DNS_ENTRY_FREE) {
+            e = &dns_cache[i];
+            break;
+        }
+        if (dns_cache[i].querying)
+            continue;
+        if ((e == NULL) || dns_before(dns_cache[i].used, e->used))
+            e = &dns_cache[i];
+    }
+    if (e == NULL)
+        return NULL;
+
+    copy = tls_mem_alloc(strlen(name) + 1);
+    if (copy == NULL)
+        return NULL;
+    strcpy(copy, name);
+
+    if (e->name)
+        tls_mem_free(e->name);
+    memset(e, 0, sizeof(*e));
+    e->name = copy;
+    e->state = DNS_ENTRY_PENDING;
+    return e;
+}
+
+static void dns_free(struct tls_dns_entry *e)
+{
+    if (e->name)
+        tls_mem_free(e->name);
+    memset(e, 0, sizeof(*e));
+}
+
+static int dns_wait(struct tls_dns_entry *e, tls_dns_found_fn found, void *arg)
+{
+    int i;
+
+    if (found == NULL)
+        return TLS_DNS_INPROGRESS;
+    for (i = 0; i < TLS_DNS_WAITER_NUM; i++) {
+        if (dns_waiters[i].entry == NULL) {
+            dns_waiters[i].found = found;
+            dns_waiters[i].arg = arg;
+            dns_waiters[i].entry = e;
+            return TLS_DNS_INPROGRESS;
+        }
+    }
+    return TLS_DNS_ERR;
+}
+
+static void dns_unwait(struct tls_dns_entry *e, tls_dns_found_fn found, void *arg)
+{
+    int i;
+
+    for (i = 0; i < TLS_DNS_WAITER_NUM; i++) {
+        if ((dns_waiters[i].entry == e) && (dns_waiters[i].found == found) &&
+            (dns_waiters[i].arg == arg)) {
+            dns_waiters[i].entry = NULL;
+            return;
+        }
+    }
+}
+
+/* Move the waiters of an entry to out, they are called after the lock is released */
+static int dns_take_waiters(struct tls_dns_entry *e, struct tls_dns_waiter *out, int n)
+{
+    int i;
+
+    for (i = 0; i < TLS_DNS_WAITER_NUM; i++) {
+        if (dns_waiters[i].entry == e) {
+            out[n++] = dns_waiters[i];
+            dns_waiters[i].entry = NULL;
+        }
+    }
+    return n;
+}
+
+static void dns_call_waiters(struct tls_dns_waiter *w, int n, const u32 *addr, u8 count)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        w[i].found(count ? addr : NULL, count, w[i].arg);
+}
+
+/* Send the query to every configured server, returns the number of packets */
+static int dns_send(struct tls_dns_entry *e)
+{
+    const ip_addr_t *server;
+    struct pbuf *p;
+    u8 *query;
+    u8 *q;
+    u8 *label;
+    const char *c;
+    int len = strlen(e->name);
+    int sent = 0;
+    int i;
+
+    if (dns_pcb == NULL)
+        return 0;
+    query = tls_mem_alloc(DNS_HDR_LEN + len + 2 + 4);
+    if (query == NULL)
+        return 0;
+
+    q = query;
+    memset(q, 0, DNS_HDR_LEN);
+    q[0] = e->id >> 8;
+    q[1] = e->id & 0xff;
+    q[2] = DNS_FLAG1_RD;
+    q[5] = 1;
+    q += DNS_HDR_LEN;
+
+    /* www.wm.com to 3www2wm3com0 */
+    label = q++;
+    *label = 0;
+    for (c = e->name; *c; c++) {
+        if (*c == '.') {
+            label = q++;
+            *label = 0;
+        } else {
+            *q++ = *c;
+            (*label)++;
+        }
+    }
+    if (*label)
+        *q++ = 0;
+    *q++ = 0;
+    *q++ = DNS_TYPE_A;
+    *q++ = 0;
+    *q++ = DNS_CLASS_IN;
+    len = q - query;
+
+    /* udp_sendto leaves its headers in the pbuf, each server gets a copy */
+    for (i = 0; i < DNS_MAX_SERVERS; i++) {
+        server = dns_getserver(i);
+        if (ip_addr_isany(server))
+            continue;
+        p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+        if (p == NULL)
+            break;
+        pbuf_take(p, query, len);
+        if (udp_sendto(dns_pcb, p, server, DNS_PORT) == ERR_OK)
+            sent++;
+        pbuf_free(p);
+    }
+    tls_mem_free(query);
+
+    dns_stats.sent += sent;
+    return sent;
+}
+
+static void dns_tmr_start(void)
+{
+    if (!dns_tmr_active) {
+        dns_tmr_active = 1;
+        sys_timeout(DNS_RETRY_INTERVAL, dns_retry_tmr, NULL);
+    }
+}
+
+/* End a query without an answer, an entry being refreshed keeps its addresses */
+static int dns_fail(struct tls_dns_entry *e, struct tls_dns_waiter *out, int n)
+{
+    e->querying = 0;
+    n = dns_take_waiters(e, out, n);
+    if (e->state != DNS_ENTRY_VALID)
+        dns_free(e);
+    return n;
+}
+
+static void dns_start(void *arg)
+{
+    struct tls_dns_entry *e = arg;
+    struct tls_dns_waiter w[TLS_DNS_WAITER_NUM];
+    int n = 0;
+
+    sys_mutex_lock(&dns_mutex);
+    e->id = (u16)LWIP_RAND();
+    e->tries = 1;
+    e->sent = tls_os_get_time();
+    if (dns_send(e))
+        dns_tmr_start();
+    else
+        n = dns_fail(e, w, 0);
+    sys_mutex_unlock(&dns_mutex);
+
+    dns_call_waiters(w, n, NULL, 0);
+}
+
+static void dns_retry_tmr(void *arg)
+{
+    struct tls_dns_waiter w[TLS_DNS_WAITER_NUM];
+    struct tls_dns_entry *e;
+    u32 now = tls_os_get_time();
+    u8 active = 0;
+    int n = 0;
+    int i;
+
+    sys_mutex_lock(&dns_mutex);
+    for (i = 0; i < TLS_DNS_CACHE_NUM; i++) {
+        e = &dns_cache[i];
+        /* tries is 0 until dns_start ran */
+        if (!e->querying || (e->tries == 0))
+            continue;
+        if ((now - e->sent) < (((TLS_DNS_RTO << (e->tries - 1)) * HZ) / 1000)) {
+            active = 1;
+            continue;
+        }
+        if ((e->tries < TLS_DNS_TRIES) && dns_send(e)) {
+            e->tries++;
+            e->sent = now;
+            active = 1;
+            continue;
+        }
+        dns_stats.timeouts++;
+        n = dns_fail(e, w, n);
+    }
+    dns_tmr_active = active;
+    if (active)
+        sys_timeout(DNS_RETRY_INTERVAL, dns_retry_tmr, NULL);
+    sys_mutex_unlock(&dns_mutex);
+
+    dns_call_waiters(w, n, NULL, 0);
+}
+
+/* Length of the question name if it is the name of e, else 0 */
+static int dns_name_cmp(const u8 *q, int max, const char *name)
+{
+    int pos = 0;
+    u8 n;
+
+    while (pos < max) {
+        n = q[pos++];
+        if (n == 0)
+            return ((*name == '\0') || ((*name == '.') && (name[1] == '\0'))) ? pos : 0;
+        if ((n & 0xc0) || ((pos + n) > max))
+            return 0;
+        if ((pos > 1) && (*name++ != '.'))
+            return 0;
+        while (n--) {
+            if (dns_lower(q[pos++]) != dns_lower(*name++))
+                return 0;
+        }
+    }
+    return 0;
+}
+
+static void dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    struct tls_dns_waiter w[TLS_DNS_WAITER_NUM];
+    struct tls_dns_entry *e = NULL;
+    u32 found[TLS_DNS_ADDR_MAX];
+    u32 ttl = 0xffffffff;
+    u32 rr_ttl;
+    u8 *msg = NULL;
+    u8 *m;
+    u16 id;
+    u16 answers;
+    u8 rcode;
+    u8 count = 0;
+    int len = p->tot_len;
+    int pos;
+    int i;
+    int n = 0;
+
+    if ((port != DNS_PORT) || (len < DNS_HDR_LEN))
+        goto out;
+
+    /* Answers nearly always come in one pbuf */
+    if (p->len == p->tot_len) {
+        m = p->payload;
+    } else {
+        msg = tls_mem_alloc(len);
+        if (msg == NULL)
+            goto out;
+        pbuf_copy_partial(p, msg, len, 0);
+        m = msg;
+    }
+
+    if (!(m[2] & DNS_FLAG1_RESPONSE) || (m[4] != 0) || (m[5] != 1))
+        goto out;
+    id = (m[0] << 8) | m[1];
+    rcode = m[3] & DNS_FLAG2_RCODE;
+    answers = (m[6] << 8) | m[7];
+
+    sys_mutex_lock(&dns_mutex);
+    for (i = 0; i < TLS_DNS_CACHE_NUM; i++) {
+        if (dns_cache[i].querying && (dns_cache[i].id == id)) {
+            e = &dns_cache[i];
+            break;
+        }
+    }
+    pos = e ? dns_name_cmp(m + DNS_HDR_LEN, len - DNS_HDR_LEN, e->name) : 0;
+    sys_mutex_unlock(&dns_mutex);
+    /* Another server already answered, or a SERVFAIL the others may beat */
+    if ((pos == 0) || ((rcode != DNS_RCODE_NOERROR) && (rcode != DNS_RCODE_NXDOMAIN)))
+        goto out;
+    pos += DNS_HDR_LEN + 4;
+
+    while (answers-- && (rcode == DNS_RCODE_NOERROR)) {
+        /* Owner name, compressed or not */
+        while (pos < len) {
+            if (m[pos] == 0) {
+                pos += 1;
+                break;
+            }
+            if ((m[pos] & 0xc0) == 0xc0) {
+                pos += 2;
+                break;
+            }
+            pos += m[pos] + 1;
+        }
+        /* Type, class, ttl and data length */
+        if ((pos + 10) > len)
+            break;
+        rr_ttl = ((u32)m[pos + 4] << 24) | ((u32)m[pos + 5] << 16) | ((u32)m[pos + 6] << 8) | m[pos + 7];
+        if (rr_ttl < ttl)
+            ttl = rr_ttl;
+        if ((m[pos + 1] == DNS_TYPE_A) && (m[pos] == 0) && (m[pos + 3] == DNS_CLASS_IN) &&
+            (m[pos + 8] == 0) && (m[pos + 9] == 4) && ((pos + 14) <= len) && (count < TLS_DNS_ADDR_MAX))
+            MEMCPY(&found[count++], &m[pos + 10], 4);
+        pos += 10 + ((m[pos + 8] << 8) | m[pos + 9]);
+    }
+
+    sys_mutex_lock(&dns_mutex);
+    /* The entry may have been taken over while the lock was released */
+    if (e->querying && (e->id == id)) {
+        dns_stats.answers++;
+        e->querying = 0;
+        if (ttl > DNS_TTL_MAX)
+            ttl = DNS_TTL_MAX;
+        if (count) {
+            e->state = DNS_ENTRY_VALID;
+            e->count = count;
+            MEMCPY(e->addr, found, count * 4);
+            e->ttl = ttl;
+            e->expire = tls_os_get_time() + ttl * HZ;
+        } else {
+            dns_stats.nxdomain++;
+            e->state = DNS_ENTRY_NEGATIVE;
+            e->count = 0;
+            e->ttl = TLS_DNS_NEG_TTL;
+            e->expire = tls_os_get_time() + TLS_DNS_NEG_TTL * HZ;
+        }
+        n = dns_take_waiters(e, w, 0);
+    }
+    sys_mutex_unlock(&dns_mutex);
+
+    dns_call_waiters(w, n, found, count);
+
+out:
+    if (msg)
+        tls_mem_free(msg);
+    pbuf_free(p);
+}
+
+static int dns_lookup(const char *name, u32 *addr, tls_dns_found_fn found, void *arg, u8 query)
+{
+    struct tls_dns_waiter w[TLS_DNS_WAITER_NUM];
+    struct tls_dns_entry *e;
+    ip4_addr_t ip;
+    u32 now = tls_os_get_time();
+    u8 start = 0;
+    int ret;
+    int n;
+
+    if ((name == NULL) || (addr == NULL))
+        return TLS_DNS_ERR;
+    if (ip4addr_aton(name, &ip)) {
+        *addr = ip4_addr_get_u32(&ip);
+        return TLS_DNS_OK;
+    }
+    if ((strlen(name) >= DNS_MAX_NAME_LENGTH) || !dns_name_valid(name))
+        return TLS_DNS_ERR;
+
+    sys_mutex_lock(&dns_mutex);
+    e = dns_find(name);
+    if (e && (e->state == DNS_ENTRY_VALID) && dns_before(now, e->expire)) {
+        dns_stats.hits++;
+        e->used = now;
+        *addr = e->addr[0];
+        /* Refresh names in use before they expire, so lookups keep hitting */
+        if (!e->querying && (e->ttl >= TLS_DNS_PREFETCH_TTL) &&
+            (((e->expire - now) * 8) < (e->ttl * HZ))) {
+            dns_stats.prefetches++;
+            start = 1;
+        }
+        ret = TLS_DNS_OK;
+    } else if (e && (e->state == DNS_ENTRY_NEGATIVE) && dns_before(now, e->expire)) {
+        dns_stats.neg_hits++;
+        e->used = now;
+        ret = TLS_DNS_ERR;
+    } else if (!query) {
+        ret = TLS_DNS_INPROGRESS;
+    } else {
+        if (e == NULL)
+            e = dns_alloc(name);
+        if (e == NULL) {
+            ret = TLS_DNS_ERR;
+        } else {
+            e->used = now;
+            if (e->querying) {
+                dns_stats.joined++;
+            } else {
+                dns_stats.misses++;
+                e->state = DNS_ENTRY_PENDING;
+                start = 1;
+            }
+            ret = dns_wait(e, found, arg);
+            if ((ret != TLS_DNS_INPROGRESS) && start) {
+                dns_free(e);
+                start = 0;
+            }
+        }
+    }
+    if (start) {
+        e->querying = 1;
+        e->tries = 0;
+    }
+    sys_mutex_unlock(&dns_mutex);
+
+    /* Lookups may have joined the query meanwhile, nothing else would ever end it */
+    if (start && (tcpip_callback_with_block(dns_start, e, 0) != ERR_OK)) {
+        sys_mutex_lock(&dns_mutex);
+        if (ret == TLS_DNS_INPROGRESS) {
+            dns_unwait(e, found, arg);
+            ret = TLS_DNS_ERR;
+        }
+        n = dns_fail(e, w, 0);
+        sys_mutex_unlock(&dns_mutex);
+
+        dns_call_waiters(w, n, NULL, 0);
+    }
+
+    return ret;
+}
+
+int tls_dns_resolve(const char *name, u32 *addr, tls_dns_found_fn found, void *arg)
+{
+    return dns_lookup(name, addr, found, arg, 1);
+}
+
+struct dns_wait_ctx {
+    sys_sem_t sem;
+    u32 addr;
+    u8 count;
+};
+
+static void dns_wait_found(const u32 *addr, u8 count, void *arg)
+{
+    struct dns_wait_ctx *ctx = arg;
+
+    ctx->count = count;
+    if (count)
+        ctx->addr = addr[0];
+    sys_sem_signal(&ctx->sem);
+}
+
+int tls_dns_gethostbyname(const char *name, u32 *addr)
+{
+    struct dns_wait_ctx ctx;
+    int ret;
+
+    /* Cache hits cost no semaphore */
+    ret = dns_lookup(name, addr, NULL, NULL, 0);
+    if (ret != TLS_DNS_INPROGRESS)
+        return ret;
+
+    if (sys_sem_new(&ctx.sem, 0) != ERR_OK)
+        return TLS_DNS_ERR;
+    ctx.count = 0;
+    ret = dns_lookup(name, addr, dns_wait_found, &ctx, 1);
+    if (ret == TLS_DNS_INPROGRESS) {
+        /* The last retransmission timeout always ends the query */
+        sys_arch_sem_wait(&ctx.sem, 0);
+        if (ctx.count) {
+            *addr = ctx.addr;
+            ret = TLS_DNS_OK;
+        } else {
+            ret = TLS_DNS_ERR;
+        }
+    }
+    sys_sem_free(&ctx.sem);
+
+    return ret;
+}
+
+void tls_dns_flush(void)
+{
+    int i;
+
+    sys_mutex_lock(&dns_mutex);
+    for (i = 0; i < TLS_DNS_CACHE_NUM; i++) {
+        if ((dns_cache[i].state != DNS_ENTRY_FREE) && !dns_cache[i].querying)
+            dns_free(&dns_cache[i]);
+    }
+    sys_mutex_unlock(&dns_mutex);
+}
+
+void tls_dns_get_stats(tls_dns_stats_t *stats)
+{
+    sys_mutex_lock(&dns_mutex);
+    MEMCPY(stats, &dns_stats, sizeof(tls_dns_stats_t));
+    sys_mutex_unlock(&dns_mutex);
+}
+
+static void dns_init_pcb(void *arg)
+{
+    dns_pcb = udp_new();
+    if (dns_pcb == NULL)
+        return;
+    udp_bind(dns_pcb, IP_ADDR_ANY, 0);
+    udp_recv(dns_pcb, dns_recv, NULL);
+}
+
+void tls_dns_init(void)
+{
+    if (sys_mutex_new(&dns_mutex) != ERR_OK)
+        return;
+    tcpip_callback(dns_init_pcb, NULL);
+}
+
+#endif /* TLS_CONFIG_DNS_RESOLVER */
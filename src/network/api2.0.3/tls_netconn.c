@@ -969,6 +969,25 @@ static err_t net_skt_tcp_send(struct tls_net_msg *net_msg)
 }
 
 
+/**
+ * Wake the task waiting in netconn_msg(). With core locking the function
+ * runs in that task, so there is nobody to wake.
+ */
+static void net_msg_done(int socketno)
+{
+#if !LWIP_TCPIP_CORE_LOCKING
+#if CONN_SEM_NOT_FREE
+    sys_sem_signal(&conn_op_completed[socketno - 1]);
+#else
+    struct tls_netconn *conn = tls_net_get_socket(socketno);
+    if(conn && TRUE == conn->used)
+    {
+        sys_sem_signal(&conn->op_completed);
+    }
+#endif
+#endif
+}
+
 /**
  * Send data on a UDP pcb 
  */
@@ -989,7 +1008,7 @@ static void net_do_send(void *ctx)
 		if(p)
 			pbuf_free(p);
 #if CONN_SEM_NOT_FREE
-                sys_sem_signal(&conn_op_completed[socketno - 1]);
+		net_msg_done(socketno);
 #endif
 			
 		return;
@@ -1013,15 +1032,7 @@ static void net_do_send(void *ctx)
 #endif /* LWIP_CHECKSUM_ON_COPY */
 
     pbuf_free(p);
-#if CONN_SEM_NOT_FREE
-        sys_sem_signal(&conn_op_completed[socketno - 1]);
-#else
-	conn = tls_net_get_socket(socketno);
-	if(conn && TRUE == conn->used)
-	{
-		sys_sem_signal(&conn->op_completed);
-	}
-#endif
+    net_msg_done(socketno);
 }
 
 /**
@@ -1041,7 +1052,7 @@ static void net_do_write(void *ctx)
 	{
 		TLS_DBGPRT_ERR("\n conn=%x,used=%d\n",conn, conn->used);
 #if CONN_SEM_NOT_FREE
-        sys_sem_signal(&conn_op_completed[socketno - 1]);
+		net_msg_done(socketno);
 #endif		
 		return;
 	}
@@ -1094,15 +1105,7 @@ static void net_do_write(void *ctx)
         //TLS_DBGPRT_INFO("conn->proto=%d, err=%d\n", conn->proto, net_msg->err);
         //TLS_DBGPRT_INFO("free net_msg->dataptr=%p\n", net_msg->dataptr);
 
-#if CONN_SEM_NOT_FREE
-        sys_sem_signal(&conn_op_completed[socketno - 1]);
-#else
-	conn = tls_net_get_socket(socketno);
-	if(conn && TRUE == conn->used)
-	{
-		sys_sem_signal(&conn->op_completed);
-	}
-#endif
+        net_msg_done(socketno);
     }
 #if 0
     tls_mem_free(net_msg);
@@ -1435,6 +1438,29 @@ int tls_socket_close(u8 socket)
 
 }
 
+#if TCP_WND_AUTOTUNE
+/**
+ * Change the window priority of a TCP pcb, net_msg->len carries it
+ */
+static void net_do_wnd_prio(void *ctx)
+{
+    struct tls_net_msg *net_msg = (struct tls_net_msg *)ctx;
+    struct tls_netconn *conn;
+
+    conn = tls_net_get_socket(net_msg->skt_no);
+    if (conn && TRUE == conn->used && conn->pcb.tcp && conn->pcb.tcp->state != LISTEN)
+    {
+        tcp_set_wnd_prio(conn->pcb.tcp, (u8_t)net_msg->len);
+        net_msg->err = ERR_OK;
+    }
+    else
+    {
+        net_msg->err = ERR_CONN;
+    }
+    net_msg_done(net_msg->skt_no);
+}
+#endif
+
 static err_t netconn_msg(tcpip_callback_fn function, struct tls_net_msg *net_msg, u8_t block)
 {
 	err_t err = ERR_OK;
@@ -1445,7 +1471,13 @@ static err_t netconn_msg(tcpip_callback_fn function, struct tls_net_msg *net_msg
 		TLS_DBGPRT_ERR("netconn_msg conn=%x,used=%d\n",conn, conn->used);
 		return ERR_ARG;
 	}
-#if 1
+#if LWIP_TCPIP_CORE_LOCKING
+	/* run it in this task, no message to the tcpip thread and no wait */
+	LOCK_TCPIP_CORE();
+	function(net_msg);
+	UNLOCK_TCPIP_CORE();
+	return net_msg->err;
+#elif 1
 	err = tcpip_callback_with_block(function, net_msg, block);
 	if(err)
 	{
@@ -1674,6 +1706,30 @@ int tls_socket_send(u8 skt_num, void *pdata, u16 len)
     return err;
 }
 
+#if TCP_WND_AUTOTUNE
+int tls_socket_set_wnd_prio(u8 skt_num, u8 prio)
+{
+    struct tls_net_msg net_msg[1] = {0};
+    struct tls_netconn *conn;
+
+    if (skt_num < 1 || skt_num > TLS_MAX_NETCONN_NUM || prio > TCP_WND_PRIO_HIGH)
+    {
+        return ERR_VAL;
+    }
+    conn = tls_net_get_socket(skt_num);
+    if (conn == NULL || TRUE != conn->used || conn->proto != TLS_NETCONN_TCP || !conn->client)
+    {
+        return ERR_VAL;
+    }
+
+    dl_list_init(&net_msg->list);
+    net_msg->skt_no = skt_num;
+    net_msg->len = prio;
+    net_msg->err = ERR_VAL;
+    return netconn_msg(net_do_wnd_prio, net_msg, 0);
+}
+#endif
+
 int tls_net_init()
 {
     //int i;
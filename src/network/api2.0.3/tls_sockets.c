@@ -3,6 +3,11 @@
 #if LWIP_SOCKET /* don't build if not configured for use in lwipopts.h */
 
 #include "lwip/sockets.h"
+#if TLS_CONFIG_DNS_RESOLVER
+#include <string.h>
+#include "lwip/dns.h"
+#include "wm_dns.h"
+#endif
 
 extern struct hostent* lwip_gethostbyname(const char *name);
 int
@@ -116,7 +121,30 @@ fcntl(int s, int cmd, int val)
 	return lwip_fcntl(s, cmd, val);
 }
 struct hostent* gethostbyname(const char *name){
+#if TLS_CONFIG_DNS_RESOLVER
+	/* static like lwip_gethostbyname, answered from the tls_dns cache */
+	static struct hostent host;
+	static char host_name[DNS_MAX_NAME_LENGTH + 1];
+	static char *host_aliases;
+	static char *host_addr_list[2];
+	static u32 host_addr;
+
+	if (tls_dns_gethostbyname(name, &host_addr) != TLS_DNS_OK)
+		return NULL;
+	strncpy(host_name, name, DNS_MAX_NAME_LENGTH);
+	host_name[DNS_MAX_NAME_LENGTH] = '\0';
+	host_aliases = NULL;
+	host_addr_list[0] = (char *)&host_addr;
+	host_addr_list[1] = NULL;
+	host.h_name = host_name;
+	host.h_aliases = &host_aliases;
+	host.h_addrtype = AF_INET;
+	host.h_length = sizeof(host_addr);
+	host.h_addr_list = host_addr_list;
+	return &host;
+#else
 	return lwip_gethostbyname(name);
+#endif
 }
 
 #endif /* LWIP_SOCKET */
@@ -999,7 +999,7 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
         apiflags |= NETCONN_MORE;
       }
       written = 0;
-      err = netconn_write_partly(sock->conn, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len, write_flags, &written);
+      err = netconn_write_partly(sock->conn, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len, apiflags, &written);
       if (err == ERR_OK) {
         size += written;
         /* check that the entire IO vector was accepected, if not return a partial write */
@@ -2103,6 +2103,13 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
                   s, *(int *)optval));
       break;
 #endif /* LWIP_TCP_KEEPALIVE */
+#if TCP_WND_AUTOTUNE
+    case TCP_WNDPRIO:
+      *(int*)optval = (int)sock->conn->pcb.tcp->wnd_prio;
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_WNDPRIO) = %d\n",
+                  s, *(int *)optval));
+      break;
+#endif /* TCP_WND_AUTOTUNE */
     default:
       LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                   s, optname));
@@ -2499,6 +2506,17 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
                   s, sock->conn->pcb.tcp->keep_cnt));
       break;
 #endif /* LWIP_TCP_KEEPALIVE */
+#if TCP_WND_AUTOTUNE
+    case TCP_WNDPRIO:
+      if ((*(const int*)optval < TCP_WND_PRIO_LOW) || (*(const int*)optval > TCP_WND_PRIO_HIGH)) {
+        err = EINVAL;
+        break;
+      }
+      tcp_set_wnd_prio(sock->conn->pcb.tcp, (u8_t)(*(const int*)optval));
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_WNDPRIO) -> %d\n",
+                  s, *(const int *)optval));
+      break;
+#endif /* TCP_WND_AUTOTUNE */
     default:
       LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                   s, optname));
@@ -38,11 +38,9 @@ extern struct netif *tls_get_netif(void);
 extern struct tls_wif *tls_get_wif_data(void);
 
 //#define NAPT_ALLOC_DEBUG
-#ifdef  NAPT_ALLOC_DEBUG
-static u16 napt4ic_cnt;
-static u16 napt4tcp_cnt;
-static u16 napt4udp_cnt;
-#endif
+
+/* check the incrementally updated checksums against full sums */
+//#define NAPT_CHKSUM_DEBUG
 
 //#define NAPT_DEBUG
 #ifdef  NAPT_DEBUG
@@ -57,25 +55,19 @@ static u16 napt4udp_cnt;
 
 #define NAPT_CHKSUM_16BIT_LEN        sizeof(u16)
 
-#define NAPT_TABLE_FOREACH(pos, head)\
-         for (pos = head.next; NULL != pos; pos = pos->next)
+#define NAPT_HASH_SIZE               (1 << NAPT_HASH_BITS)
 
-/* napt tcp/udp */
-struct napt_addr_4tu{
-    struct napt_addr_4tu *next;
+#define NAPT_WHEEL_MASK              (NAPT_WHEEL_SLOTS - 1)
+
+/* napt tcp/udp/icmp, for icmp the ports are echo ids */
+struct napt_item{
+    struct napt_item *dest_next;/* translated port hash chain */
+    struct napt_item *src_next; /* source ip/port hash chain */
+    struct napt_item *tmr_next; /* timer wheel slot */
     u16 src_port;
     u16 new_port;
+    u16 expire;                 /* wheel tick of expiry */
     u8 src_ip;
-    u8 time_stamp;
-};
-
-/* napt icmp */
-struct napt_addr_4ic{
-    struct napt_addr_4ic *next;
-    u16 src_id;/* icmp id */
-    u16 new_id;
-    u8 src_ip;
-    u8 time_stamp;
 };
 
 struct napt_addr_gre{
@@ -84,25 +76,22 @@ struct napt_addr_gre{
     bool is_used;
 };
 
-struct napt_table_head_4tu{
-    struct napt_addr_4tu *next;
-#ifdef NAPT_TABLE_LIMIT
+struct napt_table{
+    struct napt_item *dest_hash[NAPT_HASH_SIZE];
+    struct napt_item *src_hash[NAPT_HASH_SIZE];
+    struct napt_item *wheel[NAPT_WHEEL_SLOTS];
+    u16 now;                    /* last wheel tick checked */
     u16 cnt;
+#ifdef NAPT_ALLOC_DEBUG
+    const char *name;
 #endif
 };
 
-struct napt_table_head_4ic{
-    struct napt_addr_4ic *next;
-#ifdef NAPT_TABLE_LIMIT
-    u16 cnt;
-#endif
-};
+static struct napt_table napt_table_4tcp;
+static struct napt_table napt_table_4udp;
+static struct napt_table napt_table_4ic;
 
 /* napt lock */
-static struct napt_table_head_4tu napt_table_4tcp;
-static struct napt_table_head_4tu napt_table_4udp;
-static struct napt_table_head_4ic napt_table_4ic;
-
 #define NAPT_TABLE_MUTEX_LOCK
 #ifdef  NAPT_TABLE_MUTEX_LOCK
 static tls_os_sem_t *napt_table_lock_4tcp;
@@ -113,6 +102,9 @@ static bool napt_check_udp = FALSE;
 static bool napt_check_ic  = FALSE;
 #endif
 
+/* timer wheel, advanced every NAPT_TMR_INTERVAL */
+static u16 napt_tick;
+
 /* tcp&udp */
 static u16 napt_curr_port;
 
@@ -254,6 +246,76 @@ static inline bool alg_napt_table_is_full(void)
 }
 #endif
 
+/*****************************************************************************
+ Prototype    : alg_napt_hash_dest
+ Description  : hash of a translated port
+ Input        : u16 port    translated port or icmp id
+ Output       : None
+ Return Value : u32         bucket index
+*****************************************************************************/
+static inline u32 alg_napt_hash_dest(u16 port)
+{
+    return (port ^ (port >> NAPT_HASH_BITS) ^ (port >> 12)) & (NAPT_HASH_SIZE - 1);
+}
+
+/*****************************************************************************
+ Prototype    : alg_napt_hash_src
+ Description  : hash of a source ip and port
+ Input        : u16 port    source port or icmp id
+                u8  ip      source ip
+ Output       : None
+ Return Value : u32         bucket index
+*****************************************************************************/
+static inline u32 alg_napt_hash_src(u16 port, u8 ip)
+{
+    return (u32)((((u32)ip << 16) | port) * 2654435761U) >> (32 - NAPT_HASH_BITS);
+}
+
+/*****************************************************************************
+ Prototype    : alg_napt_table_get_by_dest
+ Description  : find item by translated port
+ Input        : struct napt_table *table
+                u16 port    dest port or icmp id
+ Output       : None
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
+*****************************************************************************/
+static inline struct napt_item *alg_napt_table_get_by_dest(struct napt_table *table, u16 port)
+{
+    struct napt_item *napt;
+
+    for (napt = table->dest_hash[alg_napt_hash_dest(port)]; NULL != napt; napt = napt->dest_next)
+    {
+        if (port == napt->new_port)
+            break;
+    }
+
+    return napt;
+}
+
+/*****************************************************************************
+ Prototype    : alg_napt_table_get_by_src
+ Description  : find item by port and ip
+ Input        : struct napt_table *table
+                u16 port    source port or icmp id
+                u8  ip      source ip
+ Output       : None
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
+*****************************************************************************/
+static inline struct napt_item *alg_napt_table_get_by_src(struct napt_table *table, u16 port, u8 ip)
+{
+    struct napt_item *napt;
+
+    for (napt = table->src_hash[alg_napt_hash_src(port, ip)]; NULL != napt; napt = napt->src_next)
+    {
+        if ((port == napt->src_port) && (ip == napt->src_ip))
+            break;
+    }
+
+    return napt;
+}
+
 /*****************************************************************************
  Prototype    : alg_napt_port_alloc
  Description  : alloc napt port
@@ -275,8 +337,6 @@ static inline u16 alg_napt_port_alloc(void)
     u16 cnt = 0;
     struct udp_pcb *udp_pcb;
     struct tcp_pcb *tcp_pcb;
-    struct napt_addr_4tu *napt_tcp;
-    struct napt_addr_4tu *napt_udp;
 
 again:
     if (napt_curr_port++ == NAPT_LOCAL_PORT_RANGE_END)
@@ -313,100 +373,20 @@ again:
         }
     }
 
-    /* tcp napt */
-    NAPT_TABLE_FOREACH(napt_tcp, napt_table_4tcp)
-    {
-        if (napt_tcp->new_port == napt_curr_port)
-        {
-            if (++cnt > (NAPT_LOCAL_PORT_RANGE_END - NAPT_LOCAL_PORT_RANGE_START))
-            {
-                return 0;
-            }
-            goto again;
-        }
-    }
-
-    /* udp napt */
-    NAPT_TABLE_FOREACH(napt_udp, napt_table_4udp)
+    /* tcp and udp napt, the tables keep ports in network order */
+    if ((NULL != alg_napt_table_get_by_dest(&napt_table_4tcp, htons(napt_curr_port))) ||
+        (NULL != alg_napt_table_get_by_dest(&napt_table_4udp, htons(napt_curr_port))))
     {
-        if (napt_udp->new_port == napt_curr_port)
+        if (++cnt > (NAPT_LOCAL_PORT_RANGE_END - NAPT_LOCAL_PORT_RANGE_START))
         {
-            if (++cnt > (NAPT_LOCAL_PORT_RANGE_END - NAPT_LOCAL_PORT_RANGE_START))
-            {
-                return 0;
-            }
-            goto again;
+            return 0;
         }
+        goto again;
     }
 
     return napt_curr_port;
 }
 
-/*****************************************************************************
- Prototype    : alg_napt_get_by_src_id
- Description  : find item by ip and id
- Input        : u16 id          icmp echo id
-                u8  ip          source ip
- Output       : None
- Return Value : struct napt_addr_4ic *      NULL   fail
-                                           !NULL   success
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
-*****************************************************************************/
-static inline struct napt_addr_4ic *alg_napt_get_by_src_id(u16 id, u8 ip)
-{
-    struct napt_addr_4ic *ret = NULL;
-    struct napt_addr_4ic *napt;
-
-    NAPT_TABLE_FOREACH(napt, napt_table_4ic)
-    {
-        if ((id == napt->src_id) && (ip == napt->src_ip))
-        {
-	       ret = napt;
-	       break;
-        }
-    }
-
-    return ret;
-}
-
-/*****************************************************************************
- Prototype    : alg_napt_get_by_dst_id
- Description  : find item by dest id
- Input        : u16 id          icmp echo id
- Output       : None
- Return Value : struct napt_addr_4ic *      NULL   fail
-                                           !NULL   success
- ------------------------------------------------------------------------------
-
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
-*****************************************************************************/
-static inline struct napt_addr_4ic *alg_napt_get_by_dst_id(u16 id)
-{
-    struct napt_addr_4ic *ret = NULL;
-    struct napt_addr_4ic *napt;
-
-    NAPT_TABLE_FOREACH(napt, napt_table_4ic)
-    {
-        if (id == napt->new_id)
-        {
-	       ret = napt;
-	       break;
-        }
-    }
-
-    return ret;
-}
-
 /*****************************************************************************
  Prototype    : alg_napt_icmp_id_alloc
  Description  : alloc imcp id
@@ -425,7 +405,6 @@ static inline struct napt_addr_4ic *alg_napt_get_by_dst_id(u16 id)
 static u16 alg_napt_icmp_id_alloc(void)
 {
     u16 cnt = 0;
-    struct napt_addr_4ic *napt;
 
 again:
     if (napt_curr_id++ == NAPT_ICMP_ID_RANGE_END)
@@ -433,42 +412,51 @@ again:
         napt_curr_id = NAPT_ICMP_ID_RANGE_START;
     }
 
-    NAPT_TABLE_FOREACH(napt, napt_table_4ic)
+    if (NULL != alg_napt_table_get_by_dest(&napt_table_4ic, napt_curr_id))
     {
-        if (napt_curr_id == napt->new_id)
+        if (++cnt > (NAPT_ICMP_ID_RANGE_END - NAPT_ICMP_ID_RANGE_START))
         {
-            if (++cnt > (NAPT_ICMP_ID_RANGE_END - NAPT_ICMP_ID_RANGE_START))
-            {
-                return 0;
-            }
-
-	       goto again;
+            return 0;
         }
+
+        goto again;
     }
 
     return napt_curr_id;
 }
 
 /*****************************************************************************
- Prototype    : alg_napt_table_insert_4ic
+ Prototype    : alg_napt_table_update
+ Description  : fresh napt item, it expires NAPT_TABLE_TIMEOUT from now
+ Input        : struct napt_item *napt
+ Output       : None
+ Return Value : void
+ Note         : the item stays in its wheel slot, it is moved when the slot
+                comes due
+*****************************************************************************/
+static inline void alg_napt_table_update(struct napt_item *napt)
+{
+    napt->expire = napt_tick + NAPT_WHEEL_SLOTS;
+
+    return;
+}
+
+/*****************************************************************************
+ Prototype    : alg_napt_table_insert
  Description  : create napt item
- Input        : u16 id          source id
+ Input        : struct napt_table *table
+                u16 src_port    source port or icmp id
                 u8  ip          source ip
+                u16 new_port    translated port or icmp id
  Output       : None
- Return Value : struct napt_addr_4ic *      NULL   fail
-                                           !NULL   success
- Note         : icmp item no limit
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
 *****************************************************************************/
-static inline struct napt_addr_4ic *alg_napt_table_insert_4ic(u16 id, u8 ip)
+static struct napt_item *alg_napt_table_insert(struct napt_table *table,
+                                               u16 src_port, u8 ip, u16 new_port)
 {
-    struct napt_addr_4ic *napt;
+    u32 hash;
+    struct napt_item *napt;
 
 #ifdef NAPT_TABLE_LIMIT
     if (true == alg_napt_table_is_full())
@@ -477,218 +465,129 @@ static inline struct napt_addr_4ic *alg_napt_table_insert_4ic(u16 id, u8 ip)
     }
 #endif
 
-    napt = alg_napt_mem_alloc(sizeof(struct napt_addr_4ic));
+    napt = alg_napt_mem_alloc(sizeof(struct napt_item));
     if (NULL == napt)
     {
         return NULL;
     }
 
-    memset(napt, 0, sizeof(struct napt_addr_4ic));
-    napt->src_id = id;
+    napt->src_port = src_port;
+    napt->new_port = new_port;
+    napt->src_ip = ip;
+    alg_napt_table_update(napt);
 
-    napt->new_id = alg_napt_icmp_id_alloc();
-    if (0 == napt->new_id)
-    {
-        alg_napt_mem_free(napt);
-        return NULL;
-    }
+    hash = alg_napt_hash_dest(new_port);
+    napt->dest_next = table->dest_hash[hash];
+    table->dest_hash[hash] = napt;
 
-    napt->src_ip = ip;
-    napt->time_stamp++;
+    hash = alg_napt_hash_src(src_port, ip);
+    napt->src_next = table->src_hash[hash];
+    table->src_hash[hash] = napt;
 
-#ifdef NAPT_TABLE_LIMIT
-    napt_table_4ic.cnt++;
-#endif
-    napt->next = napt_table_4ic.next;
-    napt_table_4ic.next = napt;
-    
+    hash = napt->expire & NAPT_WHEEL_MASK;
+    napt->tmr_next = table->wheel[hash];
+    table->wheel[hash] = napt;
+
+    table->cnt++;
 #ifdef NAPT_ALLOC_DEBUG
-    printf("@@ napt id alloc %hu\r\n", ++napt4ic_cnt);
+    printf("@@ napt %s alloc %hu\r\n", table->name, table->cnt);
 #endif
 
     return napt;
 }
 
 /*****************************************************************************
- Prototype    : alg_napt_table_update_4ic
- Description  : fresh napt item
- Input        : struct napt_addr_4ic *napt
+ Prototype    : alg_napt_table_remove
+ Description  : unlink napt item from the hash chains and free it
+ Input        : struct napt_table *table
+                struct napt_item *napt    item, already taken off the wheel
  Output       : None
  Return Value : void
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
 *****************************************************************************/
-static inline void alg_napt_table_update_4ic(struct napt_addr_4ic *napt)
+static void alg_napt_table_remove(struct napt_table *table, struct napt_item *napt)
 {
-    if (!++napt->time_stamp)
-        napt->time_stamp++;
-
-    return;
-}
-
-/*****************************************************************************
- Prototype    : alg_napt_get_tcp_port_by_dest
- Description  : find item by port
- Input        : u16 port    dest port
- Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
+    struct napt_item **pos;
 
-*****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_get_tcp_port_by_dest(u16 port)
-{
-    struct napt_addr_4tu *ret = NULL;
-    struct napt_addr_4tu *napt;
-
-    NAPT_TABLE_FOREACH(napt, napt_table_4tcp)
+    for (pos = &table->dest_hash[alg_napt_hash_dest(napt->new_port)];
+         NULL != *pos; pos = &(*pos)->dest_next)
     {
-        if (napt->new_port == port)
+        if (napt == *pos)
         {
-            ret = napt;
+            *pos = napt->dest_next;
             break;
         }
     }
 
-    return ret;
-}
-
-/*****************************************************************************
- Prototype    : alg_napt_get_tcp_port_by_src
- Description  : find item by port and ip
- Input        : u16 port    source port
-                u8  ip      source ip
- Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
-*****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_get_tcp_port_by_src(u16 port, u8 ip)
-{
-    struct napt_addr_4tu *ret = NULL;
-    struct napt_addr_4tu *napt;
-
-    NAPT_TABLE_FOREACH(napt, napt_table_4tcp)
+    for (pos = &table->src_hash[alg_napt_hash_src(napt->src_port, napt->src_ip)];
+         NULL != *pos; pos = &(*pos)->src_next)
     {
-        if (port == napt->src_port)
+        if (napt == *pos)
         {
-            if (ip == napt->src_ip)
-            {
-                ret = napt;
-                break;
-            }
+            *pos = napt->src_next;
+            break;
         }
     }
 
-    return ret;
+    table->cnt--;
+    alg_napt_mem_free(napt);
+#ifdef NAPT_ALLOC_DEBUG
+    printf("@@ napt %s free %hu\r\n", table->name, table->cnt);
+#endif
+
+    return;
 }
 
 /*****************************************************************************
- Prototype    : alg_napt_table_insert_4tcp
- Description  : create napt item
- Input        : u16 src_port    source port
-                u8  ip          soutce ip
+ Prototype    : alg_napt_table_age
+ Description  : expire the items of the wheel slots that came due
+ Input        : struct napt_table *table
  Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
+ Return Value : void
+ Note         : only the due slots are visited, items refreshed since they
+                were hooked are moved to the slot of their new expiry
 *****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_table_insert_4tcp(u16 src_port, u8 ip)
+static void alg_napt_table_age(struct napt_table *table)
 {
-    u16 new_port;
-    struct napt_addr_4tu *napt;
+    u32 slot;
+    struct napt_item *napt;
+    struct napt_item *list;
 
-#ifdef NAPT_TABLE_LIMIT
-    if (true == alg_napt_table_is_full())
+    while (table->now != napt_tick)
     {
-        return NULL;
-    }
-#endif
-
-    napt = alg_napt_mem_alloc(sizeof(struct napt_addr_4tu));
-    if (NULL == napt)
-    {
-        return NULL;
-    }
+        table->now++;
+        list = table->wheel[table->now & NAPT_WHEEL_MASK];
+        table->wheel[table->now & NAPT_WHEEL_MASK] = NULL;
 
-    memset(napt, 0, sizeof(struct napt_addr_4tu));
-    napt->src_port = src_port;
+        while (NULL != list)
+        {
+            napt = list;
+            list = list->tmr_next;
 
-    new_port = alg_napt_port_alloc();
-    if (0 == new_port)
-    {
-        alg_napt_mem_free(napt);
-        return NULL;
+            if ((s16)(napt->expire - table->now) > 0)
+            {
+                slot = napt->expire & NAPT_WHEEL_MASK;
+                napt->tmr_next = table->wheel[slot];
+                table->wheel[slot] = napt;
+            }
+            else
+            {
+                alg_napt_table_remove(table, napt);
+            }
+        }
     }
 
-    napt->new_port = htons(new_port);
-    napt->src_ip = ip;
-    napt->time_stamp++;
-
-#ifdef NAPT_TABLE_LIMIT
-    napt_table_4tcp.cnt++;
-#endif
-    napt->next = napt_table_4tcp.next;
-    napt_table_4tcp.next = napt;
-
-#ifdef NAPT_ALLOC_DEBUG
-    printf("@@ napt tcp port alloc %hu\r\n", ++napt4tcp_cnt);
-#endif
-
-    return napt;
-}
-
-/*****************************************************************************
- Prototype    : alg_napt_table_update_4tcp
- Description  : fresh napt item
- Input        : struct napt_addr_4tu *napt  napt item
- Output       : None
- Return Value : void
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
-*****************************************************************************/
-static inline void alg_napt_table_update_4tcp(struct napt_addr_4tu *napt)
-{
-    if (!++napt->time_stamp)
-        napt->time_stamp++;
-
     return;
 }
 
 /*****************************************************************************
- Prototype    : alg_napt_get_udp_port_by_dest
- Description  : find item by port
- Input        : u16 port    dest port
+ Prototype    : alg_napt_table_insert_4ic
+ Description  : create napt item
+ Input        : u16 id          source id
+                u8  ip          source ip
  Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
+ Note         : icmp item no limit
  ------------------------------------------------------------------------------
  
   History        :
@@ -697,31 +596,27 @@ static inline void alg_napt_table_update_4tcp(struct napt_addr_4tu *napt)
     Modification : Created function
 
 *****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_get_udp_port_by_dest(u16 port)
+static inline struct napt_item *alg_napt_table_insert_4ic(u16 id, u8 ip)
 {
-    struct napt_addr_4tu *ret = NULL;
-    struct napt_addr_4tu *napt;
+    u16 new_id;
 
-    NAPT_TABLE_FOREACH(napt, napt_table_4udp)
+    new_id = alg_napt_icmp_id_alloc();
+    if (0 == new_id)
     {
-        if (napt->new_port == port)
-        {
-            ret = napt;
-            break;
-        }
+        return NULL;
     }
 
-    return ret;
+    return alg_napt_table_insert(&napt_table_4ic, id, ip, new_id);
 }
 
 /*****************************************************************************
- Prototype    : alg_napt_get_udp_port_by_src
- Description  : find item by port and ip
- Input        : u16 port    source port
-                u8  ip      source ip
+ Prototype    : alg_napt_table_insert_4tcp
+ Description  : create napt item
+ Input        : u16 src_port    source port
+                u8  ip          soutce ip
  Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
  ------------------------------------------------------------------------------
  
   History        :
@@ -730,24 +625,17 @@ static inline struct napt_addr_4tu *alg_napt_get_udp_port_by_dest(u16 port)
     Modification : Created function
 
 *****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_get_udp_port_by_src(u16 port, u8 ip)
+static inline struct napt_item *alg_napt_table_insert_4tcp(u16 src_port, u8 ip)
 {
-    struct napt_addr_4tu *ret = NULL;
-    struct napt_addr_4tu *napt;
+    u16 new_port;
 
-    NAPT_TABLE_FOREACH(napt, napt_table_4udp)
+    new_port = alg_napt_port_alloc();
+    if (0 == new_port)
     {
-        if (port == napt->src_port)
-        {
-            if (ip == napt->src_ip)
-            {
-                ret = napt;
-                break;
-            }
-        }
+        return NULL;
     }
 
-    return ret;
+    return alg_napt_table_insert(&napt_table_4tcp, src_port, ip, htons(new_port));
 }
 
 /*****************************************************************************
@@ -756,8 +644,8 @@ static inline struct napt_addr_4tu *alg_napt_get_udp_port_by_src(u16 port, u8 ip
  Input        : u16 src_port    source port
                 u8  ip          dest   port
  Output       : None
- Return Value : struct napt_addr_4tu *      NULL   fail
-                                           !NULL   success
+ Return Value : struct napt_item *      NULL   fail
+                                       !NULL   success
  ------------------------------------------------------------------------------
  
   History        :
@@ -766,71 +654,17 @@ static inline struct napt_addr_4tu *alg_napt_get_udp_port_by_src(u16 port, u8 ip
     Modification : Created function
 
 *****************************************************************************/
-static inline struct napt_addr_4tu *alg_napt_table_insert_4udp(u16 src_port, u8 ip)
+static inline struct napt_item *alg_napt_table_insert_4udp(u16 src_port, u8 ip)
 {
     u16 new_port;
-    struct napt_addr_4tu *napt;
-
-#ifdef NAPT_TABLE_LIMIT
-    if (true == alg_napt_table_is_full())
-    {
-        return NULL;
-    }
-#endif
-
-    napt = alg_napt_mem_alloc(sizeof(struct napt_addr_4tu));
-    if (NULL == napt)
-    {
-        return NULL;
-    }
-
-    memset(napt, 0, sizeof(struct napt_addr_4tu));
-    napt->src_port = src_port;
 
     new_port = alg_napt_port_alloc();
     if (0 == new_port)
     {
-        alg_napt_mem_free(napt);
         return NULL;
     }
 
-    napt->new_port = htons(new_port);
-    napt->src_ip = ip;
-    napt->time_stamp++;
-
-#ifdef NAPT_TABLE_LIMIT
-    napt_table_4udp.cnt++;
-#endif
-    napt->next = napt_table_4udp.next;
-    napt_table_4udp.next = napt;
-
-#ifdef NAPT_ALLOC_DEBUG
-    printf("@@ napt udp port alloc %hu\r\n", ++napt4udp_cnt);
-#endif
-
-    return napt;
-}
-
-/*****************************************************************************
- Prototype    : alg_napt_table_update_4udp
- Description  : fresh napt item
- Input        : struct napt_addr_4tu *napt
- Output       : None
- Return Value : void
- ------------------------------------------------------------------------------
- 
-  History        :
-  1.Date         : 2015/3/10
-    Author       : Li Limin, lilm@winnermicro.com
-    Modification : Created function
-
-*****************************************************************************/
-static inline void alg_napt_table_update_4udp(struct napt_addr_4tu *napt)
-{
-    if (!++napt->time_stamp)
-        napt->time_stamp++;
-
-    return;
+    return alg_napt_table_insert(&napt_table_4udp, src_port, ip, htons(new_port));
 }
 
 /*****************************************************************************
@@ -849,9 +683,6 @@ static inline void alg_napt_table_update_4udp(struct napt_addr_4tu *napt)
 *****************************************************************************/
 static void alg_napt_table_check_4tcp(void)
 {
-    struct napt_addr_4tu *napt4tcp;
-    struct napt_addr_4tu *napt4tcp_prev;
-
     /* tcp */
 #ifdef NAPT_TABLE_MUTEX_LOCK
     if (alg_napt_try_lock(napt_table_lock_4tcp))
@@ -862,52 +693,7 @@ static void alg_napt_table_check_4tcp(void)
     }
     napt_check_tcp = FALSE;
 #endif
-    for (napt4tcp_prev = napt_table_4tcp.next;\
-         NULL != napt4tcp_prev;\
-         napt4tcp_prev = napt4tcp_prev->next)
-    {
-        napt4tcp = napt4tcp_prev->next;
-        if (NULL != napt4tcp)
-        {
-            if (0 == napt4tcp->time_stamp)
-            {
-#ifdef NAPT_TABLE_LIMIT
-                napt_table_4tcp.cnt--;
-#endif
-                napt4tcp_prev->next = napt4tcp->next;
-                napt4tcp->next = NULL;
-                alg_napt_mem_free(napt4tcp);
-#ifdef NAPT_ALLOC_DEBUG
-                printf("@@ napt tcp port free %hu\r\n", --napt4tcp_cnt);
-#endif
-            }
-            else
-            {
-                napt4tcp->time_stamp = 0;
-            }
-        }
-        
-    }
-    napt4tcp = napt_table_4tcp.next;
-    if (NULL != napt4tcp)
-    {
-        if (0 == napt4tcp->time_stamp)
-        {
-#ifdef NAPT_TABLE_LIMIT
-            napt_table_4tcp.cnt--;
-#endif
-            napt_table_4tcp.next = napt4tcp->next;
-            napt4tcp->next = NULL;
-            alg_napt_mem_free(napt4tcp);
-#ifdef NAPT_ALLOC_DEBUG
-            printf("@@ napt tcp port free %hu\r\n", --napt4tcp_cnt);
-#endif
-        }
-        else
-        {
-            napt4tcp->time_stamp = 0;
-        }
-    }
+    alg_napt_table_age(&napt_table_4tcp);
 #ifdef NAPT_TABLE_MUTEX_LOCK
     alg_napt_unlock(napt_table_lock_4tcp);
 #endif
@@ -930,9 +716,6 @@ static void alg_napt_table_check_4tcp(void)
 *****************************************************************************/
 static void alg_napt_table_check_4udp(void)
 {
-    struct napt_addr_4tu *napt4udp;
-    struct napt_addr_4tu *napt4udp_prev;
-
     /* udp */
 #ifdef NAPT_TABLE_MUTEX_LOCK
     if (alg_napt_try_lock(napt_table_lock_4udp))
@@ -943,52 +726,7 @@ static void alg_napt_table_check_4udp(void)
     }
     napt_check_udp = FALSE;
 #endif
-    for (napt4udp_prev = napt_table_4udp.next;\
-         NULL != napt4udp_prev;\
-         napt4udp_prev = napt4udp_prev->next)
-    {
-        napt4udp = napt4udp_prev->next;
-        if (NULL != napt4udp)
-        {
-            if (0 == napt4udp->time_stamp)
-            {
-#ifdef NAPT_TABLE_LIMIT
-                napt_table_4udp.cnt--;
-#endif
-                napt4udp_prev->next = napt4udp->next;
-                napt4udp->next = NULL;
-                alg_napt_mem_free(napt4udp);
-#ifdef NAPT_ALLOC_DEBUG
-                printf("@@ napt udp port free %hu\r\n", --napt4udp_cnt);
-#endif
-            }
-            else
-            {
-                napt4udp->time_stamp = 0;
-            }
-        }
-        
-    }
-    napt4udp = napt_table_4udp.next;
-    if (NULL != napt4udp)
-    {
-        if (0 == napt4udp->time_stamp)
-        {
-#ifdef NAPT_TABLE_LIMIT
-            napt_table_4udp.cnt--;
-#endif
-            napt_table_4udp.next = napt4udp->next;
-            napt4udp->next = NULL;
-            alg_napt_mem_free(napt4udp);
-#ifdef NAPT_ALLOC_DEBUG
-            printf("@@ napt udp port free %hu\r\n", --napt4udp_cnt);
-#endif
-        }
-        else
-        {
-            napt4udp->time_stamp = 0;
-        }
-    }
+    alg_napt_table_age(&napt_table_4udp);
 #ifdef NAPT_TABLE_MUTEX_LOCK
     alg_napt_unlock(napt_table_lock_4udp);
 #endif
@@ -1011,9 +749,6 @@ static void alg_napt_table_check_4udp(void)
 *****************************************************************************/
 static void alg_napt_table_check_4ic(void)
 {
-    struct napt_addr_4ic *napt4ic;
-    struct napt_addr_4ic *napt4ic_prev;
-
     /* icmp */
 #ifdef NAPT_TABLE_MUTEX_LOCK
     if (alg_napt_try_lock(napt_table_lock_4ic))
@@ -1024,54 +759,7 @@ static void alg_napt_table_check_4ic(void)
     }
     napt_check_ic = FALSE;
 #endif
-    /* skip the first item */
-    for (napt4ic_prev = napt_table_4ic.next;\
-         NULL != napt4ic_prev;\
-         napt4ic_prev = napt4ic_prev->next)
-    {
-        napt4ic = napt4ic_prev->next;
-        if (NULL != napt4ic)
-        {
-            if (0 == napt4ic->time_stamp)
-            {
-#ifdef NAPT_TABLE_LIMIT
-                napt_table_4ic.cnt--;
-#endif
-                napt4ic_prev->next = napt4ic->next;
-                napt4ic->next = NULL;
-                alg_napt_mem_free(napt4ic);
-#ifdef NAPT_ALLOC_DEBUG
-                printf("@@ napt id free %hu\r\n", --napt4ic_cnt);
-#endif
-            }
-            else
-            {
-                napt4ic->time_stamp = 0;
-            }
-        }
-        
-    }
-    /* check the first item */
-    napt4ic = napt_table_4ic.next;
-    if (NULL != napt4ic)
-    {
-        if (0 == napt4ic->time_stamp)
-        {
-#ifdef NAPT_TABLE_LIMIT
-            napt_table_4ic.cnt--;
-#endif
-            napt_table_4ic.next = napt4ic->next;
-            napt4ic->next = NULL;
-            alg_napt_mem_free(napt4ic);
-#ifdef NAPT_ALLOC_DEBUG
-            printf("@@ napt id free %hu\r\n", --napt4ic_cnt);
-#endif
-        }
-        else
-        {
-            napt4ic->time_stamp = 0;
-        }
-    }
+    alg_napt_table_age(&napt_table_4ic);
 #ifdef NAPT_TABLE_MUTEX_LOCK
     alg_napt_unlock(napt_table_lock_4ic);
 #endif
@@ -1123,10 +811,15 @@ static void alg_napt_table_check_4gre(void)
 *****************************************************************************/
 static void alg_napt_table_check(void *arg)
 {
+    napt_tick++;
+
     alg_napt_table_check_4tcp();
     alg_napt_table_check_4udp();
     alg_napt_table_check_4ic();
-    alg_napt_table_check_4gre();
+
+    /* gre keeps its two strike check every half timeout */
+    if (0 == (napt_tick % (NAPT_WHEEL_SLOTS / 2)))
+        alg_napt_table_check_4gre();
 
     return;
 }
@@ -1147,6 +840,7 @@ static void alg_napt_table_check_try(void)
 }
 #endif
 
+#ifdef NAPT_CHKSUM_DEBUG
 /*****************************************************************************
  Prototype    : alg_hdr_16bitsum
  Description  : check sum
@@ -1246,6 +940,113 @@ static inline u16 alg_tcpudphdr_chksum(u32 src_addr, u32 dst_addr, u8 proto,
     return (u16)(~sum);
 }
 
+/*****************************************************************************
+ Prototype    : alg_chksum_verify
+ Description  : sum a translated packet, checksum fields included
+ Input        : const struct ip_hdr *ip_hdr
+ Output       : None
+ Return Value : void
+ Note         : a packet that came in damaged is reported as well
+*****************************************************************************/
+static void alg_chksum_verify(const struct ip_hdr *ip_hdr)
+{
+    u8 iphdr_len = (ip_hdr->_v_hl & 0x0F) * 4;
+    u16 len = ntohs(ip_hdr->_len) - iphdr_len;
+    const u16 *hdr = (const u16 *)((const u8 *)ip_hdr + iphdr_len);
+    u16 sum = 0;
+
+    if (0 != alg_iphdr_chksum((const u16 *)ip_hdr, iphdr_len))
+    {
+        printf("@@ napt ip chksum mismatch\r\n");
+    }
+
+    switch (ip_hdr->_proto)
+    {
+        case IP_PROTO_ICMP:
+            sum = alg_iphdr_chksum(hdr, len);
+            break;
+        case IP_PROTO_UDP:
+            if (0 == ((const struct udp_hdr *)hdr)->chksum)
+                break;
+        case IP_PROTO_TCP:
+            sum = alg_tcpudphdr_chksum(ip_hdr->src.addr, ip_hdr->dest.addr,
+                                       ip_hdr->_proto, hdr, len);
+            break;
+        default:
+            break;
+    }
+
+    if (0 != sum)
+    {
+        printf("@@ napt proto %hhu chksum mismatch\r\n", ip_hdr->_proto);
+    }
+
+    return;
+}
+#define NAPT_CHKSUM_VERIFY(ip_hdr)   alg_chksum_verify(ip_hdr)
+#else
+#define NAPT_CHKSUM_VERIFY(ip_hdr)
+#endif
+
+/*****************************************************************************
+ Prototype    : alg_chksum_replace16
+ Description  : update a checksum for one changed 16 bit word (RFC 1624)
+ Input        : u16 chksum    checksum as found in the header
+                u16 from      old word, as found in the header
+                u16 to        new word
+ Output       : None
+ Return Value : u16  new checksum
+*****************************************************************************/
+static inline u16 alg_chksum_replace16(u16 chksum, u16 from, u16 to)
+{
+    /* HC' = ~(~HC + ~m + m') */
+    u32 sum = (u16)~chksum;
+
+    sum += (u16)~from;
+    sum += to;
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return (u16)(~sum);
+}
+
+/*****************************************************************************
+ Prototype    : alg_chksum_replace32
+ Description  : update a checksum for a changed ip address (RFC 1624)
+ Input        : u16 chksum    checksum as found in the header
+                u32 from      old address, as found in the header
+                u32 to        new address
+ Output       : None
+ Return Value : u16  new checksum
+*****************************************************************************/
+static inline u16 alg_chksum_replace32(u16 chksum, u32 from, u32 to)
+{
+    u32 sum = (u16)~chksum;
+
+    sum += (u16)~(from >> 16);
+    sum += (u16)~(from & 0xFFFF);
+    sum += to >> 16;
+    sum += to & 0xFFFF;
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return (u16)(~sum);
+}
+
+/*****************************************************************************
+ Prototype    : alg_udp_chksum
+ Description  : udp sends a computed checksum of 0 as 0xFFFF, 0 means none
+ Input        : u16 chksum    updated checksum
+ Output       : None
+ Return Value : u16  checksum for the udp header
+*****************************************************************************/
+static inline u16 alg_udp_chksum(u16 chksum)
+{
+    return (0 == chksum) ? 0xFFFF : chksum;
+}
+
 /*****************************************************************************
  Prototype    : alg_output
  Description  : wifi mac layer forward
@@ -1367,7 +1168,9 @@ static int alg_icmp_proc(const u8 *bssid,
                          u8 *ehdr, u16 eth_len)
 {
     int err;
-    struct napt_addr_4ic *napt;
+    u16 old_id;
+    u32 old_addr;
+    struct napt_item *napt;
     struct icmp_echo_hdr *icmp_hdr;
     struct netif *net_if = tls_get_netif();
     u8 *mac = wpa_supplicant_get_mac();
@@ -1389,7 +1192,7 @@ static int alg_icmp_proc(const u8 *bssid,
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_lock(napt_table_lock_4ic);
 #endif
-        napt = alg_napt_get_by_src_id(icmp_hdr->id, ip_hdr->src.addr >> 24);
+        napt = alg_napt_table_get_by_src(&napt_table_4ic, icmp_hdr->id, ip_hdr->src.addr >> 24);
         if (NULL == napt)
         {
             napt = alg_napt_table_insert_4ic(icmp_hdr->id, ip_hdr->src.addr >> 24);
@@ -1403,21 +1206,22 @@ static int alg_icmp_proc(const u8 *bssid,
         }
         else
         {
-            alg_napt_table_update_4ic(napt);
+            alg_napt_table_update(napt);
         }
 
-        icmp_hdr->id = napt->new_id;
+        old_id = icmp_hdr->id;
+        icmp_hdr->id = napt->new_port;
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_unlock(napt_table_lock_4ic);
 #endif
 
-        icmp_hdr->chksum = 0;
-        icmp_hdr->chksum = alg_iphdr_chksum((u16 *)icmp_hdr, ntohs(ip_hdr->_len) - iphdr_len);
+        icmp_hdr->chksum = alg_chksum_replace16(icmp_hdr->chksum, old_id, icmp_hdr->id);
 
+        old_addr = ip_hdr->src.addr;
         ip_hdr->src.addr = ip_addr_get_ip4_u32(&net_if->ip_addr);
-        ip_hdr->_chksum = 0;
-        ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->src.addr);
+        NAPT_CHKSUM_VERIFY(ip_hdr);
 
         if ((ip_addr_get_ip4_u32(&net_if->ip_addr) & 0xFFFFFF) == (ip_hdr->dest.addr & 0xFFFFFF))
         {
@@ -1436,23 +1240,24 @@ static int alg_icmp_proc(const u8 *bssid,
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_lock(napt_table_lock_4ic);
 #endif
-        napt = alg_napt_get_by_dst_id(icmp_hdr->id);
+        napt = alg_napt_table_get_by_dest(&napt_table_4ic, icmp_hdr->id);
         if (NULL != napt)
         {
-            //alg_napt_table_update_4ic(napt);
+            //alg_napt_table_update(napt);
 
-            icmp_hdr->id = napt->src_id;
-            icmp_hdr->chksum = 0;
-            icmp_hdr->chksum = alg_iphdr_chksum((u16 *)icmp_hdr, ntohs(ip_hdr->_len) - iphdr_len);
+            old_id = icmp_hdr->id;
+            icmp_hdr->id = napt->src_port;
+            icmp_hdr->chksum = alg_chksum_replace16(icmp_hdr->chksum, old_id, icmp_hdr->id);
 
+            old_addr = ip_hdr->dest.addr;
             ip_hdr->dest.addr = ((napt->src_ip) << 24) | (ip_addr_get_ip4_u32(&net_if->next->ip_addr) & 0x00ffffff);
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
             alg_napt_unlock(napt_table_lock_4ic);
 #endif
 
-            ip_hdr->_chksum = 0;
-            ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+            ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->dest.addr);
+            NAPT_CHKSUM_VERIFY(ip_hdr);
 
             memcpy(ehdr, tls_dhcps_getmac((ip_addr_t *)&ip_hdr->dest.addr), ETH_ALEN);
             memcpy(ehdr + ETH_ALEN, mac2, ETH_ALEN);
@@ -1499,7 +1304,9 @@ static int alg_tcp_proc(const u8 *bssid,
 {
     int err;
     u8 src_ip;
-    struct napt_addr_4tu *napt;
+    u16 old_port;
+    u32 old_addr;
+    struct napt_item *napt;
     struct tcp_hdr *tcp_hdr;
     struct netif *net_if = tls_get_netif();
     u8 *mac = wpa_supplicant_get_mac();
@@ -1522,7 +1329,7 @@ static int alg_tcp_proc(const u8 *bssid,
         alg_napt_lock(napt_table_lock_4tcp);
 #endif
         src_ip = ip_hdr->src.addr >> 24;
-        napt = alg_napt_get_tcp_port_by_src(tcp_hdr->src, src_ip);
+        napt = alg_napt_table_get_by_src(&napt_table_4tcp, tcp_hdr->src, src_ip);
         if (NULL == napt)
         {
             napt = alg_napt_table_insert_4tcp(tcp_hdr->src, src_ip);
@@ -1536,24 +1343,23 @@ static int alg_tcp_proc(const u8 *bssid,
         }
         else
         {
-            alg_napt_table_update_4tcp(napt);
+            alg_napt_table_update(napt);
         }
 
+        old_port = tcp_hdr->src;
         tcp_hdr->src = napt->new_port;
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_unlock(napt_table_lock_4tcp);
 #endif
 
+        old_addr = ip_hdr->src.addr;
         ip_hdr->src.addr = ip_addr_get_ip4_u32(&net_if->ip_addr);
-        ip_hdr->_chksum = 0;
-        ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->src.addr);
 
-        tcp_hdr->chksum = 0;
-        tcp_hdr->chksum = alg_tcpudphdr_chksum(ip_hdr->src.addr,
-                                               ip_hdr->dest.addr,
-                                               IP_PROTO_TCP,
-                                               (u16 *)tcp_hdr,
-                                               ntohs(ip_hdr->_len) - iphdr_len);
+        /* the pseudo header has the address */
+        tcp_hdr->chksum = alg_chksum_replace16(tcp_hdr->chksum, old_port, tcp_hdr->src);
+        tcp_hdr->chksum = alg_chksum_replace32(tcp_hdr->chksum, old_addr, ip_hdr->src.addr);
+        NAPT_CHKSUM_VERIFY(ip_hdr);
 
         if ((ip_addr_get_ip4_u32(&net_if->ip_addr) & 0xFFFFFF) == (ip_hdr->dest.addr & 0xFFFFFF))
         {
@@ -1573,28 +1379,26 @@ static int alg_tcp_proc(const u8 *bssid,
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_lock(napt_table_lock_4tcp);
 #endif
-        napt = alg_napt_get_tcp_port_by_dest(tcp_hdr->dest);
+        napt = alg_napt_table_get_by_dest(&napt_table_4tcp, tcp_hdr->dest);
         /* forward to sta... */
         if (NULL != napt)
         {
-            //alg_napt_table_update_4tcp(napt);
+            //alg_napt_table_update(napt);
 
+            old_addr = ip_hdr->dest.addr;
             ip_hdr->dest.addr = (napt->src_ip << 24) | (ip_addr_get_ip4_u32(&net_if->next->ip_addr) & 0x00ffffff);
-            ip_hdr->_chksum = 0;
-            ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+            ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->dest.addr);
 
+            old_port = tcp_hdr->dest;
             tcp_hdr->dest = napt->src_port;
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
             alg_napt_unlock(napt_table_lock_4tcp);
 #endif
 
-            tcp_hdr->chksum = 0;
-            tcp_hdr->chksum = alg_tcpudphdr_chksum(ip_hdr->src.addr,
-                                                   ip_hdr->dest.addr,
-                                                   IP_PROTO_TCP,
-                                                   (u16 *)tcp_hdr,
-                                                   ntohs(ip_hdr->_len) - iphdr_len);
+            tcp_hdr->chksum = alg_chksum_replace16(tcp_hdr->chksum, old_port, tcp_hdr->dest);
+            tcp_hdr->chksum = alg_chksum_replace32(tcp_hdr->chksum, old_addr, ip_hdr->dest.addr);
+            NAPT_CHKSUM_VERIFY(ip_hdr);
 
             memcpy(ehdr, tls_dhcps_getmac((ip_addr_t *)&ip_hdr->dest.addr), ETH_ALEN);
             memcpy(ehdr + ETH_ALEN, mac2, ETH_ALEN);
@@ -1642,7 +1446,10 @@ static int alg_udp_proc(const u8 *bssid,
 {
     int err = 0;
     u8 src_ip;
-    struct napt_addr_4tu *napt;
+    u16 old_port;
+    u32 old_src;
+    u32 old_dest;
+    struct napt_item *napt;
     struct udp_hdr *udp_hdr;
     struct netif *net_if = tls_get_netif();
     u8 *mac = wpa_supplicant_get_mac();
@@ -1677,7 +1484,7 @@ static int alg_udp_proc(const u8 *bssid,
         alg_napt_lock(napt_table_lock_4udp);
 #endif
         src_ip = ip_hdr->src.addr >> 24;
-        napt = alg_napt_get_udp_port_by_src(udp_hdr->src, src_ip);
+        napt = alg_napt_table_get_by_src(&napt_table_4udp, udp_hdr->src, src_ip);
         if (NULL == napt)
         {
             napt = alg_napt_table_insert_4udp(udp_hdr->src, src_ip);
@@ -1691,16 +1498,24 @@ static int alg_udp_proc(const u8 *bssid,
         }
         else
         {
-            alg_napt_table_update_4udp(napt);
+            alg_napt_table_update(napt);
         }
 
+        old_port = udp_hdr->src;
         udp_hdr->src = napt->new_port;
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_unlock(napt_table_lock_4udp);
 #endif
 
+        if (0 != udp_hdr->chksum)
+        {
+            udp_hdr->chksum = alg_udp_chksum(alg_chksum_replace16(udp_hdr->chksum, old_port, udp_hdr->src));
+        }
+
 redo:
+        old_src = ip_hdr->src.addr;
+        old_dest = ip_hdr->dest.addr;
         if (is_dns)
         {
             dns = (ip_addr_t*)dns_getserver(is_dns - 1);
@@ -1710,18 +1525,15 @@ redo:
         }
         
         ip_hdr->src.addr = ip_addr_get_ip4_u32(&net_if->ip_addr);
-        ip_hdr->_chksum = 0;
-        ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_src, ip_hdr->src.addr);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_dest, ip_hdr->dest.addr);
 
         if (0 != udp_hdr->chksum)
         {
-            udp_hdr->chksum = 0;
-            udp_hdr->chksum = alg_tcpudphdr_chksum(ip_hdr->src.addr,
-                                                   ip_hdr->dest.addr,
-                                                   IP_PROTO_UDP,
-                                                   (u16 *)udp_hdr,
-                                                   ntohs(ip_hdr->_len) - iphdr_len);
+            udp_hdr->chksum = alg_chksum_replace32(udp_hdr->chksum, old_src, ip_hdr->src.addr);
+            udp_hdr->chksum = alg_udp_chksum(alg_chksum_replace32(udp_hdr->chksum, old_dest, ip_hdr->dest.addr));
         }
+        NAPT_CHKSUM_VERIFY(ip_hdr);
 
         if ((ip_addr_get_ip4_u32(&net_if->ip_addr) & 0xFFFFFF) == (ip_hdr->dest.addr & 0xFFFFFF))
         {
@@ -1747,14 +1559,17 @@ redo:
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_lock(napt_table_lock_4udp);
 #endif
-        napt = alg_napt_get_udp_port_by_dest(udp_hdr->dest);
+        napt = alg_napt_table_get_by_dest(&napt_table_4udp, udp_hdr->dest);
         /* forward to sta... */
         if (NULL != napt)
         {
-            alg_napt_table_update_4udp(napt);
+            alg_napt_table_update(napt);
 
+            old_src = ip_hdr->src.addr;
+            old_dest = ip_hdr->dest.addr;
             ip_hdr->dest.addr = (napt->src_ip << 24) | (ip_addr_get_ip4_u32(&net_if->next->ip_addr) & 0x00ffffff);
 
+            old_port = udp_hdr->dest;
             udp_hdr->dest = napt->src_port;
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
@@ -1766,18 +1581,16 @@ redo:
                 ip_hdr->src.addr = ip_addr_get_ip4_u32(&net_if->next->ip_addr);
             }
 
-            ip_hdr->_chksum = 0;
-            ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+            ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_src, ip_hdr->src.addr);
+            ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_dest, ip_hdr->dest.addr);
 
             if (0 != udp_hdr->chksum)
             {
-                udp_hdr->chksum = 0;
-                udp_hdr->chksum = alg_tcpudphdr_chksum(ip_hdr->src.addr,
-                                                       ip_hdr->dest.addr,
-                                                       IP_PROTO_UDP,
-                                                       (u16 *)udp_hdr,
-                                                       ntohs(ip_hdr->_len) - iphdr_len);
+                udp_hdr->chksum = alg_chksum_replace16(udp_hdr->chksum, old_port, udp_hdr->dest);
+                udp_hdr->chksum = alg_chksum_replace32(udp_hdr->chksum, old_src, ip_hdr->src.addr);
+                udp_hdr->chksum = alg_udp_chksum(alg_chksum_replace32(udp_hdr->chksum, old_dest, ip_hdr->dest.addr));
             }
+            NAPT_CHKSUM_VERIFY(ip_hdr);
 
             memcpy(ehdr, tls_dhcps_getmac((ip_addr_t *)&ip_hdr->dest.addr), ETH_ALEN);
             memcpy(ehdr + ETH_ALEN, mac2, ETH_ALEN);
@@ -1824,13 +1637,11 @@ static int alg_gre_proc(const u8 *bssid, struct ip_hdr *ip_hdr, u8 *ehdr, u16 et
 {
     int err;
     u8 src_ip;
-    u8 iphdr_len;
+    u32 old_addr;
     struct netif *net_if = tls_get_netif();
     u8 *mac = wpa_supplicant_get_mac();
     u8 *mac2 = hostapd_get_mac();
 
-    iphdr_len = (ip_hdr->_v_hl & 0x0F) * 4;
-
     /* from sta... */
     if (0 == compare_ether_addr(bssid, mac2))
     {
@@ -1852,9 +1663,9 @@ static int alg_gre_proc(const u8 *bssid, struct ip_hdr *ip_hdr, u8 *ehdr, u16 et
                 gre_info.time_stamp++;
         }
 
+        old_addr = ip_hdr->src.addr;
         ip_hdr->src.addr = ip_addr_get_ip4_u32(&net_if->ip_addr);
-        ip_hdr->_chksum = 0;
-        ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->src.addr);
 
         if ((ip_addr_get_ip4_u32(&net_if->ip_addr) & 0xFFFFFF) == (ip_hdr->dest.addr & 0xFFFFFF))
         {
@@ -1871,9 +1682,9 @@ static int alg_gre_proc(const u8 *bssid, struct ip_hdr *ip_hdr, u8 *ehdr, u16 et
     /* from ap... */
     else
     {
+        old_addr = ip_hdr->dest.addr;
         ip_hdr->dest.addr = (gre_info.src_ip << 24) | (ip_addr_get_ip4_u32(&net_if->next->ip_addr) & 0x00ffffff);
-        ip_hdr->_chksum = 0;
-        ip_hdr->_chksum = alg_iphdr_chksum((u16 *)ip_hdr, iphdr_len);
+        ip_hdr->_chksum = alg_chksum_replace32(ip_hdr->_chksum, old_addr, ip_hdr->dest.addr);
 
         memcpy(ehdr, tls_dhcps_getmac((ip_addr_t *)&ip_hdr->dest.addr), ETH_ALEN);
         memcpy(ehdr + ETH_ALEN, mac2, ETH_ALEN);
@@ -1959,19 +1770,16 @@ int alg_input(const u8 *bssid, u8 *pkt_body, u32 pkt_len)
 bool alg_napt_port_is_used(u16 port)
 {
     bool is_used = false;
-    struct napt_addr_4tu *napt_tcp;
-    struct napt_addr_4tu *napt_udp;
+
+    /* the tables keep ports in network order */
+    port = htons(port);
 
 #ifdef NAPT_TABLE_MUTEX_LOCK
     alg_napt_lock(napt_table_lock_4tcp);
 #endif
-    NAPT_TABLE_FOREACH(napt_tcp, napt_table_4tcp)
+    if (NULL != alg_napt_table_get_by_dest(&napt_table_4tcp, port))
     {
-        if (port == napt_tcp->new_port)
-        {
-            is_used = true;
-            break;
-        }
+        is_used = true;
     }
 #ifdef NAPT_TABLE_MUTEX_LOCK
     alg_napt_unlock(napt_table_lock_4tcp);
@@ -1982,13 +1790,9 @@ bool alg_napt_port_is_used(u16 port)
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_lock(napt_table_lock_4udp);
 #endif
-        NAPT_TABLE_FOREACH(napt_udp, napt_table_4udp)
+        if (NULL != alg_napt_table_get_by_dest(&napt_table_4udp, port))
         {
-            if (port == napt_udp->new_port)
-            {
-                is_used = true;
-                break;
-            }
+            is_used = true;
         }
 #ifdef NAPT_TABLE_MUTEX_LOCK
         alg_napt_unlock(napt_table_lock_4udp);
@@ -2018,9 +1822,15 @@ int alg_napt_init(void)
     int err = 0;
     struct tls_timer_cfg timer_cfg;
 
-    memset(&napt_table_4tcp, 0, sizeof(struct napt_table_head_4tu));
-    memset(&napt_table_4udp, 0, sizeof(struct napt_table_head_4tu));
-    memset(&napt_table_4ic, 0, sizeof(struct napt_table_head_4ic));
+    memset(&napt_table_4tcp, 0, sizeof(struct napt_table));
+    memset(&napt_table_4udp, 0, sizeof(struct napt_table));
+    memset(&napt_table_4ic, 0, sizeof(struct napt_table));
+    napt_tick = 0;
+#ifdef NAPT_ALLOC_DEBUG
+    napt_table_4tcp.name = "tcp port";
+    napt_table_4udp.name = "udp port";
+    napt_table_4ic.name = "id";
+#endif
 
     napt_curr_port = NAPT_LOCAL_PORT_RANGE_START;
     napt_curr_id   = NAPT_ICMP_ID_RANGE_START;
@@ -2047,12 +1857,6 @@ int alg_napt_init(void)
     }
 #endif
 
-#ifdef NAPT_ALLOC_DEBUG
-    napt4ic_cnt = 0;
-    napt4tcp_cnt = 0;
-    napt4udp_cnt = 0;
-#endif
-
     memset(&timer_cfg, 0, sizeof(timer_cfg));
     timer_cfg.unit = TLS_TIMER_UNIT_MS;
     timer_cfg.timeout = NAPT_TMR_INTERVAL;
@@ -255,6 +255,96 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+/** Fold a 64-bit sum of 32-bit words to the 16-bit lwip checksum */
+static u16_t
+lwip_chksum_fold64(unsigned long long acc, int odd)
+{
+  u32_t sum;
+
+  acc = (acc >> 32) + (acc & 0xffffffffUL);
+  acc = (acc >> 32) + (acc & 0xffffffffUL);
+  sum = (u32_t)acc;
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif
+
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+/**
+ * Like version #3, but the inner loop sums 32-bit words into a 64-bit
+ * accumulator, 16 bytes per iteration. The carries collect in the upper
+ * half, so each word costs one load and an add-with-carry pair on 32-bit
+ * cores without any compare.
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+u16_t
+lwip_standard_chksum(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  const u16_t *ps;
+  const u32_t *pl;
+  u16_t t = 0;
+  unsigned long long acc = 0;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (const u16_t *)(const void *)pb;
+
+  if (((mem_ptr_t)ps & 3) && len > 1) {
+    acc += *ps++;
+    len -= 2;
+  }
+
+  pl = (const u32_t *)(const void *)ps;
+
+  while (len > 15) {
+    acc += pl[0];
+    acc += pl[1];
+    acc += pl[2];
+    acc += pl[3];
+    pl += 4;
+    len -= 16;
+  }
+
+  while (len > 3) {
+    acc += *pl++;
+    len -= 4;
+  }
+
+  ps = (const u16_t *)(const void *)pl;
+
+  /* 16-bit aligned word remaining? */
+  if (len > 1) {
+    acc += *ps++;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *(const u8_t *)ps;
+  }
+
+  acc += t;
+
+  return lwip_chksum_fold64(acc, odd);
+}
+#endif
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
 inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
@@ -607,3 +697,83 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/** Copy and sum in one pass, a 32-bit word at a time, when source and
+ * destination have the same alignment within a word. Otherwise word
+ * stores would be unaligned, so this falls back to version #1.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  const u8_t *sb = (const u8_t *)src;
+  u8_t *db = (u8_t *)dst;
+  const u32_t *sl;
+  u32_t *dl;
+  u32_t w;
+  u16_t h;
+  u16_t t = 0;
+  unsigned long long acc = 0;
+  int n = len;
+  int odd = ((mem_ptr_t)sb & 1);
+
+  if (((mem_ptr_t)sb ^ (mem_ptr_t)db) & 3) {
+    MEMCPY(dst, src, len);
+    return LWIP_CHKSUM(dst, len);
+  }
+
+  if (odd && n > 0) {
+    ((u8_t *)&t)[1] = *db++ = *sb++;
+    n--;
+  }
+
+  if (((mem_ptr_t)sb & 3) && n > 1) {
+    h = *(const u16_t *)(const void *)sb;
+    *(u16_t *)(void *)db = h;
+    acc += h;
+    sb += 2;
+    db += 2;
+    n -= 2;
+  }
+
+  sl = (const u32_t *)(const void *)sb;
+  dl = (u32_t *)(void *)db;
+
+  while (n > 15) {
+    w = sl[0]; dl[0] = w; acc += w;
+    w = sl[1]; dl[1] = w; acc += w;
+    w = sl[2]; dl[2] = w; acc += w;
+    w = sl[3]; dl[3] = w; acc += w;
+    sl += 4;
+    dl += 4;
+    n -= 16;
+  }
+
+  while (n > 3) {
+    w = *sl++;
+    *dl++ = w;
+    acc += w;
+    n -= 4;
+  }
+
+  sb = (const u8_t *)sl;
+  db = (u8_t *)dl;
+
+  if (n > 1) {
+    h = *(const u16_t *)(const void *)sb;
+    *(u16_t *)(void *)db = h;
+    acc += h;
+    sb += 2;
+    db += 2;
+    n -= 2;
+  }
+
+  if (n > 0) {
+    ((u8_t *)&t)[0] = *db = *sb;
+  }
+
+  acc += t;
+
+  return lwip_chksum_fold64(acc, odd);
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
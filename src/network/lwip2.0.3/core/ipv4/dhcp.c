@@ -723,20 +723,14 @@ void dhcp_cleanup(struct netif *netif)
 }
 
 /**
- * @ingroup dhcp4
- * Start DHCP negotiation for a network interface.
- *
- * If no DHCP client instance was attached to this interface,
- * a new client is created first. If a DHCP client instance
- * was already present, it restarts negotiation.
+ * Attach (or reset) the DHCP client of a netif and start negotiation,
+ * either from INIT or, when a previous lease is known, from INIT-REBOOT.
  *
  * @param netif The lwIP network interface
- * @return lwIP error code
- * - ERR_OK - No error
- * - ERR_MEM - Out of memory
+ * @param lease previously leased address, NULL or any to discover
  */
-err_t
-dhcp_start(struct netif *netif)
+static err_t
+dhcp_start_client(struct netif *netif, const ip4_addr_t *lease)
 {
   struct dhcp *dhcp;
   err_t result;
@@ -797,7 +791,13 @@ dhcp_start(struct netif *netif)
 
 
   /* (re)start the DHCP negotiation */
-  result = dhcp_discover(netif);
+  if ((lease != NULL) && !ip4_addr_isany(lease)) {
+    /* REQUEST the old address, a NAK or no answer falls back to discover */
+    ip4_addr_copy(dhcp->offered_ip_addr, *lease);
+    result = dhcp_reboot(netif);
+  } else {
+    result = dhcp_discover(netif);
+  }
   if (result != ERR_OK) {
     /* free resources allocated above */
     dhcp_stop(netif);
@@ -806,6 +806,43 @@ dhcp_start(struct netif *netif)
   return result;
 }
 
+/**
+ * @ingroup dhcp4
+ * Start DHCP negotiation for a network interface.
+ *
+ * If no DHCP client instance was attached to this interface,
+ * a new client is created first. If a DHCP client instance
+ * was already present, it restarts negotiation.
+ *
+ * @param netif The lwIP network interface
+ * @return lwIP error code
+ * - ERR_OK - No error
+ * - ERR_MEM - Out of memory
+ */
+err_t
+dhcp_start(struct netif *netif)
+{
+  return dhcp_start_client(netif, NULL);
+}
+
+/**
+ * @ingroup dhcp4
+ * Start DHCP for a network interface in INIT-REBOOT state (RFC 2131,
+ * 3.2), asking the server to confirm a previously leased address
+ * instead of going through DISCOVER/OFFER.
+ *
+ * @param netif The lwIP network interface
+ * @param lease the previously leased address
+ * @return lwIP error code
+ * - ERR_OK - No error
+ * - ERR_MEM - Out of memory
+ */
+err_t
+dhcp_start_reboot(struct netif *netif, const ip4_addr_t *lease)
+{
+  return dhcp_start_client(netif, lease);
+}
+
 /**
  * @ingroup dhcp4
  * Inform a DHCP server of our manual configuration.
@@ -56,6 +56,7 @@
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/debug.h"
 #include "lwip/stats.h"
+#include "lwip/sys.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/nd6.h"
@@ -527,10 +528,10 @@ tcp_abandon(struct tcp_pcb *pcb, int reset)
       tcp_rst(seqno, ackno, &pcb->local_ip, &pcb->remote_ip, local_port, pcb->remote_port);
     }
  #if SNDBUF_SHARE
-    if(pcb->snd_buf < TCP_SND_BUF)
+    if(pcb->snd_buf < TCP_SND_BUF_MAX(pcb))
     {
-		sndbuf_len += (TCP_SND_BUF - pcb->snd_buf);
-		pcb->snd_buf = TCP_SND_BUF;
+		sndbuf_len += (TCP_SND_BUF_MAX(pcb) - pcb->snd_buf);
+		pcb->snd_buf = TCP_SND_BUF_MAX(pcb);
     }
 #endif
     last_state = pcb->state;
@@ -828,6 +829,16 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
   LWIP_ASSERT("don't call tcp_recved for listen-pcbs",
     pcb->state != LISTEN);
 
+#if TCP_WND_AUTOTUNE
+  pcb->tune_rcvd += len;
+  if (pcb->rcv_wnd_max > pcb->rcv_wnd_tgt) {
+    /* a lowered cap takes the window back as the application reads */
+    u16_t shrink = (u16_t)LWIP_MIN(len, pcb->rcv_wnd_max - pcb->rcv_wnd_tgt);
+    pcb->rcv_wnd_max -= shrink;
+    len -= shrink;
+  }
+#endif /* TCP_WND_AUTOTUNE */
+
   pcb->rcv_wnd += len;
   if (pcb->rcv_wnd > TCP_WND_MAX(pcb)) {
     pcb->rcv_wnd = TCP_WND_MAX(pcb);
@@ -849,7 +860,7 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
    * watermark is TCP_WND/4), then send an explicit update now.
    * Otherwise wait for a packet to be sent in the normal course of
    * events (or more window to be available later) */
-  if (wnd_inflation >= TCP_WND_UPDATE_THRESHOLD) {
+  if (wnd_inflation >= TCP_WND_UPDATE_THRESHOLD_PCB(pcb)) {
     tcp_ack_now(pcb);
     tcp_output(pcb);
   }
@@ -858,6 +869,226 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
          len, pcb->rcv_wnd, (u16_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd)));
 }
 
+#if TCP_WND_AUTOTUNE
+/**
+ * Sum of the receive window caps of the active pcbs other than pcb.
+ *
+ * @param pcb the pcb to leave out (may be NULL)
+ * @param others returns the number of pcbs counted
+ */
+static u32_t
+tcp_wnd_used(struct tcp_pcb *pcb, u8_t *others)
+{
+  struct tcp_pcb *p;
+  u32_t used = 0;
+  u8_t n = 0;
+
+  for (p = tcp_active_pcbs; p != NULL; p = p->next) {
+    if (p != pcb) {
+      used += p->rcv_wnd_max;
+      n++;
+    }
+  }
+  *others = n;
+  return used;
+}
+
+/**
+ * Move the caps of a pcb. Growing takes effect at once. A lower receive cap
+ * never retracts window already announced: the part not announced yet is
+ * taken now, the rest in tcp_recved(). A lower send cap only takes what is
+ * not in use, the invariant snd_buf_max - snd_buf = bytes queued is kept for
+ * SNDBUF_SHARE.
+ */
+static void
+tcp_wnd_set(struct tcp_pcb *pcb, u32_t rcv, u32_t snd)
+{
+  u32_t d;
+
+  pcb->rcv_wnd_tgt = (tcpwnd_size_t)rcv;
+  if (rcv > pcb->rcv_wnd_max) {
+    pcb->rcv_wnd += (tcpwnd_size_t)(rcv - pcb->rcv_wnd_max);
+    pcb->rcv_wnd_max = (tcpwnd_size_t)rcv;
+    if (((pcb->state == ESTABLISHED) || (pcb->state == CLOSE_WAIT)) &&
+        (tcp_update_rcv_ann_wnd(pcb) >= TCP_WND_UPDATE_THRESHOLD_PCB(pcb))) {
+      tcp_ack_now(pcb);
+      tcp_output(pcb);
+    }
+  } else {
+    u32_t announced = 0;
+    if (TCP_SEQ_GT(pcb->rcv_ann_right_edge, pcb->rcv_nxt)) {
+      announced = pcb->rcv_ann_right_edge - pcb->rcv_nxt;
+    }
+    d = pcb->rcv_wnd_max - rcv;
+    if (pcb->rcv_wnd > announced) {
+      d = LWIP_MIN(d, pcb->rcv_wnd - announced);
+    } else {
+      d = 0;
+    }
+    pcb->rcv_wnd -= (tcpwnd_size_t)d;
+    pcb->rcv_wnd_max -= (tcpwnd_size_t)d;
+  }
+
+  if (snd > pcb->snd_buf_max) {
+    pcb->snd_buf += (tcpwnd_size_t)(snd - pcb->snd_buf_max);
+    pcb->snd_buf_max = (tcpwnd_size_t)snd;
+  } else {
+    d = LWIP_MIN(pcb->snd_buf_max - snd, pcb->snd_buf);
+    pcb->snd_buf -= (tcpwnd_size_t)d;
+    pcb->snd_buf_max -= (tcpwnd_size_t)d;
+  }
+}
+
+/**
+ * Take back the announced window of a pcb idle for TCP_WND_IDLE_TICKS, the
+ * only way its cap comes off the budget. The peer sent nothing for that long
+ * and the application read everything, so the right edge moves back to
+ * TCP_WND_MIN past rcv_nxt. Shrinking is discouraged but every sender must
+ * cope with it (RFC 1122 4.2.2.16); data beyond the edge is trimmed and sent
+ * again.
+ */
+static void
+tcp_wnd_retract(struct tcp_pcb *pcb)
+{
+  if ((pcb->rcv_wnd_max > TCP_WND_MIN) && (pcb->rcv_wnd == pcb->rcv_wnd_max)) {
+    pcb->rcv_wnd = pcb->rcv_ann_wnd = pcb->rcv_wnd_max = TCP_WND_MIN;
+    pcb->rcv_ann_right_edge = pcb->rcv_nxt + TCP_WND_MIN;
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+  }
+}
+
+/**
+ * Set the initial caps of a new pcb from what the active pcbs leave.
+ */
+void
+tcp_wnd_tune_init(struct tcp_pcb *pcb)
+{
+  u32_t used;
+  u32_t rcv = TCP_WND_INIT;
+  u8_t others;
+
+  used = tcp_wnd_used(NULL, &others);
+  if (used + rcv > TCP_WND_BUDGET) {
+    rcv = (used + TCP_WND_MIN < TCP_WND_BUDGET) ? (TCP_WND_BUDGET - used) : TCP_WND_MIN;
+  }
+  pcb->wnd_prio = TCP_WND_PRIO_NORMAL;
+  pcb->rcv_wnd = pcb->rcv_ann_wnd = pcb->rcv_wnd_max = pcb->rcv_wnd_tgt = (tcpwnd_size_t)rcv;
+  pcb->snd_buf = pcb->snd_buf_max = TCP_WND_INIT;
+}
+
+/**
+ * Resize the caps of a pcb, called every slow timer tick.
+ *
+ * A normal priority pcb gets twice the bytes it moved in one RTT at the rate
+ * of the last tick (receive and send side separately), grows only, and
+ * falls back to TCP_WND_MIN after TCP_WND_IDLE_TICKS without traffic.
+ * Receive caps of all pcbs together stay within TCP_WND_BUDGET, each send
+ * cap leaves TCP_WND_MIN of TCP_SND_BUF to every other pcb.
+ */
+void
+tcp_wnd_tune(struct tcp_pcb *pcb)
+{
+  u32_t used, rcv_limit, snd_limit, rcv, snd, rtt;
+  u8_t others;
+
+  used = tcp_wnd_used(pcb, &others);
+  rcv_limit = (used + TCP_WND_MIN < TCP_WND_BUDGET) ? LWIP_MIN(TCP_WND_BUDGET - used, TCP_WND) : TCP_WND_MIN;
+  snd_limit = ((u32_t)(others + 1) * TCP_WND_MIN < TCP_SND_BUF) ? (TCP_SND_BUF - (u32_t)others * TCP_WND_MIN) : TCP_WND_MIN;
+
+  switch (pcb->wnd_prio) {
+  case TCP_WND_PRIO_LOW:
+    rcv = snd = TCP_WND_MIN;
+    break;
+  case TCP_WND_PRIO_HIGH:
+    rcv = rcv_limit;
+    snd = snd_limit;
+    break;
+  default:
+    rcv = pcb->rcv_wnd_tgt;
+    snd = pcb->snd_buf_max;
+    if ((pcb->tune_rcvd == 0) && (pcb->tune_acked == 0)) {
+      if (pcb->tune_idle < TCP_WND_IDLE_TICKS) {
+        pcb->tune_idle++;
+      } else {
+        rcv = snd = TCP_WND_MIN;
+        tcp_wnd_retract(pcb);
+      }
+    } else {
+      pcb->tune_idle = 0;
+      rtt = pcb->tune_rtt ? LWIP_MIN(pcb->tune_rtt, 4 * TCP_SLOW_INTERVAL) : TCP_WND_RTT_DEFAULT;
+      /* bytes per ms times RTT, kept in u32_t for any rate the MAC can do */
+      rcv = LWIP_MAX(rcv, 2 * (pcb->tune_rcvd / TCP_SLOW_INTERVAL) * rtt);
+      snd = LWIP_MAX(snd, 2 * (pcb->tune_acked / TCP_SLOW_INTERVAL) * rtt);
+    }
+    rcv = LWIP_MIN(LWIP_MAX(rcv, TCP_WND_MIN), rcv_limit);
+    snd = LWIP_MIN(LWIP_MAX(snd, TCP_WND_MIN), snd_limit);
+    break;
+  }
+  pcb->tune_rcvd = 0;
+  pcb->tune_acked = 0;
+  tcp_wnd_set(pcb, rcv, snd);
+}
+
+/**
+ * Feed an RTT sample (ms) to the estimate. Smaller samples are taken at
+ * once, larger ones are averaged in.
+ */
+void
+tcp_wnd_tune_rtt(struct tcp_pcb *pcb, u32_t rtt)
+{
+  if (rtt == 0) {
+    rtt = 1;
+  }
+  if ((pcb->tune_rtt == 0) || (rtt < pcb->tune_rtt)) {
+    pcb->tune_rtt = rtt;
+  } else {
+    pcb->tune_rtt = (7 * pcb->tune_rtt + rtt) / 8;
+  }
+}
+
+/**
+ * RTT seen by the receiver, for connections that do not send: the time
+ * until data beyond the right edge announced at the start of the sample
+ * arrives. The peer may only send it after our next ACK, so it is a round
+ * trip and not the length of the burst in flight. Called for in-sequence
+ * data.
+ */
+void
+tcp_wnd_tune_rcv(struct tcp_pcb *pcb)
+{
+  u32_t now = sys_now();
+
+  if (pcb->tune_rcv_stamp == 0) {
+    pcb->tune_rcv_stamp = now | 1;
+    pcb->tune_rcv_seq = pcb->rcv_ann_right_edge;
+  } else if (TCP_SEQ_GT(pcb->rcv_nxt, pcb->tune_rcv_seq)) {
+    tcp_wnd_tune_rtt(pcb, now - pcb->tune_rcv_stamp);
+    pcb->tune_rcv_stamp = 0;
+  }
+}
+
+/**
+ * @ingroup tcp_raw
+ * Set the window priority of a pcb (TCP_WND_PRIO_xxx). Low and high pin
+ * the caps at TCP_WND_MIN and at the largest share of the budget, normal
+ * sizes them from RTT and throughput.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param prio TCP_WND_PRIO_LOW, TCP_WND_PRIO_NORMAL or TCP_WND_PRIO_HIGH
+ */
+void
+tcp_set_wnd_prio(struct tcp_pcb *pcb, u8_t prio)
+{
+  LWIP_ASSERT("don't call tcp_set_wnd_prio for listen-pcbs",
+    pcb->state != LISTEN);
+
+  pcb->wnd_prio = prio;
+  pcb->tune_idle = 0;
+  tcp_wnd_tune(pcb);
+}
+#endif /* TCP_WND_AUTOTUNE */
+
 /**
  * Allocate a new local TCP port.
  *
@@ -982,7 +1213,11 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   pcb->snd_lbb = iss - 1;
   /* Start with a window that does not need scaling. When window scaling is
      enabled and used, the window is enlarged when both sides agree on scaling. */
+#if TCP_WND_AUTOTUNE
+  pcb->rcv_wnd = pcb->rcv_ann_wnd = pcb->rcv_wnd_max;
+#else
   pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
+#endif
   pcb->rcv_ann_right_edge = pcb->rcv_nxt;
   pcb->snd_wnd = TCP_WND;
   /* As initial send MSS, we use TCP_MSS but limit it to 536.
@@ -1226,6 +1461,12 @@ tcp_slowtmr_start:
       prev = pcb;
       pcb = pcb->next;
 
+#if TCP_WND_AUTOTUNE
+      if ((prev->state == ESTABLISHED) || (prev->state == CLOSE_WAIT)) {
+        tcp_wnd_tune(prev);
+      }
+#endif /* TCP_WND_AUTOTUNE */
+
       /* We check if we should poll the connection. */
       ++prev->polltmr;
       if (prev->polltmr >= prev->pollinterval) {
@@ -1654,10 +1895,14 @@ tcp_alloc(u8_t prio)
     /* zero out the whole pcb, so there is no need to initialize members to zero */
     memset(pcb, 0, sizeof(struct tcp_pcb));
     pcb->prio = prio;
+#if TCP_WND_AUTOTUNE
+    tcp_wnd_tune_init(pcb);
+#else
     pcb->snd_buf = TCP_SND_BUF;
     /* Start with a window that does not need scaling. When window scaling is
        enabled and used, the window is enlarged when both sides agree on scaling. */
     pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND);
+#endif
     pcb->ttl = TCP_TTL;
     /* As initial send MSS, we use TCP_MSS but limit it to 536.
        The send MSS is updated when an MSS option is received. */
@@ -1897,10 +2142,10 @@ tcp_pcb_purge(struct tcp_pcb *pcb)
     pcb->unsent_oversize = 0;
 #endif /* TCP_OVERSIZE */
 #if SNDBUF_SHARE
-	if(pcb->snd_buf < TCP_SND_BUF)
+	if(pcb->snd_buf < TCP_SND_BUF_MAX(pcb))
 	{
-		sndbuf_len += (TCP_SND_BUF - pcb->snd_buf);
-		pcb->snd_buf = TCP_SND_BUF;
+		sndbuf_len += (TCP_SND_BUF_MAX(pcb) - pcb->snd_buf);
+		pcb->snd_buf = TCP_SND_BUF_MAX(pcb);
 	}
 #endif
   }
@@ -53,6 +53,7 @@
 #include "lwip/memp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
+#include "lwip/sys.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #if LWIP_ND6_TCP_REACHABILITY_HINTS
@@ -1249,6 +1250,9 @@ tcp_receive(struct tcp_pcb *pcb)
 #if SNDBUF_SHARE	  
 	sndbuf_len += recv_acked;
 #endif	  
+#if TCP_WND_AUTOTUNE
+    pcb->tune_acked += recv_acked;
+#endif
     /* End of ACK for new data processing. */
 
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: pcb->rttest %"U32_F" rtseq %"U32_F" ackno %"U32_F"\n",
@@ -1261,6 +1265,9 @@ tcp_receive(struct tcp_pcb *pcb)
       /* diff between this shouldn't exceed 32K since this are tcp timer ticks
          and a round-trip shouldn't be that long... */
       m = (s16_t)(tcp_ticks - pcb->rttest);
+#if TCP_WND_AUTOTUNE
+      tcp_wnd_tune_rtt(pcb, sys_now() - pcb->tune_snd_stamp);
+#endif
 
       LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: experienced rtt %"U16_F" ticks (%"U16_F" msec).\n",
                                   m, (u16_t)(m * TCP_SLOW_INTERVAL)));
@@ -1534,6 +1541,10 @@ tcp_receive(struct tcp_pcb *pcb)
 #endif /* TCP_QUEUE_OOSEQ */
 
 
+#if TCP_WND_AUTOTUNE
+        tcp_wnd_tune_rcv(pcb);
+#endif
+
         /* Acknowledge the segment(s). */
         tcp_ack(pcb);
 
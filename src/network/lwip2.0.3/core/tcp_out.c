@@ -52,7 +52,7 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
-#if LWIP_TCP_TIMESTAMPS
+#if LWIP_TCP_TIMESTAMPS || TCP_WND_AUTOTUNE
 #include "lwip/sys.h"
 #endif
 
@@ -319,7 +319,11 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
 
   /* fail on too much data */
 #if SNDBUF_SHARE
-    if(len > sndbuf_len){
+    if((len > sndbuf_len)
+#if TCP_WND_AUTOTUNE
+       || (len > pcb->snd_buf)
+#endif
+      ){
 	LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"TCPWNDSIZE_F")\n",
       len, sndbuf_len));
 #else  
@@ -1264,6 +1268,9 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   if (pcb->rttest == 0) {
     pcb->rttest = tcp_ticks;
     pcb->rtseq = lwip_ntohl(seg->tcphdr->seqno);
+#if TCP_WND_AUTOTUNE
+    pcb->tune_snd_stamp = sys_now();
+#endif
 
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_output_segment: rtseq %"U32_F"\n", pcb->rtseq));
   }
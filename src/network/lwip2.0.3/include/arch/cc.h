@@ -3,6 +3,7 @@
 #define CC_H_INCLUDED
 
 #include <stdio.h>
+#include "wm_config.h"
 
 /* Define platform endianness */
 #define BYTE_ORDER LITTLE_ENDIAN
@@ -55,8 +56,13 @@ typedef u32_t mem_ptr_t;
 /* define LWIP_COMPAT_MUTEX
     to let sys.h use binary semaphores instead of mutexes - as before in 1.3.2
     Refer CHANGELOG
+    The tcpip core lock needs a real mutex, sys_arch.c has them on FreeRTOS.
 */
+#if TLS_CONFIG_LWIP_CORE_LOCKING
+#define  LWIP_COMPAT_MUTEX  0
+#else
 #define  LWIP_COMPAT_MUTEX  1
+#endif
 
 #ifndef LWIP_PLATFORM_ASSERT
 #define LWIP_PLATFORM_ASSERT(x) \
@@ -25,6 +25,9 @@
 
 typedef tls_os_sem_t * sys_sem_t;
 typedef tls_os_queue_t * sys_mbox_t;
+#if TLS_CONFIG_LWIP_CORE_LOCKING
+typedef tls_os_mutex_t * sys_mutex_t;
+#endif
 typedef u8_t sys_thread_t;
 
 typedef unsigned long int sys_prot_t;
@@ -40,6 +40,12 @@ extern "C"{
 #define NAPT_ICMP_ID_RANGE_END       0xFFFF
 
 
+/* napt hash buckets per table: 1 << NAPT_HASH_BITS */
+#define NAPT_HASH_BITS               6
+
+/* napt age timer wheel slots, power of 2 */
+#define NAPT_WHEEL_SLOTS             16
+
 /* napt table size */
 //#define NAPT_TABLE_LIMIT
 #ifdef  NAPT_TABLE_LIMIT
@@ -48,7 +54,7 @@ extern "C"{
 /* ============================================================ */
 
 
-#define NAPT_TMR_INTERVAL            ((NAPT_TABLE_TIMEOUT / 2) * 1000UL)
+#define NAPT_TMR_INTERVAL            ((NAPT_TABLE_TIMEOUT * 1000UL) / NAPT_WHEEL_SLOTS)
 
 extern bool alg_napt_port_is_used(u16 port);
 
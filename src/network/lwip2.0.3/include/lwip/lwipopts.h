@@ -12,8 +12,13 @@
  * instead of the lwip internal allocator. Can save code size if you
  * already use it.
  */
+#if TLS_CONFIG_LWIP_POOLS
+#define MEM_LIBC_MALLOC                 0
+#define MEMP_MEM_MALLOC                 0
+#else
 #define MEM_LIBC_MALLOC                 1
 #define MEMP_MEM_MALLOC                 1
+#endif
 #define MEM_USE_POOLS                   0
 #define MEMP_USE_CUSTOM_POOLS           0
 
@@ -27,8 +32,13 @@
 /**
  * TCP_WND: The size of a TCP window.  This must be at least 
  * (2 * TCP_MSS) for things to work well
+ * With TCP_WND_AUTOTUNE it is the ceiling of a single connection.
  */
+#if TLS_CONFIG_TCP_WND_AUTOTUNE
+#define TCP_WND                         (12 * TCP_MSS)
+#else
 #define TCP_WND                         (6 * TCP_MSS)
+#endif
 
 /**
  * TCP_MSS: TCP Maximum segment size. (default is 536, a conservative default,
@@ -63,10 +73,21 @@
 #define TCPIP_MBOX_SIZE               64 
 
 /**
- * LWIP_TCPIP_CORE_LOCKING: (EXPERIMENTAL!)
- * Don't use it if you're not an active lwIP project member
+ * LWIP_TCPIP_CORE_LOCKING: socket and tls_netconn calls run in the calling
+ * task under the tcpip core lock instead of messaging the tcpip thread
+ */
+#define LWIP_TCPIP_CORE_LOCKING         TLS_CONFIG_LWIP_CORE_LOCKING
+
+/**
+ * TCP_WND_AUTOTUNE: size the receive window and the send buffer of each
+ * connection from its RTT and throughput. TCP_WND_BUDGET bounds the sum of
+ * the receive windows, TCP_SND_BUF stays the shared send pool.
  */
-#define LWIP_TCPIP_CORE_LOCKING         0
+#define TCP_WND_AUTOTUNE                TLS_CONFIG_TCP_WND_AUTOTUNE
+#if TCP_WND_AUTOTUNE
+#define TCP_WND_BUDGET                  (16 * TCP_MSS)
+#define TCP_WND_MIN                     (2 * TCP_MSS)
+#endif
 
 /**
  * LWIP_TCPIP_CORE_LOCKING_INPUT: (EXPERIMENTAL!)
@@ -116,4 +137,36 @@
 #define LWIP_NETIF_HOSTNAME             1
 #define LWIP_TCP_KEEPALIVE              1
 
+/* word-wise checksum, and checksum while copying tcp/udp payload */
+#define LWIP_CHKSUM_ALGORITHM           4
+#define LWIP_CHECKSUM_ON_COPY           1
+#define LWIP_CHKSUM_COPY_ALGORITHM      2
+
+#if TLS_CONFIG_LWIP_POOLS
+/**
+ * Fixed pools per object type. MEM_SIZE is then the lwIP heap, used only
+ * for PBUF_RAM (tx data). Received frames go to PBUF_POOL, a pool buffer
+ * holds a whole ethernet frame. AT+LWMEM prints the usage of each pool,
+ * size the numbers from its high-water marks.
+ */
+#define MEMP_NUM_PBUF                   16
+#define MEMP_NUM_RAW_PCB                4
+#define MEMP_NUM_UDP_PCB                8
+#define MEMP_NUM_TCP_PCB                8
+#define MEMP_NUM_TCP_PCB_LISTEN         4
+#define MEMP_NUM_REASSDATA              4
+#define MEMP_NUM_FRAG_PBUF              8
+#define MEMP_NUM_ARP_QUEUE              8
+#define MEMP_NUM_NETBUF                 8
+#define MEMP_NUM_NETDB                  2
+#define MEMP_NUM_TCPIP_MSG_API          8
+#define MEMP_NUM_TCPIP_MSG_INPKT        (PBUF_POOL_SIZE + 4)
+/* dhcp server, coap, the tls_dns resolver and the ntp client run their own timeouts */
+#define MEMP_NUM_SYS_TIMEOUT            (LWIP_TCP + IP_REASSEMBLY + LWIP_ARP + (2*LWIP_DHCP) + LWIP_AUTOIP + LWIP_IGMP + LWIP_DNS + (LWIP_IPV6 ? (1 + LWIP_IPV6_REASS + LWIP_IPV6_MLD) : 0) + 4 + TLS_CONFIG_DNS_RESOLVER + (3 * TLS_CONFIG_NTP))
+#define PBUF_POOL_SIZE                  12
+#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(1514 + PBUF_LINK_ENCAPSULATION_HLEN)
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+#endif
+
 #endif /* end of __LWIP_OPTS_H */
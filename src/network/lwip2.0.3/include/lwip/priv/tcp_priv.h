@@ -85,6 +85,32 @@ void             tcp_rexmit_fast (struct tcp_pcb *pcb);
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 
+#if TCP_WND_AUTOTUNE
+#ifndef TCP_WND_BUDGET
+#define TCP_WND_BUDGET           (2 * TCP_WND)
+#endif
+#ifndef TCP_WND_MIN
+#define TCP_WND_MIN              (2 * TCP_MSS)
+#endif
+/* caps of a new connection, before any RTT sample */
+#ifndef TCP_WND_INIT
+#define TCP_WND_INIT             (4 * TCP_MSS)
+#endif
+/* slow timer ticks without traffic before a connection gives its caps back */
+#ifndef TCP_WND_IDLE_TICKS
+#define TCP_WND_IDLE_TICKS       10
+#endif
+/* RTT assumed (ms) until the first sample */
+#ifndef TCP_WND_RTT_DEFAULT
+#define TCP_WND_RTT_DEFAULT      100
+#endif
+
+void             tcp_wnd_tune_init(struct tcp_pcb *pcb);
+void             tcp_wnd_tune(struct tcp_pcb *pcb);
+void             tcp_wnd_tune_rtt(struct tcp_pcb *pcb, u32_t rtt);
+void             tcp_wnd_tune_rcv(struct tcp_pcb *pcb);
+#endif /* TCP_WND_AUTOTUNE */
+
 /**
  * This is the Nagle algorithm: try to combine user data to send as few TCP
  * segments as possible. Only send if
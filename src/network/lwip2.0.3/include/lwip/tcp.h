@@ -145,6 +145,29 @@ typedef u32_t tcpwnd_size_t;
 typedef u16_t tcpwnd_size_t;
 #endif
 
+#ifndef TCP_WND_AUTOTUNE
+#define TCP_WND_AUTOTUNE        0
+#endif
+#if TCP_WND_AUTOTUNE
+/* the receive window and send buffer of each pcb are capped separately */
+#undef TCP_WND_MAX
+#define TCP_WND_MAX(pcb)        ((pcb)->rcv_wnd_max)
+#define TCP_SND_BUF_MAX(pcb)    ((pcb)->snd_buf_max)
+/* half the cap, TCP_SNDLOWAT is above TCP_WND_MIN and would never be reached */
+#define TCP_SNDLOWAT_PCB(pcb)   ((pcb)->snd_buf_max / 2)
+/* a quarter of the cap at most, a small window never opens that far */
+#define TCP_WND_UPDATE_THRESHOLD_PCB(pcb) LWIP_MIN((pcb)->rcv_wnd_max / 4, TCP_WND_UPDATE_THRESHOLD)
+#else
+#define TCP_SND_BUF_MAX(pcb)    TCP_SND_BUF
+#define TCP_SNDLOWAT_PCB(pcb)   TCP_SNDLOWAT
+#define TCP_WND_UPDATE_THRESHOLD_PCB(pcb) TCP_WND_UPDATE_THRESHOLD
+#endif
+
+/** Window priorities for tcp_set_wnd_prio() */
+#define TCP_WND_PRIO_LOW        0  /* pinned at TCP_WND_MIN */
+#define TCP_WND_PRIO_NORMAL     1  /* sized from RTT and throughput */
+#define TCP_WND_PRIO_HIGH       2  /* pinned at the largest share of the budget */
+
 #if LWIP_WND_SCALE || TCP_LISTEN_BACKLOG || LWIP_TCP_TIMESTAMPS
 typedef u16_t tcpflags_t;
 #else
@@ -327,6 +350,20 @@ struct tcp_pcb {
   u8_t snd_scale;
   u8_t rcv_scale;
 #endif
+
+#if TCP_WND_AUTOTUNE
+  tcpwnd_size_t rcv_wnd_max; /* current receive window cap */
+  tcpwnd_size_t rcv_wnd_tgt; /* cap being approached as the application reads */
+  tcpwnd_size_t snd_buf_max; /* current send buffer cap */
+  u8_t wnd_prio;             /* TCP_WND_PRIO_xxx */
+  u8_t tune_idle;            /* slow timer ticks without traffic */
+  u32_t tune_rcvd;           /* bytes read by the application this tick */
+  u32_t tune_acked;          /* bytes acknowledged by the peer this tick */
+  u32_t tune_rtt;            /* smoothed RTT in ms, 0 = no sample yet */
+  u32_t tune_snd_stamp;      /* sys_now() when rtseq was sent */
+  u32_t tune_rcv_stamp;      /* sys_now() when rcv_nxt reached the receiver sample start */
+  u32_t tune_rcv_seq;        /* rcv_nxt that ends the receiver RTT sample */
+#endif /* TCP_WND_AUTOTUNE */
 };
 
 #if LWIP_EVENT_API
@@ -370,7 +407,11 @@ void             tcp_poll    (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interv
 #endif /* LWIP_TCP_TIMESTAMPS */
 #if SNDBUF_SHARE
 extern s32 sndbuf_len;
+#if TCP_WND_AUTOTUNE
+#define          tcp_sndbuf(pcb)          (TCPWND16(LWIP_MIN(sndbuf_len, (s32)(pcb)->snd_buf)))
+#else
 #define          tcp_sndbuf(pcb)          (TCPWND16(sndbuf_len))
+#endif
 #else
 #define          tcp_sndbuf(pcb)          (TCPWND16((pcb)->snd_buf))
 #endif
@@ -396,6 +437,9 @@ void             tcp_backlog_accepted(struct tcp_pcb* pcb);
 #define          tcp_accepted(pcb) /* compatibility define, not needed any more */
 
 void             tcp_recved  (struct tcp_pcb *pcb, u16_t len);
+#if TCP_WND_AUTOTUNE
+void             tcp_set_wnd_prio(struct tcp_pcb *pcb, u8_t prio);
+#endif
 err_t            tcp_bind    (struct tcp_pcb *pcb, const ip_addr_t *ipaddr,
                               u16_t port);
 err_t            tcp_connect (struct tcp_pcb *pcb, const ip_addr_t *ipaddr,
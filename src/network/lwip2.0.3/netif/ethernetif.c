@@ -238,7 +238,11 @@ static struct pbuf *low_level_input(struct netif *netif, u8 *buf, u32 buf_len)
 #endif
 
     /* We allocate a pbuf chain of pbufs from the pool. */
+#if TLS_CONFIG_LWIP_POOLS
+    p = pbuf_alloc(PBUF_RAW, s_len, PBUF_POOL);
+#else
     p = pbuf_alloc(PBUF_RAW, s_len, PBUF_RAM);
+#endif
 
     if (p != NULL) {
 #if ETH_PAD_SIZE
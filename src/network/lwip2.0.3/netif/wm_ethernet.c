@@ -58,6 +58,9 @@
 #include "lwip/alg.h"
 #include "tls_wireless.h"
 #endif
+#if TLS_CONFIG_DNS_RESOLVER
+#include "wm_dns.h"
+#endif
 #if TLS_CONFIG_SOCKET_RAW
 #include "tls_netconn.h"
 #endif
@@ -185,6 +188,9 @@ struct netif *Tcpip_stack_init()
 	
     /* Setup lwIP. */
     tcpip_init(NULL, NULL);
+#if TLS_CONFIG_DNS_RESOLVER
+    tls_dns_init();
+#endif
 
 #if TLS_CONFIG_AP
     /* add net info for apsta's ap */
@@ -302,6 +308,20 @@ err_t tls_dhcp_start(void)
     return netifapi_dhcp_start(nif);
 }
 
+static ip4_addr_t dhcp_reboot_lease;
+
+static err_t tls_dhcp_reboot_fn(struct netif *netif)
+{
+    return dhcp_start_reboot(netif, &dhcp_reboot_lease);
+}
+
+err_t tls_dhcp_start_reboot(u32 ipaddr)
+{
+    ip4_addr_set_u32(&dhcp_reboot_lease, ipaddr);
+
+    return netifapi_netif_common(nif, NULL, tls_dhcp_reboot_fn);
+}
+
 err_t tls_dhcp_stop(void)
 {
     return netifapi_dhcp_stop(nif);
@@ -397,6 +417,14 @@ void tls_dnss_stop(void)
 {
     DNSS_Stop();
 }
+INT8S tls_dnss_add_name(INT8U * DnsName)
+{
+    return DNSS_AddName(DnsName);
+}
+INT8S tls_dnss_del_name(INT8U * DnsName)
+{
+    return DNSS_DelName(DnsName);
+}
 ip_addr_t *tls_dhcps_getip(const u8_t *mac)
 {
 	return DHCPS_GetIpByMac(mac);
@@ -439,3 +467,47 @@ struct netif *tls_get_netif(void)
     return nif;
 }
 
+#if TLS_CONFIG_LWIP_POOLS
+static const char * const tls_memp_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc) desc,
+#include "lwip/priv/memp_std.h"
+};
+
+int tls_netif_mem_report(char *buf, int len)
+{
+    char line[64];
+    int i, pos, line_len;
+    u32 total = MEM_SIZE;
+
+    if ((NULL == buf) || (len <= 0))
+        return 0;
+    buf[0] = '\0';
+
+    for (i = 0; i < MEMP_MAX; i++)
+        total += (u32)memp_pools[i]->num * memp_pools[i]->size;
+
+    pos = sprintf(line, "%u,%u,%u,%u,%u", total, MEM_SIZE,
+                  (u32)lwip_stats.mem.used, (u32)lwip_stats.mem.max,
+                  (u32)lwip_stats.mem.err);
+    if (pos >= len)
+        pos = 0;
+    else
+        memcpy(buf, line, pos + 1);
+
+    for (i = 0; (i < MEMP_MAX) && pos; i++)
+    {
+        line_len = sprintf(line, "\r\n%s,%hu,%hu,%u,%u,%u", tls_memp_names[i],
+                           memp_pools[i]->size, memp_pools[i]->num,
+                           (u32)lwip_stats.memp[i]->used,
+                           (u32)lwip_stats.memp[i]->max,
+                           (u32)lwip_stats.memp[i]->err);
+        if (pos + line_len >= len)
+            break;
+        memcpy(buf + pos, line, line_len + 1);
+        pos += line_len;
+    }
+
+    return pos;
+}
+#endif
+
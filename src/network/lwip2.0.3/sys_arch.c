@@ -154,6 +154,87 @@ void sys_sem_set_invalid(sys_sem_t *sem)
 }
 #endif
 
+#if !LWIP_COMPAT_MUTEX
+/**
+ * \brief Creates a new mutex, it has priority inheritance.
+ *
+ * \param mutex Pointer to the mutex.
+ *
+ * \return ERR_OK for OK, ERR_MEM on error.
+ */
+err_t sys_mutex_new(sys_mutex_t *mutex)
+{
+	if (mutex == NULL)
+		return ERR_MEM;
+
+	if (tls_os_mutex_create(0, mutex) != TLS_OS_SUCCESS) {
+		*mutex = NULL;
+		return ERR_MEM;
+	}
+#if SYS_STATS
+	lwip_stats.sys.mutex.used++;
+	if (lwip_stats.sys.mutex.used > lwip_stats.sys.mutex.max) {
+		lwip_stats.sys.mutex.max = lwip_stats.sys.mutex.used;
+	}
+#endif /* SYS_STATS */
+	return ERR_OK;
+}
+
+/**
+ * \brief Locks a mutex, waits as long as it takes.
+ *
+ * \param mutex Pointer to the mutex.
+ */
+void sys_mutex_lock(sys_mutex_t *mutex)
+{
+	tls_os_mutex_acquire(*mutex, 0);
+}
+
+/**
+ * \brief Unlocks a mutex locked by the same task.
+ *
+ * \param mutex Pointer to the mutex.
+ */
+void sys_mutex_unlock(sys_mutex_t *mutex)
+{
+	tls_os_mutex_release(*mutex);
+}
+
+/**
+ * \brief Frees a mutex created by sys_mutex_new.
+ *
+ * \param mutex Pointer to the mutex.
+ */
+void sys_mutex_free(sys_mutex_t *mutex)
+{
+	if (*mutex != NULL) {
+		tls_os_mutex_delete(*mutex);
+#if SYS_STATS
+		lwip_stats.sys.mutex.used--;
+#endif /* SYS_STATS */
+	}
+	*mutex = NULL;
+}
+
+/**
+ * \brief Check if a mutex is valid/allocated.
+ *
+ * \return 1 on valid, 0 for invalid.
+ */
+int sys_mutex_valid(sys_mutex_t *mutex)
+{
+	return *mutex != NULL;
+}
+
+/**
+ * \brief Set a mutex invalid.
+ */
+void sys_mutex_set_invalid(sys_mutex_t *mutex)
+{
+	*mutex = NULL;
+}
+#endif /* !LWIP_COMPAT_MUTEX */
+
 /**
  * \brief Creates an empty mailbox for maximum "size" elements. Elements stored
  * in mailboxes are pointers. 
@@ -254,13 +335,19 @@ err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
     if(msg == NULL ) 
         msg = (void*)null_pointer;  
 
+#if LWIP_TCPIP_CORE_LOCKING
+    /* the caller may hold the core lock: one try, sleeping would stall every task */
+    i = 9;
+#endif
+
     /* try 10 times */
     while (i < 10){
        // err = OSQPost(mbox, msg);
 	err = tls_os_queue_send(*mbox, msg, 0);
         if(err == TLS_OS_SUCCESS)
             return ERR_OK;
-        i++;
+        if (++i == 10)
+            break;
         //OSTimeDly(5);
         tls_os_time_delay(1);
     }
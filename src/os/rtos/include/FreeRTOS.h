@@ -439,6 +439,10 @@ extern void vClearInterruptMaskFromISR( int ulMask );
 	#define configGENERATE_RUN_TIME_STATS 0
 #endif
 
+#ifndef configUSE_TICKLESS_IDLE
+	#define configUSE_TICKLESS_IDLE 0
+#endif
+
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
 	#ifndef portCONFIGURE_TIMER_FOR_RUN_TIME_STATS
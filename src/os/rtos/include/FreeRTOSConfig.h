@@ -102,6 +102,25 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil			0
 #define INCLUDE_vTaskDelay				1
 
+/* Per-task run time statistics, the counter is driven by a hardware timer
+owned by the OS adapter layer (see tls_os_task_prof_start). */
+#include "wm_config.h"
+#if TLS_CONFIG_TASK_PROFILE
+#define configGENERATE_RUN_TIME_STATS	1
+extern unsigned long tls_os_task_prof_counter(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()	tls_os_task_prof_counter()
+#endif
+
+/* lwIP's tcpip core lock is a mutex, with priority inheritance. */
+#if TLS_CONFIG_LWIP_CORE_LOCKING
+#define configUSE_MUTEXES				1
+#endif
+
+/* The idle hook stops the tick while every task is blocked (see wm_main.c). */
+#if TLS_CONFIG_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE			1
+#endif
 
 
 #endif /* FREERTOS_CONFIG_H */
@@ -84,6 +84,8 @@ typedef struct QueueDefinition
 	signed portBASE_TYPE xRxLock;			/*< Stores the number of items received from the queue (removed from the queue) while the queue was locked.  Set to queueUNLOCKED when the queue is not locked. */
 	signed portBASE_TYPE xTxLock;			/*< Stores the number of items transmitted to the queue (added to the queue) while the queue was locked.  Set to queueUNLOCKED when the queue is not locked. */
 
+	unsigned char ucStaticallyAllocated;	/*< Set to pdTRUE if the structure was supplied by the caller, so it is not freed when the queue is deleted. */
+
 } xQUEUE;
 
 
@@ -158,6 +160,13 @@ typedef xQUEUE * xQueueHandle;
  */
 
 xQueueHandle xQueueCreateExt( void *QueueStart, unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize );
+/*
+ * Create a queue without using the heap.  Both the item storage (QueueStart,
+ * uxQueueLength * uxItemSize bytes) and the queue structure (pxStaticQueue)
+ * are supplied by the caller and must remain valid until the queue is
+ * deleted.  QueueStart may be NULL when uxItemSize is zero.
+ */
+xQueueHandle xQueueCreateStatic( void *QueueStart, unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, xQUEUE *pxStaticQueue );
 xQueueHandle xQueueCreate( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize );
 
 /**
@@ -1243,6 +1252,8 @@ signed portBASE_TYPE xQueueCRReceive( xQueueHandle pxQueue, void *pvBuffer, port
  */
 xQueueHandle xQueueCreateMutex( void );
 xQueueHandle xQueueCreateCountingSemaphore( unsigned portBASE_TYPE uxCountValue, unsigned portBASE_TYPE uxInitialCount );
+xQueueHandle xQueueCreateMutexStatic( xQUEUE *pxStaticQueue );
+xQueueHandle xQueueCreateCountingSemaphoreStatic( unsigned portBASE_TYPE uxCountValue, unsigned portBASE_TYPE uxInitialCount, xQUEUE *pxStaticQueue );
 
 /*
  * For internal use only.  Use xSemaphoreTakeMutexRecursive() or
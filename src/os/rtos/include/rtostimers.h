@@ -101,6 +101,7 @@ typedef struct tmrTimerControl
 	void 					*pvTimerID;			/*<< An ID to identify the timer.  This allows the timer to be identified when the same callback is used for multiple timers. */
 	tmrTIMER_CALLBACK		pxCallbackFunction;	/*<< The function that will be called when the timer expires. */
 	void 				*callback_arg;			/*added by dave */
+	unsigned char			ucStaticallyAllocated;	/*<< Set to pdTRUE if the structure was supplied by the caller, so it is not freed when the timer is deleted. */
 } xTIMER;
 
 /**
@@ -233,6 +234,11 @@ typedef struct tmrTimerControl
  */
 xTimerHandle xTimerCreate( const signed char *pcTimerName, portTickType xTimerPeriodInTicks, unsigned portBASE_TYPE uxAutoReload, void * pvTimerID, tmrTIMER_CALLBACK pxCallbackFunction ) PRIVILEGED_FUNCTION;
 xTimerHandle xTimerCreateExt( const signed char *pcTimerName, portTickType xTimerPeriodInTicks, unsigned portBASE_TYPE uxAutoReload, void *pvTimerID, tmrTIMER_CALLBACK pxCallbackFunction, void *callback_arg );
+/*
+ * Same as xTimerCreateExt() but the timer structure is supplied by the caller
+ * in pxTimerBuffer and must remain valid until the timer is deleted.
+ */
+xTimerHandle xTimerCreateStatic( const signed char *pcTimerName, portTickType xTimerPeriodInTicks, unsigned portBASE_TYPE uxAutoReload, void *pvTimerID, tmrTIMER_CALLBACK pxCallbackFunction, void *callback_arg, xTIMER *pxTimerBuffer );
 
 /**
  * void *pvTimerGetTimerID( xTimerHandle xTimer );
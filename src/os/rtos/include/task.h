@@ -117,6 +117,60 @@ typedef struct xTASK_PARAMTERS
 	xMemoryRegion xRegions[ portNUM_CONFIGURABLE_REGIONS ];
 } xTaskParameters;
 
+/*
+ * Storage for a task control block supplied by the application, see
+ * xTaskGenericCreateStatic().  The layout mirrors the private tskTCB in
+ * tasks.c and must be kept in step with it; the members are not to be
+ * accessed directly.
+ */
+typedef struct xSTATIC_TCB
+{
+	void *pvDummy1;
+	#if ( portUSING_MPU_WRAPPERS == 1 )
+		xMPU_SETTINGS xDummy2;
+	#endif
+	xListItem xDummy3[ 2 ];
+	unsigned portBASE_TYPE uxDummy4;
+	void *pvDummy5;
+	portSTACK_TYPE uxDummy6;
+	signed char ucDummy7[ configMAX_TASK_NAME_LEN ];
+	#if ( portSTACK_GROWTH > 0 )
+		void *pvDummy8;
+	#endif
+	#if ( portCRITICAL_NESTING_IN_TCB == 1 )
+		unsigned portBASE_TYPE uxDummy9;
+	#endif
+	#if ( configUSE_TRACE_FACILITY == 1 )
+		unsigned portBASE_TYPE uxDummy10;
+	#endif
+	#if ( configUSE_MUTEXES == 1 )
+		unsigned portBASE_TYPE uxDummy11;
+	#endif
+	#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+		void *pvDummy12;
+	#endif
+	#if ( configGENERATE_RUN_TIME_STATS == 1 )
+		unsigned long ulDummy13;
+		unsigned long ulDummy13b;
+	#endif
+	unsigned char ucDummy14;
+} xStaticTCB;
+
+/*
+ * Per-task snapshot filled in by uxTaskGetProfile().  Run time is expressed
+ * in ticks of the run time stats counter, stack figures are in bytes.
+ */
+typedef struct xTASK_PROFILE
+{
+	signed char pcTaskName[ configMAX_TASK_NAME_LEN ];
+	unsigned portBASE_TYPE uxPriority;
+	unsigned long ulRunTimeCounter;
+	unsigned long ulSwitchCounter;
+	unsigned long ulStackSize;
+	unsigned long ulStackFree;				/*< Least amount of stack that has remained free since the task was created. */
+	signed char cStatus;
+} xTaskProfile;
+
 /*
  * Defines the priority used by the idle task.  This must not be modified.
  *
@@ -273,6 +327,7 @@ extern  void freeRtosTickIrqHandler( void );
  */
 #define xTaskCreate( pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask ) xTaskGenericCreate( ( pvTaskCode ), ( pcName ), ( usStackDepth ), ( pvParameters ), ( uxPriority ), ( pxCreatedTask ), ( NULL ), ( NULL ) )
 #define xTaskCreateExt( pvTaskCode, pcName, puxStackBuffer,usStackDepth, pvParameters, uxPriority, pxCreatedTask ) xTaskGenericCreate( ( pvTaskCode ), ( pcName ), ( usStackDepth ), ( pvParameters ), ( uxPriority ), ( pxCreatedTask ), ( puxStackBuffer ), ( NULL ) )
+#define xTaskCreateStatic( pvTaskCode, pcName, puxStackBuffer, usStackDepth, pvParameters, uxPriority, pxCreatedTask, pxTCBBuffer ) xTaskGenericCreateStatic( ( pvTaskCode ), ( pcName ), ( usStackDepth ), ( pvParameters ), ( uxPriority ), ( pxCreatedTask ), ( puxStackBuffer ), ( pxTCBBuffer ) )
 
 /**
  * task. h
@@ -992,6 +1047,43 @@ portTickType xTaskGetTickCount( void ) PRIVILEGED_FUNCTION;
  */
 portTickType xTaskGetTickCountFromISR( void ) PRIVILEGED_FUNCTION;
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+/**
+ * task. h
+ * <PRE>portTickType xTaskGetExpectedIdleTime( void );</PRE>
+ *
+ * Only available when configUSE_TICKLESS_IDLE is 1.  Must be called from the
+ * idle task with the scheduler suspended and interrupts disabled.
+ *
+ * @return The number of ticks until the next delayed task has to be woken, or
+ * 0 if some other task is ready (or about to become ready) so the tick must
+ * not be stopped.
+ *
+ * \page xTaskGetExpectedIdleTime xTaskGetExpectedIdleTime
+ * \ingroup TaskUtils
+ */
+portTickType xTaskGetExpectedIdleTime( void ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <PRE>void vTaskStepTick( portTickType xTicksToJump );</PRE>
+ *
+ * Only available when configUSE_TICKLESS_IDLE is 1.  Accounts for tick
+ * interrupts that were suppressed while the processor slept.  Must be called
+ * with the scheduler suspended; the ticks are replayed by xTaskResumeAll() so
+ * delayed tasks are unblocked and a tick count overflow is handled exactly as
+ * if the ticks had occurred.
+ *
+ * @param xTicksToJump Number of whole tick periods that elapsed.
+ *
+ * \page vTaskStepTick vTaskStepTick
+ * \ingroup TaskUtils
+ */
+void vTaskStepTick( portTickType xTicksToJump ) PRIVILEGED_FUNCTION;
+
+#endif
+
 /**
  * task. h
  * <PRE>unsigned short uxTaskGetNumberOfTasks( void );</PRE>
@@ -1078,6 +1170,35 @@ void vTaskList( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
  */
 void vTaskGetRunTimeStats( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <PRE>unsigned portBASE_TYPE uxTaskGetProfile( xTaskProfile *pxProfile, unsigned portBASE_TYPE uxArraySize, portBASE_TYPE xReset );</PRE>
+ *
+ * configGENERATE_RUN_TIME_STATS must be defined as 1 for this function
+ * to be available.
+ *
+ * Binary counterpart of vTaskGetRunTimeStats().  Copies the name, priority,
+ * state, accumulated run time, context switch count and stack high water
+ * mark of up to uxArraySize tasks into pxProfile.
+ *
+ * NOTE: This function suspends the scheduler and scans every task stack.
+ * It is intended as a debug aid only.
+ *
+ * @param pxProfile Array receiving one entry per task, may be NULL when only
+ * a reset is wanted.
+ *
+ * @param uxArraySize Number of entries available in pxProfile.
+ *
+ * @param xReset If not pdFALSE the run time and switch counters of every task
+ * are cleared once they have been copied out.
+ *
+ * @return The number of entries written to pxProfile.
+ *
+ * \page uxTaskGetProfile uxTaskGetProfile
+ * \ingroup TaskUtils
+ */
+unsigned portBASE_TYPE uxTaskGetProfile( xTaskProfile *pxProfile, unsigned portBASE_TYPE uxArraySize, portBASE_TYPE xReset ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * <PRE>void vTaskStartTrace( char * pcBuffer, unsigned portBASE_TYPE uxBufferSize );</PRE>
@@ -1308,6 +1429,13 @@ void vTaskPriorityDisinherit( xTaskHandle * const pxMutexHolder ) PRIVILEGED_FUN
  */
 signed portBASE_TYPE xTaskGenericCreate( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions ) PRIVILEGED_FUNCTION;
 
+/*
+ * Same as xTaskGenericCreate() but the TCB is supplied by the caller in
+ * pxTCBBuffer, so no heap memory is used.  Both the stack and the TCB must
+ * remain valid until the task is deleted; vTaskDelete() does not free them.
+ */
+signed portBASE_TYPE xTaskGenericCreateStatic( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, xStaticTCB *pxTCBBuffer ) PRIVILEGED_FUNCTION;
+
 #ifdef __cplusplus
 }
 #endif
@@ -279,6 +279,7 @@ xQueueHandle xReturn = NULL;
 				pxNewQueue->uxItemSize = uxItemSize;
 				pxNewQueue->xRxLock = queueUNLOCKED;
 				pxNewQueue->xTxLock = queueUNLOCKED;
+				pxNewQueue->ucStaticallyAllocated = pdFALSE;
 
 				/* Likewise ensure the event queues start with the correct state. */
 				vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
@@ -331,6 +332,7 @@ xQueueHandle xReturn = NULL;
 				pxNewQueue->uxItemSize = uxItemSize;
 				pxNewQueue->xRxLock = queueUNLOCKED;
 				pxNewQueue->xTxLock = queueUNLOCKED;
+				pxNewQueue->ucStaticallyAllocated = pdFALSE;
 
 				/* Likewise ensure the event queues start with the correct state. */
 				vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
@@ -352,6 +354,93 @@ xQueueHandle xReturn = NULL;
 	return xReturn;
 }
 
+/*-----------------------------------------------------------*/
+
+xQueueHandle xQueueCreateStatic( void *QueueStart, unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, xQUEUE *pxStaticQueue )
+{
+xQUEUE *pxNewQueue = pxStaticQueue;
+xQueueHandle xReturn = NULL;
+
+	configASSERT( pxStaticQueue );
+
+	if( ( pxNewQueue != NULL ) && ( uxQueueLength > ( unsigned portBASE_TYPE ) 0 ) &&
+		( ( QueueStart != NULL ) || ( uxItemSize == ( unsigned portBASE_TYPE ) 0 ) ) )
+	{
+		/* A NULL pcHead marks a mutex, so a queue without item storage (a
+		semaphore) points pcHead at its own structure instead. */
+		if( uxItemSize == ( unsigned portBASE_TYPE ) 0 )
+		{
+			pxNewQueue->pcHead = ( signed char * ) pxNewQueue;
+		}
+		else
+		{
+			pxNewQueue->pcHead = ( signed char * ) QueueStart;
+		}
+		pxNewQueue->pcTail = pxNewQueue->pcHead + ( uxQueueLength * uxItemSize );
+		pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
+		pxNewQueue->pcWriteTo = pxNewQueue->pcHead;
+		pxNewQueue->pcReadFrom = pxNewQueue->pcHead + ( ( uxQueueLength - ( unsigned portBASE_TYPE ) 1U ) * uxItemSize );
+		pxNewQueue->uxLength = uxQueueLength;
+		pxNewQueue->uxItemSize = uxItemSize;
+		pxNewQueue->xRxLock = queueUNLOCKED;
+		pxNewQueue->xTxLock = queueUNLOCKED;
+		pxNewQueue->ucStaticallyAllocated = pdTRUE;
+
+		vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
+		vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
+
+		traceQUEUE_CREATE( pxNewQueue );
+		xReturn = pxNewQueue;
+	}
+	else
+	{
+		traceQUEUE_CREATE_FAILED();
+	}
+
+	configASSERT( xReturn );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_MUTEXES == 1 )
+
+	xQueueHandle xQueueCreateMutexStatic( xQUEUE *pxStaticQueue )
+	{
+	xQUEUE *pxNewQueue = pxStaticQueue;
+
+		if( pxNewQueue != NULL )
+		{
+			/* Same initial state as xQueueCreateMutex(). */
+			pxNewQueue->pxMutexHolder = NULL;
+			pxNewQueue->uxQueueType = queueQUEUE_IS_MUTEX;
+			pxNewQueue->pcWriteTo = NULL;
+			pxNewQueue->pcReadFrom = NULL;
+			pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
+			pxNewQueue->uxLength = ( unsigned portBASE_TYPE ) 1U;
+			pxNewQueue->uxItemSize = ( unsigned portBASE_TYPE ) 0U;
+			pxNewQueue->xRxLock = queueUNLOCKED;
+			pxNewQueue->xTxLock = queueUNLOCKED;
+			pxNewQueue->ucStaticallyAllocated = pdTRUE;
+
+			vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
+			vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
+
+			xQueueGenericSend( pxNewQueue, NULL, ( portTickType ) 0U, queueSEND_TO_BACK );
+
+			traceCREATE_MUTEX( pxNewQueue );
+		}
+		else
+		{
+			traceCREATE_MUTEX_FAILED();
+		}
+
+		configASSERT( pxNewQueue );
+		return pxNewQueue;
+	}
+
+#endif /* configUSE_MUTEXES */
+/*-----------------------------------------------------------*/
 
 #if ( configUSE_MUTEXES == 1 )
 
@@ -380,6 +469,7 @@ xQueueHandle xReturn = NULL;
 			pxNewQueue->uxItemSize = ( unsigned portBASE_TYPE ) 0U;
 			pxNewQueue->xRxLock = queueUNLOCKED;
 			pxNewQueue->xTxLock = queueUNLOCKED;
+			pxNewQueue->ucStaticallyAllocated = pdFALSE;
 
 			/* Ensure the event queues start with the correct state. */
 			vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
@@ -514,6 +604,26 @@ xQueueHandle xReturn = NULL;
 		return pxHandle;
 	}
 
+	xQueueHandle xQueueCreateCountingSemaphoreStatic( unsigned portBASE_TYPE uxCountValue, unsigned portBASE_TYPE uxInitialCount, xQUEUE *pxStaticQueue )
+	{
+	xQueueHandle pxHandle;
+
+		pxHandle = xQueueCreateStatic( NULL, ( unsigned portBASE_TYPE ) uxCountValue, queueSEMAPHORE_QUEUE_ITEM_LENGTH, pxStaticQueue );
+
+		if( pxHandle != NULL )
+		{
+			pxHandle->uxMessagesWaiting = uxInitialCount;
+
+			traceCREATE_COUNTING_SEMAPHORE();
+		}
+		else
+		{
+			traceCREATE_COUNTING_SEMAPHORE_FAILED();
+		}
+
+		return pxHandle;
+	}
+
 #endif /* configUSE_COUNTING_SEMAPHORES */
 /*-----------------------------------------------------------*/
 
@@ -1136,6 +1246,11 @@ void vQueueDelete( xQueueHandle pxQueue )
 
 	traceQUEUE_DELETE( pxQueue );
 	vQueueUnregisterQueue( pxQueue );
+	if( pxQueue->ucStaticallyAllocated != pdFALSE )
+	{
+		/* Storage and structure belong to the caller. */
+		return;
+	}
 	vPortFree( pxQueue->pcHead );
 	vPortFree( pxQueue );
 }
@@ -1148,7 +1263,10 @@ void vQueueDeleteExt( xQueueHandle pxQueue )
 	traceQUEUE_DELETE( pxQueue );
 	vQueueUnregisterQueue( pxQueue );
 //	vPortFree( pxQueue->pcHead );	//外部释放
-	vPortFree( pxQueue );
+	if( pxQueue->ucStaticallyAllocated == pdFALSE )
+	{
+		vPortFree( pxQueue );
+	}
 }
 
 /*-----------------------------------------------------------*/
@@ -230,6 +230,7 @@ xTIMER *pxNewTimer;
 			pxNewTimer->pvTimerID = pvTimerID;
 			pxNewTimer->pxCallbackFunction = pxCallbackFunction;
 			pxNewTimer->callback_arg = NULL;		//add by dave
+			pxNewTimer->ucStaticallyAllocated = pdFALSE;
 			vListInitialiseItem( &( pxNewTimer->xTimerListItem ) );
 			
 			traceTIMER_CREATE( pxNewTimer );
@@ -269,6 +270,7 @@ xTIMER *pxNewTimer;
 			pxNewTimer->pvTimerID = pvTimerID;
 			pxNewTimer->pxCallbackFunction = pxCallbackFunction;
 			pxNewTimer->callback_arg = callback_arg;	//add by dave
+			pxNewTimer->ucStaticallyAllocated = pdFALSE;
 			vListInitialiseItem( &( pxNewTimer->xTimerListItem ) );
 			
 			traceTIMER_CREATE( pxNewTimer );
@@ -282,6 +284,37 @@ xTIMER *pxNewTimer;
 	return ( xTimerHandle ) pxNewTimer;
 }
 
+xTimerHandle xTimerCreateStatic( const signed char *pcTimerName, portTickType xTimerPeriodInTicks, unsigned portBASE_TYPE uxAutoReload, void *pvTimerID, tmrTIMER_CALLBACK pxCallbackFunction, void *callback_arg, xTIMER *pxTimerBuffer )
+{
+xTIMER *pxNewTimer = pxTimerBuffer;
+
+	configASSERT( pxTimerBuffer );
+
+	if( ( xTimerPeriodInTicks == ( portTickType ) 0U ) || ( pxNewTimer == NULL ) )
+	{
+		configASSERT( ( xTimerPeriodInTicks > 0 ) );
+		traceTIMER_CREATE_FAILED();
+		return NULL;
+	}
+
+	/* Ensure the infrastructure used by the timer service task has been
+	created/initialised. */
+	prvCheckForValidListAndQueue();
+
+	pxNewTimer->pcTimerName = pcTimerName;
+	pxNewTimer->xTimerPeriodInTicks = xTimerPeriodInTicks;
+	pxNewTimer->uxAutoReload = uxAutoReload;
+	pxNewTimer->pvTimerID = pvTimerID;
+	pxNewTimer->pxCallbackFunction = pxCallbackFunction;
+	pxNewTimer->callback_arg = callback_arg;
+	pxNewTimer->ucStaticallyAllocated = pdTRUE;
+	vListInitialiseItem( &( pxNewTimer->xTimerListItem ) );
+
+	traceTIMER_CREATE( pxNewTimer );
+
+	return ( xTimerHandle ) pxNewTimer;
+}
+
 /*-----------------------------------------------------------*/
 
 portBASE_TYPE xTimerGenericCommand( xTimerHandle xTimer, portBASE_TYPE xCommandID, portTickType xOptionalValue, portBASE_TYPE *pxHigherPriorityTaskWoken, portTickType xBlockTime )
@@ -597,7 +630,10 @@ portTickType xTimeNow;
 			case tmrCOMMAND_DELETE :
 				/* The timer has already been removed from the active list,
 				just free up the memory. */
-				vPortFree( pxTimer );
+				if( pxTimer->ucStaticallyAllocated == pdFALSE )
+				{
+					vPortFree( pxTimer );
+				}
 				break;
 
 			default	:			
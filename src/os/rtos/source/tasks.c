@@ -118,10 +118,16 @@ typedef struct tskTaskControlBlock
 
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
 		unsigned long ulRunTimeCounter;		/*< Used for calculating how much CPU time each task is utilising. */
+		unsigned long ulSwitchCounter;		/*< Number of times the task has been switched in. */
 	#endif
 
+	unsigned char ucStaticallyAllocated;	/*< Set to pdTRUE if the TCB was supplied by the caller, so it is not freed when the task is deleted. */
+
 } tskTCB;
 
+/* xStaticTCB is the public mirror of tskTCB; fail the build if they diverge. */
+typedef char xStaticTCBSizeCheck[ ( sizeof( xStaticTCB ) == sizeof( tskTCB ) ) ? 1 : -1 ];
+
 
 /*
  * Some kernel aware debuggers require data to be viewed to be global, rather
@@ -180,6 +186,7 @@ PRIVILEGED_DATA static portTickType xNextTaskUnblockTime						= ( portTickType )
 	PRIVILEGED_DATA static char pcStatsString[ 50 ] ;
 	PRIVILEGED_DATA static unsigned long ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
 	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, unsigned long ulTotalRunTime ) PRIVILEGED_FUNCTION;
+	static void prvProfileTasksWithinSingleList( xTaskProfile *pxProfile, unsigned portBASE_TYPE uxArraySize, unsigned portBASE_TYPE *puxCount, xList *pxList, signed char cStatus, portBASE_TYPE xReset ) PRIVILEGED_FUNCTION;
 
 #endif
 
@@ -398,7 +405,13 @@ static void prvAddCurrentTaskToDelayedList( portTickType xTimeToWake ) PRIVILEGE
  * Allocates memory from the heap for a TCB and associated stack.  Checks the
  * allocation was successful.
  */
-static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TYPE *puxStackBuffer ) PRIVILEGED_FUNCTION;
+static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TYPE *puxStackBuffer, tskTCB *pxTCBBuffer ) PRIVILEGED_FUNCTION;
+
+/*
+ * Common body of xTaskGenericCreate() and xTaskGenericCreateStatic().  When
+ * pxTCBBuffer is NULL the TCB is allocated from the heap.
+ */
+static signed portBASE_TYPE prvTaskGenericCreate( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions, tskTCB *pxTCBBuffer ) PRIVILEGED_FUNCTION;
 
 /*
  * Called from vTaskList.  vListTasks details all the tasks currently under
@@ -436,6 +449,28 @@ static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TY
  *----------------------------------------------------------*/
 
 signed portBASE_TYPE xTaskGenericCreate( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions )
+{
+	return prvTaskGenericCreate( pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, puxStackBuffer, xRegions, NULL );
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xTaskGenericCreateStatic( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, xStaticTCB *pxTCBBuffer )
+{
+	/* Both the stack and the TCB must be supplied, otherwise use
+	xTaskGenericCreate(). */
+	configASSERT( puxStackBuffer );
+	configASSERT( pxTCBBuffer );
+
+	if( ( puxStackBuffer == NULL ) || ( pxTCBBuffer == NULL ) )
+	{
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
+
+	return prvTaskGenericCreate( pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, puxStackBuffer, NULL, ( tskTCB * ) pxTCBBuffer );
+}
+/*-----------------------------------------------------------*/
+
+static signed portBASE_TYPE prvTaskGenericCreate( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions, tskTCB *pxTCBBuffer )
 {
 signed portBASE_TYPE xReturn;
 tskTCB * pxNewTCB;
@@ -445,7 +480,7 @@ tskTCB * pxNewTCB;
 
 	/* Allocate the memory required by the TCB and stack for the new task,
 	checking that the allocation was successful. */
-	pxNewTCB = prvAllocateTCBAndStack( usStackDepth, puxStackBuffer );
+	pxNewTCB = prvAllocateTCBAndStack( usStackDepth, puxStackBuffer, pxTCBBuffer );
 
 	if( pxNewTCB != NULL )
 	{
@@ -1351,6 +1386,55 @@ unsigned portBASE_TYPE uxSavedInterruptStatus;
 }
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	portTickType xTaskGetExpectedIdleTime( void )
+	{
+	portTickType xReturn;
+
+		configASSERT( uxSchedulerSuspended );
+
+		if( pxCurrentTCB->uxPriority > tskIDLE_PRIORITY )
+		{
+			xReturn = 0;
+		}
+		else if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ tskIDLE_PRIORITY ] ) ) > 1 )
+		{
+			/* Another task shares the idle priority and wants the CPU. */
+			xReturn = 0;
+		}
+		else if( ( listLIST_IS_EMPTY( &xPendingReadyList ) == pdFALSE ) || ( xMissedYield != pdFALSE ) || ( uxMissedTicks > ( unsigned portBASE_TYPE ) 0U ) )
+		{
+			/* Something was readied since the scheduler was suspended. */
+			xReturn = 0;
+		}
+		else if( xTickCount >= xNextTaskUnblockTime )
+		{
+			xReturn = 0;
+		}
+		else
+		{
+			/* xNextTaskUnblockTime is portMAX_DELAY when the delayed list is
+			empty, which conveniently limits the sleep to the next overflow. */
+			xReturn = xNextTaskUnblockTime - xTickCount;
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vTaskStepTick( portTickType xTicksToJump )
+	{
+		configASSERT( uxSchedulerSuspended );
+
+		/* Queue the slept ticks as missed ticks, xTaskResumeAll() then feeds
+		them through vTaskIncrementTick() one at a time. */
+		uxMissedTicks += ( unsigned portBASE_TYPE ) xTicksToJump;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 {
 	/* A critical section is not required because the variables are of type
@@ -1510,6 +1594,71 @@ unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 		xTaskResumeAll();
 	}
 
+	unsigned portBASE_TYPE uxTaskGetProfile( xTaskProfile *pxProfile, unsigned portBASE_TYPE uxArraySize, portBASE_TYPE xReset )
+	{
+	unsigned portBASE_TYPE uxQueue;
+	unsigned portBASE_TYPE uxCount = 0U;
+
+		/* Same walk as vTaskGetRunTimeStats(), but the results are copied
+		out in binary form so the caller decides how to present them.  The
+		stack scan makes this a debug-only call. */
+
+		vTaskSuspendAll();
+		{
+			if( xReset != pdFALSE )
+			{
+				#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+					portALT_GET_RUN_TIME_COUNTER_VALUE( ulTaskSwitchedInTime );
+				#else
+					ulTaskSwitchedInTime = portGET_RUN_TIME_COUNTER_VALUE();
+				#endif
+			}
+
+			uxQueue = uxTopUsedPriority + ( unsigned portBASE_TYPE ) 1U;
+
+			do
+			{
+				uxQueue--;
+
+				if( listLIST_IS_EMPTY( &( pxReadyTasksLists[ uxQueue ] ) ) == pdFALSE )
+				{
+					prvProfileTasksWithinSingleList( pxProfile, uxArraySize, &uxCount, ( xList * ) &( pxReadyTasksLists[ uxQueue ] ), tskREADY_CHAR, xReset );
+				}
+			}while( uxQueue > ( unsigned short ) tskIDLE_PRIORITY );
+
+			if( listLIST_IS_EMPTY( pxDelayedTaskList ) == pdFALSE )
+			{
+				prvProfileTasksWithinSingleList( pxProfile, uxArraySize, &uxCount, ( xList * ) pxDelayedTaskList, tskBLOCKED_CHAR, xReset );
+			}
+
+			if( listLIST_IS_EMPTY( pxOverflowDelayedTaskList ) == pdFALSE )
+			{
+				prvProfileTasksWithinSingleList( pxProfile, uxArraySize, &uxCount, ( xList * ) pxOverflowDelayedTaskList, tskBLOCKED_CHAR, xReset );
+			}
+
+			#if ( INCLUDE_vTaskDelete == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xTasksWaitingTermination ) == pdFALSE )
+				{
+					prvProfileTasksWithinSingleList( pxProfile, uxArraySize, &uxCount, &xTasksWaitingTermination, tskDELETED_CHAR, xReset );
+				}
+			}
+			#endif
+
+			#if ( INCLUDE_vTaskSuspend == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xSuspendedTaskList ) == pdFALSE )
+				{
+					prvProfileTasksWithinSingleList( pxProfile, uxArraySize, &uxCount, &xSuspendedTaskList, tskSUSPENDED_CHAR, xReset );
+				}
+			}
+			#endif
+		}
+		xTaskResumeAll();
+
+		return uxCount;
+	}
+
 #endif
 /*----------------------------------------------------------*/
 
@@ -1775,6 +1924,12 @@ void vTaskSwitchContext( void )
 		
 		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopReadyPriority ] ) );
 		traceTASK_SWITCHED_IN();
+
+		#if ( configGENERATE_RUN_TIME_STATS == 1 )
+		{
+			( pxCurrentTCB->ulSwitchCounter )++;
+		}
+		#endif
 		vWriteTraceToBuffer();
 	}
 }
@@ -2103,6 +2258,7 @@ static void prvInitialiseTCBVariables( tskTCB *pxTCB, const signed char * const
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
 	{
 		pxTCB->ulRunTimeCounter = 0UL;
+		pxTCB->ulSwitchCounter = 0UL;
 	}
 	#endif
 
@@ -2231,16 +2387,29 @@ static void prvAddCurrentTaskToDelayedList( portTickType xTimeToWake )
 }
 /*-----------------------------------------------------------*/
 
-static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TYPE *puxStackBuffer )
+static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TYPE *puxStackBuffer, tskTCB *pxTCBBuffer )
 {
 tskTCB *pxNewTCB;
 
+	if( pxTCBBuffer != NULL )
+	{
+		/* The caller supplied both the TCB and the stack, nothing to allocate. */
+		pxNewTCB = pxTCBBuffer;
+		pxNewTCB->ucStaticallyAllocated = pdTRUE;
+		pxNewTCB->pxStack = puxStackBuffer;
+		pxNewTCB->stacksize = ( size_t ) usStackDepth * sizeof( portSTACK_TYPE );
+		memset( pxNewTCB->pxStack, ( int ) tskSTACK_FILL_BYTE, ( size_t ) usStackDepth * sizeof( portSTACK_TYPE ) );
+		return pxNewTCB;
+	}
+
 	/* Allocate space for the TCB.  Where the memory comes from depends on
 	the implementation of the port malloc function. */
 	pxNewTCB = ( tskTCB * ) pvPortMalloc( sizeof( tskTCB ) );
 
 	if( pxNewTCB != NULL )
 	{
+		pxNewTCB->ucStaticallyAllocated = pdFALSE;
+
 		/* Allocate space for the stack used by the task being created.
 		The base of the stack memory stored in the TCB so the task can
 		be deleted later if required. */
@@ -2465,6 +2634,46 @@ ENDTASK:
 		} while( pxNextTCB != pxFirstTCB );
 	}
 
+	static void prvProfileTasksWithinSingleList( xTaskProfile *pxProfile, unsigned portBASE_TYPE uxArraySize, unsigned portBASE_TYPE *puxCount, xList *pxList, signed char cStatus, portBASE_TYPE xReset )
+	{
+	volatile tskTCB *pxNextTCB, *pxFirstTCB;
+	xTaskProfile *pxEntry;
+
+		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
+		do
+		{
+			listGET_OWNER_OF_NEXT_ENTRY( pxNextTCB, pxList );
+
+			if( ( pxProfile != NULL ) && ( *puxCount < uxArraySize ) )
+			{
+				pxEntry = &( pxProfile[ *puxCount ] );
+				memcpy( pxEntry->pcTaskName, ( const void * ) pxNextTCB->pcTaskName, configMAX_TASK_NAME_LEN );
+				pxEntry->uxPriority = pxNextTCB->uxPriority;
+				pxEntry->cStatus = cStatus;
+				pxEntry->ulRunTimeCounter = pxNextTCB->ulRunTimeCounter;
+				pxEntry->ulSwitchCounter = pxNextTCB->ulSwitchCounter;
+				pxEntry->ulStackSize = ( unsigned long ) pxNextTCB->stacksize;
+				#if ( portSTACK_GROWTH > 0 )
+				{
+					pxEntry->ulStackFree = ( unsigned long ) usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxEndOfStack ) * sizeof( portSTACK_TYPE );
+				}
+				#else
+				{
+					pxEntry->ulStackFree = ( unsigned long ) usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxStack ) * sizeof( portSTACK_TYPE );
+				}
+				#endif
+				( *puxCount )++;
+			}
+
+			if( xReset != pdFALSE )
+			{
+				pxNextTCB->ulRunTimeCounter = 0UL;
+				pxNextTCB->ulSwitchCounter = 0UL;
+			}
+
+		} while( pxNextTCB != pxFirstTCB );
+	}
+
 #endif
 /*-----------------------------------------------------------*/
 
@@ -2522,6 +2731,11 @@ ENDTASK:
 	{
 		/* Free up the memory allocated by the scheduler for the task.  It is up to
 		the task to free any memory allocated at the application level. */
+		if( pxTCB->ucStaticallyAllocated != pdFALSE )
+		{
+			/* Both the TCB and the stack belong to the caller. */
+			return;
+		}
 		vPortFreeAligned( pxTCB->pxStack );
 		vPortFree( pxTCB );
 	}
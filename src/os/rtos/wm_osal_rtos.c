@@ -31,6 +31,29 @@
 #include "FreeRTOSConfig.h"
 #include "wm_osal.h"
 #include "wm_mem.h"
+#if TLS_CONFIG_TASK_PROFILE
+#include <string.h>
+#include "wm_regs.h"
+#include "wm_timer.h"
+#endif
+
+/* The caller storage types in wm_osal.h must be able to hold the kernel objects. */
+typedef char tls_os_task_static_check[(sizeof(tls_os_task_static_t) >= sizeof(xStaticTCB)) ? 1 : -1];
+typedef char tls_os_queue_static_check[(sizeof(tls_os_queue_static_t) >= sizeof(xQUEUE)) ? 1 : -1];
+typedef char tls_os_timer_static_check[(sizeof(tls_os_timer_static_t) >= sizeof(xTIMER)) ? 1 : -1];
+
+static bool tls_os_task_stack_valid(u8 *stk_start, u32 stk_size)
+{
+    if (((u32)stk_start >= TASK_STACK_USING_MEM_UPPER_RANGE) 
+		||(((u32)stk_start + stk_size) >= TASK_STACK_USING_MEM_UPPER_RANGE))
+    {
+    	printf("\nCurrent Stack [0x%8x, 0x%8x) is NOT in VALID STACK range [0x20000000,0x20028000)\n", (u32)stk_start, (u32)(stk_start + stk_size));
+    	printf("Please refer to APIs' manul and modify task stack position!!!\n");
+    	return FALSE;
+    }
+
+    return TRUE;
+}
 /*
 *********************************************************************************************************
 *                                     CREATE A TASK (Extended Version)
@@ -85,11 +108,8 @@ tls_os_status_t tls_os_task_create(tls_os_task_t *task,
     u8 error;
     tls_os_status_t os_status;
 
-    if (((u32)stk_start >= TASK_STACK_USING_MEM_UPPER_RANGE) 
-		||(((u32)stk_start + stk_size) >= TASK_STACK_USING_MEM_UPPER_RANGE))
+    if (!tls_os_task_stack_valid(stk_start, stk_size))
     {
-    	printf("\nCurrent Stack [0x%8x, 0x%8x) is NOT in VALID STACK range [0x20000000,0x20028000)\n", (u32)stk_start, (u32)(stk_start + stk_size));
-    	printf("Please refer to APIs' manul and modify task stack position!!!\n");
     	return TLS_OS_ERROR;
     }
 
@@ -109,6 +129,52 @@ tls_os_status_t tls_os_task_create(tls_os_task_t *task,
     return os_status;
 }
 
+/*
+*********************************************************************************************************
+*                                     CREATE A TASK (Static Version)
+*
+* Description: Same as tls_os_task_create(), but the task control block is taken from 'tcb' instead of
+*              the heap, so creating the task does not allocate any memory.
+*
+* Arguments  : tcb       is the caller storage for the task control block. It must stay valid for the
+*                        lifetime of the task.
+*
+*              others    see tls_os_task_create()
+*
+* Returns    : TLS_OS_SUCCESS             if the function was successful.
+*              TLS_OS_ERROR
+*********************************************************************************************************
+*/
+tls_os_status_t tls_os_task_create_static(tls_os_task_t *task,
+      tls_os_task_static_t *tcb,
+      const char* name,
+      void (*entry)(void* param),
+      void* param,
+      u8 *stk_start,
+      u32 stk_size,
+      u32 prio,
+      u32 flag)
+{
+	u8 error;
+
+	if ((NULL == tcb) || (NULL == stk_start))
+		return TLS_OS_ERROR;
+
+	if (!tls_os_task_stack_valid(stk_start, stk_size))
+		return TLS_OS_ERROR;
+
+	error = xTaskCreateStatic(entry,
+		(const signed char *)name,
+		(portSTACK_TYPE *)stk_start,
+		stk_size/sizeof(u32),
+		param,
+		configMAX_PRIORITIES - prio,
+		task,
+		(xStaticTCB *)tcb);
+
+	return (error == pdTRUE) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 
 /*
 *********************************************************************************************************
@@ -225,6 +291,28 @@ tls_os_status_t tls_os_task_del(u8 prio,void (*freefun)(void))
     return os_status;
 }
 
+/*
+*********************************************************************************************************
+*                            CREATE A MUTUAL EXCLUSION SEMAPHORE (Static Version)
+*
+* Description: Same as tls_os_mutex_create(), but the mutex lives in the caller storage 'mcb'.
+*
+* Returns    : TLS_OS_SUCCESS         if the call was successful.
+*              TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_mutex_create_static(u8 prio,
+        tls_os_mutex_static_t *mcb,
+        tls_os_mutex_t **mutex)
+{
+	if (NULL == mcb)
+		return TLS_OS_ERROR;
+
+	*mutex = xQueueCreateMutexStatic((xQUEUE *)mcb);
+
+    return (*mutex != NULL) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 /*
 *********************************************************************************************************
 *                                          DELETE A MUTEX
@@ -381,6 +469,26 @@ tls_os_status_t tls_os_task_del(u8 prio,void (*freefun)(void))
     return os_status;
 }
 
+/*
+*********************************************************************************************************
+*                                     CREATE A SEMAPHORE (Static Version)
+*
+* Description: Same as tls_os_sem_create(), but the semaphore lives in the caller storage 'scb'.
+*
+* Returns    : TLS_OS_SUCCESS	The call was successful
+*			TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_sem_create_static(tls_os_sem_t **sem, tls_os_sem_static_t *scb, u32 cnt)
+{
+	if (NULL == scb)
+		return TLS_OS_ERROR;
+
+	*sem = xQueueCreateCountingSemaphoreStatic(configSEMAPHORE_INIT_VALUE, cnt, (xQUEUE *)scb);
+
+    return (*sem != NULL) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 
 /*
 *********************************************************************************************************
@@ -538,6 +646,45 @@ tls_os_status_t tls_os_task_del(u8 prio,void (*freefun)(void))
     return os_status;
 }
 
+/*
+*********************************************************************************************************
+*                                  CREATE A MESSAGE QUEUE (Static Version)
+*
+* Description: This function creates a message queue without using the heap.
+*
+* Arguments  : queue	is a pointer to the created queue
+*
+*			qcb		is the caller storage for the queue control block
+*
+*			storage		is the caller storage for the messages, at least queue_size * msg_size bytes
+*
+*              	queue_size          is the number of messages the queue can hold
+*
+*			msg_size		is the size of each message.  0 makes a queue of pointers that is used with
+*						tls_os_queue_send()/tls_os_queue_receive(); any other size makes a queue that
+*						stores messages by copy, used with tls_os_queue_send_copy()/tls_os_queue_receive_copy().
+*
+* Returns    : TLS_OS_SUCCESS
+*			TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_queue_create_static(tls_os_queue_t **queue,
+        tls_os_queue_static_t *qcb,
+        void *storage,
+        u32 queue_size,
+        u32 msg_size)
+{
+	if ((NULL == qcb) || (NULL == storage) || (0 == queue_size))
+		return TLS_OS_ERROR;
+
+	if (0 == msg_size)
+		msg_size = sizeof(void *);
+
+	*queue = xQueueCreateStatic(storage, queue_size, msg_size, (xQUEUE *)qcb);
+
+    return (*queue != NULL) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 /*
 *********************************************************************************************************
 *                                        DELETE A MESSAGE QUEUE
@@ -687,6 +834,91 @@ tls_os_status_t tls_os_queue_flush(tls_os_queue_t *queue)
 	return TLS_OS_SUCCESS;
 }
 
+/*
+*********************************************************************************************************
+*                                     POST MESSAGE TO A QUEUE BY COPY
+*
+* Description: This function copies msg_size bytes from msg into a queue created by
+*              tls_os_queue_create_static() with the same msg_size.
+*
+* Returns    : TLS_OS_SUCCESS
+*			TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_queue_send_copy(tls_os_queue_t *queue,
+        const void *msg,
+        u32 msg_size)
+{
+	u8 error;
+	portBASE_TYPE pxHigherPriorityTaskWoken = pdFALSE;
+	u8 isrcount = 0;
+
+	if (((xQUEUE *)queue)->uxItemSize != msg_size)
+		return TLS_OS_ERROR;
+
+	isrcount = tls_get_isr_count();
+	if(isrcount > 0)
+	{
+		error = xQueueSendFromISR((xQUEUE *) queue, msg, &pxHigherPriorityTaskWoken );
+		if((pdTRUE == pxHigherPriorityTaskWoken) && (1 == isrcount))
+		{
+			portYIELD_FROM_ISR();
+		}
+	}
+	else
+	{
+		error = xQueueSend((xQUEUE *)queue, msg, 0 );
+	}
+
+    return (error == pdPASS) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
+/*
+*********************************************************************************************************
+*                                  PEND ON A QUEUE FOR A MESSAGE BY COPY
+*
+* Description: This function waits for a message and copies it into msg, see tls_os_queue_send_copy().
+*
+* Arguments  : wait_time       0 waits forever, otherwise the timeout in clock ticks
+*
+* Returns    : TLS_OS_SUCCESS
+*			TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_queue_receive_copy(tls_os_queue_t *queue,
+        void *msg,
+        u32 msg_size,
+        u32 wait_time)
+{
+	u8 error;
+	unsigned int xTicksToWait;
+	portBASE_TYPE pxHigherPriorityTaskWoken = pdFALSE;
+	u8 isrcount = 0;
+
+	if (((xQUEUE *)queue)->uxItemSize != msg_size)
+		return TLS_OS_ERROR;
+
+	if(0 == wait_time)
+		xTicksToWait = portMAX_DELAY;
+	else
+		xTicksToWait = wait_time;
+	isrcount = tls_get_isr_count();
+	if(isrcount > 0)
+	{
+		error = xQueueReceiveFromISR((xQUEUE *)queue, msg, &pxHigherPriorityTaskWoken);
+		if((pdTRUE == pxHigherPriorityTaskWoken) && (1 == isrcount))
+		{
+			portYIELD_FROM_ISR();
+		}
+	}
+	else
+	{
+		error = xQueueReceive((xQUEUE *)queue, msg, xTicksToWait );
+	}
+
+    return (error == pdPASS) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 /*
 *********************************************************************************************************
 *                                        CREATE A MESSAGE MAILBOX
@@ -730,6 +962,30 @@ Returns    : TLS_OS_SUCCESS
     return os_status;
 }
 
+/*
+*********************************************************************************************************
+*                                   CREATE A MESSAGE MAILBOX (Static Version)
+*
+* Description: Same as tls_os_mailbox_create(), but the control block and the message storage
+*              (mailbox_size pointers) are supplied by the caller.
+*
+Returns    : TLS_OS_SUCCESS
+*			TLS_OS_ERROR
+*********************************************************************************************************
+*/
+ tls_os_status_t tls_os_mailbox_create_static(tls_os_mailbox_t **mailbox,
+        tls_os_mailbox_static_t *mbcb,
+        void **storage,
+        u32 mailbox_size)
+{
+	if ((NULL == mbcb) || (NULL == storage))
+		return TLS_OS_ERROR;
+
+	*mailbox = xQueueCreateStatic(storage, mailbox_size ? mailbox_size : 1, sizeof(void *), (xQUEUE *)mbcb);
+
+    return (*mailbox != NULL) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 /*
 *********************************************************************************************************
 *                                         DELETE A MAIBOX
@@ -951,6 +1207,37 @@ u32 os_cnter = 0;
 	return os_status;
 }
 
+/*
+************************************************************************************************************************
+*                                            CREATE A TIMER (Static Version)
+*
+* Description: Same as tls_os_timer_create(), but the timer lives in the caller storage 'tcb'.
+*
+*Returns    : TLS_OS_SUCCESS
+*			TLS_OS_ERROR
+************************************************************************************************************************
+*/
+ tls_os_status_t tls_os_timer_create_static(tls_os_timer_t **timer,
+        tls_os_timer_static_t *tcb,
+        TLS_OS_TIMER_CALLBACK callback,
+        void *callback_arg,
+        u32 period,
+        bool repeat,
+        u8 *name)
+{
+	*timer = NULL;
+	if (NULL == tcb)
+		return TLS_OS_ERROR;
+
+	if(0 == period)
+		period = 1;
+#if configUSE_TIMERS
+	*timer = (xTIMER *)xTimerCreateStatic( (signed char *)name, period, repeat, NULL, callback, callback_arg, (xTIMER *)tcb );
+#endif
+
+    return (*timer != NULL) ? TLS_OS_SUCCESS : TLS_OS_ERROR;
+}
+
 /*
 ************************************************************************************************************************
 *                                                   START A TIMER
@@ -1121,6 +1408,168 @@ void tls_os_disp_task_stat_info(void)
 	tls_mem_free(buf);
 	buf = NULL;
 }
+
+#if TLS_CONFIG_TASK_PROFILE
+/*
+*********************************************************************************************************
+*                                       task profiler
+*
+* Description: The kernel run time counter is a hardware timer from wm_timer.c ticking every
+*              TLS_OS_TASK_PROF_TICK_US.  vTaskSwitchContext charges the elapsed ticks to the task
+*              being switched out and counts the switch.  The timer runs at the highest NVIC
+*              priority so it can also sample how often another interrupt handler was active.
+*              While stopped the counter is frozen and the timer raises no interrupt.
+*********************************************************************************************************
+*/
+#define TASK_PROF_MAX_TASKS		24
+
+static volatile u32 task_prof_ticks = 0;
+static volatile u32 task_prof_isr_ticks = 0;
+static u8 task_prof_timer = WM_TIMER_ID_INVALID;
+static u8 task_prof_run = 0;
+
+static void tls_os_task_prof_tick(void *arg)
+{
+	task_prof_ticks++;
+	/* RETTOBASE is clear when another exception was active as this one was taken */
+	if (!(SCB->ICSR & SCB_ICSR_RETTOBASE_Msk))
+		task_prof_isr_ticks++;
+}
+
+unsigned long tls_os_task_prof_counter(void)
+{
+	return task_prof_ticks;
+}
+
+tls_os_status_t tls_os_task_prof_start(void)
+{
+	struct tls_timer_cfg cfg;
+
+	if (WM_TIMER_ID_INVALID == task_prof_timer)
+	{
+		memset(&cfg, 0, sizeof(struct tls_timer_cfg));
+		cfg.unit = TLS_TIMER_UNIT_US;
+		cfg.timeout = TLS_OS_TASK_PROF_TICK_US;
+		cfg.is_repeat = TRUE;
+		cfg.callback = tls_os_task_prof_tick;
+		cfg.arg = NULL;
+		task_prof_timer = tls_timer_create(&cfg);
+		if (WM_TIMER_ID_INVALID == task_prof_timer)
+			return TLS_OS_ERROR;
+		/* the tick handler never calls into the kernel, so it may preempt everything */
+		NVIC_SetPriority((IRQn_Type)(TIMER0_INT + task_prof_timer), 0);
+	}
+
+	tls_timer_stop(task_prof_timer);
+	task_prof_run = 0;
+	task_prof_ticks = 0;
+	task_prof_isr_ticks = 0;
+	uxTaskGetProfile(NULL, 0, pdTRUE);
+	task_prof_run = 1;
+	tls_timer_start(task_prof_timer);
+
+	return TLS_OS_SUCCESS;
+}
+
+void tls_os_task_prof_stop(void)
+{
+	if (WM_TIMER_ID_INVALID == task_prof_timer)
+		return;
+
+	tls_timer_stop(task_prof_timer);
+	task_prof_run = 0;
+}
+
+u8 tls_os_task_prof_running(void)
+{
+	return task_prof_run;
+}
+
+int tls_os_task_prof_get(struct tls_os_task_prof_info *info, int max, u32 *total, u32 *isr)
+{
+	xTaskProfile *prof;
+	int i, n;
+
+	if ((NULL == info) || (max <= 0))
+		return 0;
+
+	prof = tls_mem_alloc(sizeof(xTaskProfile) * max);
+	if (NULL == prof)
+		return 0;
+
+	n = (int)uxTaskGetProfile(prof, (unsigned portBASE_TYPE)max, pdFALSE);
+	if (total)
+		*total = task_prof_ticks;
+	if (isr)
+		*isr = task_prof_isr_ticks;
+
+	for (i = 0; i < n; i++)
+	{
+		memset(info[i].name, 0, sizeof(info[i].name));
+		memcpy(info[i].name, prof[i].pcTaskName, TLS_OS_TASK_PROF_NAME_LEN);
+		info[i].state    = (char)prof[i].cStatus;
+		info[i].prio     = (u8)(configMAX_PRIORITIES - prof[i].uxPriority);
+		info[i].run_time = prof[i].ulRunTimeCounter;
+		info[i].switches = prof[i].ulSwitchCounter;
+		info[i].stk_size = prof[i].ulStackSize;
+		info[i].stk_free = prof[i].ulStackFree;
+	}
+
+	tls_mem_free(prof);
+
+	return n;
+}
+
+static u32 tls_os_task_prof_permille(u32 part, u32 total)
+{
+	if (0 == total)
+		return 0;
+
+	return (u32)(((u64)part * 1000) / total);
+}
+
+int tls_os_task_prof_report(char *buf, int len)
+{
+	struct tls_os_task_prof_info *info;
+	u32 total = 0, isr = 0;
+	char line[64];
+	int i, n, pos, line_len;
+
+	if ((NULL == buf) || (len <= 0))
+		return 0;
+	buf[0] = '\0';
+
+	info = tls_mem_alloc(sizeof(struct tls_os_task_prof_info) * TASK_PROF_MAX_TASKS);
+	if (NULL == info)
+		return 0;
+
+	n = tls_os_task_prof_get(info, TASK_PROF_MAX_TASKS, &total, &isr);
+
+	pos = sprintf(line, "%hhu,%u,%u", task_prof_run,
+	              total / (1000 / TLS_OS_TASK_PROF_TICK_US),
+	              tls_os_task_prof_permille(isr, total));
+	if (pos >= len)
+		pos = 0;
+	else
+		memcpy(buf, line, pos + 1);
+
+	for (i = 0; (i < n) && pos; i++)
+	{
+		line_len = sprintf(line, "\r\n%s,%hhu,%c,%u,%u,%u,%u",
+		                   info[i].name, info[i].prio, info[i].state,
+		                   tls_os_task_prof_permille(info[i].run_time, total),
+		                   info[i].switches, info[i].stk_free, info[i].stk_size);
+		if (pos + line_len >= len)
+			break;
+		memcpy(buf + pos, line, line_len + 1);
+		pos += line_len;
+	}
+
+	tls_mem_free(info);
+
+	return pos;
+}
+#endif
 /*
 *********************************************************************************************************
 *                                     OS INIT function
@@ -0,0 +1,269 @@
+/*
+ * CoAP observe fan-out over the loopback: hundreds of observers, each a UDP
+ * socket of its own, registered on one resource that changes every round.
+ * Compares the GET handler run for every observer against
+ * COAP_RESOURCE_FLAGS_NOTIFY_SHARED, where it runs once and the encoded
+ * notification is copied with each observer's token. Every observer must
+ * receive its notification, with its token and the same payload.
+ *
+ * libcoap is built WITH_POSIX; the send path below is what coap_io.c would
+ * be on a POSIX system. The observers' ACKs to the confirmable notifications
+ * are not modelled, the retransmission queue is dropped after each round.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "../../src/app/libcoap/address.c"
+#include "../../src/app/libcoap/coap_time.c"
+#include "../../src/app/libcoap/debug.c"
+#include "../../src/app/libcoap/encode.c"
+#include "../../src/app/libcoap/hashkey.c"
+#include "../../src/app/libcoap/mem_libcoap.c"
+#include "../../src/app/libcoap/net.c"
+#include "../../src/app/libcoap/option.c"
+#include "../../src/app/libcoap/pdu.c"
+#include "../../src/app/libcoap/resource.c"
+#include "../../src/app/libcoap/str.c"
+#include "../../src/app/libcoap/subscribe.c"
+#include "../../src/app/libcoap/uri_libcoap.c"
+#include "../../src/app/libcoap/async.c"
+#include "../../src/app/libcoap/block.c"
+
+#define MAX_OBSERVERS   1000
+#define TOKEN_LEN       4
+
+static long allocs;
+static long alloc_bytes;
+
+void *mem_alloc_debug(u32 size)
+{
+    allocs++;
+    alloc_bytes += size;
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+/* the POSIX network interface of libcoap, on host UDP sockets */
+coap_endpoint_t *coap_new_endpoint(const coap_address_t *addr, int flags)
+{
+    coap_endpoint_t *ep;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return NULL;
+    if (bind(fd, &addr->addr.sa, addr->size) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    ep = calloc(1, sizeof(*ep));
+    ep->handle.fd = fd;
+    ep->addr = *addr;
+    ep->flags = flags;
+    return ep;
+}
+
+void coap_free_endpoint(coap_endpoint_t *ep)
+{
+    if (ep)
+    {
+        close(ep->handle.fd);
+        free(ep);
+    }
+}
+
+coap_ssize_t coap_network_send(struct coap_context_t *context,
+                               const coap_endpoint_t *local_interface,
+                               const coap_address_t *dst,
+                               unsigned char *data, size_t datalen)
+{
+    (void)context;
+    return sendto(local_interface->handle.fd, data, datalen, 0,
+                  &dst->addr.sa, dst->size);
+}
+
+coap_ssize_t coap_network_read(coap_endpoint_t *ep, coap_packet_t **packet)
+{
+    (void)ep;
+    *packet = NULL;
+    return -1;
+}
+
+void coap_free_packet(coap_packet_t *packet)
+{
+    (void)packet;
+}
+
+void coap_packet_populate_endpoint(coap_packet_t *packet, coap_endpoint_t *target)
+{
+    (void)packet;
+    (void)target;
+}
+
+void coap_packet_copy_source(coap_packet_t *packet, coap_address_t *target)
+{
+    (void)packet;
+    (void)target;
+}
+
+void coap_packet_get_memmapped(coap_packet_t *packet, unsigned char **address,
+                               size_t *length)
+{
+    (void)packet;
+    *address = NULL;
+    *length = 0;
+}
+
+typedef struct {
+    int fd;
+    coap_address_t addr;
+    unsigned char token[TOKEN_LEN];
+} observer_t;
+
+static observer_t observers[MAX_OBSERVERS];
+static char reading[64];
+static int reading_len;
+static long handler_calls;
+
+/* a sensor reading as JSON, what an observable resource typically serves */
+static void hnd_get(coap_context_t *ctx, coap_resource_t *resource,
+                    const coap_endpoint_t *local_interface, coap_address_t *peer,
+                    coap_pdu_t *request, str *token, coap_pdu_t *response)
+{
+    unsigned char buf[4];
+
+    (void)resource;
+    (void)local_interface;
+    (void)peer;
+    (void)request;
+    (void)token;
+    handler_calls++;
+    response->hdr->code = COAP_RESPONSE_CODE(205);
+    coap_add_option(response, COAP_OPTION_OBSERVE,
+                    coap_encode_var_bytes(buf, ctx->observe), buf);
+    coap_add_option(response, COAP_OPTION_CONTENT_FORMAT,
+                    coap_encode_var_bytes(buf, COAP_MEDIATYPE_APPLICATION_JSON), buf);
+    coap_add_data(response, reading_len, (unsigned char *)reading);
+}
+
+/* every observer must have exactly one notification with its own token */
+static int receive_all(int count)
+{
+    unsigned char msg[COAP_MAX_PDU_SIZE];
+    unsigned char *payload;
+    int bad = 0;
+    int len;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        /* header, token, options, payload marker and the reading */
+        len = recv(observers[i].fd, msg, sizeof(msg), MSG_DONTWAIT);
+        payload = msg + len - reading_len;
+        if (len <= 4 + TOKEN_LEN + reading_len || (msg[0] & 0x0F) != TOKEN_LEN ||
+            memcmp(msg + 4, observers[i].token, TOKEN_LEN) != 0 ||
+            payload[-1] != COAP_PAYLOAD_START ||
+            memcmp(payload, reading, reading_len) != 0)
+            bad++;
+        if (recv(observers[i].fd, msg, sizeof(msg), MSG_DONTWAIT) > 0)
+            bad++;
+    }
+    return bad;
+}
+
+static int run(int count, int shared)
+{
+    coap_address_t listen_addr;
+    coap_context_t *ctx;
+    coap_resource_t *r;
+    socklen_t alen;
+    str token;
+    uint64_t t0, ns = 0;
+    long rounds, n;
+    long notifications;
+    int bad = 0;
+    int i;
+
+    coap_address_init(&listen_addr);
+    listen_addr.addr.sin.sin_family = AF_INET;
+    listen_addr.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listen_addr.size = sizeof(struct sockaddr_in);
+    ctx = coap_new_context(&listen_addr);
+    if (ctx == NULL)
+        return 1;
+
+    r = coap_resource_init((unsigned char *)"sensor", 6,
+                           shared ? COAP_RESOURCE_FLAGS_NOTIFY_SHARED : 0);
+    coap_register_handler(r, COAP_REQUEST_GET, hnd_get);
+    r->observable = 1;
+    coap_add_resource(ctx, r);
+
+    for (i = 0; i < count; i++)
+    {
+        observers[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+        coap_address_init(&observers[i].addr);
+        observers[i].addr.addr.sin.sin_family = AF_INET;
+        observers[i].addr.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        observers[i].addr.size = sizeof(struct sockaddr_in);
+        if (observers[i].fd < 0 ||
+            bind(observers[i].fd, &observers[i].addr.addr.sa, observers[i].addr.size) < 0)
+            return 1;
+        alen = sizeof(observers[i].addr.addr.sin);
+        getsockname(observers[i].fd, &observers[i].addr.addr.sa, &alen);
+        memcpy(observers[i].token, &i, TOKEN_LEN);
+        token.length = TOKEN_LEN;
+        token.s = observers[i].token;
+        if (coap_add_observer(r, ctx->endpoint, &observers[i].addr, &token) == NULL)
+            return 1;
+    }
+
+    rounds = 200000 / count;
+    handler_calls = 0;
+    allocs = 0;
+    alloc_bytes = 0;
+    for (n = 0; n < rounds; n++)
+    {
+        reading_len = snprintf(reading, sizeof(reading),
+                               "{\"temp\":%d.%d,\"hum\":%d,\"seq\":%ld}",
+                               20 + (int)(n % 5), (int)(n % 10), 40 + (int)(n % 20), n);
+        r->dirty = 1;
+        t0 = ht_now_ns();
+        coap_check_notify(ctx);
+        ns += ht_now_ns() - t0;
+
+        coap_delete_all(ctx->sendqueue);
+        ctx->sendqueue = NULL;
+        bad += receive_all(count);
+    }
+
+    notifications = rounds * count;
+    printf("%-12s %5d observers %9.0f notifications/s %5.2f handler calls %6.0f heap bytes/notification%s\n",
+           shared ? "shared" : "per observer", count, notifications * 1e9 / ns,
+           (double)handler_calls / notifications, (double)alloc_bytes / notifications,
+           bad ? " LOST OR WRONG" : "");
+
+    for (i = 0; i < count; i++)
+        close(observers[i].fd);
+    coap_free_context(ctx);
+    return bad != 0;
+}
+
+int main(void)
+{
+    static const int counts[] = {100, 300, 1000};
+    unsigned i;
+    int failed = 0;
+
+    coap_set_log_level(LOG_EMERG);
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    {
+        failed |= run(counts[i], 0);
+        failed |= run(counts[i], 1);
+    }
+    return failed;
+}
@@ -0,0 +1,244 @@
+/*
+ * Small packet throughput of the BSD sockets over the lwIP loopback
+ * interface, with the tcpip core lock (TLS_CONFIG_LWIP_CORE_LOCKING, this
+ * program) and with each call posted to the tcpip thread as a message
+ * (bench_core_locking_msg, the same source built with the option off).
+ *
+ * 64 byte UDP datagrams and 64 byte TCP writes (TCP_NODELAY) from one task
+ * to another, every thread on one cpu as on the target. The stack runs on
+ * sys_arch.c of the tree, so the core lock is a real sys_mutex. All data
+ * sent over TCP must arrive in order.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/sys_arch.c"
+#include "../../src/network/lwip2.0.3/api/tcpip.c"
+#include "../../src/network/lwip2.0.3/api/sockets.c"
+#include "../../src/network/lwip2.0.3/api/api_lib.c"
+#include "../../src/network/lwip2.0.3/api/api_msg.c"
+#include "../../src/network/lwip2.0.3/api/netbuf.c"
+#include "../../src/network/lwip2.0.3/api/err.c"
+#include "../../src/network/lwip2.0.3/core/init.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include "../../src/network/lwip2.0.3/core/dns.c"
+#include "../../src/network/lwip2.0.3/core/inet_chksum.c"
+#include "../../src/network/lwip2.0.3/core/ip.c"
+#include "../../src/network/lwip2.0.3/core/mem.c"
+#include "../../src/network/lwip2.0.3/core/memp.c"
+#include "../../src/network/lwip2.0.3/core/netif.c"
+#include "../../src/network/lwip2.0.3/core/pbuf.c"
+#include "../../src/network/lwip2.0.3/core/raw.c"
+#include "../../src/network/lwip2.0.3/core/stats.c"
+#include "../../src/network/lwip2.0.3/core/sys.c"
+#include "../../src/network/lwip2.0.3/core/tcp.c"
+#include "../../src/network/lwip2.0.3/core/tcp_in.c"
+#include "../../src/network/lwip2.0.3/core/tcp_out.c"
+#include "../../src/network/lwip2.0.3/core/timeouts.c"
+#include "../../src/network/lwip2.0.3/core/udp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/dhcp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/etharp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/icmp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/igmp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4_addr.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4_frag.c"
+#include "../../src/network/lwip2.0.3/netif/ethernet.c"
+#include "lwip_host.h"
+
+#define PAYLOAD         64
+#define UDP_PACKETS     200000
+#define TCP_WRITES      200000
+#define UDP_PORT        5001
+#define TCP_PORT        5002
+/*
+ * On the target the reader outranks the writer. Threads on one host cpu have
+ * no priorities: the writer waits while it is this many writes ahead of the
+ * reader, less than the 10 entry recvmbox, else it only measures the drops.
+ */
+#define AHEAD           8
+
+#if LWIP_TCPIP_CORE_LOCKING
+#define MODE            "core lock"
+#else
+#define MODE            "messages"
+#endif
+
+int tls_wl_get_isr_count(void)
+{
+    return 0;
+}
+
+/* no soft AP forwarding, every local port is free */
+bool alg_napt_port_is_used(u16 port)
+{
+    return false;
+}
+
+static volatile long udp_received;
+static volatile int udp_done;
+static volatile long tcp_received;
+static volatile int tcp_in_order = 1;
+static sys_sem_t rx_done;
+
+static void loopback(struct sockaddr_in *addr, u16_t port)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_len = sizeof(*addr);
+    addr->sin_family = AF_INET;
+    addr->sin_port = lwip_htons(port);
+    addr->sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+}
+
+/* a lost datagram never comes, so the wait is two ticks at most */
+static void pace(long written, volatile long *read, long unit)
+{
+    u32 t0 = tls_os_get_time();
+
+    while (written - *read > AHEAD * unit && tls_os_get_time() - t0 < 2)
+        sched_yield();
+}
+
+static void udp_rx_task(void *arg)
+{
+    int s = (int)(long)arg;
+    u8_t buf[PAYLOAD];
+    int len;
+
+    for (;;)
+    {
+        len = lwip_recv(s, buf, sizeof(buf), 0);
+        if (len == 1)
+            break;
+        if (len == PAYLOAD)
+            udp_received++;
+    }
+    udp_done = 1;
+    sys_sem_signal(&rx_done);
+}
+
+static void bench_udp(void)
+{
+    struct sockaddr_in addr;
+    u8_t buf[PAYLOAD];
+    uint64_t t0, send_ns, total_ns;
+    int rx, tx;
+    int n;
+
+    loopback(&addr, UDP_PORT);
+    rx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    tx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    HT_CHECK(rx >= 0 && tx >= 0);
+    HT_CHECK_EQ(lwip_bind(rx, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    tls_os_task_create(NULL, "udp_rx", udp_rx_task, (void *)(long)rx, NULL, 0, 0, 0);
+
+    memset(buf, 0x5A, sizeof(buf));
+    t0 = ht_now_ns();
+    for (n = 0; n < UDP_PACKETS; n++)
+    {
+        if (lwip_sendto(tx, buf, PAYLOAD, 0, (struct sockaddr *)&addr, sizeof(addr)) != PAYLOAD)
+            break;
+        pace(n + 1, &udp_received, 1);
+    }
+    send_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, UDP_PACKETS);
+
+    /* the end marker, again until it gets through a full mailbox */
+    while (!udp_done)
+    {
+        lwip_sendto(tx, buf, 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+        tls_os_time_delay(1);
+    }
+    sys_arch_sem_wait(&rx_done, 0);
+    total_ns = ht_now_ns() - t0;
+
+    printf("%-9s  udp %d bytes  sendto %7.0f calls/s  received %7.0f packets/s (%ld of %d)\n",
+           MODE, PAYLOAD, UDP_PACKETS * 1e9 / send_ns, udp_received * 1e9 / total_ns,
+           udp_received, UDP_PACKETS);
+    HT_CHECK(udp_received > 0);
+    lwip_close(rx);
+    lwip_close(tx);
+}
+
+static void tcp_rx_task(void *arg)
+{
+    int l = (int)(long)arg;
+    u8_t buf[1024];
+    int s;
+    int len;
+    int i;
+
+    s = lwip_accept(l, NULL, NULL);
+    for (;;)
+    {
+        len = lwip_recv(s, buf, sizeof(buf), 0);
+        if (len <= 0)
+            break;
+        for (i = 0; i < len; i++)
+        {
+            if (buf[i] != (u8_t)((tcp_received + i) / PAYLOAD))
+                tcp_in_order = 0;
+        }
+        tcp_received += len;
+    }
+    lwip_close(s);
+    sys_sem_signal(&rx_done);
+}
+
+static void bench_tcp(void)
+{
+    struct sockaddr_in addr;
+    u8_t buf[PAYLOAD];
+    uint64_t t0, send_ns, total_ns;
+    int one = 1;
+    int l, s;
+    int n;
+
+    loopback(&addr, TCP_PORT);
+    l = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    HT_CHECK_EQ(lwip_bind(l, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    HT_CHECK_EQ(lwip_listen(l, 1), 0);
+    tls_os_task_create(NULL, "tcp_rx", tcp_rx_task, (void *)(long)l, NULL, 0, 0, 0);
+
+    s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    HT_CHECK_EQ(lwip_connect(s, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    lwip_setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    t0 = ht_now_ns();
+    for (n = 0; n < TCP_WRITES; n++)
+    {
+        memset(buf, (u8_t)n, sizeof(buf));
+        if (lwip_send(s, buf, PAYLOAD, 0) != PAYLOAD)
+            break;
+        pace((long)(n + 1) * PAYLOAD, &tcp_received, PAYLOAD);
+    }
+    send_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, TCP_WRITES);
+    lwip_close(s);
+    sys_arch_sem_wait(&rx_done, 0);
+    total_ns = ht_now_ns() - t0;
+
+    printf("%-9s  tcp %d bytes  send   %7.0f calls/s  received %7.2f MB/s\n",
+           MODE, PAYLOAD, TCP_WRITES * 1e9 / send_ns, tcp_received * 1e3 / total_ns);
+    HT_CHECK_EQ(tcp_received, (long)TCP_WRITES * PAYLOAD);
+    HT_CHECK(tcp_in_order);
+    lwip_close(l);
+}
+
+static void tcpip_ready(void *arg)
+{
+    sys_sem_signal((sys_sem_t *)arg);
+}
+
+int main(void)
+{
+    lwip_host_init();
+    HT_CHECK_EQ(sys_sem_new(&rx_done, 0), ERR_OK);
+    tcpip_init(tcpip_ready, &rx_done);
+    sys_arch_sem_wait(&rx_done, 0);
+#if LWIP_TCPIP_CORE_LOCKING
+    HT_CHECK(sys_mutex_valid(&lock_tcpip_core));
+#endif
+
+    bench_udp();
+    bench_tcp();
+    return ht_done(__FILE__);
+}
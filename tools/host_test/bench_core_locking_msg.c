@@ -0,0 +1,2 @@
+/* bench_core_locking.c with the socket calls posted to the tcpip thread */
+#include "bench_core_locking.c"
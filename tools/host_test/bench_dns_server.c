@@ -0,0 +1,597 @@
+/*
+ * The soft AP DNS server on a replayed captive portal storm: phones asking
+ * for their connectivity check names, in mixed case (0x20 bits), for AAAA
+ * as well as A, names below a wildcard and names of the internet.
+ *
+ * The server of the tree answers its names from the prebuilt replies; the
+ * old server, kept here as scratch_recv(), matched one name and built every
+ * answer in a heap buffer. Time per query and heap allocations per query of
+ * both, then the tree's server with TLS_CONFIG_DNSS_FORWARD and the station
+ * up, the internet names answered from the cache after the first upstream
+ * round trip. Every reply of the tree's server is checked against the query.
+ */
+#include "host_test.h"
+#include "../../src/app/dnsserver/dns_server.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include <ctype.h>
+#include <stdlib.h>
+
+#define TRACE           4096
+#define ROUNDS          500
+#define PHONES          20
+#define AP_IP           0x0104A8C0UL
+#define UPSTREAM_IP     0x08080808UL
+#define UPSTREAM_TTL    300
+#define QUERY_MAX       (DNS_HEADER_LEN + 64 + sizeof(DNS_QUERY))
+
+const unsigned int HZ = 1000;
+const ip_addr_t ip_addr_any = IPADDR4_INIT(IPADDR_ANY);
+
+static const char *const portal_names[] = {
+    "connectivitycheck.gstatic.com", "captive.apple.com"
+};
+static const char *const wild_names[] = {
+    "www.msftconnecttest.com", "ipv6.msftconnecttest.com"
+};
+static const char *const other_names[] = {
+    "mtalk.google.com", "www.google.com", "api.weather.com", "time.apple.com", "graph.facebook.com"
+};
+#define OTHER_NAMES     (sizeof(other_names) / sizeof(other_names[0]))
+
+enum kind { PORTAL, PORTAL_CASE, PORTAL_AAAA, WILD, OTHER };
+
+static struct query {
+    u8 msg[QUERY_MAX];
+    u16 len;
+    u8 kind;
+    u8 other;
+    ip_addr_t addr;
+} trace[TRACE];
+
+static struct netif ap_netif;
+static struct netif sta_netif;
+static ip_addr_t upstream;
+static u32 now;
+
+static long allocs;
+static long replies;
+static long forwarded;
+
+/* what the server sent last, and where */
+static u8 reply[DNSS_CACHE_LEN];
+static u16 reply_len;
+static struct udp_pcb *reply_pcb;
+
+/* the old server's one name */
+static INT8U scratch_name[33] = "connectivitycheck.gstatic.com";
+
+void *mem_alloc_debug(u32 size)
+{
+    allocs++;
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+}
+
+u32 tls_os_get_time(void)
+{
+    return now;
+}
+
+struct netif *tls_get_netif(void)
+{
+    return &sta_netif;
+}
+
+const ip_addr_t *dns_getserver(u8_t numdns)
+{
+    return &upstream;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    return calloc(1, sizeof(struct udp_pcb));
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    struct pbuf *p;
+
+    allocs++;
+    p = malloc(sizeof(*p) + length);
+    if (p)
+    {
+        p->next = NULL;
+        p->payload = p + 1;
+        p->len = p->tot_len = length;
+    }
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    free(p);
+    return 1;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    memcpy(buf->payload, dataptr, len);
+    return ERR_OK;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    if (len > buf->len - offset)
+        len = buf->len - offset;
+    memcpy(dataptr, (u8_t *)buf->payload + offset, len);
+    return len;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    memcpy(reply, p->payload, p->len);
+    reply_len = p->len;
+    reply_pcb = pcb;
+    if (pcb == DnsServer.Upstream)
+        forwarded++;
+    else
+        replies++;
+    return ERR_OK;
+}
+
+static void put16(u8 *p, u16 v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static u16 get16(const u8 *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* "a.bc" to "\1a\2bc\0", upper case for the set bits of case_bits */
+static int name_to_wire(const char *name, u8 *wire, u32 case_bits)
+{
+    u8 *label = wire;
+    int i;
+
+    *label = 0;
+    for (i = 0; name[i]; i++)
+    {
+        if (name[i] == '.')
+        {
+            label = wire + i + 1;
+            *label = 0;
+        }
+        else
+        {
+            wire[i + 1] = (case_bits >> (i & 31)) & 1 ? toupper(name[i]) : name[i];
+            (*label)++;
+        }
+    }
+    wire[i + 1] = 0;
+    return i + 2;
+}
+
+static void make_query(struct query *q, const char *name, u16 type, u32 case_bits)
+{
+    u8 *p = q->msg;
+
+    memset(p, 0, DNS_HEADER_LEN);
+    put16(p, ht_rand());
+    p[2] = DNS_FLAG1_RD;
+    put16(p + 4, 1);
+    p += DNS_HEADER_LEN;
+    p += name_to_wire(name, p, case_bits);
+    put16(p, type);
+    put16(p + 2, DNS_RRCLASS_IN);
+    q->len = p + 4 - q->msg;
+}
+
+/* a storm of captive portal checks, some of it other traffic of the phones */
+static void make_trace(void)
+{
+    struct query *q;
+    u32 r;
+    int i;
+
+    for (i = 0; i < TRACE; i++)
+    {
+        q = &trace[i];
+        r = ht_rand() % 100;
+        q->kind = r < 40 ? PORTAL : r < 55 ? PORTAL_CASE : r < 70 ? PORTAL_AAAA : r < 85 ? WILD : OTHER;
+        switch (q->kind)
+        {
+        case PORTAL:
+            make_query(q, portal_names[ht_rand() % 2], DNS_RRTYPE_A, 0);
+            break;
+        case PORTAL_CASE:
+            make_query(q, portal_names[ht_rand() % 2], DNS_RRTYPE_A, ht_rand() | 1);
+            break;
+        case PORTAL_AAAA:
+            make_query(q, portal_names[ht_rand() % 2], 28, 0);
+            break;
+        case WILD:
+            make_query(q, wild_names[ht_rand() % 2], DNS_RRTYPE_A, 0);
+            break;
+        default:
+            q->other = ht_rand() % OTHER_NAMES;
+            make_query(q, other_names[q->other], DNS_RRTYPE_A, 0);
+            break;
+        }
+        ip_addr_set_ip4_u32(&q->addr, (AP_IP & 0x00FFFFFF) | ((u32)(2 + ht_rand() % PHONES) << 24));
+    }
+}
+
+static struct pbuf *query_pbuf(const struct query *q)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, q->len, PBUF_RAM);
+
+    memcpy(p->payload, q->msg, q->len);
+    return p;
+}
+
+/* the reply of the tree's server to q; up when the station is up and forwarding */
+static void check_reply(const struct query *q, int up)
+{
+    int qlen = q->len - DNS_HEADER_LEN;
+    int answers = q->kind == PORTAL || q->kind == PORTAL_CASE || q->kind == WILD;
+    const u8 *a;
+
+    HT_CHECK(reply_len >= q->len);
+    if (reply_len < q->len)
+        return;
+    HT_CHECK_EQ(get16(reply), get16(q->msg));
+    HT_CHECK(reply[2] & DNS_FLAG1_RESPONSE);
+    HT_CHECK_EQ(get16(reply + 4), 1);
+    /* the question as asked, its case too */
+    HT_CHECK(memcmp(reply + DNS_HEADER_LEN, q->msg + DNS_HEADER_LEN, qlen) == 0);
+
+    if (q->kind == OTHER)
+    {
+        if (up)
+        {
+            HT_CHECK_EQ(reply[3] & DNS_FLAG2_ERR_MASK, DNS_FLAG2_ERR_NONE);
+            HT_CHECK_EQ(get16(reply + 6), 1);
+            HT_CHECK_EQ(reply_len, q->len + DNS_ANSWER_A_LEN);
+            HT_CHECK(memcmp(reply + q->len + 12, &ip_2_ip4(&upstream)->addr, 4) == 0);
+        }
+        else
+        {
+            HT_CHECK_EQ(reply[3] & DNS_FLAG2_ERR_MASK, DNS_FLAG2_ERR_NAME);
+            HT_CHECK_EQ(get16(reply + 6), 0);
+        }
+        return;
+    }
+
+    HT_CHECK_EQ(reply[3] & DNS_FLAG2_ERR_MASK, DNS_FLAG2_ERR_NONE);
+    HT_CHECK_EQ(get16(reply + 6), answers);
+    HT_CHECK_EQ(reply_len, q->len + (answers ? DNS_ANSWER_A_LEN : 0));
+    if (answers && reply_len == q->len + DNS_ANSWER_A_LEN)
+    {
+        a = reply + q->len;
+        HT_CHECK_EQ(get16(a), DNS_NAME_OFFSET | DNS_HEADER_LEN);
+        HT_CHECK_EQ(get16(a + 2), DNS_RRTYPE_A);
+        HT_CHECK_EQ(get16(a + 10), 4);
+        HT_CHECK(memcmp(a + 12, &ip_2_ip4(&ap_netif.ip_addr)->addr, 4) == 0);
+    }
+}
+
+/* an answer from `from` to the query the server forwarded last, for the question of q if not NULL */
+static void upstream_reply(const ip_addr_t *from, const struct query *q)
+{
+    struct pbuf *p;
+    u8 *a;
+
+    HT_CHECK(reply_pcb == DnsServer.Upstream);
+    p = pbuf_alloc(PBUF_TRANSPORT, (q ? q->len : reply_len) + DNS_ANSWER_A_LEN, PBUF_RAM);
+    memcpy(p->payload, q ? q->msg : reply, q ? q->len : reply_len);
+    a = (u8 *)p->payload;
+    memcpy(a, reply, 2);
+    a[2] |= DNS_FLAG1_RESPONSE;
+    a[3] = DNS_FLAG2_RA;
+    put16(a + 6, 1);
+    a += q ? q->len : reply_len;
+    put16(a, DNS_NAME_OFFSET | DNS_HEADER_LEN);
+    put16(a + 2, DNS_RRTYPE_A);
+    put16(a + 4, DNS_RRCLASS_IN);
+    put16(a + 6, 0);
+    put16(a + 8, UPSTREAM_TTL);
+    put16(a + 10, 4);
+    memcpy(a + 12, &upstream, 4);
+    _DnsUpstreamRecv(NULL, DnsServer.Upstream, p, from, DNS_SERVER_PORT);
+}
+
+/* the upstream server answers the query the server forwarded last */
+static void upstream_answer(void)
+{
+    upstream_reply(&upstream, NULL);
+}
+
+/* the old server: one name, compared byte for byte, the reply built in a heap buffer */
+static INT32S scratch_compare(INT8U * MyDns, INT8U * Query)
+{
+    INT8U n;
+
+    if ((strlen((const char *)Query) - 1) > 32)
+        return 1;
+    do
+    {
+        n = *Query++;
+        if ((n & 0xc0) == 0xc0)
+            break;
+        while (n > 0)
+        {
+            if ((*MyDns) != (*Query))
+                return 1;
+            ++Query;
+            ++MyDns;
+            --n;
+        }
+        ++MyDns;
+    } while (*Query != 0);
+    return ((*(--MyDns) == 0) ? 0 : 1);
+}
+
+static void scratch_send(ip_addr_t *Addr, INT16U Port, PDNS_QUERY pDnsQuery, INT8U * QueryName,
+                         INT16U TansactionId, int answer)
+{
+    INT32U NameLen = strlen((const char *)QueryName) + 1;
+    INT32U Len = ((DNS_HEADER_LEN + NameLen + sizeof(DNS_QUERY) + DNS_ANSWER_A_LEN + 3) >> 2) << 2;
+    INT32U ServerIpAddr;
+    PDNS_HEADER pDnsHeader;
+    DNS_ANSWER DnsAnswer;
+    struct pbuf * pDnsBuf;
+    INT8U * pDnsReply;
+    INT8U * Body;
+    INT16U Tmp;
+
+    pDnsReply = tls_mem_alloc(Len);
+    if (pDnsReply == NULL)
+        return;
+    pDnsHeader = (PDNS_HEADER)pDnsReply;
+    Body = (INT8U *)(pDnsHeader + 1);
+    pDnsHeader->TansactionId = TansactionId;
+    pDnsHeader->DnsFlag1 = DNS_FLAG1_RESPONSE;
+    pDnsHeader->DnsFlag2 = answer ? DNS_FLAG2_ERR_NONE : DNS_FLAG2_ERR_NAME;
+    pDnsHeader->Quentions = htons(1);
+    pDnsHeader->AnswerRR = answer ? htons(1) : 0;
+    pDnsHeader->AuthorityRR = 0;
+    pDnsHeader->AdditionalRR = 0;
+    MEMCPY(Body, QueryName, NameLen);
+    Body += NameLen;
+    MEMCPY(Body, pDnsQuery, sizeof(DNS_QUERY));
+    Body += sizeof(DNS_QUERY);
+    Len = DNS_HEADER_LEN + NameLen + sizeof(DNS_QUERY);
+    if (answer)
+    {
+        Tmp = htons(DNS_NAME_OFFSET | DNS_HEADER_LEN);
+        MEMCPY(Body, &Tmp, sizeof(INT16U));
+        Body += sizeof(INT16U);
+        DnsAnswer.Type = htons(DNS_RRTYPE_A);
+        DnsAnswer.Class = htons(DNS_RRCLASS_IN);
+        DnsAnswer.Ttl = htonl(DNS_DEFAULT_TTL);
+        MEMCPY(Body, &DnsAnswer, sizeof(DNS_ANSWER));
+        Body += sizeof(DNS_ANSWER);
+        Tmp = htons(4);
+        MEMCPY(Body, &Tmp, sizeof(INT16U));
+        Body += sizeof(INT16U);
+        ServerIpAddr = ip_addr_get_ip4_u32(&DnsServer.HostIp);
+        MEMCPY(Body, &ServerIpAddr, 4);
+        Len += DNS_ANSWER_A_LEN;
+    }
+
+    pDnsBuf = pbuf_alloc(PBUF_TRANSPORT, Len, PBUF_RAM);
+    if (pDnsBuf)
+    {
+        pbuf_take(pDnsBuf, pDnsReply, Len);
+        udp_sendto(DnsServer.Socket, pDnsBuf, Addr, Port);
+        pbuf_free(pDnsBuf);
+    }
+    tls_mem_free(pDnsReply);
+}
+
+static void scratch_recv(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Addr, INT16U Port)
+{
+    PDNS_HEADER pDnsHeader;
+    DNS_QUERY DnsQuery;
+    INT8U * pDnsName;
+    INT8U * pDnsMsg;
+
+    do
+    {
+        pDnsMsg = tls_mem_alloc(P->tot_len);
+        if (pDnsMsg == NULL)
+            break;
+        pbuf_copy_partial(P, pDnsMsg, P->tot_len, 0);
+        pDnsHeader = (PDNS_HEADER)pDnsMsg;
+        if ((pDnsHeader->DnsFlag1 & DNS_FLAG1_RESPONSE) ||
+            ((pDnsHeader->DnsFlag1 & (0xf << 3)) != DNS_FLAG1_OPCODE_STANDARD))
+            break;
+        pDnsName = (INT8U *)(pDnsHeader + 1);
+        MEMCPY(&DnsQuery, (pDnsName + strlen((const char *)pDnsName) + 1), sizeof(DnsQuery));
+        if ((DnsQuery.Class != htons(DNS_RRCLASS_IN)) && (DnsQuery.Type != htons(DNS_RRTYPE_A)))
+            break;
+        scratch_send(Addr, Port, &DnsQuery, pDnsName, pDnsHeader->TansactionId,
+                     scratch_compare(scratch_name, pDnsName) == 0);
+    } while (0);
+
+    if (pDnsMsg)
+        tls_mem_free(pDnsMsg);
+    pbuf_free(P);
+}
+
+typedef void (*recv_fn)(void *Arg, struct udp_pcb *Pcb, struct pbuf *P, ip_addr_t *Addr, INT16U Port);
+
+/* the trace ROUNDS times; the pbufs of the queries are made outside the clock */
+static void replay(const char *name, recv_fn recv)
+{
+    static struct pbuf *pbufs[TRACE];
+    uint64_t ns = 0, t0;
+    long a0, r0;
+    int round, i;
+
+    a0 = allocs;
+    r0 = replies;
+    for (round = 0; round < ROUNDS; round++)
+    {
+        for (i = 0; i < TRACE; i++)
+            pbufs[i] = query_pbuf(&trace[i]);
+        a0 += TRACE;
+        t0 = ht_now_ns();
+        for (i = 0; i < TRACE; i++)
+            recv(NULL, DnsServer.Socket, pbufs[i], &trace[i].addr, 5353);
+        ns += ht_now_ns() - t0;
+    }
+    printf("%-26s %6.1f ns/query  %7.2f Mqueries/s  %.2f allocs/query  %ld of %d replied\n",
+           name, (double)ns / ((long)ROUNDS * TRACE), (double)ROUNDS * TRACE * 1e3 / ns,
+           (double)(allocs - a0) / ((long)ROUNDS * TRACE), (replies - r0) / ROUNDS, TRACE);
+}
+
+/* one pass with every reply checked, the station up or down */
+static void check_trace(int up)
+{
+    long f0 = forwarded;
+    int seen[OTHER_NAMES] = {0};
+    struct query *q;
+    long r;
+    int i;
+
+    for (i = 0; i < TRACE; i++)
+    {
+        q = &trace[i];
+        r = replies;
+        DNSS_RecvCb(NULL, DnsServer.Socket, query_pbuf(q), &q->addr, 5353);
+        if (up && q->kind == OTHER && reply_pcb == DnsServer.Upstream && replies == r)
+        {
+            /* a name not in the cache goes upstream once */
+            HT_CHECK(!seen[q->other]);
+            seen[q->other] = 1;
+            upstream_answer();
+        }
+        HT_CHECK_EQ(replies, r + 1);
+        check_reply(q, up);
+    }
+    if (up)
+        HT_CHECK(forwarded - f0 <= (long)OTHER_NAMES);
+    else
+        HT_CHECK_EQ(forwarded, f0);
+}
+
+#if TLS_CONFIG_DNSS_FORWARD
+/* the cache keeps an answer no longer than DNSS_CACHE_TTL_MAX */
+static void check_cache_expiry(void)
+{
+    long f0 = forwarded;
+    int i;
+
+    now += DNSS_CACHE_TTL_MAX * HZ;
+    for (i = 0; i < TRACE && trace[i].kind != OTHER; i++)
+        ;
+    DNSS_RecvCb(NULL, DnsServer.Socket, query_pbuf(&trace[i]), &trace[i].addr, 5353);
+    HT_CHECK_EQ(forwarded, f0 + 1);
+}
+
+/* with the id right, a reply from another host or for another name is neither relayed nor cached */
+static void check_spoofed_replies(void)
+{
+    struct query *q = NULL, *other = NULL;
+    ip_addr_t spoofer;
+    long r, f0;
+    int i;
+
+    now += DNSS_CACHE_TTL_MAX * HZ;
+    for (i = 0; i < TRACE && (q == NULL || other == NULL); i++)
+    {
+        if (trace[i].kind != OTHER)
+            continue;
+        if (q == NULL)
+            q = &trace[i];
+        else if (trace[i].other != q->other)
+            other = &trace[i];
+    }
+    HT_CHECK(q != NULL && other != NULL);
+    if (q == NULL || other == NULL)
+        return;
+
+    ip_addr_set_ip4_u32(&spoofer, UPSTREAM_IP + 1);
+    r = replies;
+    f0 = forwarded;
+    DNSS_RecvCb(NULL, DnsServer.Socket, query_pbuf(q), &q->addr, 5353);
+    HT_CHECK_EQ(forwarded, f0 + 1);
+    upstream_reply(&spoofer, NULL);
+    HT_CHECK_EQ(replies, r);
+    upstream_reply(&upstream, other);
+    HT_CHECK_EQ(replies, r);
+
+    /* the query still waits for the real answer */
+    upstream_answer();
+    HT_CHECK_EQ(replies, r + 1);
+    check_reply(q, 1);
+
+    /* the name of the spoofed question was not cached */
+    DNSS_RecvCb(NULL, DnsServer.Socket, query_pbuf(other), &other->addr, 5353);
+    HT_CHECK_EQ(forwarded, f0 + 2);
+    HT_CHECK_EQ(replies, r + 1);
+}
+#endif
+
+int main(void)
+{
+    ip_addr_set_ip4_u32(&ap_netif.ip_addr, AP_IP);
+    ap_netif.flags = NETIF_FLAG_UP;
+    ip_addr_set_ip4_u32(&upstream, UPSTREAM_IP);
+
+    HT_CHECK_EQ(DNSS_Start(&ap_netif, (INT8U *)"connectivitycheck.gstatic.com"), DNSS_ERR_SUCCESS);
+    HT_CHECK_EQ(DNSS_AddName((INT8U *)"captive.apple.com"), DNSS_ERR_SUCCESS);
+    HT_CHECK_EQ(DNSS_AddName((INT8U *)"*.msftconnecttest.com"), DNSS_ERR_SUCCESS);
+    make_trace();
+
+    /* the station down: the other names are a name error */
+    check_trace(0);
+    HT_STOP_IF_FAILED();
+    replay("prebuilt", DNSS_RecvCb);
+    replay("scratch (one name)", scratch_recv);
+
+#if TLS_CONFIG_DNSS_FORWARD
+    /* the station up: the other names from upstream, then from the cache */
+    sta_netif.flags = NETIF_FLAG_UP;
+    check_trace(1);
+    HT_STOP_IF_FAILED();
+    replay("prebuilt + forward cache", DNSS_RecvCb);
+    HT_CHECK(forwarded <= (long)OTHER_NAMES);
+    check_cache_expiry();
+    check_spoofed_replies();
+#endif
+
+    DNSS_Stop();
+    return ht_done(__FILE__);
+}
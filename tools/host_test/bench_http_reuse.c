@@ -0,0 +1,291 @@
+/*
+ * Connection reuse benchmark for the web server, run on a PC against a
+ * device: fetches the static files of the image a number of times with a
+ * new connection per request, one after the other on a kept-alive
+ * connection and pipelined on one connection, and reports requests per
+ * second and how many connections each way needed.
+ *
+ *   bench_http_reuse <device address> [port] [rounds]
+ */
+#define _GNU_SOURCE     /* memmem, strcasestr */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "host_test.h"
+
+#define BUF_LEN         8192
+
+/* the files of fsdata_lwip.h httpd sends with a Content-Length */
+static const char *paths[] = {"/index.html", "/style.css", "/jump.html"};
+#define NUM_PATHS       (int)(sizeof(paths) / sizeof(paths[0]))
+
+static struct addrinfo *server;
+
+struct conn {
+    int fd;
+    char buf[BUF_LEN];
+    int have;                   /* bytes in buf */
+};
+
+static int conn_open(struct conn *c)
+{
+    int one = 1;
+
+    c->have = 0;
+    c->fd = socket(server->ai_family, SOCK_STREAM, 0);
+    if (c->fd < 0)
+        return -1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c->fd, server->ai_addr, server->ai_addrlen) < 0)
+    {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void conn_close(struct conn *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+}
+
+static int send_request(struct conn *c, const char *path, int keepalive)
+{
+    char req[256];
+    int len;
+
+    len = snprintf(req, sizeof(req),
+                   "GET %s HTTP/1.1\r\nHost: device\r\n"
+                   "Accept-Encoding: gzip\r\nConnection: %s\r\n\r\n",
+                   path, keepalive ? "keep-alive" : "close");
+    return (send(c->fd, req, len, 0) == len) ? 0 : -1;
+}
+
+/* more bytes into the buffer, 0 on close */
+static int fill(struct conn *c)
+{
+    int n;
+
+    if (c->have == BUF_LEN)
+        c->have = 0;
+    n = recv(c->fd, c->buf + c->have, BUF_LEN - c->have, 0);
+    if (n > 0)
+        c->have += n;
+    return n;
+}
+
+static void consume(struct conn *c, int n)
+{
+    memmove(c->buf, c->buf + n, c->have - n);
+    c->have -= n;
+}
+
+/*
+ * Read one response. Returns 1 if the connection may be used again, 0 if
+ * the server closes it after this response, -1 on errors.
+ */
+static int read_response(struct conn *c)
+{
+    char *end;
+    char *cl;
+    long left;
+    int hdr_len;
+    int reuse;
+
+    for (;;)
+    {
+        end = memmem(c->buf, c->have, "\r\n\r\n", 4);
+        if (end)
+            break;
+        if (fill(c) <= 0)
+            return -1;
+    }
+    hdr_len = end + 4 - c->buf;
+    *end = 0;
+    if (strncmp(c->buf, "HTTP/1.", 7) != 0)
+        return -1;
+
+    reuse = (strncmp(c->buf, "HTTP/1.1", 8) == 0) &&
+            !strcasestr(c->buf, "\r\nConnection: close");
+    cl = strcasestr(c->buf, "\r\nContent-Length:");
+    if (cl == NULL)
+    {
+        /* close-delimited */
+        consume(c, hdr_len);
+        while (fill(c) > 0)
+            c->have = 0;
+        return 0;
+    }
+    left = strtol(cl + 17, NULL, 10);
+    consume(c, hdr_len);
+    while (left > 0)
+    {
+        if (c->have == 0 && fill(c) <= 0)
+            return -1;
+        if (c->have > left)
+        {
+            consume(c, left);
+            left = 0;
+        }
+        else
+        {
+            left -= c->have;
+            c->have = 0;
+        }
+    }
+    return reuse;
+}
+
+static void report(const char *mode, int requests, int conns, uint64_t ns)
+{
+    printf("%-12s %5d requests %5d connections %8.1f req/s %7.2f ms/req\n",
+           mode, requests, conns, requests * 1e9 / ns, ns / 1e6 / requests);
+}
+
+/* a new connection for every request, the way of the old server */
+static int bench_close(int rounds)
+{
+    struct conn c;
+    uint64_t t0 = ht_now_ns();
+    int i;
+
+    for (i = 0; i < rounds * NUM_PATHS; i++)
+    {
+        if (conn_open(&c) || send_request(&c, paths[i % NUM_PATHS], 0) ||
+            read_response(&c) < 0)
+        {
+            printf("close: request %d failed\n", i);
+            conn_close(&c);
+            return -1;
+        }
+        conn_close(&c);
+    }
+    report("close", rounds * NUM_PATHS, rounds * NUM_PATHS, ht_now_ns() - t0);
+    return 0;
+}
+
+/* one request at a time, a new connection only when the server closed */
+static int bench_keepalive(int rounds)
+{
+    struct conn c;
+    uint64_t t0 = ht_now_ns();
+    int conns = 0;
+    int ret;
+    int i;
+
+    c.fd = -1;
+    for (i = 0; i < rounds * NUM_PATHS; i++)
+    {
+        if (c.fd < 0)
+        {
+            if (conn_open(&c))
+                return -1;
+            conns++;
+        }
+        ret = -1;
+        if (send_request(&c, paths[i % NUM_PATHS], 1) == 0)
+            ret = read_response(&c);
+        if (ret < 0)
+        {
+            printf("keep-alive: request %d failed\n", i);
+            conn_close(&c);
+            return -1;
+        }
+        if (ret == 0)
+            conn_close(&c);
+    }
+    conn_close(&c);
+    report("keep-alive", rounds * NUM_PATHS, conns, ht_now_ns() - t0);
+    return 0;
+}
+
+/* all files of a round sent at once on a kept-alive connection */
+static int bench_pipeline(int rounds)
+{
+    struct conn c;
+    uint64_t t0 = ht_now_ns();
+    int conns = 0;
+    int ret = 0;
+    int round;
+    int i;
+
+    c.fd = -1;
+    for (round = 0; round < rounds; round++)
+    {
+        if (c.fd < 0)
+        {
+            if (conn_open(&c))
+                return -1;
+            conns++;
+        }
+        for (i = 0; i < NUM_PATHS; i++)
+        {
+            if (send_request(&c, paths[i], 1))
+                break;
+        }
+        for (i = 0; i < NUM_PATHS; i++)
+        {
+            ret = read_response(&c);
+            if (ret <= 0)
+                break;
+        }
+        if (ret < 0 || (ret == 0 && i < NUM_PATHS - 1))
+        {
+            /* the server may stop at its request cap, do the round again */
+            conn_close(&c);
+            if (ret < 0 && conns > 2 * rounds)
+            {
+                printf("pipeline: round %d failed\n", round);
+                return -1;
+            }
+            round--;
+            continue;
+        }
+        if (ret == 0)
+            conn_close(&c);
+    }
+    conn_close(&c);
+    report("pipelined", rounds * NUM_PATHS, conns, ht_now_ns() - t0);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct addrinfo hints;
+    const char *port = "80";
+    int rounds = 50;
+    int failed = 0;
+
+    if (argc < 2)
+    {
+        printf("usage: %s <device address> [port] [rounds]\n", argv[0]);
+        return 2;
+    }
+    if (argc > 2)
+        port = argv[2];
+    if (argc > 3)
+        rounds = atoi(argv[3]);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(argv[1], port, &hints, &server))
+    {
+        printf("%s: unknown address\n", argv[1]);
+        return 2;
+    }
+
+    failed |= bench_close(rounds);
+    failed |= bench_keepalive(rounds);
+    failed |= bench_pipeline(rounds);
+
+    freeaddrinfo(server);
+    return failed ? 1 : 0;
+}
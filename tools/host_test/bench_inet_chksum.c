@@ -0,0 +1,109 @@
+/*
+ * lwIP Internet checksum per packet size: the target's word-wise sum
+ * (LWIP_CHKSUM_ALGORITHM 4) against version #2, what lwIP used before, and
+ * the copy with the sum in the same loop (LWIP_CHKSUM_COPY_ALGORITHM 2)
+ * against a memcpy followed by the version #2 sum, what tcp_write() did
+ * without LWIP_CHECKSUM_ON_COPY. Word aligned and odd buffers.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/core/inet_chksum.c"
+#include <stdlib.h>
+
+#define BYTES           (256 * 1024 * 1024)
+
+u16_t lwip_htons(u16_t n)
+{
+    return (u16_t)((n << 8) | (n >> 8));
+}
+
+/* lwIP's version #2, two bytes at a time */
+static u16_t chksum_v2(const void *dataptr, int len)
+{
+    const u8_t *pb = (const u8_t *)dataptr;
+    const u16_t *ps;
+    u16_t t = 0;
+    u32_t sum = 0;
+    int odd = ((mem_ptr_t)pb & 1);
+
+    if (odd && len > 0)
+    {
+        ((u8_t *)&t)[1] = *pb++;
+        len--;
+    }
+
+    ps = (const u16_t *)(const void *)pb;
+    while (len > 1)
+    {
+        sum += *ps++;
+        len -= 2;
+    }
+
+    if (len > 0)
+        ((u8_t *)&t)[0] = *(const u8_t *)ps;
+
+    sum += t;
+    sum = FOLD_U32T(sum);
+    sum = FOLD_U32T(sum);
+    if (odd)
+        sum = SWAP_BYTES_IN_WORD(sum);
+
+    return (u16_t)sum;
+}
+
+static u16_t copy_v2(void *dst, const void *src, u16_t len)
+{
+    MEMCPY(dst, src, len);
+    return chksum_v2(dst, len);
+}
+
+static u8_t src[2048];
+static u8_t dst[2048];
+static volatile u16_t sink;
+
+static double sum_mbs(u16_t (*fn)(const void *, int), int off, int len)
+{
+    long rounds = BYTES / len;
+    uint64_t t0;
+    long n;
+
+    t0 = ht_now_ns();
+    for (n = 0; n < rounds; n++)
+        sink = fn(src + off, len);
+    return (double)rounds * len * 1e3 / (ht_now_ns() - t0);
+}
+
+static double copy_mbs(u16_t (*fn)(void *, const void *, u16_t), int off, int len)
+{
+    long rounds = BYTES / len;
+    uint64_t t0;
+    long n;
+
+    t0 = ht_now_ns();
+    for (n = 0; n < rounds; n++)
+        sink = fn(dst + off, src + off, len);
+    return (double)rounds * len * 1e3 / (ht_now_ns() - t0);
+}
+
+int main(void)
+{
+    static const int lens[] = {64, 512, 1460};
+    static const int offs[] = {0, 1};
+    unsigned i, j;
+    int failed = 0;
+
+    for (i = 0; i < sizeof(src); i++)
+        src[i] = ht_rand();
+
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+    {
+        for (j = 0; j < sizeof(offs) / sizeof(offs[0]); j++)
+        {
+            failed |= lwip_standard_chksum(src + offs[j], lens[i]) != chksum_v2(src + offs[j], lens[i]);
+            printf("%4d bytes %-7s  sum %6.0f MB/s (v2 %6.0f MB/s)  copy+sum %6.0f MB/s (memcpy+v2 %6.0f MB/s)\n",
+                   lens[i], offs[j] ? "odd" : "aligned",
+                   sum_mbs(lwip_standard_chksum, offs[j], lens[i]), sum_mbs(chksum_v2, offs[j], lens[i]),
+                   copy_mbs(lwip_chksum_copy, offs[j], lens[i]), copy_mbs(copy_v2, offs[j], lens[i]));
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,290 @@
+/*
+ * lwIP allocation with TLS_CONFIG_LWIP_POOLS: the fixed memp pools and the
+ * lwIP heap of MEM_SIZE, against the C library heap that MEMP_MEM_MALLOC
+ * and MEM_LIBC_MALLOC used before (tls_mem_alloc() is malloc() under a
+ * lock on the target, the host's malloc() stands in for it).
+ *
+ * Per object type an alloc and free pair, then a mixed churn of the stack's
+ * objects and tx buffers of random size at the pool counts of lwipopts.h:
+ * latency of each alloc (median, 99th percentile, worst) and the operations
+ * per second. The pools must give out no more than their count, count the
+ * failures and come back empty.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/core/memp.c"
+#include "../../src/network/lwip2.0.3/core/mem.c"
+#include "../../src/network/lwip2.0.3/core/pbuf.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include "../../src/network/lwip2.0.3/core/stats.c"
+#include <stdlib.h>
+
+#define PAIRS           2000000
+#define STEPS           2000000
+#define SAMPLES         200000
+#define RAM_SLOTS       16
+#define RAM_MIN         64
+#define RAM_MAX         1514
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+    return ERR_OK;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+    return 0;
+}
+
+/* pbuf.c frees out of sequence segments when PBUF_POOL runs out, no tcp here */
+struct tcp_pcb *tcp_active_pcbs;
+
+void tcp_segs_free(struct tcp_seg *seg)
+{
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx, u8_t block)
+{
+    return ERR_MEM;
+}
+
+/* the objects of a busy stack, received frames and tcp segments the most */
+static const memp_t churn_types[] = {
+    MEMP_PBUF_POOL, MEMP_PBUF_POOL, MEMP_TCPIP_MSG_INPKT, MEMP_TCPIP_MSG_INPKT,
+    MEMP_TCP_SEG, MEMP_TCP_SEG, MEMP_PBUF, MEMP_NETBUF, MEMP_TCP_PCB, MEMP_UDP_PCB
+};
+#define CHURN_TYPES     (sizeof(churn_types) / sizeof(churn_types[0]))
+
+typedef struct {
+    void *(*alloc)(memp_t type, u16_t size);
+    void (*release)(memp_t type, void *p);
+    const char *name;
+} allocator_t;
+
+static void *pool_alloc(memp_t type, u16_t size)
+{
+    return type == MEMP_MAX ? mem_malloc(size) : memp_malloc(type);
+}
+
+static void pool_release(memp_t type, void *p)
+{
+    if (type == MEMP_MAX)
+        mem_free(p);
+    else
+        memp_free(type, p);
+}
+
+static void *heap_alloc(memp_t type, u16_t size)
+{
+    return malloc(type == MEMP_MAX ? size : memp_pools[type]->size);
+}
+
+static void heap_release(memp_t type, void *p)
+{
+    free(p);
+}
+
+static const allocator_t pools = {pool_alloc, pool_release, "pools"};
+static const allocator_t heap = {heap_alloc, heap_release, "heap"};
+
+static void *slots[MEMP_MAX + 1][64];
+static u32_t samples[SAMPLES];
+static u32_t clock_ns;
+static volatile void *sink;
+
+/* the cost of reading the clock, taken off each sample */
+static void clock_cost(void)
+{
+    uint64_t t0, t1;
+    int i;
+
+    clock_ns = ~0u;
+    for (i = 0; i < 100000; i++)
+    {
+        t0 = ht_now_ns();
+        t1 = ht_now_ns();
+        if (t1 - t0 < clock_ns)
+            clock_ns = t1 - t0;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    u32_t x = *(const u32_t *)a, y = *(const u32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int slot_count(memp_t type)
+{
+    return type == MEMP_MAX ? RAM_SLOTS : memp_pools[type]->num;
+}
+
+static double pair_ns(const allocator_t *a, memp_t type)
+{
+    uint64_t t0;
+    void *p;
+    int n;
+
+    t0 = ht_now_ns();
+    for (n = 0; n < PAIRS; n++)
+    {
+        p = a->alloc(type, RAM_MAX);
+        sink = p;
+        a->release(type, p);
+    }
+    return (double)(ht_now_ns() - t0) / PAIRS;
+}
+
+/*
+ * random frees and allocs over every slot, each type filled up to its pool
+ * count; one alloc in STEPS / SAMPLES steps is timed on its own
+ */
+static void churn(const allocator_t *a, u32_t seed)
+{
+    uint64_t t0, t1, total_ns;
+    u32_t nsamples = 0;
+    u32_t every = STEPS / SAMPLES;
+    memp_t type;
+    u16_t size;
+    void **slot;
+    int fails = 0;
+    int freed;
+    int step;
+    int i;
+
+    ht_seed = seed;
+    memset(slots, 0, sizeof(slots));
+    t0 = ht_now_ns();
+    for (step = 0; step < STEPS; step++)
+    {
+        type = ht_rand() % 4 ? churn_types[ht_rand() % CHURN_TYPES] : MEMP_MAX;
+        slot = &slots[type][ht_rand() % slot_count(type)];
+        size = ht_rand_range(RAM_MIN, RAM_MAX);
+        freed = *slot != NULL;
+        if (freed)
+        {
+            a->release(type, *slot);
+            *slot = NULL;
+        }
+        else if (step % every || nsamples == SAMPLES)
+        {
+            *slot = a->alloc(type, size);
+        }
+        else
+        {
+            t1 = ht_now_ns();
+            *slot = a->alloc(type, size);
+            samples[nsamples++] = ht_now_ns() - t1 - clock_ns;
+        }
+        /* the slots of a type never ask for more than its pool count */
+        if (NULL == *slot && !freed)
+            fails++;
+    }
+    total_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(fails, 0);
+
+    for (type = 0; type <= MEMP_MAX; type++)
+    {
+        for (i = 0; i < slot_count(type); i++)
+        {
+            if (slots[type][i])
+                a->release(type, slots[type][i]);
+        }
+    }
+
+    qsort(samples, nsamples, sizeof(samples[0]), cmp_u32);
+    printf("churn %-5s  alloc p50 %4u ns  p99 %5u ns  max %7u ns  %6.2f Mops/s\n",
+           a->name, samples[nsamples / 2], samples[nsamples * 99 / 100], samples[nsamples - 1],
+           (double)STEPS * 1e3 / total_ns);
+}
+
+/* a pool gives out its count and no more, and takes them all back */
+static void test_limits(void)
+{
+    static void *objs[64];
+    memp_t type;
+    u16_t err;
+    int i;
+
+    for (type = 0; type < MEMP_MAX; type++)
+    {
+        err = memp_pools[type]->stats->err;
+        for (i = 0; i < memp_pools[type]->num; i++)
+        {
+            objs[i] = memp_malloc(type);
+            HT_CHECK(objs[i] != NULL);
+        }
+        HT_CHECK(memp_malloc(type) == NULL);
+        HT_CHECK_EQ(memp_pools[type]->stats->err, err + 1);
+        HT_CHECK_EQ(memp_pools[type]->stats->max, memp_pools[type]->num);
+        for (i = 0; i < memp_pools[type]->num; i++)
+            memp_free(type, objs[i]);
+        HT_CHECK_EQ(memp_pools[type]->stats->used, 0);
+    }
+
+    /* a received frame fits in one pool buffer */
+    sink = pbuf_alloc(PBUF_RAW, 1514, PBUF_POOL);
+    HT_CHECK(sink != NULL && ((struct pbuf *)sink)->next == NULL);
+    pbuf_free((struct pbuf *)sink);
+}
+
+int main(void)
+{
+    static const struct {
+        memp_t type;
+        const char *name;
+    } types[] = {
+        {MEMP_PBUF_POOL, "PBUF_POOL"}, {MEMP_TCPIP_MSG_INPKT, "TCPIP_MSG_INPKT"}, {MEMP_TCP_SEG, "TCP_SEG"},
+        {MEMP_PBUF, "PBUF"}, {MEMP_TCP_PCB, "TCP_PCB"}, {MEMP_MAX, "PBUF_RAM (heap)"}
+    };
+    unsigned i;
+    memp_t type;
+
+    stats_init();
+    mem_init();
+    memp_init();
+    clock_cost();
+
+    test_limits();
+    HT_STOP_IF_FAILED();
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        type = types[i].type;
+        printf("%-16s %4d bytes  alloc+free pool %5.1f ns  heap %5.1f ns\n",
+               types[i].name, type == MEMP_MAX ? RAM_MAX : memp_pools[type]->size,
+               pair_ns(&pools, type), pair_ns(&heap, type));
+    }
+
+    churn(&pools, 1);
+    churn(&heap, 1);
+
+    /* everything back */
+    for (type = 0; type < MEMP_MAX; type++)
+        HT_CHECK_EQ(memp_pools[type]->stats->used, 0);
+    HT_CHECK_EQ(lwip_stats.mem.used, 0);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,301 @@
+/*
+ * NAPT table of the soft AP forwarding (lwIP 2.0.3 alg.c): insert, lookup by
+ * the source and by the translated port, and the timer wheel ageing, for a
+ * few thousand flows. Lookups are compared against walking all flows, what
+ * the single list of the table cost before the hash chains.
+ *
+ * Then TCP packets of a client are forwarded through alg_input, with the
+ * checksums patched for the changed words as alg.c does, against the same
+ * with both checksums summed again over the whole packet as it did before.
+ *
+ * The ageing is checked on the way: a flow expires NAPT_TABLE_TIMEOUT after
+ * its last packet, within one timer interval, and the GRE (vpn) entry 30 to
+ * 60 s after its last packet however short the timer interval is.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/core/alg.c"
+#include "napt_host.h"
+
+#define MAX_FLOWS       8000
+#define LOOKUPS         200000
+
+static struct napt_item *flows[MAX_FLOWS];
+
+/* the flow of the source, every flow compared as in a single list */
+static struct napt_item *linear_get_by_src(int count, u16 port, u8 ip)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((port == flows[i]->src_port) && (ip == flows[i]->src_ip))
+            return flows[i];
+    }
+    return NULL;
+}
+
+static struct napt_item *linear_get_by_dest(int count, u16 port)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (port == flows[i]->new_port)
+            return flows[i];
+    }
+    return NULL;
+}
+
+/* the full sums of the translator before the incremental update */
+static u32 resum_16bitsum(const u16 *buff, u16 len)
+{
+    u32 sum = 0;
+
+    while (len > 1)
+    {
+        sum += *buff++;
+        len -= 2;
+    }
+    if (len > 0)
+        sum += *(const u8 *)buff;
+    return sum;
+}
+
+static u16 resum_fold(u32 sum)
+{
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+    return (u16)(~sum);
+}
+
+static void resum(struct ip_hdr *ip_hdr)
+{
+    u8 iphdr_len = (ip_hdr->_v_hl & 0x0F) * 4;
+    u16 len = ntohs(ip_hdr->_len) - iphdr_len;
+    struct tcp_hdr *tcp_hdr = (struct tcp_hdr *)((u8 *)ip_hdr + iphdr_len);
+    u32 sum;
+
+    ip_hdr->_chksum = 0;
+    ip_hdr->_chksum = resum_fold(resum_16bitsum((u16 *)ip_hdr, iphdr_len));
+
+    tcp_hdr->chksum = 0;
+    sum = (ip_hdr->src.addr & 0xFFFF) + (ip_hdr->src.addr >> 16) +
+          (ip_hdr->dest.addr & 0xFFFF) + (ip_hdr->dest.addr >> 16) +
+          htons(IP_PROTO_TCP) + htons(len);
+    tcp_hdr->chksum = resum_fold(sum + resum_16bitsum((u16 *)tcp_hdr, len));
+}
+
+/* a tcp segment of a client to the internet, the checksums left as zero */
+static int tcp_frame(u8 *frame, int payload)
+{
+    struct ip_hdr *ip_hdr = (struct ip_hdr *)(frame + NAPT_ETH_HDR_LEN);
+    struct tcp_hdr *tcp_hdr = (struct tcp_hdr *)(ip_hdr + 1);
+    int i;
+
+    for (i = 0; i < NAPT_FRAME_SIZE; i++)
+        frame[i] = ht_rand();
+    ip_hdr->_v_hl = 0x45;
+    ip_hdr->_len = htons(20 + 20 + payload);
+    ip_hdr->_proto = IP_PROTO_TCP;
+    ip_hdr->_chksum = 0;
+    ip_hdr->src.addr = (AP_IP & 0x00FFFFFF) | (10UL << 24);
+    ip_hdr->dest.addr = 0x01010101;
+    tcp_hdr->src = htons(40000);
+    tcp_hdr->dest = htons(443);
+    tcp_hdr->chksum = 0;
+    return NAPT_ETH_HDR_LEN + 20 + 20 + payload;
+}
+
+static void forward(int payload)
+{
+    static u8 frame[NAPT_FRAME_SIZE];
+    static u8 orig[NAPT_ETH_HDR_LEN + 40];
+    uint64_t t0, patch_ns, resum_ns;
+    int rounds = 1000000;
+    int len;
+    int n;
+
+    len = tcp_frame(frame, payload);
+    resum((struct ip_hdr *)(frame + NAPT_ETH_HDR_LEN));
+    memcpy(orig, frame, sizeof(orig));
+
+    /* the headers are put back for each packet, the payload stays */
+    t0 = ht_now_ns();
+    for (n = 0; n < rounds; n++)
+    {
+        memcpy(frame, orig, sizeof(orig));
+        alg_input(ap_mac, frame, len);
+    }
+    patch_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(napt_out_len, len);
+    HT_CHECK_EQ(napt_table_4tcp.cnt, 1);
+
+    t0 = ht_now_ns();
+    for (n = 0; n < rounds; n++)
+    {
+        memcpy(frame, orig, sizeof(orig));
+        alg_input(ap_mac, frame, len);
+        resum((struct ip_hdr *)(frame + NAPT_ETH_HDR_LEN));
+    }
+    resum_ns = ht_now_ns() - t0;
+
+    printf("%4d byte tcp payload  patched %5.0f ns/packet %7.1f MB/s  resummed %5.0f ns/packet %7.1f MB/s\n",
+           payload, (double)patch_ns / rounds, (double)payload * rounds * 1e3 / patch_ns,
+           (double)resum_ns / rounds, (double)payload * rounds * 1e3 / resum_ns);
+}
+
+/* one timer interval of alg_napt_table_check */
+static void tick(void)
+{
+    alg_napt_table_check(NULL);
+}
+
+static void run(int count)
+{
+    struct napt_item *napt;
+    uint64_t t0, insert_ns, age_ns;
+    uint64_t src_ns, dest_ns, linear_src_ns, linear_dest_ns;
+    int lookups;
+    int i, n;
+
+    /* clients behind the AP, a few hundred ports each */
+    t0 = ht_now_ns();
+    for (i = 0; i < count; i++)
+    {
+        flows[i] = alg_napt_table_insert_4tcp(htons(1024 + i / 16), 2 + i % 16);
+        if (NULL == flows[i])
+            break;
+    }
+    insert_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(i, count);
+    HT_CHECK_EQ(napt_table_4tcp.cnt, count);
+    if (i != count)
+        return;
+
+    lookups = LOOKUPS;
+    t0 = ht_now_ns();
+    for (n = 0; n < lookups; n++)
+    {
+        i = ht_rand() % count;
+        napt = alg_napt_table_get_by_src(&napt_table_4tcp, flows[i]->src_port, flows[i]->src_ip);
+        if (napt != flows[i])
+            break;
+    }
+    src_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, lookups);
+
+    t0 = ht_now_ns();
+    for (n = 0; n < lookups; n++)
+    {
+        i = ht_rand() % count;
+        napt = alg_napt_table_get_by_dest(&napt_table_4tcp, flows[i]->new_port);
+        if (napt != flows[i])
+            break;
+    }
+    dest_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, lookups);
+
+    /* the walk is slow, fewer of them */
+    lookups = LOOKUPS / 100;
+    t0 = ht_now_ns();
+    for (n = 0; n < lookups; n++)
+    {
+        i = ht_rand() % count;
+        if (linear_get_by_src(count, flows[i]->src_port, flows[i]->src_ip) != flows[i])
+            break;
+    }
+    linear_src_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, lookups);
+
+    t0 = ht_now_ns();
+    for (n = 0; n < lookups; n++)
+    {
+        i = ht_rand() % count;
+        if (linear_get_by_dest(count, flows[i]->new_port) != flows[i])
+            break;
+    }
+    linear_dest_ns = ht_now_ns() - t0;
+    HT_CHECK_EQ(n, lookups);
+
+    /*
+     * half of the flows see traffic every interval, the others go idle:
+     * they are still there one interval before the timeout and gone at it
+     */
+    age_ns = 0;
+    for (n = 1; n <= NAPT_WHEEL_SLOTS; n++)
+    {
+        for (i = 0; i < count; i += 2)
+            alg_napt_table_update(flows[i]);
+        t0 = ht_now_ns();
+        tick();
+        age_ns += ht_now_ns() - t0;
+        if (n == NAPT_WHEEL_SLOTS - 1)
+            HT_CHECK_EQ(napt_table_4tcp.cnt, count);
+    }
+    HT_CHECK_EQ(napt_table_4tcp.cnt, (count + 1) / 2);
+    for (i = 0; i < count; i += 2)
+        HT_CHECK(alg_napt_table_get_by_dest(&napt_table_4tcp, flows[i]->new_port) == flows[i]);
+
+    printf("%5d flows  insert %6.0f ns  by src %5.0f ns (list %7.0f ns)  by port %5.0f ns (list %7.0f ns)  age %6.0f ns/tick\n",
+           count, (double)insert_ns / count,
+           (double)src_ns / LOOKUPS, (double)linear_src_ns / lookups,
+           (double)dest_ns / LOOKUPS, (double)linear_dest_ns / lookups,
+           (double)age_ns / NAPT_WHEEL_SLOTS);
+
+    /* the rest idle, all gone within the timeout */
+    for (n = 0; n < NAPT_WHEEL_SLOTS; n++)
+        tick();
+    HT_CHECK_EQ(napt_table_4tcp.cnt, 0);
+}
+
+/* the ticks until the vpn entry is dropped after its last packet */
+static int gre_lifetime(int packet_every)
+{
+    int n;
+
+    gre_info.is_used = true;
+    gre_info.time_stamp = 1;
+    for (n = 1; n <= 4 * NAPT_WHEEL_SLOTS; n++)
+    {
+        tick();
+        if (!gre_info.is_used)
+            return n;
+        if (packet_every && 0 == n % packet_every)
+            gre_info.time_stamp++;
+    }
+    return n;
+}
+
+static void test_gre(void)
+{
+    int phase, n;
+
+    /* whatever the phase of the last packet against the check */
+    for (phase = 0; phase < NAPT_WHEEL_SLOTS; phase++)
+    {
+        napt_tick = napt_table_4tcp.now = napt_table_4udp.now = napt_table_4ic.now = phase;
+        n = gre_lifetime(0);
+        HT_CHECK(n * NAPT_TMR_INTERVAL >= NAPT_TABLE_TIMEOUT * 1000UL / 2);
+        HT_CHECK(n * NAPT_TMR_INTERVAL <= NAPT_TABLE_TIMEOUT * 1000UL);
+    }
+
+    /* a packet every 20 s keeps it */
+    n = gre_lifetime(20000 / NAPT_TMR_INTERVAL);
+    HT_CHECK_EQ(n, 4 * NAPT_WHEEL_SLOTS + 1);
+}
+
+int main(void)
+{
+    static const int counts[] = {500, 2000, MAX_FLOWS};
+    static const int payloads[] = {64, 512, 1460};
+    unsigned i;
+
+    napt_host_init();
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+        run(counts[i]);
+    test_gre();
+
+    for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++)
+        forward(payloads[i]);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,466 @@
+/*
+ * iperf style TCP runs over an emulated link with TLS_CONFIG_TCP_WND_AUTOTUNE
+ * (this program) and with the fixed TCP_WND and TCP_SND_BUF
+ * (bench_tcp_wnd_fixed, the same source built with the option off).
+ *
+ * Two netifs of one stack are joined by a wire with a bit rate, a one way
+ * delay and a drop tail queue; each end only reaches the other over it.
+ * Bulk writers on one side, readers on the other, one task each:
+ *
+ * - one flow at a short and a long RTT: throughput and the receive window
+ * - four flows: throughput of each and Jain's fairness index
+ * - one flow beside idle connections: what the idle ones keep reserved
+ * - a non-blocking writer waiting in select() must get writable again
+ *
+ * Both ends share the stack, so the writers' pcbs, which stand in for the
+ * peer on the network, take their part of the window budget and of the
+ * eight sockets too.
+ */
+#define LWIP_HOOK_IP4_ROUTE_SRC(dest, src)  wire_route(dest)
+struct netif;
+static struct netif *wire_route(const void *dest);
+
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/sys_arch.c"
+#include "../../src/network/lwip2.0.3/api/tcpip.c"
+#include "../../src/network/lwip2.0.3/api/sockets.c"
+#include "../../src/network/lwip2.0.3/api/api_lib.c"
+#include "../../src/network/lwip2.0.3/api/api_msg.c"
+#include "../../src/network/lwip2.0.3/api/netbuf.c"
+#include "../../src/network/lwip2.0.3/api/err.c"
+#include "../../src/network/lwip2.0.3/core/init.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include "../../src/network/lwip2.0.3/core/dns.c"
+#include "../../src/network/lwip2.0.3/core/inet_chksum.c"
+#include "../../src/network/lwip2.0.3/core/ip.c"
+#include "../../src/network/lwip2.0.3/core/mem.c"
+#include "../../src/network/lwip2.0.3/core/memp.c"
+#include "../../src/network/lwip2.0.3/core/netif.c"
+#include "../../src/network/lwip2.0.3/core/pbuf.c"
+#include "../../src/network/lwip2.0.3/core/raw.c"
+#include "../../src/network/lwip2.0.3/core/stats.c"
+#include "../../src/network/lwip2.0.3/core/sys.c"
+#include "../../src/network/lwip2.0.3/core/tcp.c"
+#include "../../src/network/lwip2.0.3/core/tcp_in.c"
+#include "../../src/network/lwip2.0.3/core/tcp_out.c"
+#include "../../src/network/lwip2.0.3/core/timeouts.c"
+#include "../../src/network/lwip2.0.3/core/udp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/dhcp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/etharp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/icmp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/igmp.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4_addr.c"
+#include "../../src/network/lwip2.0.3/core/ipv4/ip4_frag.c"
+#include "../../src/network/lwip2.0.3/netif/ethernet.c"
+#include "lwip_host.h"
+
+#define WIRE_RATE       20000000    /* bit/s */
+#define WIRE_QUEUE      (32 * 1024) /* bytes waiting to go out, each way */
+#define WARMUP_MS       1500
+#define RUN_MS          3000
+#define FLOWS           3
+#define IDLE_CONNS      2
+#define IDLE_MS         6000        /* longer than TCP_WND_IDLE_TICKS */
+#define NB_BYTES        (256 * 1024)
+#define PORT            5001
+
+#if TCP_WND_AUTOTUNE
+#define MODE            "autotune"
+#else
+#define MODE            "fixed"
+#endif
+
+int tls_wl_get_isr_count(void)
+{
+    return 0;
+}
+
+/* no soft AP forwarding, every local port is free */
+bool alg_napt_port_is_used(u16 port)
+{
+    return false;
+}
+
+/* a packet on the wire, due at the far end at due_ns */
+struct wire_pkt {
+    struct wire_pkt *next;
+    struct netif *to;
+    uint64_t due_ns;
+    u16_t len;
+    u8_t data[];
+};
+
+static struct netif wire_a;
+static struct netif wire_b;
+static ip4_addr_t addr_a;
+static ip4_addr_t addr_b;
+static struct wire_pkt *wire_head;
+static uint64_t wire_free_ns[2];    /* each way, when the last bit queued is out */
+static uint64_t wire_delay_ns;
+static int wire_timer;
+static u32_t wire_drops;
+
+/* each end reaches the other over its own netif, never the loopback */
+static struct netif *wire_route(const void *dest)
+{
+    if (ip4_addr_cmp((const ip4_addr_t *)dest, &addr_b))
+        return &wire_a;
+    if (ip4_addr_cmp((const ip4_addr_t *)dest, &addr_a))
+        return &wire_b;
+    return NULL;
+}
+
+/* runs in the tcpip thread: hand over what has arrived */
+static void wire_deliver(void *arg)
+{
+    uint64_t now = ht_now_ns();
+    struct wire_pkt *w;
+    struct pbuf *p;
+
+    wire_timer = 0;
+    while (wire_head && wire_head->due_ns <= now)
+    {
+        w = wire_head;
+        wire_head = w->next;
+        p = pbuf_alloc(PBUF_RAW, w->len, PBUF_RAM);
+        if (p)
+        {
+            pbuf_take(p, w->data, w->len);
+            if (w->to->input(p, w->to) != ERR_OK)
+                pbuf_free(p);
+        }
+        free(w);
+    }
+    if (wire_head)
+    {
+        wire_timer = 1;
+        sys_timeout((u32_t)((wire_head->due_ns - now + 999999) / 1000000), wire_deliver, NULL);
+    }
+}
+
+static err_t wire_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    int way = netif == &wire_b;
+    uint64_t now = ht_now_ns();
+    uint64_t start = LWIP_MAX(now, wire_free_ns[way]);
+    struct wire_pkt *w, **pos;
+
+    /* drop tail */
+    if ((start - now) * (WIRE_RATE / 8) / 1000000000u > WIRE_QUEUE)
+    {
+        wire_drops++;
+        return ERR_OK;
+    }
+    w = malloc(sizeof(*w) + p->tot_len);
+    if (NULL == w)
+        return ERR_MEM;
+    w->to = way ? &wire_a : &wire_b;
+    w->len = p->tot_len;
+    pbuf_copy_partial(p, w->data, p->tot_len, 0);
+    wire_free_ns[way] = start + (uint64_t)p->tot_len * 8 * 1000000000u / WIRE_RATE;
+    w->due_ns = wire_free_ns[way] + wire_delay_ns;
+
+    /* in order of arrival, the two ways interleave */
+    for (pos = &wire_head; *pos && (*pos)->due_ns <= w->due_ns; pos = &(*pos)->next)
+        ;
+    w->next = *pos;
+    *pos = w;
+    if (!wire_timer)
+    {
+        wire_timer = 1;
+        sys_timeout((u32_t)((wire_head->due_ns - now + 999999) / 1000000), wire_deliver, NULL);
+    }
+    return ERR_OK;
+}
+
+static err_t wire_netif_init(struct netif *netif)
+{
+    netif->output = wire_output;
+    netif->mtu = 1500;
+    netif->name[0] = 'w';
+    netif->name[1] = netif == &wire_a ? 'a' : 'b';
+    return ERR_OK;
+}
+
+struct call {
+    sys_sem_t done;
+    u32_t rcv_total;
+    u32_t rcv_max;
+    u32_t snd_total;
+};
+
+static void wire_up(void *arg)
+{
+    struct call *c = arg;
+    ip4_addr_t mask;
+
+    IP4_ADDR(&addr_a, 10, 0, 0, 1);
+    IP4_ADDR(&addr_b, 10, 0, 1, 1);
+    IP4_ADDR(&mask, 255, 255, 255, 255);
+    netif_add(&wire_a, &addr_a, &mask, IP4_ADDR_ANY4, NULL, wire_netif_init, ip_input);
+    netif_add(&wire_b, &addr_b, &mask, IP4_ADDR_ANY4, NULL, wire_netif_init, ip_input);
+    netif_set_up(&wire_a);
+    netif_set_up(&wire_b);
+    netif_set_link_up(&wire_a);
+    netif_set_link_up(&wire_b);
+    sys_sem_signal(&c->done);
+}
+
+/* the caps of the connections, receive side and send side */
+static void wnd_scan(void *arg)
+{
+    struct call *c = arg;
+    struct tcp_pcb *pcb;
+
+    c->rcv_total = c->rcv_max = c->snd_total = 0;
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next)
+    {
+        c->rcv_total += TCP_WND_MAX(pcb);
+        c->rcv_max = LWIP_MAX(c->rcv_max, (u32_t)TCP_WND_MAX(pcb));
+        c->snd_total += TCP_SND_BUF_MAX(pcb);
+    }
+    sys_sem_signal(&c->done);
+}
+
+static void in_tcpip(tcpip_callback_fn fn, struct call *c)
+{
+    sys_sem_new(&c->done, 0);
+    tcpip_callback(fn, c);
+    sys_arch_sem_wait(&c->done, 0);
+    sys_sem_free(&c->done);
+}
+
+struct flow {
+    int tx;
+    int rx;
+    volatile long received;
+    volatile int stop;
+    sys_sem_t done;
+};
+
+static struct flow flows[FLOWS];
+static int idle[IDLE_CONNS][2];
+
+static void sockaddr_of(struct sockaddr_in *sa, const ip4_addr_t *ip, u16_t port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = lwip_htons(port);
+    sa->sin_addr.s_addr = ip4_addr_get_u32(ip);
+}
+
+/* a connection from side a to side b, writer first */
+static void open_conn(int l, int *tx, int *rx)
+{
+    struct sockaddr_in sa;
+
+    sockaddr_of(&sa, &addr_b, PORT);
+    *tx = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    HT_CHECK_EQ(lwip_connect(*tx, (struct sockaddr *)&sa, sizeof(sa)), 0);
+    *rx = lwip_accept(l, NULL, NULL);
+    HT_CHECK(*rx >= 0);
+}
+
+static void writer_task(void *arg)
+{
+    struct flow *f = arg;
+    static u8_t buf[4096];
+
+    while (!f->stop)
+    {
+        if (lwip_send(f->tx, buf, sizeof(buf), 0) <= 0)
+            break;
+    }
+    lwip_close(f->tx);
+    sys_sem_signal(&f->done);
+}
+
+static void reader_task(void *arg)
+{
+    struct flow *f = arg;
+    u8_t buf[4096];
+    int len;
+
+    while ((len = lwip_recv(f->rx, buf, sizeof(buf), 0)) > 0)
+        f->received += len;
+    lwip_close(f->rx);
+    sys_sem_signal(&f->done);
+}
+
+/* run n flows, returns each one's Mbit/s in mbps */
+static void run_flows(int l, int n, double *mbps, struct call *wnd)
+{
+    long start[FLOWS];
+    uint64_t t0, t1;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        memset(&flows[i], 0, sizeof(flows[i]));
+        open_conn(l, &flows[i].tx, &flows[i].rx);
+        sys_sem_new(&flows[i].done, 0);
+        tls_os_task_create(NULL, "reader", reader_task, &flows[i], NULL, 0, 0, 0);
+        tls_os_task_create(NULL, "writer", writer_task, &flows[i], NULL, 0, 0, 0);
+    }
+
+    tls_os_time_delay(WARMUP_MS);
+    t0 = ht_now_ns();
+    for (i = 0; i < n; i++)
+        start[i] = flows[i].received;
+    tls_os_time_delay(RUN_MS);
+    t1 = ht_now_ns();
+    for (i = 0; i < n; i++)
+        mbps[i] = (flows[i].received - start[i]) * 8e3 / (t1 - t0);
+    in_tcpip(wnd_scan, wnd);
+
+    for (i = 0; i < n; i++)
+        flows[i].stop = 1;
+    for (i = 0; i < n; i++)
+    {
+        sys_arch_sem_wait(&flows[i].done, 0);
+        sys_arch_sem_wait(&flows[i].done, 0);
+        sys_sem_free(&flows[i].done);
+    }
+}
+
+static void bench_single(int l, u32_t rtt_ms)
+{
+    struct call wnd;
+    double mbps;
+
+    wire_delay_ns = (uint64_t)rtt_ms * 1000000 / 2;
+    run_flows(l, 1, &mbps, &wnd);
+    printf("%-8s  1 flow   rtt %3u ms  %6.2f Mbit/s  receive window %5u\n",
+           MODE, (unsigned)rtt_ms, mbps, (unsigned)wnd.rcv_max);
+    HT_CHECK(mbps > 0);
+}
+
+static void bench_fairness(int l, u32_t rtt_ms)
+{
+    struct call wnd;
+    double mbps[FLOWS];
+    double sum = 0, sq = 0;
+    int i;
+
+    wire_delay_ns = (uint64_t)rtt_ms * 1000000 / 2;
+    run_flows(l, FLOWS, mbps, &wnd);
+    printf("%-8s  %d flows  rtt %3u ms ", MODE, FLOWS, (unsigned)rtt_ms);
+    for (i = 0; i < FLOWS; i++)
+    {
+        printf(" %5.2f", mbps[i]);
+        sum += mbps[i];
+        sq += mbps[i] * mbps[i];
+    }
+    printf(" Mbit/s  total %5.2f  jain %.3f  receive windows %5u\n",
+           sum, sum * sum / (FLOWS * sq), (unsigned)wnd.rcv_total);
+    /* the fixed windows share one send pool, the first writer can take it all */
+#if TCP_WND_AUTOTUNE
+    for (i = 0; i < FLOWS; i++)
+        HT_CHECK(mbps[i] > 0);
+    HT_CHECK(wnd.rcv_total <= TCP_WND_BUDGET);
+#endif
+}
+
+/* one flow beside connections that stay open and quiet */
+static void bench_idle(int l, u32_t rtt_ms)
+{
+    struct call opened, quiet, wnd;
+    double mbps;
+    int i;
+
+    wire_delay_ns = (uint64_t)rtt_ms * 1000000 / 2;
+    for (i = 0; i < IDLE_CONNS; i++)
+        open_conn(l, &idle[i][0], &idle[i][1]);
+    in_tcpip(wnd_scan, &opened);
+    tls_os_time_delay(IDLE_MS);
+    in_tcpip(wnd_scan, &quiet);
+    run_flows(l, 1, &mbps, &wnd);
+    printf("%-8s  1 flow + %d idle  rtt %3u ms  %6.2f Mbit/s  idle receive windows %5u at open, %5u later"
+           "  all send caps %6u\n", MODE, IDLE_CONNS, (unsigned)rtt_ms, mbps, (unsigned)opened.rcv_total,
+           (unsigned)quiet.rcv_total, (unsigned)wnd.snd_total);
+    HT_CHECK(mbps > 0);
+    for (i = 0; i < IDLE_CONNS; i++)
+    {
+        lwip_close(idle[i][0]);
+        lwip_close(idle[i][1]);
+    }
+}
+
+/* select() must report the writer writable again each time its buffer drains */
+static void test_nonblocking(int l)
+{
+    struct flow *f = &flows[0];
+    static u8_t buf[4096];
+    struct timeval tv;
+    fd_set wr;
+    long sent = 0;
+    int stalls = 0;
+    int len;
+
+    wire_delay_ns = 5 * 1000000;
+    memset(f, 0, sizeof(*f));
+    open_conn(l, &f->tx, &f->rx);
+    sys_sem_new(&f->done, 0);
+    tls_os_task_create(NULL, "reader", reader_task, f, NULL, 0, 0, 0);
+    HT_CHECK_EQ(lwip_fcntl(f->tx, F_SETFL, O_NONBLOCK), 0);
+
+    while (sent < NB_BYTES)
+    {
+        len = lwip_send(f->tx, buf, LWIP_MIN(sizeof(buf), NB_BYTES - sent), 0);
+        if (len > 0)
+        {
+            sent += len;
+            continue;
+        }
+        FD_ZERO(&wr);
+        FD_SET(f->tx, &wr);
+        tv.tv_sec = 2;
+        tv.tv_usec = 0;
+        if (lwip_select(f->tx + 1, NULL, &wr, NULL, &tv) <= 0 && ++stalls > 2)
+            break;
+    }
+    HT_CHECK_EQ(sent, NB_BYTES);
+    HT_CHECK_EQ(stalls, 0);
+    printf("%-8s  non-blocking writer  %ld of %d bytes, %d select timeouts\n", MODE, sent, NB_BYTES, stalls);
+
+    lwip_close(f->tx);
+    sys_arch_sem_wait(&f->done, 0);
+    sys_sem_free(&f->done);
+}
+
+static void tcpip_ready(void *arg)
+{
+    sys_sem_signal((sys_sem_t *)arg);
+}
+
+int main(void)
+{
+    struct sockaddr_in sa;
+    struct call c;
+    sys_sem_t ready;
+    int l;
+
+    lwip_host_init();
+    sys_sem_new(&ready, 0);
+    tcpip_init(tcpip_ready, &ready);
+    sys_arch_sem_wait(&ready, 0);
+    in_tcpip(wire_up, &c);
+
+    sockaddr_of(&sa, &addr_b, PORT);
+    l = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    HT_CHECK_EQ(lwip_bind(l, (struct sockaddr *)&sa, sizeof(sa)), 0);
+    HT_CHECK_EQ(lwip_listen(l, IDLE_CONNS + 1), 0);
+    HT_STOP_IF_FAILED();
+
+    test_nonblocking(l);
+    bench_single(l, 10);
+    bench_single(l, 60);
+    bench_fairness(l, 20);
+    bench_idle(l, 20);
+    printf("%-8s  wire drops %u\n", MODE, (unsigned)wire_drops);
+
+    lwip_close(l);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,2 @@
+/* bench_tcp_wnd.c with the fixed TCP_WND and TCP_SND_BUF */
+#include "bench_tcp_wnd.c"
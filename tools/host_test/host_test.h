@@ -0,0 +1,70 @@
+/**
+ * @file    host_test.h
+ *
+ * @brief   checks, random numbers and timing for the host tests
+ *
+ * Copyright (c) 2014 Winner Microelectronics Co., Ltd.
+ */
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int ht_failed;
+static int ht_checked;
+
+#define HT_CHECK(cond) do { \
+        ht_checked++; \
+        if (!(cond)) { \
+            ht_failed++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define HT_CHECK_EQ(a, b) do { \
+        long long ht_a = (long long)(a), ht_b = (long long)(b); \
+        ht_checked++; \
+        if (ht_a != ht_b) { \
+            ht_failed++; \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+                   __FILE__, __LINE__, #a, #b, ht_a, ht_b); \
+        } \
+    } while (0)
+
+/* stop after the first failures of a long loop */
+#define HT_STOP_IF_FAILED() do { if (ht_failed > 10) return ht_done(__FILE__); } while (0)
+
+static inline int ht_done(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, ht_checked, ht_failed);
+    return ht_failed ? 1 : 0;
+}
+
+/* xorshift32, tests are reproducible for a seed */
+static uint32_t ht_seed = 2463534242u;
+
+static inline uint32_t ht_rand(void)
+{
+    ht_seed ^= ht_seed << 13;
+    ht_seed ^= ht_seed >> 17;
+    ht_seed ^= ht_seed << 5;
+    return ht_seed;
+}
+
+/* uniform in [lo, hi] */
+static inline uint32_t ht_rand_range(uint32_t lo, uint32_t hi)
+{
+    return lo + ht_rand() % (hi - lo + 1);
+}
+
+static inline uint64_t ht_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#endif /* HOST_TEST_H */
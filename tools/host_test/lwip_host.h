@@ -0,0 +1,322 @@
+/**
+ * @file    lwip_host.h
+ *
+ * @brief   the OS services of the lwIP port on POSIX threads, for the host
+ *          tests that run the whole stack
+ *
+ * sys_arch.c of the tree runs on top of these: semaphores and queues on a
+ * mutex and condition, the mutexes on pthread mutexes, each task a thread.
+ * A tick is a millisecond. The critical section is one recursive lock.
+ *
+ * mem_ptr_t is 32 bits: build without PIE and call lwip_host_init() first,
+ * it keeps every thread's malloc() in the heap below 4 GB.
+ *
+ * Copyright (c) 2014 Winner Microelectronics Co., Ltd.
+ */
+#ifndef LWIP_HOST_H
+#define LWIP_HOST_H
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+const unsigned int HZ = 1000;
+
+struct host_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    u32 count;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    void **msgs;
+    u32 size;
+    u32 head;
+    u32 count;
+};
+
+static pthread_mutex_t host_critical;
+static pthread_once_t host_critical_once = PTHREAD_ONCE_INIT;
+
+static void host_critical_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&host_critical, &attr);
+}
+
+/* the absolute time wait_time ticks from now */
+static void host_deadline(struct timespec *ts, u32 wait_time)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += wait_time / HZ;
+    ts->tv_nsec += (long)(wait_time % HZ) * (1000000000L / HZ);
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* wait on cond, forever if wait_time is 0; 0 on timeout */
+static int host_wait(pthread_cond_t *cond, pthread_mutex_t *lock, u32 wait_time)
+{
+    struct timespec ts;
+
+    if (0 == wait_time)
+        return 0 == pthread_cond_wait(cond, lock);
+    host_deadline(&ts, wait_time);
+    return 0 == pthread_cond_timedwait(cond, lock, &ts);
+}
+
+u32 tls_os_get_time(void)
+{
+    return (u32)(ht_now_ns() / (1000000000u / HZ));
+}
+
+void tls_os_time_delay(u32 ticks)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ticks / HZ;
+    ts.tv_nsec = (long)(ticks % HZ) * (1000000000L / HZ);
+    nanosleep(&ts, NULL);
+}
+
+u32 tls_os_set_critical(void)
+{
+    pthread_once(&host_critical_once, host_critical_init);
+    pthread_mutex_lock(&host_critical);
+    return 0;
+}
+
+void tls_os_release_critical(u32 cpu_sr)
+{
+    pthread_mutex_unlock(&host_critical);
+}
+
+tls_os_status_t tls_os_sem_create(tls_os_sem_t **sem, u32 cnt)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+
+    if (NULL == s)
+        return TLS_OS_ERROR;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = cnt;
+    *sem = s;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_delete(tls_os_sem_t *sem)
+{
+    free(sem);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_acquire(tls_os_sem_t *sem, u32 wait_time)
+{
+    struct host_sem *s = sem;
+    tls_os_status_t status = TLS_OS_SUCCESS;
+
+    pthread_mutex_lock(&s->lock);
+    while (0 == s->count)
+    {
+        if (!host_wait(&s->cond, &s->lock, wait_time) && 0 == s->count)
+        {
+            status = TLS_OS_ERROR;
+            break;
+        }
+    }
+    if (TLS_OS_SUCCESS == status)
+        s->count--;
+    pthread_mutex_unlock(&s->lock);
+    return status;
+}
+
+tls_os_status_t tls_os_sem_release(tls_os_sem_t *sem)
+{
+    struct host_sem *s = sem;
+
+    pthread_mutex_lock(&s->lock);
+    s->count++;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_mutex_create(u8 prio, tls_os_mutex_t **mutex)
+{
+    pthread_mutex_t *m = malloc(sizeof(*m));
+
+    if (NULL == m)
+        return TLS_OS_ERROR;
+    pthread_mutex_init(m, NULL);
+    *mutex = m;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_mutex_delete(tls_os_mutex_t *mutex)
+{
+    pthread_mutex_destroy(mutex);
+    free(mutex);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_mutex_acquire(tls_os_mutex_t *mutex, u32 wait_time)
+{
+    return pthread_mutex_lock(mutex) ? TLS_OS_ERROR : TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_mutex_release(tls_os_mutex_t *mutex)
+{
+    return pthread_mutex_unlock(mutex) ? TLS_OS_ERROR : TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_queue_create(tls_os_queue_t **queue, u32 queue_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+
+    if (NULL == q)
+        return TLS_OS_ERROR;
+    q->msgs = calloc(queue_size, sizeof(void *));
+    if (NULL == q->msgs)
+    {
+        free(q);
+        return TLS_OS_ERROR;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->size = queue_size;
+    *queue = q;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_queue_delete(tls_os_queue_t *queue)
+{
+    struct host_queue *q = queue;
+
+    free(q->msgs);
+    free(q);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_queue_flush(tls_os_queue_t *queue)
+{
+    struct host_queue *q = queue;
+
+    pthread_mutex_lock(&q->lock);
+    q->count = 0;
+    pthread_mutex_unlock(&q->lock);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_queue_send(tls_os_queue_t *queue, void *msg, u32 msg_size)
+{
+    struct host_queue *q = queue;
+    tls_os_status_t status = TLS_OS_ERROR;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->count < q->size)
+    {
+        q->msgs[(q->head + q->count++) % q->size] = msg;
+        pthread_cond_signal(&q->cond);
+        status = TLS_OS_SUCCESS;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return status;
+}
+
+tls_os_status_t tls_os_queue_receive(tls_os_queue_t *queue, void **msg, u32 msg_size, u32 wait_time)
+{
+    struct host_queue *q = queue;
+    tls_os_status_t status = TLS_OS_SUCCESS;
+
+    pthread_mutex_lock(&q->lock);
+    while (0 == q->count)
+    {
+        if (!host_wait(&q->cond, &q->lock, wait_time) && 0 == q->count)
+        {
+            status = TLS_OS_ERROR;
+            break;
+        }
+    }
+    if (TLS_OS_SUCCESS == status)
+    {
+        if (msg)
+            *msg = q->msgs[q->head];
+        q->head = (q->head + 1) % q->size;
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return status;
+}
+
+struct host_task_start {
+    void (*entry)(void *param);
+    void *param;
+};
+
+static void *host_task_main(void *arg)
+{
+    struct host_task_start start = *(struct host_task_start *)arg;
+
+    free(arg);
+    start.entry(start.param);
+    return NULL;
+}
+
+tls_os_status_t tls_os_task_create(tls_os_task_t *task, const char *name,
+                                   void (*entry)(void *param), void *param,
+                                   u8 *stk_start, u32 stk_size, u32 prio, u32 flag)
+{
+    struct host_task_start *start = malloc(sizeof(*start));
+    pthread_t thread;
+
+    if (NULL == start)
+        return TLS_OS_ERROR;
+    start->entry = entry;
+    start->param = param;
+    if (pthread_create(&thread, NULL, host_task_main, start))
+    {
+        free(start);
+        return TLS_OS_ERROR;
+    }
+    pthread_detach(thread);
+    return TLS_OS_SUCCESS;
+}
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+void *mem_calloc_debug(u32 n, u32 size)
+{
+    return calloc(n, size);
+}
+
+/* one heap for all threads, and all threads on one cpu as on the target */
+static void lwip_host_init(void)
+{
+    cpu_set_t set;
+
+    mallopt(M_ARENA_MAX, 1);
+    mallopt(M_MMAP_MAX, 0);
+
+    CPU_ZERO(&set);
+    CPU_SET(sched_getcpu(), &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+#endif /* LWIP_HOST_H */
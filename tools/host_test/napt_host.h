@@ -0,0 +1,159 @@
+/**
+ * @file    napt_host.h
+ *
+ * @brief   the target services alg.c calls, for the NAPT host tests
+ *
+ * The station is 192.168.1.100 towards the router, the soft AP 192.168.4.1.
+ * Frames alg.c sends to the air land in napt_out; those it hands to lwIP
+ * are only counted. The locks always succeed and there are no lwIP pcbs.
+ *
+ * Copyright (c) 2014 Winner Microelectronics Co., Ltd.
+ */
+#ifndef NAPT_HOST_H
+#define NAPT_HOST_H
+
+#include <stdlib.h>
+
+#define NAPT_FRAME_SIZE (NAPT_ETH_HDR_LEN + 60 + 8 + 1472)
+
+#define STA_IP          0x6401A8C0UL
+#define AP_IP           0x0104A8C0UL
+#define DNS_IP          0x08080808UL
+
+const unsigned int HZ = 1000;
+
+struct udp_pcb *udp_pcbs;
+static struct tcp_pcb *no_pcbs;
+struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS] = {&no_pcbs, &no_pcbs, &no_pcbs, &no_pcbs};
+
+static u8 sta_mac[ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x01};
+static u8 ap_mac[ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x02};
+static u8 router_mac[ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x03};
+static u8 client_mac[ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x04};
+
+static struct netif sta_netif;
+static struct netif ap_netif;
+static ip_addr_t dns_server;
+
+static u8 napt_out[NAPT_FRAME_SIZE];
+static int napt_out_len;
+static int napt_delivered;
+
+u16_t lwip_htons(u16_t n)
+{
+    return (u16_t)((n << 8) | (n >> 8));
+}
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+tls_os_status_t tls_os_sem_acquire(tls_os_sem_t *sem, u32 wait_time)
+{
+    (void)sem;
+    (void)wait_time;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_release(tls_os_sem_t *sem)
+{
+    (void)sem;
+    return TLS_OS_SUCCESS;
+}
+
+struct netif *tls_get_netif(void)
+{
+    return &sta_netif;
+}
+
+struct tls_wif *tls_get_wif_data(void)
+{
+    return NULL;
+}
+
+u8 *wpa_supplicant_get_mac(void)
+{
+    return sta_mac;
+}
+
+u8 *wpa_supplicant_get_bssid(void)
+{
+    return router_mac;
+}
+
+u8 *hostapd_get_mac(void)
+{
+    return ap_mac;
+}
+
+u8 *tls_dhcps_getmac(const ip_addr_t *ip)
+{
+    (void)ip;
+    return client_mac;
+}
+
+const ip_addr_t *dns_getserver(u8_t numdns)
+{
+    (void)numdns;
+    return &dns_server;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    (void)layer;
+    (void)length;
+    (void)type;
+    return NULL;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    (void)p;
+    return 0;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    (void)buf;
+    (void)dataptr;
+    (void)len;
+    return ERR_MEM;
+}
+
+int ethernetif_input(const u8 *bssid, u8 *buf, u32 buf_len)
+{
+    (void)bssid;
+    (void)buf;
+    (void)buf_len;
+    napt_delivered++;
+    return 0;
+}
+
+int tls_wl_if_xmit(struct tls_wif *wif, void *buf, int len, bool is_apsta, bool not_delay)
+{
+    (void)wif;
+    (void)is_apsta;
+    (void)not_delay;
+    memcpy(napt_out, buf, len);
+    napt_out_len = len;
+    return 0;
+}
+
+static void napt_host_init(void)
+{
+    sta_netif.ip_addr.addr = STA_IP;
+    sta_netif.next = &ap_netif;
+    sta_netif.flags = NETIF_FLAG_UP;
+    ap_netif.ip_addr.addr = AP_IP;
+    dns_server.addr = DNS_IP;
+    napt_curr_port = NAPT_LOCAL_PORT_RANGE_START;
+    napt_curr_id = NAPT_ICMP_ID_RANGE_START;
+}
+
+#endif /* NAPT_HOST_H */
@@ -0,0 +1,6 @@
+#ifndef HOST_TEST_FREERTOS_H
+#define HOST_TEST_FREERTOS_H
+
+typedef unsigned int portTickType;
+
+#endif
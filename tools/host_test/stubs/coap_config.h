@@ -0,0 +1,39 @@
+/* host stand-in for the libcoap configuration, WITH_POSIX on the host's
+ * own sockets instead of WITH_LWIP */
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include "wm_sockets.h"
+#include <sys/types.h>
+#include <sys/time.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include "wm_mem.h"
+
+#ifndef WITH_POSIX
+#define WITH_POSIX 1
+#endif
+
+/* coap_io.h typedefs ssize_t as int, keep it off the host's own */
+#define ssize_t coap_ssize_t
+
+#define PACKAGE_NAME "libcoap-host"
+#define PACKAGE_VERSION "?"
+#define PACKAGE_STRING PACKAGE_NAME PACKAGE_VERSION
+
+#define HAVE_STRNLEN 1
+#define HAVE_LIMITS_H
+#define HAVE_SYSLOG_H
+#define HAVE_ARPA_INET_H
+
+#define COAP_RESOURCES_NOHASH
+
+#define HAVE_MALLOC
+
+#endif /* _CONFIG_H_ */
@@ -0,0 +1 @@
+/* host stand-in, nothing needed from the lwIP debug header */
@@ -0,0 +1 @@
+/* host stand-in, the address helpers come from arpa/inet.h */
@@ -0,0 +1 @@
+/* host stand-in, nothing of it is used by the code under test */
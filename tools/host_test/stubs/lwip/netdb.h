@@ -0,0 +1,2 @@
+/* host stand-in, the resolver of the host */
+#include "wm_sockets.h"
@@ -0,0 +1,2 @@
+/* the IANA numbers the soft AP servers use, lwIP 2.0.3 has no copy of them */
+#include "../../../../../../src/network/lwip2x/include/lwip/prot/iana.h"
@@ -0,0 +1,47 @@
+/* the tree's configuration with the lwIP options under test switched on */
+#ifndef HOST_TEST_LWIP_WM_CONFIG_H
+#define HOST_TEST_LWIP_WM_CONFIG_H
+
+#include <endian.h>
+#include "../../../../include/wm_config.h"
+
+/* arch/cc.h defines its own, the same little endian */
+#undef BYTE_ORDER
+
+#undef TLS_CONFIG_AP_OPT_FWD
+#define TLS_CONFIG_AP_OPT_FWD           CFG_ON
+/* the forwarding path is ipv4 only */
+#undef TLS_CONFIG_IPV6
+#define TLS_CONFIG_IPV6                 CFG_OFF
+
+/* the fixed memp pools, for the programs built with -DHOST_TEST_LWIP_POOLS */
+#ifdef HOST_TEST_LWIP_POOLS
+#undef TLS_CONFIG_LWIP_POOLS
+#define TLS_CONFIG_LWIP_POOLS           CFG_ON
+#endif
+
+/* the tcpip core lock, for the programs built with -DHOST_TEST_LWIP_CORE_LOCKING */
+#ifdef HOST_TEST_LWIP_CORE_LOCKING
+#undef TLS_CONFIG_LWIP_CORE_LOCKING
+#define TLS_CONFIG_LWIP_CORE_LOCKING    CFG_ON
+#endif
+
+/* the TCP window auto-tuning, for the programs built with -DHOST_TEST_TCP_WND_AUTOTUNE */
+#ifdef HOST_TEST_TCP_WND_AUTOTUNE
+#undef TLS_CONFIG_TCP_WND_AUTOTUNE
+#define TLS_CONFIG_TCP_WND_AUTOTUNE     CFG_ON
+#endif
+
+/* the soft AP DHCP server's saved leases, for the programs built with -DHOST_TEST_DHCPS_LEASE_SAVE */
+#ifdef HOST_TEST_DHCPS_LEASE_SAVE
+#undef TLS_CONFIG_DHCPS_LEASE_SAVE
+#define TLS_CONFIG_DHCPS_LEASE_SAVE     CFG_ON
+#endif
+
+/* the soft AP DNS server's upstream forwarding, for the programs built with -DHOST_TEST_DNSS_FORWARD */
+#ifdef HOST_TEST_DNSS_FORWARD
+#undef TLS_CONFIG_DNSS_FORWARD
+#define TLS_CONFIG_DNSS_FORWARD         CFG_ON
+#endif
+
+#endif
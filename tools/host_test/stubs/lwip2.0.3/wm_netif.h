@@ -0,0 +1,2 @@
+/* the lwIP 2.0.3 netif api header, as the target build picks it */
+#include "wm_netif2.0.3.h"
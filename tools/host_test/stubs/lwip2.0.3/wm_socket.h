@@ -0,0 +1,2 @@
+/* the lwIP 2.0.3 netconn header, as the target build picks it */
+#include "wm_socket2.0.3.h"
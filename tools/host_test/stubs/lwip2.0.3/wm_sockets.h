@@ -0,0 +1,2 @@
+/* the lwIP 2.0.3 socket api header, as the target build picks it */
+#include "wm_sockets2.0.3.h"
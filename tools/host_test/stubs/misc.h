@@ -0,0 +1,40 @@
+/*
+ * host stand-in for the Cortex-M3 core registers. SysTick and SCB are plain
+ * memory, the test models the counter where time passes (__WFI).
+ */
+#ifndef HOST_TEST_MISC_H
+#define HOST_TEST_MISC_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+extern SysTick_Type host_systick;
+extern SCB_Type host_scb;
+#define SysTick                     (&host_systick)
+#define SCB                         (&host_scb)
+
+#define SysTick_CTRL_COUNTFLAG_Msk  (1UL << 16)
+#define SysTick_CTRL_TICKINT_Msk    (1UL << 1)
+#define SysTick_CTRL_ENABLE_Msk     (1UL << 0)
+#define SysTick_LOAD_RELOAD_Msk     (0xFFFFFFUL)
+#define SCB_ICSR_PENDSTSET_Msk      (1UL << 26)
+
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+#define __DSB()
+#define __ISB()
+
+#endif
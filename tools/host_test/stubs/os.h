@@ -0,0 +1,11 @@
+/* host stand-in for os.h, heap from the C library */
+#ifndef HOST_TEST_OS_H
+#define HOST_TEST_OS_H
+
+#include <stdlib.h>
+#include "wm_type_def.h"
+
+#define tls_mem_alloc(size)     malloc(size)
+#define tls_mem_free(p)         free(p)
+
+#endif
@@ -0,0 +1,12 @@
+/* host stand-in for the kernel calls made by the tickless idle hook */
+#ifndef HOST_TEST_TASK_H
+#define HOST_TEST_TASK_H
+
+#include "FreeRTOS.h"
+
+void vTaskSuspendAll(void);
+signed long xTaskResumeAll(void);
+portTickType xTaskGetExpectedIdleTime(void);
+void vTaskStepTick(portTickType ticks);
+
+#endif
@@ -0,0 +1,16 @@
+/* the tree's configuration with the options under test switched on */
+#ifndef HOST_TEST_WM_CONFIG_H
+#define HOST_TEST_WM_CONFIG_H
+
+#include "../../../include/wm_config.h"
+
+#undef TLS_CONFIG_TICKLESS_IDLE
+#define TLS_CONFIG_TICKLESS_IDLE        CFG_ON
+#undef TLS_CONFIG_HTTP_FWUP_RANGE
+#define TLS_CONFIG_HTTP_FWUP_RANGE      CFG_ON
+#undef TLS_CONFIG_HTTP_CLIENT_POOL
+#define TLS_CONFIG_HTTP_CLIENT_POOL     CFG_ON
+#undef TLS_CONFIG_MQTT_SESSION
+#define TLS_CONFIG_MQTT_SESSION         CFG_ON
+
+#endif
@@ -0,0 +1,9 @@
+/* host stand-in for the flash driver, the test provides the functions */
+#ifndef HOST_TEST_WM_FLASH_H
+#define HOST_TEST_WM_FLASH_H
+
+#include "wm_type_def.h"
+
+int tls_fls_read(u32 addr, u8 *buf, u32 len);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_TEST_WM_PMU_H
+#define HOST_TEST_WM_PMU_H
+
+#include "wm_type_def.h"
+
+typedef void (*tls_pmu_irq_callback)(void *arg);
+
+void tls_pmu_timer1_isr_register(tls_pmu_irq_callback callback, void *arg);
+void tls_pmu_timer1_start(u16 msec);
+void tls_pmu_timer1_stop(void);
+int tls_pmu_timer1_expired(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_TEST_WM_RTC_H
+#define HOST_TEST_WM_RTC_H
+
+#include <time.h>
+
+void tls_set_rtc(struct tm *tblock);
+void tls_get_rtc(struct tm *tblock);
+
+#endif
@@ -0,0 +1,9 @@
+/* host stand-in for the socket api, only its types are needed */
+#ifndef HOST_TEST_WM_SOCKET_H
+#define HOST_TEST_WM_SOCKET_H
+
+#include "wm_type_def.h"
+
+struct pbuf;
+
+#endif
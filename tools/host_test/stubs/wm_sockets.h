@@ -0,0 +1,20 @@
+/* host stand-in for the lwIP socket api, the host's own sockets */
+#ifndef HOST_TEST_WM_SOCKETS_H
+#define HOST_TEST_WM_SOCKETS_H
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define closesocket(s)          close(s)
+#define ioctlsocket(s, c, a)    ioctl(s, c, a)
+
+#endif
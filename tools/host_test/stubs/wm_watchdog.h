@@ -0,0 +1,6 @@
+#ifndef HOST_TEST_WM_WATCHDOG_H
+#define HOST_TEST_WM_WATCHDOG_H
+
+void tls_watchdog_clr(void);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef HOST_TEST_WM_WL_TIMERS_H
+#define HOST_TEST_WM_WL_TIMERS_H
+
+#include "wm_type_def.h"
+
+typedef void (* tls_timeout_handler)(void *arg);
+
+u32 tls_timeouts_next_p(void);
+void tls_timeout_p(u8 timeo_assigned, u32 msecs, tls_timeout_handler handler, void *arg);
+
+#endif
@@ -0,0 +1,489 @@
+/*
+ * The soft AP DHCP server with TLS_CONFIG_DHCPS_LEASE_SAVE: a bind only
+ * marks the lease table dirty and the server's tick writes it to the flash,
+ * at most once in DHCPS_LEASE_FLUSH_TICKS.
+ *
+ * Hundreds of stations come and go over the 8 addresses of the pool, each
+ * one through DISCOVER, OFFER, REQUEST and ACK, and the bound ones renew.
+ * No address may be given to two stations at once, the flash is written no
+ * more often than the bound, and once the table is quiet the flash holds
+ * it. DHCPS_Stop saves what the tick has not, and the next start gives the
+ * stations of the saved table their addresses back.
+ */
+#include "host_test.h"
+#include "../../src/app/dhcpserver/dhcp_server.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include <stdlib.h>
+
+#define STATIONS        300
+#define SECONDS         7200
+#define QUIET           (DHCPS_LEASE_FLUSH_TICKS + 2)
+#define AP_IP           0x0104A8C0UL
+#define AP_MASK         0x00FFFFFFUL
+#define POOL_FIRST      2
+#define POOL_SIZE       DHCPS_HISTORY_CLIENT_NUM
+/* _GetStaList() asks for a 64 byte list */
+#define AUTHED_MAX      (64 / ETH_ALEN)
+
+const ip_addr_t ip_addr_broadcast = IPADDR4_INIT(IPADDR_BROADCAST);
+
+static u8 ap_mac[ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x01};
+static struct netif ap_netif;
+
+static struct tls_param_dhcps_lease flash_lease;
+static int flash_writes;
+
+static sys_timeout_handler tick_handler;
+
+/* the last reply of the server */
+static u8 reply_type;
+static u32 reply_yiaddr;
+
+static struct station {
+    u8 mac[ETH_ALEN];
+    u8 authed;
+    u8 bound;
+    u32 ip;
+} stations[STATIONS];
+
+static int authed_count;
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+int tls_param_get(int id, void *argv, bool from_flash)
+{
+    memcpy(argv, &flash_lease, sizeof(flash_lease));
+    return 0;
+}
+
+int tls_param_set(int id, void *argv, bool to_flash)
+{
+    HT_CHECK_EQ(id, TLS_PARAM_ID_DHCPS_LEASE);
+    HT_CHECK(to_flash);
+    memcpy(&flash_lease, argv, sizeof(flash_lease));
+    flash_writes++;
+    return 0;
+}
+
+void tls_wifi_get_authed_sta_info(u32 *sta_num, u8 *buf, u32 buf_size)
+{
+    int i;
+
+    *sta_num = 0;
+    for (i = 0; i < STATIONS && (*sta_num + 1) * ETH_ALEN <= buf_size; i++)
+    {
+        if (stations[i].authed)
+            memcpy(buf + (*sta_num)++ * ETH_ALEN, stations[i].mac, ETH_ALEN);
+    }
+}
+
+u8 *wpa_supplicant_get_mac(void)
+{
+    return ap_mac;
+}
+
+struct netif *tls_get_netif(void)
+{
+    return &ap_netif;
+}
+
+void sys_timeout_p(u8 timeo_assigned, u32_t msecs, sys_timeout_handler handler, void *arg)
+{
+    tick_handler = handler;
+}
+
+void sys_untimeout_p(u8 timeo_assigned, sys_timeout_handler handler, void *arg)
+{
+    tick_handler = NULL;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    return calloc(1, sizeof(struct udp_pcb));
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    return ERR_OK;
+}
+
+err_t udp_bind_multicast_netif(struct udp_pcb *pcb, ip_addr_t *ipaddr)
+{
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+}
+
+err_t etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr, u8_t flags)
+{
+    return ERR_OK;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    struct pbuf *p = calloc(1, sizeof(*p) + length);
+
+    if (p)
+    {
+        p->payload = p + 1;
+        p->len = p->tot_len = length;
+    }
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    free(p);
+    return 1;
+}
+
+void pbuf_realloc(struct pbuf *p, u16_t new_len)
+{
+    p->len = p->tot_len = new_len;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    memcpy(buf->payload, dataptr, len);
+    return ERR_OK;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    if (len > buf->len - offset)
+        len = buf->len - offset;
+    memcpy(dataptr, (u8_t *)buf->payload + offset, len);
+    return len;
+}
+
+/* the server's replies; the message type is the first option it puts */
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    PDHCP_MSG pMsg = p->payload;
+
+    HT_CHECK_EQ(pMsg->Options[0], DHCP_OPTION_ID_MSG_TYPE);
+    reply_type = pMsg->Options[2];
+    reply_yiaddr = pMsg->Yiaddr;
+    return ERR_OK;
+}
+
+/* a client message through the server's receive callback, the reply type back */
+static u8 client_send(struct station *sta, u8 type, u32 req_ip, u32 server_id)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(DHCP_MSG), PBUF_RAM);
+    PDHCP_MSG pMsg = p->payload;
+    u8 *opt = pMsg->Options;
+
+    pMsg->Op = DHCP_OP_REQUEST;
+    pMsg->HType = DHCP_HWTYPE_ETHERNET;
+    pMsg->HLen = ETH_ALEN;
+    pMsg->Xid = htonl(ht_rand());
+    pMsg->Flags = htons(0x8000);
+    memcpy(pMsg->Chaddr, sta->mac, ETH_ALEN);
+    pMsg->Magic = htonl(DHCP_MAGIC);
+    *opt++ = DHCP_OPTION_ID_MSG_TYPE;
+    *opt++ = 1;
+    *opt++ = type;
+    if (req_ip)
+    {
+        *opt++ = DHCP_OPTION_ID_REQ_IP_ADDR;
+        *opt++ = 4;
+        memcpy(opt, &req_ip, 4);
+        opt += 4;
+    }
+    if (server_id)
+    {
+        *opt++ = DHCP_OPTION_ID_SERVER_ID;
+        *opt++ = 4;
+        memcpy(opt, &server_id, 4);
+        opt += 4;
+    }
+    *opt = DHCP_OPTION_ID_END;
+
+    reply_type = 0;
+    DHCPS_RecvCb(NULL, NULL, p, NULL, DHCP_CLIENT_UDP_PORT);
+    return reply_type;
+}
+
+static int in_pool(u32 ip)
+{
+    u32 host = ntohl(ip) & 0xFF;
+
+    return (ip & AP_MASK) == (AP_IP & AP_MASK) && host >= POOL_FIRST && host < POOL_FIRST + POOL_SIZE;
+}
+
+/* DISCOVER and REQUEST the offer; 1 when bound */
+static int station_join(struct station *sta)
+{
+    u32 ip;
+    int i;
+
+    if (client_send(sta, DHCP_MSG_DISCOVER, sta->ip, 0) != DHCP_MSG_OFFER)
+        return 0;
+    ip = reply_yiaddr;
+    HT_CHECK(in_pool(ip));
+    if (client_send(sta, DHCP_MSG_REQUEST, ip, AP_IP) != DHCP_MSG_ACK)
+        return 0;
+    HT_CHECK_EQ(reply_yiaddr, ip);
+
+    /* nobody else holds it */
+    for (i = 0; i < STATIONS; i++)
+    {
+        if (stations[i].bound && &stations[i] != sta)
+            HT_CHECK(stations[i].ip != ip);
+    }
+    sta->ip = ip;
+    sta->bound = 1;
+    return 1;
+}
+
+static void station_auth(struct station *sta)
+{
+    if (!sta->authed)
+    {
+        sta->authed = 1;
+        authed_count++;
+    }
+}
+
+/* off the air; the server frees its address on the next tick */
+static void station_leave(struct station *sta)
+{
+    if (sta->authed)
+    {
+        sta->authed = 0;
+        authed_count--;
+    }
+    sta->bound = 0;
+}
+
+/* the first station on the air from a random one on, NULL if none */
+static struct station *station_any_authed(void)
+{
+    int i = ht_rand() % STATIONS;
+    int n;
+
+    for (n = 0; n < STATIONS; n++, i = (i + 1) % STATIONS)
+    {
+        if (stations[i].authed)
+            return &stations[i];
+    }
+    return NULL;
+}
+
+static void tick(void)
+{
+    HT_CHECK(tick_handler != NULL);
+    if (tick_handler)
+        tick_handler(NULL);
+}
+
+static void server_start(void)
+{
+    HT_CHECK_EQ(DHCPS_Start(&ap_netif), DHCPS_ERR_SUCCESS);
+}
+
+/* the flash holds the bound and history entries of the server, in table order */
+static void check_flash_is_table(void)
+{
+    PDHCP_CLIENT pClient;
+    int n = 0;
+    int i;
+
+    for (i = 0; i < DHCPS_HISTORY_CLIENT_NUM; i++)
+    {
+        pClient = &DhcpServer.Clients[i];
+        if ((pClient->State == DHCP_CLIENT_STATE_BIND || pClient->State == DHCP_CLIENT_STATE_IDLE) &&
+            !_MacIsZero(pClient->MacAddr))
+        {
+            HT_CHECK(n < flash_lease.count);
+            if (n >= flash_lease.count)
+                return;
+            HT_CHECK(memcmp(flash_lease.lease[n].mac, pClient->MacAddr, ETH_ALEN) == 0);
+            HT_CHECK(memcmp(flash_lease.lease[n].ip, &pClient->IpAddr.addr, 4) == 0);
+            n++;
+        }
+    }
+    HT_CHECK_EQ(n, flash_lease.count);
+}
+
+static int station_saved(struct station *sta)
+{
+    int i;
+
+    for (i = 0; i < flash_lease.count; i++)
+    {
+        if (memcmp(flash_lease.lease[i].mac, sta->mac, ETH_ALEN) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* a pool full of stations binding in one tick costs one write, on the next tick */
+static void test_burst(void)
+{
+    int writes;
+    int i;
+
+    server_start();
+    writes = flash_writes;
+    for (i = 0; i < POOL_SIZE; i++)
+    {
+        station_auth(&stations[i]);
+        HT_CHECK(station_join(&stations[i]));
+    }
+    HT_CHECK_EQ(flash_writes, writes);
+    tick();
+    HT_CHECK_EQ(flash_writes, writes + 1);
+    check_flash_is_table();
+
+    /* renewing changes nothing to save */
+    for (i = 0; i < POOL_SIZE; i++)
+        HT_CHECK_EQ(client_send(&stations[i], DHCP_MSG_REQUEST, stations[i].ip, 0), DHCP_MSG_ACK);
+    for (i = 0; i < QUIET; i++)
+        tick();
+    HT_CHECK_EQ(flash_writes, writes + 1);
+
+    for (i = 0; i < POOL_SIZE; i++)
+        station_leave(&stations[i]);
+    tick();
+    DHCPS_Stop();
+}
+
+/* stations come and go for SECONDS ticks */
+static void test_churn(void)
+{
+    struct station *sta;
+    int binds = 0, joins = 0;
+    int writes, t, i;
+
+    ht_seed = 47;
+    server_start();
+    writes = flash_writes;
+    for (t = 0; t < SECONDS; t++)
+    {
+        for (i = ht_rand_range(0, 4); i > 0; i--)
+        {
+            sta = &stations[ht_rand() % STATIONS];
+            switch (ht_rand() % 4)
+            {
+            case 0:
+            case 1:
+                /* the list of authenticated stations is limited, as on the air */
+                if (!sta->authed && authed_count < AUTHED_MAX)
+                {
+                    station_auth(sta);
+                    joins++;
+                    binds += station_join(sta);
+                }
+                break;
+            case 2:
+                sta = station_any_authed();
+                if (sta)
+                    station_leave(sta);
+                break;
+            default:
+                sta = station_any_authed();
+                if (sta && sta->bound)
+                    HT_CHECK_EQ(client_send(sta, DHCP_MSG_REQUEST, sta->ip, 0), DHCP_MSG_ACK);
+                break;
+            }
+        }
+        tick();
+        HT_CHECK(flash_writes - writes <= t / DHCPS_LEASE_FLUSH_TICKS + 1);
+        if (ht_failed)
+            break;
+    }
+    printf("%d stations, %d joins, %d binds in %d s: %d flash writes\n",
+           STATIONS, joins, binds, SECONDS, flash_writes - writes);
+    HT_CHECK(binds > 1000);
+    HT_CHECK(flash_writes - writes > 0);
+
+    /* once quiet the flash catches up with the table */
+    for (t = 0; t < QUIET; t++)
+        tick();
+    check_flash_is_table();
+    HT_CHECK(!DhcpServer.LeaseDirty);
+
+    for (i = 0; i < STATIONS; i++)
+        station_leave(&stations[i]);
+    tick();
+    DHCPS_Stop();
+}
+
+/* a bind right before the stop is saved by the stop, and given back on the next start */
+static void test_stop_restart(void)
+{
+    struct station *sta = NULL;
+    u32 ip;
+    int writes;
+    int i;
+
+    server_start();
+    for (i = 0; i < QUIET; i++)
+        tick();
+
+    /* a station the flash does not know */
+    for (i = 0; i < STATIONS && !sta; i++)
+    {
+        if (!station_saved(&stations[i]))
+            sta = &stations[i];
+    }
+    HT_CHECK(sta != NULL);
+    if (!sta)
+        return;
+    sta->ip = 0;
+    station_auth(sta);
+    HT_CHECK(station_join(sta));
+    ip = sta->ip;
+
+    writes = flash_writes;
+    DHCPS_Stop();
+    HT_CHECK_EQ(flash_writes, writes + 1);
+    HT_CHECK(station_saved(sta));
+
+    server_start();
+    HT_CHECK_EQ(flash_writes, writes + 1);
+    sta->bound = 0;
+    sta->ip = 0;
+    HT_CHECK(station_join(sta));
+    HT_CHECK_EQ(sta->ip, ip);
+    station_leave(sta);
+    DHCPS_Stop();
+}
+
+int main(void)
+{
+    int i;
+
+    for (i = 0; i < STATIONS; i++)
+    {
+        stations[i].mac[0] = 0x02;
+        stations[i].mac[3] = 0x47;
+        stations[i].mac[4] = i >> 8;
+        stations[i].mac[5] = i & 0xFF;
+    }
+    ap_netif.ip_addr.addr = AP_IP;
+    ap_netif.netmask.addr = AP_MASK;
+    ap_netif.flags = NETIF_FLAG_UP;
+
+    test_burst();
+    test_churn();
+    test_stop_restart();
+    return ht_done(__FILE__);
+}
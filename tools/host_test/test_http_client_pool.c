@@ -0,0 +1,369 @@
+/*
+ * HTTP client keep-alive pool (TLS_CONFIG_HTTP_CLIENT_POOL) over the host's
+ * sockets against a keep-alive server thread on the loopback interface.
+ * Counts the server's accepts and the client's name lookups to check that
+ * requests to the same host reuse the pooled connection, that responses
+ * without a body (Content-Length 0, 204, 304) and chunked bodies leave the
+ * connection reusable, that Connection: close, HTTP/1.0 and a server that
+ * closed the idle connection are not reused, that the idle time runs out
+ * and that the phase statistics add up.
+ */
+#include <string.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "host_test.h"
+
+/* HTTPClientAuth.h has its own */
+#undef isascii
+#include "../../src/app/httpclient/HTTPClient.c"
+#include "../../src/app/httpclient/HTTPClientString.c"
+
+const unsigned int HZ = 500;
+
+/*-------------------------------------------------------------------------*/
+/* os and heap */
+
+/*
+ * Session handles are pointers stored in a UINT32. The test is linked
+ * without PIE, so an arena in .bss stays below 4 GB.
+ */
+#define ARENA_SIZE      (8 * 1024 * 1024)
+
+static unsigned char arena[ARENA_SIZE] __attribute__((aligned(16)));
+static size_t arena_used;
+static int allocs;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static u32 now_ticks;
+
+void *mem_alloc_debug(u32 size)
+{
+    void *p = NULL;
+
+    pthread_mutex_lock(&lock);
+    size = (size + 15) & ~15u;
+    if (arena_used + size <= ARENA_SIZE)
+    {
+        p = arena + arena_used;
+        arena_used += size;
+        allocs++;
+    }
+    pthread_mutex_unlock(&lock);
+    return p;
+}
+
+void mem_free_debug(void *p)
+{
+    if (p == NULL)
+        return;
+    pthread_mutex_lock(&lock);
+    allocs--;
+    pthread_mutex_unlock(&lock);
+}
+
+u32 tls_os_set_critical(void)
+{
+    pthread_mutex_lock(&lock);
+    return 0;
+}
+
+void tls_os_release_critical(u32 cpu_sr)
+{
+    (void)cpu_sr;
+    pthread_mutex_unlock(&lock);
+}
+
+u32 tls_os_get_time(void)
+{
+    return now_ticks;
+}
+
+/*-------------------------------------------------------------------------*/
+/* wrapper, without the target's resolver */
+
+static int lookups;
+
+int HTTPWrapperIsAscii(int c) { return (unsigned)c < 128; }
+int HTTPWrapperToUpper(int c) { return toupper(c); }
+int HTTPWrapperToLower(int c) { return tolower(c); }
+int HTTPWrapperIsAlpha(int c) { return isalpha(c); }
+int HTTPWrapperIsAlNum(int c) { return isalnum(c); }
+void HTTPWrapperInitRandomeNumber(void) { }
+int HTTPWrapperGetRandomeNumber(void) { return ht_rand() % 16; }
+long HTTPWrapperGetUpTime(void) { return tls_os_get_time(); }
+int HTTPWrapperGetSocketError(int s) { (void)s; return errno; }
+int HTTPWrapperShutDown(int s, int in) { return shutdown(s, in); }
+
+char *HTTPWrapperItoa(char *buff, int i)
+{
+    sprintf(buff, "%d", i);
+    return buff;
+}
+
+unsigned long HTTPWrapperGetHostByName(char *name, unsigned long *address)
+{
+    lookups++;
+    *address = inet_addr(name);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/* server, a thread per connection */
+
+static int listen_fd;
+static int port;
+static int accepts;
+static int served;
+
+static const char *response_for(const char *path, int *close_after)
+{
+    *close_after = 0;
+    if (strcmp(path, "/len") == 0)
+        return "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    if (strcmp(path, "/empty") == 0)
+        return "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    if (strcmp(path, "/nocontent") == 0)
+        return "HTTP/1.1 204 No Content\r\n\r\n";
+    if (strcmp(path, "/notmod") == 0)
+        return "HTTP/1.1 304 Not Modified\r\nETag: \"1\"\r\n\r\n";
+    if (strcmp(path, "/chunked") == 0)
+        return "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "3\r\nhel\r\n2\r\nlo\r\n0\r\n\r\n";
+    if (strcmp(path, "/close") == 0)
+        return "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 5\r\n\r\nhello";
+    if (strcmp(path, "/http10") == 0)
+        return "HTTP/1.0 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    if (strcmp(path, "/short") == 0)
+        return "HTTP/1.1 200 OK\r\nKeep-Alive: timeout=3, max=10\r\nContent-Length: 5\r\n\r\nhello";
+    if (strcmp(path, "/drop") == 0)
+    {
+        /* answers as keep-alive, then closes anyway */
+        *close_after = 1;
+        return "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    }
+    return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+}
+
+static void *conn_thread(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char buf[2048];
+    char path[64];
+    const char *resp;
+    char *end;
+    int have = 0;
+    int close_after;
+    int n;
+
+    for (;;)
+    {
+        while ((end = memmem(buf, have, "\r\n\r\n", 4)) == NULL)
+        {
+            n = recv(fd, buf + have, sizeof(buf) - have, 0);
+            if (n <= 0)
+                goto out;
+            have += n;
+        }
+        path[0] = 0;
+        sscanf(buf, "%*s %63s", path);
+        resp = response_for(path, &close_after);
+        n = end + 4 - buf;
+        memmove(buf, buf + n, have - n);
+        have -= n;
+        send(fd, resp, strlen(resp), MSG_NOSIGNAL);
+        __sync_fetch_and_add(&served, 1);
+        if (close_after || strstr(resp, "close") || strncmp(resp, "HTTP/1.0", 8) == 0)
+            break;
+    }
+out:
+    close(fd);
+    return NULL;
+}
+
+static void *server_thread(void *arg)
+{
+    pthread_t t;
+    int fd;
+
+    (void)arg;
+    for (;;)
+    {
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            break;
+        __sync_fetch_and_add(&accepts, 1);
+        pthread_create(&t, NULL, conn_thread, (void *)(intptr_t)fd);
+        pthread_detach(t);
+    }
+    return NULL;
+}
+
+static void server_start(void)
+{
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    pthread_t t;
+    int one = 1;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd, (struct sockaddr *)&sa, sizeof(sa));
+    listen(listen_fd, 16);
+    getsockname(listen_fd, (struct sockaddr *)&sa, &len);
+    port = ntohs(sa.sin_port);
+    pthread_create(&t, NULL, server_thread, NULL);
+    pthread_detach(t);
+}
+
+/*-------------------------------------------------------------------------*/
+
+/* one request, returns the body and the number of new connections and lookups */
+struct result {
+    UINT32 ret;
+    UINT32 status;
+    char body[64];
+    int conns;
+    int dns;
+};
+
+static struct result get(const char *path)
+{
+    HTTP_SESSION_HANDLE session;
+    HTTP_CLIENT info;
+    struct result r;
+    char url[128];
+    UINT32 n;
+    int len = 0;
+    int accepts0 = accepts;
+    int served0 = served;
+
+    memset(&r, 0, sizeof(r));
+    r.dns = lookups;
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", port, path);
+    session = HTTPClientOpenRequest(0);
+    r.ret = HTTPClientSendRequest(session, url, NULL, 0, TRUE, 5, 0);
+    if (r.ret == HTTP_CLIENT_SUCCESS)
+        r.ret = HTTPClientRecvResponse(session, 5);
+    if (r.ret == HTTP_CLIENT_SUCCESS)
+    {
+        memset(&info, 0, sizeof(info));
+        HTTPClientGetInfo(session, &info);
+        r.status = info.HTTPStatusCode;
+        do
+        {
+            n = 0;
+            r.ret = HTTPClientReadData(session, r.body + len, sizeof(r.body) - 1 - len, 5, &n);
+            len += n;
+        } while (r.ret == HTTP_CLIENT_SUCCESS);
+        if (r.ret == HTTP_CLIENT_EOS)
+            r.ret = HTTP_CLIENT_SUCCESS;
+    }
+    HTTPClientCloseRequest(&session);
+
+    /* the server thread counts after its send */
+    while (served == served0)
+        usleep(100);
+    r.conns = accepts - accepts0;
+    r.dns = lookups - r.dns;
+    return r;
+}
+
+static int pooled(void)
+{
+    int i, n = 0;
+
+    for (i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+        n += HttpPool[i].InUse == TRUE;
+    return n;
+}
+
+int main(void)
+{
+    static const char *no_body[] = {"/empty", "/nocontent", "/notmod", "/chunked", "/len"};
+    HTTP_CLIENT_STATS stats;
+    struct result r;
+    unsigned i;
+
+    server_start();
+    HTTPClientGetStats(&stats, TRUE);
+
+    /* the first request connects, the next ones reuse it */
+    r = get("/len");
+    HT_CHECK_EQ(r.ret, HTTP_CLIENT_SUCCESS);
+    HT_CHECK_EQ(r.status, 200);
+    HT_CHECK(strcmp(r.body, "hello") == 0);
+    HT_CHECK_EQ(r.conns, 1);
+    HT_CHECK_EQ(r.dns, 1);
+    HT_CHECK_EQ(pooled(), 1);
+    for (i = 0; i < sizeof(no_body) / sizeof(no_body[0]); i++)
+    {
+        r = get(no_body[i]);
+        HT_CHECK_EQ(r.ret, HTTP_CLIENT_SUCCESS);
+        HT_CHECK_EQ(r.conns, 0);
+        HT_CHECK_EQ(r.dns, 0);
+        HT_CHECK_EQ(pooled(), 1);
+    }
+    r = get("/chunked");
+    HT_CHECK(strcmp(r.body, "hello") == 0);
+    r = get("/nocontent");
+    HT_CHECK_EQ(r.status, 204);
+    HT_CHECK_EQ(r.body[0], 0);
+
+    HTTPClientGetStats(&stats, TRUE);
+    HT_CHECK_EQ(stats.nRequests, 8);
+    HT_CHECK_EQ(stats.nReused, 7);
+    HT_CHECK_EQ(stats.Dns.nCount, 1);
+    HT_CHECK_EQ(stats.Connect.nCount, 1);
+    HT_CHECK_EQ(stats.Send.nCount, 8);
+    HT_CHECK_EQ(stats.Wait.nCount, 8);
+    HT_CHECK_EQ(stats.Body.nCount, 8);
+
+    /* Connection: close and HTTP/1.0 are not pooled, the next request connects */
+    r = get("/close");
+    HT_CHECK(strcmp(r.body, "hello") == 0);
+    HT_CHECK_EQ(r.conns, 0);
+    HT_CHECK_EQ(pooled(), 0);
+    r = get("/http10");
+    HT_CHECK(strcmp(r.body, "hello") == 0);
+    HT_CHECK_EQ(r.conns, 1);
+    HT_CHECK_EQ(pooled(), 0);
+    r = get("/len");
+    HT_CHECK_EQ(r.conns, 1);
+    HT_CHECK_EQ(pooled(), 1);
+
+    /* a connection the server closed while idle is dropped, not used */
+    r = get("/drop");
+    HT_CHECK_EQ(r.conns, 0);
+    HT_CHECK_EQ(pooled(), 1);
+    usleep(20000);
+    r = get("/len");
+    HT_CHECK_EQ(r.ret, HTTP_CLIENT_SUCCESS);
+    HT_CHECK(strcmp(r.body, "hello") == 0);
+    HT_CHECK_EQ(r.conns, 1);
+    HT_CHECK_EQ(r.dns, 1);
+
+    /* the idle time runs out */
+    now_ticks += HTTP_CLIENT_POOL_IDLE * HZ - 1;
+    HTTPClientCloseIdle(FALSE);
+    HT_CHECK_EQ(pooled(), 1);
+    now_ticks += 1;
+    HTTPClientCloseIdle(FALSE);
+    HT_CHECK_EQ(pooled(), 0);
+
+    /* or less if the server says so, timeout=3 keeps it for 2 s */
+    r = get("/short");
+    HT_CHECK_EQ(r.conns, 1);
+    now_ticks += 2 * HZ;
+    r = get("/len");
+    HT_CHECK_EQ(r.conns, 1);
+
+    /* all gone, nothing leaked */
+    HTTPClientCloseIdle(TRUE);
+    HT_CHECK_EQ(pooled(), 0);
+    HT_CHECK_EQ(allocs, 0);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,642 @@
+/*
+ * Ranged, resumable HTTP OTA download (http_fwup_range) against a fake
+ * server behind the HTTPClient API that drops connections, cuts bodies
+ * short and ignores Range now and then, and a fake fwup engine that
+ * programs a flash image sector by sector. Covers fast and slow links,
+ * one and two connections, resuming after failed attempts and after a
+ * power cut, progress saved for another image, and an image the engine
+ * rejects at the end, which must not be resumed.
+ */
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include "host_test.h"
+
+/* keep the per chunk progress lines out of the output */
+#define printf(...)     ((void)0)
+#include "../../src/app/ota/wm_http_fwup.c"
+#undef printf
+
+#define IMG_MAGIC       0xA0FFFF9Fu
+#define SECTOR          INSIDE_FLS_SECTOR_SIZE
+#define BODY_LEN        (50 * SECTOR + 1234)
+
+const unsigned int HZ = 500;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*-------------------------------------------------------------------------*/
+/* os */
+
+static u32 now_ticks;
+
+u32 tls_os_get_time(void)
+{
+    u32 t;
+
+    pthread_mutex_lock(&lock);
+    t = now_ticks;
+    pthread_mutex_unlock(&lock);
+    return t;
+}
+
+static void pass_ticks(u32 ticks)
+{
+    pthread_mutex_lock(&lock);
+    now_ticks += ticks;
+    pthread_mutex_unlock(&lock);
+}
+
+void tls_os_time_delay(u32 ticks)
+{
+    pass_ticks(ticks);
+}
+
+tls_os_status_t tls_os_sem_create(tls_os_sem_t **sem, u32 cnt)
+{
+    sem_t *s = malloc(sizeof(sem_t));
+
+    sem_init(s, 0, cnt);
+    *sem = s;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_delete(tls_os_sem_t *sem)
+{
+    sem_destroy(sem);
+    free(sem);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_acquire(tls_os_sem_t *sem, u32 wait_time)
+{
+    struct timespec ts;
+
+    if (wait_time == 0)
+    {
+        while (sem_wait(sem) && (errno == EINTR))
+            ;
+        return TLS_OS_SUCCESS;
+    }
+    /* a tick of the fake clock is far shorter than a real one */
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return sem_timedwait(sem, &ts) ? TLS_OS_ERROR : TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_release(tls_os_sem_t *sem)
+{
+    sem_post(sem);
+    return TLS_OS_SUCCESS;
+}
+
+struct task_start {
+    void (*entry)(void *param);
+    void *param;
+};
+
+static void *task_main(void *arg)
+{
+    struct task_start start = *(struct task_start *)arg;
+
+    free(arg);
+    start.entry(start.param);
+    return NULL;
+}
+
+tls_os_status_t tls_os_task_create(tls_os_task_t *task, const char *name,
+                                   void (*entry)(void *param), void *param,
+                                   u8 *stk_start, u32 stk_size, u32 prio, u32 flag)
+{
+    struct task_start *start = malloc(sizeof(*start));
+    pthread_t thread;
+
+    start->entry = entry;
+    start->param = param;
+    if (pthread_create(&thread, NULL, task_main, start))
+    {
+        free(start);
+        return TLS_OS_ERROR;
+    }
+    pthread_detach(thread);
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_task_del(u8 prio, void (*freefun)(void))
+{
+    return TLS_OS_SUCCESS;
+}
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+/*-------------------------------------------------------------------------*/
+/* parameters, the saved download progress */
+
+static struct tls_param_fwup_progress param_prog;
+static int param_saves;
+
+int tls_param_get(int id, void *argv, bool from_flash)
+{
+    HT_CHECK_EQ(id, TLS_PARAM_ID_FWUP_PROGRESS);
+    memcpy(argv, &param_prog, sizeof(param_prog));
+    return 0;
+}
+
+int tls_param_set(int id, void *argv, bool to_flash)
+{
+    HT_CHECK_EQ(id, TLS_PARAM_ID_FWUP_PROGRESS);
+    memcpy(&param_prog, argv, sizeof(param_prog));
+    param_saves++;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/* fwup engine: programs whole sectors in order, the sector being filled is
+   lost on a power cut */
+
+static u8 image[sizeof(T_BOOTER) + BODY_LEN];
+static u8 flash[BODY_LEN];
+
+static struct {
+    int active;
+    u32 session;
+    int have_header;
+    u32 received;           /* body bytes taken */
+    u32 programmed;         /* body bytes in flash */
+    u8 sector[SECTOR];
+    int complete;
+    u32 power_cut;          /* body offset where power fails, 0 for never */
+    int bad_crc;            /* the check of the whole image fails */
+    int powered_off;
+    struct tls_param_fwup_progress prog_at_cut;
+} eng;
+
+int tls_fwup_img_header_check(T_BOOTER *img_param)
+{
+    return (img_param->magic_no == IMG_MAGIC) ? TRUE : FALSE;
+}
+
+u32 tls_fwup_enter(enum tls_fwup_image_src image_src)
+{
+    pthread_mutex_lock(&lock);
+    if (eng.active)
+    {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+    eng.active = 1;
+    eng.session++;
+    eng.have_header = 0;
+    eng.received = 0;
+    eng.programmed = 0;
+    eng.complete = 0;
+    pthread_mutex_unlock(&lock);
+    return eng.session;
+}
+
+u32 tls_fwup_enter_resume(enum tls_fwup_image_src image_src, T_BOOTER *booter, u32 offset)
+{
+    u32 session;
+
+    if ((TRUE != tls_fwup_img_header_check(booter)) || (offset % SECTOR))
+        return 0;
+    session = tls_fwup_enter(image_src);
+    if (session)
+    {
+        eng.have_header = 1;
+        eng.received = offset;
+        eng.programmed = offset;
+    }
+    return session;
+}
+
+u32 tls_fwup_programmed_len(u32 session_id)
+{
+    return (session_id == eng.session) ? eng.programmed : 0;
+}
+
+int tls_fwup_request_sync(u32 session_id, u8 *data, u32 data_len)
+{
+    u32 n;
+    int ret = TLS_FWUP_STATUS_OK;
+
+    pthread_mutex_lock(&lock);
+    if (!eng.active || (session_id != eng.session) || eng.powered_off)
+    {
+        ret = TLS_FWUP_STATUS_EPERM;
+        goto out;
+    }
+    if (!eng.have_header)
+    {
+        HT_CHECK_EQ(data_len, sizeof(T_BOOTER));
+        HT_CHECK(memcmp(data, image, sizeof(T_BOOTER)) == 0);
+        eng.have_header = 1;
+        goto out;
+    }
+    HT_CHECK(eng.received + data_len <= BODY_LEN);
+    while (data_len)
+    {
+        if (eng.power_cut && (eng.received >= eng.power_cut))
+        {
+            /* what the device finds after the reboot */
+            eng.powered_off = 1;
+            eng.prog_at_cut = param_prog;
+            ret = TLS_FWUP_STATUS_EPERM;
+            goto out;
+        }
+        n = SECTOR - (eng.received % SECTOR);
+        if (n > data_len)
+            n = data_len;
+        memcpy(eng.sector + (eng.received % SECTOR), data, n);
+        eng.received += n;
+        data += n;
+        data_len -= n;
+        /* checked before the last sector goes to flash */
+        if ((eng.received == BODY_LEN) && eng.bad_crc)
+        {
+            ret = TLS_FWUP_STATUS_ECRC;
+            goto out;
+        }
+        if ((eng.received % SECTOR == 0) || (eng.received == BODY_LEN))
+        {
+            n = eng.received - eng.programmed;
+            memcpy(flash + eng.programmed, eng.sector, n);
+            eng.programmed += n;
+        }
+    }
+    if (eng.received == BODY_LEN)
+        eng.complete = 1;
+out:
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+int tls_fwup_exit(u32 session_id)
+{
+    if (session_id != eng.session)
+        return TLS_FWUP_STATUS_ESESSIONID;
+    eng.active = 0;
+    return TLS_FWUP_STATUS_OK;
+}
+
+static void reboot(void)
+{
+    eng.active = 0;
+    eng.powered_off = 0;
+    eng.power_cut = 0;
+    param_prog = eng.prog_at_cut;
+}
+
+/*-------------------------------------------------------------------------*/
+/* server */
+
+static struct {
+    u32 latency;            /* ticks per request */
+    u32 ticks_per_sector;
+    int fault_percent;      /* of requests that go wrong somehow */
+    u32 body_bytes;         /* image body bytes sent */
+    u32 first_body_start;   /* start of the first range past the header */
+    u32 min_len;            /* body range sizes asked for */
+    u32 max_len;
+    u32 last_len;
+    int requests;
+} srv;
+
+enum fault { FAULT_NONE, FAULT_CONNECT, FAULT_RESPONSE, FAULT_NO_RANGE, FAULT_DROP, FAULT_SHORT };
+
+#define SESSIONS        4
+static struct {
+    int used;
+    u32 start;
+    u32 end;
+    enum fault fault;
+} sess[SESSIONS];
+
+static enum fault roll_fault(void)
+{
+    u32 r;
+
+    pthread_mutex_lock(&lock);
+    r = ht_rand();
+    pthread_mutex_unlock(&lock);
+    if ((int)(r % 100) >= srv.fault_percent)
+        return FAULT_NONE;
+    return (enum fault)(FAULT_CONNECT + (r >> 8) % 5);
+}
+
+HTTP_SESSION_HANDLE HTTPClientOpenRequest(HTTP_CLIENT_SESSION_FLAGS Flags)
+{
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for (i = 0; i < SESSIONS; i++)
+    {
+        if (!sess[i].used)
+        {
+            memset(&sess[i], 0, sizeof(sess[i]));
+            sess[i].used = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    HT_CHECK(i < SESSIONS);
+    return (i < SESSIONS) ? i + 1 : 0;
+}
+
+UINT32 HTTPClientCloseRequest(HTTP_SESSION_HANDLE *pSession)
+{
+    sess[*pSession - 1].used = 0;
+    *pSession = 0;
+    return HTTP_CLIENT_SUCCESS;
+}
+
+UINT32 HTTPClientSetVerb(HTTP_SESSION_HANDLE pSession, HTTP_VERB HttpVerb)
+{
+    HT_CHECK_EQ(HttpVerb, VerbGet);
+    return HTTP_CLIENT_SUCCESS;
+}
+
+UINT32 HTTPClientAddRequestHeaders(HTTP_SESSION_HANDLE pSession, CHAR *pHeaderName, CHAR *pHeaderData, BOOL nInsert)
+{
+    unsigned int start, end;
+
+    HT_CHECK(strcmp(pHeaderName, "Range") == 0);
+    HT_CHECK_EQ(sscanf(pHeaderData, "bytes=%u-%u", &start, &end), 2);
+    HT_CHECK(start <= end);
+    HT_CHECK(end < sizeof(image));
+    sess[pSession - 1].start = start;
+    sess[pSession - 1].end = end;
+    return HTTP_CLIENT_SUCCESS;
+}
+
+UINT32 HTTPClientSendRequest(HTTP_SESSION_HANDLE pSession, CHAR *pUrl, VOID *pData, UINT32 nDataLength, BOOL TotalLength, UINT32 nTimeout, UINT32 nClientPort)
+{
+    sess[pSession - 1].fault = roll_fault();
+    pass_ticks(srv.latency);
+    return (sess[pSession - 1].fault == FAULT_CONNECT) ? HTTP_CLIENT_ERROR_SOCKET_CONNECT : HTTP_CLIENT_SUCCESS;
+}
+
+UINT32 HTTPClientRecvResponse(HTTP_SESSION_HANDLE pSession, UINT32 nTimeout)
+{
+    return (sess[pSession - 1].fault == FAULT_RESPONSE) ? HTTP_CLIENT_ERROR_SOCKET_RECV : HTTP_CLIENT_SUCCESS;
+}
+
+UINT32 HTTPClientGetInfo(HTTP_SESSION_HANDLE pSession, HTTP_CLIENT *HTTPClient)
+{
+    memset(HTTPClient, 0, sizeof(*HTTPClient));
+    HTTPClient->HTTPStatusCode = (sess[pSession - 1].fault == FAULT_NO_RANGE) ? 200 : 206;
+    return HTTP_CLIENT_SUCCESS;
+}
+
+/* hands over full buffers and the rest at the end, like the real one */
+UINT32 HTTPClientReadDataStream(HTTP_SESSION_HANDLE pSession, VOID *pBuffer, UINT32 nBufferSize, UINT32 nTimeout, HTTP_CLIENT_BODY_CB pfnBody, VOID *pArg, UINT32 *nBytesRecived)
+{
+    u32 start = sess[pSession - 1].start;
+    u32 total = sess[pSession - 1].end - start + 1;
+    u32 sent = total;
+    u32 pos = 0;
+    u32 n;
+    UINT32 ret;
+
+    if (start >= sizeof(T_BOOTER))
+    {
+        pthread_mutex_lock(&lock);
+        if (srv.requests == 0)
+            srv.first_body_start = start - sizeof(T_BOOTER);
+        srv.requests++;
+        if (total < srv.min_len)
+            srv.min_len = total;
+        if (total > srv.max_len)
+            srv.max_len = total;
+        srv.last_len = total;
+        pthread_mutex_unlock(&lock);
+    }
+    if ((sess[pSession - 1].fault == FAULT_DROP) || (sess[pSession - 1].fault == FAULT_SHORT))
+        sent = ht_rand() % total;
+    pass_ticks((u64)srv.ticks_per_sector * total / SECTOR);
+
+    while (pos < sent)
+    {
+        n = sent - pos;
+        if (n > nBufferSize)
+            n = nBufferSize;
+        if ((n < nBufferSize) && (pos + n < total) && (sess[pSession - 1].fault == FAULT_DROP))
+            return HTTP_CLIENT_ERROR_SOCKET_RECV;
+        memcpy(pBuffer, image + start + pos, n);
+        pos += n;
+        pthread_mutex_lock(&lock);
+        if (start >= sizeof(T_BOOTER))
+            srv.body_bytes += n;
+        pthread_mutex_unlock(&lock);
+        ret = pfnBody(pArg, pBuffer, n);
+        if (ret != HTTP_CLIENT_SUCCESS)
+            return ret;
+    }
+    if (sess[pSession - 1].fault == FAULT_DROP)
+        return HTTP_CLIENT_ERROR_SOCKET_RECV;
+    return HTTP_CLIENT_EOS;
+}
+
+/* only used by the sequential http_fwup */
+UINT32 HTTPClientFindFirstHeader(HTTP_SESSION_HANDLE pSession, CHAR *pSearchClue, CHAR *pHeaderBuffer, UINT32 *nLength)
+{
+    return HTTP_CLIENT_ERROR_NOT_IMPLEMENTED;
+}
+
+UINT32 HTTPClientFindCloseHeader(HTTP_SESSION_HANDLE pSession)
+{
+    return HTTP_CLIENT_SUCCESS;
+}
+
+/*-------------------------------------------------------------------------*/
+
+static void make_image(u32 seed)
+{
+    T_BOOTER *hdr = (T_BOOTER *)image;
+    u32 i;
+
+    ht_seed = seed;
+    for (i = 0; i < sizeof(image); i++)
+        image[i] = (u8)ht_rand();
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic_no = IMG_MAGIC;
+    hdr->img_type = IMG_TYPE_NEW_PLAIN;
+    hdr->upd_img_len = BODY_LEN;
+    hdr->upd_checksum = seed;
+}
+
+static void new_run(u32 latency, u32 ticks_per_sector, int fault_percent)
+{
+    memset(&srv, 0, sizeof(srv));
+    srv.latency = latency;
+    srv.ticks_per_sector = ticks_per_sector;
+    srv.fault_percent = fault_percent;
+    srv.min_len = 0xFFFFFFFF;
+}
+
+static int download(u8 connections)
+{
+    HTTPParameters params;
+
+    memset(&params, 0, sizeof(params));
+    params.Uri = "http://192.168.1.100/WM_W600_GZ.img";
+    return http_fwup_range(params, connections);
+}
+
+static void check_flashed(void)
+{
+    HT_CHECK(eng.complete);
+    HT_CHECK(memcmp(flash, image + sizeof(T_BOOTER), BODY_LEN) == 0);
+    /* nothing to resume once the image is in */
+    HT_CHECK(!param_prog.valid);
+    HT_CHECK(!eng.active);
+}
+
+/* attempts until one succeeds, each continues where the last one stopped */
+static int download_until_done(u8 connections)
+{
+    u32 saved;
+    int attempts;
+
+    for (attempts = 1; attempts <= 50; attempts++)
+    {
+        saved = param_prog.valid ? param_prog.programmed : 0;
+        srv.requests = 0;
+        if (download(connections) == HTTP_CLIENT_SUCCESS)
+            break;
+        /* progress is kept, an attempt failing on the header has none */
+        HT_CHECK(!eng.active);
+        HT_CHECK(param_prog.valid || !saved);
+        if (param_prog.valid)
+        {
+            HT_CHECK(param_prog.programmed >= saved);
+            HT_CHECK(param_prog.programmed < BODY_LEN);
+            HT_CHECK(param_prog.programmed % SECTOR == 0);
+        }
+    }
+    HT_CHECK(attempts <= 50);
+    return attempts;
+}
+
+int main(void)
+{
+    u32 cut;
+    int attempts;
+    int round;
+    int saves;
+
+    /* fast link: the chunk grows to the maximum */
+    make_image(1);
+    memset(flash, 0xFF, sizeof(flash));
+    new_run(10, 20, 0);
+    HT_CHECK_EQ(download(1), HTTP_CLIENT_SUCCESS);
+    check_flashed();
+    HT_CHECK_EQ(srv.first_body_start, 0);
+    HT_CHECK_EQ(srv.body_bytes, BODY_LEN);
+    HT_CHECK_EQ(srv.min_len, HTTP_FWUP_CHUNK_MIN);
+    HT_CHECK_EQ(srv.max_len, HTTP_FWUP_CHUNK_MAX);
+    HT_CHECK_EQ(srv.last_len % SECTOR, BODY_LEN % SECTOR);
+
+    /* slow link: it stays at the minimum */
+    make_image(2);
+    memset(flash, 0xFF, sizeof(flash));
+    new_run(10, 2 * HZ, 0);
+    HT_CHECK_EQ(download(1), HTTP_CLIENT_SUCCESS);
+    check_flashed();
+    HT_CHECK_EQ(srv.max_len, HTTP_FWUP_CHUNK_MIN);
+
+    /* two connections on a link that goes wrong a lot */
+    for (round = 0; round < 20; round++)
+    {
+        make_image(100 + round);
+        memset(flash, 0xFF, sizeof(flash));
+        new_run(ht_rand_range(1, 300), ht_rand_range(1, 2 * HZ), 25);
+        attempts = download_until_done((round & 1) ? 2 : 1);
+        check_flashed();
+        /* bodies cut short are fetched again, little else is */
+        HT_CHECK(srv.body_bytes >= BODY_LEN - param_prog.programmed);
+        HT_STOP_IF_FAILED();
+        (void)attempts;
+    }
+
+    /* power cuts: the next boot continues from the saved progress */
+    for (round = 0; round < 20; round++)
+    {
+        make_image(200 + round);
+        memset(flash, 0xFF, sizeof(flash));
+        memset(&param_prog, 0, sizeof(param_prog));
+        new_run(10, 20, (round & 2) ? 10 : 0);
+        cut = ht_rand_range(1, BODY_LEN - 1);
+        eng.power_cut = cut;
+        HT_CHECK(download((round & 1) ? 2 : 1) != HTTP_CLIENT_SUCCESS);
+        HT_CHECK(eng.powered_off);
+        reboot();
+        HT_CHECK(!param_prog.valid || (param_prog.programmed <= cut));
+
+        new_run(10, 20, 0);
+        saves = param_saves;
+        HT_CHECK_EQ(download((round & 1) ? 2 : 1), HTTP_CLIENT_SUCCESS);
+        check_flashed();
+        HT_CHECK(param_saves > saves);
+        if (param_saves && eng.prog_at_cut.valid)
+        {
+            HT_CHECK_EQ(srv.first_body_start, eng.prog_at_cut.programmed);
+            HT_CHECK_EQ(srv.body_bytes, BODY_LEN - eng.prog_at_cut.programmed);
+        }
+        HT_STOP_IF_FAILED();
+    }
+
+    /* progress of another image is not used */
+    make_image(300);
+    memset(flash, 0xFF, sizeof(flash));
+    new_run(10, 20, 0);
+    param_prog.valid = 1;
+    param_prog.url_hash = http_fwup_url_hash("http://192.168.1.100/WM_W600_GZ.img");
+    param_prog.img_checksum = 299;
+    param_prog.img_len = BODY_LEN;
+    param_prog.programmed = 8 * SECTOR;
+    HT_CHECK_EQ(download(2), HTTP_CLIENT_SUCCESS);
+    check_flashed();
+    HT_CHECK_EQ(srv.first_body_start, 0);
+    HT_CHECK_EQ(srv.body_bytes, BODY_LEN);
+
+    /* the image fails its crc: the next attempt starts over, not on top of it */
+    for (round = 0; round < 2; round++)
+    {
+        make_image(400 + round);
+        memset(flash, 0xFF, sizeof(flash));
+        memset(&param_prog, 0, sizeof(param_prog));
+        new_run(10, 20, 0);
+        eng.bad_crc = 1;
+        HT_CHECK_EQ(download(round + 1), HTTP_CLIENT_ERROR_BAD_STATE);
+        HT_CHECK(!eng.complete);
+        HT_CHECK(eng.programmed < BODY_LEN);
+        HT_CHECK(!eng.active);
+        HT_CHECK(!param_prog.valid);
+        HT_CHECK(param_saves > 0);
+
+        eng.bad_crc = 0;
+        new_run(10, 20, 0);
+        HT_CHECK_EQ(download(round + 1), HTTP_CLIENT_SUCCESS);
+        check_flashed();
+        HT_CHECK_EQ(srv.first_body_start, 0);
+        HT_CHECK_EQ(srv.body_bytes, BODY_LEN);
+    }
+
+    printf("%d progress saves\n", param_saves);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,129 @@
+/*
+ * lwIP Internet checksum as the target builds it (LWIP_CHKSUM_ALGORITHM 4,
+ * LWIP_CHKSUM_COPY_ALGORITHM 2) against the RFC 1071 sum: random buffers
+ * of odd and even lengths at every offset within a word, and copies between
+ * every source and destination offset, same alignment or not. The copy must
+ * leave the bytes around the destination alone.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/core/inet_chksum.c"
+#include <stdlib.h>
+
+#define MAX_LEN         0xFFFF
+#define GUARD           8
+#define ROUNDS          200000
+
+u16_t lwip_htons(u16_t n)
+{
+    return (u16_t)((n << 8) | (n >> 8));
+}
+
+/* RFC 1071 over bytes in network order, in the host order lwIP returns */
+static u16_t ref_chksum(const u8_t *data, int len)
+{
+    u32_t sum = 0;
+    int i;
+
+    for (i = 0; i + 1 < len; i += 2)
+        sum += (data[i] << 8) | data[i + 1];
+    if (len & 1)
+        sum += data[len - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return lwip_htons((u16_t)sum);
+}
+
+static u8_t src[MAX_LEN + 2 * GUARD];
+static u8_t dst[MAX_LEN + 2 * GUARD];
+static u8_t pattern[MAX_LEN + 2 * GUARD];
+
+/* random bytes, or runs of 0xFF and 0x00 that make the carries */
+static void fill(u8_t *buf, int len)
+{
+    int mode = ht_rand() % 4;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        switch (mode)
+        {
+            case 0:  buf[i] = 0xFF; break;
+            case 1:  buf[i] = ht_rand() % 8 ? 0xFF : ht_rand(); break;
+            default: buf[i] = ht_rand(); break;
+        }
+    }
+}
+
+static int rand_len(void)
+{
+    switch (ht_rand() % 8)
+    {
+        case 0:  return ht_rand_range(0, 16);
+        case 1:  return ht_rand_range(1400, MAX_LEN - GUARD);
+        default: return ht_rand_range(0, 1600);
+    }
+}
+
+static void test_chksum(void)
+{
+    int round;
+    int off;
+    int len;
+
+    for (round = 0; round < ROUNDS; round++)
+    {
+        len = rand_len();
+        off = ht_rand() % GUARD;
+        fill(src + off, len);
+        HT_CHECK_EQ(lwip_standard_chksum(src + off, len), ref_chksum(src + off, len));
+        if (ht_failed > 10)
+            return;
+    }
+}
+
+static void test_copy(void)
+{
+    int round;
+    int soff, doff;
+    int len;
+    u16_t sum;
+
+    for (round = 0; round < ROUNDS; round++)
+    {
+        len = rand_len();
+        soff = ht_rand() % GUARD;
+        doff = ht_rand() % 2 ? soff : (int)(ht_rand() % GUARD);
+        fill(src + soff, len);
+        fill(pattern, len + 2 * GUARD);
+        memcpy(dst, pattern, len + 2 * GUARD);
+
+        sum = lwip_chksum_copy(dst + GUARD + doff, src + soff, len);
+        HT_CHECK_EQ(sum, ref_chksum(src + soff, len));
+        HT_CHECK(memcmp(dst + GUARD + doff, src + soff, len) == 0);
+        HT_CHECK(memcmp(dst, pattern, GUARD + doff) == 0);
+        HT_CHECK(memcmp(dst + GUARD + doff + len, pattern + GUARD + doff + len, GUARD - doff) == 0);
+        if (ht_failed > 10)
+            return;
+    }
+}
+
+int main(void)
+{
+    int len, off;
+
+    /* every short length at every offset */
+    for (len = 0; len < 64; len++)
+    {
+        for (off = 0; off < GUARD; off++)
+        {
+            fill(src + off, len);
+            HT_CHECK_EQ(lwip_standard_chksum(src + off, len), ref_chksum(src + off, len));
+            HT_CHECK_EQ(lwip_chksum_copy(dst + (len + off) % GUARD, src + off, len),
+                        ref_chksum(src + off, len));
+        }
+    }
+
+    test_chksum();
+    test_copy();
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,276 @@
+/*
+ * MQTT packet codec (libemqtt.c): remaining lengths on the 1 to 4 byte
+ * boundaries, PUBLISH, SUBSCRIBE and UNSUBSCRIBE sent through mqttsend and
+ * mqttsendv byte for byte equal to the buffer encoders, and the stream
+ * parser fed the result in pieces of random size, with oversized packets
+ * skipped. Nothing may come from the heap.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "../../src/app/mqtt/libemqtt.c"
+
+#define STREAM_SIZE     (300 * 1024)
+
+static int allocs;
+
+void *mem_alloc_debug(u32 size)
+{
+    allocs++;
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+/* what the broker would receive */
+static uint8_t stream[STREAM_SIZE];
+static uint32_t stream_len;
+static int send_calls;
+
+static int capture(int socket_info, const void *buf, unsigned int count)
+{
+    (void)socket_info;
+    send_calls++;
+    if (stream_len + count > STREAM_SIZE)
+        return -1;
+    memcpy(stream + stream_len, buf, count);
+    stream_len += count;
+    return count;
+}
+
+static int capturev(int socket_info, const mqtt_iovec_t *iov, int iovcnt)
+{
+    int total = 0;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+        total += capture(socket_info, iov[i].base, iov[i].len);
+    send_calls -= iovcnt - 1;
+    return total;
+}
+
+/* packets out of the parser */
+static uint8_t parse_buf[STREAM_SIZE];
+static uint8_t packet[STREAM_SIZE];
+static uint32_t packet_len;
+static int packets;
+
+static void on_packet(void *arg, const uint8_t *p, uint32_t len)
+{
+    (void)arg;
+    memcpy(packet, p, len);
+    packet_len = len;
+    packets++;
+}
+
+/* feed the stream to the parser in random pieces */
+static int feed(mqtt_parser_t *parser, const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+    int got = 0;
+    int ret;
+
+    while (len)
+    {
+        n = ht_rand() % 4 ? ht_rand_range(1, 8) : ht_rand_range(1, 4096);
+        if (n > len)
+            n = len;
+        ret = mqtt_parser_feed(parser, data, n, on_packet, NULL);
+        if (ret < 0)
+            return ret;
+        got += ret;
+        data += n;
+        len -= n;
+    }
+    return got;
+}
+
+static void test_rem_len(void)
+{
+    static const uint32_t values[] = {0, 1, 127, 128, 16383, 16384, 2097151,
+                                      2097152, 268435455};
+    static const uint8_t bytes[] = {1, 1, 1, 2, 2, 3, 3, 4, 4};
+    uint8_t buf[MQTT_MAX_FIXED_HEADER];
+    unsigned i;
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        buf[0] = MQTT_MSG_PUBLISH;
+        HT_CHECK_EQ(mqtt_encode_rem_len(buf + 1, values[i]), bytes[i]);
+        HT_CHECK_EQ(mqtt_num_rem_len_bytes(buf), bytes[i]);
+        HT_CHECK_EQ(mqtt_parse_rem_len(buf), values[i]);
+    }
+    HT_CHECK_EQ(mqtt_encode_rem_len(buf + 1, MQTT_MAX_REM_LEN + 1), 0);
+}
+
+static void test_publish(mqtt_broker_handle_t *broker, int rounds)
+{
+    static uint8_t expect[STREAM_SIZE];
+    static char payload[70000];
+    char topic[400];
+    mqtt_parser_t parser;
+    const uint8_t *ptr;
+    uint8_t *msg = NULL;
+    uint32_t topic_len;
+    uint32_t msg_len;
+    uint16_t id;
+    uint8_t qos;
+    uint8_t retain;
+    int expect_len;
+    int round;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(payload); i++)
+        payload[i] = (char)ht_rand();
+
+    for (round = 0; round < rounds; round++)
+    {
+        topic_len = ht_rand() % 8 ? ht_rand_range(1, 40) : ht_rand_range(200, 399);
+        for (i = 0; i < topic_len; i++)
+            topic[i] = 'a' + ht_rand() % 26;
+        topic[topic_len] = 0;
+        switch (ht_rand() % 4)
+        {
+        case 0:  msg_len = ht_rand_range(0, 16); break;
+        case 1:  msg_len = ht_rand_range(100, 200); break;
+        case 2:  msg_len = ht_rand_range(16000, 17000); break;
+        default: msg_len = ht_rand() % sizeof(payload); break;
+        }
+        qos = ht_rand() % 3;
+        retain = ht_rand() & 1;
+        if (ht_rand() % 64 == 0)
+            broker->seq = 0xFFFF;
+
+        stream_len = 0;
+        send_calls = 0;
+        id = 0;
+        HT_CHECK_EQ(mqtt_publish_with_qos(broker, topic, payload, msg_len, retain, qos, &id), 1);
+        HT_CHECK(qos == 0 || id != 0);
+        /* small parts go out together */
+        if (topic_len <= 40)
+            HT_CHECK(send_calls <= (stream_len > MQTT_SEND_GATHER_SIZE ? 2 : 1));
+
+        expect_len = mqtt_encode_publish(expect, sizeof(expect), topic, payload, msg_len,
+                                         retain, qos, id);
+        HT_CHECK_EQ(expect_len, stream_len);
+        HT_CHECK(memcmp(expect, stream, stream_len) == 0);
+
+        /* parse it back, sometimes with a buffer too small for it */
+        if (ht_rand() % 8 == 0)
+        {
+            mqtt_parser_init(&parser, parse_buf, stream_len - 1);
+            packets = 0;
+            HT_CHECK_EQ(feed(&parser, stream, stream_len), 0);
+            HT_CHECK_EQ(parser.dropped, 1);
+        }
+        mqtt_parser_init(&parser, parse_buf, sizeof(parse_buf));
+        packets = 0;
+        HT_CHECK_EQ(feed(&parser, stream, stream_len), 1);
+        HT_CHECK_EQ(packet_len, stream_len);
+        HT_CHECK_EQ(MQTTParseMessageType(packet), MQTT_MSG_PUBLISH);
+        HT_CHECK_EQ(MQTTParseMessageQos(packet), qos);
+        HT_CHECK_EQ(MQTTParseMessageRetain(packet) != 0, retain);
+        HT_CHECK_EQ(mqtt_parse_pub_topic_ptr(packet, &ptr), topic_len);
+        HT_CHECK(memcmp(ptr, topic, topic_len) == 0);
+        if (qos)
+            HT_CHECK_EQ(mqtt_parse_msg_id(packet), id);
+        HT_CHECK_EQ(mqtt_parse_publish_msg(packet, &msg), msg_len);
+        HT_CHECK(msg_len == 0 || memcmp(msg, payload, msg_len) == 0);
+        if (ht_failed)
+            return;
+    }
+}
+
+static void test_topic_requests(mqtt_broker_handle_t *broker)
+{
+    uint8_t expect[128];
+    uint16_t id;
+    int len;
+
+    stream_len = 0;
+    HT_CHECK_EQ(mqtt_subscribe(broker, "sensors/+/temp", &id), 1);
+    len = mqtt_encode_subscribe(expect, sizeof(expect), "sensors/+/temp", 0, id);
+    HT_CHECK_EQ(len, stream_len);
+    HT_CHECK(memcmp(expect, stream, len) == 0);
+    HT_CHECK_EQ(mqtt_parse_msg_id(stream), id);
+
+    stream_len = 0;
+    HT_CHECK_EQ(mqtt_unsubscribe(broker, "sensors/+/temp", &id), 1);
+    len = mqtt_encode_unsubscribe(expect, sizeof(expect), "sensors/+/temp", id);
+    HT_CHECK_EQ(len, stream_len);
+    HT_CHECK(memcmp(expect, stream, len) == 0);
+    HT_CHECK_EQ(mqtt_parse_msg_id(stream), id);
+}
+
+static void test_connect(mqtt_broker_handle_t *broker)
+{
+    uint8_t buf[MQTT_CONNECT_MAX_SIZE];
+    uint32_t rem;
+    uint8_t rlb;
+
+    stream_len = 0;
+    HT_CHECK_EQ(mqtt_connect(broker), 0);
+    HT_CHECK_EQ(MQTTParseMessageType(stream), MQTT_MSG_CONNECT);
+    rlb = mqtt_num_rem_len_bytes(stream);
+    rem = mqtt_parse_rem_len(stream);
+    HT_CHECK_EQ(1 + rlb + rem, stream_len);
+    /* MQIsdp 3, clean session, user name and password */
+    HT_CHECK(memcmp(stream + 1 + rlb, "\0\6MQIsdp\3", 9) == 0);
+    HT_CHECK_EQ(stream[1 + rlb + 9], MQTT_USERNAME_FLAG | MQTT_PASSWORD_FLAG | MQTT_CLEAN_SESSION);
+    HT_CHECK(memcmp(stream + stream_len - 8, "\0\6secret", 8) == 0);
+
+    /* the longest fields still fit */
+    memset(broker->clientid, 'c', sizeof(broker->clientid) - 1);
+    memset(broker->username, 'u', sizeof(broker->username) - 1);
+    memset(broker->password, 'p', sizeof(broker->password) - 1);
+    HT_CHECK(mqtt_encode_connect(broker, buf, sizeof(buf)) > 0);
+    HT_CHECK_EQ(mqtt_encode_connect(broker, buf, 20), -1);
+}
+
+static void test_parser_sync(void)
+{
+    static const uint8_t bad[] = {MQTT_MSG_PUBLISH, 0x80, 0x80, 0x80, 0x80, 0x01};
+    static const uint8_t ping[] = {MQTT_MSG_PINGRESP, 0x00};
+    uint8_t buf[16];
+    mqtt_parser_t parser;
+
+    /* a fifth length byte */
+    mqtt_parser_init(&parser, buf, sizeof(buf));
+    HT_CHECK_EQ(mqtt_parser_feed(&parser, bad, sizeof(bad), on_packet, NULL), -1);
+
+    /* packets without a body, back to back */
+    mqtt_parser_init(&parser, buf, sizeof(buf));
+    packets = 0;
+    HT_CHECK_EQ(mqtt_parser_feed(&parser, ping, sizeof(ping), on_packet, NULL), 1);
+    HT_CHECK_EQ(mqtt_parser_feed(&parser, ping, 1, on_packet, NULL), 0);
+    HT_CHECK_EQ(mqtt_parser_feed(&parser, ping + 1, 1, on_packet, NULL), 1);
+    HT_CHECK_EQ(packet_len, 2);
+}
+
+int main(void)
+{
+    mqtt_broker_handle_t broker;
+
+    test_rem_len();
+
+    mqtt_init(&broker, "host-test");
+    mqtt_init_auth(&broker, "user", "secret");
+    broker.mqttsend = capture;
+    test_connect(&broker);
+    mqtt_init(&broker, "host-test");
+    broker.mqttsend = capture;
+    test_topic_requests(&broker);
+    test_publish(&broker, 2000);
+
+    /* the same through the scatter send */
+    broker.mqttsendv = capturev;
+    test_publish(&broker, 500);
+    test_topic_requests(&broker);
+
+    test_parser_sync();
+    HT_CHECK_EQ(allocs, 0);
+    return ht_done(__FILE__);
+}
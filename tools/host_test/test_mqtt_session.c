@@ -0,0 +1,587 @@
+/*
+ * MQTT session (mqtt_session.c) over the host's sockets against a fake
+ * broker on the loopback interface. The broker can hold its
+ * acknowledgements, refuse connections and publish to the device. Checks
+ * the inflight window, QoS1 and QoS2 completion, retransmission with DUP,
+ * keep-alive, the RAM and flash offline queues draining in order after a
+ * reconnect, resubscription and suppressed duplicate QoS2 deliveries.
+ * The session timer is driven by the test on a fake clock.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "host_test.h"
+#include "../../src/app/mqtt/libemqtt.c"
+#include "../../src/app/mqtt/mqtt_session.c"
+
+#define INFLIGHT        4
+#define RETRY_MS        1000
+#define KEEPALIVE       10
+#define FLASH_ADDR      0x1F0000
+#define FLASH_LEN       (8 * INSIDE_FLS_SECTOR_SIZE)
+#define MAX_MSGS        1024
+
+const unsigned int HZ = 500;
+
+/*-------------------------------------------------------------------------*/
+/* os */
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static u32 now_ticks;
+
+u32 tls_os_get_time(void)
+{
+    u32 t;
+
+    pthread_mutex_lock(&lock);
+    t = now_ticks;
+    pthread_mutex_unlock(&lock);
+    return t;
+}
+
+static void pass_ticks(u32 ticks)
+{
+    pthread_mutex_lock(&lock);
+    now_ticks += ticks;
+    pthread_mutex_unlock(&lock);
+}
+
+/* the reconnect back-off, a tick of the fake clock is 20 us */
+void tls_os_time_delay(u32 ticks)
+{
+    usleep(ticks * 20);
+}
+
+tls_os_status_t tls_os_sem_create(tls_os_sem_t **sem, u32 cnt)
+{
+    sem_t *s = malloc(sizeof(sem_t));
+
+    sem_init(s, 0, cnt);
+    *sem = s;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_acquire(tls_os_sem_t *sem, u32 wait_time)
+{
+    while (sem_wait(sem))
+        ;
+    return TLS_OS_SUCCESS;
+}
+
+tls_os_status_t tls_os_sem_release(tls_os_sem_t *sem)
+{
+    sem_post(sem);
+    return TLS_OS_SUCCESS;
+}
+
+struct task_start {
+    void (*entry)(void *param);
+    void *param;
+};
+
+static void *task_main(void *arg)
+{
+    struct task_start start = *(struct task_start *)arg;
+
+    free(arg);
+    start.entry(start.param);
+    return NULL;
+}
+
+tls_os_status_t tls_os_task_create(tls_os_task_t *task, const char *name,
+                                   void (*entry)(void *param), void *param,
+                                   u8 *stk_start, u32 stk_size, u32 prio, u32 flag)
+{
+    struct task_start *start = malloc(sizeof(*start));
+    pthread_t thread;
+
+    start->entry = entry;
+    start->param = param;
+    pthread_create(&thread, NULL, task_main, start);
+    pthread_detach(thread);
+    return TLS_OS_SUCCESS;
+}
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+/* the session timer runs when the test calls tick() */
+static tls_timeout_handler tick_fn;
+
+s8 tls_wl_task_run(struct task_parameter *task_param)
+{
+    return 0;
+}
+
+s8 tls_wl_task_add_timeout(struct task_parameter *task_param, u32 msecs,
+                           tls_timeout_handler h, void *arg)
+{
+    tick_fn = h;
+    return 0;
+}
+
+void tls_timeout_p(u8 timeo_assigned, u32 msecs, tls_timeout_handler handler, void *arg)
+{
+    tick_fn = handler;
+}
+
+static void tick(void)
+{
+    tick_fn(NULL);
+}
+
+/*-------------------------------------------------------------------------*/
+/* flash */
+
+static u8 flash[FLASH_LEN];
+static int flash_erases;
+
+int tls_fls_read(u32 addr, u8 *buf, u32 len)
+{
+    memcpy(buf, flash + addr - FLASH_ADDR, len);
+    return TLS_FLS_STATUS_OK;
+}
+
+int tls_fls_write(u32 addr, u8 *buf, u32 len)
+{
+    u32 i;
+
+    /* programming only clears bits */
+    for (i = 0; i < len; i++)
+        flash[addr - FLASH_ADDR + i] &= buf[i];
+    return TLS_FLS_STATUS_OK;
+}
+
+int tls_fls_erase(u32 sector)
+{
+    memset(flash + sector * INSIDE_FLS_SECTOR_SIZE - FLASH_ADDR, 0xFF, INSIDE_FLS_SECTOR_SIZE);
+    flash_erases++;
+    return TLS_FLS_STATUS_OK;
+}
+
+/*-------------------------------------------------------------------------*/
+/* broker */
+
+static struct {
+    int listen_fd;
+    int port;
+    int fd;                         /* current connection, -1 if none */
+    int refuse;                     /* answer CONNECT with "not authorized" */
+    int hold;                       /* keep the acknowledgements back */
+    u16 held_id[MAX_MSGS];
+    u8 held_qos[MAX_MSGS];
+    int held;
+    int max_held;
+    int connects;
+    int subscribes;
+    int pings;
+    int dups;
+    int publishes;                  /* PUBLISH packets, retransmissions included */
+    int first[MAX_MSGS];            /* message numbers in the order first seen */
+    int firsts;
+    u8 seen[MAX_MSGS];
+    int pubcomps;                   /* for the broker's own QoS2 message */
+    int pubrecs;
+} bk;
+
+static pthread_mutex_t brk_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void brk_send(const u8 *packet, int len)
+{
+    if (bk.fd >= 0)
+        send(bk.fd, packet, len, MSG_NOSIGNAL);
+}
+
+static void brk_ack(u8 type, u16 id)
+{
+    u8 packet[4] = {type, 2, id >> 8, id & 0xFF};
+
+    if (type == MQTT_MSG_PUBREL)
+        packet[0] |= MQTT_QOS1_FLAG;
+    brk_send(packet, sizeof(packet));
+}
+
+static void brk_packet(void *arg, const uint8_t *p, uint32_t len)
+{
+    static const u8 connack_ok[] = {MQTT_MSG_CONNACK, 2, 0, 0};
+    static const u8 connack_no[] = {MQTT_MSG_CONNACK, 2, 0, 5};
+    static const u8 suback[] = {MQTT_MSG_SUBACK, 3, 0, 0, 1};
+    static const u8 pingresp[] = {MQTT_MSG_PINGRESP, 0};
+    u8 type = MQTTParseMessageType(p);
+    u8 qos = MQTTParseMessageQos(p);
+    u16 id = mqtt_parse_msg_id(p);
+    const u8 *msg;
+    char num[16];
+    u32 msg_len;
+    int n;
+
+    pthread_mutex_lock(&brk_lock);
+    switch (type)
+    {
+    case MQTT_MSG_CONNECT:
+        if (bk.refuse)
+        {
+            brk_send(connack_no, sizeof(connack_no));
+            break;
+        }
+        bk.connects++;
+        brk_send(connack_ok, sizeof(connack_ok));
+        break;
+    case MQTT_MSG_SUBSCRIBE:
+        bk.subscribes++;
+        brk_send(suback, sizeof(suback));
+        break;
+    case MQTT_MSG_PINGREQ:
+        bk.pings++;
+        brk_send(pingresp, sizeof(pingresp));
+        break;
+    case MQTT_MSG_PUBLISH:
+        bk.publishes++;
+        if (MQTTParseMessageDuplicate(p))
+            bk.dups++;
+        msg_len = mqtt_parse_pub_msg_ptr(p, &msg);
+        memset(num, 0, sizeof(num));
+        memcpy(num, msg, msg_len < sizeof(num) - 1 ? msg_len : sizeof(num) - 1);
+        n = atoi(num);
+        if (n >= 0 && n < MAX_MSGS && !bk.seen[n])
+        {
+            bk.seen[n] = 1;
+            bk.first[bk.firsts++] = n;
+        }
+        if (qos == 0)
+            break;
+        if (bk.hold)
+        {
+            for (n = 0; n < bk.held; n++)
+            {
+                if (bk.held_id[n] == id)
+                    break;
+            }
+            if (n == bk.held)
+            {
+                bk.held_id[bk.held] = id;
+                bk.held_qos[bk.held++] = qos;
+            }
+            if (bk.held > bk.max_held)
+                bk.max_held = bk.held;
+            break;
+        }
+        brk_ack(qos == 1 ? MQTT_MSG_PUBACK : MQTT_MSG_PUBREC, id);
+        break;
+    case MQTT_MSG_PUBREL:
+        brk_ack(MQTT_MSG_PUBCOMP, id);
+        break;
+    case MQTT_MSG_PUBREC:
+        bk.pubrecs++;
+        break;
+    case MQTT_MSG_PUBCOMP:
+        bk.pubcomps++;
+        break;
+    }
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static void *brk_thread(void *arg)
+{
+    static u8 buf[4096];
+    mqtt_parser_t parser;
+    u8 chunk[512];
+    int fd;
+    int n;
+
+    for (;;)
+    {
+        fd = accept(bk.listen_fd, NULL, NULL);
+        if (fd < 0)
+            break;
+        pthread_mutex_lock(&brk_lock);
+        bk.fd = fd;
+        pthread_mutex_unlock(&brk_lock);
+        mqtt_parser_init(&parser, buf, sizeof(buf));
+        while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+            mqtt_parser_feed(&parser, chunk, n, brk_packet, NULL);
+        pthread_mutex_lock(&brk_lock);
+        bk.fd = -1;
+        close(fd);
+        pthread_mutex_unlock(&brk_lock);
+    }
+    return NULL;
+}
+
+static void brk_start(void)
+{
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    pthread_t t;
+
+    bk.fd = -1;
+    bk.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(bk.listen_fd, (struct sockaddr *)&sa, sizeof(sa));
+    listen(bk.listen_fd, 4);
+    getsockname(bk.listen_fd, (struct sockaddr *)&sa, &len);
+    bk.port = ntohs(sa.sin_port);
+    pthread_create(&t, NULL, brk_thread, NULL);
+    pthread_detach(t);
+}
+
+/* acknowledge what was held back and stop holding */
+static void brk_release(void)
+{
+    int i;
+
+    pthread_mutex_lock(&brk_lock);
+    for (i = 0; i < bk.held; i++)
+        brk_ack(bk.held_qos[i] == 1 ? MQTT_MSG_PUBACK : MQTT_MSG_PUBREC, bk.held_id[i]);
+    bk.held = 0;
+    bk.hold = 0;
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static void brk_drop(void)
+{
+    pthread_mutex_lock(&brk_lock);
+    if (bk.fd >= 0)
+        shutdown(bk.fd, SHUT_RDWR);
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static void brk_publish(u8 qos, u16 id, const char *msg)
+{
+    u8 packet[64];
+    int len;
+
+    len = mqtt_encode_publish(packet, sizeof(packet), "cmd/led", msg, strlen(msg), 0, qos, id);
+    pthread_mutex_lock(&brk_lock);
+    brk_send(packet, len);
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static void brk_pubrel(u16 id)
+{
+    pthread_mutex_lock(&brk_lock);
+    brk_ack(MQTT_MSG_PUBREL, id);
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static int brk_get(int *field)
+{
+    int v;
+
+    pthread_mutex_lock(&brk_lock);
+    v = *field;
+    pthread_mutex_unlock(&brk_lock);
+    return v;
+}
+
+/*-------------------------------------------------------------------------*/
+
+static int delivered;
+static char delivered_msg[32];
+static u8 delivered_qos;
+static int state_changes;
+
+static void on_msg(void *arg, const char *topic, u16 topic_len,
+                   const u8 *msg, u32 msg_len, u8 qos)
+{
+    pthread_mutex_lock(&brk_lock);
+    delivered++;
+    memcpy(delivered_msg, msg, msg_len < sizeof(delivered_msg) - 1 ? msg_len : sizeof(delivered_msg) - 1);
+    delivered_qos = qos;
+    pthread_mutex_unlock(&brk_lock);
+}
+
+static void on_state(void *arg, u8 connected)
+{
+    __sync_fetch_and_add(&state_changes, 1);
+}
+
+/* wait up to 5 s of real time for a condition */
+#define WAIT_FOR(cond) do { \
+        int ht_ms; \
+        for (ht_ms = 0; ht_ms < 5000 && !(cond); ht_ms++) \
+            usleep(1000); \
+    } while (0)
+
+static mqtt_session_stats_t stats(void)
+{
+    mqtt_session_stats_t s;
+
+    mqtt_session_get_stats(&s);
+    return s;
+}
+
+static int next_msg;
+
+static void publish(int count, u8 qos)
+{
+    char msg[48];
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        /* the message number, padded to a few sizes */
+        snprintf(msg, sizeof(msg), "%d%.*s", next_msg++, (int)(ht_rand() % 30),
+                 "                              ");
+        HT_CHECK_EQ(mqtt_session_publish("sensors/room1", msg, strlen(msg), qos, 0), 0);
+    }
+}
+
+static int in_order(void)
+{
+    int i;
+
+    for (i = 1; i < bk.firsts; i++)
+    {
+        if (bk.first[i] != bk.first[i - 1] + 1)
+            return 0;
+    }
+    return bk.firsts == next_msg && bk.first[0] == 0;
+}
+
+int main(void)
+{
+    mqtt_session_config_t cfg;
+    mqtt_session_stats_t s;
+    int acked;
+
+    memset(flash, 0xFF, sizeof(flash));
+    brk_start();
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.host = "127.0.0.1";
+    cfg.port = bk.port;
+    cfg.clientid = "host-test";
+    cfg.keepalive = KEEPALIVE;
+    cfg.inflight = INFLIGHT;
+    cfg.retry_ms = RETRY_MS;
+    cfg.queue_size = 2048;
+    cfg.flash_addr = FLASH_ADDR;
+    cfg.flash_len = FLASH_LEN;
+    cfg.on_msg = on_msg;
+    cfg.on_state = on_state;
+    HT_CHECK_EQ(mqtt_session_start(&cfg), 0);
+    HT_CHECK_EQ(mqtt_session_start(&cfg), -1);
+    HT_CHECK_EQ(mqtt_session_subscribe("cmd/#", 1), 0);
+    WAIT_FOR(mqtt_session_connected() && brk_get(&bk.subscribes) == 1);
+    HT_CHECK(mqtt_session_connected());
+    HT_CHECK_EQ(brk_get(&bk.connects), 1);
+    HT_CHECK_EQ(brk_get(&bk.subscribes), 1);
+    HT_STOP_IF_FAILED();
+
+    /* the window stops at INFLIGHT unacknowledged messages */
+    bk.hold = 1;
+    publish(20, 1);
+    WAIT_FOR(brk_get(&bk.held) == INFLIGHT);
+    usleep(20000);
+    HT_CHECK_EQ(brk_get(&bk.held), INFLIGHT);
+    s = stats();
+    HT_CHECK_EQ(s.inflight, INFLIGHT);
+    HT_CHECK_EQ(s.queued, 20 - INFLIGHT);
+    brk_release();
+    WAIT_FOR(stats().acked == 20);
+    HT_CHECK_EQ(stats().acked, 20);
+    HT_CHECK_EQ(bk.max_held, INFLIGHT);
+
+    /* QoS2 through PUBREC, PUBREL and PUBCOMP, QoS0 needs none */
+    publish(10, 2);
+    publish(5, 0);
+    WAIT_FOR(stats().acked == 30 && brk_get(&bk.firsts) == 35);
+    s = stats();
+    HT_CHECK_EQ(s.acked, 30);
+    HT_CHECK_EQ(s.sent, 35);
+    HT_CHECK_EQ(s.inflight, 0);
+    HT_CHECK_EQ(bk.dups, 0);
+
+    /* no acknowledgement: sent again with DUP after the retry time */
+    bk.hold = 1;
+    publish(1, 1);
+    WAIT_FOR(brk_get(&bk.held) == 1);
+    pass_ticks(RETRY_MS * HZ / 1000 - 1);
+    tick();
+    usleep(20000);
+    HT_CHECK_EQ(brk_get(&bk.dups), 0);
+    pass_ticks(1);
+    tick();
+    WAIT_FOR(brk_get(&bk.dups) == 1);
+    HT_CHECK_EQ(brk_get(&bk.dups), 1);
+    HT_CHECK_EQ(stats().retransmits, 1);
+    brk_release();
+    WAIT_FOR(stats().acked == 31);
+
+    /* keep-alive after KEEPALIVE seconds without sending */
+    pass_ticks(KEEPALIVE * HZ);
+    tick();
+    WAIT_FOR(brk_get(&bk.pings) == 1);
+    HT_CHECK_EQ(brk_get(&bk.pings), 1);
+    HT_CHECK(mqtt_session_connected());
+    HT_STOP_IF_FAILED();
+
+    /* offline with messages in flight: the RAM queue fills up, then the flash queue */
+    acked = stats().acked;
+    bk.hold = 1;
+    publish(3, 1);
+    WAIT_FOR(brk_get(&bk.held) == 3);
+    pthread_mutex_lock(&brk_lock);
+    bk.refuse = 1;
+    bk.hold = 0;
+    bk.held = 0;
+    pthread_mutex_unlock(&brk_lock);
+    brk_drop();
+    WAIT_FOR(!mqtt_session_connected());
+    HT_CHECK(!mqtt_session_connected());
+    publish(300, 1);
+    publish(20, 0);
+    s = stats();
+    HT_CHECK(s.spilled > 0);
+    HT_CHECK_EQ(s.dropped, 0);
+    HT_CHECK_EQ(s.queued, 320);
+    HT_CHECK_EQ(s.inflight, 3);
+    HT_CHECK(flash[0] != 0xFF);
+
+    /* back online: the inflight ones again with DUP, then everything in
+       order, subscription renewed, flash erased */
+    bk.refuse = 0;
+    WAIT_FOR(stats().acked == acked + 303 && brk_get(&bk.firsts) == next_msg);
+    s = stats();
+    HT_CHECK_EQ(s.acked, acked + 303);
+    HT_CHECK_EQ(brk_get(&bk.dups), 1 + 3);
+    HT_CHECK_EQ(s.queued, 0);
+    HT_CHECK_EQ(s.inflight, 0);
+    HT_CHECK_EQ(brk_get(&bk.connects), 2);
+    HT_CHECK_EQ(brk_get(&bk.subscribes), 2);
+    HT_CHECK(in_order());
+    HT_CHECK(flash_erases > 0);
+    HT_CHECK_EQ(flash[0], 0xFF);
+    HT_CHECK_EQ(state_changes, 3);
+
+    /* a QoS2 message from the broker is delivered once, even when sent twice */
+    brk_publish(2, 77, "on");
+    brk_publish(2, 77, "on");
+    WAIT_FOR(brk_get(&bk.pubrecs) == 2);
+    HT_CHECK_EQ(brk_get(&bk.pubrecs), 2);
+    HT_CHECK_EQ(brk_get(&delivered), 1);
+    HT_CHECK(strcmp(delivered_msg, "on") == 0);
+    HT_CHECK_EQ(delivered_qos, 2);
+    brk_pubrel(77);
+    WAIT_FOR(brk_get(&bk.pubcomps) == 1);
+    HT_CHECK_EQ(brk_get(&bk.pubcomps), 1);
+    /* after PUBREL the id may be used again */
+    brk_publish(2, 77, "on");
+    WAIT_FOR(brk_get(&bk.pubrecs) == 3);
+    HT_CHECK_EQ(brk_get(&delivered), 2);
+
+    printf("%d publishes, %d connects, %d retransmits, %d through flash\n",
+           brk_get(&bk.publishes), brk_get(&bk.connects), stats().retransmits, stats().spilled);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,324 @@
+/*
+ * NAPT of the soft AP forwarding (lwIP 2.0.3 alg.c) patches the IP, TCP,
+ * UDP and ICMP checksums for the words it changes. Random packets of both
+ * directions, odd lengths and IP options included, go through alg_input;
+ * what comes out must equal the packet translated by hand with every
+ * checksum summed again from scratch, the payload untouched. A packet that
+ * came in with a wrong checksum must leave with a wrong one.
+ */
+#include "host_test.h"
+#include "../../src/network/lwip2.0.3/core/alg.c"
+#include "napt_host.h"
+
+#define ROUNDS          300000
+#define FLOWS           64
+#define MAX_PAYLOAD     1472
+
+/* RFC 1071 over bytes in network order, independent of alg.c */
+static u32 ref_add(u32 sum, const u8 *data, int len)
+{
+    int i;
+
+    for (i = 0; i + 1 < len; i += 2)
+        sum += (data[i] << 8) | data[i + 1];
+    if (len & 1)
+        sum += data[len - 1] << 8;
+    return sum;
+}
+
+static u16 ref_fold(u32 sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (u16)~sum;
+}
+
+/* the checksum of the ip payload, with the pseudo header for tcp and udp */
+static u16 ref_l4_sum(const u8 *ip)
+{
+    int hlen = (ip[0] & 0x0F) * 4;
+    int len = ((ip[2] << 8) | ip[3]) - hlen;
+    u32 sum = 0;
+
+    if (ip[9] != IP_PROTO_ICMP)
+    {
+        sum = ref_add(sum, ip + 12, 8);
+        sum += ip[9] + len;
+    }
+    return ref_fold(ref_add(sum, ip + hlen, len));
+}
+
+/* offset of the checksum in the ip payload */
+static int l4_chksum_off(u8 proto)
+{
+    return proto == IP_PROTO_TCP ? 16 : proto == IP_PROTO_UDP ? 6 : 2;
+}
+
+static void put16(u8 *p, u16 v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static u16 get16(const u8 *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* an address as the headers keep it */
+static void put_ip(u8 *p, u32 addr)
+{
+    memcpy(p, &addr, 4);
+}
+
+/* the client's address behind the soft AP */
+static u32 client_ip(u8 client)
+{
+    return (AP_IP & 0x00FFFFFF) | ((u32)client << 24);
+}
+
+/* sum the ip header and the ip payload from scratch */
+static void ref_chksum(u8 *ip, int udp_none)
+{
+    int hlen = (ip[0] & 0x0F) * 4;
+    u8 *sum = ip + hlen + l4_chksum_off(ip[9]);
+    u16 v;
+
+    put16(ip + 10, 0);
+    put16(ip + 10, ref_fold(ref_add(0, ip, hlen)));
+    if (ip[9] == IP_PROTO_GRE)
+        return;
+    put16(sum, 0);
+    if (ip[9] == IP_PROTO_UDP && udp_none)
+        return;
+    v = ref_l4_sum(ip);
+    if (ip[9] == IP_PROTO_UDP && v == 0)
+        v = 0xFFFF;
+    put16(sum, v);
+}
+
+/* 0 and 0xFFFF are the same sum, only udp tells them apart */
+static int same_sum(u16 a, u16 b)
+{
+    return a == b || ((a == 0 || b == 0) && (a ^ b) == 0xFFFF);
+}
+
+typedef struct {
+    u8 client;          /* last byte of the client's ip */
+    u16 port;           /* source port or echo id, network order */
+    u16 new_port;       /* translated, 0 before the first packet */
+} flow_t;
+
+static flow_t flows[3][FLOWS];
+
+static int proto_index(u8 proto)
+{
+    return proto == IP_PROTO_TCP ? 0 : proto == IP_PROTO_UDP ? 1 : 2;
+}
+
+/* a packet of random size and content with its checksums right */
+static int build(u8 *frame, u8 proto, u32 src, u32 dest, u16 sport, u16 dport, int udp_none)
+{
+    u8 *ip = frame + NAPT_ETH_HDR_LEN;
+    int hlen = 20 + 4 * (ht_rand() % 4 ? 0 : ht_rand_range(1, 10));
+    int l4len = proto == IP_PROTO_TCP ? 20 : proto == IP_PROTO_GRE ? 4 : 8;
+    int len;
+    int i;
+
+    switch (ht_rand() % 4)
+    {
+        case 0:  len = 0; break;
+        case 1:  len = ht_rand_range(1, 16); break;
+        default: len = ht_rand_range(0, MAX_PAYLOAD); break;
+    }
+    for (i = 0; i < NAPT_ETH_HDR_LEN + hlen + l4len + len; i++)
+        frame[i] = ht_rand();
+
+    ip[0] = 0x40 | (hlen / 4);
+    put16(ip + 2, hlen + l4len + len);
+    ip[9] = proto;
+    put_ip(ip + 12, src);
+    put_ip(ip + 16, dest);
+    if (proto == IP_PROTO_ICMP)
+    {
+        ip[hlen] = (dport == 0) ? ICMP_ECHO : ICMP_ER;
+        ip[hlen + 1] = 0;
+        memcpy(ip + hlen + 4, dport ? &dport : &sport, 2);
+    }
+    else if (proto != IP_PROTO_GRE)
+    {
+        memcpy(ip + hlen, &sport, 2);
+        memcpy(ip + hlen + 2, &dport, 2);
+        if (proto == IP_PROTO_UDP)
+            put16(ip + hlen + 4, l4len + len);
+    }
+    ref_chksum(ip, udp_none);
+    return NAPT_ETH_HDR_LEN + hlen + l4len + len;
+}
+
+/* somewhere on the internet, not on either side of the gateway */
+static u32 public_ip(void)
+{
+    u32 ip;
+
+    do
+        ip = ht_rand();
+    while ((ip & 0xFFFF) == 0xA8C0);
+    return ip;
+}
+
+static void check(int len, const u8 *expect, const u8 *mac_dest, const u8 *mac_src, int damaged)
+{
+    const u8 *ip = napt_out + NAPT_ETH_HDR_LEN;
+    const u8 *want = expect + NAPT_ETH_HDR_LEN;
+    int hlen = (ip[0] & 0x0F) * 4;
+    int off = hlen + l4_chksum_off(ip[9]);
+    static u8 got[NAPT_FRAME_SIZE];
+
+    HT_CHECK_EQ(napt_out_len, len);
+    if (napt_out_len != len)
+        return;
+    HT_CHECK(memcmp(napt_out, mac_dest, ETH_ALEN) == 0);
+    HT_CHECK(memcmp(napt_out + ETH_ALEN, mac_src, ETH_ALEN) == 0);
+    HT_CHECK(same_sum(get16(ip + 10), get16(want + 10)));
+
+    memcpy(got, napt_out, len);
+    memcpy(got + NAPT_ETH_HDR_LEN + 10, want + 10, 2);
+    if (ip[9] != IP_PROTO_GRE)
+    {
+        if (damaged)
+        {
+            /* still wrong, and the same distance from right as it came in */
+            HT_CHECK(ref_l4_sum(ip) != 0);
+        }
+        else if (ip[9] == IP_PROTO_UDP)
+        {
+            HT_CHECK_EQ(get16(ip + off), get16(want + off));
+        }
+        else
+        {
+            HT_CHECK(same_sum(get16(ip + off), get16(want + off)));
+        }
+        memcpy(got + NAPT_ETH_HDR_LEN + off, want + off, 2);
+    }
+    HT_CHECK(memcmp(got + NAPT_ETH_HDR_LEN, want, len - NAPT_ETH_HDR_LEN) == 0);
+}
+
+/* a client behind the soft AP to the internet */
+static void send_out(u8 proto)
+{
+    static u8 frame[NAPT_FRAME_SIZE];
+    static u8 expect[NAPT_FRAME_SIZE];
+    flow_t *flow = &flows[proto_index(proto)][ht_rand() % FLOWS];
+    struct napt_table *table = proto == IP_PROTO_TCP ? &napt_table_4tcp :
+                               proto == IP_PROTO_UDP ? &napt_table_4udp : &napt_table_4ic;
+    struct napt_item *napt;
+    u8 *ip = expect + NAPT_ETH_HDR_LEN;
+    int udp_none = proto == IP_PROTO_UDP && ht_rand() % 8 == 0;
+    int hlen;
+    int len;
+
+    len = build(frame, proto, client_ip(flow->client),
+                public_ip(), flow->port, proto == IP_PROTO_ICMP ? 0 : ht_rand(), udp_none);
+    memcpy(expect, frame, len);
+    hlen = (ip[0] & 0x0F) * 4;
+
+    napt_out_len = 0;
+    alg_input(ap_mac, frame, len);
+
+    if (proto == IP_PROTO_GRE)
+    {
+        /* one vpn at a time, let the next client have it */
+        gre_info.is_used = false;
+        put_ip(ip + 12, STA_IP);
+        ref_chksum(ip, 0);
+        check(len, expect, router_mac, sta_mac, 0);
+        return;
+    }
+
+    napt = alg_napt_table_get_by_src(table, flow->port, flow->client);
+    HT_CHECK(napt != NULL);
+    if (napt == NULL)
+        return;
+    HT_CHECK(flow->new_port == 0 || flow->new_port == napt->new_port);
+    flow->new_port = napt->new_port;
+
+    put_ip(ip + 12, STA_IP);
+    memcpy(ip + hlen + (proto == IP_PROTO_ICMP ? 4 : 0), &napt->new_port, 2);
+    ref_chksum(ip, udp_none);
+    check(len, expect, router_mac, sta_mac, 0);
+}
+
+/* an answer from the internet to a flow that went out */
+static void send_in(u8 proto)
+{
+    static u8 frame[NAPT_FRAME_SIZE];
+    static u8 expect[NAPT_FRAME_SIZE];
+    flow_t *flow = &flows[proto_index(proto)][ht_rand() % FLOWS];
+    u8 *ip = expect + NAPT_ETH_HDR_LEN;
+    u8 *fip = frame + NAPT_ETH_HDR_LEN;
+    int udp_none = proto == IP_PROTO_UDP && ht_rand() % 8 == 0;
+    int damaged = proto != IP_PROTO_GRE && !udp_none && ht_rand() % 16 == 0;
+    u16 sport = proto == IP_PROTO_UDP && ht_rand() % 8 == 0 ? htons(53) : ht_rand();
+    int hlen;
+    int off;
+    int len;
+
+    if (proto != IP_PROTO_GRE && flow->new_port == 0)
+        return;
+    len = build(frame, proto, public_ip(), STA_IP, sport, flow->new_port, udp_none);
+    hlen = (fip[0] & 0x0F) * 4;
+    off = hlen + l4_chksum_off(proto);
+    if (damaged)
+        put16(fip + off, get16(fip + off) ^ ht_rand_range(1, 0xFFFE));
+    memcpy(expect, frame, len);
+
+    napt_out_len = 0;
+    alg_input(router_mac, frame, len);
+
+    if (proto == IP_PROTO_GRE)
+    {
+        put_ip(ip + 16, client_ip(gre_info.src_ip));
+        ref_chksum(ip, 0);
+        check(len, expect, client_mac, ap_mac, 0);
+        return;
+    }
+
+    put_ip(ip + 16, client_ip(flow->client));
+    if (proto == IP_PROTO_UDP && sport == htons(53))
+        put_ip(ip + 12, AP_IP);
+    memcpy(ip + hlen + (proto == IP_PROTO_ICMP ? 4 : 2), &flow->port, 2);
+    ref_chksum(ip, udp_none);
+    check(len, expect, client_mac, ap_mac, damaged);
+}
+
+int main(void)
+{
+    static const u8 protos[] = {IP_PROTO_TCP, IP_PROTO_UDP, IP_PROTO_ICMP, IP_PROTO_GRE};
+    u8 proto;
+    int round;
+    int i, p;
+
+    napt_host_init();
+
+    for (p = 0; p < 3; p++)
+    {
+        for (i = 0; i < FLOWS; i++)
+        {
+            flows[p][i].client = ht_rand_range(2, 254);
+            flows[p][i].port = ht_rand_range(1, 0xFFFF);
+        }
+    }
+
+    for (round = 0; round < ROUNDS; round++)
+    {
+        proto = protos[ht_rand() % 4];
+        if (ht_rand() % 2)
+            send_out(proto);
+        else
+            send_in(proto);
+        HT_STOP_IF_FAILED();
+    }
+    HT_CHECK_EQ(napt_delivered, 0);
+    return ht_done(__FILE__);
+}
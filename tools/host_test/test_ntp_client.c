@@ -0,0 +1,575 @@
+/*
+ * The NTP client against three fake servers, with a local tick clock that
+ * runs DRIFT_PPM fast and an RTC that runs RTC_DRIFT_PPM fast.
+ *
+ * Time is simulated: the stack's timers and the datagrams on the way are
+ * events on the true time line, the tick counter starts just before it
+ * wraps. Each request reaches its server after a random delay and the
+ * answer comes back after another one, so the samples carry the error of
+ * an asymmetric path.
+ *
+ * Once tls_ntp_sync_start has run for a while the frequency correction
+ * cancels the drift, the clock stays within CLOCK_ERR_MS of the true time
+ * and the poll interval grows. The RTC error is estimated. Servers that
+ * jump are stepped to, servers that stop answering count as failures while
+ * the clock runs on its frequency.
+ */
+#include "host_test.h"
+#include "../../src/app/ntp/ntp_client.c"
+#include "../../src/network/lwip2.0.3/core/def.c"
+#include <stdlib.h>
+
+#define DRIFT_PPM       120
+#define RTC_DRIFT_PPM   40
+/* the tick counter wraps 65 s into the test */
+#define LOCAL_START     0xFFFF0000u
+/* true UTC when the simulation starts, in s */
+#define EPOCH           1700000000ULL
+#define SERVERS         3
+#define SERVER_IP(i)    PP_HTONL(LWIP_MAKEU32(10, 0, 0, 1 + (i)))
+/* one way delay in ms */
+#define DELAY_MIN       3
+#define DELAY_MAX       12
+#define CLOCK_ERR_MS    20
+#define HOUR_US         (3600ULL * 1000000)
+
+const unsigned int HZ = 1000;
+
+/* true time in us */
+static u64 now_us;
+
+static struct event {
+    u64 at;
+    sys_timeout_handler handler;
+    void *arg;
+    struct pbuf *p;     /* an answer on the way */
+    u32 from;
+    u8 used;
+} events[32];
+
+static struct fake_server {
+    s32 offset_ms;      /* against the true time */
+    u8 answer;
+    u32 requests;
+} servers[SERVERS];
+
+static char params[SERVERS][NTP_SERVER_DOMAIN_LEN];
+
+static time_t rtc_base;
+static u64 rtc_set_at;
+static int rtc_writes;
+
+static int protect_depth;
+
+void *mem_alloc_debug(u32 size)
+{
+    return malloc(size);
+}
+
+void mem_free_debug(void *p)
+{
+    free(p);
+}
+
+u32 tls_os_get_time(void)
+{
+    return (u32)(LOCAL_START + now_us * (1000000 + DRIFT_PPM) / 1000000000);
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    protect_depth++;
+    return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+    protect_depth--;
+}
+
+static s64 true_utc_ms(void)
+{
+    return (s64)(EPOCH * 1000 + now_us / 1000);
+}
+
+static struct event *event_new(u64 at)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(events) / sizeof(events[0])); i++)
+    {
+        if (!events[i].used)
+        {
+            memset(&events[i], 0, sizeof(events[i]));
+            events[i].used = 1;
+            events[i].at = at;
+            return &events[i];
+        }
+    }
+    HT_CHECK(0);
+    return NULL;
+}
+
+/* the stack's timers count local ticks */
+void sys_timeout_p(u8 timeo_assigned, u32_t msecs, sys_timeout_handler handler, void *arg)
+{
+    struct event *e = event_new(now_us + (u64)msecs * 1000000000 / (1000000 + DRIFT_PPM));
+
+    if (e)
+    {
+        e->handler = handler;
+        e->arg = arg;
+    }
+}
+
+void sys_untimeout_p(u8 timeo_assigned, sys_timeout_handler handler, void *arg)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(events) / sizeof(events[0])); i++)
+    {
+        if (events[i].used && events[i].handler == handler && events[i].arg == arg)
+        {
+            events[i].used = 0;
+            return;
+        }
+    }
+}
+
+struct udp_pcb *udp_new(void)
+{
+    return calloc(1, sizeof(struct udp_pcb));
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    struct pbuf *p = calloc(1, sizeof(*p) + length);
+
+    if (p)
+    {
+        p->payload = p + 1;
+        p->len = p->tot_len = length;
+    }
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    free(p);
+    return 1;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    memcpy(buf->payload, dataptr, len);
+    return ERR_OK;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    if (len > buf->len - offset)
+        len = buf->len - offset;
+    memcpy(dataptr, (u8_t *)buf->payload + offset, len);
+    return len;
+}
+
+static void ntp_ts_put(u8 *ts, s64 utc_ms)
+{
+    u32 sec = (u32)(utc_ms / 1000) + UTC_NTP;
+    u32 frac = (u32)(((u64)(utc_ms % 1000) << 32) / 1000);
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        ts[i] = (u8)(sec >> (24 - 8 * i));
+        ts[4 + i] = (u8)(frac >> (24 - 8 * i));
+    }
+}
+
+/* the request reaches the server, the answer is put on its way back */
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    struct fake_server *srv = NULL;
+    const u8 *req = p->payload;
+    u64 arrive = now_us + ht_rand_range(DELAY_MIN * 1000, DELAY_MAX * 1000);
+    s64 t2 = (s64)(EPOCH * 1000 + arrive / 1000);
+    struct pbuf *q;
+    struct event *e;
+    u8 *buf;
+    int i;
+
+    HT_CHECK_EQ(dst_port, NTP_PORT);
+    HT_CHECK_EQ(p->tot_len, BUF_LEN);
+    HT_CHECK_EQ(req[0], 0x23);
+    for (i = 0; i < SERVERS; i++)
+    {
+        if (ip_addr_get_ip4_u32(dst_ip) == SERVER_IP(i))
+            srv = &servers[i];
+    }
+    HT_CHECK(srv != NULL);
+    if (srv == NULL)
+        return ERR_RTE;
+    srv->requests++;
+    if (!srv->answer)
+        return ERR_OK;
+
+    q = pbuf_alloc(PBUF_TRANSPORT, BUF_LEN, PBUF_RAM);
+    buf = q->payload;
+    buf[0] = 0x24;      /* LI 0, version 4, server */
+    buf[1] = 2;         /* stratum */
+    memcpy(buf + 24, req + 40, 8);
+    ntp_ts_put(buf + 32, t2 + srv->offset_ms);
+    ntp_ts_put(buf + 40, t2 + 1 + srv->offset_ms);
+
+    e = event_new(arrive + 1000 + ht_rand_range(DELAY_MIN * 1000, DELAY_MAX * 1000));
+    if (e == NULL)
+    {
+        pbuf_free(q);
+        return ERR_MEM;
+    }
+    e->p = q;
+    e->from = ip_addr_get_ip4_u32(dst_ip);
+    return ERR_OK;
+}
+
+static int run_one(void)
+{
+    struct event *e = NULL;
+    struct event ev;
+    ip_addr_t from;
+    int i;
+
+    for (i = 0; i < (int)(sizeof(events) / sizeof(events[0])); i++)
+    {
+        if (events[i].used && (e == NULL || events[i].at < e->at))
+            e = &events[i];
+    }
+    if (e == NULL)
+        return 0;
+    ev = *e;
+    e->used = 0;
+    if (ev.at > now_us)
+        now_us = ev.at;
+
+    if (ev.p)
+    {
+        ip_addr_set_ip4_u32(&from, ev.from);
+        if (ntp.pcb && ntp.pcb->recv)
+            ntp.pcb->recv(ntp.pcb->recv_arg, ntp.pcb, ev.p, &from, NTP_PORT);
+        else
+            pbuf_free(ev.p);
+    }
+    else
+    {
+        ev.handler(ev.arg);
+    }
+    HT_CHECK_EQ(protect_depth, 0);
+    return 1;
+}
+
+/* the events due until true time at */
+static void run_until(u64 at)
+{
+    int i;
+
+    for (;;)
+    {
+        struct event *e = NULL;
+
+        for (i = 0; i < (int)(sizeof(events) / sizeof(events[0])); i++)
+        {
+            if (events[i].used && events[i].at <= at && (e == NULL || events[i].at < e->at))
+                e = &events[i];
+        }
+        if (e == NULL)
+            break;
+        run_one();
+    }
+    now_us = at;
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx, u8_t block)
+{
+    function(ctx);
+    return ERR_OK;
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+    u32 *n = malloc(sizeof(u32));
+
+    if (n == NULL)
+        return ERR_MEM;
+    *n = count;
+    *sem = n;
+    return ERR_OK;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+    (*(u32 *)*sem)++;
+}
+
+void sys_sem_free(sys_sem_t *sem)
+{
+    free(*sem);
+}
+
+/* the caller blocks while the stack runs */
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+    u32 *n = *sem;
+
+    while (*n == 0)
+    {
+        if (!run_one())
+        {
+            HT_CHECK(0);
+            return SYS_ARCH_TIMEOUT;
+        }
+    }
+    (*n)--;
+    return 0;
+}
+
+int tls_param_get(int id, void *argv, bool from_flash)
+{
+    memcpy(argv, params[id - TLS_PARAM_ID_SNTP_SERVER1], NTP_SERVER_DOMAIN_LEN);
+    return 0;
+}
+
+int tls_param_set(int id, void *argv, bool to_flash)
+{
+    strncpy(params[id - TLS_PARAM_ID_SNTP_SERVER1], argv, NTP_SERVER_DOMAIN_LEN - 1);
+    return 0;
+}
+
+/* "ntp<n>" is 10.0.0.<n> */
+struct hostent *lwip_gethostbyname(const char *name)
+{
+    static u32 addr;
+    static char *addr_list[2] = {(char *)&addr, NULL};
+    static struct hostent host;
+
+    if (strncmp(name, "ntp", 3) || name[3] < '1' || name[3] > '0' + SERVERS)
+        return NULL;
+    addr = SERVER_IP(name[3] - '1');
+    host.h_addr_list = addr_list;
+    return &host;
+}
+
+void tls_rtc_set_time(time_t t)
+{
+    rtc_base = t;
+    rtc_set_at = now_us;
+    rtc_writes++;
+}
+
+time_t tls_rtc_get_time(void)
+{
+    return rtc_base + (time_t)((now_us - rtc_set_at) * (1000000 + RTC_DRIFT_PPM) / 1000000000000ULL);
+}
+
+/* the clock against the true time, in ms */
+static s64 clock_error(void)
+{
+    u32 sec, ms;
+
+    if (tls_ntp_get_time(&sec, &ms) != WM_SUCCESS)
+        return 0x7fffffff;
+    return ((s64)sec * 1000 + ms) - true_utc_ms();
+}
+
+static u32 requests(void)
+{
+    u32 n = 0;
+    int i;
+
+    for (i = 0; i < SERVERS; i++)
+        n += servers[i].requests;
+    return n;
+}
+
+static void set_servers(s32 offset_ms, u8 answer)
+{
+    int i;
+
+    for (i = 0; i < SERVERS; i++)
+    {
+        servers[i].offset_ms = offset_ms;
+        servers[i].answer = answer;
+    }
+}
+
+static s64 abs64(s64 v)
+{
+    return v < 0 ? -v : v;
+}
+
+/* nothing to read before the first answer */
+static void test_unsynced(void)
+{
+    tls_ntp_status_t st;
+    u32 sec = 1, ms = 1;
+
+    HT_CHECK_EQ(tls_ntp_get_time(&sec, &ms), WM_FAILED);
+    HT_CHECK_EQ(sec, 1);
+    tls_ntp_get_status(&st);
+    HT_CHECK_EQ(st.synced, 0);
+
+    /* no server configured */
+    HT_CHECK_EQ(tls_ntp_client(), 0);
+    HT_CHECK_EQ(tls_ntp_sync_start(), WM_FAILED);
+    HT_CHECK_EQ(requests(), 0);
+}
+
+/* one round on demand steps the clock */
+static void test_client(void)
+{
+    tls_ntp_status_t st;
+    u32 t;
+    int i;
+
+    for (i = 0; i < SERVERS; i++)
+    {
+        char name[8];
+
+        sprintf(name, "ntp%d", i + 1);
+        HT_CHECK_EQ(tls_ntp_set_server(name, i), WM_SUCCESS);
+    }
+    set_servers(0, 1);
+
+    t = tls_ntp_client();
+    HT_CHECK(abs64((s64)t - (s64)(true_utc_ms() / 1000 + NTP_TIMEZONE)) <= 1);
+    HT_CHECK(abs64(clock_error()) <= DELAY_MAX);
+    HT_CHECK_EQ(requests(), SERVERS);
+    tls_ntp_get_status(&st);
+    HT_CHECK_EQ(st.synced, 1);
+    HT_CHECK_EQ(st.service, 0);
+    HT_CHECK_EQ(st.rounds, 1);
+    HT_CHECK_EQ(st.samples, SERVERS);
+    HT_CHECK_EQ(st.steps, 1);
+    HT_CHECK(st.delay_ms <= 2 * DELAY_MAX + 1);
+}
+
+/* the service cancels the drift of the tick clock and of the RTC */
+static void test_drift(void)
+{
+    tls_ntp_status_t st;
+    s64 err, max_err = 0;
+    u64 t;
+
+    HT_CHECK_EQ(tls_ntp_sync_start(), WM_SUCCESS);
+    run_until(now_us + HOUR_US);
+    tls_ntp_get_status(&st);
+    HT_CHECK_EQ(st.service, 1);
+    HT_CHECK_EQ(st.steps, 1);
+    HT_CHECK_EQ(st.failures, 0);
+
+    /* while fresh, tls_ntp_client asks no server */
+    t = requests();
+    HT_CHECK(abs64((s64)tls_ntp_client() - (s64)(true_utc_ms() / 1000 + NTP_TIMEZONE)) <= 1);
+    HT_CHECK_EQ(requests(), t);
+
+    for (t = 0; t < 12 * 60; t++)
+    {
+        run_until(now_us + 60ULL * 1000000);
+        err = abs64(clock_error());
+        if (err > max_err)
+            max_err = err;
+        HT_CHECK(err <= CLOCK_ERR_MS);
+        if (ht_failed)
+            break;
+    }
+
+    tls_ntp_get_status(&st);
+    printf("drift %d ppm: freq %d ppb, poll %u s, max error %d ms, rtc %d ppm, %u rounds\n",
+           DRIFT_PPM, (int)st.freq_ppb, (unsigned)st.poll, (int)max_err, (int)st.rtc_ppm,
+           (unsigned)st.rounds);
+    HT_CHECK(abs64(st.freq_ppb + DRIFT_PPM * 1000) <= 5000);
+    HT_CHECK(st.poll > NTP_POLL_MIN);
+    HT_CHECK_EQ(st.steps, 1);
+    HT_CHECK_EQ(st.failures, 0);
+    HT_CHECK(abs64(st.rtc_ppm - RTC_DRIFT_PPM) <= 10);
+    /* the RTC was written again once it was off by half a second */
+    HT_CHECK(rtc_writes >= 2);
+    HT_CHECK(abs64((s64)tls_rtc_get_time() - (s64)(true_utc_ms() / 1000 + NTP_TIMEZONE)) <= 1);
+}
+
+/* without answers the clock runs on its frequency */
+static void test_silent(void)
+{
+    tls_ntp_status_t st, st0;
+
+    tls_ntp_get_status(&st0);
+    set_servers(0, 0);
+    run_until(now_us + 4 * HOUR_US);
+    tls_ntp_get_status(&st);
+    HT_CHECK(st.failures > st0.failures);
+    HT_CHECK_EQ(st.samples, st0.samples);
+    HT_CHECK_EQ(st.synced, 1);
+    HT_CHECK(abs64(clock_error()) <= 4 * CLOCK_ERR_MS);
+    HT_CHECK_EQ(tls_ntp_client(), 0);
+
+    /* a failed round polls again at the shortest interval */
+    set_servers(0, 1);
+    run_until(now_us + (NTP_POLL_MIN + 2) * 1000000ULL);
+    tls_ntp_get_status(&st);
+    HT_CHECK(st.samples > st0.samples);
+    HT_CHECK(abs64(clock_error()) <= CLOCK_ERR_MS);
+}
+
+/* on demand after the service, a jump past NTP_STEP_MS is stepped to, a small one slewed */
+static void test_step(void)
+{
+    tls_ntp_status_t st, st0;
+
+    tls_ntp_get_status(&st0);
+    set_servers(5000, 1);
+    HT_CHECK(tls_ntp_client() != 0);
+    tls_ntp_get_status(&st);
+    HT_CHECK_EQ(st.steps, st0.steps + 1);
+    HT_CHECK_EQ(st.poll, NTP_POLL_MIN);
+    HT_CHECK(abs64(clock_error() - 5000) <= DELAY_MAX);
+
+    set_servers(5200, 1);
+    HT_CHECK(tls_ntp_client() != 0);
+    tls_ntp_get_status(&st);
+    HT_CHECK_EQ(st.steps, st0.steps + 1);
+    /* the slew is bounded: 200 ms at 500 ppm take 400 s */
+    HT_CHECK(clock_error() < 5200 - 100);
+    run_until(now_us + 600 * 1000000ULL);
+    HT_CHECK(abs64(clock_error() - 5200) <= CLOCK_ERR_MS);
+}
+
+/* stopped, the service sends nothing */
+static void test_stop(void)
+{
+    u32 n;
+
+    tls_ntp_sync_stop();
+    n = requests();
+    run_until(now_us + 2 * HOUR_US);
+    HT_CHECK_EQ(requests(), n);
+    HT_CHECK(tls_ntp_get_time(NULL, NULL) == WM_SUCCESS);
+}
+
+int main(void)
+{
+    ht_seed = 50;
+    test_unsynced();
+    test_client();
+    HT_STOP_IF_FAILED();
+    test_drift();
+    HT_STOP_IF_FAILED();
+    test_silent();
+    test_stop();
+    test_step();
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,370 @@
+/*
+ * Simulation of the tickless idle hook against a cycle accurate model of
+ * systick: busy periods, sleeps cut short by other interrupts and sleeps
+ * that run to the end, with the kernel and wl timer limits drawn at random.
+ * After every sleep the kernel tick count must match the tick boundaries
+ * that really passed and the next tick must come on the next boundary.
+ *
+ * Sleeps longer than a systick period are woken by pmu timer1, its 32K
+ * clock off by up to PMU_PPM, and the rtc counts seconds from a random
+ * phase. Those cut short after the first systick lap may leave the kernel
+ * behind, by no more than the rtc allows; the grid of tick boundaries then
+ * restarts where the hook put the next one.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "../../platform/sys/wm_tickless.c"
+
+#define CPU_HZ          80000000u
+#define CPT             (CPU_HZ / 500)
+#define ROUNDS          200000
+#define LAP             (SysTick_LOAD_RELOAD_Msk + 1)
+#define PMU_PPM         500
+/* rtc seconds when the simulation starts, the 5th of the month */
+#define RTC_START       (5 * 86400)
+
+const unsigned int HZ = 500;
+
+SysTick_Type host_systick;
+SCB_Type host_scb;
+
+static uint64_t now;            /* cycles, tick boundaries where now + shift is a multiple of CPT */
+static uint64_t shift;
+static uint64_t lost;           /* ticks the kernel fell behind */
+static uint64_t kernel_ticks;
+static int irq_disabled;
+static int suspended;
+
+/* what the stubs hand out and record */
+static portTickType idle_ticks;
+static u32 wl_next_ms;
+static int slept;
+static u32 sleep_reload;
+static uint64_t sleep_start;
+static int wake_early;
+static u32 wake_val;
+
+/* pmu timer1 and the rtc */
+static int pmu_registered;
+static int pmu_armed;
+static u32 pmu_ms;
+static int pmu_out;
+static uint64_t rtc_phase;      /* cycles into the rtc second at now 0 */
+static int long_sleep;
+static int wake_wrapped;
+static u32 rtc_slept;
+
+void __disable_irq(void) { irq_disabled = 1; }
+void __enable_irq(void) { irq_disabled = 0; }
+void vTaskSuspendAll(void) { suspended++; }
+signed long xTaskResumeAll(void) { suspended--; return 0; }
+portTickType xTaskGetExpectedIdleTime(void) { return idle_ticks; }
+void vTaskStepTick(portTickType ticks) { kernel_ticks += ticks; }
+u32 tls_timeouts_next_p(void) { return wl_next_ms; }
+void tls_watchdog_clr(void) { }
+u32 tls_os_get_time(void) { return (u32)kernel_ticks; }
+void tls_pmu_timer1_isr_register(tls_pmu_irq_callback callback, void *arg) { pmu_registered = 1; }
+void tls_pmu_timer1_start(u16 msec) { pmu_armed = 1; pmu_ms = msec; }
+void tls_pmu_timer1_stop(void) { pmu_armed = 0; }
+int tls_pmu_timer1_expired(void) { return pmu_out; }
+
+static u32 rtc_secs_at(uint64_t t)
+{
+    return RTC_START + (u32)((t + rtc_phase) / CPU_HZ);
+}
+
+void tls_get_rtc(struct tm *tblock)
+{
+    u32 secs = rtc_secs_at(now);
+
+    memset(tblock, 0, sizeof(*tblock));
+    tblock->tm_mday = secs / 86400;
+    tblock->tm_hour = secs / 3600 % 24;
+    tblock->tm_min = secs / 60 % 60;
+    tblock->tm_sec = secs % 60;
+}
+
+void tls_set_rtc(struct tm *tblock)
+{
+    HT_CHECK(0);
+}
+
+static int ticks_at(uint64_t t)
+{
+    return (int)((t + shift) / CPT);
+}
+
+static u32 tick_phase(uint64_t t)
+{
+    return (u32)((t + shift) % CPT);
+}
+
+/*
+ * A long sleep: systick counts laps from VAL 0 without its interrupt,
+ * pmu timer1 runs out pmu_ms later by its own clock.
+ */
+static void wfi_long(void)
+{
+    uint64_t out;
+    uint64_t wake;
+    uint64_t c;
+    s32 ppm = (s32)ht_rand_range(0, 2 * PMU_PPM) - PMU_PPM;
+
+    HT_CHECK(pmu_armed);
+    HT_CHECK(!(host_systick.CTRL & SysTick_CTRL_TICKINT_Msk));
+    HT_CHECK_EQ(host_systick.LOAD, SysTick_LOAD_RELOAD_Msk);
+
+    long_sleep = 1;
+    out = now + (uint64_t)pmu_ms * (CPU_HZ / 1000) * (1000000 + ppm) / 1000000;
+    wake_early = ht_rand() & 1;
+    if (wake_early)
+    {
+        /* as often within the first two laps as later */
+        if ((ht_rand() & 1) && (out - now > 2 * LAP))
+            wake = now + 1 + ht_rand() % (2 * LAP);
+        else
+            wake = now + 1 + (((uint64_t)ht_rand() << 32) | ht_rand()) % (out - now - 1);
+    }
+    else
+    {
+        wake = out + ht_rand() % 64;
+    }
+    pmu_out = !wake_early;
+    rtc_slept = rtc_secs_at(wake) - rtc_secs_at(now);
+
+    c = wake - now;
+    wake_wrapped = c >= LAP;
+    host_systick.VAL = SysTick_LOAD_RELOAD_Msk - (u32)((c - 1) % LAP);
+    if (wake_wrapped)
+        host_systick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+    wake_val = host_systick.VAL;
+    now = wake;
+}
+
+/*
+ * The cpu sleeps from now. systick was just written with VAL 0, so it loads
+ * LOAD on the next cycle and runs out LOAD cycles later.
+ */
+void __WFI(void)
+{
+    uint64_t out;
+    uint64_t wake;
+
+    HT_CHECK(irq_disabled);
+    HT_CHECK(host_systick.CTRL & SysTick_CTRL_ENABLE_Msk);
+    HT_CHECK_EQ(host_systick.VAL, 0);
+
+    slept = 1;
+    sleep_start = now;
+    sleep_reload = host_systick.LOAD;
+    if (pmu_armed)
+    {
+        wfi_long();
+        return;
+    }
+
+    out = now + 1 + sleep_reload;
+
+    wake_early = (sleep_reload > 1) && (ht_rand() & 1);
+    if (wake_early)
+    {
+        wake = now + 1 + ht_rand() % (sleep_reload - 1);
+        host_systick.VAL = sleep_reload - (u32)(wake - now - 1);
+    }
+    else
+    {
+        /* interrupt latency and the instructions up to reading ctrl */
+        wake = out + ht_rand() % 64;
+        host_systick.VAL = (wake == out) ? 0 : sleep_reload - (u32)(wake - out - 1);
+        host_systick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+        host_scb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+    }
+    wake_val = host_systick.VAL;
+    now = wake;
+}
+
+/* run the pending tick interrupt, if any */
+static void service_tick(void)
+{
+    if (host_scb.ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        host_scb.ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+        kernel_ticks++;
+    }
+}
+
+/* run with the normal tick for some cycles, a boundary at now stays pending */
+static void run_busy(uint64_t cycles)
+{
+    uint64_t end = now + cycles;
+
+    if (cycles == 0)
+        return;
+    service_tick();
+    kernel_ticks += ticks_at(end - 1) - ticks_at(now);
+    now = end;
+    if (tick_phase(now) == 0)
+        host_scb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+
+    host_systick.LOAD = CPT - 1;
+    host_systick.VAL = (CPT - tick_phase(now)) % CPT;
+    host_systick.CTRL = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+}
+
+static u32 min_u32(u32 a, u32 b)
+{
+    return (a < b) ? a : b;
+}
+
+/* checks after a long sleep, the grid restarts at the next boundary set */
+static void check_long(u32 start_val, u32 limit, uint64_t kernel_before)
+{
+    uint64_t next;
+    u32 load;
+    int lag;
+
+    HT_CHECK(!pmu_armed);
+    HT_CHECK(pmu_ms > 0);
+    HT_CHECK(pmu_ms < limit * (1000 / HZ));
+    HT_CHECK(limit > tickless_max_idle_ticks);
+
+    /* no systick interrupt while asleep; exact unless cut short after a lap */
+    HT_CHECK(!(host_scb.ICSR & SCB_ICSR_PENDSTSET_Msk));
+    lag = ticks_at(now) - (int)lost - (int)kernel_ticks;
+    if (!wake_early || !wake_wrapped)
+        HT_CHECK_EQ(lag, 0);
+    HT_CHECK(lag >= 0);
+    HT_CHECK((uint64_t)lag * CPT <= 2ULL * CPU_HZ);
+    HT_CHECK(kernel_ticks - kernel_before <= limit + limit / 1000 + 1);
+
+    tickless_long_wake(start_val,
+                       tickless_long_elapsed(wake_val, wake_wrapped, pmu_out,
+                                             (uint64_t)pmu_ms * (CPU_HZ / 1000), rtc_slept),
+                       &load);
+    next = now + 1 + load;
+    HT_CHECK(next > now && next - now <= CPT);
+    if (lag == 0)
+        HT_CHECK_EQ(tick_phase(next), 0);
+    HT_CHECK_EQ(host_systick.LOAD, CPT - 1);
+    HT_CHECK((host_systick.CTRL & (SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk)) ==
+             (SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk));
+
+    /* the kernel counts from the boundary the hook set */
+    shift = (CPT - next % CPT) % CPT;
+    lost = ticks_at(now) - kernel_ticks;
+    now = next;
+    pmu_out = 0;
+    host_systick.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+}
+
+int main(void)
+{
+    u32 limit;
+    u32 start_val;
+    u32 expected;
+    u32 load;
+    int counted;
+    int pending;
+    int ret;
+    int round;
+    int sleeps = 0;
+    int early = 0;
+    int longs = 0;
+    int longs_early = 0;
+    uint64_t kernel_before;
+
+    rtc_phase = ht_rand() % CPU_HZ;
+    tls_tickless_init(CPU_HZ);
+    HT_CHECK_EQ(tickless_max_idle_ticks, SysTick_LOAD_RELOAD_Msk / CPT);
+    HT_CHECK(pmu_registered);
+
+    now = CPT / 3;
+    run_busy(1);
+
+    for (round = 0; round < ROUNDS; round++)
+    {
+        /* mostly short busy periods, sometimes ending on a boundary */
+        if (ht_rand() % 8 == 0)
+            run_busy(CPT - tick_phase(now));
+        else
+            run_busy(ht_rand() % (3 * CPT));
+
+        if (ht_rand() % 5)
+            idle_ticks = ht_rand_range(0, 300);
+        else
+            idle_ticks = (ht_rand() & 1) ? 0xFFFFFFFF : ht_rand_range(0, 40000);
+        if (ht_rand() % 3)
+            wl_next_ms = 0xFFFFFFFF;
+        else
+            wl_next_ms = (ht_rand() & 1) ? ht_rand_range(0, 400) : ht_rand_range(0, 100000);
+        limit = min_u32(min_u32(idle_ticks, tickless_max_long_ticks),
+                        (wl_next_ms == 0xFFFFFFFF) ? 0xFFFFFFFF : wl_next_ms / 2);
+
+        slept = 0;
+        long_sleep = 0;
+        start_val = host_systick.VAL;
+        pending = (host_scb.ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+        kernel_before = kernel_ticks;
+        ret = tls_tickless_idle_sleep();
+
+        HT_CHECK_EQ(suspended, 0);
+        HT_CHECK(!irq_disabled);
+        HT_CHECK_EQ(ret, slept);
+        if (!slept)
+        {
+            /* too short, or a tick pending */
+            HT_CHECK((limit < TICKLESS_IDLE_MIN_TICKS) || pending);
+            HT_CHECK(host_systick.CTRL & SysTick_CTRL_ENABLE_Msk);
+            service_tick();
+            HT_CHECK_EQ(kernel_ticks, ticks_at(now) - lost);
+            continue;
+        }
+        sleeps++;
+        early += wake_early;
+        HT_CHECK(!pending);
+
+        if (long_sleep)
+        {
+            longs++;
+            longs_early += wake_early && wake_wrapped;
+            check_long(start_val, limit, kernel_before);
+        }
+        else
+        {
+            /* the sleep covers whole ticks and ends no later than allowed */
+            HT_CHECK(limit <= tickless_max_idle_ticks);
+            HT_CHECK((sleep_reload + 1 - start_val) % CPT == 0);
+            expected = (sleep_reload + 1 - start_val) / CPT + 1;
+            HT_CHECK(expected >= TICKLESS_IDLE_MIN_TICKS);
+            HT_CHECK(expected <= limit);
+            HT_CHECK_EQ(tick_phase(sleep_start + 1 + sleep_reload), 0);
+
+            /* the tick interrupt left pending, then the kernel is up to date */
+            service_tick();
+            HT_CHECK_EQ(kernel_ticks, ticks_at(now) - lost);
+
+            /* the rest of the current tick ends on the next boundary */
+            counted = !wake_early;
+            tickless_wake(sleep_reload, wake_val, counted, expected, &load);
+            HT_CHECK_EQ(tick_phase(now + 1 + load), 0);
+            HT_CHECK_EQ(host_systick.LOAD, CPT - 1);
+            HT_CHECK(host_systick.CTRL & SysTick_CTRL_ENABLE_Msk);
+
+            /* the counter runs out on that boundary, go on from there */
+            now += CPT - tick_phase(now);
+        }
+        host_scb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+        host_systick.VAL = 0;
+        HT_STOP_IF_FAILED();
+    }
+
+    printf("%d rounds, %d sleeps, %d woken early, %d long, %d of them cut short after a lap, "
+           "%llu ticks, %llu behind\n",
+           ROUNDS, sleeps, early, longs, longs_early, (unsigned long long)kernel_ticks,
+           (unsigned long long)lost);
+    HT_CHECK(sleeps > ROUNDS / 4);
+    HT_CHECK(early > sleeps / 4);
+    HT_CHECK(longs > ROUNDS / 50);
+    HT_CHECK(longs_early > longs / 8);
+    return ht_done(__FILE__);
+}
@@ -0,0 +1,246 @@
+/*
+ * Checks the web file system image built by makefs (fsdata_lwip.h, see
+ * src/app/web/goall) against its sources in fs_basic and the lookup of
+ * fs.c: headers and flags, the gzip copy and the uncompressed one, entity
+ * tags, the name hash index and fs_open()/fs_use_plain().
+ */
+#include <zlib.h>
+#include "host_test.h"
+#include "../../src/app/web/fs.c"
+
+#define WEB_SRC         "../../src/app/web/fs_basic"
+#define MAX_BODY        (64 * 1024)
+
+u16 Web_parse_line(char *id_char, u16 *after_id_len, char *idvalue, u16 *Value_Offset, u8 *Id_type)
+{
+    return 0;
+}
+
+/* the source of an image file, templates are named hed<file> in the image */
+static int read_source(const char *name, unsigned char *buf)
+{
+    char path[256];
+    FILE *fp;
+    int len;
+
+    if (strncmp(name, "/hed", 4) == 0)
+        name += 4;
+    else
+        name++;
+    snprintf(path, sizeof(path), "%s/%s", WEB_SRC, name);
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+    len = (int)fread(buf, 1, MAX_BODY, fp);
+    fclose(fp);
+    return len;
+}
+
+/* split an image file in header and body, -1 if it has no header */
+static int split(const char *data, int len, char *hdr, const char **body)
+{
+    const char *end = NULL;
+    int i;
+
+    for (i = 0; i + 4 <= len; i++)
+    {
+        if (memcmp(data + i, "\r\n\r\n", 4) == 0)
+        {
+            end = data + i + 4;
+            break;
+        }
+    }
+    if (end == NULL)
+        return -1;
+    memcpy(hdr, data, end - data);
+    hdr[end - data] = 0;
+    *body = end;
+    return len - (int)(end - data);
+}
+
+static int header_has(const char *hdr, const char *line)
+{
+    return strstr(hdr, line) != NULL;
+}
+
+static void check_file(const struct fsdata_file *f, int *gzipped)
+{
+    static unsigned char src[MAX_BODY];
+    static unsigned char unzipped[MAX_BODY];
+    static char hdr[1024];
+    const char *name = (const char *)f->name;
+    const char *body;
+    char line[64];
+    int template = strstr(name, "hed") != NULL;
+    int srclen;
+    int len;
+    uLongf unzipped_len = sizeof(unzipped);
+    struct fs_file *file;
+    const struct fsdata_file *plain;
+
+    srclen = read_source(name, src);
+    HT_CHECK(srclen >= 0);
+    HT_CHECK_EQ(f->hash, fs_hash(name));
+
+    len = split((const char *)f->data, f->len, hdr, &body);
+    HT_CHECK(len >= 0);
+    if (len < 0)
+        return;
+
+    if (template)
+    {
+        /* filtered while sending, so plain, close-delimited and no ETag */
+        HT_CHECK(strncmp(hdr, "HTTP/1.0 200 OK\r\n", 17) == 0);
+        HT_CHECK_EQ(f->flags, 0);
+        HT_CHECK(f->etag == NULL);
+        HT_CHECK(f->plain == NULL);
+        HT_CHECK_EQ(len, srclen);
+        HT_CHECK(memcmp(body, src, len) == 0);
+        return;
+    }
+
+    HT_CHECK(strncmp(hdr, "HTTP/1.1 ", 9) == 0);
+    HT_CHECK(f->flags & FS_FILE_FLAG_LENGTH);
+    snprintf(line, sizeof(line), "Content-Length: %d\r\n", len);
+    HT_CHECK(header_has(hdr, line));
+    if (f->flags & FS_FILE_FLAG_ETAG)
+    {
+        snprintf(line, sizeof(line), "ETag: %s\r\n", f->etag);
+        HT_CHECK(header_has(hdr, line));
+    }
+    else
+    {
+        HT_CHECK(f->etag == NULL);
+    }
+
+    if (!(f->flags & FS_FILE_FLAG_GZIP))
+    {
+        HT_CHECK(!header_has(hdr, "Content-Encoding:"));
+        HT_CHECK(f->plain == NULL);
+        HT_CHECK_EQ(len, srclen);
+        HT_CHECK(memcmp(body, src, len) == 0);
+        return;
+    }
+
+    /* the gzip copy inflates to the source and is smaller */
+    (*gzipped)++;
+    HT_CHECK(header_has(hdr, "Content-Encoding: gzip\r\n"));
+    HT_CHECK(header_has(hdr, "Vary: Accept-Encoding\r\n"));
+    HT_CHECK(len < srclen);
+    {
+        z_stream zs;
+
+        memset(&zs, 0, sizeof(zs));
+        HT_CHECK_EQ(inflateInit2(&zs, 16 + MAX_WBITS), Z_OK);
+        zs.next_in = (Bytef *)body;
+        zs.avail_in = len;
+        zs.next_out = unzipped;
+        zs.avail_out = sizeof(unzipped);
+        HT_CHECK_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+        unzipped_len = zs.total_out;
+        inflateEnd(&zs);
+    }
+    HT_CHECK_EQ(unzipped_len, srclen);
+    HT_CHECK(memcmp(unzipped, src, srclen) == 0);
+
+    /* the uncompressed copy, same name, own ETag, not in the list */
+    plain = f->plain;
+    HT_CHECK(plain != NULL);
+    if (plain == NULL)
+        return;
+    HT_CHECK(strcmp((const char *)plain->name, name) == 0);
+    HT_CHECK(plain->next == NULL);
+    HT_CHECK(plain->plain == NULL);
+    HT_CHECK_EQ(plain->flags, f->flags & ~FS_FILE_FLAG_GZIP);
+    len = split((const char *)plain->data, plain->len, hdr, &body);
+    HT_CHECK_EQ(len, srclen);
+    HT_CHECK(memcmp(body, src, srclen) == 0);
+    HT_CHECK(!header_has(hdr, "Content-Encoding:"));
+    HT_CHECK(header_has(hdr, "Vary: Accept-Encoding\r\n"));
+    snprintf(line, sizeof(line), "Content-Length: %d\r\n", srclen);
+    HT_CHECK(header_has(hdr, line));
+    if (f->etag)
+    {
+        HT_CHECK(plain->etag != NULL);
+        if (plain->etag != NULL)
+        {
+            HT_CHECK(strcmp((const char *)plain->etag, (const char *)f->etag) != 0);
+            snprintf(line, sizeof(line), "ETag: %s\r\n", plain->etag);
+            HT_CHECK(header_has(hdr, line));
+        }
+    }
+
+    /* httpd switches to it for clients without gzip */
+    file = fs_open((char *)name);
+    HT_CHECK(file != NULL);
+    if (file == NULL)
+        return;
+    HT_CHECK(file->flags & FS_FILE_FLAG_GZIP);
+    HT_CHECK_EQ(fs_use_plain(file), 0);
+    HT_CHECK(file->data == (char *)plain->data);
+    HT_CHECK_EQ(file->len, plain->len);
+    HT_CHECK(file->etag == (const char *)plain->etag);
+    HT_CHECK(!(file->flags & FS_FILE_FLAG_GZIP));
+    HT_CHECK_EQ(fs_use_plain(file), -1);
+    fs_close(file);
+}
+
+int main(void)
+{
+    const struct fsdata_file *f;
+    struct fs_file *files[LWIP_MAX_OPEN_FILES];
+    struct fs_file *file;
+    int count = 0;
+    int gzipped = 0;
+    int found;
+    int i;
+
+    for (f = FS_ROOT; f != NULL; f = f->next)
+    {
+        check_file(f, &gzipped);
+
+        /* fs_open finds it through the index */
+        file = fs_open((char *)f->name);
+        HT_CHECK(file != NULL);
+        HT_STOP_IF_FAILED();
+        HT_CHECK(file->data == (char *)f->data);
+        HT_CHECK_EQ(file->len, f->len);
+        HT_CHECK_EQ(file->flags, f->flags);
+        if (!(f->flags & FS_FILE_FLAG_GZIP))
+            HT_CHECK_EQ(fs_use_plain(file), -1);
+        fs_close(file);
+
+        found = 0;
+        for (i = 0; i < FS_NUMFILES; i++)
+            found += (FS_INDEX[i].file == f);
+        HT_CHECK_EQ(found, 1);
+        count++;
+    }
+    HT_CHECK_EQ(count, FS_NUMFILES);
+    HT_CHECK(gzipped > 0);
+
+    for (i = 1; i < FS_NUMFILES; i++)
+        HT_CHECK(FS_INDEX[i - 1].hash <= FS_INDEX[i].hash);
+
+    /* misses, including a prefix and a name differing only in case */
+    HT_CHECK(fs_open("/nothere.html") == NULL);
+    HT_CHECK(fs_open("/index") == NULL);
+    HT_CHECK(fs_open("/INDEX.html") == NULL);
+    HT_CHECK(fs_open("") == NULL);
+
+    /* a miss or a full table does not leak entries */
+    for (i = 0; i < LWIP_MAX_OPEN_FILES; i++)
+    {
+        files[i] = fs_open("/index.html");
+        HT_CHECK(files[i] != NULL);
+    }
+    HT_CHECK(fs_open("/index.html") == NULL);
+    for (i = 0; i < LWIP_MAX_OPEN_FILES; i++)
+        fs_close(files[i]);
+    file = fs_open("/index.html");
+    HT_CHECK(file != NULL);
+    fs_close(file);
+
+    printf("%d files, %d gzip compressed\n", count, gzipped);
+    return ht_done(__FILE__);
+}
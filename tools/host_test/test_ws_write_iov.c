@@ -0,0 +1,355 @@
+/*
+ * Websocket server sends through lws_write_iov() with the socket taking a
+ * few bytes at a time, and lws_write() called in between: a data or
+ * control frame must be refused while an iov frame is partly on the wire,
+ * and a data frame while an iov message is unfinished. The byte stream the
+ * peer receives is parsed back into frames and has to match what was
+ * accepted.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "host_test.h"
+#include "../../src/app/libwebsockets-2.1-stable/output.c"
+
+#define STREAM_SIZE     (256 * 1024)
+#define MAX_EXPECT      4096
+
+/* what the socket takes on the next writev, -1 for no limit */
+static int budget = -1;
+static int writable_requests;
+
+void _lws_log(int filter, const char *format, ...)
+{
+    (void)filter;
+    (void)format;
+}
+
+int lws_callback_on_writable(struct lws *wsi)
+{
+    (void)wsi;
+    writable_requests++;
+    return 1;
+}
+
+void *lws_malloc(u32 size)
+{
+    return malloc(size);
+}
+
+void lws_free(void *p)
+{
+    free(p);
+}
+
+struct lws_context *lws_get_context(const struct lws *wsi)
+{
+    return wsi->context;
+}
+
+struct lws_plat_file_ops *lws_get_fops(struct lws_context *context)
+{
+    (void)context;
+    return NULL;
+}
+
+int lws_get_random(struct lws_context *context, void *buf, int len)
+{
+    (void)context;
+    memset(buf, 0x5a, len);
+    return len;
+}
+
+void lws_restart_ws_ping_pong_timer(struct lws *wsi)
+{
+    (void)wsi;
+}
+
+int lws_send_pipe_choked(struct lws *wsi)
+{
+    (void)wsi;
+    return 0;
+}
+
+void lws_set_timeout(struct lws *wsi, enum pending_timeout reason, int secs)
+{
+    (void)wsi;
+    (void)reason;
+    (void)secs;
+}
+
+int user_callback_handle_rxflow(lws_callback_function callback_function, struct lws *wsi,
+                                enum lws_callback_reasons reason, void *user,
+                                void *in, size_t len)
+{
+    (void)callback_function;
+    (void)wsi;
+    (void)reason;
+    (void)user;
+    (void)in;
+    (void)len;
+    return 0;
+}
+
+/* a socket that takes at most budget bytes */
+int lws_plat_writev(struct lws *wsi, const struct lws_iovec *iov, int iovcnt)
+{
+    static unsigned char flat[STREAM_SIZE];
+    size_t len = 0;
+    size_t n;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        n = iov[i].len;
+        if (budget >= 0 && len + n > (size_t)budget)
+            n = budget - len;
+        memcpy(flat + len, iov[i].base, n);
+        len += n;
+    }
+    if (!len)
+        return LWS_SSL_CAPABLE_MORE_SERVICE;
+    return send(wsi->sock, flat, len, 0);
+}
+
+/* the frames lws_write() and lws_write_iov() accepted, in order */
+typedef struct {
+    unsigned char opc;
+    size_t len;
+    const unsigned char *data;
+} expect_t;
+
+static expect_t expect[MAX_EXPECT];
+static int expect_count;
+
+static void expect_frame(unsigned char opc, const void *data, size_t len)
+{
+    expect[expect_count].opc = opc;
+    expect[expect_count].data = data;
+    expect[expect_count].len = len;
+    expect_count++;
+}
+
+/* read what the peer got and compare it frame by frame */
+static void check_stream(int fd)
+{
+    static unsigned char stream[STREAM_SIZE];
+    size_t got = 0;
+    size_t pos = 0;
+    size_t len;
+    int n;
+    int i;
+
+    while ((n = recv(fd, stream + got, sizeof(stream) - got, MSG_DONTWAIT)) > 0)
+        got += n;
+
+    for (i = 0; i < expect_count && pos + 2 <= got; i++)
+    {
+        HT_CHECK_EQ(stream[pos], expect[i].opc);
+        HT_CHECK_EQ(stream[pos + 1] & 0x80, 0);
+        len = stream[pos + 1] & 0x7f;
+        pos += 2;
+        if (len == 126)
+        {
+            len = (stream[pos] << 8) | stream[pos + 1];
+            pos += 2;
+        }
+        HT_CHECK_EQ(len, expect[i].len);
+        if (pos + len > got || len != expect[i].len)
+            break;
+        HT_CHECK(memcmp(stream + pos, expect[i].data, len) == 0);
+        pos += len;
+    }
+    HT_CHECK_EQ(i, expect_count);
+    HT_CHECK_EQ(pos, got);
+    expect_count = 0;
+}
+
+static struct lws_context context;
+static struct lws_protocols protocol;
+static struct lws wsi;
+static int peer;
+
+static void setup(size_t frame_limit)
+{
+    int sv[2];
+
+    if (wsi.sock > 0)
+    {
+        close(wsi.sock);
+        close(peer);
+    }
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    memset(&wsi, 0, sizeof(wsi));
+    wsi.context = &context;
+    wsi.protocol = &protocol;
+    wsi.sock = sv[0];
+    wsi.mode = LWSCM_WS_SERVING;
+    wsi.state = LWSS_ESTABLISHED;
+    wsi.ietf_spec_revision = 13;
+    peer = sv[1];
+    protocol.rx_buffer_size = frame_limit;
+    budget = -1;
+}
+
+static int write_iov(const unsigned char *data, size_t len, int wp)
+{
+    struct lws_iovec iov[2];
+
+    /* two pieces, split anywhere */
+    iov[0].base = data;
+    iov[0].len = len ? ht_rand() % (len + 1) : 0;
+    iov[1].base = data + iov[0].len;
+    iov[1].len = len - iov[0].len;
+    return lws_write_iov(&wsi, iov, 2, wp);
+}
+
+static unsigned char payload[64 * 1024];
+
+/* a frame is refused until the socket has taken all of the iov frame */
+static void test_partial_frame(void)
+{
+    static unsigned char text[LWS_PRE + 16];
+    int sent;
+    int n;
+
+    setup(0);
+    memcpy(text + LWS_PRE, "after", 5);
+
+    budget = 7;
+    writable_requests = 0;
+    sent = write_iov(payload, 300, LWS_WRITE_BINARY);
+    HT_CHECK_EQ(sent, 3);
+    HT_CHECK(wsi.u.ws.tx_hdr_len != 0);
+    HT_CHECK(writable_requests > 0);
+
+    HT_CHECK_EQ(lws_write(&wsi, text + LWS_PRE, 5, LWS_WRITE_TEXT), -1);
+    HT_CHECK_EQ(lws_write(&wsi, text + LWS_PRE, 0, LWS_WRITE_PING), -1);
+    HT_CHECK_EQ(lws_write(&wsi, text + LWS_PRE, 0, LWS_WRITE_PONG), -1);
+
+    /* the rest from the writable callback, a byte at a time at first */
+    budget = 1;
+    n = write_iov(payload + sent, 300 - sent, LWS_WRITE_BINARY);
+    HT_CHECK_EQ(n, 1);
+    sent += n;
+    HT_CHECK_EQ(lws_write(&wsi, text + LWS_PRE, 5, LWS_WRITE_TEXT), -1);
+    budget = -1;
+    HT_CHECK_EQ(write_iov(payload + sent, 300 - sent, LWS_WRITE_BINARY), 300 - sent);
+    HT_CHECK_EQ(wsi.u.ws.tx_hdr_len, 0);
+    expect_frame(0x80 | LWSWSOPC_BINARY_FRAME, payload, 300);
+
+    HT_CHECK_EQ(lws_write(&wsi, text + LWS_PRE, 5, LWS_WRITE_TEXT), 5);
+    expect_frame(0x80 | LWSWSOPC_TEXT_FRAME, text + LWS_PRE, 5);
+    check_stream(peer);
+}
+
+/* control frames may go between the frames of an unfinished message */
+static void test_open_message(void)
+{
+    static unsigned char buf[LWS_PRE + 16];
+    int n;
+
+    setup(100);
+    memcpy(buf + LWS_PRE, "ping", 4);
+
+    n = write_iov(payload, 150, LWS_WRITE_TEXT | LWS_WRITE_NO_FIN);
+    HT_CHECK_EQ(n, 150);
+    HT_CHECK_EQ(wsi.u.ws.tx_stream, 1);
+    expect_frame(LWSWSOPC_TEXT_FRAME, payload, 100);
+    expect_frame(LWSWSOPC_CONTINUATION, payload + 100, 50);
+
+    HT_CHECK_EQ(lws_write(&wsi, buf + LWS_PRE, 4, LWS_WRITE_TEXT), -1);
+    HT_CHECK_EQ(lws_write(&wsi, buf + LWS_PRE, 4, LWS_WRITE_BINARY), -1);
+    /* control frames count their header */
+    HT_CHECK_EQ(lws_write(&wsi, buf + LWS_PRE, 4, LWS_WRITE_PING), 6);
+    expect_frame(0x80 | LWSWSOPC_PING, buf + LWS_PRE, 4);
+
+    HT_CHECK_EQ(write_iov(payload + 150, 20, LWS_WRITE_TEXT), 20);
+    HT_CHECK_EQ(wsi.u.ws.tx_stream, 0);
+    expect_frame(0x80 | LWSWSOPC_CONTINUATION, payload + 150, 20);
+
+    HT_CHECK_EQ(lws_write(&wsi, buf + LWS_PRE, 4, LWS_WRITE_BINARY), 4);
+    expect_frame(0x80 | LWSWSOPC_BINARY_FRAME, buf + LWS_PRE, 4);
+    check_stream(peer);
+}
+
+/* the frames of a message of len bytes cut at 1000, up to byte upto */
+static void expect_message(size_t len, int wp, size_t *pos, size_t upto)
+{
+    size_t frame;
+    unsigned char opc;
+
+    while (*pos < upto)
+    {
+        frame = len - *pos > 1000 ? 1000 : len - *pos;
+        if (*pos)
+            opc = LWSWSOPC_CONTINUATION;
+        else
+            opc = wp == LWS_WRITE_TEXT ? LWSWSOPC_TEXT_FRAME : LWSWSOPC_BINARY_FRAME;
+        if (*pos + frame == len)
+            opc |= 0x80;
+        expect_frame(opc, payload + *pos, frame);
+        *pos += frame;
+    }
+}
+
+/* messages at random socket budgets, with a ping tried in between */
+static void test_random(int rounds)
+{
+    static unsigned char ping[LWS_PRE + 8];
+    size_t len, done, pos;
+    int round;
+    int wp;
+    int n;
+
+    setup(1000);
+    memcpy(ping + LWS_PRE, "p", 1);
+    for (round = 0; round < rounds; round++)
+    {
+        len = ht_rand() % 2 ? ht_rand_range(1, 200) : ht_rand_range(1000, 3000);
+        wp = ht_rand() % 2 ? LWS_WRITE_TEXT : LWS_WRITE_BINARY;
+        done = 0;
+        pos = 0;
+        do
+        {
+            budget = ht_rand() % 3 ? (int)ht_rand_range(0, 64) : -1;
+            n = write_iov(payload + done, len - done, wp);
+            HT_CHECK(n >= 0 && (size_t)n <= len - done);
+            if (n < 0)
+                return;
+            done += n;
+
+            /* it gets through only between frames */
+            budget = -1;
+            n = lws_write(&wsi, ping + LWS_PRE, 1, LWS_WRITE_PING);
+            HT_CHECK_EQ(n, wsi.u.ws.tx_hdr_len ? -1 : 3);
+            if (n > 0)
+            {
+                expect_message(len, wp, &pos, done);
+                expect_frame(0x80 | LWSWSOPC_PING, ping + LWS_PRE, 1);
+            }
+        } while (done < len);
+        expect_message(len, wp, &pos, len);
+        check_stream(peer);
+        if (ht_failed)
+            return;
+    }
+}
+
+int main(void)
+{
+    static unsigned char serv_buf[4096];
+    size_t i;
+
+    for (i = 0; i < sizeof(payload); i++)
+        payload[i] = (unsigned char)ht_rand();
+    context.pt_serv_buf_size = sizeof(serv_buf);
+    context.pt[0].serv_buf = serv_buf;
+
+    test_partial_frame();
+    test_open_message();
+    test_random(3000);
+    return ht_done(__FILE__);
+}